@@ -4,12 +4,16 @@
 #include <stdexcept>
 
 #include "../src/AppDelegate.h"
+#include "../src/util/Headless.h"
 #include "../src/util/Logger.h"
 
 int main(int argc, char* args[]) {
   // Install SIGSEGV handler. See util/Logger.cc
   signal(SIGSEGV, &vigilante::logger::segvHandler);
 
+  // e.g., ./Vigilante --headless --exec "benchmark ...". See util/Headless.h
+  vigilante::headless::init(argc, args);
+
   // Create the application instance
   AppDelegate app;
 
@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+# -*- encoding: utf-8 -*-
+#
+# Description
+# ===========
+# This program will pack the frames of several texture directories
+# into a multi-page texture atlas (cocos2d plist format 2), so that
+# the characters/equipment/fx sharing a graphical layer can be drawn
+# with a few shared SpriteBatchNodes (see src/map/BatchNodeRegistry.h).
+#
+# Each texture directory contains the frames cut by SpriteCutter.py, e.g.,
+#   Texture/character/player/player_attacking0/0.png
+#   Texture/character/player/player_attacking0/1.png
+#   ...
+#
+# Example usage:
+#   ./AtlasPacker.py Texture/atlas/characters Texture/character/*
+#
+# After running the program, there will be characters_0.png, characters_0.plist,
+# characters_1.png, characters_1.plist, ... and the .plist files are printed,
+# which should be listed in Texture/spritesheets.txt (replacing the per-directory
+# spritesheet.plist files).
+#
+# All of the frames of a texture directory are always packed into the same
+# page, since a sprite in a SpriteBatchNode can't switch textures.
+# Transparent borders are trimmed, and the offsets are recorded in the .plist.
+#
+# Compressed textures
+# ===================
+# With --compress, each page is also encoded into the GPU texture formats
+# which asset_manager::loadSpritesheets() picks from at runtime:
+#   s3tc  -> characters_0.dds (DXT5, desktop)
+#   pvrtc -> characters_0.pvr (PVRTC 4bpp, iOS; the page is padded to a square)
+#   etc1  -> characters_0.pkm and characters_0.pkm@alpha (android)
+#
+# Block compression is lossy, which pixel art doesn't tolerate well, so the
+# pages up to --lossless-max-size, and the pages with semi-transparent pixels,
+# are left as png only (and always loaded losslessly).
+#
+# Requirement
+# ===========
+# $ pip3 install --user Pillow
+# PVRTexToolCLI (s3tc, pvrtc) and etc1tool from the Android SDK (etc1) in $PATH.
+
+from PIL import Image
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+
+class Frame:
+    def __init__(self, name, img):
+        self.name = name
+        self.source_size = img.size
+        bbox = img.getbbox() or (0, 0, 1, 1)
+        self.color_rect = bbox
+        self.img = img.crop(bbox)
+        self.x = 0
+        self.y = 0
+
+    @property
+    def width(self):
+        return self.img.size[0]
+
+    @property
+    def height(self):
+        return self.img.size[1]
+
+
+class Page:
+    def __init__(self, max_size, padding):
+        self.max_size = max_size
+        self.padding = padding
+        self.frames = []
+        # Shelf packing: the frames are placed left to right in rows.
+        self.shelf_x = 0
+        self.shelf_y = 0
+        self.shelf_height = 0
+
+    def try_add(self, frames):
+        """Places all of `frames` in this page, or none of them."""
+        state = (self.shelf_x, self.shelf_y, self.shelf_height)
+        positions = []
+        for frame in frames:
+            pos = self.place(frame)
+            if pos is None:
+                self.shelf_x, self.shelf_y, self.shelf_height = state
+                return False
+            positions.append(pos)
+
+        for frame, (x, y) in zip(frames, positions):
+            frame.x, frame.y = x, y
+        self.frames.extend(frames)
+        return True
+
+    def place(self, frame):
+        w = frame.width + self.padding
+        h = frame.height + self.padding
+        if self.shelf_x + w > self.max_size:
+            self.shelf_x = 0
+            self.shelf_y += self.shelf_height
+            self.shelf_height = 0
+        if self.shelf_x + w > self.max_size or self.shelf_y + h > self.max_size:
+            return None
+        pos = (self.shelf_x, self.shelf_y)
+        self.shelf_x += w
+        self.shelf_height = max(self.shelf_height, h)
+        return pos
+
+    def size(self):
+        width = max(f.x + f.width for f in self.frames)
+        height = max(f.y + f.height for f in self.frames)
+        return next_pow2(width), next_pow2(height)
+
+
+def next_pow2(n):
+    p = 1
+    while p < n:
+        p *= 2
+    return p
+
+
+def load_frames(texture_dir):
+    frames = []
+    for frames_dir in sorted(os.listdir(texture_dir)):
+        path = os.path.join(texture_dir, frames_dir)
+        if not os.path.isdir(path):
+            continue
+        for png in sorted(os.listdir(path)):
+            if png.endswith('.png'):
+                img = Image.open(os.path.join(path, png)).convert('RGBA')
+                frames.append(Frame('{}/{}'.format(frames_dir, png), img))
+    # Taller frames first, so that the shelves are filled up more tightly.
+    frames.sort(key=lambda f: (-f.height, -f.width))
+    return frames
+
+
+def write_plist(plist_name, texture_file_name, page):
+    width, height = page.size()
+    lines = [
+        '<?xml version="1.0" encoding="UTF-8"?>',
+        '<!DOCTYPE plist PUBLIC "-//Apple//DTD PLIST 1.0//EN" '
+        '"http://www.apple.com/DTDs/PropertyList-1.0.dtd">',
+        '<plist version="1.0">',
+        '<dict>',
+        '  <key>frames</key>',
+        '  <dict>',
+    ]
+    for f in sorted(page.frames, key=lambda f: f.name):
+        left, top, right, bottom = f.color_rect
+        src_w, src_h = f.source_size
+        # The offset of the trimmed rect's center from the source's center (y-up).
+        offset_x = (left + right) / 2 - src_w / 2
+        offset_y = src_h / 2 - (top + bottom) / 2
+        lines += [
+            '    <key>{}</key>'.format(f.name),
+            '    <dict>',
+            '      <key>frame</key>',
+            '      <string>{{{{{},{}}},{{{},{}}}}}</string>'.format(f.x, f.y, f.width, f.height),
+            '      <key>offset</key>',
+            '      <string>{{{:g},{:g}}}</string>'.format(offset_x, offset_y),
+            '      <key>rotated</key>',
+            '      <false/>',
+            '      <key>sourceColorRect</key>',
+            '      <string>{{{{{},{}}},{{{},{}}}}}</string>'.format(left, top, f.width, f.height),
+            '      <key>sourceSize</key>',
+            '      <string>{{{},{}}}</string>'.format(src_w, src_h),
+            '    </dict>',
+        ]
+    lines += [
+        '  </dict>',
+        '  <key>metadata</key>',
+        '  <dict>',
+        '    <key>format</key>',
+        '    <integer>2</integer>',
+        '    <key>size</key>',
+        '    <string>{{{},{}}}</string>'.format(width, height),
+        '    <key>textureFileName</key>',
+        '    <string>{}</string>'.format(texture_file_name),
+        '  </dict>',
+        '</dict>',
+        '</plist>',
+    ]
+    with open(plist_name, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def is_alpha_sensitive(img):
+    """Whether `img` has any pixel which is neither transparent nor opaque."""
+    return any(0 < a < 255 for a in img.getchannel('A').getdata())
+
+
+def run(args):
+    try:
+        subprocess.check_call(args)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print('{}: {}'.format(args[0], e), file=sys.stderr)
+        sys.exit(1)
+
+
+def remove_stale_variants(png_name):
+    """The runtime prefers any variant it finds over the png."""
+    base_name = os.path.splitext(png_name)[0]
+    for ext in ('.dds', '.pvr', '.pkm', '.pkm@alpha'):
+        if os.path.exists(base_name + ext):
+            os.remove(base_name + ext)
+
+
+def compress(img, png_name, formats):
+    base_name = os.path.splitext(png_name)[0]
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        if 's3tc' in formats:
+            run(['PVRTexToolCLI', '-i', png_name, '-o', base_name + '.dds', '-f', 'BC3'])
+
+        if 'pvrtc' in formats:
+            # PVRTC only takes square textures. The padding goes to the right
+            # and the bottom, so the frame rects in the .plist stay the same.
+            size = max(img.size)
+            square = Image.new('RGBA', (size, size))
+            square.paste(img, (0, 0))
+            square_name = os.path.join(tmp_dir, 'square.png')
+            square.save(square_name)
+            run(['PVRTexToolCLI', '-i', square_name, '-o', base_name + '.pvr',
+                 '-f', 'PVRTC1_4', '-q', 'pvrtcbest'])
+
+        if 'etc1' in formats:
+            # ETC1 has no alpha, so the alpha goes into another ETC1 texture
+            # (see TextureCache::getETC1AlphaFileSuffix()).
+            rgb_name = os.path.join(tmp_dir, 'rgb.png')
+            alpha_name = os.path.join(tmp_dir, 'alpha.png')
+            img.convert('RGB').save(rgb_name)
+            img.getchannel('A').convert('RGB').save(alpha_name)
+            run(['etc1tool', rgb_name, '--encode', '-o', base_name + '.pkm'])
+            run(['etc1tool', alpha_name, '--encode', '-o', base_name + '.pkm@alpha'])
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Packs texture directories into a multi-page atlas.')
+    parser.add_argument('output_prefix', help='e.g., Texture/atlas/characters')
+    parser.add_argument('texture_dirs', nargs='+')
+    parser.add_argument('--max-size', type=int, default=2048, help='max width/height of a page')
+    parser.add_argument('--padding', type=int, default=1, help='pixels between frames')
+    parser.add_argument('--compress', nargs='+', default=[], choices=['s3tc', 'pvrtc', 'etc1'],
+                        help='compressed texture formats to encode each page into')
+    parser.add_argument('--lossless-max-size', type=int, default=256,
+                        help='pages whose width and height are both up to this are never compressed')
+    args = parser.parse_args()
+
+    pages = []
+    for texture_dir in args.texture_dirs:
+        frames = load_frames(texture_dir)
+        if not frames:
+            continue
+        if not any(page.try_add(frames) for page in pages):
+            page = Page(args.max_size, args.padding)
+            if not page.try_add(frames):
+                print('{} does not fit in a {}x{} page'.format(texture_dir, args.max_size, args.max_size),
+                      file=sys.stderr)
+                sys.exit(1)
+            pages.append(page)
+
+    output_dir = os.path.dirname(args.output_prefix)
+    if output_dir and not os.path.isdir(output_dir):
+        os.makedirs(output_dir)
+
+    for i, page in enumerate(pages):
+        png_name = '{}_{}.png'.format(args.output_prefix, i)
+        plist_name = '{}_{}.plist'.format(args.output_prefix, i)
+
+        img = Image.new('RGBA', page.size())
+        for f in page.frames:
+            img.paste(f.img, (f.x, f.y))
+        img.save(png_name)
+
+        remove_stale_variants(png_name)
+        is_small = max(img.size) <= args.lossless_max_size
+        if args.compress and not is_small and not is_alpha_sensitive(img):
+            compress(img, png_name, args.compress)
+
+        write_plist(plist_name, os.path.basename(png_name), page)
+        print(plist_name)
+
+
+if __name__ == '__main__':
+    main()
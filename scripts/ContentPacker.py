@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# -*- encoding: utf-8 -*-
+#
+# Description
+# ===========
+# This program will pack the assets of a region (a directory under Map/,
+# plus the tilesets, npcs, items and audio which only that region uses)
+# into a content pack, which is downloaded on demand and mounted at runtime
+# (see ContentPackManager in src/ContentPackManager.h), and updates the
+# entry of the region in the content pack manifest.
+#
+# The packed files should then be removed from the Resources/ shipped
+# inside the app. If any of them is a json under Database/, the database
+# pack must be rebuilt without it (see DatabasePacker.py), otherwise it
+# will keep serving the json from the app.
+#
+# Example usage:
+#   ./ContentPacker.py Resources Forest out/Forest.pack \
+#       --include Texture/tileset/forest Database/character/wolf.json Music/forest.mp3 \
+#       --neighbors VampireCastle \
+#       --manifest Resources/ContentPacks.json
+#
+# Format (all integers are little-endian uint32)
+# ==============================================
+# Same as the database pack (see DatabasePacker.py), except that:
+# magic:        'VCPK'
+# string table: the names of all entries, relative to Resources/,
+#               e.g., "Map/Forest/Cave.tmx"
+# data:         the exact bytes of each file
+#
+# The manifest lists the size and the crc32 of the whole pack, which are
+# verified before the pack is extracted.
+
+import argparse
+import json
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4b504356  # 'VCPK'
+VERSION = 1
+HEADER_SIZE = 16
+ENTRY_SIZE = 16
+
+
+def collect_entries(resources_dir, paths):
+    """Returns a sorted list of (name, file bytes) of the files under `paths`."""
+    entries = {}
+    for path in paths:
+        full_path = os.path.join(resources_dir, path)
+        if os.path.isfile(full_path):
+            file_paths = [full_path]
+        elif os.path.isdir(full_path):
+            file_paths = [os.path.join(root, file_name)
+                          for root, _, files in os.walk(full_path) for file_name in files]
+        else:
+            sys.exit('{} does not exist'.format(full_path))
+
+        for file_path in file_paths:
+            name = os.path.relpath(file_path, resources_dir).replace(os.sep, '/')
+            with open(file_path, 'rb') as f:
+                entries[name.encode('utf-8')] = f.read()
+
+    return sorted(entries.items(), key=lambda entry: entry[0])
+
+
+def write_pack(entries, pack_file_name):
+    string_table = b''.join(name for name, _ in entries)
+    data_offset = HEADER_SIZE + ENTRY_SIZE * len(entries) + len(string_table)
+
+    index = b''
+    name_offset = 0
+    for name, data in entries:
+        index += struct.pack('<4I', name_offset, len(name), data_offset, len(data))
+        name_offset += len(name)
+        data_offset += len(data)
+
+    with open(pack_file_name, 'wb') as f:
+        f.write(struct.pack('<4I', MAGIC, VERSION, len(entries), len(string_table)))
+        f.write(index)
+        f.write(string_table)
+        for _, data in entries:
+            f.write(data)
+
+
+def update_manifest(manifest_file_name, region, pack_file_name, neighbors):
+    manifest = {'baseUrl': '', 'packs': []}
+    if os.path.isfile(manifest_file_name):
+        with open(manifest_file_name, 'r', encoding='utf-8') as f:
+            manifest = json.load(f)
+
+    with open(pack_file_name, 'rb') as f:
+        data = f.read()
+
+    manifest['packs'] = [pack for pack in manifest['packs'] if pack['region'] != region]
+    manifest['packs'].append({
+        'region': region,
+        'fileName': os.path.basename(pack_file_name),
+        'size': len(data),
+        'crc32': zlib.crc32(data) & 0xffffffff,
+        'neighbors': neighbors,
+    })
+    manifest['packs'].sort(key=lambda pack: pack['region'])
+
+    with open(manifest_file_name, 'w', encoding='utf-8') as f:
+        json.dump(manifest, f, indent=2)
+        f.write('\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Packs the assets of a region into a content pack.')
+    parser.add_argument('resources_dir', help='e.g., Resources')
+    parser.add_argument('region', help='the directory under Map/, e.g., Forest')
+    parser.add_argument('pack_file', help='e.g., out/Forest.pack')
+    parser.add_argument('--include', nargs='*', default=[],
+                        help='the other files or directories to pack, relative to resources_dir')
+    parser.add_argument('--neighbors', nargs='*', default=[],
+                        help='the regions whose packs are kept resident along with this one')
+    parser.add_argument('--manifest', help='e.g., Resources/ContentPacks.json')
+    args = parser.parse_args()
+
+    if not os.path.isdir(os.path.join(args.resources_dir, 'Map', args.region)):
+        sys.exit('{} has no region named {}'.format(args.resources_dir, args.region))
+
+    entries = collect_entries(args.resources_dir, ['Map/' + args.region] + args.include)
+    write_pack(entries, args.pack_file)
+    print('Packed {} files into {}'.format(len(entries), args.pack_file))
+
+    if args.manifest:
+        update_manifest(args.manifest, args.region, args.pack_file, args.neighbors)
+        print('Updated {}'.format(args.manifest))
+
+
+if __name__ == '__main__':
+    main()
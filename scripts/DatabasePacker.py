@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+# -*- encoding: utf-8 -*-
+#
+# Description
+# ===========
+# This program will compile all of the json files under the Database
+# directory into a single indexed binary pack, which is memory mapped
+# at runtime (see asset_manager::loadDatabasePack() in src/AssetManager.h).
+# When there's no pack, the game falls back to the individual json files,
+# so the pack is only needed for release builds.
+#
+# Example usage:
+#   ./DatabasePacker.py Resources/Database Resources/Database.pack
+#
+# Remember to re-run the program after editing any json file,
+# otherwise the game will keep using the stale data in the pack.
+#
+# Format (all integers are little-endian uint32)
+# ==============================================
+# header:       magic ('VDBP'), version, entry count, string table size
+# index:        (name offset, name length, data offset, data length) per entry,
+#               sorted by name, so that the entries can be binary searched
+# string table: the names of all entries, e.g., "Database/character/vlad.json"
+# data:         the minified json of each entry
+#
+# The name offsets are relative to the string table, and the data offsets
+# are relative to the beginning of the file.
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+MAGIC = 0x50424456  # 'VDBP'
+VERSION = 1
+HEADER_SIZE = 16
+ENTRY_SIZE = 16
+
+
+def collect_entries(database_dir):
+    """Returns a sorted list of (name, minified json bytes)."""
+    prefix = os.path.basename(os.path.normpath(database_dir))
+    entries = []
+    for root, _, files in os.walk(database_dir):
+        for file_name in files:
+            if not file_name.endswith('.json'):
+                continue
+            path = os.path.join(root, file_name)
+            rel_path = os.path.relpath(path, database_dir).replace(os.sep, '/')
+            with open(path, 'r', encoding='utf-8') as f:
+                try:
+                    obj = json.load(f)
+                except json.JSONDecodeError as e:
+                    sys.exit('{}: {}'.format(path, e))
+            data = json.dumps(obj, ensure_ascii=False, separators=(',', ':')).encode('utf-8')
+            entries.append(('{}/{}'.format(prefix, rel_path).encode('utf-8'), data))
+
+    entries.sort(key=lambda entry: entry[0])
+    return entries
+
+
+def write_pack(entries, pack_file_name):
+    string_table = b''.join(name for name, _ in entries)
+    data_offset = HEADER_SIZE + ENTRY_SIZE * len(entries) + len(string_table)
+
+    index = b''
+    name_offset = 0
+    for name, data in entries:
+        index += struct.pack('<4I', name_offset, len(name), data_offset, len(data))
+        name_offset += len(name)
+        data_offset += len(data)
+
+    with open(pack_file_name, 'wb') as f:
+        f.write(struct.pack('<4I', MAGIC, VERSION, len(entries), len(string_table)))
+        f.write(index)
+        f.write(string_table)
+        for _, data in entries:
+            f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Packs the json database into a binary pack.')
+    parser.add_argument('database_dir', help='e.g., Resources/Database')
+    parser.add_argument('pack_file', help='e.g., Resources/Database.pack')
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.database_dir):
+        sys.exit('{} is not a directory'.format(args.database_dir))
+
+    entries = collect_entries(args.database_dir)
+    write_pack(entries, args.pack_file)
+    print('Packed {} json files into {}'.format(len(entries), args.pack_file))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# -*- encoding: utf-8 -*-
+#
+# Description
+# ===========
+# This program will prebake a pixel font (.ttf) at a fixed pixel size into
+# a bitmap font (AngelCode BMFont text format, i.e., a .fnt and a .png),
+# so that the labels can be created with Label::createWithBMFont() instead
+# of being rasterized by FreeType (see src/util/LabelUtil.h).
+#
+# The output files are named after the font and the size, e.g.,
+#   Font/at01.ttf at 16px -> Font/at01_16.fnt, Font/at01_16.png
+# which is where label_util::create() looks for them.
+#
+# Example usage:
+#   ./FontBaker.py Font/at01.ttf 12 16
+#   ./FontBaker.py Font/HeartbitXX2Px.ttf 16
+#   ./FontBaker.py Font/MatchupPro.ttf 16
+#
+# The glyphs are rendered in white without anti-aliasing, and are tinted
+# with the label's color at runtime (see label_util::setTextColor()).
+#
+# Requirement
+# ===========
+# $ pip3 install --user Pillow
+
+from PIL import Image, ImageDraw, ImageFont
+import argparse
+import os
+import sys
+
+
+FIRST_CHAR = 32   # ' '
+LAST_CHAR = 126   # '~'
+SPACING = 1       # the gap (in pixels) between the glyphs in the texture
+
+
+def next_power_of_two(n):
+    p = 1
+    while p < n:
+        p <<= 1
+    return p
+
+
+def layout_glyphs(glyphs, width):
+    """Arranges the glyphs in rows. Returns the height of the texture."""
+    x, y, row_height = SPACING, SPACING, 0
+    for glyph in glyphs:
+        w, h = glyph['img'].size
+        if x + w + SPACING > width:
+            x, y = SPACING, y + row_height + SPACING
+            row_height = 0
+        glyph['x'], glyph['y'] = x, y
+        x += w + SPACING
+        row_height = max(row_height, h)
+    return y + row_height + SPACING
+
+
+def bake(ttf_path, size):
+    font = ImageFont.truetype(ttf_path, size)
+    ascent, descent = font.getmetrics()
+
+    glyphs = []
+    for code in range(FIRST_CHAR, LAST_CHAR + 1):
+        ch = chr(code)
+        left, top, right, bottom = font.getbbox(ch)
+        w, h = max(right - left, 0), max(bottom - top, 0)
+
+        img = Image.new('RGBA', (w, h), (255, 255, 255, 0))
+        if w > 0 and h > 0:
+            draw = ImageDraw.Draw(img)
+            draw.fontmode = '1'  # no anti-aliasing
+            draw.text((-left, -top), ch, font=font, fill=(255, 255, 255, 255))
+
+        glyphs.append({
+            'id': code,
+            'img': img,
+            'xoffset': left,
+            'yoffset': top,
+            'xadvance': int(round(font.getlength(ch))),
+        })
+
+    # Find the smallest power-of-two square-ish texture which fits all glyphs.
+    width = 64
+    while True:
+        height = layout_glyphs(glyphs, width)
+        if height <= width:
+            break
+        width <<= 1
+    height = next_power_of_two(height)
+
+    atlas = Image.new('RGBA', (width, height), (255, 255, 255, 0))
+    for glyph in glyphs:
+        atlas.paste(glyph['img'], (glyph['x'], glyph['y']))
+
+    base_name = '{}_{}'.format(os.path.splitext(ttf_path)[0], size)
+    png_path = base_name + '.png'
+    fnt_path = base_name + '.fnt'
+    atlas.save(png_path)
+
+    face = os.path.splitext(os.path.basename(ttf_path))[0]
+    with open(fnt_path, 'w') as f:
+        f.write('info face="{}" size={} bold=0 italic=0 charset="" unicode=1 '
+                'stretchH=100 smooth=0 aa=0 padding=0,0,0,0 spacing={},{}\n'
+                .format(face, size, SPACING, SPACING))
+        f.write('common lineHeight={} base={} scaleW={} scaleH={} pages=1 packed=0\n'
+                .format(ascent + descent, ascent, width, height))
+        f.write('page id=0 file="{}"\n'.format(os.path.basename(png_path)))
+        f.write('chars count={}\n'.format(len(glyphs)))
+        for glyph in glyphs:
+            w, h = glyph['img'].size
+            f.write('char id={} x={} y={} width={} height={} xoffset={} yoffset={} '
+                    'xadvance={} page=0 chnl=15\n'
+                    .format(glyph['id'], glyph['x'], glyph['y'], w, h,
+                            glyph['xoffset'], glyph['yoffset'], glyph['xadvance']))
+
+    print(fnt_path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Prebake a pixel font into bitmap fonts.')
+    parser.add_argument('ttf', help='the .ttf file')
+    parser.add_argument('sizes', type=int, nargs='+', help='the pixel sizes to bake')
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.ttf):
+        print('{}: no such file'.format(args.ttf), file=sys.stderr)
+        return 1
+
+    for size in args.sizes:
+        bake(args.ttf, size)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
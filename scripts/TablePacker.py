@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# -*- encoding: utf-8 -*-
+#
+# Description
+# ===========
+# This program will compile the gameplay tables (exp_point_table.txt and
+# item_price_table.txt) under the Gameplay directory into binary packs
+# next to them, which are imported at runtime without any text parsing
+# (see exp_point_table::importPack() and item_price_table::importPack()).
+# When there's no pack, the game falls back to the text tables.
+#
+# Example usage:
+#   ./TablePacker.py Resources/Gameplay
+#
+# Remember to re-run the program after editing any table,
+# otherwise the game will keep using the stale data in the packs.
+#
+# Format (all integers are little-endian)
+# =======================================
+# exp_point_table.bin:  magic ('VEXP'), version, level count (uint32),
+#                       followed by the exp needed to level up at each level
+#                       (int32), indexed by level
+# item_price_table.bin: magic ('VIPT'), version, item count (uint32),
+#                       followed by (name length (uint32), name, price (int32))
+#                       per item
+
+import argparse
+import os
+import struct
+import sys
+
+EXP_POINT_TABLE_MAGIC = 0x50584556  # 'VEXP'
+EXP_POINT_TABLE_VERSION = 1
+ITEM_PRICE_TABLE_MAGIC = 0x54504956  # 'VIPT'
+ITEM_PRICE_TABLE_VERSION = 1
+LEVEL_CAP = 100  # see src/gameplay/ExpPointTable.h
+
+
+def read_table(table_file_name):
+    """Returns a list of (key, int value) of the whitespace-separated table."""
+    with open(table_file_name, 'r', encoding='utf-8') as f:
+        tokens = f.read().split()
+    if len(tokens) % 2 != 0:
+        sys.exit('{}: odd number of tokens'.format(table_file_name))
+    try:
+        return [(tokens[i], int(tokens[i + 1])) for i in range(0, len(tokens), 2)]
+    except ValueError as e:
+        sys.exit('{}: {}'.format(table_file_name, e))
+
+
+def pack_exp_point_table(table_file_name, pack_file_name):
+    exps = [0] * LEVEL_CAP
+    for level, exp in read_table(table_file_name):
+        level = int(level)
+        if not 0 <= level < LEVEL_CAP:
+            sys.exit('{}: level {} is out of range'.format(table_file_name, level))
+        exps[level] = exp
+
+    with open(pack_file_name, 'wb') as f:
+        f.write(struct.pack('<3I', EXP_POINT_TABLE_MAGIC, EXP_POINT_TABLE_VERSION, len(exps)))
+        f.write(struct.pack('<{}i'.format(len(exps)), *exps))
+    return len(exps)
+
+
+def pack_item_price_table(table_file_name, pack_file_name):
+    prices = read_table(table_file_name)
+    with open(pack_file_name, 'wb') as f:
+        f.write(struct.pack('<3I', ITEM_PRICE_TABLE_MAGIC, ITEM_PRICE_TABLE_VERSION, len(prices)))
+        for item_json_file_name, price in prices:
+            name = item_json_file_name.encode('utf-8')
+            f.write(struct.pack('<I', len(name)))
+            f.write(name)
+            f.write(struct.pack('<i', price))
+    return len(prices)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Packs the gameplay tables into binary packs.')
+    parser.add_argument('gameplay_dir', help='e.g., Resources/Gameplay')
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.gameplay_dir):
+        sys.exit('{} is not a directory'.format(args.gameplay_dir))
+
+    for name, pack in (('exp_point_table', pack_exp_point_table),
+                       ('item_price_table', pack_item_price_table)):
+        table_file_name = os.path.join(args.gameplay_dir, name + '.txt')
+        pack_file_name = os.path.join(args.gameplay_dir, name + '.bin')
+        count = pack(table_file_name, pack_file_name)
+        print('Packed {} rows of {} into {}'.format(count, table_file_name, pack_file_name))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+# -*- encoding: utf-8 -*-
+#
+# Description
+# ===========
+# This program will collect the texts shown to the player from all of the
+# json files under the Database directory, i.e., the dialogue lines and the
+# descs of the items, skills, quests and quest objectives, and cook them into
+# a binary pack, which is memory mapped at runtime (see TextId::importPack()
+# in src/util/TextId.h). Each distinct text is stored only once.
+# When there's no pack, the game interns the texts at runtime instead,
+# so the pack is only needed for release builds.
+#
+# Example usage:
+#   ./TextPacker.py Resources/Database Resources/Text.pack
+#
+# Remember to re-run the program after editing any json file,
+# otherwise the texts which are missing from the pack will be
+# interned at runtime again.
+#
+# Format (all integers are little-endian uint32)
+# ==============================================
+# header: magic ('VTXT'), version, text count, text data size
+# index:  (text offset, text length) per text, sorted by the utf-8 bytes
+#         of the texts, so that they can be binary searched
+# data:   the utf-8 bytes of all texts (not null-terminated)
+#
+# The text offsets are relative to the beginning of the text data.
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+MAGIC = 0x54585456  # 'VTXT'
+VERSION = 1
+DESC_KEYS = ('desc', 'questDesc')
+
+
+def collect_texts_from(obj, texts):
+    if isinstance(obj, dict):
+        for key, value in obj.items():
+            if key in DESC_KEYS and isinstance(value, str):
+                texts.add(value)
+            elif key == 'lines' and isinstance(value, list):
+                texts.update(line for line in value if isinstance(line, str))
+            else:
+                collect_texts_from(value, texts)
+    elif isinstance(obj, list):
+        for value in obj:
+            collect_texts_from(value, texts)
+
+
+def collect_texts(database_dir):
+    """Returns a sorted list of the utf-8 bytes of all distinct texts."""
+    texts = set()
+    for root, _, files in os.walk(database_dir):
+        for file_name in files:
+            if not file_name.endswith('.json'):
+                continue
+            path = os.path.join(root, file_name)
+            with open(path, 'r', encoding='utf-8') as f:
+                try:
+                    obj = json.load(f)
+                except json.JSONDecodeError as e:
+                    sys.exit('{}: {}'.format(path, e))
+            collect_texts_from(obj, texts)
+
+    # An empty text yields an invalid TextId, so it's never looked up.
+    texts.discard('')
+    return sorted(text.encode('utf-8') for text in texts)
+
+
+def write_pack(texts, pack_file_name):
+    data = b''.join(texts)
+
+    index = b''
+    offset = 0
+    for text in texts:
+        index += struct.pack('<2I', offset, len(text))
+        offset += len(text)
+
+    with open(pack_file_name, 'wb') as f:
+        f.write(struct.pack('<4I', MAGIC, VERSION, len(texts), len(data)))
+        f.write(index)
+        f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Packs the texts of the json database into a binary pack.')
+    parser.add_argument('database_dir', help='e.g., Resources/Database')
+    parser.add_argument('pack_file', help='e.g., Resources/Text.pack')
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.database_dir):
+        sys.exit('{} is not a directory'.format(args.database_dir))
+
+    texts = collect_texts(args.database_dir)
+    write_pack(texts, args.pack_file)
+    print('Packed {} texts into {}'.format(len(texts), args.pack_file))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,158 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "AnimationCache.h"
+
+#include <stdexcept>
+
+#include "AssetManager.h"
+#include "StaticActor.h"
+#include "TextureResidency.h"
+#include "util/StringUtil.h"
+#include "util/Logger.h"
+
+using std::string;
+using std::unordered_set;
+using std::runtime_error;
+using cocos2d::Vector;
+using cocos2d::Animation;
+using cocos2d::SpriteFrame;
+using cocos2d::SpriteFrameCache;
+
+namespace vigilante {
+
+AnimationCache* AnimationCache::getInstance() {
+  static AnimationCache instance;
+  return &instance;
+}
+
+
+Animation* AnimationCache::acquire(const string& textureResDir,
+                                   const string& framesName,
+                                   float interval,
+                                   Animation* fallback) {
+  // The frames of the cached animations may have been released
+  // from SpriteFrameCache along with their spritesheets as well.
+  TextureResidency::getInstance()->require(textureResDir);
+
+  const string key = AnimationCache::getKey(textureResDir, framesName, interval);
+  auto it = _entries.find(key);
+  if (it != _entries.end()) {
+    it->second.refCount++;
+    return it->second.animation;
+  }
+
+  Animation* animation = AnimationCache::create(textureResDir, framesName, interval);
+
+  // If there are no frames in the corresponding directory, use the fallback.
+  if (!animation) {
+    if (!fallback) {
+      throw runtime_error("Failed to create animations from " + textureResDir + "/" +
+                          StaticActor::getLastDirName(textureResDir) + "_" + framesName +
+                          ", but fallback animation is not provided.");
+    }
+    auto keyIt = _keys.find(fallback);
+    if (keyIt != _keys.end()) {
+      _entries[keyIt->second].refCount++;
+    }
+    return fallback;
+  }
+
+  _entries.insert({key, {animation, 1, textureResDir}});
+  _keys.insert({animation, key});
+  return animation;
+}
+
+void AnimationCache::preload(const string& textureResDir, const string& framesName, float interval) {
+  const string key = AnimationCache::getKey(textureResDir, framesName, interval);
+  if (_entries.find(key) != _entries.end()) {
+    return;
+  }
+
+  // Kept resident until it's acquired, or until the next evictUnused().
+  if (Animation* animation = AnimationCache::create(textureResDir, framesName, interval)) {
+    _entries.insert({key, {animation, 0, textureResDir}});
+    _keys.insert({animation, key});
+  }
+}
+
+void AnimationCache::release(Animation* animation) {
+  auto keyIt = _keys.find(animation);
+  if (keyIt == _keys.end()) {
+    VGLOG(LOG_ERR, "Releasing an animation which is not cached: %p", animation);
+    return;
+  }
+
+  AnimationCache::Entry& entry = _entries[keyIt->second];
+  if (entry.refCount <= 0) {
+    VGLOG(LOG_ERR, "Animation over-released: %s", keyIt->second.c_str());
+    return;
+  }
+  entry.refCount--;
+}
+
+void AnimationCache::evictUnused() {
+  // The actions which are still running an evicted animation hold
+  // their own reference to it, so it's safe to release it here.
+  for (auto it = _entries.begin(); it != _entries.end();) {
+    if (it->second.refCount == 0) {
+      _keys.erase(it->second.animation);
+      it->second.animation->release();
+      it = _entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t AnimationCache::size() const {
+  return _entries.size();
+}
+
+size_t AnimationCache::getNumReferences() const {
+  size_t numReferences = 0;
+  for (const auto& p : _entries) {
+    numReferences += p.second.refCount;
+  }
+  return numReferences;
+}
+
+unordered_set<string> AnimationCache::getReferencedTextureResDirs() const {
+  unordered_set<string> textureResDirs;
+  for (const auto& p : _entries) {
+    if (p.second.refCount > 0) {
+      textureResDirs.insert(p.second.textureResDir);
+    }
+  }
+  return textureResDirs;
+}
+
+
+Animation* AnimationCache::create(const string& textureResDir,
+                                  const string& framesName,
+                                  float interval) {
+  // See StaticActor::createAnimation() for the naming rules of the frames.
+  const string framesNamePrefix = StaticActor::getLastDirName(textureResDir);
+  const string prefixedFramesName = framesNamePrefix + "_" + framesName;
+  const size_t frameCount = asset_manager::getFrameCount(prefixedFramesName);
+  if (frameCount == 0) {
+    return nullptr;
+  }
+
+  SpriteFrameCache* frameCache = SpriteFrameCache::getInstance();
+  Vector<SpriteFrame*> frames;
+  for (size_t i = 0; i < frameCount; i++) {
+    frames.pushBack(frameCache->getSpriteFrameByName(prefixedFramesName + "/" +
+                                                     std::to_string(i) + ".png"));
+  }
+
+  Animation* animation = Animation::createWithSpriteFrames(frames, interval);
+  animation->retain();
+  return animation;
+}
+
+string AnimationCache::getKey(const string& textureResDir,
+                              const string& framesName,
+                              float interval) {
+  return string_util::format("%s/%s@%f", textureResDir.c_str(), framesName.c_str(), interval);
+}
+
+}  // namespace vigilante
@@ -0,0 +1,75 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_ANIMATION_CACHE_H_
+#define VIGILANTE_ANIMATION_CACHE_H_
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// An engine-wide cache of the cocos2d::Animations created from the texture
+// resources (see StaticActor::createAnimation()), keyed by
+// (textureResDir, framesName, interval), so that the actors which share
+// the same textures (e.g., a wave of goblins) also share their animations.
+//
+// Each animation is reference counted. Every acquire() should be paired with
+// a release(), but an animation whose reference count drops to zero is kept
+// resident until evictUnused() (e.g., when the GameMap is unloaded).
+//
+// All methods must be called on the main thread.
+class AnimationCache final {
+ public:
+  static AnimationCache* getInstance();
+
+  // Returns the specified animation, creating it if it isn't cached yet.
+  // If the animation cannot be created, `fallback` is returned instead
+  // (and it is acquired once more). If there's no `fallback` either,
+  // a std::runtime_error will be thrown.
+  cocos2d::Animation* acquire(const std::string& textureResDir,
+                              const std::string& framesName,
+                              float interval,
+                              cocos2d::Animation* fallback=nullptr);
+  void release(cocos2d::Animation* animation);
+
+  // Creates the specified animation without acquiring it, if it isn't cached
+  // yet, so that a later acquire() of it is just a lookup. Its frames must
+  // already be resident (see TextureResidency::prefetch()). It's a no-op
+  // if there are no such frames.
+  void preload(const std::string& textureResDir, const std::string& framesName, float interval);
+
+  // Releases all animations which are no longer referenced.
+  void evictUnused();
+  size_t size() const;
+  // The sum of the reference counts of all cached animations.
+  size_t getNumReferences() const;
+  // The textureResDirs of the animations which are still referenced (see TextureResidency).
+  std::unordered_set<std::string> getReferencedTextureResDirs() const;
+
+ private:
+  struct Entry final {
+    cocos2d::Animation* animation;
+    int refCount;
+    std::string textureResDir;
+  };
+
+  AnimationCache() = default;
+
+  static std::string getKey(const std::string& textureResDir,
+                            const std::string& framesName,
+                            float interval);
+
+  // Returns a retained animation, or nullptr if there are no such frames.
+  static cocos2d::Animation* create(const std::string& textureResDir,
+                                    const std::string& framesName,
+                                    float interval);
+
+  std::unordered_map<std::string, AnimationCache::Entry> _entries;
+  std::unordered_map<const cocos2d::Animation*, std::string> _keys;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_ANIMATION_CACHE_H_
@@ -1,15 +1,23 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "AppDelegate.h"
 
+#include <chrono>
 #include <string>
 
 #include "AssetManager.h"
 #include "Constants.h"
+#include "ContentPackManager.h"
+#include "scene/LoadingScene.h"
 #include "scene/SceneManager.h"
-#include "scene/MainMenuScene.h"
+#include "util/FramePacer.h"
+#include "util/Headless.h"
+#include "util/MainThread.h"
+#include "util/Telemetry.h"
+#include "util/TextId.h"
 
-//#define USE_AUDIO_ENGINE 1
-#define USE_SIMPLE_AUDIO_ENGINE 1
+// See AudioManager.
+#define USE_AUDIO_ENGINE 1
+//#define USE_SIMPLE_AUDIO_ENGINE 1
 
 #if USE_AUDIO_ENGINE && USE_SIMPLE_AUDIO_ENGINE
 #error "Don't use AudioEngine and SimpleAudioEngine at the same time. Please just select one in your game!"
@@ -57,6 +65,8 @@ static int register_all_packages() {
 }
 
 bool AppDelegate::applicationDidFinishLaunching() {
+  vigilante::main_thread::init();
+
   // Initialize director
   Director* director = Director::getInstance();
   GLView* glview = director->getOpenGLView();
@@ -70,16 +80,30 @@ bool AppDelegate::applicationDidFinishLaunching() {
     director->setOpenGLView(glview);
   }
 
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32) || (CC_TARGET_PLATFORM == CC_PLATFORM_MAC) || (CC_TARGET_PLATFORM == CC_PLATFORM_LINUX)
+  // The GL context is still needed for the textures, but nothing is presented.
+  if (vigilante::headless::isEnabled()) {
+    glfwHideWindow(static_cast<GLViewImpl*>(glview)->getWindow());
+  }
+#endif
+
   glview->setDesignResolutionSize(kVirtualWidth, kVirtualHeight, ResolutionPolicy::SHOW_ALL);
 
-  // set FPS. the default value is 1.0/60 if you don't call this
-  director->setAnimationInterval(1.0f / 60);
+  // The animation interval is adjusted by FramePacer from now on.
+  vigilante::FramePacer::getInstance()->init();
+  vigilante::Telemetry::getInstance()->init();
 
-  // Load resources
-  vigilante::asset_manager::loadSpritesheets(vigilante::asset_manager::kSpritesheetsList);
+  // Load resources. The spritesheets and the tables are loaded by LoadingScene,
+  // which then replaces itself with MainMenuScene.
+  const auto beginTime = std::chrono::steady_clock::now();
+  vigilante::asset_manager::loadDatabasePack(vigilante::asset_manager::kDatabasePack);
+  vigilante::TextId::importPack(vigilante::asset_manager::kTextPack);
+  vigilante::ContentPackManager::getInstance()->init(vigilante::asset_manager::kContentPacksManifest);
+  const std::chrono::duration<float> loadTime = std::chrono::steady_clock::now() - beginTime;
+  vigilante::Telemetry::getInstance()->addStartupPhase("databasePack", loadTime.count());
 
   // Create a scene (auto-release object).
-  vigilante::SceneManager::getInstance()->runWithScene(vigilante::MainMenuScene::create());
+  vigilante::SceneManager::getInstance()->runWithScene(vigilante::LoadingScene::create());
 
   return true;
 }
@@ -87,6 +111,7 @@ bool AppDelegate::applicationDidFinishLaunching() {
 // This function will be called when the app is inactive. Note, when receiving a phone call it is invoked.
 void AppDelegate::applicationDidEnterBackground() {
   Director::getInstance()->stopAnimation();
+  vigilante::Telemetry::getInstance()->flush();
 
 #if USE_AUDIO_ENGINE
   AudioEngine::pauseAll();
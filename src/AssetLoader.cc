@@ -0,0 +1,107 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "util/TraceProfiler.h"
+
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::lock_guard;
+using std::mutex;
+using std::thread;
+
+namespace vigilante {
+
+AssetLoader::AssetLoader(int numWorkerThreads)
+    : _numWorkerThreads(std::max(numWorkerThreads, 1)),
+      _tasks(),
+      _workerThreads(),
+      _nextTaskIndex(),
+      _loadedTaskIndicesMutex(),
+      _loadedTaskIndices(),
+      _numCommittedTasks() {}
+
+AssetLoader::~AssetLoader() {
+  // Let the workers finish their current tasks, and skip the rest.
+  _nextTaskIndex = _tasks.size();
+  joinWorkerThreads();
+}
+
+
+void AssetLoader::addTask(const LoadFunc& load, const CommitFunc& commit) {
+  _tasks.push_back({load, commit, nullptr});
+}
+
+void AssetLoader::start() {
+  const int numWorkerThreads = std::min(_numWorkerThreads, static_cast<int>(_tasks.size()));
+  for (int i = 0; i < numWorkerThreads; i++) {
+    _workerThreads.push_back(thread(&AssetLoader::runWorkerThread, this));
+  }
+}
+
+bool AssetLoader::update(float timeBudget) {
+  const steady_clock::time_point beginTime = steady_clock::now();
+
+  while (_numCommittedTasks < _tasks.size()) {
+    size_t taskIndex;
+    {
+      lock_guard<mutex> lock(_loadedTaskIndicesMutex);
+      if (_loadedTaskIndices.empty()) {
+        break;
+      }
+      taskIndex = _loadedTaskIndices.back();
+      _loadedTaskIndices.pop_back();
+    }
+
+    Task& task = _tasks[taskIndex];
+    if (task.exception) {
+      std::rethrow_exception(task.exception);
+    }
+    if (task.commit) {
+      VGTRACE_ZONE("AssetLoader::commit");
+      task.commit();
+    }
+    _numCommittedTasks++;
+
+    const duration<float> elapsed = steady_clock::now() - beginTime;
+    if (elapsed.count() >= timeBudget) {
+      break;
+    }
+  }
+
+  if (_numCommittedTasks < _tasks.size()) {
+    return false;
+  }
+  joinWorkerThreads();
+  return true;
+}
+
+float AssetLoader::getProgress() const {
+  return (_tasks.empty()) ? 1.0f : static_cast<float>(_numCommittedTasks) / _tasks.size();
+}
+
+
+void AssetLoader::runWorkerThread() {
+  for (size_t i = _nextTaskIndex++; i < _tasks.size(); i = _nextTaskIndex++) {
+    try {
+      VGTRACE_ZONE("AssetLoader::load");
+      _tasks[i].load();
+    } catch (...) {
+      _tasks[i].exception = std::current_exception();
+    }
+
+    lock_guard<mutex> lock(_loadedTaskIndicesMutex);
+    _loadedTaskIndices.push_back(i);
+  }
+}
+
+void AssetLoader::joinWorkerThreads() {
+  for (auto& workerThread : _workerThreads) {
+    workerThread.join();
+  }
+  _workerThreads.clear();
+}
+
+}  // namespace vigilante
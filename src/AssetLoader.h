@@ -0,0 +1,66 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_ASSET_LOADER_H_
+#define VIGILANTE_ASSET_LOADER_H_
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vigilante {
+
+// Loads assets on a pool of worker threads. Each task consists of a load
+// function which runs on a worker thread (e.g., decoding a png, parsing a
+// plist), and an optional commit function which runs on the main thread
+// afterwards (e.g., uploading the decoded image to a GL texture).
+//
+// The commit functions are run by update(), which must be called on the
+// main thread every frame until it returns true. If a load function throws,
+// the exception is rethrown from update().
+class AssetLoader final {
+ public:
+  using LoadFunc = std::function<void ()>;
+  using CommitFunc = std::function<void ()>;
+
+  explicit AssetLoader(int numWorkerThreads);
+  ~AssetLoader();
+
+  AssetLoader(const AssetLoader&) = delete;
+  AssetLoader& operator=(const AssetLoader&) = delete;
+
+  // Must be called before start().
+  void addTask(const LoadFunc& load, const CommitFunc& commit=nullptr);
+  void start();
+
+  // Runs the commit functions of the loaded tasks until `timeBudget`
+  // (in seconds) is used up. Returns true if all tasks have been committed.
+  bool update(float timeBudget);
+
+  // Returns the ratio (0~1) of the committed tasks.
+  float getProgress() const;
+
+ private:
+  struct Task final {
+    LoadFunc load;
+    CommitFunc commit;
+    std::exception_ptr exception;  // thrown by `load`
+  };
+
+  void runWorkerThread();
+  void joinWorkerThreads();
+
+  int _numWorkerThreads;
+  std::vector<AssetLoader::Task> _tasks;
+  std::vector<std::thread> _workerThreads;
+  std::atomic<size_t> _nextTaskIndex;
+
+  std::mutex _loadedTaskIndicesMutex;
+  std::vector<size_t> _loadedTaskIndices;
+  size_t _numCommittedTasks;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_ASSET_LOADER_H_
@@ -2,25 +2,539 @@
 #include "AssetManager.h"
 
 extern "C" {
+#include <sys/stat.h>
 #include <unistd.h>
 }
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <fstream>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 #include <cocos2d.h>
+#include <zlib.h>
+#include "AssetLoader.h"
+#include "TextureResidency.h"
+#include "std/make_unique.h"
+#include "util/ds/BinaryStream.h"
+#include "util/LoadProfiler.h"
 #include "util/Logger.h"
+#include "util/MappedFile.h"
+
+#define DATABASE_PACK_MAGIC 0x50424456  // 'VDBP'
+#define DATABASE_PACK_VERSION 1
+
+#define CONTENT_PACK_MAGIC 0x4b504356  // 'VCPK'
+#define CONTENT_PACK_VERSION 1
+#define CONTENT_PACK_STAMP_FILE_NAME ".crc32"
+#define CRC32_CHUNK_SIZE (1 << 20)
+
+#define SPRITESHEET_INDEX_MAGIC 0x46534756  // "VGSF"
+#define SPRITESHEET_INDEX_VERSION 1
+#define SPRITESHEET_INDEX_DIR "spritesheet_cache/"
 
 using std::string;
 using std::ifstream;
+using std::ofstream;
+using std::unique_ptr;
 using std::runtime_error;
+using std::vector;
+using std::unordered_map;
+using std::make_shared;
+using std::shared_ptr;
+using cocos2d::Configuration;
+using cocos2d::Director;
+using cocos2d::FileUtils;
+using cocos2d::Image;
+using cocos2d::Rect;
+using cocos2d::RefPtr;
+using cocos2d::Size;
+using cocos2d::SpriteFrame;
 using cocos2d::SpriteFrameCache;
+using cocos2d::Texture2D;
+using cocos2d::TextureCache;
+using cocos2d::ValueMap;
+using cocos2d::Vec2;
 
 namespace vigilante {
 
 namespace asset_manager {
 
+namespace {
+
+// prefixed frames name -> frame count
+unordered_map<string, size_t> animationManifest;
+
+// prefixed frames name -> whether each frame (0.png, 1.png, ...) exists
+//
+// The frames of an animation aren't necessarily in the same spritesheet
+// (e.g., hand-made pages of a multi-page atlas), so they're collected from
+// all of the spritesheets first, and then counted by buildAnimationManifest().
+using FrameIndices = unordered_map<string, vector<bool>>;
+
+// The frames of a spritesheet, as SpriteFrameCache would read them from
+// its plist (format 2, which is what scripts/AtlasPacker.py writes).
+//
+// Parsing the xml plists is a large share of the startup time, so each
+// index is compiled into <writable path>/spritesheet_cache/ the first time
+// its plist is loaded, keyed by the plist's mtime, and read from there
+// on later launches (see readSpritesheetIndex()).
+struct SpritesheetIndex final {
+  struct Frame final {
+    string name;
+    Rect rect;
+    Vec2 offset;
+    Size originalSize;
+    bool isRotated;
+  };
+
+  string textureFileName;  // relative to the plist, or empty if named after the plist
+  vector<SpritesheetIndex::Frame> frames;
+
+  // False if the plist isn't in format 2 (e.g., polygon sprites), in which
+  // case only the frame names are indexed, and the frames themselves have
+  // to be added by SpriteFrameCache from the plist.
+  bool hasFrameGeometry;
+};
+
+void parseSpritesheetIndex(const ValueMap& dict, SpritesheetIndex& index) {
+  index.hasFrameGeometry = false;
+  int format = 0;
+  auto metadataIt = dict.find("metadata");
+  if (metadataIt != dict.end()) {
+    const ValueMap& metadata = metadataIt->second.asValueMap();
+    auto it = metadata.find("textureFileName");
+    if (it != metadata.end()) {
+      index.textureFileName = it->second.asString();
+    }
+    it = metadata.find("format");
+    if (it != metadata.end()) {
+      format = it->second.asInt();
+    }
+  }
+
+  auto framesIt = dict.find("frames");
+  if (framesIt == dict.end()) {
+    index.hasFrameGeometry = (format == 2);
+    return;
+  }
+
+  const ValueMap& frames = framesIt->second.asValueMap();
+  index.frames.reserve(frames.size());
+  bool hasFrameGeometry = (format == 2);
+  for (const auto& frame : frames) {
+    index.frames.push_back({frame.first, Rect::ZERO, Vec2::ZERO, Size::ZERO, false});
+    if (!hasFrameGeometry) {
+      continue;
+    }
+
+    const ValueMap& frameDict = frame.second.asValueMap();
+    auto rectIt = frameDict.find("frame");
+    auto offsetIt = frameDict.find("offset");
+    auto sourceSizeIt = frameDict.find("sourceSize");
+    if (rectIt == frameDict.end() || offsetIt == frameDict.end() ||
+        sourceSizeIt == frameDict.end() || frameDict.count("vertices")) {
+      hasFrameGeometry = false;
+      continue;
+    }
+
+    SpritesheetIndex::Frame& indexedFrame = index.frames.back();
+    indexedFrame.rect = cocos2d::RectFromString(rectIt->second.asString());
+    indexedFrame.offset = cocos2d::PointFromString(offsetIt->second.asString());
+    indexedFrame.originalSize = cocos2d::SizeFromString(sourceSizeIt->second.asString());
+    auto rotatedIt = frameDict.find("rotated");
+    indexedFrame.isRotated = rotatedIt != frameDict.end() && rotatedIt->second.asBool();
+  }
+  index.hasFrameGeometry = hasFrameGeometry;
+}
+
+int64_t getLastModifiedTime(const string& fullPath) {
+  struct stat st;
+  return (stat(fullPath.c_str(), &st) == 0) ? static_cast<int64_t>(st.st_mtime) : -1;
+}
+
+// Example: /.../Texture/characters_0.plist -> <cacheDir>/<FNV-1a of the full path>.bin
+// The full path is stored in the file as well, in case of a hash collision.
+string getCompiledSpritesheetIndexFileName(const string& plistFullPath, const string& cacheDir) {
+  uint32_t hash = 2166136261u;
+  for (const char c : plistFullPath) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  char fileName[16];
+  std::snprintf(fileName, sizeof(fileName), "%08x.bin", hash);
+  return cacheDir + fileName;
+}
+
+bool loadCompiledSpritesheetIndex(const string& compiledFileName, const string& plistFullPath,
+                                  int64_t mtime, SpritesheetIndex& index) {
+  MappedFile file(compiledFileName);
+  if (!file.isOpen()) {
+    return false;
+  }
+
+  BinaryReader reader(file.getData(), file.getData() + file.getSize());
+  if (reader.read<uint32_t>() != SPRITESHEET_INDEX_MAGIC ||
+      reader.read<uint32_t>() != SPRITESHEET_INDEX_VERSION ||
+      reader.read<int64_t>() != mtime ||
+      reader.readString() != plistFullPath) {
+    return false;
+  }
+
+  index.textureFileName = reader.readString();
+  index.hasFrameGeometry = reader.read<uint8_t>();
+  index.frames.resize(reader.readCount());
+  for (auto& frame : index.frames) {
+    frame.name = reader.readString();
+    frame.rect.origin.x = reader.read<float>();
+    frame.rect.origin.y = reader.read<float>();
+    frame.rect.size.width = reader.read<float>();
+    frame.rect.size.height = reader.read<float>();
+    frame.offset.x = reader.read<float>();
+    frame.offset.y = reader.read<float>();
+    frame.originalSize.width = reader.read<float>();
+    frame.originalSize.height = reader.read<float>();
+    frame.isRotated = reader.read<uint8_t>();
+  }
+  return reader.isOk();
+}
+
+void saveCompiledSpritesheetIndex(const string& compiledFileName, const string& plistFullPath,
+                                  int64_t mtime, const SpritesheetIndex& index) {
+  BinaryWriter writer;
+  writer.write<uint32_t>(SPRITESHEET_INDEX_MAGIC);
+  writer.write<uint32_t>(SPRITESHEET_INDEX_VERSION);
+  writer.write<int64_t>(mtime);
+  writer.writeString(plistFullPath);
+  writer.writeString(index.textureFileName);
+  writer.write<uint8_t>(index.hasFrameGeometry);
+  writer.write<uint32_t>(index.frames.size());
+  for (const auto& frame : index.frames) {
+    writer.writeString(frame.name);
+    writer.write(frame.rect.origin.x);
+    writer.write(frame.rect.origin.y);
+    writer.write(frame.rect.size.width);
+    writer.write(frame.rect.size.height);
+    writer.write(frame.offset.x);
+    writer.write(frame.offset.y);
+    writer.write(frame.originalSize.width);
+    writer.write(frame.originalSize.height);
+    writer.write<uint8_t>(frame.isRotated);
+  }
+
+  // Written to a temporary file first and then renamed, so that
+  // a crash never leaves a truncated index behind.
+  const string tmpFileName = compiledFileName + ".tmp";
+  ofstream fout(tmpFileName, std::ios::binary | std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_WARN, "Unable to write spritesheet index: %s", compiledFileName.c_str());
+    return;
+  }
+  fout.write(writer.getBuffer().data(), writer.getBuffer().size());
+  fout.close();
+
+  if (std::rename(tmpFileName.c_str(), compiledFileName.c_str()) != 0) {
+    std::remove(tmpFileName.c_str());
+  }
+}
+
+// Reads the index of the specified spritesheet from its compiled cache if it's
+// up to date, or parses the plist (and compiles the cache) otherwise.
+// This may be called on any thread, as long as `plistFullPath` is absolute
+// and `cacheDir` (<writable path>/spritesheet_cache/) has been created.
+void readSpritesheetIndex(const string& plistFullPath, const string& cacheDir,
+                          SpritesheetIndex& index) {
+  const string compiledFileName = getCompiledSpritesheetIndexFileName(plistFullPath, cacheDir);
+  const int64_t mtime = getLastModifiedTime(plistFullPath);
+  if (mtime >= 0 && loadCompiledSpritesheetIndex(compiledFileName, plistFullPath, mtime, index)) {
+    return;
+  }
+
+  index = SpritesheetIndex{};
+  FileUtils* fileUtils = FileUtils::getInstance();
+  const string plistContent = fileUtils->getStringFromFile(plistFullPath);
+  LoadProfiler::addFileRead(plistContent.size());
+  parseSpritesheetIndex(fileUtils->getValueMapFromData(plistContent.c_str(), plistContent.size()),
+                        index);
+  if (mtime >= 0 && !plistContent.empty()) {
+    saveCompiledSpritesheetIndex(compiledFileName, plistFullPath, mtime, index);
+  }
+}
+
+// Adds the frames of the spritesheet to SpriteFrameCache,
+// the same way as SpriteFrameCache::addSpriteFramesWithFile() would.
+void addSpriteFrames(const string& plistFullPath, const SpritesheetIndex& index,
+                     Texture2D* texture) {
+  SpriteFrameCache* frameCache = SpriteFrameCache::getInstance();
+  if (!index.hasFrameGeometry) {
+    frameCache->addSpriteFramesWithFile(plistFullPath, texture);
+    return;
+  }
+
+  for (const auto& frame : index.frames) {
+    frameCache->addSpriteFrame(SpriteFrame::createWithTexture(texture, frame.rect, frame.isRotated,
+                                                              frame.offset, frame.originalSize),
+                               frame.name);
+  }
+}
+
+string getSpritesheetIndexDir() {
+  const string cacheDir = FileUtils::getInstance()->getWritablePath() + SPRITESHEET_INDEX_DIR;
+  FileUtils::getInstance()->createDirectory(cacheDir);
+  return cacheDir;
+}
+
+// Records the frames of the specified spritesheet into `frameIndices`.
+// Each frame is named as "<prefixed frames name>/<frame index>.png",
+// e.g., "player_attacking0/0.png". Returns false if some of the frames
+// aren't named that way (i.e., they aren't animation frames).
+bool addToFrameIndices(const SpritesheetIndex& index, FrameIndices& frameIndices) {
+  bool hasAnimationFramesOnly = true;
+  for (const auto& frame : index.frames) {
+    const string& frameName = frame.name;
+    const size_t slashPos = frameName.find_last_of('/');
+    const size_t dotPos = frameName.find_last_of('.');
+    if (slashPos == string::npos || dotPos == string::npos || dotPos <= slashPos + 1) {
+      hasAnimationFramesOnly = false;
+      continue;
+    }
+
+    const string indexStr = frameName.substr(slashPos + 1, dotPos - slashPos - 1);
+    if (indexStr.find_first_not_of("0123456789") != string::npos) {
+      hasAnimationFramesOnly = false;
+      continue;
+    }
+
+    const size_t index = std::stoul(indexStr);
+    vector<bool>& indices = frameIndices[frameName.substr(0, slashPos)];
+    if (indices.size() <= index) {
+      indices.resize(index + 1);
+    }
+    indices[index] = true;
+  }
+  return hasAnimationFramesOnly;
+}
+
+// Only the spritesheets which consist of animation frames alone
+// can be released by TextureResidency.
+void addToTextureResidency(const string& plistFullPath, const string& textureFullPath,
+                           const FrameIndices& frameIndices, bool hasAnimationFramesOnly) {
+  vector<string> framesNames;
+  framesNames.reserve(frameIndices.size());
+  for (const auto& entry : frameIndices) {
+    framesNames.push_back(entry.first);
+  }
+  TextureResidency::getInstance()->addSpritesheet(plistFullPath, textureFullPath,
+                                                  std::move(framesNames), hasAnimationFramesOnly);
+}
+
+void buildAnimationManifest(const FrameIndices& frameIndices) {
+  // Only the frames 0.png, 1.png, ..., n.png (without any gaps) count.
+  for (const auto& entry : frameIndices) {
+    size_t frameCount = 0;
+    while (frameCount < entry.second.size() && entry.second[frameCount]) {
+      frameCount++;
+    }
+    animationManifest[entry.first] = frameCount;
+  }
+}
+
+void mergeFrameIndices(const FrameIndices& src, FrameIndices& dst) {
+  for (const auto& entry : src) {
+    vector<bool>& indices = dst[entry.first];
+    if (indices.size() < entry.second.size()) {
+      indices.resize(entry.second.size());
+    }
+    for (size_t i = 0; i < entry.second.size(); i++) {
+      indices[i] = indices[i] || entry.second[i];
+    }
+  }
+}
+
+// The extensions of the compressed texture formats which the GPU supports,
+// most preferred first. scripts/AtlasPacker.py (--compress) writes them next
+// to the png pages, e.g., characters_0.dds, characters_0.pvr, characters_0.pkm.
+// Must be called on the main thread, after the GL context has been created.
+vector<string> getSupportedTextureExtensions() {
+  const Configuration* configuration = Configuration::getInstance();
+  vector<string> extensions;
+  if (configuration->supportsS3TC()) {
+    extensions.push_back(".dds");  // desktop, DXT5
+  }
+  if (configuration->supportsPVRTC()) {
+    extensions.push_back(".pvr");  // iOS, PVRTC 4bpp
+  }
+  if (configuration->supportsETC()) {
+    extensions.push_back(".pkm");  // android, ETC1 (with a separate alpha texture)
+  }
+  return extensions;
+}
+
+// Same as SpriteFrameCache, the texture is either specified in the metadata
+// (relative to the plist), or has the same name as the plist. If a compressed
+// variant of it exists in one of `extensions`, that one is picked instead.
+// The pages which have been left as png (e.g., the small or alpha-sensitive ones,
+// see AtlasPacker.py) are always loaded losslessly.
+string getTextureFullPath(const string& plistFullPath, const string& textureFileName,
+                          const vector<string>& extensions) {
+  const string textureFullPath = (!textureFileName.empty()) ?
+    plistFullPath.substr(0, plistFullPath.find_last_of('/') + 1) + textureFileName :
+    plistFullPath.substr(0, plistFullPath.find_last_of('.')) + ".png";
+
+  const string basePath = textureFullPath.substr(0, textureFullPath.find_last_of('.'));
+  for (const auto& extension : extensions) {
+    const string variantFullPath = basePath + extension;
+    if (FileUtils::getInstance()->isFileExist(variantFullPath)) {
+      return variantFullPath;
+    }
+  }
+  return textureFullPath;
+}
+
+// A spritesheet whose plist has been parsed and texture has been decoded
+// by a worker thread, waiting for its texture to be uploaded by the main thread.
+struct DecodedSpritesheet final {
+  string plistFullPath;
+  SpritesheetIndex index;
+  string textureFullPath;
+  RefPtr<Image> image;
+  RefPtr<Image> alphaImage;  // ETC1 only
+  FrameIndices frameIndices;
+  bool hasAnimationFramesOnly;
+};
+
+// Runs on a worker thread. Only absolute paths are passed to FileUtils here,
+// since its full path cache is not thread-safe.
+void decodeSpritesheet(DecodedSpritesheet& spritesheet, const vector<string>& textureExtensions,
+                       const string& spritesheetIndexDir) {
+  LoadProfiler::ScopedTimer timer(LoadProfiler::Section::SPRITESHEETS);
+
+  FileUtils* fileUtils = FileUtils::getInstance();
+  readSpritesheetIndex(spritesheet.plistFullPath, spritesheetIndexDir, spritesheet.index);
+  spritesheet.hasAnimationFramesOnly = addToFrameIndices(spritesheet.index, spritesheet.frameIndices);
+  spritesheet.textureFullPath = getTextureFullPath(spritesheet.plistFullPath,
+                                                   spritesheet.index.textureFileName,
+                                                   textureExtensions);
+
+  RefPtr<Image> image = new Image();
+  image->release();  // RefPtr took a reference already.
+  if (!image->initWithImageFileThreadSafe(spritesheet.textureFullPath)) {
+    return;
+  }
+  spritesheet.image = image;
+
+  // ETC1 has no alpha channel, so the alpha is stored in another ETC1 texture,
+  // the same way as TextureCache::addImage() expects it.
+  const string alphaFullPath = spritesheet.textureFullPath + TextureCache::getETC1AlphaFileSuffix();
+  if (image->getFileType() == Image::Format::ETC && fileUtils->isFileExist(alphaFullPath)) {
+    RefPtr<Image> alphaImage = new Image();
+    alphaImage->release();
+    if (alphaImage->initWithImageFileThreadSafe(alphaFullPath)) {
+      spritesheet.alphaImage = alphaImage;
+    }
+  }
+}
+
+// See scripts/DatabasePacker.py for the format of the database pack.
+struct PackEntry final {
+  uint32_t nameOffset;  // relative to the string table
+  uint32_t nameLength;
+  uint32_t dataOffset;  // relative to the beginning of the pack
+  uint32_t dataLength;
+};
+
+static_assert(sizeof(PackEntry) == 4 * sizeof(uint32_t), "PackEntry must not be padded");
+
+unique_ptr<MappedFile> databasePack;
+const PackEntry* packEntries;  // sorted by name, points into the mapping
+uint32_t numPackEntries;
+const char* packStringTable;
+
+// Verifies the header and the index of a database (or content) pack,
+// so that the lookups don't have to check the offsets again.
+bool isPackValid(const MappedFile& file, uint32_t expectedMagic, uint32_t expectedVersion) {
+  BinaryReader reader(file.getData(), file.getData() + file.getSize());
+  const uint32_t magic = reader.read<uint32_t>();
+  const uint32_t version = reader.read<uint32_t>();
+  const uint64_t numEntries = reader.read<uint32_t>();
+  const uint64_t stringTableSize = reader.read<uint32_t>();
+  if (!reader.isOk() || magic != expectedMagic || version != expectedVersion) {
+    return false;
+  }
+
+  const uint64_t indexOffset = 4 * sizeof(uint32_t);
+  const uint64_t stringTableOffset = indexOffset + numEntries * sizeof(PackEntry);
+  if (stringTableOffset + stringTableSize > file.getSize()) {
+    return false;
+  }
+
+  const PackEntry* entries = reinterpret_cast<const PackEntry*>(file.getData() + indexOffset);
+  for (uint64_t i = 0; i < numEntries; i++) {
+    const PackEntry& entry = entries[i];
+    if (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > stringTableSize ||
+        static_cast<uint64_t>(entry.dataOffset) + entry.dataLength > file.getSize()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compares the name of `entry` with `name` byte by byte,
+// in the same order as the entries are sorted by DatabasePacker.py.
+bool isPackEntryNameLess(const PackEntry& entry, const string& name) {
+  const int result = std::memcmp(packStringTable + entry.nameOffset, name.data(),
+                                 std::min<size_t>(entry.nameLength, name.size()));
+  return result < 0 || (result == 0 && entry.nameLength < name.size());
+}
+
+// The entries of a content pack are extracted under a directory of the
+// writable path, so their names must not be able to escape it.
+bool isSafeRelativePath(const string& path) {
+  if (path.empty() || path.front() == '/' || path.find('\\') != string::npos) {
+    return false;
+  }
+
+  size_t begin = 0;
+  while (begin <= path.size()) {
+    const size_t end = std::min(path.find('/', begin), path.size());
+    const string component = path.substr(begin, end - begin);
+    if (component.empty() || component == "." || component == "..") {
+      return false;
+    }
+    begin = end + 1;
+  }
+  return true;
+}
+
+// Same as `mkdir -p`, but safe to be called on any thread
+// (unlike FileUtils::createDirectory()).
+bool createDirectories(const string& path) {
+  for (size_t pos = path.find('/', 1); pos != string::npos; pos = path.find('/', pos + 1)) {
+    const string dir = path.substr(0, pos);
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+  }
+  return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+uint32_t computeCrc32(const char* data, size_t size) {
+  // zlib's crc32() takes a uInt length, so a large pack is fed in chunks.
+  uLong crc = ::crc32(0L, Z_NULL, 0);
+  for (size_t offset = 0; offset < size; offset += CRC32_CHUNK_SIZE) {
+    const size_t chunkSize = std::min<size_t>(CRC32_CHUNK_SIZE, size - offset);
+    crc = ::crc32(crc, reinterpret_cast<const Bytef*>(data + offset), static_cast<uInt>(chunkSize));
+  }
+  return static_cast<uint32_t>(crc);
+}
+
+}  // namespace
+
 void loadSpritesheets(const string& spritesheetsListFileName) {
   char buf[256] = {0};
   getcwd(buf, 256);
@@ -33,12 +547,288 @@ void loadSpritesheets(const string& spritesheetsListFileName) {
 
   VGLOG(LOG_INFO, "Loading textures...");
   SpriteFrameCache* frameCache = SpriteFrameCache::getInstance();
+  TextureCache* textureCache = Director::getInstance()->getTextureCache();
+  const vector<string> textureExtensions = getSupportedTextureExtensions();
+  const string spritesheetIndexDir = getSpritesheetIndexDir();
+  FrameIndices frameIndices;
   string line;
   while (std::getline(fin, line)) {
     if (!line.empty()) {
-      frameCache->addSpriteFramesWithFile(line);
+      LoadProfiler::ScopedTimer timer(LoadProfiler::Section::SPRITESHEETS);
+      const string plistFullPath = FileUtils::getInstance()->fullPathForFilename(line);
+      SpritesheetIndex index;
+      readSpritesheetIndex(plistFullPath, spritesheetIndexDir, index);
+      const string textureFullPath = getTextureFullPath(plistFullPath, index.textureFileName,
+                                                        textureExtensions);
+      Texture2D* texture = textureCache->addImage(textureFullPath);
+      if (texture) {
+        texture->setAliasTexParameters();
+        addSpriteFrames(plistFullPath, index, texture);
+      } else {
+        frameCache->addSpriteFramesWithFile(plistFullPath);
+      }
+
+      FrameIndices spritesheetFrameIndices;
+      const bool hasAnimationFramesOnly = addToFrameIndices(index, spritesheetFrameIndices);
+      addToTextureResidency(plistFullPath, textureFullPath, spritesheetFrameIndices,
+                            hasAnimationFramesOnly && texture != nullptr);
+      mergeFrameIndices(spritesheetFrameIndices, frameIndices);
+    }
+  }
+  buildAnimationManifest(frameIndices);
+  VGLOG(LOG_INFO, "Animation manifest: %zu animations", animationManifest.size());
+}
+
+void loadSpritesheetsAsync(const string& spritesheetsListFileName, AssetLoader& loader) {
+  ifstream fin(spritesheetsListFileName);
+  if (!fin.is_open()) {
+    throw runtime_error("Failed to load spritesheets from " + spritesheetsListFileName);
+  }
+
+  vector<shared_ptr<DecodedSpritesheet>> spritesheets;
+  string line;
+  while (std::getline(fin, line)) {
+    if (!line.empty()) {
+      spritesheets.push_back(make_shared<DecodedSpritesheet>());
+      spritesheets.back()->plistFullPath = FileUtils::getInstance()->fullPathForFilename(line);
     }
   }
+
+  VGLOG(LOG_INFO, "Loading textures (%zu spritesheets)...", spritesheets.size());
+  if (spritesheets.empty()) {
+    buildAnimationManifest({});
+    return;
+  }
+
+  // Only accessed by the commit functions, i.e., on the main thread.
+  auto frameIndices = make_shared<FrameIndices>();
+  auto numRemainingSpritesheets = make_shared<size_t>(spritesheets.size());
+
+  // Read-only once the tasks have been added.
+  auto textureExtensions = make_shared<const vector<string>>(getSupportedTextureExtensions());
+  auto spritesheetIndexDir = make_shared<const string>(getSpritesheetIndexDir());
+
+  for (const auto& spritesheet : spritesheets) {
+    loader.addTask([spritesheet, textureExtensions, spritesheetIndexDir]() {
+      decodeSpritesheet(*spritesheet, *textureExtensions, *spritesheetIndexDir);
+    }, [spritesheet, frameIndices, numRemainingSpritesheets]() {
+      SpriteFrameCache* frameCache = SpriteFrameCache::getInstance();
+      Texture2D* texture = nullptr;
+      if (spritesheet->image) {
+        texture = Director::getInstance()->getTextureCache()->addImage(
+            spritesheet->image.get(), spritesheet->textureFullPath);
+      }
+      if (texture && spritesheet->alphaImage) {
+        Texture2D* alphaTexture = new Texture2D();
+        if (alphaTexture->initWithImage(spritesheet->alphaImage.get())) {
+          texture->setAlphaTexture(alphaTexture);
+        }
+        alphaTexture->release();
+      }
+
+      if (texture) {
+        // Pixel art, which must not be interpolated.
+        texture->setAliasTexParameters();
+        addSpriteFrames(spritesheet->plistFullPath, spritesheet->index, texture);
+      } else {
+        VGLOG(LOG_WARN, "Failed to decode [%s], loading it synchronously.",
+              spritesheet->textureFullPath.c_str());
+        frameCache->addSpriteFramesWithFile(spritesheet->plistFullPath);
+      }
+      addToTextureResidency(spritesheet->plistFullPath, spritesheet->textureFullPath,
+                            spritesheet->frameIndices,
+                            spritesheet->hasAnimationFramesOnly && texture != nullptr);
+      mergeFrameIndices(spritesheet->frameIndices, *frameIndices);
+      spritesheet->image = nullptr;
+      spritesheet->alphaImage = nullptr;
+      spritesheet->index = SpritesheetIndex{};
+
+      if (--(*numRemainingSpritesheets) == 0) {
+        buildAnimationManifest(*frameIndices);
+        VGLOG(LOG_INFO, "Animation manifest: %zu animations", animationManifest.size());
+      }
+    });
+  }
+}
+
+size_t getFrameCount(const string& prefixedFramesName) {
+  auto it = animationManifest.find(prefixedFramesName);
+  return (it != animationManifest.end()) ? it->second : 0;
+}
+
+
+bool loadDatabasePack(const string& packFileName) {
+  const string fullPath = FileUtils::getInstance()->fullPathForFilename(packFileName);
+  if (fullPath.empty()) {
+    VGLOG(LOG_INFO, "No database pack found, reading json files instead.");
+    return false;
+  }
+
+  auto file = std::make_unique<MappedFile>(fullPath);
+  if (!file->isOpen() || !isPackValid(*file, DATABASE_PACK_MAGIC, DATABASE_PACK_VERSION)) {
+    VGLOG(LOG_ERR, "Invalid database pack: %s, reading json files instead.", fullPath.c_str());
+    return false;
+  }
+
+  const char* data = file->getData();
+  std::memcpy(&numPackEntries, data + 2 * sizeof(uint32_t), sizeof(uint32_t));
+  packEntries = reinterpret_cast<const PackEntry*>(data + 4 * sizeof(uint32_t));
+  packStringTable = reinterpret_cast<const char*>(packEntries + numPackEntries);
+  databasePack = std::move(file);
+  VGLOG(LOG_INFO, "Database pack: %u json files", numPackEntries);
+  return true;
+}
+
+bool isDatabasePackLoaded() {
+  return databasePack != nullptr;
+}
+
+bool getPackedJson(const string& jsonFileName, const char** data, size_t* size) {
+  if (!databasePack) {
+    return false;
+  }
+
+  // The entries are named relative to the resources directory,
+  // e.g., "Resources/Database/a.json" -> "Database/a.json".
+  static const string kResourcesPrefix = "Resources/";
+  const string name = (jsonFileName.compare(0, kResourcesPrefix.size(), kResourcesPrefix) == 0) ?
+    jsonFileName.substr(kResourcesPrefix.size()) : jsonFileName;
+
+  const PackEntry* end = packEntries + numPackEntries;
+  const PackEntry* it = std::lower_bound(packEntries, end, name, isPackEntryNameLess);
+  if (it == end || it->nameLength != name.size() ||
+      std::memcmp(packStringTable + it->nameOffset, name.data(), name.size()) != 0) {
+    return false;
+  }
+
+  *data = databasePack->getData() + it->dataOffset;
+  *size = it->dataLength;
+  return true;
+}
+
+vector<string> listJsonFiles(const string& directory) {
+  vector<string> jsonFileNames;
+  auto isJson = [](const string& fileName) {
+    static const string kJsonExtension = ".json";
+    return fileName.size() >= kJsonExtension.size() &&
+           fileName.compare(fileName.size() - kJsonExtension.size(),
+                            kJsonExtension.size(), kJsonExtension) == 0;
+  };
+
+  if (databasePack) {
+    // The entries are sorted by name, so the ones under `directory` are contiguous.
+    const PackEntry* end = packEntries + numPackEntries;
+    const PackEntry* it = std::lower_bound(packEntries, end, directory, isPackEntryNameLess);
+    for (; it != end; it++) {
+      const string name(packStringTable + it->nameOffset, it->nameLength);
+      if (name.compare(0, directory.size(), directory) != 0) {
+        break;
+      }
+      if (isJson(name)) {
+        jsonFileNames.push_back(name);
+      }
+    }
+    return jsonFileNames;
+  }
+
+  const string fullPath = FileUtils::getInstance()->fullPathForFilename(directory);
+  if (fullPath.empty()) {
+    return jsonFileNames;
+  }
+
+  vector<string> files;
+  FileUtils::getInstance()->listFilesRecursively(fullPath, &files);
+  for (const auto& file : files) {
+    // Strip the search path, e.g., "/.../Resources/Database/item/a.json"
+    // -> "Database/item/a.json".
+    const size_t pos = file.rfind(directory);
+    if (pos != string::npos && isJson(file)) {
+      jsonFileNames.push_back(file.substr(pos));
+    }
+  }
+  std::sort(jsonFileNames.begin(), jsonFileNames.end());
+  return jsonFileNames;
+}
+
+
+bool extractContentPack(const string& packFileName, uint64_t size, uint32_t crc32,
+                        const string& dir) {
+  MappedFile file(packFileName);
+  if (!file.isOpen() || file.getSize() != size) {
+    VGLOG(LOG_ERR, "Content pack has the wrong size: %s", packFileName.c_str());
+    return false;
+  }
+  if (computeCrc32(file.getData(), file.getSize()) != crc32 ||
+      !isPackValid(file, CONTENT_PACK_MAGIC, CONTENT_PACK_VERSION)) {
+    VGLOG(LOG_ERR, "Content pack is corrupted: %s", packFileName.c_str());
+    return false;
+  }
+
+  // Any earlier extraction is invalidated first, so that if this one
+  // is interrupted, the half-written files won't be mistaken for a complete pack.
+  const string stampFileName = dir + CONTENT_PACK_STAMP_FILE_NAME;
+  std::remove(stampFileName.c_str());
+
+  const char* data = file.getData();
+  uint32_t numEntries = 0;
+  std::memcpy(&numEntries, data + 2 * sizeof(uint32_t), sizeof(uint32_t));
+  const PackEntry* entries = reinterpret_cast<const PackEntry*>(data + 4 * sizeof(uint32_t));
+  const char* stringTable = reinterpret_cast<const char*>(entries + numEntries);
+
+  for (uint32_t i = 0; i < numEntries; i++) {
+    const PackEntry& entry = entries[i];
+    const string name(stringTable + entry.nameOffset, entry.nameLength);
+    if (!isSafeRelativePath(name)) {
+      VGLOG(LOG_ERR, "Content pack has an invalid entry: %s (%s)", name.c_str(), packFileName.c_str());
+      return false;
+    }
+
+    const string fileName = dir + name;
+    if (!createDirectories(fileName.substr(0, fileName.find_last_of('/')))) {
+      VGLOG(LOG_ERR, "Unable to create the directory of: %s", fileName.c_str());
+      return false;
+    }
+    ofstream fout(fileName, std::ios::binary | std::ios::trunc);
+    fout.write(data + entry.dataOffset, entry.dataLength);
+    if (!fout) {
+      VGLOG(LOG_ERR, "Unable to write: %s", fileName.c_str());
+      return false;
+    }
+  }
+
+  ofstream fout(stampFileName, std::ios::trunc);
+  fout << crc32;
+  VGLOG(LOG_INFO, "Content pack extracted: %s (%u files)", packFileName.c_str(), numEntries);
+  return static_cast<bool>(fout);
+}
+
+bool isContentPackExtracted(const string& dir, uint32_t crc32) {
+  ifstream fin(dir + CONTENT_PACK_STAMP_FILE_NAME);
+  uint32_t stampedCrc32 = 0;
+  return static_cast<bool>(fin >> stampedCrc32) && stampedCrc32 == crc32;
+}
+
+void mountContentPack(const string& dir) {
+  // setSearchPaths() also purges the cached full paths,
+  // which may have been resolved to the files shipped inside the app.
+  FileUtils* fileUtils = FileUtils::getInstance();
+  vector<string> searchPaths = fileUtils->getSearchPaths();
+  if (std::find(searchPaths.begin(), searchPaths.end(), dir) != searchPaths.end()) {
+    return;
+  }
+  searchPaths.insert(searchPaths.begin(), dir);
+  fileUtils->setSearchPaths(searchPaths);
+}
+
+void unmountContentPack(const string& dir) {
+  FileUtils* fileUtils = FileUtils::getInstance();
+  vector<string> searchPaths = fileUtils->getSearchPaths();
+  auto it = std::find(searchPaths.begin(), searchPaths.end(), dir);
+  if (it == searchPaths.end()) {
+    return;
+  }
+  searchPaths.erase(it);
+  fileUtils->setSearchPaths(searchPaths);
 }
 
 }  // namespace asset_manager
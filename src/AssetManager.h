@@ -2,111 +2,188 @@
 #ifndef VIGILANTE_ASSET_MANAGER_H_
 #define VIGILANTE_ASSET_MANAGER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace vigilante {
 
+class AssetLoader;
+
 namespace asset_manager {
 
+// The asset paths are constexpr char arrays rather than std::strings,
+// so that the translation units including this header don't each
+// construct their own copies of them during static initialization.
+
 #ifdef __linux__
-const std::string kExpPointTable = "Resources/Gameplay/exp_point_table.txt";
-const std::string kItemPriceTable = "Resources/Gameplay/item_price_table.txt";
-const std::string kSpritesheetsList = "Resources/Texture/spritesheets.txt";
-const std::string kQuestsList = "Resources/Gameplay/quests_list.txt";
-const std::string kPlayerJson = "Resources/Database/character/vlad.json";
+constexpr char kExpPointTable[] = "Resources/Gameplay/exp_point_table.txt";
+constexpr char kItemPriceTable[] = "Resources/Gameplay/item_price_table.txt";
+constexpr char kExpPointTablePack[] = "Resources/Gameplay/exp_point_table.bin";
+constexpr char kItemPriceTablePack[] = "Resources/Gameplay/item_price_table.bin";
+constexpr char kSpritesheetsList[] = "Resources/Texture/spritesheets.txt";
+constexpr char kQuestsList[] = "Resources/Gameplay/quests_list.txt";
+constexpr char kPlayerJson[] = "Resources/Database/character/vlad.json";
+constexpr char kDatabasePack[] = "Resources/Database.pack";
+constexpr char kTextPack[] = "Resources/Text.pack";
+constexpr char kContentPacksManifest[] = "Resources/ContentPacks.json";
 #else
-const std::string kExpPointTable = "Gameplay/exp_point_table.txt";
-const std::string kItemPriceTable = "Gameplay/item_price_table.txt";
-const std::string kSpritesheetsList = "Texture/spritesheets.txt";
-const std::string kQuestsList = "Gameplay/quests_list.txt";
-const std::string kPlayerJson = "Database/character/vlad.json";
+constexpr char kExpPointTable[] = "Gameplay/exp_point_table.txt";
+constexpr char kItemPriceTable[] = "Gameplay/item_price_table.txt";
+constexpr char kExpPointTablePack[] = "Gameplay/exp_point_table.bin";
+constexpr char kItemPriceTablePack[] = "Gameplay/item_price_table.bin";
+constexpr char kSpritesheetsList[] = "Texture/spritesheets.txt";
+constexpr char kQuestsList[] = "Gameplay/quests_list.txt";
+constexpr char kPlayerJson[] = "Database/character/vlad.json";
+constexpr char kDatabasePack[] = "Database.pack";
+constexpr char kTextPack[] = "Text.pack";
+constexpr char kContentPacksManifest[] = "ContentPacks.json";
 #endif
 
 // Fonts
-const std::string kRegularFont = "Font/at01.ttf";
-const std::string kBoldFont = "Font/HeartbitXX2Px.ttf";
-const std::string kTitleFont = "Font/MatchupPro.ttf";
-const float kRegularFontSize = 16.0f;
-const float kSmallFontSize = 12.0f;
+constexpr char kRegularFont[] = "Font/at01.ttf";
+constexpr char kBoldFont[] = "Font/HeartbitXX2Px.ttf";
+constexpr char kTitleFont[] = "Font/MatchupPro.ttf";
+constexpr float kRegularFontSize = 16.0f;
+constexpr float kSmallFontSize = 12.0f;
 
 // MainMenu
-const std::string kMainMenuBg = "Texture/ui/mainmenu_bg.png";
+constexpr char kMainMenuBg[] = "Texture/ui/mainmenu_bg.png";
 
 // NewGame initial GameMap
-const std::string kNewGameInitialMap = "Map/VampireCastle/PrisonCell.tmx";
+constexpr char kNewGameInitialMap[] = "Map/VampireCastle/PrisonCell.tmx";
 
 // Shade (an overlay image used for screen fadeout/fadein effects)
-const std::string kShade = "Texture/ui/shade.png";
+constexpr char kShade[] = "Texture/ui/shade.png";
 
 // Hud
-const std::string kHud = "Texture/ui/hud/";
-const std::string kBarLeftPadding = kHud + "bar_padding_left.png";
-const std::string kBarRightPadding = kHud + "bar_padding_right.png";
-const std::string kHealthBar = kHud + "health_bar.png";
-const std::string kMagickaBar = kHud + "magicka_bar.png";
-const std::string kStaminaBar = kHud + "stamina_bar.png";
-const std::string kEquippedWeaponBg = kHud + "equipped_weapon_slot.png";
-const std::string kEquippedWeaponDescBg = kHud + "item_desc.png";
+constexpr char kHud[] = "Texture/ui/hud/";
+constexpr char kBarLeftPadding[] = "Texture/ui/hud/bar_padding_left.png";
+constexpr char kBarRightPadding[] = "Texture/ui/hud/bar_padding_right.png";
+constexpr char kHealthBar[] = "Texture/ui/hud/health_bar.png";
+constexpr char kMagickaBar[] = "Texture/ui/hud/magicka_bar.png";
+constexpr char kStaminaBar[] = "Texture/ui/hud/stamina_bar.png";
+constexpr char kEquippedWeaponBg[] = "Texture/ui/hud/equipped_weapon_slot.png";
+constexpr char kEquippedWeaponDescBg[] = "Texture/ui/hud/item_desc.png";
 
 // Dialogue
-const std::string kDialogue = "Texture/ui/dialogue/";
-const std::string kDialogueMenuBg = kDialogue + "dialogue_menu_bg.png";
-const std::string kDialogueTriangle = kDialogue + "triangle.png";
+constexpr char kDialogue[] = "Texture/ui/dialogue/";
+constexpr char kDialogueMenuBg[] = "Texture/ui/dialogue/dialogue_menu_bg.png";
+constexpr char kDialogueTriangle[] = "Texture/ui/dialogue/triangle.png";
 
 // PauseMenu
-const std::string kPauseMenu = "Texture/ui/pause_menu/";
-const std::string kPauseMenuBg = kPauseMenu + "pause.png";
+constexpr char kPauseMenu[] = "Texture/ui/pause_menu/";
+constexpr char kPauseMenuBg[] = "Texture/ui/pause_menu/pause.png";
 
 // PauseMenu - StatsPane
-const std::string kStatsBg = kPauseMenu + "stats_bg.png";
+constexpr char kStatsBg[] = "Texture/ui/pause_menu/stats_bg.png";
 
 // PauseMenu - InventoryPane
-const std::string kInventoryBg = kPauseMenu + "inventory_bg.png";
-const std::string kTabRegular = kPauseMenu + "tab_regular.png";
-const std::string kTabHighlighted = kPauseMenu + "tab_highlighted.png";
-const std::string kItemRegular = kPauseMenu + "item_regular.png";
-const std::string kItemHighlighted = kPauseMenu + "item_highlighted.png";
-const std::string kScrollBar = "Texture/ui/scroll_bar.png";
+constexpr char kInventoryBg[] = "Texture/ui/pause_menu/inventory_bg.png";
+constexpr char kTabRegular[] = "Texture/ui/pause_menu/tab_regular.png";
+constexpr char kTabHighlighted[] = "Texture/ui/pause_menu/tab_highlighted.png";
+constexpr char kItemRegular[] = "Texture/ui/pause_menu/item_regular.png";
+constexpr char kItemHighlighted[] = "Texture/ui/pause_menu/item_highlighted.png";
+constexpr char kScrollBar[] = "Texture/ui/scroll_bar.png";
 
 // PauseMenu - EquipmentPane
-const std::string kEquipmentRegular = kPauseMenu + "equipment_regular.png";
-const std::string kEquipmentHighlighted = kPauseMenu + "equipment_highlighted.png";
+constexpr char kEquipmentRegular[] = "Texture/ui/pause_menu/equipment_regular.png";
+constexpr char kEquipmentHighlighted[] = "Texture/ui/pause_menu/equipment_highlighted.png";
 
 // Item icons
-const std::string kItemIcons = "Texture/item/";
-const std::string kEmptyImage = "Texture/empty.png";
+constexpr char kItemIcons[] = "Texture/item/";
+constexpr char kEmptyImage[] = "Texture/empty.png";
 
 // Window
-const std::string kWindow = "Texture/ui/window/";
-const std::string kWindowContentBg = kWindow + "window_content_bg.png";
-const std::string kWindowTopLeftBg = kWindow + "window_top_left_bg.png";
-const std::string kWindowTopRightBg = kWindow + "window_top_right_bg.png";
-const std::string kWindowBottomLeftBg = kWindow + "window_bottom_left_bg.png";
-const std::string kWindowBottomRightBg = kWindow + "window_bottom_right_bg.png";
-const std::string kWindowTopBg = kWindow + "window_top_bg.png";
-const std::string kWindowLeftBg = kWindow + "window_left_bg.png";
-const std::string kWindowRightBg = kWindow + "window_right_bg.png";
-const std::string kWindowBottomBg = kWindow + "window_bottom_bg.png";
-
-const std::string kTextFieldBg = "Texture/ui/text_field_bg.png";
+constexpr char kWindow[] = "Texture/ui/window/";
+constexpr char kWindowContentBg[] = "Texture/ui/window/window_content_bg.png";
+constexpr char kWindowTopLeftBg[] = "Texture/ui/window/window_top_left_bg.png";
+constexpr char kWindowTopRightBg[] = "Texture/ui/window/window_top_right_bg.png";
+constexpr char kWindowBottomLeftBg[] = "Texture/ui/window/window_bottom_left_bg.png";
+constexpr char kWindowBottomRightBg[] = "Texture/ui/window/window_bottom_right_bg.png";
+constexpr char kWindowTopBg[] = "Texture/ui/window/window_top_bg.png";
+constexpr char kWindowLeftBg[] = "Texture/ui/window/window_left_bg.png";
+constexpr char kWindowRightBg[] = "Texture/ui/window/window_right_bg.png";
+constexpr char kWindowBottomBg[] = "Texture/ui/window/window_bottom_bg.png";
+
+constexpr char kTextFieldBg[] = "Texture/ui/text_field_bg.png";
 
 // Trade
-const std::string kTrade = "Texture/ui/trade/";
-const std::string kTradeBg = kTrade + "trade_bg.png";
+constexpr char kTrade[] = "Texture/ui/trade/";
+constexpr char kTradeBg[] = "Texture/ui/trade/trade_bg.png";
 
 // Control Hints
-const std::string kControlHints = "Texture/ui/control_hints/";
+constexpr char kControlHints[] = "Texture/ui/control_hints/";
 
 // Important items
-const std::string kGoldCoin = "Database/item/misc/gold_coin.json";
+constexpr char kGoldCoin[] = "Database/item/misc/gold_coin.json";
 
 // BGM
-const std::string kBgm = "Music/";
-const std::string kMainThemeBgm = kBgm + "main_theme.mp3";
+constexpr char kBgm[] = "Music/";
+constexpr char kMainThemeBgm[] = "Music/main_theme.mp3";
 
 // Spritesheets
+// Each page is loaded in the best compressed texture format the GPU supports
+// (S3TC, PVRTC or ETC1), if AtlasPacker.py has produced one for it,
+// or from its png otherwise. Each spritesheet is then handed over to
+// TextureResidency, which may release it later.
+// The frames of each plist are read from a binary index compiled on
+// the first launch (<writable path>/spritesheet_cache/), unless the
+// plist has been modified since then.
 void loadSpritesheets(const std::string& spritesheetsListFileName);
 
+// Same as loadSpritesheets(), except that the plists are parsed and the
+// textures are decoded on the worker threads of `loader`. Only the texture
+// uploads happen on the main thread (see AssetLoader::update()).
+void loadSpritesheetsAsync(const std::string& spritesheetsListFileName, AssetLoader& loader);
+
+// Animation manifest
+// The frame count of every animation in the spritesheets loaded by
+// loadSpritesheets(), keyed by the frames name with its prefix,
+// e.g., "player_attacking0" (see StaticActor::createAnimation()).
+// Returns 0 if there's no such animation.
+size_t getFrameCount(const std::string& prefixedFramesName);
+
+// Database pack
+// All of the json files under Database/ compiled into one indexed binary
+// pack by scripts/DatabasePacker.py. The pack is memory mapped, and the
+// json files are served straight from the mapping (see json_util::JsonDocument).
+// Returns false if there's no valid pack, in which case the individual
+// json files will be read instead (e.g., during development).
+bool loadDatabasePack(const std::string& packFileName);
+bool isDatabasePackLoaded();
+
+// Looks up the json data of `jsonFileName` (e.g., "Database/character/vlad.json")
+// from the database pack. The data is not null-terminated, and stays valid
+// until the process exits. Returns false if it's not in the pack.
+bool getPackedJson(const std::string& jsonFileName, const char** data, size_t* size);
+
+// Lists the json files under `directory` (e.g., "Database/item/"), from the
+// database pack if it's loaded, or from the file system otherwise.
+// The results are named like the ones passed to getPackedJson().
+std::vector<std::string> listJsonFiles(const std::string& directory);
+
+// Content packs
+// The assets of a region (its maps, tilesets, npcs, items and audio) which
+// aren't shipped inside the app, but downloaded on demand (see ContentPackManager).
+// scripts/ContentPacker.py writes them in the same layout as the database pack,
+// except that the files are stored as they are.
+//
+// Verifies the pack at `packFileName` against the size and the crc32 listed
+// in the manifest, and extracts its files into `dir` (which must end with '/').
+// The extracted files are only stamped with `crc32` after all of them have
+// been written, see isContentPackExtracted(). May be called on any thread.
+bool extractContentPack(const std::string& packFileName, uint64_t size, uint32_t crc32,
+                        const std::string& dir);
+bool isContentPackExtracted(const std::string& dir, uint32_t crc32);
+
+// Adds `dir` in front of the search paths of FileUtils, so that the files
+// extracted into it are found as if they were under Resources/.
+// Must be called on the main thread.
+void mountContentPack(const std::string& dir);
+void unmountContentPack(const std::string& dir);
+
 }  // namespace asset_manager
 
 }  // namespace vigilante
@@ -0,0 +1,192 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "AudioManager.h"
+
+#include <algorithm>
+
+#include "gameplay/CameraSystem.h"
+#include "map/GameMapSpec.h"
+#include "util/Headless.h"
+#include "util/Logger.h"
+
+#define SFX_VOLUME .8f
+#define BGM_VOLUME .6f
+#define SFX_AUDIBLE_MARGIN 4.0f  // in meters beyond the view, where a positional SFX falls silent
+#define SFX_MIN_DELAY .03  // in seconds between two instances in the same category
+#define MAP_BGM_CROSSFADE_DURATION 1.5f
+
+using std::array;
+using std::string;
+using std::unordered_set;
+using cocos2d::experimental::AudioEngine;
+using cocos2d::experimental::AudioProfile;
+
+namespace vigilante {
+
+const array<int, AudioManager::Category::SIZE> AudioManager::_kMaxVoices = {{
+  6,  // hit
+  3,  // footstep
+  4,  // spell
+  2   // ui
+}};
+
+AudioManager* AudioManager::getInstance() {
+  static AudioManager instance;
+  return &instance;
+}
+
+AudioManager::AudioManager()
+    : _profiles(),
+      _preloadedSfx(),
+      _preloadingSfx(),
+      _mapSfx(),
+      _sfxPlayedThisFrame(),
+      _currentBgm{"", AudioEngine::INVALID_AUDIO_ID, 0, 0, 0},
+      _previousBgm{"", AudioEngine::INVALID_AUDIO_ID, 0, 0, 0} {
+  for (int i = 0; i < Category::SIZE; i++) {
+    _profiles[i].name = "sfx" + std::to_string(i);
+    _profiles[i].maxInstances = _kMaxVoices[i];
+    _profiles[i].minDelay = SFX_MIN_DELAY;
+  }
+}
+
+
+void AudioManager::update(float delta) {
+  _sfxPlayedThisFrame.clear();
+
+  if (_currentBgm.audioId != AudioEngine::INVALID_AUDIO_ID) {
+    fade(_currentBgm, delta, BGM_VOLUME);
+  }
+  if (_previousBgm.audioId != AudioEngine::INVALID_AUDIO_ID) {
+    fade(_previousBgm, delta, 0);
+    if (_previousBgm.fadeTime >= _previousBgm.fadeDuration) {
+      AudioEngine::stop(_previousBgm.audioId);
+      _previousBgm.audioId = AudioEngine::INVALID_AUDIO_ID;
+    }
+  }
+}
+
+void AudioManager::preload(const string& fileName) {
+  if (fileName.empty() || headless::isEnabled() ||
+      _preloadedSfx.find(fileName) != _preloadedSfx.end() ||
+      _preloadingSfx.find(fileName) != _preloadingSfx.end()) {
+    return;
+  }
+
+  _preloadingSfx.insert(fileName);
+  AudioEngine::preload(fileName, [this, fileName](bool isSuccess) {
+    _preloadingSfx.erase(fileName);
+    if (!isSuccess) {
+      VGLOG(LOG_WARN, "Failed to preload sfx: %s", fileName.c_str());
+      return;
+    }
+    _preloadedSfx.insert(fileName);
+  });
+}
+
+void AudioManager::onGameMapLoaded(const GameMapSpec& spec) {
+  const unordered_set<string> mapSfx(spec.sfx.begin(), spec.sfx.end());
+  for (const auto& fileName : _mapSfx) {
+    if (mapSfx.find(fileName) == mapSfx.end() &&
+        _preloadedSfx.find(fileName) != _preloadedSfx.end()) {
+      AudioEngine::uncache(fileName);
+      _preloadedSfx.erase(fileName);
+    }
+  }
+  for (const auto& fileName : mapSfx) {
+    preload(fileName);
+  }
+  _mapSfx = std::move(mapSfx);
+
+  if (!spec.bgm.empty()) {
+    playBgm(spec.bgm, MAP_BGM_CROSSFADE_DURATION);
+  }
+}
+
+void AudioManager::playSfx(const string& fileName, AudioManager::Category category) {
+  playSfxAtVolume(fileName, category, SFX_VOLUME);
+}
+
+void AudioManager::playSfx(const string& fileName, AudioManager::Category category, const b2Vec2& pos) {
+  if (fileName.empty()) {
+    return;
+  }
+
+  // The distance (in meters) from the edge of the view.
+  const b2AABB& viewAabb = CameraSystem::getInstance()->getViewAabb();
+  const float dx = std::max({viewAabb.lowerBound.x - pos.x, pos.x - viewAabb.upperBound.x, 0.0f});
+  const float dy = std::max({viewAabb.lowerBound.y - pos.y, pos.y - viewAabb.upperBound.y, 0.0f});
+  const float distance = std::max(dx, dy);
+  if (distance >= SFX_AUDIBLE_MARGIN) {
+    return;
+  }
+
+  playSfxAtVolume(fileName, category, SFX_VOLUME * (1.0f - distance / SFX_AUDIBLE_MARGIN));
+}
+
+void AudioManager::playBgm(const string& fileName, float crossfadeDuration) {
+  if (headless::isEnabled()) {
+    return;
+  }
+  if (fileName == _currentBgm.fileName && _currentBgm.audioId != AudioEngine::INVALID_AUDIO_ID) {
+    return;
+  }
+
+  stopBgm(crossfadeDuration);
+
+  // AudioEngine streams the long files instead of decoding them in whole.
+  const float initialVolume = (crossfadeDuration > 0) ? 0 : BGM_VOLUME;
+  _currentBgm.fileName = fileName;
+  _currentBgm.audioId = AudioEngine::play2d(fileName, /*loop=*/true, initialVolume);
+  _currentBgm.volume = initialVolume;
+  _currentBgm.fadeTime = 0;
+  _currentBgm.fadeDuration = crossfadeDuration;
+}
+
+void AudioManager::stopBgm(float fadeDuration) {
+  if (_currentBgm.audioId == AudioEngine::INVALID_AUDIO_ID) {
+    return;
+  }
+
+  // Only two BGMs are mixed at the same time.
+  if (_previousBgm.audioId != AudioEngine::INVALID_AUDIO_ID) {
+    AudioEngine::stop(_previousBgm.audioId);
+  }
+
+  _previousBgm = _currentBgm;
+  _previousBgm.volume = AudioEngine::getVolume(_currentBgm.audioId);
+  _previousBgm.fadeTime = 0;
+  _previousBgm.fadeDuration = fadeDuration;
+  _currentBgm.fileName.clear();
+  _currentBgm.audioId = AudioEngine::INVALID_AUDIO_ID;
+
+  if (fadeDuration <= 0) {
+    AudioEngine::stop(_previousBgm.audioId);
+    _previousBgm.audioId = AudioEngine::INVALID_AUDIO_ID;
+  }
+}
+
+
+void AudioManager::playSfxAtVolume(const string& fileName, AudioManager::Category category, float volume) {
+  if (_preloadedSfx.find(fileName) == _preloadedSfx.end()) {
+    preload(fileName);
+    return;
+  }
+  if (!_sfxPlayedThisFrame.insert(fileName).second) {
+    return;
+  }
+
+  // If the pool of this category is full, AudioEngine rejects it at once.
+  AudioEngine::play2d(fileName, /*loop=*/false, volume, &_profiles[category]);
+}
+
+void AudioManager::fade(AudioManager::Bgm& bgm, float delta, float targetVolume) {
+  if (bgm.fadeTime >= bgm.fadeDuration) {
+    return;
+  }
+
+  bgm.fadeTime = std::min(bgm.fadeTime + delta, bgm.fadeDuration);
+  const float progress = bgm.fadeTime / bgm.fadeDuration;
+  AudioEngine::setVolume(bgm.audioId, bgm.volume + (targetVolume - bgm.volume) * progress);
+}
+
+}  // namespace vigilante
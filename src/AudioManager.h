@@ -0,0 +1,90 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_AUDIO_MANAGER_H_
+#define VIGILANTE_AUDIO_MANAGER_H_
+
+#include <array>
+#include <string>
+#include <unordered_set>
+
+#include <AudioEngine.h>
+#include <Box2D/Box2D.h>
+
+namespace vigilante {
+
+class GameMapSpec;
+
+// Plays the sound effects and the background music with cocos2d's AudioEngine.
+//
+// SFX are never decoded when they're played. Each of them has to be preloaded
+// first (e.g., the sounds of the characters once they're constructed, and the
+// "sfx" list of each map, see onGameMapLoaded()), and playing an SFX which
+// hasn't finished preloading is a no-op.
+//
+// Each category of SFX has its own limited pool of voices (an AudioProfile),
+// so a big fight can't flood the mixer. On top of that, the same SFX is
+// played at most once per frame, and the positional SFX which are too far
+// away from the camera to be heard are culled before they reach AudioEngine.
+//
+// The BGM ("bgm" map property) is streamed from disk by AudioEngine, and
+// crossfaded whenever it changes on a GameMap transition.
+//
+// All methods must be called on the main thread.
+class AudioManager final {
+ public:
+  enum Category {
+    HIT,
+    FOOTSTEP,
+    SPELL,
+    UI,
+    SIZE
+  };
+
+  static AudioManager* getInstance();
+
+  // Advances the BGM crossfade.
+  void update(float delta);
+
+  // Starts decoding `fileName` in the background, unless it has
+  // been preloaded or is being preloaded. Does nothing if `fileName` is empty.
+  void preload(const std::string& fileName);
+
+  // Preloads the SFX listed by the new map (and releases those listed by
+  // the previous one only), and crossfades to the new map's BGM if there's one.
+  void onGameMapLoaded(const GameMapSpec& spec);
+
+  void playSfx(const std::string& fileName, AudioManager::Category category);
+  // `pos` is in meters. The volume falls off with the distance from the camera.
+  void playSfx(const std::string& fileName, AudioManager::Category category, const b2Vec2& pos);
+
+  void playBgm(const std::string& fileName, float crossfadeDuration);
+  void stopBgm(float fadeDuration);
+
+ private:
+  struct Bgm final {
+    std::string fileName;
+    int audioId;
+    float volume;  // at the beginning of the fade
+    float fadeTime;
+    float fadeDuration;
+  };
+
+  AudioManager();
+
+  void playSfxAtVolume(const std::string& fileName, AudioManager::Category category, float volume);
+  static void fade(AudioManager::Bgm& bgm, float delta, float targetVolume);
+
+  static const std::array<int, AudioManager::Category::SIZE> _kMaxVoices;
+
+  std::array<cocos2d::experimental::AudioProfile, AudioManager::Category::SIZE> _profiles;
+  std::unordered_set<std::string> _preloadedSfx;
+  std::unordered_set<std::string> _preloadingSfx;
+  std::unordered_set<std::string> _mapSfx;  // the "sfx" list of the current map
+  std::unordered_set<std::string> _sfxPlayedThisFrame;
+
+  AudioManager::Bgm _currentBgm;  // fading in (or playing)
+  AudioManager::Bgm _previousBgm;  // fading out
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_AUDIO_MANAGER_H_
@@ -1,43 +1,111 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "CallbackManager.h"
 
-#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
 
-using std::atomic;
-using std::function;
-using cocos2d::Scene;
-using cocos2d::DelayTime;
-using cocos2d::CallFunc;
-using cocos2d::Sequence;
+#include "util/TraceProfiler.h"
 
 namespace vigilante {
 
+const int CallbackManager::_kNumLevels = 4;
+const int CallbackManager::_kSlotBits = 6;
+const uint32_t CallbackManager::_kNumSlots = 1 << CallbackManager::_kSlotBits;
+const uint32_t CallbackManager::_kNil = std::numeric_limits<uint32_t>::max();
+const float CallbackManager::_kTickInterval = 1.0f / 60.0f;
+
 CallbackManager* CallbackManager::getInstance() {
   static CallbackManager instance;
   return &instance;
 }
 
 CallbackManager::CallbackManager()
-    : _scene(),
-      _pendingCount(0) {}
+    : _slots(_kNumLevels * _kNumSlots, _kNil),
+      _timers(),
+      _freeTimers(),
+      _ownedTimers(),
+      _currentTick(),
+      _timeAccumulator(),
+      _pendingCount() {}
+
 
+void CallbackManager::update(float delta) {
+  _timeAccumulator += delta;
 
-void CallbackManager::runAfter(const function<void ()>& userCallback, float delay) {
+  while (_timeAccumulator >= _kTickInterval) {
+    _timeAccumulator -= _kTickInterval;
+    tick();
+  }
+}
+
+CallbackManager::Handle CallbackManager::runAfter(CallbackManager::Callback userCallback,
+                                                  float delay,
+                                                  const void* owner) {
   // If the specified delay is 0 second, then we can
   // simply invoke `userCallback` and return early.
-  if (delay == 0) {
+  if (delay <= 0) {
     userCallback();
+    return {_kNil, 0};
+  }
+
+  ++_pendingCount;
+
+  uint32_t timerIndex;
+  if (!_freeTimers.empty()) {
+    timerIndex = _freeTimers.back();
+    _freeTimers.pop_back();
+  } else {
+    timerIndex = static_cast<uint32_t>(_timers.size());
+    _timers.push_back({nullptr, 0, nullptr, 0, false, _kNil, _kNil, _kNil, _kNil, _kNil});
+  }
+
+  // The callback runs on the first tick at or after `delay` seconds.
+  const uint64_t numTicks = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(delay / _kTickInterval - 1e-3f)));
+
+  Timer& timer = _timers[timerIndex];
+  timer.callback = std::move(userCallback);
+  timer.expiryTick = _currentTick + numTicks;
+  timer.owner = owner;
+  timer.isScheduled = true;
+  link(timerIndex);
+
+  if (owner) {
+    auto it = _ownedTimers.find(owner);
+    timer.ownerPrev = _kNil;
+    timer.ownerNext = (it != _ownedTimers.end()) ? it->second : _kNil;
+    if (timer.ownerNext != _kNil) {
+      _timers[timer.ownerNext].ownerPrev = timerIndex;
+    }
+    _ownedTimers[owner] = timerIndex;
+  }
+
+  return {timerIndex, timer.generation};
+}
+
+bool CallbackManager::cancel(const CallbackManager::Handle& handle) {
+  if (handle.index >= _timers.size() ||
+      _timers[handle.index].generation != handle.generation ||
+      !_timers[handle.index].isScheduled) {
+    return false;
+  }
+
+  cancelTimer(handle.index);
+  return true;
+}
+
+void CallbackManager::cancelAll(const void* owner) {
+  if (!owner) {
     return;
   }
 
-  _scene->runAction(Sequence::create(
-      CallFunc::create([=]() { ++(this->_pendingCount); }),
-      DelayTime::create(delay),
-      CallFunc::create(userCallback),
-      CallFunc::create([=]() { --(this->_pendingCount); }),
-      nullptr
-    )
-  );
+  auto it = _ownedTimers.find(owner);
+  while (it != _ownedTimers.end()) {
+    cancelTimer(it->second);
+    it = _ownedTimers.find(owner);
+  }
 }
 
 
@@ -45,8 +113,125 @@ int CallbackManager::getPendingCount() const {
   return _pendingCount;
 }
 
-void CallbackManager::setScene(Scene* scene) {
-  _scene = scene;
+
+void CallbackManager::tick() {
+  ++_currentTick;
+
+  // Every time a lower level wraps around, the timers in the next slot
+  // of the upper level are redistributed into the lower levels.
+  for (int level = 1; level < _kNumLevels; level++) {
+    const uint64_t mask = (static_cast<uint64_t>(1) << (_kSlotBits * level)) - 1;
+    if (_currentTick & mask) {
+      break;
+    }
+    cascade(level);
+  }
+
+  // All the timers in the current slot of level 0 expire in this tick.
+  // A callback may schedule or cancel other callbacks, so the slot is
+  // re-read after each of them.
+  const uint32_t slot = _currentTick & (_kNumSlots - 1);
+  uint32_t timerIndex;
+  while ((timerIndex = _slots[slot]) != _kNil) {
+    unlink(timerIndex);
+    unlinkOwner(timerIndex);
+    Callback callback = std::move(_timers[timerIndex].callback);
+    freeTimer(timerIndex);
+
+    {
+      VGTRACE_ZONE("CallbackManager::callback");
+      callback();
+    }
+    --_pendingCount;
+  }
+}
+
+void CallbackManager::cascade(int level) {
+  const uint32_t slot = level * _kNumSlots +
+                        ((_currentTick >> (_kSlotBits * level)) & (_kNumSlots - 1));
+  uint32_t timerIndex = _slots[slot];
+  _slots[slot] = _kNil;
+
+  while (timerIndex != _kNil) {
+    const uint32_t next = _timers[timerIndex].next;
+    link(timerIndex);
+    timerIndex = next;
+  }
+}
+
+void CallbackManager::link(uint32_t timerIndex) {
+  Timer& timer = _timers[timerIndex];
+
+  // Timers beyond the range of the top level are clamped to it.
+  const uint64_t maxTicks = (static_cast<uint64_t>(1) << (_kSlotBits * _kNumLevels)) - 1;
+  timer.expiryTick = std::min(timer.expiryTick, _currentTick + maxTicks);
+
+  const uint64_t ticksLeft = timer.expiryTick - _currentTick;
+  int level = 0;
+  while (level < _kNumLevels - 1 &&
+         ticksLeft >= (static_cast<uint64_t>(1) << (_kSlotBits * (level + 1)))) {
+    level++;
+  }
+
+  timer.slot = level * _kNumSlots +
+               ((timer.expiryTick >> (_kSlotBits * level)) & (_kNumSlots - 1));
+  timer.prev = _kNil;
+  timer.next = _slots[timer.slot];
+  if (timer.next != _kNil) {
+    _timers[timer.next].prev = timerIndex;
+  }
+  _slots[timer.slot] = timerIndex;
+}
+
+void CallbackManager::unlink(uint32_t timerIndex) {
+  Timer& timer = _timers[timerIndex];
+
+  if (timer.prev != _kNil) {
+    _timers[timer.prev].next = timer.next;
+  } else {
+    _slots[timer.slot] = timer.next;
+  }
+  if (timer.next != _kNil) {
+    _timers[timer.next].prev = timer.prev;
+  }
+  timer.prev = _kNil;
+  timer.next = _kNil;
+}
+
+void CallbackManager::unlinkOwner(uint32_t timerIndex) {
+  Timer& timer = _timers[timerIndex];
+  if (!timer.owner) {
+    return;
+  }
+
+  if (timer.ownerPrev != _kNil) {
+    _timers[timer.ownerPrev].ownerNext = timer.ownerNext;
+  } else if (timer.ownerNext != _kNil) {
+    _ownedTimers[timer.owner] = timer.ownerNext;
+  } else {
+    _ownedTimers.erase(timer.owner);
+  }
+  if (timer.ownerNext != _kNil) {
+    _timers[timer.ownerNext].ownerPrev = timer.ownerPrev;
+  }
+  timer.ownerPrev = _kNil;
+  timer.ownerNext = _kNil;
+}
+
+void CallbackManager::cancelTimer(uint32_t timerIndex) {
+  unlink(timerIndex);
+  unlinkOwner(timerIndex);
+  freeTimer(timerIndex);
+  --_pendingCount;
+}
+
+void CallbackManager::freeTimer(uint32_t timerIndex) {
+  Timer& timer = _timers[timerIndex];
+  timer.callback = nullptr;
+  timer.owner = nullptr;
+  timer.isScheduled = false;
+  timer.generation++;
+  _freeTimers.push_back(timerIndex);
 }
 
 }  // namespace vigilante
@@ -2,28 +2,88 @@
 #ifndef VIGILANTE_CALLBACK_MANAGER_H_
 #define VIGILANTE_CALLBACK_MANAGER_H_
 
-#include <atomic>
-#include <functional>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 
-#include <cocos2d.h>
+#include "util/SmallFunction.h"
 
 namespace vigilante {
 
+// Delayed callbacks are kept in a hierarchical timer wheel, which is
+// ticked by GameScene::update() (i.e., the time stops while the game
+// is paused). Both scheduling and cancelling a callback are O(1).
+//
+// All methods must be called on the main thread.
 class CallbackManager {
  public:
+  // The callbacks capturing up to a few pointers are stored
+  // in the timers themselves, without any heap allocation.
+  using Callback = SmallFunction<void ()>;
+
+  struct Handle final {
+    uint32_t index;
+    uint32_t generation;
+  };
+
   static CallbackManager* getInstance();
   virtual ~CallbackManager() = default;
 
-  void runAfter(const std::function<void ()>& userCallback, float delay);
+  void update(float delta);
+
+  // If `owner` is specified, the callback can be cancelled with
+  // cancelAll(owner), e.g., when the owner is being destroyed.
+  CallbackManager::Handle runAfter(CallbackManager::Callback userCallback,
+                                   float delay,
+                                   const void* owner=nullptr);
+
+  // Returns false if the callback has already been run or cancelled.
+  bool cancel(const CallbackManager::Handle& handle);
+  void cancelAll(const void* owner);
 
   int getPendingCount() const;
-  void setScene(cocos2d::Scene* scene);
 
  private:
+  struct Timer final {
+    CallbackManager::Callback callback;
+    uint64_t expiryTick;
+    const void* owner;
+    uint32_t generation;
+    bool isScheduled;
+    uint32_t slot;  // index into _slots
+
+    // Intrusive doubly linked lists of the timers in the same slot,
+    // and of the timers with the same owner.
+    uint32_t prev;
+    uint32_t next;
+    uint32_t ownerPrev;
+    uint32_t ownerNext;
+  };
+
   CallbackManager();
 
-  cocos2d::Scene* _scene;
-  std::atomic<int> _pendingCount;  // # of callbacks pending to run
+  void tick();
+  void cascade(int level);
+  void link(uint32_t timerIndex);
+  void unlink(uint32_t timerIndex);
+  void unlinkOwner(uint32_t timerIndex);
+  void cancelTimer(uint32_t timerIndex);
+  void freeTimer(uint32_t timerIndex);
+
+  static const int _kNumLevels;
+  static const int _kSlotBits;
+  static const uint32_t _kNumSlots;
+  static const uint32_t _kNil;
+  static const float _kTickInterval;
+
+  // _slots[level * _kNumSlots + slot] is the index of the first timer in that slot.
+  std::vector<uint32_t> _slots;
+  std::vector<CallbackManager::Timer> _timers;
+  std::vector<uint32_t> _freeTimers;
+  std::unordered_map<const void*, uint32_t> _ownedTimers;  // <owner, first timer>
+  uint64_t _currentTick;
+  float _timeAccumulator;
+  int _pendingCount;  // # of callbacks pending to run
 };
 
 }  // namespace vigilante
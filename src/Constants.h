@@ -5,8 +5,11 @@
 namespace vigilante {
 
 const float kFps = 60.0f;
+const float kFixedTimeStep = 1 / kFps;
+const int kMaxPhysicsSubsteps = 5;
 const int kVelocityIterations = 6;
 const int kPositionIterations = 2;
+const float kDeferredTaskTimeBudget = .001f;  // per frame, see DeferredTaskScheduler
 
 const float kPpm = 100;
 const int kVirtualWidth = 600;
@@ -41,6 +44,59 @@ const short kDestroyed = 16384;
 }  // namespace category_bits
 
 
+namespace collision_filters {
+
+struct Filter final {
+  short categoryBits;
+  short maskBits;
+};
+
+enum Role {
+  PLAYER,
+  ALLY,
+  ENEMY,
+  ROLE_SIZE
+};
+
+// The collision matrix of characters, indexed by
+// [Role][Character::FixtureType] (BODY, FEET, WEAPON).
+constexpr Filter kCharacterFilters[Role::ROLE_SIZE][3] = {
+  {  // PLAYER
+    {category_bits::kPlayer,
+     category_bits::kFeet | category_bits::kEnemy | category_bits::kMeleeWeapon |
+     category_bits::kProjectile},
+    {category_bits::kFeet,
+     category_bits::kGround | category_bits::kPlatform | category_bits::kWall |
+     category_bits::kNpc | category_bits::kPortal | category_bits::kInteractable},
+    {category_bits::kMeleeWeapon,
+     category_bits::kEnemy}
+  },
+  {  // ALLY
+    {category_bits::kNpc,
+     category_bits::kFeet | category_bits::kEnemy | category_bits::kMeleeWeapon |
+     category_bits::kPivotMarker | category_bits::kCliffMarker | category_bits::kProjectile},
+    {category_bits::kFeet,
+     category_bits::kGround | category_bits::kPlatform | category_bits::kWall |
+     category_bits::kPortal | category_bits::kInteractable},
+    {category_bits::kMeleeWeapon,
+     category_bits::kEnemy}
+  },
+  {  // ENEMY
+    {category_bits::kEnemy,
+     category_bits::kFeet | category_bits::kPlayer | category_bits::kNpc |
+     category_bits::kMeleeWeapon | category_bits::kPivotMarker | category_bits::kCliffMarker |
+     category_bits::kProjectile},
+    {category_bits::kFeet,
+     category_bits::kGround | category_bits::kPlatform | category_bits::kWall |
+     category_bits::kInteractable},
+    {category_bits::kMeleeWeapon,
+     category_bits::kPlayer | category_bits::kNpc}
+  }
+};
+
+}  // namespace collision_filters
+
+
 namespace graphical_layers {
 
 const int kTmxTiledMap = 0;
@@ -55,6 +111,8 @@ const int kEquipment = 37;
 
 const int kDefault = 50;
 
+const int kLightMap = 65;
+
 const int kFx = 70;
 const int kFloatingDamage = 80;
 const int kNotification = 82;
@@ -67,6 +125,7 @@ const int kShade = 96;
 const int kPauseMenu = 98;
 const int kControlHints = 99;
 const int kConsole = 100;
+const int kProfiler = 101;
 
 }  // namespace graphical_layers
 
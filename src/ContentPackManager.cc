@@ -0,0 +1,264 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ContentPackManager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#include <cocos2d.h>
+#include <json/document.h>
+#include "AssetManager.h"
+#include "std/make_unique.h"
+#include "util/JsonUtil.h"
+#include "util/Logger.h"
+#include "util/ThreadPool.h"
+
+#define CONTENT_PACKS_DIR "content_packs/"
+#define MAP_DIR_PREFIX "Map/"
+
+using std::function;
+using std::string;
+using std::vector;
+using cocos2d::FileUtils;
+using cocos2d::network::DownloadTask;
+using cocos2d::network::Downloader;
+using rapidjson::Document;
+
+namespace vigilante {
+
+const uint64_t ContentPackManager::_kDiskBudget = 256 * 1024 * 1024;  // 256 MiB
+
+ContentPackManager* ContentPackManager::getInstance() {
+  static ContentPackManager instance;
+  return &instance;
+}
+
+ContentPackManager::ContentPackManager()
+    : _baseUrl(),
+      _packsDir(),
+      _packs(),
+      _neighbors(),
+      _residentRegions(),
+      _downloader(),
+      _residencyClock() {}
+
+void ContentPackManager::init(const string& manifestFileName) {
+  if (FileUtils::getInstance()->fullPathForFilename(manifestFileName).empty()) {
+    VGLOG(LOG_INFO, "No content pack manifest found, all regions are shipped inside the app.");
+    return;
+  }
+
+  json_util::JsonDocument jsonDocument(manifestFileName);
+  Document& json = jsonDocument.get();
+  if (!json.IsObject() || !json.HasMember("baseUrl") || !json.HasMember("packs")) {
+    VGLOG(LOG_ERR, "Invalid content pack manifest: %s", manifestFileName.c_str());
+    return;
+  }
+
+  _baseUrl = json["baseUrl"].GetString();
+  _packsDir = FileUtils::getInstance()->getWritablePath() + CONTENT_PACKS_DIR;
+  FileUtils::getInstance()->createDirectory(_packsDir);
+
+  for (const auto& packJson : json["packs"].GetArray()) {
+    Pack pack{packJson["region"].GetString(), packJson["fileName"].GetString(),
+              packJson["size"].GetUint64(), packJson["crc32"].GetUint(),
+              State::NOT_DOWNLOADED, 0, {}};
+
+    // A download which was interrupted by the previous session is started over.
+    std::remove((_packsDir + pack.fileName).c_str());
+    if (asset_manager::isContentPackExtracted(getDir(pack), pack.crc32)) {
+      pack.state = State::EXTRACTED;
+    }
+
+    for (const auto& neighbor : packJson["neighbors"].GetArray()) {
+      _neighbors[pack.region].push_back(neighbor.GetString());
+      _neighbors[neighbor.GetString()].push_back(pack.region);
+    }
+    _packs.insert({pack.region, std::move(pack)});
+  }
+
+  _downloader = std::make_unique<Downloader>();
+  _downloader->onFileTaskSuccess = [this](const DownloadTask& task) {
+    onDownloaded(task.identifier, /*isSuccessful=*/true);
+  };
+  _downloader->onTaskError = [this](const DownloadTask& task, int errorCode, int, const string& errorStr) {
+    VGLOG(LOG_ERR, "Unable to download %s (%d): %s",
+          task.requestURL.c_str(), errorCode, errorStr.c_str());
+    onDownloaded(task.identifier, /*isSuccessful=*/false);
+  };
+  VGLOG(LOG_INFO, "Content packs: %zu regions", _packs.size());
+}
+
+bool ContentPackManager::isAvailable(const string& tmxMapFileName) const {
+  const Pack* pack = getPack(getRegion(tmxMapFileName));
+  return !pack || pack->state == State::MOUNTED;
+}
+
+void ContentPackManager::requestMap(const string& tmxMapFileName,
+                                    const function<void (bool)>& callback) {
+  Pack* pack = getPack(getRegion(tmxMapFileName));
+  if (!pack) {
+    callback(true);
+    return;
+  }
+
+  pack->callbacks.push_back(callback);
+  request(*pack);
+}
+
+void ContentPackManager::setCurrentMap(const string& tmxMapFileName) {
+  const string region = getRegion(tmxMapFileName);
+  _residentRegions = {region};
+  auto it = _neighbors.find(region);
+  if (it != _neighbors.end()) {
+    _residentRegions.insert(it->second.begin(), it->second.end());
+  }
+
+  _residencyClock++;
+  for (auto& entry : _packs) {
+    Pack& pack = entry.second;
+    if (_residentRegions.count(pack.region)) {
+      pack.lastResidentTime = _residencyClock;
+      request(pack);
+    } else if (pack.state == State::MOUNTED) {
+      asset_manager::unmountContentPack(getDir(pack));
+      pack.state = State::EXTRACTED;
+    }
+  }
+  evictExtractedPacks();
+}
+
+
+string ContentPackManager::getRegion(const string& tmxMapFileName) {
+  // The map may be named relative to the working directory, e.g., "Resources/Map/...".
+  const size_t begin = tmxMapFileName.find(MAP_DIR_PREFIX);
+  if (begin == string::npos) {
+    return "";
+  }
+  const size_t regionBegin = begin + sizeof(MAP_DIR_PREFIX) - 1;
+  const size_t regionEnd = tmxMapFileName.find('/', regionBegin);
+  return (regionEnd != string::npos) ? tmxMapFileName.substr(regionBegin, regionEnd - regionBegin) : "";
+}
+
+ContentPackManager::Pack* ContentPackManager::getPack(const string& region) {
+  auto it = _packs.find(region);
+  return (it != _packs.end()) ? &it->second : nullptr;
+}
+
+const ContentPackManager::Pack* ContentPackManager::getPack(const string& region) const {
+  auto it = _packs.find(region);
+  return (it != _packs.end()) ? &it->second : nullptr;
+}
+
+string ContentPackManager::getDir(const ContentPackManager::Pack& pack) const {
+  return _packsDir + pack.region + "/";
+}
+
+void ContentPackManager::request(ContentPackManager::Pack& pack) {
+  switch (pack.state) {
+    case State::NOT_DOWNLOADED:
+      pack.state = State::DOWNLOADING;
+      _downloader->createDownloadFileTask(_baseUrl + pack.fileName,
+                                          _packsDir + pack.fileName, pack.region);
+      VGLOG(LOG_INFO, "Downloading content pack: %s", pack.fileName.c_str());
+      break;
+    case State::EXTRACTED:
+      asset_manager::mountContentPack(getDir(pack));
+      pack.state = State::MOUNTED;
+      invokeCallbacks(pack, /*isAvailable=*/true);
+      break;
+    case State::MOUNTED:
+      invokeCallbacks(pack, /*isAvailable=*/true);
+      break;
+    default:  // The callbacks will be invoked once it's done.
+      break;
+  }
+}
+
+void ContentPackManager::onDownloaded(const string& region, bool isSuccessful) {
+  Pack* pack = getPack(region);
+  if (!pack) {
+    return;
+  }
+
+  const string packFileName = _packsDir + pack->fileName;
+  if (!isSuccessful) {
+    std::remove(packFileName.c_str());
+    pack->state = State::NOT_DOWNLOADED;
+    invokeCallbacks(*pack, /*isAvailable=*/false);
+    return;
+  }
+
+  // Hashing and extracting a pack takes a while, so it's done
+  // on a worker thread, and the downloaded pack is deleted afterwards.
+  pack->state = State::EXTRACTING;
+  auto isExtracted = std::make_shared<bool>(false);
+  const uint64_t size = pack->size;
+  const uint32_t crc32 = pack->crc32;
+  const string dir = getDir(*pack);
+  ThreadPool::getInstance()->post([packFileName, size, crc32, dir, isExtracted]() {
+    *isExtracted = asset_manager::extractContentPack(packFileName, size, crc32, dir);
+    std::remove(packFileName.c_str());
+  }, [this, region, isExtracted]() {
+    onExtracted(region, *isExtracted);
+  });
+}
+
+void ContentPackManager::onExtracted(const string& region, bool isSuccessful) {
+  Pack* pack = getPack(region);
+  if (!pack) {
+    return;
+  }
+
+  if (!isSuccessful) {
+    pack->state = State::NOT_DOWNLOADED;
+    invokeCallbacks(*pack, /*isAvailable=*/false);
+    return;
+  }
+
+  pack->state = State::EXTRACTED;
+  // It may have been left behind by the player while it was being downloaded.
+  if (_residentRegions.count(region) || !pack->callbacks.empty()) {
+    request(*pack);
+  }
+  evictExtractedPacks();
+}
+
+void ContentPackManager::invokeCallbacks(ContentPackManager::Pack& pack, bool isAvailable) {
+  // A callback may request another map (e.g., GameMapManager::loadGameMap()).
+  vector<function<void (bool)>> callbacks;
+  callbacks.swap(pack.callbacks);
+  for (const auto& callback : callbacks) {
+    callback(isAvailable);
+  }
+}
+
+void ContentPackManager::evictExtractedPacks() {
+  uint64_t diskUsage = 0;
+  for (const auto& entry : _packs) {
+    if (entry.second.state == State::EXTRACTED || entry.second.state == State::MOUNTED) {
+      diskUsage += entry.second.size;
+    }
+  }
+
+  while (diskUsage > _kDiskBudget) {
+    Pack* lruPack = nullptr;
+    for (auto& entry : _packs) {
+      Pack& pack = entry.second;
+      if (pack.state == State::EXTRACTED && !_residentRegions.count(pack.region) &&
+          (!lruPack || pack.lastResidentTime < lruPack->lastResidentTime)) {
+        lruPack = &pack;
+      }
+    }
+    if (!lruPack) {
+      return;
+    }
+
+    VGLOG(LOG_INFO, "Deleting content pack: %s", lruPack->fileName.c_str());
+    FileUtils::getInstance()->removeDirectory(getDir(*lruPack));
+    lruPack->state = State::NOT_DOWNLOADED;
+    diskUsage -= lruPack->size;
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,116 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_CONTENT_PACK_MANAGER_H_
+#define VIGILANTE_CONTENT_PACK_MANAGER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <network/CCDownloader.h>
+
+namespace vigilante {
+
+// Downloads, verifies and mounts the content packs of the regions, so that
+// the app doesn't have to ship all of Resources/ (see asset_manager's
+// content packs).
+//
+// A region is a directory under Map/ (e.g., "Map/Forest/"), and its pack
+// is listed in the manifest (ContentPacks.json), which ships inside the app:
+//
+// {
+//   "baseUrl": "https://cdn.example.com/vigilante/packs/",
+//   "packs": [
+//     {
+//       "region": "Forest",
+//       "fileName": "Forest.pack",
+//       "size": 10485760,
+//       "crc32": 3735928559,
+//       "neighbors": ["VampireCastle"]
+//     }
+//   ]
+// }
+//
+// The regions which aren't listed (e.g., the one of kNewGameInitialMap)
+// are shipped inside the app as before. The neighbors are mutual, so a
+// region shipped inside the app can still have its neighbors prefetched.
+//
+// Whenever a GameMap has been loaded, the packs of its region and of the
+// neighboring regions are made resident: the missing ones are downloaded
+// in the background (by cocos2d::network::Downloader), verified and extracted
+// to <writable path>/content_packs/<region>/ on a worker thread, and mounted.
+// The other packs are unmounted, and the least recently resident ones are
+// deleted once the extracted packs take more than _kDiskBudget.
+//
+// All methods must be called on the main thread.
+class ContentPackManager final {
+ public:
+  static ContentPackManager* getInstance();
+
+  // Reads the manifest. Without one, all regions count as shipped inside the app.
+  void init(const std::string& manifestFileName);
+
+  // Returns true if `tmxMapFileName` is shipped inside the app,
+  // or the pack of its region is mounted.
+  bool isAvailable(const std::string& tmxMapFileName) const;
+
+  // Downloads (if needed) and mounts the pack of `tmxMapFileName`'s region,
+  // then invokes `callback` with whether the map is available. If it's
+  // already available, `callback` is invoked immediately.
+  void requestMap(const std::string& tmxMapFileName, const std::function<void (bool)>& callback);
+
+  // Makes the packs of `tmxMapFileName`'s region and its neighbors resident,
+  // see GameMapManager::doLoadGameMap().
+  void setCurrentMap(const std::string& tmxMapFileName);
+
+ private:
+  enum State {
+    NOT_DOWNLOADED,
+    DOWNLOADING,
+    EXTRACTING,
+    EXTRACTED,  // on the disk, but not mounted
+    MOUNTED
+  };
+
+  struct Pack final {
+    std::string region;
+    std::string fileName;
+    uint64_t size;  // in bytes
+    uint32_t crc32;
+    ContentPackManager::State state;
+    uint64_t lastResidentTime;  // the _residencyClock when it was last resident
+    std::vector<std::function<void (bool)>> callbacks;
+  };
+
+  static const uint64_t _kDiskBudget;  // in bytes
+
+  ContentPackManager();
+
+  // Example: "Map/Forest/Cave.tmx" -> "Forest"
+  static std::string getRegion(const std::string& tmxMapFileName);
+
+  ContentPackManager::Pack* getPack(const std::string& region);
+  const ContentPackManager::Pack* getPack(const std::string& region) const;
+  std::string getDir(const ContentPackManager::Pack& pack) const;
+
+  void request(ContentPackManager::Pack& pack);
+  void onDownloaded(const std::string& region, bool isSuccessful);
+  void onExtracted(const std::string& region, bool isSuccessful);
+  void invokeCallbacks(ContentPackManager::Pack& pack, bool isAvailable);
+  void evictExtractedPacks();
+
+  std::string _baseUrl;
+  std::string _packsDir;  // <writable path>/content_packs/
+  std::unordered_map<std::string, ContentPackManager::Pack> _packs;  // keyed by region
+  std::unordered_map<std::string, std::vector<std::string>> _neighbors;
+  std::unordered_set<std::string> _residentRegions;
+  std::unique_ptr<cocos2d::network::Downloader> _downloader;
+  uint64_t _residencyClock;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_CONTENT_PACK_MANAGER_H_
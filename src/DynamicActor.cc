@@ -9,10 +9,14 @@ using std::unique_ptr;
 
 namespace vigilante {
 
+float DynamicActor::_interpolationAlpha = 1.0f;
+
 DynamicActor::DynamicActor(size_t numAnimations, size_t numFixtures)
     : StaticActor(numAnimations),
       _body(),
-      _fixtures(numFixtures) {}
+      _fixtures(numFixtures),
+      _previousBodyPos(),
+      _hasPreviousBodyPos() {}
 
 
 bool DynamicActor::removeFromMap() {
@@ -25,20 +29,23 @@ bool DynamicActor::removeFromMap() {
 
 void DynamicActor::setPosition(float x, float y) {
   _body->SetTransform({x, y}, 0);
+
+  // Don't interpolate between the old and the new position.
+  _previousBodyPos = {x, y};
 }
 
 void DynamicActor::update(float) {
-  // Sync the body sprite with its b2body.
-  b2Vec2 b2bodyPos = _body->GetPosition();
-  _bodySprite->setPosition(b2bodyPos.x * kPpm, b2bodyPos.y * kPpm);
+  // The body sprite is synced with its b2body by TransformSync.
 }
 
 void DynamicActor::destroyBody() {
   if (!_body) {
     return;
   }
+  GameMapManager::getInstance()->setBullet(_body, false);
   _body->GetWorld()->DestroyBody(_body);
   _body = nullptr;
+  _hasPreviousBodyPos = false;
 }
 
 
@@ -51,14 +58,65 @@ vector<b2Fixture*>& DynamicActor::getFixtures() {
 }
 
 
+void DynamicActor::recordPreviousBodyPosition() {
+  if (!_body) {
+    return;
+  }
+  _previousBodyPos = _body->GetPosition();
+  _hasPreviousBodyPos = true;
+}
+
+b2Vec2 DynamicActor::getInterpolatedBodyPosition() const {
+  const b2Vec2& currentBodyPos = _body->GetPosition();
+
+  // If the world hasn't been stepped since this body was created,
+  // then there's nothing to interpolate with.
+  if (!_hasPreviousBodyPos) {
+    return currentBodyPos;
+  }
+  return _interpolationAlpha * currentBodyPos + (1.0f - _interpolationAlpha) * _previousBodyPos;
+}
+
+b2Vec2 DynamicActor::getPreviousBodyPosition() const {
+  return (_hasPreviousBodyPos) ? _previousBodyPos : _body->GetPosition();
+}
+
+float DynamicActor::getInterpolationAlpha() {
+  return _interpolationAlpha;
+}
+
+void DynamicActor::setInterpolationAlpha(float alpha) {
+  _interpolationAlpha = alpha;
+}
+
+
+bool DynamicActor::isTransformSyncNeeded() const {
+  return _isShownOnMap && _body && _bodySprite;
+}
+
+void DynamicActor::syncTransform(float x, float y) {
+  _bodySprite->setPosition(x, y);
+}
+
+
 void DynamicActor::setCategoryBits(b2Fixture* fixture, const short categoryBits) {
-  b2Filter filter = fixture->GetFilterData();
-  filter.categoryBits = categoryBits;
-  fixture->SetFilterData(filter);
+  const b2Filter& filter = fixture->GetFilterData();
+  setFilterData(fixture, categoryBits, filter.maskBits);
 }
 
 void DynamicActor::setMaskBits(b2Fixture* fixture, const short maskBits) {
+  const b2Filter& filter = fixture->GetFilterData();
+  setFilterData(fixture, filter.categoryBits, maskBits);
+}
+
+void DynamicActor::setFilterData(b2Fixture* fixture, const short categoryBits, const short maskBits) {
   b2Filter filter = fixture->GetFilterData();
+  if (filter.categoryBits == static_cast<uint16>(categoryBits) &&
+      filter.maskBits == static_cast<uint16>(maskBits)) {
+    return;  // SetFilterData() would flag all contacts and touch the broadphase proxy.
+  }
+
+  filter.categoryBits = categoryBits;
   filter.maskBits = maskBits;
   fixture->SetFilterData(filter);
 }
@@ -34,12 +34,41 @@ class DynamicActor : public StaticActor {
   b2Body* getBody() const;
   std::vector<b2Fixture*>& getFixtures();
 
+  // Physics interpolation.
+  // The b2World is stepped with a fixed time step (see GameScene::update()),
+  // so the sprites are synced with the body position interpolated between
+  // the last two physics states instead of the latest one.
+  void recordPreviousBodyPosition();
+  b2Vec2 getInterpolatedBodyPosition() const;
+  // Returns the current body position if the world hasn't been
+  // stepped since this body was created.
+  b2Vec2 getPreviousBodyPosition() const;
+  static float getInterpolationAlpha();
+  static void setInterpolationAlpha(float alpha);
+
+  // Sprite sync, see TransformSync.
+  // The sprites aren't synced in update(), but in one pass after all
+  // actors have been updated. syncTransform() is called with the
+  // interpolated body position (in pixels) of the actors for which
+  // isTransformSyncNeeded() returns true.
+  virtual bool isTransformSyncNeeded() const;
+  virtual void syncTransform(float x, float y);
+
  protected:
   static void setCategoryBits(b2Fixture* fixture, const short categoryBits);
   static void setMaskBits(b2Fixture* fixture, const short maskBits);
 
+  // Sets both the category and mask bits with a single b2Fixture::Refilter().
+  // Does nothing if the filter data of `fixture` is unchanged.
+  static void setFilterData(b2Fixture* fixture, const short categoryBits, const short maskBits);
+
   b2Body* _body;  // users should manually destory _body in subclass!
   std::vector<b2Fixture*> _fixtures;
+
+  b2Vec2 _previousBodyPos;
+  bool _hasPreviousBodyPos;
+
+  static float _interpolationAlpha;
 };
 
 }  // namespace vigilante
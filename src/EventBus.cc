@@ -0,0 +1,26 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "EventBus.h"
+
+namespace vigilante {
+
+EventBus* EventBus::getInstance() {
+  static EventBus instance;
+  return &instance;
+}
+
+EventBus::EventBus() : _channels(), _nextSubscriptionId() {}
+
+
+void EventBus::unsubscribe(int subscriptionId) {
+  std::get<EventBus::Channel<StatChangedEvent>>(_channels).unsubscribe(subscriptionId);
+  std::get<EventBus::Channel<ItemChangedEvent>>(_channels).unsubscribe(subscriptionId);
+  std::get<EventBus::Channel<QuestProgressedEvent>>(_channels).unsubscribe(subscriptionId);
+}
+
+void EventBus::dispatch() {
+  std::get<EventBus::Channel<StatChangedEvent>>(_channels).dispatch();
+  std::get<EventBus::Channel<ItemChangedEvent>>(_channels).dispatch();
+  std::get<EventBus::Channel<QuestProgressedEvent>>(_channels).dispatch();
+}
+
+}  // namespace vigilante
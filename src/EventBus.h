@@ -0,0 +1,144 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_EVENT_BUS_H_
+#define VIGILANTE_EVENT_BUS_H_
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace vigilante {
+
+// Forward Declaration
+class Character;
+class Quest;
+
+// The stats (health, magicka, stamina, ...) of a character have changed.
+struct StatChangedEvent final {
+  bool operator==(const StatChangedEvent& other) const {
+    return character == other.character;
+  }
+
+  Character* character;
+};
+
+// The inventory or the equipment slots of a character have changed.
+struct ItemChangedEvent final {
+  bool operator==(const ItemChangedEvent& other) const {
+    return character == other.character;
+  }
+
+  Character* character;
+};
+
+// A quest has been started, advanced or completed.
+struct QuestProgressedEvent final {
+  bool operator==(const QuestProgressedEvent& other) const {
+    return quest == other.quest && hint == other.hint;
+  }
+
+  Quest* quest;
+  std::string hint;  // to be shown by QuestHints
+};
+
+// A lightweight event bus which decouples the gameplay code from the UI.
+//
+// post() only queues an event, and identical events posted within the same
+// frame are coalesced. The listeners are notified by dispatch(), which is
+// called once per frame by GameScene::update(), so e.g., a character that
+// takes damage several times in one frame only causes one Hud relayout.
+//
+// The pointers in the events should only be compared against (e.g., Hud
+// ignores the characters other than the player), since the objects they
+// point to may have been deleted by the time the events are dispatched.
+//
+// The event bus must only be used by the main thread.
+class EventBus final {
+ public:
+  static EventBus* getInstance();
+
+  // Returns a subscription id which can be passed to unsubscribe().
+  template <typename Event>
+  int subscribe(const std::function<void (const Event&)>& listener);
+  void unsubscribe(int subscriptionId);
+
+  template <typename Event>
+  void post(const Event& event);
+
+  // Notifies the listeners of the events posted since the last dispatch().
+  // The events posted by the listeners themselves are deferred to the next one.
+  void dispatch();
+
+ private:
+  template <typename Event>
+  class Channel final {
+   public:
+    using Listener = std::function<void (const Event&)>;
+
+    Channel() : _listeners(), _pendingEvents() {}
+
+    void subscribe(int subscriptionId, const Channel::Listener& listener) {
+      _listeners.push_back({subscriptionId, listener});
+    }
+
+    void unsubscribe(int subscriptionId) {
+      _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
+                                      [subscriptionId](const std::pair<int, Channel::Listener>& l) {
+        return l.first == subscriptionId;
+      }), _listeners.end());
+    }
+
+    void post(const Event& event) {
+      if (std::find(_pendingEvents.begin(), _pendingEvents.end(), event) == _pendingEvents.end()) {
+        _pendingEvents.push_back(event);
+      }
+    }
+
+    void dispatch() {
+      if (_pendingEvents.empty()) {
+        return;
+      }
+
+      std::vector<Event> events;
+      events.swap(_pendingEvents);
+
+      // A listener may unsubscribe itself (or others) while being notified.
+      const std::vector<std::pair<int, Channel::Listener>> listeners = _listeners;
+      for (const auto& event : events) {
+        for (const auto& l : listeners) {
+          l.second(event);
+        }
+      }
+    }
+
+   private:
+    std::vector<std::pair<int, Channel::Listener>> _listeners;
+    std::vector<Event> _pendingEvents;
+  };
+
+  EventBus();
+
+  std::tuple<EventBus::Channel<StatChangedEvent>,
+             EventBus::Channel<ItemChangedEvent>,
+             EventBus::Channel<QuestProgressedEvent>> _channels;
+  int _nextSubscriptionId;
+};
+
+
+template <typename Event>
+int EventBus::subscribe(const std::function<void (const Event&)>& listener) {
+  const int subscriptionId = _nextSubscriptionId++;
+  std::get<EventBus::Channel<Event>>(_channels).subscribe(subscriptionId, listener);
+  return subscriptionId;
+}
+
+template <typename Event>
+void EventBus::post(const Event& event) {
+  std::get<EventBus::Channel<Event>>(_channels).post(event);
+}
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_EVENT_BUS_H_
@@ -0,0 +1,192 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "FrameAnimator.h"
+
+#include <algorithm>
+
+using std::array;
+using std::function;
+using std::string;
+using cocos2d::Animation;
+using cocos2d::Sprite;
+
+namespace vigilante {
+
+const int FrameAnimator::kAfterLastFrame;
+const FrameAnimator::EventTrack FrameAnimator::kNoEvents = {{-1, -1}};
+
+const array<string, FrameAnimator::Event::EVENT_SIZE> FrameAnimator::_kEventStr = {{
+  "hit",
+  "end"
+}};
+
+double FrameAnimator::_clock = 0;
+
+FrameAnimator::EventTrack FrameAnimator::parseEventTrack(const rapidjson::Value& json) {
+  EventTrack eventTrack = kNoEvents;
+  for (int event = 0; event < Event::EVENT_SIZE; event++) {
+    const char* eventStr = _kEventStr[event].c_str();
+    if (json.HasMember(eventStr)) {
+      eventTrack[event] = json[eventStr].GetInt();
+    }
+  }
+  return eventTrack;
+}
+
+FrameAnimator::FrameAnimator()
+    : _sprite(),
+      _animation(),
+      _isLooped(),
+      _startTime(),
+      _frameIndex(-1),
+      _onFinished(),
+      _eventTrack(kNoEvents),
+      _listener(),
+      _lastDispatchedFrame(-1),
+      _isEndDispatched(),
+      _playCount() {}
+
+FrameAnimator::~FrameAnimator() {
+  // The listener (usually the owner) is being destroyed.
+  release();
+}
+
+
+void FrameAnimator::advanceClock(float delta) {
+  _clock += delta;
+}
+
+void FrameAnimator::play(Sprite* sprite,
+                         Animation* animation,
+                         bool loop,
+                         const function<void ()>& onFinished,
+                         const EventTrack& eventTrack,
+                         Listener* listener) {
+  // Retain the new animation before releasing the old one,
+  // in case they're the same animation.
+  animation->retain();
+  Listener* const pendingEndListener =
+      (_animation && _listener && _eventTrack[Event::END] >= 0 && !_isEndDispatched) ? _listener : nullptr;
+  release();
+
+  _sprite = sprite;
+  _animation = animation;
+  _isLooped = loop;
+  _startTime = _clock;
+  _frameIndex = -1;
+  _onFinished = onFinished;
+  _eventTrack = eventTrack;
+  _listener = listener;
+  _lastDispatchedFrame = -1;
+  _isEndDispatched = false;
+
+  if (pendingEndListener) {
+    const unsigned int playCount = _playCount;
+    pendingEndListener->onFrameEvent(Event::END);
+    if (_playCount != playCount) {
+      return;
+    }
+  }
+  update();
+}
+
+void FrameAnimator::stop() {
+  Listener* const pendingEndListener =
+      (_animation && _listener && _eventTrack[Event::END] >= 0 && !_isEndDispatched) ? _listener : nullptr;
+  release();
+  if (pendingEndListener) {
+    pendingEndListener->onFrameEvent(Event::END);
+  }
+}
+
+void FrameAnimator::update(bool isSpriteSynced) {
+  if (!_animation) {
+    return;
+  }
+
+  const auto& frames = _animation->getFrames();
+  const int frameCount = static_cast<int>(frames.size());
+  const float delay = _animation->getDelayPerUnit();
+  if (frameCount == 0) {
+    stop();
+    return;
+  }
+
+  // The number of frames elapsed since play(), including the previous loops.
+  const int elapsedFrames = (delay > 0) ? static_cast<int>((_clock - _startTime) / delay) : frameCount;
+  const bool isFinished = !_isLooped && elapsedFrames >= frameCount;
+  const int frameIndex = (isFinished) ? frameCount - 1 : elapsedFrames % frameCount;
+
+  if (isSpriteSynced && frameIndex != _frameIndex) {
+    _frameIndex = frameIndex;
+    _sprite->setSpriteFrame(frames.at(frameIndex)->getSpriteFrame());
+  }
+
+  if (_listener && elapsedFrames > _lastDispatchedFrame &&
+      !dispatchEvents(_lastDispatchedFrame + 1, elapsedFrames, frameCount)) {
+    return;
+  }
+
+  if (isFinished) {
+    // The callback may destroy the owner of this animator,
+    // so don't touch any member after calling it.
+    function<void ()> onFinished = std::move(_onFinished);
+    release();
+    if (onFinished) {
+      onFinished();
+    }
+  }
+}
+
+
+bool FrameAnimator::isPlaying() const {
+  return _animation != nullptr;
+}
+
+bool FrameAnimator::dispatchEvents(int firstFrame, int lastFrame, int frameCount) {
+  _lastDispatchedFrame = lastFrame;
+  const unsigned int playCount = _playCount;
+
+  for (int event = 0; event < Event::EVENT_SIZE; event++) {
+    const int frame = _eventTrack[event];
+    bool isPassed = false;
+    if (frame < 0) {
+      continue;
+    } else if (!_isLooped) {
+      // An event past the last frame is dispatched after the last frame.
+      isPassed = (frame < frameCount) ? firstFrame <= frame && frame <= lastFrame :
+                                        lastFrame >= frameCount;
+    } else {
+      // When catching up with the clock, an event of a looped animation is
+      // dispatched once, no matter how many loops have been skipped.
+      const int loopFrame = std::min(frame, frameCount - 1);
+      const int firstLoopFrame = firstFrame % frameCount;
+      isPassed = lastFrame - firstFrame + 1 >= frameCount ||
+                 (loopFrame - firstLoopFrame + frameCount) % frameCount <= lastFrame - firstFrame;
+    }
+
+    if (!isPassed) {
+      continue;
+    }
+    if (event == Event::END) {
+      _isEndDispatched = true;
+    }
+    _listener->onFrameEvent(static_cast<Event>(event));
+    if (_playCount != playCount) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void FrameAnimator::release() {
+  if (_animation) {
+    _animation->release();
+  }
+  _sprite = nullptr;
+  _animation = nullptr;
+  _onFinished = nullptr;
+  _listener = nullptr;
+  _playCount++;
+}
+
+}  // namespace vigilante
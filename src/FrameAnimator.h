@@ -0,0 +1,109 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_FRAME_ANIMATOR_H_
+#define VIGILANTE_FRAME_ANIMATOR_H_
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <string>
+
+#include <cocos2d.h>
+#include <json/document.h>
+
+namespace vigilante {
+
+// Plays a cocos2d::Animation on a sprite by setting its sprite frames directly,
+// instead of running Animate/Repeat/Sequence actions on the sprite, so that
+// switching animations doesn't allocate anything.
+//
+// All animators are driven by a shared clock (see advanceClock()), and the
+// current frame is derived from the time elapsed since play(). Therefore,
+// an animator which isn't updated for a while (e.g., an off-screen Npc)
+// will simply catch up with the clock the next time it's updated.
+//
+// An animation may also have an event track, which marks the frames at which
+// something happens (e.g., an attack lands), so that the gameplay follows the
+// animation rather than separate timers. The events are dispatched to the
+// listener as the animator advances past their frames, e.g., in a json:
+//
+// "frameEvents": {
+//   "hit": 3,   // dispatched when the 4th frame is shown
+//   "end": 99   // past the last frame: dispatched after the last frame
+// }
+class FrameAnimator final {
+ public:
+  enum Event {
+    HIT,
+    END,
+    EVENT_SIZE
+  };
+
+  // The frame index of each event, or -1 if the animation doesn't have it.
+  using EventTrack = std::array<int, FrameAnimator::Event::EVENT_SIZE>;
+
+  class Listener {
+   public:
+    virtual ~Listener() = default;
+
+    // Mustn't destroy the owner of the animator.
+    virtual void onFrameEvent(FrameAnimator::Event event) = 0;
+  };
+
+  // The frame index which is past the last frame of any animation.
+  static const int kAfterLastFrame = std::numeric_limits<int>::max();
+  static const FrameAnimator::EventTrack kNoEvents;
+
+  // The events which aren't in `json` are -1.
+  static FrameAnimator::EventTrack parseEventTrack(const rapidjson::Value& json);
+
+  FrameAnimator();
+  ~FrameAnimator();
+
+  // Advances the shared clock. Must be called once per frame.
+  static void advanceClock(float delta);
+
+  // The animation is retained until it's finished (or replaced/stopped).
+  // If `loop` is false, `onFinished` will be called after the last frame.
+  // The events of `eventTrack` are dispatched to `listener`. If the animation
+  // is replaced or stopped before its END has been dispatched, END is
+  // dispatched right away, so whatever is waiting for it won't hang.
+  void play(cocos2d::Sprite* sprite,
+            cocos2d::Animation* animation,
+            bool loop,
+            const std::function<void ()>& onFinished=nullptr,
+            const FrameAnimator::EventTrack& eventTrack=kNoEvents,
+            FrameAnimator::Listener* listener=nullptr);
+  void stop();
+
+  // If `isSpriteSynced` is false (e.g., the sprite is off screen),
+  // only the events are dispatched, and the sprite frame is left as is.
+  void update(bool isSpriteSynced=true);
+
+  bool isPlaying() const;
+
+ private:
+  static const std::array<std::string, FrameAnimator::Event::EVENT_SIZE> _kEventStr;
+
+  // Returns false if the listener has replayed or stopped this animator.
+  bool dispatchEvents(int firstFrame, int lastFrame, int frameCount);
+  void release();
+
+  static double _clock;  // in seconds
+
+  cocos2d::Sprite* _sprite;
+  cocos2d::Animation* _animation;
+  bool _isLooped;
+  double _startTime;
+  int _frameIndex;
+  std::function<void ()> _onFinished;
+
+  FrameAnimator::EventTrack _eventTrack;
+  FrameAnimator::Listener* _listener;
+  int _lastDispatchedFrame;  // counted from play(), including the previous loops
+  bool _isEndDispatched;
+  unsigned int _playCount;  // incremented by play() and stop()
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_FRAME_ANIMATOR_H_
@@ -0,0 +1,193 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "HotReloader.h"
+
+#include <sys/stat.h>
+
+#include <functional>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <cocos2d.h>
+#include "AssetManager.h"
+#include "Importable.h"
+#include "character/Npc.h"
+#include "character/Player.h"
+#include "item/Equipment.h"
+#include "item/Item.h"
+#include "map/GameMapManager.h"
+#include "ui/dialogue/DialogueManager.h"
+#include "util/JsonUtil.h"
+#include "util/Logger.h"
+#include "util/ProfileCache.h"
+
+#define HOT_RELOAD_POLL_INTERVAL 1.0f  // in seconds
+
+using std::string;
+using std::vector;
+using std::unordered_set;
+using cocos2d::FileUtils;
+
+namespace vigilante {
+
+namespace {
+
+void addImportable(HotReloader::ImportableMap& importables,
+                   unordered_set<Importable*>& visited,
+                   const string& jsonFileName,
+                   Importable* importable) {
+  if (!jsonFileName.empty() && visited.insert(importable).second) {
+    importables[jsonFileName].push_back(importable);
+  }
+}
+
+void addCharacterItems(HotReloader::ImportableMap& importables,
+                       unordered_set<Importable*>& visited,
+                       const Character& character) {
+  for (const auto& items : character.getInventory()) {
+    for (const auto item : items) {
+      addImportable(importables, visited, item->getItemProfile().jsonFileName, item);
+    }
+  }
+  for (const auto equipment : character.getEquipmentSlots()) {
+    if (equipment) {
+      addImportable(importables, visited, equipment->getItemProfile().jsonFileName, equipment);
+    }
+  }
+}
+
+}  // namespace
+
+
+HotReloader* HotReloader::getInstance() {
+  static HotReloader instance;
+  return &instance;
+}
+
+HotReloader::HotReloader()
+    : _isEnabled(!asset_manager::isDatabasePackLoaded()),
+      _timer(),
+      _watchedFiles() {}
+
+
+void HotReloader::update(float delta) {
+  if (!_isEnabled) {
+    return;
+  }
+
+  _timer += delta;
+  if (_timer < HOT_RELOAD_POLL_INTERVAL) {
+    return;
+  }
+  _timer = 0;
+
+  ImportableMap importables;
+  collectImportables(importables);
+
+  for (const auto& entry : importables) {
+    FileState newState;
+    if (pollFile(entry.first, newState)) {
+      reload(entry.first, entry.second);
+    }
+    _watchedFiles[entry.first] = newState;
+  }
+}
+
+
+bool HotReloader::isEnabled() const {
+  return _isEnabled;
+}
+
+void HotReloader::setEnabled(bool enabled) {
+  _isEnabled = enabled;
+  _timer = 0;
+
+  // Files modified while disabled are not reloaded when re-enabled.
+  _watchedFiles.clear();
+}
+
+
+void HotReloader::collectImportables(HotReloader::ImportableMap& importables) const {
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  if (!gmMgr->getGameMap()) {
+    return;
+  }
+
+  unordered_set<Importable*> visited;
+
+  // The player's own profile is part of the save game,
+  // so only the player's items are reloaded.
+  if (Player* player = gmMgr->getPlayer()) {
+    addCharacterItems(importables, visited, *player);
+  }
+
+  const Npc* interlocutor = DialogueManager::getInstance()->getTargetNpc();
+  const ActorRegistry& actors = gmMgr->getGameMap()->getDynamicActors();
+
+  actors.forEachInGroup(ActorRegistry::Group::NPC, [&](DynamicActor* actor) {
+    Npc* npc = dynamic_cast<Npc*>(actor);
+    if (!npc) {
+      return;
+    }
+    addImportable(importables, visited, npc->getCharacterProfile().jsonFileName, npc);
+    addCharacterItems(importables, visited, *npc);
+
+    // The nodes of the dialogue tree being traversed must stay alive.
+    if (npc != interlocutor) {
+      DialogueTree& dialogueTree = npc->getDialogueTree();
+      addImportable(importables, visited, dialogueTree.getJsonFileName(), &dialogueTree);
+    }
+  });
+
+  actors.forEachInGroup(ActorRegistry::Group::ITEM, [&](DynamicActor* actor) {
+    if (Item* item = dynamic_cast<Item*>(actor)) {
+      addImportable(importables, visited, item->getItemProfile().jsonFileName, item);
+    }
+  });
+}
+
+bool HotReloader::pollFile(const string& jsonFileName, HotReloader::FileState& newState) {
+  auto it = _watchedFiles.find(jsonFileName);
+  const string fullPath = FileUtils::getInstance()->fullPathForFilename(jsonFileName);
+
+  struct stat fileStat;
+  if (fullPath.empty() || ::stat(fullPath.c_str(), &fileStat) != 0) {
+    newState = (it != _watchedFiles.end()) ? it->second : FileState{};
+    return false;
+  }
+
+  newState.modificationTime = fileStat.st_mtime;
+  if (it != _watchedFiles.end() && it->second.modificationTime == newState.modificationTime) {
+    newState.contentHash = it->second.contentHash;
+    return false;
+  }
+
+  // Some editors touch the file without changing anything, so only
+  // the files whose contents have actually changed are reloaded.
+  newState.contentHash = std::hash<string>()(FileUtils::getInstance()->getStringFromFile(fullPath));
+  return it != _watchedFiles.end() && it->second.contentHash != newState.contentHash;
+}
+
+void HotReloader::reload(const string& jsonFileName, const vector<Importable*>& importables) {
+  try {
+    json_util::JsonDocument jsonDocument(jsonFileName);
+    if (jsonDocument.get().HasParseError()) {
+      VGLOG(LOG_WARN, "Not reloading malformed json: %s", jsonFileName.c_str());
+      return;
+    }
+  } catch (const std::runtime_error& ex) {
+    VGLOG(LOG_WARN, "Not reloading %s: %s", jsonFileName.c_str(), ex.what());
+    return;
+  }
+
+  VGLOG(LOG_INFO, "Reloading %s (%d objects)", jsonFileName.c_str(),
+        static_cast<int>(importables.size()));
+  profile_cache::invalidate(jsonFileName);
+
+  // Characters keep their current vitals, clamped to the new maximums
+  // (see Character::import()).
+  for (auto importable : importables) {
+    importable->import(jsonFileName);
+  }
+}
+
+}  // namespace vigilante
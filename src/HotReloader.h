@@ -0,0 +1,63 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_HOT_RELOADER_H_
+#define VIGILANTE_HOT_RELOADER_H_
+
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vigilante {
+
+class Importable;
+
+// Watches the json files of the npcs, items and dialogue trees which are
+// currently alive, and re-imports them in place whenever their files are
+// modified on disk, so that the designers can tweak the values without
+// restarting the game.
+//
+// The files are polled (by their modification time) every once in a while.
+// A modified file is parsed first, and if it's malformed, the objects keep
+// their current profiles. Only the objects imported from the modified file
+// are re-imported (see profile_cache::invalidate()).
+//
+// Hot reloading is disabled by default if the json files are served from
+// the database pack, since the pack won't change at runtime.
+// All methods must be called on the main thread.
+class HotReloader final {
+ public:
+  // json file name -> the objects imported from it
+  using ImportableMap = std::unordered_map<std::string, std::vector<Importable*>>;
+
+  static HotReloader* getInstance();
+
+  void update(float delta);
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+
+ private:
+  struct FileState final {
+    std::time_t modificationTime;
+    size_t contentHash;
+  };
+
+  HotReloader();
+
+  void collectImportables(ImportableMap& importables) const;
+
+  // Returns true if `jsonFileName` has been modified since the last poll.
+  // The first poll of a file only records its current state.
+  bool pollFile(const std::string& jsonFileName, HotReloader::FileState& newState);
+  void reload(const std::string& jsonFileName, const std::vector<Importable*>& importables);
+
+  bool _isEnabled;
+  float _timer;
+
+  // json file name -> its state as of the last poll
+  std::unordered_map<std::string, HotReloader::FileState> _watchedFiles;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_HOT_RELOADER_H_
@@ -0,0 +1,71 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ProjectilePool.h"
+
+using std::string;
+using std::vector;
+
+namespace vigilante {
+
+const size_t ProjectilePool::_kInitialCapacity = 8;
+
+ProjectilePool::ProjectilePool(b2World* world)
+    : _world(world),
+      _freeBodies() {}
+
+ProjectilePool::~ProjectilePool() {
+  clear();
+}
+
+
+b2Body* ProjectilePool::acquire(const string& kind,
+                                const ProjectilePool::BodyFactory& factory,
+                                const b2Vec2& position,
+                                void* userData) {
+  auto it = _freeBodies.find(kind);
+  if (it == _freeBodies.end()) {
+    it = _freeBodies.emplace(kind, vector<b2Body*>()).first;
+    it->second.reserve(_kInitialCapacity);
+    for (size_t i = 0; i < _kInitialCapacity; i++) {
+      b2Body* body = factory(_world);
+      body->SetActive(false);
+      it->second.push_back(body);
+    }
+  }
+
+  vector<b2Body*>& freeBodies = it->second;
+  b2Body* body = nullptr;
+  if (freeBodies.empty()) {
+    body = factory(_world);
+  } else {
+    body = freeBodies.back();
+    freeBodies.pop_back();
+  }
+
+  for (b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+    fixture->SetUserData(userData);
+  }
+  body->SetTransform(position, 0);
+  body->SetLinearVelocity({0, 0});
+  body->SetAngularVelocity(0);
+  body->SetActive(true);
+  return body;
+}
+
+void ProjectilePool::release(const string& kind, b2Body* body) {
+  body->SetActive(false);
+  for (b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+    fixture->SetUserData(nullptr);
+  }
+  _freeBodies[kind].push_back(body);
+}
+
+void ProjectilePool::clear() {
+  for (const auto& freeBodies : _freeBodies) {
+    for (auto body : freeBodies.second) {
+      _world->DestroyBody(body);
+    }
+  }
+  _freeBodies.clear();
+}
+
+}  // namespace vigilante
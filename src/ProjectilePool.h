@@ -0,0 +1,51 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_PROJECTILE_POOL_H_
+#define VIGILANTE_PROJECTILE_POOL_H_
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+namespace vigilante {
+
+// A free list of inactive b2Bodies (with their b2Fixtures already attached)
+// for each kind of projectile, so that firing a projectile doesn't have to
+// create a new b2Body and destroying it doesn't have to free one.
+//
+// When a kind of projectile is acquired for the first time,
+// _kInitialCapacity bodies are pre-created with its BodyFactory.
+// Acquired bodies are re-enabled with SetTransform() and SetActive(),
+// and released bodies are disabled with SetActive(false).
+//
+// Like b2World::CreateBody() and b2World::DestroyBody(), acquire()
+// and release() must not be called during b2World::Step().
+class ProjectilePool final {
+ public:
+  // Creates a b2Body with all of its fixtures attached.
+  using BodyFactory = std::function<b2Body* (b2World*)>;
+
+  explicit ProjectilePool(b2World* world);
+  ~ProjectilePool();
+
+  b2Body* acquire(const std::string& kind,
+                  const ProjectilePool::BodyFactory& factory,
+                  const b2Vec2& position,
+                  void* userData);
+  void release(const std::string& kind, b2Body* body);
+
+  // Destroys all the bodies which are currently in the pool.
+  void clear();
+
+  static const size_t _kInitialCapacity;
+
+ private:
+  b2World* _world;
+  std::unordered_map<std::string, std::vector<b2Body*>> _freeBodies;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_PROJECTILE_POOL_H_
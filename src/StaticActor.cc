@@ -1,21 +1,16 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "StaticActor.h"
 
-#include <stdexcept>
-
+#include "AnimationCache.h"
 #include "Constants.h"
 #include "map/GameMapManager.h"
+#include "util/LoadProfiler.h"
 
 using std::string;
-using std::runtime_error;
 using cocos2d::Node;
-using cocos2d::FileUtils;
-using cocos2d::Vector;
 using cocos2d::Animation;
 using cocos2d::Sprite;
-using cocos2d::SpriteFrame;
 using cocos2d::SpriteBatchNode;
-using cocos2d::SpriteFrameCache;
 
 namespace vigilante {
 
@@ -34,8 +29,7 @@ bool StaticActor::showOnMap(float x, float y) {
   _isShownOnMap = true;
 
   _bodySprite->setPosition(x, y);
-  GameMapManager::getInstance()->getLayer()->addChild(_bodySprite,
-                                                      graphical_layers::kDefault);
+  GameMapManager::getInstance()->getRenderBuckets()->get(graphical_layers::kDefault)->addChild(_bodySprite);
   return true;
 }
 
@@ -47,11 +41,23 @@ bool StaticActor::removeFromMap() {
   _isShownOnMap = false;
 
   // If _bodySpritesheet exists, we should remove it instead of _bodySprite.
-  GameMapManager::getInstance()->getLayer()->removeChild(
-    (_bodySpritesheet) ? ((Node*) _bodySpritesheet) : ((Node*) _bodySprite)
-  );
+  // Otherwise, _bodySprite is either a child of a render bucket (see RenderBuckets)
+  // or a child of a shared batch node (see BatchNodeRegistry).
+  if (_bodySpritesheet) {
+    _bodySpritesheet->removeFromParent();
+  } else {
+    _bodySprite->removeFromParent();
+  }
   _bodySpritesheet = nullptr;
   _bodySprite = nullptr;
+
+  // The animations will be created again in the next showOnMap().
+  for (auto& animation : _bodyAnimations) {
+    if (animation) {
+      StaticActor::releaseAnimation(animation);
+      animation = nullptr;
+    }
+  }
   return true;
 }
 
@@ -60,6 +66,10 @@ void StaticActor::setPosition(float x, float y) {
 }
 
 
+bool StaticActor::isShownOnMap() const {
+  return _isShownOnMap;
+}
+
 Sprite* StaticActor::getBodySprite() const {
   return _bodySprite;
 }
@@ -73,50 +83,12 @@ Animation* StaticActor::createAnimation(const string& textureResDir,
                                         const string& framesName,
                                         float interval,
                                         Animation* fallback) {
-  FileUtils* fileUtils = FileUtils::getInstance();
-  SpriteFrameCache* frameCache = SpriteFrameCache::getInstance();
-
-  // The texture resources under Resources/Texture/ has the following rules:
-  //
-  // Texture/character/player/player_attacking0/0.png
-  // |______________________| |____| |________| |___|
-  //      textureResDir          |   framesName
-  //                      framesNamePrefix
-  //
-  // As you can see, each framesName (e.g., attacking0) is preceded by a prefix,
-  // this is to **prevent frames name collision** in cocos2d::SpriteFrameCache!
-  string framesNamePrefix = StaticActor::getLastDirName(textureResDir);
-
-  // Count how many frames (.png) are there in the corresponding directory.
-  // Method: we will use FileUtils to test whether a file exists starting from
-  //         0.png, 1.png, ..., n.png
-  string dir = textureResDir + "/" + framesNamePrefix + "_" + framesName;
-  size_t frameCount = 0;
-  fileUtils->setPopupNotify(false); // disable CCLOG
-  while (fileUtils->isFileExist(dir + "/" + std::to_string(frameCount) + ".png")) {
-    frameCount++;
-  }
-  fileUtils->setPopupNotify(true); // re-enable CCLOG
-
-  // If there are no frames in the corresponding directory, fallback to IDLE_SHEATHED.
-  if (frameCount == 0) {
-    if (fallback) {
-      return fallback;
-    } else {
-      throw runtime_error("Failed to create animations from " +
-                          dir + ", but fallback animation is not provided.");
-    }
-  }
-  
-  Vector<SpriteFrame*> frames;
-  for (size_t i = 0; i < frameCount; i++) {
-    const string& name = framesNamePrefix + "_" + framesName + "/" +
-                         std::to_string(i) + ".png";
-    frames.pushBack(frameCache->getSpriteFrameByName(name));
-  }
-  Animation* animation = Animation::createWithSpriteFrames(frames, interval);
-  animation->retain();
-  return animation;
+  LoadProfiler::ScopedTimer timer(LoadProfiler::Section::ANIMATIONS);
+  return AnimationCache::getInstance()->acquire(textureResDir, framesName, interval, fallback);
+}
+
+void StaticActor::releaseAnimation(Animation* animation) {
+  AnimationCache::getInstance()->release(animation);
 }
 
 string StaticActor::getLastDirName(const string& directory) {
@@ -24,6 +24,7 @@ class StaticActor {
   virtual bool removeFromMap();
   virtual void setPosition(float x, float y);
 
+  bool isShownOnMap() const;
   cocos2d::Sprite* getBodySprite() const;
   cocos2d::SpriteBatchNode* getBodySpritesheet() const;
 
@@ -35,7 +36,11 @@ class StaticActor {
   // instead. If the user did not provide a fallback animation, a std::runtime_error
   // will be thrown.
   //
-  // IMPORTANT: animations created with this utility method should be release()d!
+  // The animations are shared via AnimationCache, so the actors with the same
+  // textureResDir will get the same cocos2d::Animation instances.
+  //
+  // IMPORTANT: animations created with this utility method should be
+  //            released with StaticActor::releaseAnimation()!
   //
   // @param textureResDir: the path to texture resource directory
   // @param framesName: the name of the frames
@@ -46,6 +51,7 @@ class StaticActor {
                                              const std::string& framesName,
                                              float interval,
                                              cocos2d::Animation* fallback=nullptr);
+  static void releaseAnimation(cocos2d::Animation* animation);
 
   // The texture resources under Resources/Texture/ has the following rules:
   //
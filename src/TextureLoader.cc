@@ -0,0 +1,79 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TextureLoader.h"
+
+#include "AssetManager.h"
+#include "util/Logger.h"
+#include "util/TraceProfiler.h"
+
+using std::string;
+using cocos2d::Director;
+using cocos2d::Rect;
+using cocos2d::Sprite;
+using cocos2d::Texture2D;
+using cocos2d::TextureCache;
+
+namespace vigilante {
+
+TextureLoader* TextureLoader::getInstance() {
+  static TextureLoader instance;
+  return &instance;
+}
+
+
+void TextureLoader::preload(const string& textureFileName) {
+  TextureCache* textureCache = Director::getInstance()->getTextureCache();
+  if (textureCache->getTextureForKey(textureFileName) ||
+      _pendingTextures.find(textureFileName) != _pendingTextures.end()) {
+    return;
+  }
+
+  _pendingTextures[textureFileName];
+  textureCache->addImageAsync(textureFileName, [this, textureFileName](Texture2D* texture) {
+    onTextureLoaded(textureFileName, texture);
+  });
+}
+
+Sprite* TextureLoader::createSprite(const string& textureFileName) {
+  Texture2D* texture = Director::getInstance()->getTextureCache()->getTextureForKey(textureFileName);
+  if (texture) {
+    Sprite* sprite = Sprite::createWithTexture(texture);
+    sprite->getTexture()->setAliasTexParameters();
+    return sprite;
+  }
+
+  Sprite* sprite = Sprite::create(asset_manager::kEmptyImage);
+  sprite->retain();
+  preload(textureFileName);
+  _pendingTextures[textureFileName].push_back(sprite);
+  return sprite;
+}
+
+
+void TextureLoader::onTextureLoaded(const string& textureFileName, Texture2D* texture) {
+  VGTRACE_ZONE("TextureLoader::onTextureLoaded");
+
+  auto it = _pendingTextures.find(textureFileName);
+  if (it == _pendingTextures.end()) {
+    return;
+  }
+
+  if (texture) {
+    texture->setAliasTexParameters();
+  } else {
+    VGLOG(LOG_ERR, "Failed to load texture: %s", textureFileName.c_str());
+  }
+
+  // If a sprite has been removed from the map in the meantime,
+  // this is where it gets deleted.
+  for (auto sprite : it->second) {
+    if (texture) {
+      sprite->setTexture(texture);
+      sprite->setTextureRect(Rect(0, 0, texture->getContentSize().width,
+                                        texture->getContentSize().height));
+    }
+    sprite->release();
+  }
+  _pendingTextures.erase(it);
+}
+
+}  // namespace vigilante
@@ -0,0 +1,44 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TEXTURE_LOADER_H_
+#define VIGILANTE_TEXTURE_LOADER_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// Loads standalone textures (e.g., item icons) with TextureCache::addImageAsync(),
+// so that the png files are decoded off the main thread.
+//
+// createSprite() never blocks. If the texture hasn't been loaded yet,
+// the sprite shows a placeholder (asset_manager::kEmptyImage) until the
+// texture is ready. To avoid placeholders altogether, preload() the
+// textures which are likely to be needed soon (see GameMap::preloadItemIcons()).
+//
+// All methods must be called on the main thread.
+class TextureLoader final {
+ public:
+  static TextureLoader* getInstance();
+
+  // Starts loading the texture in the background,
+  // unless it has been loaded or is being loaded.
+  void preload(const std::string& textureFileName);
+
+  // Returns an autoreleased sprite of the specified texture.
+  cocos2d::Sprite* createSprite(const std::string& textureFileName);
+
+ private:
+  TextureLoader() = default;
+
+  void onTextureLoaded(const std::string& textureFileName, cocos2d::Texture2D* texture);
+
+  // texture file name -> the (retained) sprites waiting for it
+  std::unordered_map<std::string, std::vector<cocos2d::Sprite*>> _pendingTextures;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TEXTURE_LOADER_H_
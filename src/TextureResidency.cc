@@ -0,0 +1,243 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TextureResidency.h"
+
+#include <cocos2d.h>
+#include "AnimationCache.h"
+#include "StaticActor.h"
+#include "character/Character.h"
+#include "map/GameMapSpec.h"
+#include "util/Logger.h"
+#include "util/ProfileCache.h"
+
+using std::function;
+using std::string;
+using std::vector;
+using std::unordered_set;
+using cocos2d::Director;
+using cocos2d::SpriteFrameCache;
+using cocos2d::Texture2D;
+
+namespace vigilante {
+
+TextureResidency* TextureResidency::getInstance() {
+  static TextureResidency instance;
+  return &instance;
+}
+
+TextureResidency::TextureResidency()
+    : _spritesheets(),
+      _spritesheetIndices(),
+      _learnedWorkingSets(),
+      _currentTmxMapFileName(),
+      _pendingPrefetches() {}
+
+
+void TextureResidency::addSpritesheet(const string& plistFullPath,
+                                      const string& textureFullPath,
+                                      vector<string> framesNames,
+                                      bool isReleasable) {
+  _spritesheets.push_back({plistFullPath, textureFullPath, std::move(framesNames),
+                           isReleasable, /*isResident=*/true, /*isLoading=*/false});
+  _spritesheetIndices.clear();
+}
+
+void TextureResidency::require(const string& textureResDir) {
+  if (!_currentTmxMapFileName.empty()) {
+    _learnedWorkingSets[_currentTmxMapFileName].insert(textureResDir);
+  }
+
+  for (const auto index : getSpritesheetIndices(textureResDir)) {
+    Spritesheet& spritesheet = _spritesheets[index];
+    if (!spritesheet.isResident) {
+      VGLOG(LOG_INFO, "Loading non-resident spritesheet: %s", spritesheet.plistFullPath.c_str());
+      load(spritesheet);
+    }
+  }
+}
+
+void TextureResidency::switchWorkingSet(const GameMapSpec& spec) {
+  _currentTmxMapFileName = spec.tmxMapFileName;
+
+  // The spritesheets still referenced by the remaining animations
+  // (i.e., not the ones of the previous map) must be kept as well.
+  unordered_set<string> textureResDirs = getWorkingSet(spec);
+  for (const auto& textureResDir : AnimationCache::getInstance()->getReferencedTextureResDirs()) {
+    textureResDirs.insert(textureResDir);
+  }
+
+  vector<bool> shouldBeResident(_spritesheets.size());
+  for (const auto& textureResDir : textureResDirs) {
+    for (const auto index : getSpritesheetIndices(textureResDir)) {
+      shouldBeResident[index] = true;
+    }
+  }
+
+  int numLoaded = 0;
+  int numUnloaded = 0;
+  for (size_t i = 0; i < _spritesheets.size(); i++) {
+    Spritesheet& spritesheet = _spritesheets[i];
+    if (shouldBeResident[i] && !spritesheet.isResident) {
+      load(spritesheet);
+      numLoaded++;
+    } else if (!shouldBeResident[i] && spritesheet.isResident && spritesheet.isReleasable) {
+      unload(spritesheet);
+      numUnloaded++;
+    }
+  }
+  VGLOG(LOG_INFO, "Texture working set of %s: %zu/%zu spritesheets (+%d, -%d)",
+        spec.tmxMapFileName.c_str(), getNumResidentSpritesheets(), _spritesheets.size(),
+        numLoaded, numUnloaded);
+}
+
+void TextureResidency::prefetchWorkingSet(const GameMapSpec& spec) {
+  for (const auto& textureResDir : getWorkingSet(spec)) {
+    for (const auto index : getSpritesheetIndices(textureResDir)) {
+      if (!_spritesheets[index].isResident && !_spritesheets[index].isLoading) {
+        loadAsync(index);
+      }
+    }
+  }
+}
+
+void TextureResidency::prefetch(const string& textureResDir, const function<void ()>& onResident) {
+  bool isResident = true;
+  for (const auto index : getSpritesheetIndices(textureResDir)) {
+    if (_spritesheets[index].isResident) {
+      continue;
+    }
+    isResident = false;
+    if (!_spritesheets[index].isLoading) {
+      loadAsync(index);
+    }
+  }
+
+  if (isResident) {
+    onResident();
+    return;
+  }
+  _pendingPrefetches.push_back({textureResDir, onResident});
+}
+
+size_t TextureResidency::getNumSpritesheets() const {
+  return _spritesheets.size();
+}
+
+size_t TextureResidency::getNumResidentSpritesheets() const {
+  size_t numResidentSpritesheets = 0;
+  for (const auto& spritesheet : _spritesheets) {
+    numResidentSpritesheets += spritesheet.isResident;
+  }
+  return numResidentSpritesheets;
+}
+
+
+unordered_set<string> TextureResidency::getWorkingSet(const GameMapSpec& spec) const {
+  unordered_set<string> textureResDirs(spec.textures.begin(), spec.textures.end());
+  for (const auto& npcSpec : spec.npcs) {
+    textureResDirs.insert(profile_cache::get<Character::Profile>(npcSpec.json)->textureResDir);
+  }
+
+  auto it = _learnedWorkingSets.find(spec.tmxMapFileName);
+  if (it != _learnedWorkingSets.end()) {
+    textureResDirs.insert(it->second.begin(), it->second.end());
+  }
+  return textureResDirs;
+}
+
+const vector<int>& TextureResidency::getSpritesheetIndices(const string& textureResDir) {
+  auto it = _spritesheetIndices.find(textureResDir);
+  if (it != _spritesheetIndices.end()) {
+    return it->second;
+  }
+
+  // See StaticActor::createAnimation() for the naming rules of the frames.
+  const string framesNamePrefix = StaticActor::getLastDirName(textureResDir) + "_";
+  vector<int> indices;
+  for (size_t i = 0; i < _spritesheets.size(); i++) {
+    for (const auto& framesName : _spritesheets[i].framesNames) {
+      if (framesName.compare(0, framesNamePrefix.size(), framesNamePrefix) == 0) {
+        indices.push_back(static_cast<int>(i));
+        break;
+      }
+    }
+  }
+  return _spritesheetIndices.insert({textureResDir, std::move(indices)}).first->second;
+}
+
+void TextureResidency::load(TextureResidency::Spritesheet& spritesheet) {
+  Texture2D* texture = Director::getInstance()->getTextureCache()->addImage(spritesheet.textureFullPath);
+  if (!texture) {
+    VGLOG(LOG_ERR, "Failed to load spritesheet: %s", spritesheet.textureFullPath.c_str());
+    return;
+  }
+
+  texture->setAliasTexParameters();
+  SpriteFrameCache::getInstance()->addSpriteFramesWithFile(spritesheet.plistFullPath, texture);
+  spritesheet.isResident = true;
+  spritesheet.isLoading = false;
+}
+
+void TextureResidency::loadAsync(int index) {
+  _spritesheets[index].isLoading = true;
+
+  // _spritesheets may have grown by the time the texture is loaded,
+  // so it's referred to by its index.
+  Director::getInstance()->getTextureCache()->addImageAsync(
+      _spritesheets[index].textureFullPath, [this, index](Texture2D* texture) {
+    Spritesheet& spritesheet = _spritesheets[index];
+    if (!spritesheet.isLoading) {
+      // Either loaded synchronously or unloaded in the meantime.
+      if (texture && !spritesheet.isResident) {
+        Director::getInstance()->getTextureCache()->removeTexture(texture);
+      }
+      resolvePendingPrefetches();
+      return;
+    }
+    spritesheet.isLoading = false;
+    if (texture) {
+      texture->setAliasTexParameters();
+      SpriteFrameCache::getInstance()->addSpriteFramesWithFile(spritesheet.plistFullPath, texture);
+      spritesheet.isResident = true;
+    }
+    resolvePendingPrefetches();
+  });
+}
+
+void TextureResidency::unload(TextureResidency::Spritesheet& spritesheet) {
+  // The sprites which are still using this texture hold their own
+  // references to it, so it will be freed once they're gone.
+  SpriteFrameCache::getInstance()->removeSpriteFramesFromFile(spritesheet.plistFullPath);
+  Director::getInstance()->getTextureCache()->removeTextureForKey(spritesheet.textureFullPath);
+  spritesheet.isResident = false;
+  spritesheet.isLoading = false;
+}
+
+void TextureResidency::resolvePendingPrefetches() {
+  // The callbacks are invoked after the loop, since they may prefetch again.
+  vector<function<void ()>> callbacks;
+  for (auto it = _pendingPrefetches.begin(); it != _pendingPrefetches.end();) {
+    bool isLoading = false;
+    bool isResident = true;
+    for (const auto index : getSpritesheetIndices(it->textureResDir)) {
+      isLoading |= _spritesheets[index].isLoading;
+      isResident &= _spritesheets[index].isResident;
+    }
+
+    if (isLoading) {
+      ++it;
+      continue;
+    }
+    // A prefetch whose spritesheets have failed to load (or have been
+    // unloaded in the meantime) is simply dropped.
+    if (isResident) {
+      callbacks.push_back(std::move(it->onResident));
+    }
+    it = _pendingPrefetches.erase(it);
+  }
+
+  for (const auto& callback : callbacks) {
+    callback();
+  }
+}
+
+}  // namespace vigilante
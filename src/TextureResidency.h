@@ -0,0 +1,110 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TEXTURE_RESIDENCY_H_
+#define VIGILANTE_TEXTURE_RESIDENCY_H_
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vigilante {
+
+class GameMapSpec;
+
+// Keeps only the spritesheets needed by the current GameMap in VRAM,
+// so that the texture memory is bounded by the largest map rather than
+// by all of the spritesheets in spritesheets.txt.
+//
+// The working set of a GameMap is a set of texture resource directories
+// (see StaticActor::createAnimation()), which is the union of:
+// 1. the "textures" map property (a comma-separated list), if any,
+// 2. the textureResDirs of the npcs placed on the map, and
+// 3. whatever has been required (see require()) during the previous visits
+//    of the same map, e.g., the fx and the npcs' equipment.
+//
+// When a GameMap is being loaded, the spritesheets outside of its working set
+// are released, unless they're still referenced by AnimationCache (e.g., those
+// of the player and the fx). When the map is being prefetched (see
+// GameMapManager::prefetchGameMap()), the spritesheets of its working set are
+// loaded asynchronously. Anything which is required but not resident
+// (e.g., on the first visit of a map) is loaded synchronously, unless it has
+// been prefetched (see prefetch()) in time.
+//
+// Only the spritesheets which consist of animation frames alone
+// (e.g., "goblin_attacking0/0.png") are ever released. The others
+// (e.g., the control hints atlas) are looked up by frame names
+// directly, so they're always resident.
+//
+// All methods must be called on the main thread.
+class TextureResidency final {
+ public:
+  static TextureResidency* getInstance();
+
+  // Called by asset_manager once a spritesheet has been loaded.
+  // `framesNames` are the prefixed frames names in it, e.g., "goblin_attacking0".
+  void addSpritesheet(const std::string& plistFullPath,
+                      const std::string& textureFullPath,
+                      std::vector<std::string> framesNames,
+                      bool isReleasable);
+
+  // Makes sure the spritesheets with the frames under `textureResDir` are
+  // resident, and adds `textureResDir` to the working set of the current map.
+  void require(const std::string& textureResDir);
+
+  // Releases the spritesheets outside of the working set of `spec`
+  // and loads the ones inside it.
+  void switchWorkingSet(const GameMapSpec& spec);
+  void prefetchWorkingSet(const GameMapSpec& spec);
+
+  // Loads the spritesheets with the frames under `textureResDir` asynchronously
+  // (e.g., those of the equipment highlighted in the pause menu), and calls
+  // `onResident` once all of them are resident, which may be right away.
+  // Unlike require(), this doesn't add `textureResDir` to the working set.
+  void prefetch(const std::string& textureResDir, const std::function<void ()>& onResident);
+
+  size_t getNumSpritesheets() const;
+  size_t getNumResidentSpritesheets() const;
+
+ private:
+  struct Spritesheet final {
+    std::string plistFullPath;
+    std::string textureFullPath;
+    std::vector<std::string> framesNames;
+    bool isReleasable;
+    bool isResident;
+    bool isLoading;  // asynchronously
+  };
+
+  TextureResidency();
+
+  std::unordered_set<std::string> getWorkingSet(const GameMapSpec& spec) const;
+  // The indices into _spritesheets.
+  const std::vector<int>& getSpritesheetIndices(const std::string& textureResDir);
+
+  void load(TextureResidency::Spritesheet& spritesheet);
+  void loadAsync(int index);
+  void unload(TextureResidency::Spritesheet& spritesheet);
+  // Calls back the prefetches whose spritesheets are no longer loading.
+  void resolvePendingPrefetches();
+
+  struct PendingPrefetch final {
+    std::string textureResDir;
+    std::function<void ()> onResident;
+  };
+
+  std::vector<TextureResidency::Spritesheet> _spritesheets;
+
+  // textureResDir -> the indices of the spritesheets which have its frames.
+  std::unordered_map<std::string, std::vector<int>> _spritesheetIndices;
+
+  // tmx map file name -> the textureResDirs required on that map.
+  std::unordered_map<std::string, std::unordered_set<std::string>> _learnedWorkingSets;
+  std::string _currentTmxMapFileName;
+
+  std::vector<TextureResidency::PendingPrefetch> _pendingPrefetches;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TEXTURE_RESIDENCY_H_
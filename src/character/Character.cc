@@ -5,41 +5,61 @@
 #include <cassert>
 
 #include <json/document.h>
+#include "std/make_unique.h"
+#include "AnimationCache.h"
 #include "AssetManager.h"
+#include "AudioManager.h"
 #include "CallbackManager.h"
 #include "Constants.h"
+#include "EventBus.h"
 #include "Player.h"
+#include "TextureResidency.h"
+#include "gameplay/CameraSystem.h"
+#include "gameplay/CombatSystem.h"
+#include "gameplay/CooldownSystem.h"
 #include "gameplay/ExpPointTable.h"
+#include "gl/PaletteSwap.h"
+#include "item/LootBag.h"
 #include "map/GameMapManager.h"
-#include "ui/hud/Hud.h"
-#include "ui/floating_damages/FloatingDamages.h"
+#include "map/WorldEpoch.h"
 #include "util/box2d/b2BodyBuilder.h"
+#include "util/FrameArena.h"
+#include "util/ProfileCache.h"
 #include "util/RandUtil.h"
 #include "util/JsonUtil.h"
 #include "util/Logger.h"
+#include "util/TraceProfiler.h"
+
+#define MAX_IDLE_SKILL_INSTANCES 4
+#define SKILL_PARTICLES_VIEW_MARGIN 1.0f  // in meters
+#define DEFAULT_NPC_HIT_DELAY .25f  // in seconds, see Character::getEventTrack()
 
-using std::set;
 using std::array;
+using std::vector;
+using std::pair;
 using std::unordered_set;
 using std::string;
 using std::function;
 using std::unique_ptr;
 using std::shared_ptr;
 using cocos2d::Director;
-using cocos2d::Sequence;
-using cocos2d::CallFunc;
-using cocos2d::Repeat;
-using cocos2d::RepeatForever;
 using cocos2d::Animation;
-using cocos2d::Animate;
-using cocos2d::Action;
 using cocos2d::Sprite;
 using cocos2d::FileUtils;
-using cocos2d::SpriteBatchNode;
+using cocos2d::GLProgramState;
+using cocos2d::Vec2;
 using rapidjson::Document;
 
 namespace vigilante {
 
+namespace {
+
+bool compareItemNameIds(const Item* lhs, const Item* rhs) {
+  return lhs->getItemProfile().nameId.getValue() < rhs->getItemProfile().nameId.getValue();
+}
+
+}  // namespace
+
 const array<string, Character::State::STATE_SIZE> Character::_kCharacterStateStr = {{
   "idle_sheathed",
   "idle_unsheathed",
@@ -57,65 +77,121 @@ const array<string, Character::State::STATE_SIZE> Character::_kCharacterStateStr
   "killed"
 }};
 
+const array<bool, Character::State::STATE_SIZE> Character::_kIsStateAnimationLooped = {{
+  true,   // idle_sheathed
+  true,   // idle_unsheathed
+  true,   // running_sheathed
+  true,   // running_unsheathed
+  false,  // jumping_sheathed
+  false,  // jumping_unsheathed
+  false,  // falling_sheathed
+  false,  // falling_unsheathed
+  false,  // crouching_sheathed
+  false,  // crouching_unsheathed
+  false,  // sheathing_weapon
+  false,  // unsheathing_weapon
+  false,  // attacking0
+  false   // killed
+}};
+
+vector<Character::HotState> Character::_hotStates;
+vector<int> Character::_freeHotStateIndices;
+
+Character::ColdData::ColdData(const Character::Profile& characterProfile)
+    : characterProfile(characterProfile),
+      derivedStats(),
+      inventory(),
+      itemMapper(),
+      skillBook(),
+      skillMapper(),
+      idleSkills(),
+      bodyExtraAttackAnimations(),
+      equipmentExtraAttackAnimations(),
+      equipmentAnimations(),
+      skillBodyAnimations() {}
+
 Character::Character(const string& jsonFileName)
     : DynamicActor(State::STATE_SIZE, FixtureType::FIXTURE_SIZE),
-      _characterProfile(jsonFileName),
-      _statsRegenTimer(),
-      _baseRegenDeltaHealth(5),
-      _baseRegenDeltaMagicka(5),
-      _baseRegenDeltaStamina(5),
-      _currentState(State::IDLE_SHEATHED),
-      _previousState(State::IDLE_SHEATHED),
-      _isFacingRight(true),
-      _isWeaponSheathed(true),
-      _isSheathingWeapon(),
-      _isUnsheathingWeapon(),
-      _isJumpingDisallowed(),
-      _isJumping(),
-      _isDoubleJumping(),
-      _isOnPlatform(),
-      _isAttacking(),
-      _isUsingSkill(),
-      _isCrouching(),
-      _isInvincible(),
-      _isTakingDamage(),
-      _isKilled(),
-      _isSetToKill(),
-      _inRangeTargets(),
+      _cold(std::make_unique<Character::ColdData>(*profile_cache::get<Character::Profile>(jsonFileName))),
+      _statsIndex(StatsSystem::getInstance()->allocate(this,
+          {{_cold->characterProfile.health,
+            _cold->characterProfile.magicka,
+            _cold->characterProfile.stamina}},
+          {{_cold->characterProfile.fullHealth,
+            _cold->characterProfile.fullMagicka,
+            _cold->characterProfile.fullStamina}})),
+      _hotIndex(allocateHotState()),
+      _weaponMaskBits(),
+      _isWeaponFixtureEnabled(),
       _lockedOnTarget(),
       _isAlerted(),
-      _inventory(),
       _equipmentSlots(),
-      _itemMapper(),
+      _inventoryRevision(),
       _interactableObject(),
       _portal(),
-      _skillBook(),
-      _skillMapper(),
+      _skillCooldowns(),
+      _activeSkills(),
       _currentlyUsedSkill(),
       // There will be at least `1` attack animation.
       _kAttackAnimationIdxMax(1 + getExtraAttackAnimationsCount()),
       _attackAnimationIdx(),
-      _bodyExtraAttackAnimations(_kAttackAnimationIdxMax - 1),
-      _equipmentExtraAttackAnimations(),
       _equipmentSprites(),
-      _equipmentSpritesheets(),
-      _equipmentAnimations(),
-      _skillBodyAnimations(),
-      _party() {
-  // Resize each vector in _equipmentExtraAttackAnimations to match
-  // the size of _bodyExtraAttackAnimations.
-  for (auto& animationVector : _equipmentExtraAttackAnimations) {
-    animationVector.resize(_bodyExtraAttackAnimations.size());
-  }
-
-  // Populate this character's _skillBook with the skills it knows by default.
-  for (const auto& s : _characterProfile.defaultSkills) {
+      _bodyAnimator(),
+      _equipmentAnimators(),
+      _party(),
+      _allies(),
+      _alliesVersion() {
+  // Resize each vector in ColdData::equipmentExtraAttackAnimations to match
+  // the size of ColdData::bodyExtraAttackAnimations.
+  _cold->bodyExtraAttackAnimations.resize(_kAttackAnimationIdxMax - 1);
+  for (auto& animationVector : _cold->equipmentExtraAttackAnimations) {
+    animationVector.resize(_cold->bodyExtraAttackAnimations.size());
+  }
+
+  // Populate this character's skill book with the skills it knows by default.
+  for (const auto& s : _cold->characterProfile.defaultSkills) {
     addSkill(Skill::create(s, this));
   }
-  // Popuplate this character's _inventory with the items it owns by default.
-  for (const auto& p : _characterProfile.defaultInventory) {
-    addItem(Item::create(p.first), p.second);
+  // Popuplate this character's inventory with the items it owns by default.
+  addDefaultItems();
+  updateDerivedStats();
+
+  AudioManager::getInstance()->preload(_cold->characterProfile.hurtSfx);
+  AudioManager::getInstance()->preload(_cold->characterProfile.killedSfx);
+}
+
+Character::~Character() {
+  // The pending callbacks of this character (and of its skills) capture `this`.
+  CallbackManager::getInstance()->cancelAll(this);
+  CombatSystem::getInstance()->cancel(this);
+  StatsSystem::getInstance()->release(_statsIndex);
+  for (const auto& p : _skillCooldowns) {
+    CooldownSystem::getInstance()->release(p.second);
   }
+  _freeHotStateIndices.push_back(_hotIndex);
+}
+
+Character::HotState Character::getInitialHotState() {
+  HotState hotState{};
+  hotState.currentState = State::IDLE_SHEATHED;
+  hotState.previousState = State::IDLE_SHEATHED;
+  hotState.isFacingRight = true;
+  hotState.isWeaponSheathed = true;
+  hotState.isInView = true;
+  hotState.isSpriteSyncDirty = true;
+  return hotState;
+}
+
+int Character::allocateHotState() {
+  if (_freeHotStateIndices.empty()) {
+    _hotStates.push_back(getInitialHotState());
+    return static_cast<int>(_hotStates.size()) - 1;
+  }
+
+  const int index = _freeHotStateIndices.back();
+  _freeHotStateIndices.pop_back();
+  _hotStates[index] = getInitialHotState();
+  return index;
 }
 
 
@@ -124,133 +200,151 @@ bool Character::removeFromMap() {
     return false;
   }
 
-  if (!_isKilled) {
+  _bodyAnimator.stop();
+  StatsSystem::getInstance()->setRegenEnabled(_statsIndex, false);
+  CombatSystem::getInstance()->cancel(this);
+
+  // The pending callbacks of this character (and of the skills it's using,
+  // e.g., the end of a BackDash) touch its b2Body, which is gone from here on.
+  // An Npc removed during a GameMap transition is only parked in NpcPool, so
+  // they have to be dropped here rather than in the destructor.
+  CallbackManager::getInstance()->cancelAll(this);
+  settleTransientStates();
+
+  if (!hot().isKilled) {
     destroyBody();
   }
 
-  // Remove _equipmentSpritesheets
+  // Remove _equipmentSprites from their batch nodes.
   for (auto equipment : _equipmentSlots) {
     if (equipment) {
-      GameMapManager::getInstance()->getLayer()->removeChild(
-          _equipmentSpritesheets[equipment->getEquipmentProfile().equipmentType]
-      );
+      Equipment::Type type = equipment->getEquipmentProfile().equipmentType;
+      _equipmentSprites[type]->removeFromParent();
+      _equipmentSprites[type] = nullptr;
     }
   }
 
+  // Release the animations (the body animations are released in
+  // StaticActor::removeFromMap()). They will be acquired from
+  // AnimationCache again in the next showOnMap().
+  for (auto& animation : _cold->bodyExtraAttackAnimations) {
+    StaticActor::releaseAnimation(animation);
+    animation = nullptr;
+  }
+  for (const auto& p : _cold->skillBodyAnimations) {
+    StaticActor::releaseAnimation(p.second);
+  }
+  _cold->skillBodyAnimations.clear();
+
+  for (int type = 0; type < Equipment::Type::SIZE; type++) {
+    releaseEquipmentAnimations(static_cast<Equipment::Type>(type));
+  }
+
   return true;
 }
 
 void Character::update(float delta) {
-  if (!_isShownOnMap || _isKilled) {
+  VGTRACE_ZONE("Character::update");
+  if (!_isShownOnMap || hot().isKilled) {
     return;
   }
 
   // Flip the sprite if needed.
-  if (!_isFacingRight && !_bodySprite->isFlippedX()) {
+  if (!hot().isFacingRight && !_bodySprite->isFlippedX()) {
     _bodySprite->setFlippedX(true);
-    auto shape = dynamic_cast<b2CircleShape*>(_fixtures[FixtureType::WEAPON]->GetShape());
-    shape->m_p = {-_characterProfile.attackRange / kPpm, 0};
-  } else if (_isFacingRight && _bodySprite->isFlippedX()) {
+  } else if (hot().isFacingRight && _bodySprite->isFlippedX()) {
     _bodySprite->setFlippedX(false);
-    auto shape = dynamic_cast<b2CircleShape*>(_fixtures[FixtureType::WEAPON]->GetShape());
-    shape->m_p = {_characterProfile.attackRange / kPpm, 0};
   }
 
-  const b2Vec2& b2bodyPos = _body->GetPosition();
+  if (hot().isUsingSkill != _isWeaponFixtureEnabled) {
+    setWeaponFixtureEnabled(hot().isUsingSkill);
+  }
 
-  // Sync the body sprite with its b2body.
-   _bodySprite->setPosition(_body->GetPosition().x * kPpm + _characterProfile.spriteOffsetX,
-                            _body->GetPosition().y * kPpm + _characterProfile.spriteOffsetY);
+  // If this character is far away from the camera, then there's no need to
+  // switch its animations until it comes back into view, unless it is
+  // about to be killed (onKilled() runs after the KILLED animation).
+  // The same goes for its sprites, see isTransformSyncNeeded().
+  // Its body animation still has to dispatch its events (e.g., the END of a skill).
+  if (!hot().isInView && !hot().isSetToKill) {
+    _bodyAnimator.update(/*isSpriteSynced=*/false);
+    return;
+  }
 
-  // Sync the equipment sprites with its b2body.
+  // Advance the animations.
+  _bodyAnimator.update();
   for (int type = 0; type < static_cast<int>(Equipment::Type::SIZE); type++) {
-    if (!_equipmentSlots[type]) {
-      continue;
+    if (_equipmentSlots[type]) {
+      _equipmentAnimators[type].update();
     }
-
-    if (!_isFacingRight && !_equipmentSprites[type]->isFlippedX()) {
-      _equipmentSprites[type]->setFlippedX(true);
-    } else if (_isFacingRight && _equipmentSprites[type]->isFlippedX()) {
-      _equipmentSprites[type]->setFlippedX(false);
-    }
-    _equipmentSprites[type]->setPosition(b2bodyPos.x * kPpm + _characterProfile.spriteOffsetX,
-                                         b2bodyPos.y * kPpm + _characterProfile.spriteOffsetY);
-  }
-
-  // Handle stats regeneration.
-  _statsRegenTimer += delta;
-  if (_statsRegenTimer >= 5.0f) {
-    _statsRegenTimer = 0;
-    regenHealth(_baseRegenDeltaHealth);
-    regenMagicka(_baseRegenDeltaMagicka);
-    regenStamina(_baseRegenDeltaStamina);
-    Hud::getInstance()->updateStatusBars();
   }
 
   // Don't update character's state if he/she is using skill.
-  if (_isUsingSkill) {
+  if (hot().isUsingSkill) {
     return;
   }
 
-  _previousState = _currentState;
-  _currentState = getState();
+  hot().previousState = hot().currentState;
+  hot().currentState = getState();
   
   // If there's a change in character's state, run the corresponding animation.
-  if (_previousState != _currentState) {
-    switch(_currentState) {
-      case State::RUNNING_SHEATHED:
-        runAnimation(State::RUNNING_SHEATHED, true);
-        break;
-      case State::RUNNING_UNSHEATHED:
-        runAnimation(State::RUNNING_UNSHEATHED, true);
-        break;
-      case State::JUMPING_SHEATHED:
-        runAnimation(State::JUMPING_SHEATHED, false);
-        break;
-      case State::JUMPING_UNSHEATHED:
-        runAnimation(State::JUMPING_UNSHEATHED, false);
-        break;
-      case State::FALLING_SHEATHED:
-        runAnimation(State::FALLING_SHEATHED, false);
-        break;
-      case State::FALLING_UNSHEATHED:
-        runAnimation(State::FALLING_UNSHEATHED, false);
-        break;
-      case State::CROUCHING_SHEATHED:
-        runAnimation(State::CROUCHING_SHEATHED, false);
-        break;
-      case State::CROUCHING_UNSHEATHED:
-        runAnimation(State::CROUCHING_UNSHEATHED, false);
-        break;
-      case State::SHEATHING_WEAPON:
-        runAnimation(State::SHEATHING_WEAPON, false);
-        break;
-      case State::UNSHEATHING_WEAPON:
-        runAnimation(State::UNSHEATHING_WEAPON, false);
-        break;
-      case State::ATTACKING:
-        runAnimation(State::ATTACKING, false);
-        break;
-      case State::KILLED:
-        // `onKilled()` will be executed after the KILLED animation
-        // has finished.
-        runAnimation(State::KILLED, [this]() {
-          onKilled();
-        });
-        break;
-      case State::IDLE_SHEATHED:
-        runAnimation(State::IDLE_SHEATHED, true);
-        break;
-      case State::IDLE_UNSHEATHED:  // fallthrough
-      default:
-        runAnimation(State::IDLE_UNSHEATHED, true);
-        break;
-    }
+  if (hot().previousState == hot().currentState) {
+    return;
+  }
+
+  if (hot().currentState == State::KILLED) {
+    // `onKilled()` will be executed after the KILLED animation
+    // has finished.
+    runAnimation(State::KILLED, [this]() {
+      onKilled();
+    });
+  } else {
+    runAnimation(hot().currentState, _kIsStateAnimationLooped[hot().currentState]);
   }
 }
 
+void Character::reset() {
+  assert(!_isShownOnMap);
+  CallbackManager::getInstance()->cancelAll(this);
+  import(_cold->characterProfile.jsonFileName);
+
+  setStat(StatsSystem::Stat::HEALTH, _cold->characterProfile.health);
+  setStat(StatsSystem::Stat::MAGICKA, _cold->characterProfile.magicka);
+  setStat(StatsSystem::Stat::STAMINA, _cold->characterProfile.stamina);
+
+  hot() = getInitialHotState();
+
+  _isWeaponFixtureEnabled = false;
+  _lockedOnTarget = nullptr;
+  _isAlerted = false;
+  _interactableObject = nullptr;
+  _portal = nullptr;
+  _activeSkills.clear();
+  _cold->idleSkills.clear();
+  for (const auto& p : _skillCooldowns) {
+    CooldownSystem::getInstance()->reset(p.second);
+  }
+  _currentlyUsedSkill = nullptr;
+  _attackAnimationIdx = 0;
+
+  // Restock the items it owns by default (e.g., a merchant's goods).
+  for (auto& items : _cold->inventory) {
+    items.clear();
+  }
+  _equipmentSlots.fill(nullptr);
+  _cold->itemMapper.clear();
+  addDefaultItems();
+  updateDerivedStats();
+}
+
 void Character::import(const string& jsonFileName) {
-  _characterProfile = Character::Profile(jsonFileName);
+  _cold->characterProfile = *profile_cache::get<Character::Profile>(jsonFileName);
+
+  // Keep the current vitals, clamped to the new full values.
+  StatsSystem* statsSystem = StatsSystem::getInstance();
+  statsSystem->setFull(_statsIndex, StatsSystem::Stat::HEALTH, _cold->characterProfile.fullHealth);
+  statsSystem->setFull(_statsIndex, StatsSystem::Stat::MAGICKA, _cold->characterProfile.fullMagicka);
+  statsSystem->setFull(_statsIndex, StatsSystem::Stat::STAMINA, _cold->characterProfile.fullStamina);
+  updateDerivedStats();
 }
 
 
@@ -272,8 +366,8 @@ void Character::defineBody(b2BodyType bodyType,
   // Fixture position in box2d is relative to b2body's position.
   float scaleFactor = Director::getInstance()->getContentScaleFactor();
   b2Vec2 vertices[4];
-  float bw = _characterProfile.bodyWidth;
-  float bh = _characterProfile.bodyHeight;
+  float bw = _cold->characterProfile.bodyWidth;
+  float bh = _cold->characterProfile.bodyHeight;
   vertices[0] = {-bw / 2 / scaleFactor,  bh / 2 / scaleFactor};
   vertices[1] = { bw / 2 / scaleFactor,  bh / 2 / scaleFactor};
   vertices[2] = {-bw / 2 / scaleFactor, -bh / 2 / scaleFactor};
@@ -301,30 +395,109 @@ void Character::defineBody(b2BodyType bodyType,
     .buildFixture();
 
 
-  // Create weapon fixture.
-  float atkRange = _characterProfile.attackRange;
+  // Create weapon fixture, which doesn't collide with anything
+  // until a skill is used (see setWeaponFixtureEnabled()).
+  float atkRange = _cold->characterProfile.attackRange;
   _fixtures[FixtureType::WEAPON] = bodyBuilder.newCircleFixture({atkRange, 0}, atkRange, kPpm)
     .categoryBits(category_bits::kMeleeWeapon)
-    .maskBits(weaponMaskBits)
+    .maskBits(0)
     .setSensor(true)
     .setUserData(this)
     .buildFixture();
+  _weaponMaskBits = weaponMaskBits;
+  _isWeaponFixtureEnabled = false;
+}
+
+void Character::setCollisionRole(collision_filters::Role role) {
+  static_assert(FixtureType::FIXTURE_SIZE == 3, "collision matrix out of sync with FixtureType");
+
+  const auto& filters = collision_filters::kCharacterFilters[role];
+  _weaponMaskBits = filters[FixtureType::WEAPON].maskBits;
+  for (int type = 0; type < FixtureType::FIXTURE_SIZE; type++) {
+    const bool isCollidable = type != FixtureType::WEAPON || _isWeaponFixtureEnabled;
+    DynamicActor::setFilterData(_fixtures[type], filters[type].categoryBits,
+                                isCollidable ? filters[type].maskBits : 0);
+  }
+}
+
+void Character::setWeaponFixtureEnabled(bool enabled) {
+  _isWeaponFixtureEnabled = enabled;
+  if (!_body) {
+    return;
+  }
+
+  b2Fixture* weaponFixture = _fixtures[FixtureType::WEAPON];
+  if (enabled) {
+    auto shape = static_cast<b2CircleShape*>(weaponFixture->GetShape());
+    const float atkRange = _cold->characterProfile.attackRange / kPpm;
+    shape->m_p = {(hot().isFacingRight) ? atkRange : -atkRange, 0};
+  }
+  DynamicActor::setMaskBits(weaponFixture, (enabled) ? _weaponMaskBits : 0);
 }
 
 void Character::defineTexture(const string& bodyTextureResDir, float x, float y) {
   loadBodyAnimations(bodyTextureResDir);
-  _bodySprite->setPosition(x * kPpm, y * kPpm + _characterProfile.spriteOffsetY);
+  _bodySprite->setPosition(x * kPpm, y * kPpm + _cold->characterProfile.spriteOffsetY);
+  hot().isSpriteSyncDirty = true;
 
   runAnimation(State::IDLE_SHEATHED);
 }
 
+bool Character::isTransformSyncNeeded() const {
+  return DynamicActor::isTransformSyncNeeded() &&
+         !hot().isKilled &&
+         (hot().isInView || hot().isSetToKill);
+}
+
+void Character::syncTransform(float x, float y) {
+  // Pushes the b2body's (interpolated) position and this character's facing
+  // to the body sprite and the equipment sprites, but only if either of them
+  // has changed since the last sync, or the sprites have been recreated.
+  const Vec2 spritePos = {x + _cold->characterProfile.spriteOffsetX,
+                          y + _cold->characterProfile.spriteOffsetY};
+
+  if (!hot().isSpriteSyncDirty &&
+      spritePos == hot().lastSyncedSpritePos &&
+      hot().isFacingRight == hot().lastSyncedFacingRight) {
+    return;
+  }
+
+  // Sync the body sprite with its b2body.
+  // (The body sprite is flipped in Character::update() along with the weapon fixture.)
+  _bodySprite->setPosition(spritePos);
+
+  // Sync the equipment sprites with its b2body.
+  for (int type = 0; type < static_cast<int>(Equipment::Type::SIZE); type++) {
+    if (!_equipmentSlots[type]) {
+      continue;
+    }
+    _equipmentSprites[type]->setFlippedX(!hot().isFacingRight);
+    _equipmentSprites[type]->setPosition(spritePos);
+  }
+
+  hot().isSpriteSyncDirty = false;
+  hot().lastSyncedSpritePos = spritePos;
+  hot().lastSyncedFacingRight = hot().isFacingRight;
+}
+
+GLProgramState* Character::getPaletteProgramState(const string& palette) {
+  return (palette.empty()) ? nullptr : PaletteSwap::getInstance()->getProgramState(palette);
+}
+
+void Character::addEquipmentSpriteToMap(Equipment::Type type) {
+  const string& palette = _equipmentSlots[type]->getEquipmentProfile().palette;
+  GameMapManager::getInstance()->getBatchNodeRegistry()->addChild(_equipmentSprites[type],
+                                                                  graphical_layers::kEquipment - type,
+                                                                  getPaletteProgramState(palette));
+}
+
 void Character::loadBodyAnimations(const string& bodyTextureResDir) {
 #define CREATE_BODY_ANIMATION(state, fallback)         \
   do {                                                 \
     _bodyAnimations[state] = createAnimation(          \
-        _characterProfile.textureResDir,               \
+        _cold->characterProfile.textureResDir,               \
         _kCharacterStateStr[state],                    \
-        _characterProfile.frameInterval[state] / kPpm, \
+        _cold->characterProfile.frameInterval[state] / kPpm, \
         fallback                                       \
     );                                                 \
   } while (0)
@@ -346,11 +519,11 @@ void Character::loadBodyAnimations(const string& bodyTextureResDir) {
   CREATE_BODY_ANIMATION(State::KILLED, fallback);
 
   // Load extra attack animations.
-  for (size_t i = 0; i < _bodyExtraAttackAnimations.size(); i++) {
-    _bodyExtraAttackAnimations[i] = createAnimation(
+  for (size_t i = 0; i < _cold->bodyExtraAttackAnimations.size(); i++) {
+    _cold->bodyExtraAttackAnimations[i] = createAnimation(
         bodyTextureResDir,
         "attacking" + std::to_string(1 + i),
-        _characterProfile.frameInterval[State::ATTACKING] / kPpm,
+        _cold->characterProfile.frameInterval[State::ATTACKING] / kPpm,
         fallback
     );
   }
@@ -358,74 +531,59 @@ void Character::loadBodyAnimations(const string& bodyTextureResDir) {
   // Select a frame as default look for this sprite.
   string framePrefix = StaticActor::getLastDirName(bodyTextureResDir);
   _bodySprite = Sprite::createWithSpriteFrameName(framePrefix + "_idle_sheathed/0.png");
-  _bodySprite->setScale(_characterProfile.spriteScaleX,
-                        _characterProfile.spriteScaleY);
-
-  _bodySpritesheet = SpriteBatchNode::create(bodyTextureResDir + "/spritesheet.png");
-  _bodySpritesheet->getTexture()->setAliasTexParameters();  // disable texture antialiasing
-  _bodySpritesheet->addChild(_bodySprite);
+  _bodySprite->setScale(_cold->characterProfile.spriteScaleX,
+                        _cold->characterProfile.spriteScaleY);
 }
 
 void Character::loadEquipmentAnimations(Equipment* equipment) {
-#define CREATE_EQUIPMENT_ANIMATION(equipment, state, fallback)                                     \
-  do {                                                                                             \
-    _equipmentAnimations[equipment->getEquipmentProfile().equipmentType][state] = createAnimation( \
-        equipment->getItemProfile().textureResDir,                                                 \
-        _kCharacterStateStr[state],                                                                \
-        _characterProfile.frameInterval[state] / kPpm,                                             \
-        fallback                                                                                   \
-    );                                                                                             \
-  } while (0)
-
   Equipment::Type type = equipment->getEquipmentProfile().equipmentType;
   const string& textureResDir = equipment->getItemProfile().textureResDir;
-  
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::IDLE_SHEATHED, nullptr);
-  Animation* fallback = _equipmentAnimations[type][State::IDLE_SHEATHED];
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::IDLE_UNSHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::RUNNING_SHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::RUNNING_UNSHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::JUMPING_SHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::JUMPING_UNSHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::FALLING_SHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::FALLING_UNSHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::CROUCHING_SHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::CROUCHING_UNSHEATHED, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::SHEATHING_WEAPON, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::UNSHEATHING_WEAPON, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::ATTACKING, fallback);
-  CREATE_EQUIPMENT_ANIMATION(equipment, State::KILLED, fallback);
-
-  // Load extra attack animations.
-  for (size_t i = 0; i < _bodyExtraAttackAnimations.size(); i++) {
-    _equipmentExtraAttackAnimations[type][i] = createAnimation(
-        textureResDir,
-        "attacking" + std::to_string(1 + i),
-        _characterProfile.frameInterval[State::ATTACKING] / kPpm,
-        fallback
-    );
-  }
+  releaseEquipmentAnimations(type);
+
+  // Only the IDLE_SHEATHED animation (which is also the fallback of all the
+  // others) is loaded right away. The rest of them are loaded on demand by
+  // getEquipmentAnimation() when this character first transitions into each
+  // state, so the Npcs which never unsheath their weapons won't pay for them.
+  _cold->equipmentAnimations[type][State::IDLE_SHEATHED] = createAnimation(
+      textureResDir,
+      _kCharacterStateStr[State::IDLE_SHEATHED],
+      _cold->characterProfile.frameInterval[State::IDLE_SHEATHED] / kPpm
+  );
 
   // Select a frame as default look for this sprite.
   string framePrefix = StaticActor::getLastDirName(textureResDir);
   _equipmentSprites[type] = Sprite::createWithSpriteFrameName(framePrefix + "_idle_sheathed/0.png");
-  _equipmentSprites[type]->setScale(_characterProfile.spriteScaleX,
-                                    _characterProfile.spriteScaleY);
+  _equipmentSprites[type]->setScale(_cold->characterProfile.spriteScaleX,
+                                    _cold->characterProfile.spriteScaleY);
+  hot().isSpriteSyncDirty = true;
+}
+
+void Character::releaseEquipmentAnimations(Equipment::Type type) {
+  _equipmentAnimators[type].stop();
 
-  _equipmentSpritesheets[type] = SpriteBatchNode::create(textureResDir + "/spritesheet.png");
-  _equipmentSpritesheets[type]->getTexture()->setAliasTexParameters();
-  _equipmentSpritesheets[type]->addChild(_equipmentSprites[type]);
+  for (auto& animation : _cold->equipmentAnimations[type]) {
+    if (animation) {
+      StaticActor::releaseAnimation(animation);
+      animation = nullptr;
+    }
+  }
+  for (auto& animation : _cold->equipmentExtraAttackAnimations[type]) {
+    if (animation) {
+      StaticActor::releaseAnimation(animation);
+      animation = nullptr;
+    }
+  }
 }
 
 int Character::getExtraAttackAnimationsCount() const {
   FileUtils* fileUtils = FileUtils::getInstance();
-  const string& framesNamePrefix = StaticActor::getLastDirName(_characterProfile.textureResDir);
+  const string& framesNamePrefix = StaticActor::getLastDirName(_cold->characterProfile.textureResDir);
 
   // player_attacking0  // must have!
   // player_attacking1  // optional...
   // player_attacking2  // optional...
   // ...
-  string dir = _characterProfile.textureResDir + "/" + framesNamePrefix + "_" + "attacking";
+  string dir = _cold->characterProfile.textureResDir + "/" + framesNamePrefix + "_" + "attacking";
   int frameCount = 0;
   fileUtils->setPopupNotify(false);  // disable CCLOG
   while (fileUtils->isDirectoryExist(dir + std::to_string(frameCount + 1))) {
@@ -438,22 +596,40 @@ int Character::getExtraAttackAnimationsCount() const {
 
 Animation* Character::getBodyAttackAnimation() const {
   return (_attackAnimationIdx == 0) ? _bodyAnimations[State::ATTACKING] :
-                                      _bodyExtraAttackAnimations[_attackAnimationIdx - 1];
+                                      _cold->bodyExtraAttackAnimations[_attackAnimationIdx - 1];
+}
+
+Animation* Character::getEquipmentAnimation(const Equipment::Type type, const State state) {
+  Animation*& animation = _cold->equipmentAnimations[type][state];
+  if (!animation) {
+    animation = createAnimation(_equipmentSlots[type]->getItemProfile().textureResDir,
+                                _kCharacterStateStr[state],
+                                _cold->characterProfile.frameInterval[state] / kPpm,
+                                _cold->equipmentAnimations[type][State::IDLE_SHEATHED]);
+  }
+  return animation;
 }
 
-Animation* Character::getEquipmentAttackAnimation(const Equipment::Type type) const {
-  return (_attackAnimationIdx == 0) ? _equipmentAnimations[type][State::ATTACKING] :
-                                      _equipmentExtraAttackAnimations[type][_attackAnimationIdx - 1];
+Animation* Character::getEquipmentAttackAnimation(const Equipment::Type type) {
+  if (_attackAnimationIdx == 0) {
+    return getEquipmentAnimation(type, State::ATTACKING);
+  }
+
+  Animation*& animation = _cold->equipmentExtraAttackAnimations[type][_attackAnimationIdx - 1];
+  if (!animation) {
+    animation = createAnimation(_equipmentSlots[type]->getItemProfile().textureResDir,
+                                "attacking" + std::to_string(_attackAnimationIdx),
+                                _cold->characterProfile.frameInterval[State::ATTACKING] / kPpm,
+                                _cold->equipmentAnimations[type][State::IDLE_SHEATHED]);
+  }
+  return animation;
 }
 
 
 void Character::runAnimation(State state, bool loop) {
   // Update body animation.
-  Animate* animate = Animate::create((state != State::ATTACKING) ? _bodyAnimations[state] :
-                                                                   getBodyAttackAnimation());
-  _bodySprite->stopAllActions();
-  _bodySprite->runAction((loop) ? dynamic_cast<Action*>(RepeatForever::create(animate)) :
-                                  dynamic_cast<Action*>(Repeat::create(animate, 1)));
+  Animation* bodyAnimation = (state != State::ATTACKING) ? _bodyAnimations[state] : getBodyAttackAnimation();
+  _bodyAnimator.play(_bodySprite, bodyAnimation, loop, nullptr, getEventTrack(state, bodyAnimation), this);
 
   // Update equipment animation.
   for (int type = 0; type < static_cast<int>(Equipment::Type::SIZE); type++) {
@@ -461,13 +637,11 @@ void Character::runAnimation(State state, bool loop) {
       continue;
     }
 
-    Animate* animate = Animate::create((state != State::ATTACKING) ?
-        _equipmentAnimations[type][state] :
-        getEquipmentAttackAnimation(static_cast<Equipment::Type>(type)));
-
-    _equipmentSprites[type]->stopAllActions();
-    _equipmentSprites[type]->runAction((loop) ? dynamic_cast<Action*>(RepeatForever::create(animate)) :
-                                                dynamic_cast<Action*>(Repeat::create(animate, 1)));
+    _equipmentAnimators[type].play(_equipmentSprites[type],
+                                   (state != State::ATTACKING) ?
+                                     getEquipmentAnimation(static_cast<Equipment::Type>(type), state) :
+                                     getEquipmentAttackAnimation(static_cast<Equipment::Type>(type)),
+                                   loop);
   }
 
   // If `state` is ATTACKING, then increment `_attackAnimationIdx` 
@@ -477,40 +651,36 @@ void Character::runAnimation(State state, bool loop) {
   }
 }
 
-void Character::runAnimation(State state, const function<void ()>& func) const {
-  auto animate = Animate::create(_bodyAnimations[state]);
-  auto callback = CallFunc::create(func);
-  _bodySprite->stopAllActions();
-  _bodySprite->runAction(Sequence::createWithTwoActions(animate, callback));
+void Character::runAnimation(State state, const function<void ()>& func) {
+  _bodyAnimator.play(_bodySprite, _bodyAnimations[state], /*loop=*/false, func,
+                     getEventTrack(state, _bodyAnimations[state]), this);
 
   // Update equipment animation.
   for (int type = 0; type < static_cast<int>(Equipment::Type::SIZE); type++) {
     if (!_equipmentSlots[type]) {
       continue;
     }
-
-    Animate* animate = Animate::create(_equipmentAnimations[type][state]);
-    Action* action = Repeat::create(animate, 1);
-    _equipmentSprites[type]->stopAllActions();
-    _equipmentSprites[type]->runAction(action);
+    _equipmentAnimators[type].play(_equipmentSprites[type],
+                                   getEquipmentAnimation(static_cast<Equipment::Type>(type), state),
+                                   /*loop=*/false);
   }
 }
 
-void Character::runAnimation(const string& framesName, float interval) {
+void Character::runAnimation(const string& framesName, float interval,
+                             const FrameAnimator::EventTrack& eventTrack) {
   // Try to load the target framesName under this character's textureResDir.
   Animation* bodyAnimation = nullptr;
   
-  if (_skillBodyAnimations.find(framesName) != _skillBodyAnimations.end()) {
-    bodyAnimation = _skillBodyAnimations[framesName];
+  if (_cold->skillBodyAnimations.find(framesName) != _cold->skillBodyAnimations.end()) {
+    bodyAnimation = _cold->skillBodyAnimations[framesName];
   } else {
     Animation* fallback = _bodyAnimations[State::ATTACKING];
-    bodyAnimation = createAnimation(_characterProfile.textureResDir, framesName, interval, fallback);
+    bodyAnimation = createAnimation(_cold->characterProfile.textureResDir, framesName, interval, fallback);
     // Cache this skill animation (body).
-    _skillBodyAnimations.insert({framesName, bodyAnimation});
+    _cold->skillBodyAnimations.insert({framesName, bodyAnimation});
   }
 
-  _bodySprite->stopAllActions();
-  _bodySprite->runAction(Repeat::create(Animate::create(bodyAnimation), 1));
+  _bodyAnimator.play(_bodySprite, bodyAnimation, /*loop=*/false, nullptr, eventTrack, this);
 
   // Update equipment animation.
   for (int type = 0; type < static_cast<int>(Equipment::Type::SIZE); type++) {
@@ -519,71 +689,96 @@ void Character::runAnimation(const string& framesName, float interval) {
     }
 
     const string& textureResDir = _equipmentSlots[type]->getItemProfile().textureResDir;
-    Animation* fallback = _equipmentAnimations[type][ATTACKING];
+    Animation* fallback = getEquipmentAnimation(static_cast<Equipment::Type>(type), State::ATTACKING);
 
-    // TODO: cache these equipment skill animation
+    // The animator retains the animation, so it can be released right away
+    // (the animation stays in AnimationCache until it's evicted).
     Animation* animation = createAnimation(textureResDir, framesName, interval, fallback);
-    _equipmentSprites[type]->stopAllActions();
-    _equipmentSprites[type]->runAction(Animate::create(animation));
+    _equipmentAnimators[type].play(_equipmentSprites[type], animation, /*loop=*/false);
+    StaticActor::releaseAnimation(animation);
   }
 }
 
+FrameAnimator::EventTrack Character::getEventTrack(State state, const Animation* animation) const {
+  FrameAnimator::EventTrack eventTrack = _cold->characterProfile.frameEvents[state];
+
+  // Without a HIT frame, the player's attacks land at once, and
+  // the others' attacks land after a little delay.
+  if (state == State::ATTACKING && eventTrack[FrameAnimator::Event::HIT] < 0) {
+    const float delay = animation->getDelayPerUnit();
+    eventTrack[FrameAnimator::Event::HIT] = (dynamic_cast<const Player*>(this) || delay <= 0) ?
+        0 : static_cast<int>(DEFAULT_NPC_HIT_DELAY / delay);
+  }
+  return eventTrack;
+}
+
 
 // FIXME: Maybe clean up this method...
 Character::State Character::getState() const {
-  if (_isSetToKill) {
+  static_assert(State::IDLE_UNSHEATHED == State::IDLE_SHEATHED + 1 &&
+                State::RUNNING_UNSHEATHED == State::RUNNING_SHEATHED + 1 &&
+                State::JUMPING_UNSHEATHED == State::JUMPING_SHEATHED + 1 &&
+                State::FALLING_UNSHEATHED == State::FALLING_SHEATHED + 1 &&
+                State::CROUCHING_UNSHEATHED == State::CROUCHING_SHEATHED + 1,
+                "each *_UNSHEATHED state must follow its *_SHEATHED counterpart");
+
+  if (hot().isSetToKill) {
     return State::KILLED;
-  } else if (_isAttacking) {
+  } else if (hot().isAttacking) {
     return State::ATTACKING;
-  } else if (_isSheathingWeapon) {
+  } else if (hot().isSheathingWeapon) {
     return State::SHEATHING_WEAPON;
-  } else if (_isUnsheathingWeapon) {
+  } else if (hot().isUnsheathingWeapon) {
     return State::UNSHEATHING_WEAPON;
-  } else if (_isJumping) {
-    return (_isWeaponSheathed) ? State::JUMPING_SHEATHED : State::JUMPING_UNSHEATHED;
-  } else if (_body->GetLinearVelocity().y < -2.0f && !_isTakingDamage) {
-    return (_isWeaponSheathed) ? State::FALLING_SHEATHED : State::FALLING_UNSHEATHED;
-  } else if (_isCrouching) {
-    return (_isWeaponSheathed) ? State::CROUCHING_SHEATHED : State::CROUCHING_UNSHEATHED;
-  } else if (std::abs(_body->GetLinearVelocity().x) > .01f && !_isTakingDamage) {
-    return (_isWeaponSheathed) ? State::RUNNING_SHEATHED : State::RUNNING_UNSHEATHED;
-  // This one makes platform jumping animation smoother...
-  // but the code looks more ugly :(
-  } else if (std::abs(_body->GetLinearVelocity().y) > .01f && !_isTakingDamage) {
-    return (_isWeaponSheathed) ? State::IDLE_SHEATHED : State::IDLE_UNSHEATHED;
+  }
+
+  // The remaining states come in pairs, and the weapon
+  // sheathed/unsheathed flag picks one from each pair.
+  const b2Vec2& velocity = _body->GetLinearVelocity();
+  State state;
+  if (hot().isJumping) {
+    state = State::JUMPING_SHEATHED;
+  } else if (velocity.y < -2.0f && !hot().isTakingDamage) {
+    state = State::FALLING_SHEATHED;
+  } else if (hot().isCrouching) {
+    state = State::CROUCHING_SHEATHED;
+  } else if (std::abs(velocity.x) > .01f && !hot().isTakingDamage) {
+    state = State::RUNNING_SHEATHED;
   } else {
-    return (_isWeaponSheathed) ? State::IDLE_SHEATHED : State::IDLE_UNSHEATHED;
+    state = State::IDLE_SHEATHED;
   }
+  return static_cast<State>(state + !hot().isWeaponSheathed);
 }
 
 
 void Character::onKilled() {
-  _isKilled = true;
+  hot().isKilled = true;
+  StatsSystem::getInstance()->setRegenEnabled(_statsIndex, false);
   GameMapManager::getInstance()->getWorld()->DestroyBody(_body);
 }
 
 
 void Character::moveLeft() {
-  _isFacingRight = false;
+  hot().isFacingRight = false;
 
-  if (_isCrouching) {
+  if (hot().isCrouching) {
     return;
   }
 
-  if (_body->GetLinearVelocity().x >= -_characterProfile.moveSpeed * 2) {
-    _body->ApplyLinearImpulse({-_characterProfile.moveSpeed, 0}, _body->GetWorldCenter(), true);
+  if (_body->GetLinearVelocity().x >= -_cold->derivedStats.moveSpeed * 2) {
+    _body->ApplyLinearImpulse({-_cold->derivedStats.moveSpeed, 0}, _body->GetWorldCenter(), true);
   }
 }
 
 void Character::moveRight() {
-  _isFacingRight = true;
+  hot().isFacingRight = true;
 
-  if (_isCrouching) {
+  if (hot().isCrouching) {
     return;
   }
 
-  if (_body->GetLinearVelocity().x <= _characterProfile.moveSpeed * 2) {
-    _body->ApplyLinearImpulse({_characterProfile.moveSpeed, 0}, _body->GetWorldCenter(), true);
+  if (_body->GetLinearVelocity().x <= _cold->derivedStats.moveSpeed * 2) {
+    _body->ApplyLinearImpulse({_cold->derivedStats.moveSpeed, 0}, _body->GetWorldCenter(), true);
   }
 }
 
@@ -592,73 +787,87 @@ void Character::jump() {
   // 1. This character's timer-based jump lock has not expired yet.
   // 2. This character cannot double jump, and it has already jumped.
   // 3. This character can double jump, and it has already double jumped.
-  if (_isJumpingDisallowed ||
-      (!_characterProfile.canDoubleJump && _isJumping) ||
-      (_characterProfile.canDoubleJump && _isDoubleJumping)) {
+  if (hot().isJumpingDisallowed ||
+      (!_cold->characterProfile.canDoubleJump && hot().isJumping) ||
+      (_cold->characterProfile.canDoubleJump && hot().isDoubleJumping)) {
     return;
   }
 
-  if (_isJumping) {
-    _isDoubleJumping = true;
-    runAnimation((_isWeaponSheathed) ? State::JUMPING_SHEATHED : State::JUMPING_UNSHEATHED, false);
+  if (hot().isJumping) {
+    hot().isDoubleJumping = true;
+    runAnimation((hot().isWeaponSheathed) ? State::JUMPING_SHEATHED : State::JUMPING_UNSHEATHED, false);
     // Set velocity.y to 0.
     const b2Vec2& velocity = _body->GetLinearVelocity();
     _body->SetLinearVelocity({velocity.x, 0});
   } 
 
-  _isJumpingDisallowed = true;
-  CallbackManager::getInstance()->runAfter([this]() {
-      _isJumpingDisallowed = false;
+  hot().isJumpingDisallowed = true;
+  runAfter([this]() {
+      hot().isJumpingDisallowed = false;
   }, .2f);
 
-  _isJumping = true;
-  _body->ApplyLinearImpulse({0, _characterProfile.jumpHeight}, _body->GetWorldCenter(), true);
+  hot().isJumping = true;
+  _body->ApplyLinearImpulse({0, _cold->derivedStats.jumpHeight}, _body->GetWorldCenter(), true);
 }
 
 void Character::doubleJump() {
   jump();
 
-  CallbackManager::getInstance()->runAfter([this]() {
+  runAfter([this]() {
     jump();
   }, .25f);
 }
 
 void Character::jumpDown() {
-  if (!_isOnPlatform) {
+  if (!hot().isOnPlatform) {
     return;
   }
 
-  _fixtures[FixtureType::FEET]->SetSensor(true);
+  // The platforms (rather than everything, as the feet would if they were
+  // a sensor) are passed through for a while, including the one which this
+  // character is standing on. See WorldContactListener::isPassingThrough().
+  hot().isJumpingDown = true;
+
+  WorldContactListener* worldContactListener = GameMapManager::getInstance()->getWorldContactListener();
+  for (b2ContactEdge* edge = _body->GetContactList(); edge; edge = edge->next) {
+    b2Contact* contact = edge->contact;
+    const bool isFeetContact = contact->GetFixtureA() == _fixtures[FixtureType::FEET] ||
+                               contact->GetFixtureB() == _fixtures[FixtureType::FEET];
+    if (isFeetContact && (contact->GetFixtureA()->GetFilterData().categoryBits == category_bits::kPlatform ||
+                          contact->GetFixtureB()->GetFilterData().categoryBits == category_bits::kPlatform)) {
+      worldContactListener->setPassingThrough(contact);
+    }
+  }
 
-  CallbackManager::getInstance()->runAfter([this]() {
-    _fixtures[FixtureType::FEET]->SetSensor(false);
+  runAfter([this]() {
+    hot().isJumpingDown = false;
   }, .25f);
 }
 
 void Character::crouch() {
-  _isCrouching = true;
+  hot().isCrouching = true;
 }
 
 void Character::getUp() {
-  _isCrouching = false;
+  hot().isCrouching = false;
 }
 
 
 void Character::sheathWeapon() {
-  _isSheathingWeapon = true;
+  hot().isSheathingWeapon = true;
 
-  CallbackManager::getInstance()->runAfter([this]() {
-    _isSheathingWeapon = false;
-    _isWeaponSheathed = true;
+  runAfter([this]() {
+    hot().isSheathingWeapon = false;
+    hot().isWeaponSheathed = true;
   }, .8f);
 }
 
 void Character::unsheathWeapon() {
-  _isUnsheathingWeapon = true;
+  hot().isUnsheathingWeapon = true;
 
-  CallbackManager::getInstance()->runAfter([this]() {
-    _isUnsheathingWeapon = false;
-    _isWeaponSheathed = false;
+  runAfter([this]() {
+    hot().isUnsheathingWeapon = false;
+    hot().isWeaponSheathed = false;
   }, .8f);
 }
 
@@ -666,68 +875,128 @@ void Character::attack() {
   // If character is still attacking, block this attack request.
   // The latter condition prevents the character from being stucked in an
   // attack animation when the user calls Character::attack() too frequently.
-  if (_isAttacking || _currentState == State::ATTACKING) {
+  if (hot().isAttacking || hot().currentState == State::ATTACKING) {
     return;
   }
-  if (_isWeaponSheathed) {
+  if (hot().isWeaponSheathed) {
     unsheathWeapon();
     return;
   }
 
-  _isAttacking = true;
+  hot().isAttacking = true;
+  hot().isHitPending = false;
+
+  runAfter([this]() {
+    hot().isAttacking = false;
+  }, _cold->characterProfile.attackTime);
 
-  CallbackManager::getInstance()->runAfter([this]() {
-    _isAttacking = false;
-  }, _characterProfile.attackTime);
 
+  vector<Character*> inRangeTargets;
+  queryInRangeTargets(inRangeTargets);
 
-  if (!_inRangeTargets.empty()) {
-    _lockedOnTarget = *_inRangeTargets.begin();
+  if (!inRangeTargets.empty()) {
+    if (std::find(inRangeTargets.begin(), inRangeTargets.end(), _lockedOnTarget) == inRangeTargets.end()) {
+      _lockedOnTarget = inRangeTargets.front();
+    }
 
     if (!_lockedOnTarget->isInvincible()) {
-      // If this character is not the Player,
-      // then add a little delay before inflicting damage / knockback.
-      float damageDelay = (dynamic_cast<Player*>(this)) ? 0 : .25f;
-
-      CallbackManager::getInstance()->runAfter([this]() {
-          inflictDamage(_lockedOnTarget, getDamageOutput());
-          float knockBackForceX = (_isFacingRight) ? .5f : -.5f; // temporary
-          float knockBackForceY = 1.0f; // temporary
-          knockBack(_lockedOnTarget, knockBackForceX, knockBackForceY);
-      }, damageDelay);
+      // The hit lands at the HIT event of the attack animation (see onFrameEvent()).
+      // Off screen, the attack animation won't be played (see update()),
+      // so the hit lands at once.
+      if (hot().isInView) {
+        hot().isHitPending = true;
+      } else {
+        landHit();
+      }
     }
   }
 }
 
+void Character::landHit() {
+  // The hit only lands if the target is still within the hitbox
+  // when the attack's active frame comes.
+  if (!_lockedOnTarget || !isInAttackRange(_lockedOnTarget)) {
+    return;
+  }
+  inflictDamage(_lockedOnTarget, getDamageOutput());
+  float knockBackForceX = (hot().isFacingRight) ? .5f : -.5f; // temporary
+  float knockBackForceY = 1.0f; // temporary
+  knockBack(_lockedOnTarget, knockBackForceX, knockBackForceY);
+}
+
 void Character::activateSkill(Skill* skill) {
   // If this character is still using another skill, or
   // if it doesn't meet the criteria of activating this skill,
   // then return at once.
-  if (_isUsingSkill || !skill->canActivate()) {
+  if (hot().isUsingSkill || !isSkillReady(skill) || !skill->canActivate()) {
     return;
   }
 
-  _isUsingSkill = true;
+  hot().isUsingSkill = true;
   _currentlyUsedSkill = skill;
 
-  CallbackManager::getInstance()->runAfter([this]() {
-    _isUsingSkill = false;
-    // Set _currentState to FORCE_UPDATE so that next time in
-    // Character::update the animation is guaranteed to be updated.
-    _currentState = State::FORCE_UPDATE;
-  }, skill->getSkillProfile().framesDuration);
+  auto it = _skillCooldowns.find(skill->getName());
+  if (it != _skillCooldowns.end()) {
+    CooldownSystem::getInstance()->trigger(it->second);
+  }
 
-  if (skill->getSkillProfile().characterFramesName != "") {
-    Skill::Profile& skillProfile = skill->getSkillProfile();
-    runAnimation(skillProfile.characterFramesName, skillProfile.frameInterval / kPpm);
+  if (_body) {
+    AudioManager::getInstance()->playSfx(skill->getSkillProfile().sfx,
+                                         AudioManager::Category::SPELL, _body->GetPosition());
+
+    // Nobody would see the particles of the skills used off screen.
+    const b2Vec2& bodyPos = _body->GetPosition();
+    const ParticleSystem::Emitter& particles = skill->getSkillProfile().particles;
+    if (particles.count > 0 && CameraSystem::getInstance()->isInView(bodyPos, SKILL_PARTICLES_VIEW_MARGIN)) {
+      GameMapManager::getInstance()->getParticleSystem()->emit(
+          particles, skill->getSkillProfile().textureResDir,
+          bodyPos.x * kPpm, bodyPos.y * kPpm, hot().isFacingRight);
+    }
   }
 
-  // Create an extra copy of this skill object and activate it.
-  shared_ptr<Skill> copiedSkill(Skill::create(skill->getSkillProfile().jsonFileName, this));
+  // The skill ends at the END event of this character's skill animation
+  // (see onFrameEvent()), or after framesDuration if it doesn't have one.
+  const Skill::Profile& skillProfile = skill->getSkillProfile();
+  if (skillProfile.characterFramesName != "") {
+    runAnimation(skillProfile.characterFramesName, skillProfile.frameInterval / kPpm,
+                 skillProfile.frameEvents);
+  } else {
+    runAfter([this]() {
+      endSkill();
+    }, skillProfile.framesDuration);
+  }
+
+  // Activate an extra copy of this skill object.
+  shared_ptr<Skill> copiedSkill = acquireSkillInstance(skill);
   _activeSkills.insert(copiedSkill);
   copiedSkill->activate();
   
-  Hud::getInstance()->updateStatusBars();
+  EventBus::getInstance()->post(StatChangedEvent{this});
+}
+
+void Character::endSkill() {
+  hot().isUsingSkill = false;
+  // Set the current state to FORCE_UPDATE so that next time in
+  // Character::update the animation is guaranteed to be updated.
+  hot().currentState = State::FORCE_UPDATE;
+}
+
+void Character::onFrameEvent(FrameAnimator::Event event) {
+  switch (event) {
+    case FrameAnimator::Event::HIT:
+      if (hot().isHitPending) {
+        hot().isHitPending = false;
+        landHit();
+      }
+      break;
+    case FrameAnimator::Event::END:
+      if (hot().isUsingSkill) {
+        endSkill();
+      }
+      break;
+    default:
+      break;
+  }
 }
 
 void Character::knockBack(Character* target, float forceX, float forceY) const {
@@ -736,48 +1005,36 @@ void Character::knockBack(Character* target, float forceX, float forceY) const {
 }
 
 void Character::inflictDamage(Character* target, int damage) {
-  target->receiveDamage(this, damage);
-  target->lockOn(this);
-
-  for (const auto& ally : this->getAllies()) {
-    ally->lockOn(target);
-  }
-  for (const auto& targetAlly : target->getAllies()) {
-    targetAlly->lockOn(this);
-  }
+  CombatSystem::getInstance()->enqueueHit(this, target, damage);
 }
 
 void Character::receiveDamage(Character* source, int damage) {
-  if (_isInvincible) {
+  if (hot().isInvincible) {
     return;
   }
 
-  _characterProfile.health -= damage;
+  modifyStat(StatsSystem::Stat::HEALTH, -damage);
 
-  _isTakingDamage = true;
-  CallbackManager::getInstance()->runAfter([this]() {
-    _isTakingDamage = false;
+  hot().isTakingDamage = true;
+  runAfter([this]() {
+    hot().isTakingDamage = false;
   }, .25f);
   
-  if (_characterProfile.health <= 0) {
-    _characterProfile.health = 0;
-
-    source->getInRangeTargets().erase(this);
+  if (getStat(StatsSystem::Stat::HEALTH) == 0) {
     for (const auto& sourceAlly : source->getAllies()) {
-      sourceAlly->getInRangeTargets().erase(this);
       if (sourceAlly->getLockedOnTarget() == this) {
         sourceAlly->setLockedOnTarget(nullptr);
       }
     }
 
     DynamicActor::setCategoryBits(_fixtures[FixtureType::BODY], category_bits::kDestroyed);
-    _isSetToKill = true;
-    // TODO: play killed sound.
+    hot().isSetToKill = true;
+    AudioManager::getInstance()->playSfx(_cold->characterProfile.killedSfx,
+                                         AudioManager::Category::HIT, _body->GetPosition());
   } else {
-    // TODO: play hurt sound.
+    AudioManager::getInstance()->playSfx(_cold->characterProfile.hurtSfx,
+                                         AudioManager::Category::HIT, _body->GetPosition());
   }
-
-  FloatingDamages::getInstance()->show(this, damage);
 }
 
 void Character::lockOn(Character* target) {
@@ -792,19 +1049,18 @@ void Character::addItem(shared_ptr<Item> item, int amount) {
     return;
   }
 
-  // If this Item* does not exist in Inventory or EquipmentSlots yet, store it in _itemMapper.
-  // Otherwise, simply delete it and use the existing copy instead (saves memory).
-  Item* existingItemObj = getExistingItemObj(item.get());
+  Item* existingItemObj = storeItem(std::move(item), amount);
+  onItemAmountChanged(existingItemObj->getItemProfile().nameId, amount);
 
-  if (existingItemObj) {
-    existingItemObj->setAmount(existingItemObj->getAmount() + amount);
-  } else {
-    existingItemObj = item.get();
-    existingItemObj->setAmount(amount);
-    _itemMapper[item->getItemProfile().name] = std::move(item);
+  // If its previous amount was zero, it is not in the inventory yet.
+  if (existingItemObj->getAmount() == amount) {
+    auto& items = _cold->inventory[existingItemObj->getItemProfile().itemType];
+    items.insert(std::upper_bound(items.begin(), items.end(), existingItemObj, compareItemNameIds),
+                 existingItemObj);
   }
 
-  _inventory[existingItemObj->getItemProfile().itemType].insert(existingItemObj);
+  _inventoryRevision++;
+  EventBus::getInstance()->post(ItemChangedEvent{this});
 }
 
 void Character::removeItem(Item* item, int amount) {
@@ -815,46 +1071,168 @@ void Character::removeItem(Item* item, int amount) {
     return;
   }
 
-  existingItemObj->setAmount(existingItemObj->getAmount() - amount);
+  const int originalAmount = existingItemObj->getAmount();
+  existingItemObj->setAmount(std::max(0, originalAmount - amount));
+  onItemAmountChanged(existingItemObj->getItemProfile().nameId,
+                      existingItemObj->getAmount() - originalAmount);
 
-  if (existingItemObj->getAmount() <= 0) {
-    _inventory[item->getItemProfile().itemType].erase(existingItemObj);
+  if (existingItemObj->getAmount() == 0) {
+    auto& items = _cold->inventory[existingItemObj->getItemProfile().itemType];
+    auto it = std::lower_bound(items.begin(), items.end(), existingItemObj, compareItemNameIds);
+    if (it != items.end() && *it == existingItemObj) {
+      items.erase(it);
+    }
+    releaseItem(existingItemObj);
+  }
 
-    // We can safely delete this Item* if:
-    // 1. It is not an equipment, or...
-    // 2. It is an equipment, but no same item is currently equipped.
-    Equipment* equipment = dynamic_cast<Equipment*>(existingItemObj);
+  _inventoryRevision++;
+  EventBus::getInstance()->post(ItemChangedEvent{this});
+}
 
-    if (!equipment ||
-        _equipmentSlots[equipment->getEquipmentProfile().equipmentType] != existingItemObj) {
-      _itemMapper.erase(item->getItemProfile().name);
+void Character::addItems(const vector<pair<shared_ptr<Item>, int>>& items) {
+  array<size_t, Item::Type::SIZE> originalSizes;
+  for (int i = 0; i < Item::Type::SIZE; i++) {
+    originalSizes[i] = _cold->inventory[i].size();
+  }
+
+  // Append the new items to the end of each list first,
+  // and then merge them into the sorted part of the list.
+  for (const auto& p : items) {
+    if (!p.first || p.second == 0) {
+      VGLOG(LOG_WARN, "Either item == nullptr or amount == 0");
+      continue;
+    }
+    Item* existingItemObj = storeItem(p.first, p.second);
+    onItemAmountChanged(existingItemObj->getItemProfile().nameId, p.second);
+    if (existingItemObj->getAmount() == p.second) {
+      _cold->inventory[existingItemObj->getItemProfile().itemType].push_back(existingItemObj);
     }
   }
+
+  for (int i = 0; i < Item::Type::SIZE; i++) {
+    auto& inventoryItems = _cold->inventory[i];
+    if (inventoryItems.size() == originalSizes[i]) {
+      continue;
+    }
+    auto middle = inventoryItems.begin() + originalSizes[i];
+    std::sort(middle, inventoryItems.end(), compareItemNameIds);
+    std::inplace_merge(inventoryItems.begin(), middle, inventoryItems.end(), compareItemNameIds);
+  }
+
+  _inventoryRevision++;
+  EventBus::getInstance()->post(ItemChangedEvent{this});
+}
+
+void Character::removeItems(const vector<pair<Item*, int>>& items) {
+  array<bool, Item::Type::SIZE> hasDepletedItems{};
+  FrameVector<Item*> depletedItems;  // see FrameArena
+
+  for (const auto& p : items) {
+    Item* existingItemObj = getExistingItemObj(p.first);
+    if (!existingItemObj || p.second == 0) {
+      VGLOG(LOG_WARN, "Unable to remove such item!");
+      continue;
+    }
+    if (existingItemObj->getAmount() == 0) {
+      continue;
+    }
+    const int originalAmount = existingItemObj->getAmount();
+    existingItemObj->setAmount(std::max(0, originalAmount - p.second));
+    onItemAmountChanged(existingItemObj->getItemProfile().nameId,
+                        existingItemObj->getAmount() - originalAmount);
+    if (existingItemObj->getAmount() == 0) {
+      hasDepletedItems[existingItemObj->getItemProfile().itemType] = true;
+      depletedItems.push_back(existingItemObj);
+    }
+  }
+
+  // Compact each affected list in a single pass, which keeps it sorted.
+  for (int i = 0; i < Item::Type::SIZE; i++) {
+    if (!hasDepletedItems[i]) {
+      continue;
+    }
+    auto& inventoryItems = _cold->inventory[i];
+    inventoryItems.erase(std::remove_if(inventoryItems.begin(), inventoryItems.end(), [](const Item* item) {
+      return item->getAmount() == 0;
+    }), inventoryItems.end());
+  }
+
+  for (auto item : depletedItems) {
+    releaseItem(item);
+  }
+
+  _inventoryRevision++;
+  EventBus::getInstance()->post(ItemChangedEvent{this});
 }
 
 // For each instance of an item, at most one copy is kept in the memory.
-// This copy will be stored in _itemMapper (unordered_map<string, Item*>)
-// Search time complexity: avg O(1), worst O(n).
+// This copy will be stored in ColdData::itemMapper (vector<shared_ptr<Item>>),
+// which is indexed by the item's name id, so the search time complexity is O(1).
 Item* Character::getExistingItemObj(Item* item) const {
   if (!item) {
     return nullptr;
   }
-  auto it = _itemMapper.find(item->getItemProfile().name);
-  return (it != _itemMapper.end()) ? it->second.get() : nullptr;
+  return getExistingItemObj(item->getItemProfile().nameId);
 }
 
-void Character::useItem(Consumable* consumable) {
-  auto& profile = _characterProfile;
-  const auto& consumableProfile = consumable->getConsumableProfile();
+Item* Character::getExistingItemObj(AssetId itemNameId) const {
+  if (!itemNameId.isValid() || itemNameId.getValue() >= _cold->itemMapper.size()) {
+    return nullptr;
+  }
+  return _cold->itemMapper[itemNameId.getValue()].get();
+}
 
-  profile.health += consumableProfile.restoreHealth;
-  if (profile.health > profile.fullHealth) profile.health = profile.fullHealth;
+// If this Item* does not exist in Inventory or EquipmentSlots yet, store it in ColdData::itemMapper.
+// Otherwise, simply delete it and use the existing copy instead (saves memory).
+// Returns the existing copy, whose amount has been increased by `amount`.
+Item* Character::storeItem(shared_ptr<Item> item, int amount) {
+  Item* existingItemObj = getExistingItemObj(item.get());
 
-  profile.magicka += consumableProfile.restoreMagicka;
-  if (profile.magicka > profile.fullMagicka) profile.magicka = profile.fullMagicka;
+  if (existingItemObj) {
+    existingItemObj->setAmount(existingItemObj->getAmount() + amount);
+    return existingItemObj;
+  }
 
-  profile.stamina += consumableProfile.restoreStamina;
-  if (profile.stamina > profile.fullStamina) profile.stamina = profile.fullStamina;
+  const uint32_t index = item->getItemProfile().nameId.getValue();
+  if (index >= _cold->itemMapper.size()) {
+    _cold->itemMapper.resize(index + 1);
+  }
+  existingItemObj = item.get();
+  existingItemObj->setAmount(amount);
+  _cold->itemMapper[index] = std::move(item);
+  return existingItemObj;
+}
+
+void Character::addDefaultItems() {
+  vector<pair<shared_ptr<Item>, int>> defaultItems;
+  defaultItems.reserve(_cold->characterProfile.defaultInventory.size());
+  for (const auto& p : _cold->characterProfile.defaultInventory) {
+    defaultItems.push_back({Item::create(p.first), p.second});
+  }
+  addItems(defaultItems);
+}
+
+// We can safely delete an Item* which is no longer in the inventory if:
+// 1. It is not an equipment, or...
+// 2. It is an equipment, but no same item is currently equipped.
+void Character::releaseItem(Item* existingItemObj) {
+  Equipment* equipment = dynamic_cast<Equipment*>(existingItemObj);
+
+  if (!equipment ||
+      _equipmentSlots[equipment->getEquipmentProfile().equipmentType] != existingItemObj) {
+    _cold->itemMapper[existingItemObj->getItemProfile().nameId.getValue()].reset();
+  }
+}
+
+void Character::onItemAmountChanged(AssetId, int) {}
+
+void Character::useItem(Consumable* consumable) {
+  auto& profile = _cold->characterProfile;
+  const auto& consumableProfile = consumable->getConsumableProfile();
+
+  modifyStat(StatsSystem::Stat::HEALTH, consumableProfile.restoreHealth);
+  modifyStat(StatsSystem::Stat::MAGICKA, consumableProfile.restoreMagicka);
+  modifyStat(StatsSystem::Stat::STAMINA, consumableProfile.restoreStamina);
 
   profile.baseMeleeDamage += consumableProfile.bonusPhysicalDamage;
   //profile.baseMagicalDamage += consumableProfile.bonusMagicalDamage;
@@ -865,8 +1243,9 @@ void Character::useItem(Consumable* consumable) {
 
   profile.moveSpeed += consumableProfile.bonusMoveSpeed;
   profile.jumpHeight += consumableProfile.bonusJumpHeight;
+  updateDerivedStats();
 
-  Hud::getInstance()->updateStatusBars();
+  EventBus::getInstance()->post(StatChangedEvent{this});
   removeItem(consumable, 1);
 }
 
@@ -881,7 +1260,31 @@ void Character::equip(Equipment* equipment) {
 
   // Load equipment animations.
   loadEquipmentAnimations(equipment);
-  GameMapManager::getInstance()->getLayer()->addChild(_equipmentSpritesheets[type], graphical_layers::kEquipment - type);
+  addEquipmentSpriteToMap(type);
+  updateDerivedStats();
+
+  EventBus::getInstance()->post(ItemChangedEvent{this});
+}
+
+void Character::preloadEquipmentAnimations(const Equipment* equipment) const {
+  const Equipment::Type type = equipment->getEquipmentProfile().equipmentType;
+  const string textureResDir = equipment->getItemProfile().textureResDir;
+  const vector<float> frameInterval = _cold->characterProfile.frameInterval;
+  const size_t numExtraAttackAnimations = _cold->equipmentExtraAttackAnimations[type].size();
+
+  // The intervals are copied, since this character may be gone by the time
+  // the spritesheets are loaded. The animations are keyed by them as well,
+  // so each character preloads the animations it'll actually acquire.
+  TextureResidency::getInstance()->prefetch(textureResDir, [=]() {
+    AnimationCache* animationCache = AnimationCache::getInstance();
+    for (int state = 0; state < State::STATE_SIZE; state++) {
+      animationCache->preload(textureResDir, _kCharacterStateStr[state], frameInterval[state] / kPpm);
+    }
+    for (size_t i = 0; i < numExtraAttackAnimations; i++) {
+      animationCache->preload(textureResDir, "attacking" + std::to_string(1 + i),
+                              frameInterval[State::ATTACKING] / kPpm);
+    }
+  });
 }
 
 void Character::unequip(Equipment::Type equipmentType) {
@@ -897,12 +1300,22 @@ void Character::unequip(Equipment::Type equipmentType) {
 
   Equipment* e = _equipmentSlots[equipmentType];
   _equipmentSlots[equipmentType] = nullptr;
-  addItem(_itemMapper.find(e->getItemProfile().name)->second, 1);
-  GameMapManager::getInstance()->getLayer()->removeChild(_equipmentSpritesheets[equipmentType]);
+  addItem(_cold->itemMapper[e->getItemProfile().nameId.getValue()], 1);
+  _equipmentSprites[equipmentType]->removeFromParent();
+  _equipmentSprites[equipmentType] = nullptr;
+  releaseEquipmentAnimations(equipmentType);
+  updateDerivedStats();
+
+  EventBus::getInstance()->post(ItemChangedEvent{this});
 }
 
 void Character::pickupItem(Item* item) {
   shared_ptr<Item> i = GameMapManager::getInstance()->getGameMap()->removeDynamicActor<Item>(item); 
+
+  if (auto lootBag = dynamic_cast<LootBag*>(i.get())) {
+    addItems(lootBag->getContents());
+    return;
+  }
   addItem(std::move(i), item->getAmount());
 }
 
@@ -920,46 +1333,58 @@ void Character::interact(Interactable* target) {
 }
 
 void Character::addExp(const int exp) {
-  int& thisExp = _characterProfile.exp;
-  int& thisLevel = _characterProfile.level;
+  int& thisExp = _cold->characterProfile.exp;
+  int& thisLevel = _cold->characterProfile.level;
 
+  const int previousLevel = thisLevel;
   thisExp += exp;
   while (thisExp >= exp_point_table::getNextLevelExp(thisLevel)) {
     thisExp -= exp_point_table::getNextLevelExp(thisLevel);
     thisLevel++;
   }
+
+  if (thisLevel != previousLevel) {
+    updateDerivedStats();
+  }
 }
 
 
 void Character::addSkill(unique_ptr<Skill> skill) {
   assert(skill != nullptr);
 
-  auto it = _skillMapper.find(skill->getName());
-  if (it != _skillMapper.end()) {
+  auto it = _cold->skillMapper.find(skill->getName());
+  if (it != _cold->skillMapper.end()) {
     VGLOG(LOG_WARN, "This character has already learned the skill: %s", skill->getName().c_str());
     return;
   }
 
-  _skillBook[skill->getSkillProfile().skillType].insert(skill.get());
-  _skillMapper.insert({skill->getName(), std::move(skill)});
+  AudioManager::getInstance()->preload(skill->getSkillProfile().sfx);
+  _cold->skillBook[skill->getSkillProfile().skillType].insert(skill.get());
+  _skillCooldowns.insert({skill->getName(),
+                          CooldownSystem::getInstance()->allocate(skill->getSkillProfile().cooldown)});
+  _cold->skillMapper.insert({skill->getName(), std::move(skill)});
 }
 
 void Character::removeSkill(Skill* skill) {
   assert(skill != nullptr);
 
-  auto it = _skillMapper.find(skill->getName());
-  if (it == _skillMapper.end()) {
+  auto it = _cold->skillMapper.find(skill->getName());
+  if (it == _cold->skillMapper.end()) {
     VGLOG(LOG_WARN, "This character has not yet learned the skill: %s", skill->getName().c_str());
     return;
   }
 
-  _skillBook[skill->getSkillProfile().skillType].erase(skill);
-  _skillMapper.erase(skill->getName());
+  _cold->skillBook[skill->getSkillProfile().skillType].erase(skill);
+  CooldownSystem::getInstance()->release(_skillCooldowns[skill->getName()]);
+  _skillCooldowns.erase(skill->getName());
+  _cold->skillMapper.erase(it);
 }
 
 
 int Character::getGoldBalance() const {
-  return getItemAmount(Item::create(asset_manager::kGoldCoin)->getName());
+  static const AssetId kGoldCoinNameId
+    = profile_cache::get<Item::Profile>(asset_manager::kGoldCoin)->nameId;
+  return getItemAmount(kGoldCoinNameId);
 }
 
 void Character::addGold(const int amount) {
@@ -972,94 +1397,197 @@ void Character::removeGold(const int amount) {
 
 
 bool Character::isFacingRight() const {
-  return _isFacingRight;
+  return hot().isFacingRight;
 }
 
 bool Character::isJumping() const {
-  return _isJumping;
+  return hot().isJumping;
 }
 
 bool Character::isDoubleJumping() const {
-  return _isDoubleJumping;
+  return hot().isDoubleJumping;
 }
 
 bool Character::isOnPlatform() const {
-  return _isOnPlatform;
+  return hot().isOnPlatform;
 }
 
 bool Character::isAttacking() const {
-  return _isAttacking;
+  return hot().isAttacking;
 }
 
 bool Character::isUsingSkill() const {
-  return _isUsingSkill;
+  return hot().isUsingSkill;
 }
 
 bool Character::isCrouching() const {
-  return _isCrouching;
+  return hot().isCrouching;
 }
 
 bool Character::isInvincible() const {
-  return _isInvincible;
+  return hot().isInvincible;
 }
 
 bool Character::isKilled() const {
-  return _isKilled;
+  return hot().isKilled;
 }
 
 bool Character::isSetToKill() const {
-  return _isSetToKill;
+  return hot().isSetToKill;
+}
+
+bool Character::isInView() const {
+  return hot().isInView;
 }
 
 bool Character::isWeaponSheathed() const {
-  return _isWeaponSheathed;
+  return hot().isWeaponSheathed;
 }
 
 bool Character::isSheathingWeapon() const {
-  return _isSheathingWeapon;
+  return hot().isSheathingWeapon;
 }
 
 bool Character::isUnsheathingWeapon() const {
-  return _isUnsheathingWeapon;
+  return hot().isUnsheathingWeapon;
+}
+
+bool Character::isJumpingDown() const {
+  return hot().isJumpingDown;
 }
 
 
 void Character::setJumping(bool jumping) {
-  _isJumping = jumping;
+  hot().isJumping = jumping;
 }
 
 void Character::setDoubleJumping(bool doubleJumping) {
-  _isDoubleJumping = doubleJumping;
+  hot().isDoubleJumping = doubleJumping;
 }
 
 void Character::setOnPlatform(bool onPlatform) {
-  _isOnPlatform = onPlatform;
+  hot().isOnPlatform = onPlatform;
 }
 
 void Character::setAttacking(bool attacking) {
-  _isAttacking = attacking;
+  hot().isAttacking = attacking;
 }
 
 void Character::setUsingSkill(bool usingSkill) {
-  _isUsingSkill = usingSkill;
+  hot().isUsingSkill = usingSkill;
 }
 
 void Character::setCrouching(bool crouching) {
-  _isCrouching = crouching;
+  hot().isCrouching = crouching;
 }
 
 void Character::setInvincible(bool invincible) {
-  _isInvincible = invincible;
+  hot().isInvincible = invincible;
+}
+
+void Character::setInView(bool inView) {
+  hot().isInView = inView;
 }
 
 
 Character::Profile& Character::getCharacterProfile() {
-  return _characterProfile;
+  return _cold->characterProfile;
+}
+
+const Character::DerivedStats& Character::getDerivedStats() const {
+  return _cold->derivedStats;
+}
+
+void Character::updateDerivedStats() {
+  const Character::Profile& profile = _cold->characterProfile;
+  DerivedStats& stats = _cold->derivedStats;
+  stats.attack = profile.baseMeleeDamage;
+  stats.strength = profile.strength;
+  stats.dexterity = profile.dexterity;
+  stats.intelligence = profile.intelligence;
+  stats.luck = profile.luck;
+  stats.moveSpeed = profile.moveSpeed;
+  stats.jumpHeight = profile.jumpHeight;
+
+  for (const auto equipment : _equipmentSlots) {
+    if (!equipment) {
+      continue;
+    }
+    const Equipment::Profile& equipmentProfile = equipment->getEquipmentProfile();
+    stats.strength += equipmentProfile.bonusStr;
+    stats.dexterity += equipmentProfile.bonusDex;
+    stats.intelligence += equipmentProfile.bonusInt;
+    stats.luck += equipmentProfile.bonusLuk;
+  }
+
+  if (const Equipment* weapon = _equipmentSlots[Equipment::Type::WEAPON]) {
+    stats.attack += weapon->getEquipmentProfile().bonusPhysicalDamage;
+  }
 }
 
+int Character::getStat(StatsSystem::Stat stat) const {
+  return StatsSystem::getInstance()->get(_statsIndex, stat);
+}
+
+void Character::setStat(StatsSystem::Stat stat, int value) {
+  StatsSystem::getInstance()->set(_statsIndex, stat, value);
+}
 
-set<Character*>& Character::getInRangeTargets() {
-  return _inRangeTargets;
+void Character::modifyStat(StatsSystem::Stat stat, int delta) {
+  StatsSystem::getInstance()->modify(_statsIndex, stat, delta);
+}
+
+
+b2AABB Character::getWeaponHitbox() const {
+  const float atkRange = _cold->characterProfile.attackRange / kPpm;
+  const b2Vec2& pos = _body->GetPosition();
+  const float centerX = pos.x + ((hot().isFacingRight) ? atkRange : -atkRange);
+
+  b2AABB hitbox;
+  hitbox.lowerBound.Set(centerX - atkRange, pos.y - atkRange);
+  hitbox.upperBound.Set(centerX + atkRange, pos.y + atkRange);
+  return hitbox;
+}
+
+bool Character::isInAttackRange(const Character* target) const {
+  if (!_body || !target || target == this || !target->_body || target->hot().isSetToKill) {
+    return false;
+  }
+
+  // The body fixture of a killed character is recategorized as kDestroyed.
+  const b2Fixture* bodyFixture = target->_fixtures[FixtureType::BODY];
+  return (bodyFixture->GetFilterData().categoryBits & _weaponMaskBits) &&
+         b2TestOverlap(getWeaponHitbox(), bodyFixture->GetAABB(0));
+}
+
+void Character::queryInRangeTargets(vector<Character*>& targets) const {
+  if (!_body) {
+    return;
+  }
+
+  class HitboxQueryCallback : public b2QueryCallback {
+   public:
+    HitboxQueryCallback(const Character* attacker, vector<Character*>& targets)
+        : _attacker(attacker), _targets(targets) {}
+
+    virtual bool ReportFixture(b2Fixture* fixture) override {
+      // Only the body fixtures of characters have these category bits.
+      if (fixture->GetFilterData().categoryBits & _attacker->_weaponMaskBits) {
+        Character* target = static_cast<Character*>(fixture->GetUserData());
+        if (_attacker->isInAttackRange(target)) {
+          _targets.push_back(target);
+        }
+      }
+      return true;
+    }
+
+   private:
+    const Character* _attacker;
+    vector<Character*>& _targets;
+  };
+
+  HitboxQueryCallback callback(this, targets);
+  _body->GetWorld()->QueryAABB(&callback, getWeaponHitbox());
 }
 
 Character* Character::getLockedOnTarget() const {
@@ -1079,13 +1607,12 @@ void Character::setAlerted(bool alerted) {
 }
 
 
-set<Item*>& Character::getInRangeItems() {
-  return _inRangeItems;
+const Character::Inventory& Character::getInventory() const {
+  return _cold->inventory;
 }
 
-
-const Character::Inventory& Character::getInventory() const {
-  return _inventory;
+uint32_t Character::getInventoryRevision() const {
+  return _inventoryRevision;
 }
 
 const Character::EquipmentSlots& Character::getEquipmentSlots() const {
@@ -1093,11 +1620,9 @@ const Character::EquipmentSlots& Character::getEquipmentSlots() const {
 }
 
 
-int Character::getItemAmount(const string& itemName) const {
-  if (_itemMapper.find(itemName) == _itemMapper.end()) {
-    return 0;
-  }
-  return _itemMapper.at(itemName)->getAmount();
+int Character::getItemAmount(AssetId itemNameId) const {
+  const Item* item = getExistingItemObj(itemNameId);
+  return (item) ? item->getAmount() : 0;
 }
 
 
@@ -1119,7 +1644,17 @@ void Character::setPortal(GameMap::Portal* portal) {
 
 
 const Character::SkillBook& Character::getSkillBook() const {
-  return _skillBook;
+  return _cold->skillBook;
+}
+
+bool Character::isSkillReady(Skill* skill) const {
+  auto it = _skillCooldowns.find(skill->getName());
+  return it == _skillCooldowns.end() || CooldownSystem::getInstance()->isReady(it->second);
+}
+
+float Character::getSkillCooldownProgress(Skill* skill) const {
+  auto it = _skillCooldowns.find(skill->getName());
+  return (it != _skillCooldowns.end()) ? CooldownSystem::getInstance()->getProgress(it->second) : 1.0f;
 }
 
 shared_ptr<Skill> Character::getActiveSkill(Skill* skill) const {
@@ -1130,35 +1665,99 @@ shared_ptr<Skill> Character::getActiveSkill(Skill* skill) const {
 
 void Character::removeActiveSkill(Skill* skill) {
   shared_ptr<Skill> key(shared_ptr<Skill>(), skill);
-  _activeSkills.erase(key);
-}
+  auto it = _activeSkills.find(key);
+  if (it == _activeSkills.end()) {
+    return;
+  }
 
-Skill* Character::getCurrentlyUsedSkill() const {
-  return _currentlyUsedSkill;
+  // Keep the instance around for the next activation of the same skill.
+  auto& idleSkills = _cold->idleSkills[skill->getSkillProfile().jsonFileName];
+  if (idleSkills.size() < MAX_IDLE_SKILL_INSTANCES) {
+    idleSkills.push_back(*it);
+  }
+  _activeSkills.erase(it);
 }
 
+shared_ptr<Skill> Character::acquireSkillInstance(Skill* skill) {
+  auto it = _cold->idleSkills.find(skill->getSkillProfile().jsonFileName);
+  if (it == _cold->idleSkills.end() || it->second.empty()) {
+    return shared_ptr<Skill>(Skill::create(skill->getSkillProfile().jsonFileName, this));
+  }
 
-bool Character::isWaitingForPartyLeader() const {
-  return _party && _party->hasWaitingMember(_characterProfile.jsonFileName);
+  shared_ptr<Skill> instance = std::move(it->second.back());
+  it->second.pop_back();
+  instance->reset();
+  return instance;
 }
 
-unordered_set<Character*> Character::getAllies() const {
-  if (!_party) {
-    return {};
+void Character::runAfter(const function<void ()>& userCallback, float delay) {
+  if (!isBoundToWorldEpoch()) {
+    CallbackManager::getInstance()->runAfter(userCallback, delay, this);
+    return;
   }
 
-  unordered_set<Character*> ret;
+  // Drop the callback if a GameMap transition has begun since it was
+  // scheduled, see world_epoch.
+  const world_epoch::Epoch epoch = world_epoch::current();
+  CallbackManager::getInstance()->runAfter([userCallback, epoch]() {
+    if (world_epoch::isCurrent(epoch)) {
+      userCallback();
+    }
+  }, delay, this);
+}
+
+bool Character::isBoundToWorldEpoch() const {
+  return false;
+}
 
-  for (const auto& member : _party->getMembers()) {
-    ret.insert(member.get());
+void Character::settleTransientStates() {
+  // Leave this character in the states which the callbacks dropped
+  // by removeFromMap() would have left it in.
+  HotState& state = hot();
+  if (state.isSheathingWeapon) {
+    state.isSheathingWeapon = false;
+    state.isWeaponSheathed = true;
+  }
+  if (state.isUnsheathingWeapon) {
+    state.isUnsheathingWeapon = false;
+    state.isWeaponSheathed = false;
   }
+  state.isJumpingDisallowed = false;
+  state.isJumpingDown = false;
+  state.isAttacking = false;
+  state.isHitPending = false;
+  state.isInvincible = false;
+  state.isTakingDamage = false;
+  if (state.isUsingSkill) {
+    endSkill();
+  }
+}
+
+Skill* Character::getCurrentlyUsedSkill() const {
+  return _currentlyUsedSkill;
+}
+
 
-  Character* leader = _party->getLeader();
-  if (leader != this) {
-    ret.insert(leader);
+bool Character::isWaitingForPartyLeader() const {
+  return _party && _party->hasWaitingMember(_cold->characterProfile.id);
+}
+
+const vector<Character*>& Character::getAllies() const {
+  const uint64_t partyVersion = (_party) ? _party->getVersion() : 0;
+  if (partyVersion == _alliesVersion) {
+    return _allies;
   }
 
-  return ret;
+  // The leader's allies are the members, and a member's allies
+  // are the leader and all the members (including itself).
+  _allies.clear();
+  if (_party) {
+    const vector<Character*>& leaderAndMembers = _party->getLeaderAndMembers();
+    const bool isLeader = _party->getLeader() == this;
+    _allies.assign(leaderAndMembers.begin() + (isLeader ? 1 : 0), leaderAndMembers.end());
+  }
+  _alliesVersion = partyVersion;
+  return _allies;
 }
 
 shared_ptr<Party> Character::getParty() const {
@@ -1172,45 +1771,32 @@ void Character::setParty(shared_ptr<Party> party) {
 
 
 int Character::getDamageOutput() const {
-  int output = _characterProfile.baseMeleeDamage;
-
-  Equipment* weapon = _equipmentSlots[Equipment::Type::WEAPON];
-  if (weapon) {
-    output += weapon->getEquipmentProfile().bonusPhysicalDamage;
-  }
-
-  return output + rand_util::randInt(-5, 5); // temporary
+  return _cold->derivedStats.attack + rand_util::randInt(-5, 5); // temporary
 }
 
+void Character::setReplicatedState(const b2Vec2& position, const b2Vec2& velocity,
+                                   bool isFacingRight, bool isWeaponSheathed) {
+  if (!_isShownOnMap || !_body) {
+    return;
+  }
 
-void Character::regenHealth(int deltaHealth) {
-  const int& fullHealth = _characterProfile.fullHealth;
-  int& health = _characterProfile.health;
-
-  health += deltaHealth;
-  health = (health > fullHealth) ? fullHealth : health;
-}
-
-void Character::regenMagicka(int deltaMagicka) {
-  const int& fullMagicka = _characterProfile.fullMagicka;
-  int& magicka = _characterProfile.magicka;
-
-  magicka += deltaMagicka;
-  magicka = (magicka > fullMagicka) ? fullMagicka : magicka;
-}
-
-void Character::regenStamina(int deltaStamina) {
-  const int& fullStamina = _characterProfile.fullStamina;
-  int& stamina = _characterProfile.stamina;
-
-  stamina += deltaStamina;
-  stamina = (stamina > fullStamina) ? fullStamina : stamina;
+  // An inactive body has no contacts, so a replica never
+  // triggers anything (e.g., a portal) on the client.
+  if (_body->IsActive()) {
+    _body->SetActive(false);
+  }
+  _body->SetTransform(position, _body->GetAngle());
+  _body->SetLinearVelocity(velocity);
+  hot().isFacingRight = isFacingRight;
+  hot().isWeaponSheathed = isWeaponSheathed;
 }
 
 
-
-Character::Profile::Profile(const string& jsonFileName) : jsonFileName(jsonFileName) {
-  Document json = json_util::parseJson(jsonFileName);
+Character::Profile::Profile(const string& jsonFileName)
+    : jsonFileName(jsonFileName),
+      id(jsonFileName) {
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  Document& json = jsonDocument.get();
 
   textureResDir = json["textureResDir"].GetString();
   spriteOffsetX = json["spriteOffsetX"].GetFloat();
@@ -1223,7 +1809,30 @@ Character::Profile::Profile(const string& jsonFileName) : jsonFileName(jsonFileN
     frameInterval.push_back(interval);
   }
 
+  frameEvents.resize(Character::State::STATE_SIZE, FrameAnimator::kNoEvents);
+  if (json.HasMember("frameEvents")) {
+    for (int i = 0; i < Character::State::STATE_SIZE; i++) {
+      const char* stateStr = Character::_kCharacterStateStr[i].c_str();
+      if (json["frameEvents"].HasMember(stateStr)) {
+        frameEvents[i] = FrameAnimator::parseEventTrack(json["frameEvents"][stateStr]);
+      }
+    }
+  }
+
+  // The color variants of the same texture are defined by their palettes.
+  if (json.HasMember("palette")) {
+    palette = json["palette"].GetString();
+  }
+
+  if (json.HasMember("hurtSfx")) {
+    hurtSfx = json["hurtSfx"].GetString();
+  }
+  if (json.HasMember("killedSfx")) {
+    killedSfx = json["killedSfx"].GetString();
+  }
+
   name = json["name"].GetString();
+  nameId = AssetId(name);
   level = json["level"].GetInt();
   exp = json["exp"].GetInt();
 
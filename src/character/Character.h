@@ -9,26 +9,32 @@
 #include <unordered_set>
 #include <string>
 #include <memory>
+#include <utility>
 #include <functional>
 
 #include <cocos2d.h>
 #include <Box2D/Box2D.h>
+#include "Constants.h"
 #include "DynamicActor.h"
+#include "FrameAnimator.h"
 #include "Importable.h"
 #include "Interactable.h"
 #include "character/Party.h"
+#include "gameplay/StatsSystem.h"
 #include "item/Item.h"
 #include "item/Equipment.h"
 #include "item/Consumable.h"
 #include "map/GameMap.h"
 #include "skill/Skill.h"
+#include "util/AssetId.h"
 #include "util/ds/SetVector.h"
 
 namespace vigilante {
 
-class Character : public DynamicActor, public Importable {
+class Character : public DynamicActor, public Importable, public FrameAnimator::Listener {
  public: 
-  using Inventory = std::array<SetVector<Item*>, Item::Type::SIZE>;
+  // The items of each type are sorted by their name ids (see AssetId).
+  using Inventory = std::array<std::vector<Item*>, Item::Type::SIZE>;
   using EquipmentSlots = std::array<Equipment*, Equipment::Type::SIZE>;
   using SkillBook = std::array<SetVector<Skill*>, Skill::Type::SIZE>;
 
@@ -37,20 +43,29 @@ class Character : public DynamicActor, public Importable {
     ~Profile() = default;
 
     std::string jsonFileName;
+    AssetId id;  // interned `jsonFileName`
     std::string textureResDir;
     float spriteOffsetX;
     float spriteOffsetY;
     float spriteScaleX;
     float spriteScaleY;
     std::vector<float> frameInterval;
+    // optional, e.g., the frame at which an attack lands (see Character::onFrameEvent())
+    std::vector<FrameAnimator::EventTrack> frameEvents;
+    std::string palette;  // optional, see PaletteSwap
+    std::string hurtSfx;  // optional, see AudioManager
+    std::string killedSfx;  // optional
 
     std::string name;
+    AssetId nameId;  // interned `name`
     int level;
     int exp;
 
     int fullHealth;
     int fullStamina;
     int fullMagicka;
+    // The initial vitals. The current ones are kept by the StatsSystem,
+    // see Character::getStat().
     int health;
     int stamina;
     int magicka;
@@ -75,6 +90,20 @@ class Character : public DynamicActor, public Importable {
     std::vector<std::pair<std::string, int>> defaultInventory;
   };
 
+  // The stats derived from the profile and the equipment, which are read by
+  // the combat, the movement and the UI. They're only recomputed by
+  // updateDerivedStats() when either of those changes (e.g., equipping an
+  // item, leveling up, using a consumable), instead of on every read.
+  struct DerivedStats final {
+    int attack;  // the base melee damage plus the weapon's bonus
+    int strength;  // including the bonuses of all equipment
+    int dexterity;
+    int intelligence;
+    int luck;
+    float moveSpeed;
+    float jumpHeight;
+  };
+
   // We have a vector of b2Fixtures (declared in DynamicActor abstract class).
   // e.g., to access the weapon fixture: _fixtures[FixtureType::WEAPON]
   enum FixtureType {
@@ -84,12 +113,20 @@ class Character : public DynamicActor, public Importable {
     FIXTURE_SIZE
   };
 
-  virtual ~Character() = default;
+  virtual ~Character();
 
   virtual bool showOnMap(float x, float y) override = 0;  // DynamicActor
   virtual bool removeFromMap() override;  // DynamicActor
   virtual void update(float delta) override;  // DynamicActor
+  virtual bool isTransformSyncNeeded() const override;  // DynamicActor
+  virtual void syncTransform(float x, float y) override;  // DynamicActor
   virtual void import(const std::string& jsonFileName) override;  // Importable
+  virtual void onFrameEvent(FrameAnimator::Event event) override;  // FrameAnimator::Listener
+
+  // Restores a character which has been removed from the map to the state
+  // right after it was constructed from its json file (re-importing it),
+  // so that it can be shown on the map again instead of being re-created.
+  virtual void reset();
 
   virtual void onKilled();
 
@@ -106,15 +143,26 @@ class Character : public DynamicActor, public Importable {
   virtual void attack();
   virtual void activateSkill(Skill* skill);
   virtual void knockBack(Character* target, float forceX, float forceY) const;
-  virtual void inflictDamage(Character* target, int damage);
+  // Enqueues a hit on `target`, which is resolved along with the
+  // other hits of this frame by CombatSystem::resolve().
+  void inflictDamage(Character* target, int damage);
+  // Called by CombatSystem::resolve().
   virtual void receiveDamage(Character* source, int damage);
   virtual void lockOn(Character* target);
 
   virtual void addItem(std::shared_ptr<Item> item, int amount=1);
   virtual void removeItem(Item* item, int amount=1);
+  // Bulk versions of addItem() and removeItem(), e.g., for trades and looting.
+  // Each affected inventory list is re-sorted / compacted only once.
+  virtual void addItems(const std::vector<std::pair<std::shared_ptr<Item>, int>>& items);
+  virtual void removeItems(const std::vector<std::pair<Item*, int>>& items);
   virtual void useItem(Consumable* consumable);
   virtual void equip(Equipment* equipment);
   virtual void unequip(Equipment::Type equipmentType);
+  // Loads the spritesheets of `equipment` in the background, followed by all
+  // of its animations (into AnimationCache), so that equipping it later
+  // (e.g., after it's highlighted in the pause menu) won't stall.
+  void preloadEquipmentAnimations(const Equipment* equipment) const;
   virtual void pickupItem(Item* item);
   virtual void discardItem(Item* item, int amount);
   virtual void interact(Interactable* target);
@@ -137,9 +185,11 @@ class Character : public DynamicActor, public Importable {
   bool isInvincible() const;
   bool isKilled() const;
   bool isSetToKill() const;
+  bool isInView() const;
   bool isWeaponSheathed() const;
   bool isSheathingWeapon() const;
   bool isUnsheathingWeapon() const;
+  bool isJumpingDown() const;  // passing through the platforms, see jumpDown()
 
   void setJumping(bool jumping);
   void setDoubleJumping(bool doubleJumping);
@@ -148,20 +198,38 @@ class Character : public DynamicActor, public Importable {
   void setUsingSkill(bool usingSkill);
   void setCrouching(bool crouching);
   void setInvincible(bool invincible);
+  void setInView(bool inView);
 
+  // Call updateDerivedStats() after modifying the returned profile.
   Character::Profile& getCharacterProfile();
+  const Character::DerivedStats& getDerivedStats() const;
+  void updateDerivedStats();
+
+  // The current health, magicka and stamina, clamped to [0, full value].
+  int getStat(StatsSystem::Stat stat) const;
+  void setStat(StatsSystem::Stat stat, int value);
+  void modifyStat(StatsSystem::Stat stat, int delta);
+
+  // The melee hitbox, i.e., the AABB (in meters) of the attack range in front
+  // of this character. It isn't backed by a fixture, so the characters idling
+  // next to each other don't generate any contacts. Instead, it's only tested
+  // during the active frames of an attack (see attack()) or by the AI.
+  b2AABB getWeaponHitbox() const;
+  bool isInAttackRange(const Character* target) const;
+  // Appends the hostile characters whose bodies overlap the hitbox to `targets`.
+  void queryInRangeTargets(std::vector<Character*>& targets) const;
 
-  std::set<Character*>& getInRangeTargets();
   Character* getLockedOnTarget() const;
   void setLockedOnTarget(Character* target);
   bool isAlerted() const;
   void setAlerted(bool alerted);
 
-  std::set<Item*>& getInRangeItems();
-
   const Inventory& getInventory() const;
+  // Incremented whenever an item is added to or removed from the inventory,
+  // so that the views of the inventory can tell if they're out of date.
+  uint32_t getInventoryRevision() const;
   const EquipmentSlots& getEquipmentSlots() const;
-  int getItemAmount(const std::string& itemName) const;
+  int getItemAmount(AssetId itemNameId) const;
 
   Interactable* getInteractableObject() const;
   void setInteractableObject(Interactable* interactableObject);
@@ -170,24 +238,32 @@ class Character : public DynamicActor, public Importable {
   void setPortal(GameMap::Portal* portal);
 
   const SkillBook& getSkillBook() const;
+  // The cooldown queries are answered by CooldownSystem without touching `skill`
+  // (other than its name), so the UI may call them for every skill each frame.
+  bool isSkillReady(Skill* skill) const;
+  float getSkillCooldownProgress(Skill* skill) const;  // [0, 1]
   std::shared_ptr<Skill> getActiveSkill(Skill* skill) const;
   void removeActiveSkill(Skill* skill);
   Skill* getCurrentlyUsedSkill() const;
 
   bool isWaitingForPartyLeader() const;
-  std::unordered_set<Character*> getAllies() const;
+  // The view is cached, and only rebuilt after the party has changed
+  // (see Party::getVersion()). Must be called on the main thread.
+  const std::vector<Character*>& getAllies() const;
   std::shared_ptr<Party> getParty() const;
   void setParty(std::shared_ptr<Party> party);
 
   int getDamageOutput() const;
+
+  // The co-op client doesn't simulate the characters (see net/CoopSession.h).
+  // Their bodies are deactivated, and moved to the states sent by the host.
+  void setReplicatedState(const b2Vec2& position, const b2Vec2& velocity,
+                          bool isFacingRight, bool isWeaponSheathed);
   
 
  protected:
   explicit Character(const std::string& jsonFileName);
 
-  virtual void regenHealth(int deltaHealth);
-  virtual void regenMagicka(int deltaMagicka);
-  virtual void regenStamina(int deltaStamina);
 
   enum State {
     IDLE_SHEATHED,
@@ -210,6 +286,10 @@ class Character : public DynamicActor, public Importable {
 
   static const std::array<std::string, Character::State::STATE_SIZE> _kCharacterStateStr;
 
+  // Whether the animation of each state is looped when this character
+  // transitions into it (see Character::update()).
+  static const std::array<bool, Character::State::STATE_SIZE> _kIsStateAnimationLooped;
+
   virtual void defineBody(b2BodyType bodyType,
                           float x,
                           float y, 
@@ -218,74 +298,156 @@ class Character : public DynamicActor, public Importable {
                           short feetMaskBits=0,
                           short weaponMaskBits=0);
 
+  // Switches the filters of all fixtures to those of `role`.
+  // Only the fixtures whose filter data actually changes are refiltered.
+  void setCollisionRole(collision_filters::Role role);
+
+  // The WEAPON fixture only collides while a skill is being used,
+  // e.g., ForwardSlash damages the enemies it dashes through.
+  void setWeaponFixtureEnabled(bool enabled);
+
   virtual void defineTexture(const std::string& bodyTextureResDir, float x, float y);
 
+  // Returns the shader which draws the sprites with `palette` (see PaletteSwap),
+  // or nullptr if `palette` is empty (i.e., the default shader).
+  static cocos2d::GLProgramState* getPaletteProgramState(const std::string& palette);
+  void addEquipmentSpriteToMap(Equipment::Type type);
+
   virtual void loadBodyAnimations(const std::string& bodyTextureResDir);
   virtual void loadEquipmentAnimations(Equipment* equipment);
+  void releaseEquipmentAnimations(Equipment::Type type);
 
   int getExtraAttackAnimationsCount() const;
   cocos2d::Animation* getBodyAttackAnimation() const;
-  cocos2d::Animation* getEquipmentAttackAnimation(const Equipment::Type type) const;
+  // The equipment animations other than IDLE_SHEATHED are loaded
+  // on demand, see loadEquipmentAnimations().
+  cocos2d::Animation* getEquipmentAnimation(const Equipment::Type type, const Character::State state);
+  cocos2d::Animation* getEquipmentAttackAnimation(const Equipment::Type type);
 
+  // The animations of the states play the events of Profile::frameEvents.
   void runAnimation(Character::State state, bool loop=true);
-  void runAnimation(Character::State state, const std::function<void ()>& func) const;
-  void runAnimation(const std::string& framesName, float interval);
+  void runAnimation(Character::State state, const std::function<void ()>& func);
+  void runAnimation(const std::string& framesName, float interval,
+                    const FrameAnimator::EventTrack& eventTrack=FrameAnimator::kNoEvents);
+  FrameAnimator::EventTrack getEventTrack(Character::State state, const cocos2d::Animation* animation) const;
+
+  // Lands the hit of the attack on `_lockedOnTarget`, see attack().
+  void landHit();
+  // Ends the skill being used, see activateSkill().
+  void endSkill();
 
   Character::State getState() const;
 
 
+  // The data touched by (almost) every frame, e.g., the state flags read by
+  // update() and the AI, and the state last pushed to the sprites by syncTransform().
+  // It's kept in a contiguous array shared by all characters (see hot()),
+  // so that iterating over many characters doesn't drag their cold data
+  // through the cache.
+  struct HotState final {
+    Character::State currentState;
+    Character::State previousState;
+
+    bool isFacingRight;
+    bool isWeaponSheathed;
+    bool isSheathingWeapon;
+    bool isUnsheathingWeapon;
+    bool isJumpingDisallowed;
+    bool isJumping;
+    bool isJumpingDown;
+    bool isDoubleJumping;
+    bool isOnPlatform;
+    bool isAttacking;
+    bool isHitPending;  // the attack hasn't reached its HIT event yet
+    bool isUsingSkill;
+    bool isCrouching;
+    bool isInvincible;
+    bool isTakingDamage;
+    bool isKilled;
+    bool isSetToKill;
+    bool isInView;  // see GameMapManager::getUpdateLod()
+
+    bool isSpriteSyncDirty;
+    bool lastSyncedFacingRight;
+    cocos2d::Vec2 lastSyncedSpritePos;
+  };
+
+  // The data which is only touched by occasional events (e.g., picking up
+  // an item, activating a skill, changing the equipment or the animation),
+  // kept out of line behind `_cold`.
+  struct ColdData final {
+    explicit ColdData(const Character::Profile& characterProfile);
+
+    Character::Profile characterProfile;
+    Character::DerivedStats derivedStats;  // see updateDerivedStats()
+
+    // For each instance of Item, only one copy of Item* is stored,
+    // and its count is stored inline (see Item::getAmount()).
+    Character::Inventory inventory;
+    std::vector<std::shared_ptr<Item>> itemMapper;  // see getExistingItemObj()
+
+    Character::SkillBook skillBook;
+    std::unordered_map<std::string, std::unique_ptr<Skill>> skillMapper;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Skill>>> idleSkills;  // <json, instances>
+
+    // Extra attack animations.
+    // The first attack animations is in _bodyAnimations[State::ATTACK],
+    // and here's some extra ones.
+    std::vector<cocos2d::Animation*> bodyExtraAttackAnimations;
+    std::array<std::vector<cocos2d::Animation*>, Equipment::Type::SIZE> equipmentExtraAttackAnimations;
+    std::array<std::array<cocos2d::Animation*, Character::State::STATE_SIZE>, Equipment::Type::SIZE>
+      equipmentAnimations;
+
+    // Skill animations
+    std::unordered_map<std::string, cocos2d::Animation*> skillBodyAnimations;
+  };
+
+  // Don't hold on to the returned reference while a character may be
+  // created, since that may grow `_hotStates`. Characters are only
+  // created on the main thread, and never during Npc::think().
+  HotState& hot();
+  const HotState& hot() const;
+
+
   // Characater data.
-  Character::Profile _characterProfile;
-
-  // Stats regen timer
-  float _statsRegenTimer;
-  const int _baseRegenDeltaHealth;
-  const int _baseRegenDeltaMagicka;
-  const int _baseRegenDeltaStamina;
-
-  // The following variables are used to determine the character's state
-  // and run the corresponding animations. Please see Character::update()
-  // for the logic.
-  Character::State _currentState;
-  Character::State _previousState;
-
-  bool _isFacingRight;
-  bool _isWeaponSheathed;
-  bool _isSheathingWeapon;
-  bool _isUnsheathingWeapon;
-  bool _isJumpingDisallowed;
-  bool _isJumping;
-  bool _isDoubleJumping;
-  bool _isOnPlatform;
-  bool _isAttacking;
-  bool _isUsingSkill;
-  bool _isCrouching;
-  bool _isInvincible;
-  bool _isTakingDamage;
-  bool _isKilled;
-  bool _isSetToKill;
+  std::unique_ptr<Character::ColdData> _cold;
+
+  // This character's slot in the StatsSystem.
+  const int _statsIndex;
+
+  // This character's slot in `_hotStates`. The slots are recycled, not compacted.
+  const int _hotIndex;
 
   // The following variables are used to determine combat targets.
   // A character can only inflict damage to another iff the target is
-  // within (attack) range.
-  std::set<Character*> _inRangeTargets;
+  // within (attack) range, see getWeaponHitbox().
+  short _weaponMaskBits;  // the category bits of the characters which can be hit
+  bool _isWeaponFixtureEnabled;
   Character* _lockedOnTarget;
   bool _isAlerted;
 
-  // When player are close enough to the items dropped in the world,
-  // the pointers to the items are stored here.
-  std::set<Item*> _inRangeItems;
-
-  // Character's inventory and equipment slots.
-  // These two types are aliased. See the beginning of this class.
-  // We use an extra std::map to keep track of each item's count.
-  // For each instance of Item, only one copy of Item* is stored.
-  Character::Inventory _inventory;
+  // Character's equipment slots (the inventory is in `_cold`).
   Character::EquipmentSlots _equipmentSlots;
+  uint32_t _inventoryRevision;
 
   // For each item, at most one copy of Item* is kept in memory.
+  // The copy is stored in ColdData::itemMapper, which is indexed by the item's name id.
   Item* getExistingItemObj(Item* item) const;
-  std::unordered_map<std::string, std::shared_ptr<Item>> _itemMapper;   
+  Item* getExistingItemObj(AssetId itemNameId) const;
+  Item* storeItem(std::shared_ptr<Item> item, int amount);
+  void releaseItem(Item* existingItemObj);
+  // Called whenever the amount of an item in the inventory changes by `deltaAmount`
+  // (e.g., Player keeps its collect objectives' counters up to date with it).
+  virtual void onItemAmountChanged(AssetId itemNameId, int deltaAmount);
+  void addDefaultItems();
+  std::shared_ptr<Skill> acquireSkillInstance(Skill* skill);
+
+  // Schedules `userCallback` owned by this character (see CallbackManager).
+  // If isBoundToWorldEpoch() returns true, the callback is dropped when
+  // a GameMap transition begins before it's run.
+  void runAfter(const std::function<void ()>& userCallback, float delay);
+  virtual bool isBoundToWorldEpoch() const;
+  void settleTransientStates();
 
 
   // The interactable object / portal to which this character is near.
@@ -294,38 +456,51 @@ class Character : public DynamicActor, public Importable {
 
 
   // Currently used skill.
-  Character::SkillBook _skillBook;
-  std::unordered_map<std::string, std::unique_ptr<Skill>> _skillMapper;
+  std::unordered_map<std::string, int> _skillCooldowns;  // <name, index in CooldownSystem>
   std::unordered_set<std::shared_ptr<Skill>> _activeSkills;
   Skill* _currentlyUsedSkill;
 
 
-  // Extra attack animations.
-  // The first attack animations is in _bodyAnimations[State::ATTACK],
-  // and here's some extra ones.
+  // The number of attack animations (see ColdData::bodyExtraAttackAnimations).
   const int _kAttackAnimationIdxMax;
   int _attackAnimationIdx;
-  std::vector<cocos2d::Animation*> _bodyExtraAttackAnimations;
-  std::array<std::vector<cocos2d::Animation*>, Equipment::Type::SIZE> _equipmentExtraAttackAnimations;
  
   // Besides body sprite and animations (declared in Actor abstract class),
   // there is also a sprite for each equipment slots! Each equipped equipment
   // has their own animation!
   std::array<cocos2d::Sprite*, Equipment::Type::SIZE> _equipmentSprites;
-  std::array<cocos2d::SpriteBatchNode*, Equipment::Type::SIZE> _equipmentSpritesheets;
-  std::array<std::array<cocos2d::Animation*, Character::State::STATE_SIZE>, Equipment::Type::SIZE>
-    _equipmentAnimations;
 
-  // Skill animations
-  std::unordered_map<std::string, cocos2d::Animation*> _skillBodyAnimations;
+  // The animations of the body sprite and the equipment sprites are played
+  // by FrameAnimators rather than cocos2d actions (see runAnimation()).
+  FrameAnimator _bodyAnimator;
+  std::array<FrameAnimator, Equipment::Type::SIZE> _equipmentAnimators;
 
   // Party
   // A character can either:
   // (1) be a leader who has a set of allies/followers, or
   // (2) be a follower of other character
   std::shared_ptr<Party> _party;
+  mutable std::vector<Character*> _allies;
+  mutable uint64_t _alliesVersion;  // the version of `_party` when `_allies` was built
+
+ private:
+  static Character::HotState getInitialHotState();
+  static int allocateHotState();
+
+  static std::vector<Character::HotState> _hotStates;
+  static std::vector<int> _freeHotStateIndices;
 };
 
+
+// Defined here so that the accesses to the state flags are inlined everywhere.
+inline Character::HotState& Character::hot() {
+  return _hotStates[_hotIndex];
+}
+
+inline const Character::HotState& Character::hot() const {
+  return _hotStates[_hotIndex];
+}
+
 }  // namespace vigilante
 
 #endif  // VIGILANTE_CHARACTER_H_
@@ -1,17 +1,19 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "Npc.h"
 
+#include <algorithm>
 #include <memory>
 
 #include <json/document.h>
 #include "std/make_unique.h"
 #include "AssetManager.h"
-#include "CallbackManager.h"
 #include "Constants.h"
 #include "character/Player.h"
 #include "item/Item.h"
 #include "map/GameMapManager.h"
 #include "map/FxManager.h"
+#include "map/WorldEpoch.h"
+#include "net/CoopSession.h"
 #include "quest/KillTargetObjective.h"
 #include "quest/CollectItemObjective.h"
 #include "ui/WindowManager.h"
@@ -19,23 +21,25 @@
 #include "ui/dialogue/DialogueManager.h"
 #include "ui/trade/TradeWindow.h"
 #include "util/box2d/b2BodyBuilder.h"
+#include "util/FrameBudget.h"
+#include "util/FrameProfiler.h"
+#include "util/ProfileCache.h"
 #include "util/RandUtil.h"
 #include "util/JsonUtil.h"
 #include "util/StringUtil.h"
-
-#define ALLY_BODY_CATEGORY_BITS kNpc
-#define ALLY_BODY_MASK_BITS kFeet | kEnemy | kMeleeWeapon | kPivotMarker | kCliffMarker | kProjectile
-#define ALLY_FEET_MASK_BITS kGround | kPlatform | kWall | kItem | kPortal | kInteractable
-#define ALLY_WEAPON_MASK_BITS kEnemy
-
-#define ENEMY_BODY_CATEGORY_BITS kEnemy
-#define ENEMY_BODY_MASK_BITS kFeet | kPlayer | kNpc | kMeleeWeapon | kPivotMarker | kCliffMarker | kProjectile
-#define ENEMY_FEET_MASK_BITS kGround | kPlatform | kWall | kItem | kInteractable
-#define ENEMY_WEAPON_MASK_BITS kPlayer | kNpc
+#include "util/TraceProfiler.h"
 
 #define ALLY_FOLLOW_DISTANCE .75f
-
-using std::atomic;
+#define ALLY_FORMATION_SLOT_TOLERANCE .15f
+#define NPC_ASLEEP_VELOCITY_SQUARED .01f
+#define NAV_TAKE_OFF_TOLERANCE 4.0f  // in pixels
+#define NPC_AGGRO_RADIUS 1.5f  // in meters
+#define NPC_AGGRO_QUERY_INTERVAL .5f  // in seconds
+#define NPC_PROXIMITY_THREAT 1.0f  // per query, for a target right next to the npc
+#define NPC_THREAT_DECAY .75f  // per query
+#define NPC_THREAT_SWITCH_RATIO 1.5f
+
+using std::pair;
 using std::string;
 using std::vector;
 using std::unique_ptr;
@@ -52,33 +56,21 @@ using cocos2d::SpriteFrame;
 using cocos2d::SpriteFrameCache;
 using cocos2d::SpriteBatchNode;
 using cocos2d::EventKeyboard;
-using vigilante::category_bits::kPlayer;
-using vigilante::category_bits::kEnemy;
-using vigilante::category_bits::kNpc;
 using vigilante::category_bits::kFeet;
-using vigilante::category_bits::kMeleeWeapon;
-using vigilante::category_bits::kItem;
-using vigilante::category_bits::kGround;
-using vigilante::category_bits::kPlatform;
-using vigilante::category_bits::kPivotMarker;
-using vigilante::category_bits::kCliffMarker;
-using vigilante::category_bits::kWall;
-using vigilante::category_bits::kPortal;
 using vigilante::category_bits::kInteractable;
-using vigilante::category_bits::kProjectile;
 using rapidjson::Document;
 
 namespace vigilante {
 
-atomic<bool> Npc::_areNpcsAllowedToAct(true);
-unordered_set<string> Npc::_npcSpawningBlacklist;
+unordered_set<AssetId> Npc::_npcSpawningBlacklist;
 
 Npc::Npc(const string& jsonFileName)
     : Character(jsonFileName),
-      _npcProfile(jsonFileName),
+      _npcProfile(*profile_cache::get<Npc::Profile>(jsonFileName)),
       _dialogueTree(_npcProfile.dialogueTreeJsonFile, this),
       _disposition(_npcProfile.disposition),
       _isSandboxing(_npcProfile.shouldSandbox),
+      _isRemoteControlled(),
       _hintBubbleFxSprite(),
       _isMovingRight(),
       _moveDuration(),
@@ -86,7 +78,16 @@ Npc::Npc(const string& jsonFileName)
       _waitDuration(),
       _waitTimer(),
       _calculateDistanceTimer(),
-      _lastStoppedPosition() {
+      _lastStoppedPosition(),
+      _navPath(),
+      _navPathIndex(),
+      _navGoalNode(-1),
+      _hasNavPlan(),
+      _navPlanTarget(),
+      _isOnNavPath(),
+      _threats(),
+      _aggroQueryTimer(rand_util::randFloat(0, NPC_AGGRO_QUERY_INTERVAL, rand_util::Stream::AI)),
+      _aggroTarget() {
   if (_npcProfile.isUnsheathed) {
     unsheathWeapon();
   }
@@ -95,43 +96,55 @@ Npc::Npc(const string& jsonFileName)
 void Npc::update(float delta) {
   Character::update(delta);
 
-  if (!_isShownOnMap || _isKilled) {
+  if (!_isShownOnMap || hot().isKilled) {
     return;
   }
 
-  // Sync the hint bubble fx sprite with Npc's b2body if it exists.
-  if (_hintBubbleFxSprite) {
-    const b2Vec2& b2bodyPos = _body->GetPosition();
-    _hintBubbleFxSprite->setPosition(b2bodyPos.x * kPpm,
-                                     b2bodyPos.y * kPpm + HINT_BUBBLE_FX_SPRITE_OFFSET_Y);
+  if (!world_epoch::isInTransition() && !_isRemoteControlled) {
+    _aggroQueryTimer += delta;
+    act(delta);
   }
+  _hasNavPlan = false;
+  _aggroTarget = nullptr;
+}
 
-  if (_areNpcsAllowedToAct) {
-    act(delta);
+void Npc::syncTransform(float x, float y) {
+  Character::syncTransform(x, y);
+
+  // Sync the hint bubble fx sprite with Npc's b2body if it exists.
+  if (_hintBubbleFxSprite) {
+    _hintBubbleFxSprite->setPosition(x, y + HINT_BUBBLE_FX_SPRITE_OFFSET_Y);
   }
 }
 
 bool Npc::showOnMap(float x, float y) {
-  if (_isShownOnMap || _isKilled) {
+  if (_isShownOnMap || hot().isKilled) {
     return false;
   }
 
   _isShownOnMap = true;
+  StatsSystem::getInstance()->setRegenEnabled(_statsIndex, true);
 
   // Construct b2Body and b2Fixtures.
-  // The category/mask bits of each fixture are set in Npc::setDisposition()
-  // based on the disposition of this npc.
-  defineBody(b2BodyType::b2_dynamicBody, x, y);
-  setDisposition(_disposition);
+  // The category/mask bits of each fixture are looked up from the collision
+  // matrix based on the disposition of this npc (see Npc::setDisposition()).
+  const auto& filters = collision_filters::kCharacterFilters[getCollisionRole(_disposition)];
+  defineBody(b2BodyType::b2_dynamicBody, x, y,
+             filters[FixtureType::BODY].categoryBits,
+             filters[FixtureType::BODY].maskBits,
+             filters[FixtureType::FEET].maskBits,
+             filters[FixtureType::WEAPON].maskBits);
 
   // Load sprites, spritesheets, and animations, and then add them to GameMapManager layer.
-  defineTexture(_characterProfile.textureResDir, x, y);
+  defineTexture(_cold->characterProfile.textureResDir, x, y);
   GameMapManager* gmMgr = GameMapManager::getInstance();
-  gmMgr->getLayer()->addChild(_bodySpritesheet, graphical_layers::kNpcBody);
+  gmMgr->getBatchNodeRegistry()->addChild(_bodySprite, graphical_layers::kNpcBody,
+                                          getPaletteProgramState(_cold->characterProfile.palette));
   for (auto equipment : _equipmentSlots) {
     if (equipment) {
       Equipment::Type type = equipment->getEquipmentProfile().equipmentType;
-      gmMgr->getLayer()->addChild(_equipmentSpritesheets[type], graphical_layers::kEquipment - type);
+      loadEquipmentAnimations(equipment);
+      addEquipmentSpriteToMap(type);
     }
   }
 
@@ -154,7 +167,7 @@ void Npc::defineBody(b2BodyType bodyType, float x, float y,
 
   float scaleFactor = Director::getInstance()->getContentScaleFactor();
   b2Vec2 vertices[4];
-  float sideLength = std::max(_characterProfile.bodyWidth, _characterProfile.bodyHeight) * 1.2;
+  float sideLength = std::max(_cold->characterProfile.bodyWidth, _cold->characterProfile.bodyHeight) * 1.2;
   vertices[0] = {-sideLength / scaleFactor,  sideLength / scaleFactor};
   vertices[1] = { sideLength / scaleFactor,  sideLength / scaleFactor};
   vertices[2] = {-sideLength / scaleFactor, -sideLength / scaleFactor};
@@ -170,61 +183,77 @@ void Npc::defineBody(b2BodyType bodyType, float x, float y,
 
 void Npc::import(const string& jsonFileName) {
   Character::import(jsonFileName);
-  _npcProfile = Npc::Profile(jsonFileName);
+  _npcProfile = *profile_cache::get<Npc::Profile>(jsonFileName);
 }
 
+void Npc::reset() {
+  Character::reset();
 
-void Npc::onKilled() {
-  Character::onKilled();
+  _dialogueTree.import(_npcProfile.dialogueTreeJsonFile);
+  _disposition = _npcProfile.disposition;
+  _isSandboxing = _npcProfile.shouldSandbox;
+  _isRemoteControlled = false;
+  removeHintBubbleFx();
 
-  if (!_npcProfile.isRespawnable) {
-    Npc::setNpcAllowedToSpawn(_characterProfile.jsonFileName, false);
+  _isMovingRight = false;
+  _moveDuration = 0;
+  _moveTimer = 0;
+  _waitDuration = 0;
+  _waitTimer = 0;
+  _calculateDistanceTimer = 0;
+  _lastStoppedPosition = {0, 0};
+
+  _navPath.clear();
+  _navPathIndex = 0;
+  _navGoalNode = -1;
+  _hasNavPlan = false;
+  _navPlanTarget = nullptr;
+  _isOnNavPath = false;
+
+  _threats.clear();
+  _aggroQueryTimer = rand_util::randFloat(0, NPC_AGGRO_QUERY_INTERVAL, rand_util::Stream::AI);
+  _aggroTarget = nullptr;
+
+  if (_npcProfile.isUnsheathed) {
+    unsheathWeapon();
   }
 }
 
 
-void Npc::inflictDamage(Character* target, int damage) {
-  Character::inflictDamage(target, damage);
+void Npc::onKilled() {
+  Character::onKilled();
 
-  // If this Npc is in the player's party, and this Npc kills an enemy,
-  // then update player's quests with KillTargetObjective.
-  if (_disposition == Npc::Disposition::ALLY && target->isSetToKill() && _party) {
-    auto player = dynamic_cast<Player*>(_party->getLeader());
-    if (player) {
-      player->updateKillTargetObjectives(target);
-    }
+  if (!_npcProfile.isRespawnable) {
+    Npc::setNpcAllowedToSpawn(_cold->characterProfile.id, false);
+  } else if (GameMap* gameMap = GameMapManager::getInstance()->getGameMap()) {
+    gameMap->onNpcKilled(this);
   }
 }
 
+
 void Npc::receiveDamage(Character* source, int damage) {
   Character::receiveDamage(source, damage);
   _isAlerted = true;
+  addThreat(source, damage);
 
 
-  if (!_isSetToKill) {
+  if (!hot().isSetToKill) {
     return;
   }
 
   // Give exp point to source character.
-  source->addExp(_characterProfile.exp);
+  source->addExp(_cold->characterProfile.exp);
  
-  // Drop items. (Here we'll use a callback to drop items
-  // since creating fixtures during collision callback will crash)
-  // See: https://github.com/libgdx/libgdx/issues/2730
-  CallbackManager::getInstance()->runAfter([=]() {
-    for (const auto& i : _npcProfile.droppedItems) {
-      const string& itemJson = i.first;
-      float dropChance = i.second.chance;
-
-      float randChance = rand_util::randInt(0, 100);
-      if (randChance <= dropChance) {
-        float x = _body->GetPosition().x;
-        float y = _body->GetPosition().y;
-        int amount = rand_util::randInt(i.second.minAmount, i.second.maxAmount);
-        GameMapManager::getInstance()->getGameMap()->createItem(itemJson, x * kPpm, y * kPpm, amount);
-      }
-    }
-  }, .2f);
+  // Drop items. Creating fixtures during b2World::Step() will crash
+  // (see: https://github.com/libgdx/libgdx/issues/2730), but the contacts
+  // are dispatched after the step (see WorldContactListener), so it's safe
+  // to create them right away.
+  LootTable::Drops drops;
+  _npcProfile.lootTable->roll(rand_util::getStream(rand_util::Stream::LOOT), drops);
+
+  float x = _body->GetPosition().x;
+  float y = _body->GetPosition().y;
+  GameMapManager::getInstance()->getGameMap()->dropLoot(drops, x * kPpm, y * kPpm);
 }
 
 void Npc::interact(Interactable* target) {
@@ -279,14 +308,15 @@ void Npc::removeHintBubbleFx() {
 void Npc::updateDialogueTreeIfNeeded() {
   // Fetch the latest update from DialogueTree::_latestNpcDialogueTree.
   // See gameplay/DialogueTree.cc
-  string latestDialogueTreeJsonFileName
-    = DialogueTree::getLatestNpcDialogueTree(_characterProfile.jsonFileName);
+  const string& latestDialogueTreeJsonFileName
+    = DialogueTree::getLatestNpcDialogueTree(_cold->characterProfile.id);
 
-  if (latestDialogueTreeJsonFileName.empty()) {
+  if (latestDialogueTreeJsonFileName.empty() ||
+      latestDialogueTreeJsonFileName == _dialogueTree.getJsonFileName()) {
     return;
   }
 
-  VGLOG(LOG_INFO, "Loading %s's dialogue tree: %s", _characterProfile.jsonFileName.c_str(),
+  VGLOG(LOG_INFO, "Loading %s's dialogue tree: %s", _cold->characterProfile.jsonFileName.c_str(),
                                                     latestDialogueTreeJsonFileName.c_str());
   _dialogueTree = DialogueTree(latestDialogueTreeJsonFileName, this);
 }
@@ -297,11 +327,12 @@ void Npc::beginDialogue() {
   }
 
   onDialogueBegin();
+  _dialogueTree.update();
 
   auto dialogueMgr = DialogueManager::getInstance();
   dialogueMgr->setTargetNpc(this);
   for (const auto& line : _dialogueTree.getCurrentNode()->getLines()) {
-    dialogueMgr->getSubtitles()->addSubtitle(line);
+    dialogueMgr->getSubtitles()->addSubtitle(line.getText());
   }
   dialogueMgr->getSubtitles()->beginSubtitles();
 }
@@ -323,11 +354,45 @@ void Npc::onDialogueEnd() {
 }
 
 
+void Npc::think() {
+  _hasNavPlan = false;
+  _aggroTarget = nullptr;
+
+  if (!_isShownOnMap || hot().isKilled || world_epoch::isInTransition() ||
+      hot().isSetToKill || hot().isAttacking) {
+    return;
+  }
+
+  if (_aggroQueryTimer >= NPC_AGGRO_QUERY_INTERVAL) {
+    _aggroQueryTimer = 0;
+    acquireTarget();
+  }
+
+  // Path finding is the most expensive part of the AI,
+  // so plan the path ahead of act().
+  Character* target = getMoveTarget();
+  if (!target || !target->getBody()) {
+    return;
+  }
+
+  _navPlanTarget = target;
+  _isOnNavPath = planNavPath(target);
+  _hasNavPlan = true;
+}
+
 void Npc::act(float delta) {
-  if (_isKilled || _isSetToKill || _isAttacking) {
+  VGTRACE_ZONE("Npc::act");
+  FrameProfiler::ScopedTimer timer(FrameProfiler::Section::AI);
+  FrameBudget::ScopedOffender offender(FrameBudget::Subsystem::AI, getCharacterProfile().name);
+  if (hot().isKilled || hot().isSetToKill || hot().isAttacking) {
     return;
   }
 
+  if (_aggroTarget && _aggroTarget != _lockedOnTarget) {
+    lockOn(_aggroTarget);
+  }
+  _aggroTarget = nullptr;
+
 
   // This Npc may perform one of the following actions:
   // (1) Has `_lockedOnTarget` and `_lockedOnTarget` is not dead yet:
@@ -341,10 +406,10 @@ void Npc::act(float delta) {
 
   if (_lockedOnTarget && !_lockedOnTarget->isSetToKill()) {
 
-    if (!_inRangeTargets.empty()) {  // target is within attack range
+    if (isInAttackRange(_lockedOnTarget)) {  // target is within attack range
       attack();
     } else {  // target not within attack range
-      moveToTarget(delta, _lockedOnTarget, _characterProfile.attackRange / kPpm);
+      moveToTarget(delta, _lockedOnTarget, _cold->characterProfile.attackRange / kPpm);
     }
 
   } else if (_lockedOnTarget && _lockedOnTarget->isSetToKill()) {
@@ -352,8 +417,19 @@ void Npc::act(float delta) {
     setLockedOnTarget(nullptr);
     findNewLockedOnTargetFromParty(killedTarget);
   } else if (_party && !isWaitingForPlayer()) {
-    moveToTarget(delta, _party->getLeader(), ALLY_FOLLOW_DISTANCE);
+    followPartyLeader(delta);
   } else if (_isSandboxing) {
+    // There's no point wandering around while no one is watching, so let
+    // this Npc's b2Body fall asleep until it comes back into view
+    // (see GameMapManager::getUpdateLod()), or until an awake body
+    // (e.g., another character) bumps into it, in which case box2d wakes it up.
+    if (!hot().isInView) {
+      if (_body->IsAwake() && !hot().isJumping &&
+          _body->GetLinearVelocity().LengthSquared() < NPC_ASLEEP_VELOCITY_SQUARED) {
+        _body->SetAwake(false);
+      }
+      return;
+    }
     moveRandomly(delta, 0, 5, 0, 5);
   }
 }
@@ -372,41 +448,233 @@ void Npc::findNewLockedOnTargetFromParty(Character* killedTarget) {
 }
 
 void Npc::moveToTarget(float delta, Character* target, float followDistance) {
-  assert(_body != nullptr);
-
   if (!target->getBody()) {
     VGLOG(LOG_WARN, "Unable to move to target: %s (b2body missing)",
                     target->getCharacterProfile().name.c_str());
     return;
   }
+  moveToTarget(delta, target, target->getBody()->GetPosition().x, followDistance);
+}
+
+void Npc::moveToTarget(float delta, Character* target, float targetX, float followDistance) {
+  assert(_body != nullptr && target->getBody() != nullptr);
+
+  // If the target is on another surface (e.g., a platform above),
+  // walk/jump/drop our way there along the map's NavGraph.
+  if (moveAlongNavPath(target)) {
+    jumpIfStucked(delta, /*checkInterval=*/.5f);
+    return;
+  }
 
   const b2Vec2& thisPos = _body->GetPosition();
-  const b2Vec2& targetPos = target->getBody()->GetPosition();
   
   // If this character is already close enough to the target character,
   // we could return at once.
-  if (std::abs(thisPos.x - targetPos.x) <= followDistance) {
+  if (std::abs(thisPos.x - targetX) <= followDistance) {
     return;
   }
 
   // Sometimes when Npcs are too close to each other,
   // they will stuck in the same place, unable to attack each other.
   // This is most likely because they are facing at the wrong direction.
-  _isFacingRight = targetPos.x - thisPos.x > 0;
+  hot().isFacingRight = targetX - thisPos.x > 0;
 
-  (thisPos.x > targetPos.x) ? moveLeft() : moveRight();
+  (thisPos.x > targetX) ? moveLeft() : moveRight();
+
+  // Jump over the wall in front of us right away,
+  // instead of waiting for jumpIfStucked() to notice.
+  PhysicsQueryService* queries = GameMapManager::getInstance()->getPhysicsQueryService();
+  if (!hot().isJumping && queries->isWallAhead(this, hot().isFacingRight)) {
+    jump();
+  }
   jumpIfStucked(delta, /*checkInterval=*/.5f);
 }
 
+void Npc::followPartyLeader(float delta) {
+  Character* leader = _party->getLeader();
+  const b2Vec2* slot = _party->getFormationSlot(this);
+
+  if (!slot || !leader->getBody()) {
+    moveToTarget(delta, leader, ALLY_FOLLOW_DISTANCE);
+    return;
+  }
+  moveToTarget(delta, leader, slot->x, ALLY_FORMATION_SLOT_TOLERANCE);
+}
+
+bool Npc::moveAlongNavPath(Character* target) {
+  // Use the path planned by think() if there's one, otherwise plan it now.
+  const bool isOnNavPath = (_hasNavPlan && _navPlanTarget == target) ? _isOnNavPath :
+                                                                       planNavPath(target);
+  _hasNavPlan = false;
+  if (!isOnNavPath) {
+    return false;
+  }
+
+  // While in the air, keep going until we land on the next surface.
+  if (hot().isJumping) {
+    hot().isFacingRight ? moveRight() : moveLeft();
+    return true;
+  }
+
+  // Head for where we should take off, and then take the edge.
+  const NavGraph& navGraph = GameMapManager::getInstance()->getGameMap()->getSpec()->navGraph;
+  const NavGraph::Edge& edge = navGraph.getEdges()[_navPath[_navPathIndex]];
+  const float thisX = kPpm * _body->GetPosition().x;
+
+  if (std::abs(thisX - edge.x) > NAV_TAKE_OFF_TOLERANCE) {
+    hot().isFacingRight = edge.x > thisX;
+  } else {
+    hot().isFacingRight = edge.isTowardsRight;
+    if (edge.type == NavGraph::EdgeType::JUMP) {
+      jump();
+    } else if (edge.type == NavGraph::EdgeType::DROP_THROUGH) {
+      jumpDown();
+    }
+  }
+
+  hot().isFacingRight ? moveRight() : moveLeft();
+  return true;
+}
+
+Character* Npc::getMoveTarget() const {
+  // Same as the branches of Npc::act() which call moveToTarget().
+  if (_lockedOnTarget) {
+    return (!_lockedOnTarget->isSetToKill() && !isInAttackRange(_lockedOnTarget)) ? _lockedOnTarget : nullptr;
+  } else if (_party && !isWaitingForPlayer()) {
+    return _party->getLeader();
+  }
+  return nullptr;
+}
+
+void Npc::acquireTarget() {
+  const b2Vec2& thisPos = _body->GetPosition();
+
+  // Only reads the spatial index built during the last frame,
+  // and the player's party, so it's safe to run in parallel.
+  thread_local vector<DynamicActor*> nearbyActors;
+  thread_local vector<Character*> candidates;
+  nearbyActors.clear();
+  candidates.clear();
+
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  gmMgr->getGameMap()->queryDynamicActors(thisPos, NPC_AGGRO_RADIUS,
+                                          ActorRegistry::Group::NPC, nearbyActors);
+  for (auto actor : nearbyActors) {
+    candidates.push_back(static_cast<Npc*>(actor));
+  }
+
+  // The player and its allies aren't in the spatial index.
+  if (Player* player = gmMgr->getPlayer()) {
+    const auto& party = player->getParty();
+    const float radiusSquared = NPC_AGGRO_RADIUS * NPC_AGGRO_RADIUS;
+    for (auto character : party->getLeaderAndMembers()) {
+      if (character->getBody() &&
+          (character->getBody()->GetPosition() - thisPos).LengthSquared() <= radiusSquared) {
+        candidates.push_back(character);
+      }
+    }
+  }
+
+  candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this](Character* c) {
+    return c == this || c->isSetToKill() || !c->getBody() || !isHostileTo(c);
+  }), candidates.end());
+
+  // Forget the targets which have gone out of range (or have been deleted).
+  _threats.erase(std::remove_if(_threats.begin(), _threats.end(), [](const Threat& threat) {
+    return std::find(candidates.begin(), candidates.end(), threat.target) == candidates.end();
+  }), _threats.end());
+
+  for (auto candidate : candidates) {
+    const float distance = (candidate->getBody()->GetPosition() - thisPos).Length();
+    const float proximityThreat = NPC_PROXIMITY_THREAT * (1 - distance / NPC_AGGRO_RADIUS);
+    auto it = std::find_if(_threats.begin(), _threats.end(), [candidate](const Threat& threat) {
+      return threat.target == candidate;
+    });
+    if (it == _threats.end()) {
+      _threats.push_back({candidate, proximityThreat});
+    } else {
+      it->value = it->value * NPC_THREAT_DECAY + proximityThreat;
+    }
+  }
+
+  auto mostThreatening = std::max_element(_threats.begin(), _threats.end(),
+                                          [](const Threat& t1, const Threat& t2) {
+    return t1.value < t2.value;
+  });
+  if (mostThreatening == _threats.end() || mostThreatening->target == _lockedOnTarget) {
+    return;
+  }
+
+  // Don't keep switching between targets of similar threat.
+  float lockedOnTargetThreat = 0;
+  if (_lockedOnTarget && !_lockedOnTarget->isSetToKill()) {
+    for (const auto& threat : _threats) {
+      if (threat.target == _lockedOnTarget) {
+        lockedOnTargetThreat = threat.value;
+      }
+    }
+    if (lockedOnTargetThreat == 0) {  // out of range, but still being chased
+      return;
+    }
+  }
+  if (mostThreatening->value > lockedOnTargetThreat * NPC_THREAT_SWITCH_RATIO) {
+    _aggroTarget = mostThreatening->target;
+  }
+}
+
+bool Npc::planNavPath(Character* target) {
+  const NavGraph& navGraph = GameMapManager::getInstance()->getGameMap()->getSpec()->navGraph;
+  if (navGraph.empty()) {
+    return false;
+  }
+
+  const b2Vec2 thisPos = kPpm * _body->GetPosition();
+  const b2Vec2 targetPos = kPpm * target->getBody()->GetPosition();
+  const int currentNode = navGraph.findNode(
+      {thisPos.x, thisPos.y - _cold->characterProfile.bodyHeight / 2});
+  const int goalNode = navGraph.findNode(
+      {targetPos.x, targetPos.y - target->getCharacterProfile().bodyHeight / 2});
+
+  if (currentNode == -1 || goalNode == -1 || currentNode == goalNode) {
+    _navPath.clear();
+    _navGoalNode = -1;
+    return false;
+  }
+
+  // While in the air, the path is kept as is.
+  if (hot().isJumping && !_navPath.empty()) {
+    return true;
+  }
+
+  const auto& edges = navGraph.getEdges();
+  while (_navPathIndex < _navPath.size() && edges[_navPath[_navPathIndex]].to == currentNode) {
+    _navPathIndex++;
+  }
+
+  // The path is reused across frames. Only replan if the target has moved
+  // onto another surface, or if we've strayed from the path (e.g., knocked back).
+  if (goalNode != _navGoalNode ||
+      _navPathIndex >= _navPath.size() ||
+      edges[_navPath[_navPathIndex]].from != currentNode) {
+    _navGoalNode = goalNode;
+    _navPathIndex = 0;
+    if (!navGraph.findPath(currentNode, goalNode, _navPath) || _navPath.empty()) {
+      _navPath.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
 void Npc::moveRandomly(float delta,
                        int minMoveDuration, int maxMoveDuration,
                        int minWaitDuration, int maxWaitDuration) {
   // If the character has finished moving and waiting, regenerate random values for
   // _moveDuration and _waitDuration within the specified range.
   if (_moveTimer >= _moveDuration && _waitTimer >= _waitDuration) {
-    _isMovingRight = static_cast<bool>(rand_util::randInt(0, 1));
-    _moveDuration = rand_util::randInt(minMoveDuration, maxMoveDuration);
-    _waitDuration = rand_util::randInt(minWaitDuration, maxWaitDuration);
+    _isMovingRight = static_cast<bool>(rand_util::randInt(0, 1, rand_util::Stream::AI));
+    _moveDuration = rand_util::randInt(minMoveDuration, maxMoveDuration, rand_util::Stream::AI);
+    _waitDuration = rand_util::randInt(minWaitDuration, maxWaitDuration, rand_util::Stream::AI);
     _moveTimer = 0;
     _waitTimer = 0;
   }
@@ -414,6 +682,12 @@ void Npc::moveRandomly(float delta,
   if (_moveTimer >= _moveDuration) {
     _waitTimer += delta;
   } else {
+    // Don't walk off a cliff, even if there's no kPivotMarker in front of it.
+    PhysicsQueryService* queries = GameMapManager::getInstance()->getPhysicsQueryService();
+    if (!hot().isJumping && !queries->isGroundAhead(this, _isMovingRight)) {
+      reverseDirection();
+    }
+
     _moveTimer += delta;
     (_isMovingRight) ? moveRight() : moveLeft();
     jumpIfStucked(delta, /*checkInterval=*/.5f);
@@ -442,12 +716,32 @@ void Npc::reverseDirection() {
 }
 
 
+bool Npc::isBoundToWorldEpoch() const {
+  return !isInPlayerParty();
+}
+
 bool Npc::isInPlayerParty() const {
   return (_party) ? dynamic_cast<Player*>(_party->getLeader()) != nullptr : false;
 }
 
 bool Npc::isWaitingForPlayer() const {
-  return isInPlayerParty() && _party->hasWaitingMember(_characterProfile.jsonFileName);
+  return isInPlayerParty() && _party->hasWaitingMember(_cold->characterProfile.id);
+}
+
+bool Npc::isHostileTo(const Character* other) const {
+  const Npc* otherNpc = dynamic_cast<const Npc*>(other);
+  const Npc::Disposition otherFaction = (otherNpc) ? otherNpc->_disposition : Npc::Disposition::ALLY;
+  return _disposition != otherFaction;
+}
+
+void Npc::addThreat(Character* source, float threat) {
+  for (auto& entry : _threats) {
+    if (entry.target == source) {
+      entry.value += threat;
+      return;
+    }
+  }
+  _threats.push_back({source, threat});
 }
 
 
@@ -467,26 +761,21 @@ bool Npc::isSandboxing() const {
   return _isSandboxing;
 }
 
+bool Npc::isRemoteControlled() const {
+  return _isRemoteControlled;
+}
+
 
 void Npc::setDisposition(Npc::Disposition disposition) {
   _disposition = disposition;
 
-  switch (disposition) {
-    case Npc::Disposition::ALLY:
-      DynamicActor::setCategoryBits(_fixtures[FixtureType::BODY], ALLY_BODY_CATEGORY_BITS);
-      DynamicActor::setMaskBits(_fixtures[FixtureType::BODY], ALLY_BODY_MASK_BITS);
-      DynamicActor::setMaskBits(_fixtures[FixtureType::FEET], ALLY_FEET_MASK_BITS);
-      DynamicActor::setMaskBits(_fixtures[FixtureType::WEAPON], ALLY_WEAPON_MASK_BITS);
-      break;
-    case Npc::Disposition::ENEMY:
-      DynamicActor::setCategoryBits(_fixtures[FixtureType::BODY], ENEMY_BODY_CATEGORY_BITS);
-      DynamicActor::setMaskBits(_fixtures[FixtureType::BODY], ENEMY_BODY_MASK_BITS);
-      DynamicActor::setMaskBits(_fixtures[FixtureType::FEET], ENEMY_FEET_MASK_BITS);
-      DynamicActor::setMaskBits(_fixtures[FixtureType::WEAPON], ENEMY_WEAPON_MASK_BITS);
-      break;
-    default:
-      VGLOG(LOG_ERR, "Invalid disposition for user: %s", _characterProfile.name.c_str());
-      break;
+  if (disposition != Npc::Disposition::ALLY && disposition != Npc::Disposition::ENEMY) {
+    VGLOG(LOG_ERR, "Invalid disposition for user: %s", _cold->characterProfile.name.c_str());
+    return;
+  }
+
+  if (_body) {
+    setCollisionRole(getCollisionRole(disposition));
   }
 }
 
@@ -494,41 +783,40 @@ void Npc::setSandboxing(bool sandboxing) {
   _isSandboxing = sandboxing;
 }
 
+void Npc::setRemoteControlled(bool remoteControlled) {
+  _isRemoteControlled = remoteControlled;
+}
+
 
-void Npc::setNpcsAllowedToAct(bool npcsAllowedToAct) {
-  Npc::_areNpcsAllowedToAct = npcsAllowedToAct;
+collision_filters::Role Npc::getCollisionRole(Npc::Disposition disposition) {
+  return (disposition == Npc::Disposition::ALLY) ? collision_filters::Role::ALLY
+                                                 : collision_filters::Role::ENEMY;
 }
 
-bool Npc::isNpcAllowedToSpawn(const string& jsonFileName) {
-  return Npc::_npcSpawningBlacklist.find(jsonFileName)
+
+bool Npc::isNpcAllowedToSpawn(AssetId npcId) {
+  // The npcs shown on the co-op client are the replicas of the host's.
+  if (CoopSession::getInstance()->isClient()) {
+    return false;
+  }
+  return Npc::_npcSpawningBlacklist.find(npcId)
       == Npc::_npcSpawningBlacklist.end();
 }
 
-void Npc::setNpcAllowedToSpawn(const string& jsonFileName, bool canSpawn) {
-  if (!canSpawn && Npc::isNpcAllowedToSpawn(jsonFileName)) {
-    Npc::_npcSpawningBlacklist.insert(jsonFileName);
-  } else if (canSpawn && !Npc::isNpcAllowedToSpawn(jsonFileName)) {
-    Npc::_npcSpawningBlacklist.erase(jsonFileName);
+void Npc::setNpcAllowedToSpawn(AssetId npcId, bool canSpawn) {
+  if (canSpawn) {
+    Npc::_npcSpawningBlacklist.erase(npcId);
+  } else {
+    Npc::_npcSpawningBlacklist.insert(npcId);
   }
 }
 
 
 Npc::Profile::Profile(const string& jsonFileName) {
-  Document json = json_util::parseJson(jsonFileName);
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  Document& json = jsonDocument.get();
 
-  const auto& droppedItemsMap = json["droppedItems"].GetObject();
-  if (!droppedItemsMap.ObjectEmpty()) {
-    for (const auto& keyValue : droppedItemsMap) {
-      const auto& droppedItemDataJson = keyValue.value.GetObject();
-
-      DroppedItemData droppedItemData;
-      droppedItemData.chance = droppedItemDataJson["chance"].GetInt();
-      droppedItemData.minAmount = droppedItemDataJson["minAmount"].GetInt();
-      droppedItemData.maxAmount = droppedItemDataJson["maxAmount"].GetInt();
-
-      droppedItems.insert({keyValue.name.GetString(), droppedItemData});
-    }
-  }
+  lootTable = std::make_shared<const LootTable>(json);
 
   dialogueTreeJsonFile = json["dialogueTree"].GetString();
   disposition = static_cast<Npc::Disposition>(json["disposition"].GetInt());
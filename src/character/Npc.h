@@ -2,7 +2,7 @@
 #ifndef VIGILANTE_NPC_H_
 #define VIGILANTE_NPC_H_
 
-#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_set>
@@ -10,10 +10,13 @@
 #include <cocos2d.h>
 #include "Character.h"
 #include "Interactable.h"
+#include "item/LootTable.h"
 #include "gameplay/DialogueTree.h"
 
 namespace vigilante {
 
+class GameState;
+
 // Npc: Non-player character
 // i.e., enemies and allies are all npcs.
 class Npc : public Character, public Interactable {
@@ -29,13 +32,9 @@ class Npc : public Character, public Interactable {
     explicit Profile(const std::string& jsonFileName);
     ~Profile() = default;
 
-    struct DroppedItemData {
-      int chance;
-      int minAmount;
-      int maxAmount;
-    };
-    // <json, {chance, minAmount, maxAmount}>
-    std::unordered_map<std::string, DroppedItemData> droppedItems;
+    // Compiled from the "droppedItems" (and optionally "lootTables" and
+    // "lootPool") of the npc's json. Shared by all instances of this npc.
+    std::shared_ptr<const LootTable> lootTable;
 
     std::string dialogueTreeJsonFile;
     Npc::Disposition disposition;
@@ -62,11 +61,12 @@ class Npc : public Character, public Interactable {
 
   virtual bool showOnMap(float x, float y) override;  // Character
   virtual void update(float delta) override;  // Character
+  virtual void syncTransform(float x, float y) override;  // Character
   virtual void import(const std::string& jsonFileName) override;  // Character
+  virtual void reset() override;  // Character
 
   virtual void onKilled() override;  // Character
 
-  virtual void inflictDamage(Character* target, int damage) override;  // Character
   virtual void receiveDamage(Character* source, int damage) override;  // Character
   virtual void interact(Interactable* target) override;  // Character
 
@@ -83,9 +83,17 @@ class Npc : public Character, public Interactable {
   void onDialogueEnd();
 
 
+  // The AI of each Npc runs in two phases every frame. think() only reads the
+  // state of the other characters and the map, so it can run in parallel for
+  // all Npcs (see GameMapManager::update()). act() then issues the actions
+  // planned by think() on the main thread.
+  void think();
   void act(float delta);
   void findNewLockedOnTargetFromParty(Character* killedTarget);
   void moveToTarget(float delta, Character* target, float followDistance);
+  // Moves towards `targetX` (in meters) on the surface where `target` is.
+  void moveToTarget(float delta, Character* target, float targetX, float followDistance);
+  void followPartyLeader(float delta);  // to its formation slot, see Party::updateFormation()
   void moveRandomly(float delta,
                     int minMoveDuration, int maxMoveDuration,
                     int minWaitDuration, int maxWaitDuration);
@@ -95,19 +103,26 @@ class Npc : public Character, public Interactable {
   bool isInPlayerParty() const;
   bool isWaitingForPlayer() const;
 
+  // Characters are hostile to each other if they belong to different
+  // factions. The player belongs to the same faction as ALLY Npcs.
+  bool isHostileTo(const Character* other) const;
+  void addThreat(Character* source, float threat);
+
   
   Npc::Profile& getNpcProfile();
   DialogueTree& getDialogueTree();
   Npc::Disposition getDisposition() const;
   bool isSandboxing() const;
+  // A remote controlled npc doesn't act on its own, e.g., the ally controlled
+  // by the co-op client, and the replicas on the client (see net/CoopSession.h).
+  bool isRemoteControlled() const;
 
   void setDisposition(Npc::Disposition disposition);
   void setSandboxing(bool sandboxing);
+  void setRemoteControlled(bool remoteControlled);
 
-  static void setNpcsAllowedToAct(bool npcsAllowedToAct);
-
-  static bool isNpcAllowedToSpawn(const std::string& jsonFileName);
-  static void setNpcAllowedToSpawn(const std::string& jsonFileName, bool canSpawn);
+  static bool isNpcAllowedToSpawn(AssetId npcId);
+  static void setNpcAllowedToSpawn(AssetId npcId, bool canSpawn);
 
 
  private:
@@ -119,21 +134,44 @@ class Npc : public Character, public Interactable {
                           short feetMaskBits=0,
                           short weaponMaskBits=0) override;  // Character
 
+  // The Npcs which aren't in the player's party are left behind
+  // when the player leaves the GameMap.
+  virtual bool isBoundToWorldEpoch() const override;  // Character
+
   virtual void createHintBubbleFx() override;  // Interactable
   virtual void removeHintBubbleFx() override;  // Interactable
 
+  static collision_filters::Role getCollisionRole(Npc::Disposition disposition);
+
+  // Moves along the path (on the map's NavGraph) towards the surface
+  // which `target` is standing on. Returns false if `target` is on
+  // the same surface as this Npc, or if there's no such path.
+  bool moveAlongNavPath(Character* target);
 
-  // See `map/GameMap.cc` for its usage.
-  static std::atomic<bool> _areNpcsAllowedToAct;
+  // Returns the character which this Npc is going to move to in act().
+  Character* getMoveTarget() const;
 
-  // Once those spawn-once NPCs are killed, their jsonFileName
+  // Updates the path (on the map's NavGraph) towards the surface which
+  // `target` is standing on, without moving. Returns true if this Npc
+  // should move along the path, see moveAlongNavPath().
+  bool planNavPath(Character* target);
+
+  // Looks for the hostile characters within the aggro radius, and
+  // picks the most threatening one as `_aggroTarget`. Called by think().
+  void acquireTarget();
+
+
+  // Once those spawn-once NPCs are killed, their json ids
   // will be inserted into this unordered_set.
-  static std::unordered_set<std::string> _npcSpawningBlacklist;
+  // Saved and restored by GameState.
+  static std::unordered_set<AssetId> _npcSpawningBlacklist;
+  friend class GameState;
 
   Npc::Profile _npcProfile;
   DialogueTree _dialogueTree;
   Npc::Disposition _disposition;
   bool _isSandboxing;
+  bool _isRemoteControlled;
 
   cocos2d::Sprite* _hintBubbleFxSprite;
 
@@ -147,6 +185,28 @@ class Npc : public Character, public Interactable {
   // The following variables are used in Npc::jumpIfStucked()
   float _calculateDistanceTimer;
   b2Vec2 _lastStoppedPosition;
+
+  // The following variables are used in Npc::moveAlongNavPath()
+  std::vector<int> _navPath;  // indices of NavGraph edges
+  size_t _navPathIndex;
+  int _navGoalNode;
+
+  // The following variables are set by Npc::think(),
+  // and consumed by Npc::moveAlongNavPath() in the same frame.
+  bool _hasNavPlan;
+  Character* _navPlanTarget;
+  bool _isOnNavPath;
+
+  // Threat table. The targets are only compared by address until they're
+  // found again by the next spatial query in acquireTarget(), since they
+  // might have been deleted in the meantime.
+  struct Threat final {
+    Character* target;
+    float value;
+  };
+  std::vector<Npc::Threat> _threats;
+  float _aggroQueryTimer;
+  Character* _aggroTarget;  // set by think(), locked on by act()
 };
 
 }  // namespace vigilante
@@ -0,0 +1,46 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "NpcPool.h"
+
+using std::string;
+using std::shared_ptr;
+
+namespace vigilante {
+
+const size_t NpcPool::_kMaxIdleInstancesPerPrototype = 16;
+
+NpcPool* NpcPool::getInstance() {
+  static NpcPool instance;
+  return &instance;
+}
+
+NpcPool::NpcPool() : _idleInstances() {}
+
+
+shared_ptr<Npc> NpcPool::acquire(const string& jsonFileName) {
+  auto it = _idleInstances.find(AssetId(jsonFileName));
+  if (it == _idleInstances.end() || it->second.empty()) {
+    return std::make_shared<Npc>(jsonFileName);
+  }
+
+  shared_ptr<Npc> npc = std::move(it->second.back());
+  it->second.pop_back();
+  npc->reset();
+  return npc;
+}
+
+void NpcPool::release(shared_ptr<Npc> npc) {
+  if (!npc || npc->isShownOnMap() || npc->getParty() || npc.use_count() > 1) {
+    return;
+  }
+
+  auto& idleInstances = _idleInstances[npc->getCharacterProfile().id];
+  if (idleInstances.size() < _kMaxIdleInstancesPerPrototype) {
+    idleInstances.push_back(std::move(npc));
+  }
+}
+
+void NpcPool::clear() {
+  _idleInstances.clear();
+}
+
+}  // namespace vigilante
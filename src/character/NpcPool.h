@@ -0,0 +1,48 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_NPC_POOL_H_
+#define VIGILANTE_NPC_POOL_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "character/Npc.h"
+#include "util/AssetId.h"
+
+namespace vigilante {
+
+// A registry of Npc prototypes (keyed by their json file names), each with
+// a pool of idle instances. Constructing an Npc is expensive (parsing its
+// profiles, creating its default skills and items, ...), so the Npcs which
+// have been killed or unloaded (e.g., by hibernating a map chunk or leaving
+// the map) are released into this pool, and acquire() resets and hands them
+// out again the next time an Npc of the same prototype is spawned.
+//
+// All methods must be called on the main thread.
+class NpcPool final {
+ public:
+  static NpcPool* getInstance();
+
+  // Returns an idle instance of the prototype if there's one,
+  // otherwise a new Npc is constructed.
+  std::shared_ptr<Npc> acquire(const std::string& jsonFileName);
+
+  // `npc` is only pooled if it has been removed from the map, doesn't belong
+  // to any party, and isn't referenced by anyone else. Otherwise it's simply
+  // dropped.
+  void release(std::shared_ptr<Npc> npc);
+
+  void clear();
+
+ private:
+  NpcPool();
+
+  static const size_t _kMaxIdleInstancesPerPrototype;
+
+  std::unordered_map<AssetId, std::vector<std::shared_ptr<Npc>>> _idleInstances;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_NPC_POOL_H_
@@ -1,39 +1,55 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "Party.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <Box2D/Box2D.h>
 #include "Constants.h"
 #include "character/Character.h"
 #include "character/Npc.h"
+#include "character/NpcPool.h"
 #include "map/GameMapManager.h"
 #include "ui/notifications/Notifications.h"
 #include "util/StringUtil.h"
 
+#define PARTY_FORMATION_FOLLOW_DISTANCE .75f  // between the leader and the first slot
+#define PARTY_FORMATION_SLOT_SPACING .4f
+#define PARTY_FORMATION_TURN_VELOCITY .5f
+
+using std::pair;
 using std::string;
 using std::shared_ptr;
 using std::unordered_map;
 using std::unordered_set;
+using std::vector;
 
 namespace vigilante {
 
+uint64_t Party::_nextVersion = 1;
+
 Party::Party(Character* leader)
     : _leader(leader),
       _members(),
-      _waitingMembersLocationInfo() {}
+      _leaderAndMembers({leader}),
+      _version(_nextVersion++),
+      _waitingMembersLocationInfo(),
+      _waitingMembersByMap(),
+      _formationSlots(),
+      _isFormationFacingRight(true) {}
 
 
-Character* Party::getMember(const string& characterJsonFileName) const {
+Character* Party::getMember(AssetId characterId) const {
   auto it = std::find_if(_members.begin(),
                          _members.end(),
-                         [&characterJsonFileName](const shared_ptr<Character>& c) {
-                             return c->getCharacterProfile().jsonFileName
-                                 == characterJsonFileName;
+                         [characterId](const shared_ptr<Character>& c) {
+                             return c->getCharacterProfile().id == characterId;
                          });
   return (it != _members.end()) ? it->get() : nullptr;
 }
 
-bool Party::hasMember(const string& characterJsonFileName) const {
-  return getMember(characterJsonFileName) != nullptr;
+bool Party::hasMember(AssetId characterId) const {
+  return getMember(characterId) != nullptr;
 }
 
 void Party::recruit(Character* targetCharacter) {
@@ -48,20 +64,21 @@ void Party::recruit(Character* targetCharacter) {
   // then we wouldn't want to respawn it.
   shared_ptr<Npc> targetNpc = std::dynamic_pointer_cast<Npc>(target);
   if (!targetNpc->getNpcProfile().isRespawnable) {
-    Npc::setNpcAllowedToSpawn(targetNpc->getCharacterProfile().jsonFileName, false);
+    Npc::setNpcAllowedToSpawn(targetNpc->getCharacterProfile().id, false);
   }
 
   target->showOnMap(targetPos.x * kPpm, targetPos.y * kPpm);
   addMember(std::move(target));
 
+  char buf[128];
   Notifications::getInstance()->show(
-      string_util::format("%s is now following you.",
-                          targetCharacter->getCharacterProfile().name.c_str()));
+      string_util::formatTo(buf, "%s is now following you.",
+                            targetCharacter->getCharacterProfile().name.c_str()));
 }
 
 void Party::dismiss(Character* targetCharacter, bool addToMap) {
-  if (hasWaitingMember(targetCharacter->getCharacterProfile().jsonFileName)) {
-    removeWaitingMember(targetCharacter->getCharacterProfile().jsonFileName);
+  if (hasWaitingMember(targetCharacter->getCharacterProfile().id)) {
+    removeWaitingMember(targetCharacter->getCharacterProfile().id);
   }
 
   const b2Vec2 targetPos = targetCharacter->getBody()->GetPosition();
@@ -74,96 +91,199 @@ void Party::dismiss(Character* targetCharacter, bool addToMap) {
         std::move(target), targetPos.x * kPpm, targetPos.y * kPpm);
   }
 
+  char buf[128];
   Notifications::getInstance()->show(
-      string_util::format("%s has left your party.",
-                          targetCharacter->getCharacterProfile().name.c_str()));
+      string_util::formatTo(buf, "%s has left your party.",
+                            targetCharacter->getCharacterProfile().name.c_str()));
 }
 
 
 void Party::askMemberToWait(Character* targetCharacter) {
   const b2Vec2 targetPos = targetCharacter->getBody()->GetPosition();
 
-  addWaitingMember(targetCharacter->getCharacterProfile().jsonFileName,
-                   GameMapManager::getInstance()->getGameMap()->getTmxTiledMapFileName(),
+  addWaitingMember(targetCharacter->getCharacterProfile().id,
+                   GameMapManager::getInstance()->getGameMap()->getTmxTiledMapId(),
                    targetPos.x,
                    targetPos.y);
 
+  char buf[128];
   Notifications::getInstance()->show(
-      string_util::format("%s will be waiting for you.",
-                          targetCharacter->getCharacterProfile().name.c_str()));
+      string_util::formatTo(buf, "%s will be waiting for you.",
+                            targetCharacter->getCharacterProfile().name.c_str()));
 }
 
 void Party::askMemberToFollow(Character* targetCharacter) {
-  removeWaitingMember(targetCharacter->getCharacterProfile().jsonFileName);
+  removeWaitingMember(targetCharacter->getCharacterProfile().id);
 
+  char buf[128];
   Notifications::getInstance()->show(
-      string_util::format("%s is now following you.",
-                          targetCharacter->getCharacterProfile().name.c_str()));
+      string_util::formatTo(buf, "%s is now following you.",
+                            targetCharacter->getCharacterProfile().name.c_str()));
 }
 
 
-bool Party::hasWaitingMember(const string& characterJsonFileName) const {
-  auto it = _waitingMembersLocationInfo.find(characterJsonFileName);
+bool Party::hasWaitingMember(AssetId characterId) const {
+  auto it = _waitingMembersLocationInfo.find(characterId);
   return it != _waitingMembersLocationInfo.end();
 }
 
-void Party::addWaitingMember(const string& characterJsonFileName,
-                             const string& currentTmxMapFileName,
-                             float x,
-                             float y) {
-  if (hasWaitingMember(characterJsonFileName)) {
+void Party::addWaitingMember(AssetId characterId, AssetId tmxMapId, float x, float y) {
+  if (hasWaitingMember(characterId)) {
     VGLOG(LOG_ERR, "This member is already a waiting member of the party.");
     return;
   }
-  _waitingMembersLocationInfo.insert({characterJsonFileName, {currentTmxMapFileName, x, y}});
+  _waitingMembersLocationInfo.insert({characterId, {tmxMapId, x, y, /*isDormant=*/false}});
+  _waitingMembersByMap[tmxMapId].push_back(characterId);
 }
 
-void Party::removeWaitingMember(const string& characterJsonFileName) {
-  if (!hasWaitingMember(characterJsonFileName)) {
+void Party::removeWaitingMember(AssetId characterId) {
+  auto it = _waitingMembersLocationInfo.find(characterId);
+  if (it == _waitingMembersLocationInfo.end()) {
     VGLOG(LOG_ERR, "This member is not a waiting member of the party.");
     return;
   }
-  _waitingMembersLocationInfo.erase(characterJsonFileName);
+
+  vector<AssetId>& members = _waitingMembersByMap[it->second.tmxMapId];
+  members.erase(std::remove(members.begin(), members.end(), characterId), members.end());
+  _waitingMembersLocationInfo.erase(it);
+}
+
+void Party::clearWaitingMembers() {
+  _waitingMembersLocationInfo.clear();
+  _waitingMembersByMap.clear();
 }
 
 Party::WaitingLocationInfo
-Party::getWaitingMemberLocationInfo(const std::string& characterJsonFileName) const {
-  auto it = _waitingMembersLocationInfo.find(characterJsonFileName);
+Party::getWaitingMemberLocationInfo(AssetId characterId) const {
+  auto it = _waitingMembersLocationInfo.find(characterId);
   if (it == _waitingMembersLocationInfo.end()) {
     VGLOG(LOG_ERR, "This member is not a waiting member of the party");
-    return {"", 0, 0};
+    return {AssetId(), 0, 0, false};
   }
   return it->second;
 }
 
+const vector<AssetId>& Party::getWaitingMembersAt(AssetId tmxMapId) const {
+  static const vector<AssetId> kNoMembers;
+  auto it = _waitingMembersByMap.find(tmxMapId);
+  return (it != _waitingMembersByMap.end()) ? it->second : kNoMembers;
+}
 
-Character* Party::getLeader() const {
-  return _leader;
+void Party::hibernateWaitingMember(Character* member) {
+  auto it = _waitingMembersLocationInfo.find(member->getCharacterProfile().id);
+  if (it == _waitingMembersLocationInfo.end() || it->second.isDormant) {
+    VGLOG(LOG_ERR, "This member is not a waiting member of the party.");
+    return;
+  }
+
+  shared_ptr<Character> removedMember = removeMember(member);
+  if (!removedMember) {
+    return;
+  }
+  removedMember->removeFromMap();
+  it->second.isDormant = true;
+
+  // Only the record is kept. The Npc goes back to the pool once
+  // the last reference to it is dropped here.
+  shared_ptr<Npc> npc = std::dynamic_pointer_cast<Npc>(removedMember);
+  removedMember.reset();
+  NpcPool::getInstance()->release(std::move(npc));
+}
+
+void Party::wakeWaitingMembers(AssetId tmxMapId) {
+  for (const auto characterId : getWaitingMembersAt(tmxMapId)) {
+    WaitingLocationInfo& location = _waitingMembersLocationInfo.at(characterId);
+
+    Character* member = nullptr;
+    if (location.isDormant) {
+      shared_ptr<Npc> npc = NpcPool::getInstance()->acquire(characterId.getName());
+      member = npc.get();
+      addMember(std::move(npc));
+      location.isDormant = false;
+    } else {
+      member = getMember(characterId);
+    }
+
+    if (member) {
+      member->showOnMap(location.x * kPpm, location.y * kPpm);
+    }
+  }
 }
 
-unordered_set<Character*> Party::getLeaderAndMembers() const {
-  unordered_set<Character*> allMembers;
 
-  allMembers.insert(_leader);
-  for (const auto& member : _members) {
-    allMembers.insert(member.get());
+void Party::updateFormation() {
+  _formationSlots.clear();
+
+  const b2Body* leaderBody = _leader->getBody();
+  if (!leaderBody) {
+    return;
+  }
+
+  // Only turn the formation around when the leader actually walks the other
+  // way, so that the members won't swap sides whenever the leader turns around
+  // to attack something.
+  const float leaderVelocityX = leaderBody->GetLinearVelocity().x;
+  if (std::abs(leaderVelocityX) >= PARTY_FORMATION_TURN_VELOCITY) {
+    _isFormationFacingRight = leaderVelocityX > 0;
+  }
+
+  for (auto member : _leaderAndMembers) {
+    if (member != _leader && member->getBody() && !member->isKilled() &&
+        !hasWaitingMember(member->getCharacterProfile().id)) {
+      _formationSlots.push_back({member, member->getBody()->GetPosition()});
+    }
+  }
+
+  // Assign the slots by how far behind the leader each member is right now.
+  const float behind = (_isFormationFacingRight) ? -1.0f : 1.0f;
+  std::sort(_formationSlots.begin(), _formationSlots.end(),
+            [behind](const pair<Character*, b2Vec2>& s1, const pair<Character*, b2Vec2>& s2) {
+    return s1.second.x * behind < s2.second.x * behind;
+  });
+
+  const b2Vec2& leaderPos = leaderBody->GetPosition();
+  for (size_t i = 0; i < _formationSlots.size(); i++) {
+    const float distance = PARTY_FORMATION_FOLLOW_DISTANCE + i * PARTY_FORMATION_SLOT_SPACING;
+    _formationSlots[i].second = {leaderPos.x + behind * distance, leaderPos.y};
   }
-  return allMembers;
+}
+
+const b2Vec2* Party::getFormationSlot(const Character* member) const {
+  auto it = std::find_if(_formationSlots.begin(), _formationSlots.end(),
+                         [member](const pair<Character*, b2Vec2>& slot) {
+    return slot.first == member;
+  });
+  return (it != _formationSlots.end()) ? &it->second : nullptr;
+}
+
+
+Character* Party::getLeader() const {
+  return _leader;
+}
+
+const vector<Character*>& Party::getLeaderAndMembers() const {
+  return _leaderAndMembers;
 }
 
 const unordered_set<shared_ptr<Character>>& Party::getMembers() const {
   return _members;
 }
 
-const unordered_map<string, Party::WaitingLocationInfo>&
+const unordered_map<AssetId, Party::WaitingLocationInfo>&
 Party::getWaitingMembersLocationInfo() const {
   return _waitingMembersLocationInfo;
 }
 
+uint64_t Party::getVersion() const {
+  return _version;
+}
+
 
 void Party::addMember(shared_ptr<Character> character) {
   character->setParty(_leader->getParty());
+  _leaderAndMembers.push_back(character.get());
   _members.insert(std::move(character));
+  _version = _nextVersion++;
 }
 
 shared_ptr<Character> Party::removeMember(Character* character) {
@@ -180,6 +300,9 @@ shared_ptr<Character> Party::removeMember(Character* character) {
 
   removedMember = std::move(*it);
   _members.erase(it);
+  _leaderAndMembers.erase(std::remove(_leaderAndMembers.begin(), _leaderAndMembers.end(), character),
+                          _leaderAndMembers.end());
+  _version = _nextVersion++;
   return removedMember;
 }
 
@@ -2,10 +2,16 @@
 #ifndef VIGILANTE_PARTY_H_
 #define VIGILANTE_PARTY_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+#include "util/AssetId.h"
 
 namespace vigilante {
 
@@ -14,17 +20,22 @@ class Character;
 
 class Party {
  public:
+  // Where a waiting member is waiting. While the leader is on another map,
+  // the member is dormant: it's no longer constructed (it has been released
+  // into the NpcPool), and only this record is kept until the map it's waiting
+  // in is entered again (see wakeWaitingMembers()).
   struct WaitingLocationInfo {
-    std::string tmxMapFileName;
+    AssetId tmxMapId;
     float x;
     float y;
+    bool isDormant;
   };
 
   explicit Party(Character* leader);
   virtual ~Party() = default;
 
-  Character* getMember(const std::string& characterJsonFileName) const;
-  bool hasMember(const std::string& characterJsonFileName) const;
+  Character* getMember(AssetId characterId) const;
+  bool hasMember(AssetId characterId) const;
   void recruit(Character* targetCharacter);
   void dismiss(Character* targetCharacter, bool addToMap=true);
 
@@ -32,27 +43,55 @@ class Party {
   void askMemberToFollow(Character* targetCharacter);  // resume following
 
 
-  bool hasWaitingMember(const std::string& characterJsonFileName) const;
-  void addWaitingMember(const std::string& characterJsonFileName,
-                        const std::string& currentTmxMapFileName,
-                        float x,
-                        float y);
-  void removeWaitingMember(const std::string& characterJsonFileName);
-  Party::WaitingLocationInfo getWaitingMemberLocationInfo(const std::string& characterJsonFileName) const;
+  bool hasWaitingMember(AssetId characterId) const;
+  void addWaitingMember(AssetId characterId, AssetId tmxMapId, float x, float y);
+  void removeWaitingMember(AssetId characterId);
+  void clearWaitingMembers();
+  Party::WaitingLocationInfo getWaitingMemberLocationInfo(AssetId characterId) const;
+  // The members waiting in the map `tmxMapId`.
+  const std::vector<AssetId>& getWaitingMembersAt(AssetId tmxMapId) const;
+
+  // Turns `member`, which is waiting in another map, into a dormant record.
+  void hibernateWaitingMember(Character* member);
+  // Shows the members waiting in the map `tmxMapId` (which has just been loaded),
+  // rehydrating the dormant ones through the NpcPool.
+  void wakeWaitingMembers(AssetId tmxMapId);
+
+  // The follow formation, updated once per frame (see GameMapManager::update())
+  // from the leader's position and heading. The following members are lined up
+  // behind the leader, one slot each, in the order they're currently standing,
+  // so that they don't have to cross (and bump into) each other to get there.
+  void updateFormation();
+  // Returns nullptr if `member` has no slot (e.g., it's waiting somewhere).
+  const b2Vec2* getFormationSlot(const Character* member) const;
 
   Character* getLeader() const;
-  std::unordered_set<Character*> getLeaderAndMembers() const;
+  const std::vector<Character*>& getLeaderAndMembers() const;  // the leader comes first
   const std::unordered_set<std::shared_ptr<Character>>& getMembers() const;
-  const std::unordered_map<std::string, Party::WaitingLocationInfo>& getWaitingMembersLocationInfo() const;
+
+  // Changes whenever a member is added or removed, and is unique among all
+  // parties, so the cached views of the members (e.g., Character::getAllies())
+  // can tell whether they're outdated.
+  uint64_t getVersion() const;
+  const std::unordered_map<AssetId, Party::WaitingLocationInfo>& getWaitingMembersLocationInfo() const;
 
  protected:
   void addMember(std::shared_ptr<Character> character);
   std::shared_ptr<Character> removeMember(Character* character);
 
+  static uint64_t _nextVersion;
+
   // `_leader` will NOT be in `_members`.
   Character* _leader;
   std::unordered_set<std::shared_ptr<Character>> _members;
-  std::unordered_map<std::string, Party::WaitingLocationInfo> _waitingMembersLocationInfo;
+  std::vector<Character*> _leaderAndMembers;
+  uint64_t _version;
+  std::unordered_map<AssetId, Party::WaitingLocationInfo> _waitingMembersLocationInfo;
+  // tmx map id -> the members waiting there
+  std::unordered_map<AssetId, std::vector<AssetId>> _waitingMembersByMap;
+
+  std::vector<std::pair<Character*, b2Vec2>> _formationSlots;
+  bool _isFormationFacingRight;
 };
 
 }  // namespace vigilante
@@ -7,10 +7,14 @@
 #include "AssetManager.h"
 #include "CallbackManager.h"
 #include "Constants.h"
+#include "EventBus.h"
 #include "character/Party.h"
+#include "gameplay/CheckpointManager.h"
+#include "gameplay/PickupSystem.h"
 #include "input/InputManager.h"
 #include "input/HotkeyManager.h"
 #include "input/Keybindable.h"
+#include "item/LootBag.h"
 #include "map/GameMapManager.h"
 #include "skill/Skill.h"
 #include "skill/BackDash.h"
@@ -18,18 +22,15 @@
 #include "skill/MagicalMissile.h"
 #include "quest/KillTargetObjective.h"
 #include "ui/Shade.h"
-#include "ui/hud/Hud.h"
 #include "ui/notifications/Notifications.h"
-#include "util/CameraUtil.h"
+#include "util/KeyCodeUtil.h"
 #include "util/StringUtil.h"
 
-#define PLAYER_BODY_CATEGORY_BITS kPlayer
-#define PLAYER_BODY_MASK_BITS kFeet | kEnemy | kMeleeWeapon | kProjectile
-#define PLAYER_FEET_MASK_BITS kGround | kPlatform | kWall | kItem | kNpc | kPortal | kInteractable
-#define PLAYER_WEAPON_MASK_BITS kEnemy
+#define PLAYER_INPUT_BUFFER_FRAMES 8
 
 using std::string;
 using std::vector;
+using std::pair;
 using std::shared_ptr;
 using cocos2d::Vector;
 using cocos2d::Director;
@@ -47,18 +48,6 @@ using cocos2d::FadeOut;
 using cocos2d::CallFunc;
 using cocos2d::Sequence;
 using cocos2d::EventKeyboard;
-using vigilante::category_bits::kPlayer;
-using vigilante::category_bits::kEnemy;
-using vigilante::category_bits::kNpc;
-using vigilante::category_bits::kFeet;
-using vigilante::category_bits::kMeleeWeapon;
-using vigilante::category_bits::kItem;
-using vigilante::category_bits::kGround;
-using vigilante::category_bits::kPlatform;
-using vigilante::category_bits::kWall;
-using vigilante::category_bits::kPortal;
-using vigilante::category_bits::kInteractable;
-using vigilante::category_bits::kProjectile;
 
 namespace vigilante {
 
@@ -71,27 +60,31 @@ Player::Player(const std::string& jsonFileName)
 
 
 bool Player::showOnMap(float x, float y) {
-  if (_isShownOnMap || _isKilled) {
+  if (_isShownOnMap || hot().isKilled) {
     return false;
   }
 
   _isShownOnMap = true;
+  StatsSystem::getInstance()->setRegenEnabled(_statsIndex, true);
 
   // Construct b2Body and b2Fixtures
+  const auto& filters = collision_filters::kCharacterFilters[collision_filters::Role::PLAYER];
   defineBody(b2BodyType::b2_dynamicBody, x, y,
-             PLAYER_BODY_CATEGORY_BITS,
-             PLAYER_BODY_MASK_BITS,
-             PLAYER_FEET_MASK_BITS,
-             PLAYER_WEAPON_MASK_BITS);
+             filters[FixtureType::BODY].categoryBits,
+             filters[FixtureType::BODY].maskBits,
+             filters[FixtureType::FEET].maskBits,
+             filters[FixtureType::WEAPON].maskBits);
 
   // Load sprites, spritesheets, and animations, and then add them to GameMapManager layer.
-  defineTexture(_characterProfile.textureResDir, x, y);
+  defineTexture(_cold->characterProfile.textureResDir, x, y);
   GameMapManager* gmMgr = GameMapManager::getInstance();
-  gmMgr->getLayer()->addChild(_bodySpritesheet, graphical_layers::kPlayerBody);
+  gmMgr->getBatchNodeRegistry()->addChild(_bodySprite, graphical_layers::kPlayerBody,
+                                          getPaletteProgramState(_cold->characterProfile.palette));
   for (auto equipment : _equipmentSlots) {
     if (equipment) {
       Equipment::Type type = equipment->getEquipmentProfile().equipmentType;
-      gmMgr->getLayer()->addChild(_equipmentSpritesheets[type], graphical_layers::kEquipment - type);
+      loadEquipmentAnimations(equipment);
+      addEquipmentSpriteToMap(type);
     }
   }
 
@@ -99,129 +92,161 @@ bool Player::showOnMap(float x, float y) {
 }
 
 
-void Player::inflictDamage(Character* target, int damage) {
-  Character::inflictDamage(target, damage);
-  camera_util::shake(8, .1f);
-  
-  if (target->isSetToKill()) {
-    Notifications::getInstance()->show(
-        string_util::format("Acquired %d exp", target->getCharacterProfile().exp)
-    );
-
-    updateKillTargetObjectives(target);
-  }
-}
-
 void Player::receiveDamage(Character* source, int damage) {
   Character::receiveDamage(source, damage);
-  camera_util::shake(8, .1f);
 
   _fixtures[FixtureType::BODY]->SetSensor(true);
-  _isInvincible = true;
+  hot().isInvincible = true;
 
   CallbackManager::getInstance()->runAfter([&](){
     _fixtures[FixtureType::BODY]->SetSensor(false);
-    _isInvincible = false;
-  }, 1.0f);
+    hot().isInvincible = false;
+  }, 1.0f, this);
 
-  Hud::getInstance()->updateStatusBars();
+  EventBus::getInstance()->post(StatChangedEvent{this});
 }
 
 
+void Player::onKilled() {
+  Character::onKilled();
+
+  // Retry from the last checkpoint, if any.
+  CheckpointManager::getInstance()->onPlayerKilled();
+}
+
 void Player::addItem(shared_ptr<Item> item, int amount) {
   Character::addItem(item, amount);
 
+  char buf[128];
   Notifications::getInstance()->show((amount > 1) ?
-      string_util::format("Acquired item: %s (%d).", item->getName().c_str(), amount) :
-      string_util::format("Acquired item: %s.", item->getName().c_str())
+      string_util::formatTo(buf, "Acquired item: %s (%d).", item->getName().c_str(), amount) :
+      string_util::formatTo(buf, "Acquired item: %s.", item->getName().c_str())
   );
 }
 
 void Player::removeItem(Item* item, int amount) {
+  // `item` may be deleted by Character::removeItem(),
+  // so the message is formatted beforehand.
+  char buf[128];
+  if (amount > 1) {
+    string_util::formatTo(buf, "Removed item: %s (%d).", item->getName().c_str(), amount);
+  } else {
+    string_util::formatTo(buf, "Removed item: %s.", item->getName().c_str());
+  }
   Character::removeItem(item, amount);
 
-  Notifications::getInstance()->show((amount > 1) ?
-      string_util::format("Removed item: %s (%d).", item->getName().c_str(), amount) :
-      string_util::format("Removed item: %s.", item->getName().c_str())
-  );
+  Notifications::getInstance()->show(buf);
 }
 
-void Player::equip(Equipment* equipment) {
-  Character::equip(equipment);
-  Hud::getInstance()->updateEquippedWeapon();
+void Player::addItems(const vector<pair<shared_ptr<Item>, int>>& items) {
+  Character::addItems(items);
+
+  char buf[128];
+  if (items.size() == 1) {
+    Notifications::getInstance()->show(string_util::formatTo(buf, "Acquired item: %s (%d).",
+          items.front().first->getName().c_str(), items.front().second));
+  } else if (items.size() > 1) {
+    Notifications::getInstance()->show(string_util::formatTo(buf, "Acquired %d items.", static_cast<int>(items.size())));
+  }
 }
 
-void Player::unequip(Equipment::Type equipmentType) {
-  Character::unequip(equipmentType);
-  Hud::getInstance()->updateEquippedWeapon();
+void Player::removeItems(const vector<pair<Item*, int>>& items) {
+  const string itemName = (items.size() == 1) ? items.front().first->getName() : "";
+  Character::removeItems(items);
+
+  if (items.size() == 1) {
+    Notifications::getInstance()->show(string_util::format("Removed item: %s (%d).",
+          itemName.c_str(), items.front().second));
+  } else if (items.size() > 1) {
+    Notifications::getInstance()->show(string_util::format("Removed %d items.", static_cast<int>(items.size())));
+  }
 }
 
 void Player::pickupItem(Item* item) {
+  // `item` may be deleted by Character::pickupItem().
+  vector<AssetId> itemNameIds;
+  if (auto lootBag = dynamic_cast<LootBag*>(item)) {
+    for (const auto& p : lootBag->getContents()) {
+      itemNameIds.push_back(p.first->getItemProfile().nameId);
+    }
+  } else {
+    itemNameIds.push_back(item->getItemProfile().nameId);
+  }
+
   Character::pickupItem(item);
-  _questBook.update(Quest::Objective::Type::COLLECT);
+  for (const auto& itemNameId : itemNameIds) {
+    _questBook.update(Quest::Objective::Type::COLLECT, itemNameId);
+  }
 }
 
 void Player::addExp(const int exp) {
-  int originalLevel = _characterProfile.level;
+  int originalLevel = _cold->characterProfile.level;
   Character::addExp(exp);
 
-  if (_characterProfile.level > originalLevel) {
+  if (_cold->characterProfile.level > originalLevel) {
     Notifications::getInstance()->show(
-        string_util::format("Congrats! You are now level %d.", _characterProfile.level));
+        string_util::format("Congrats! You are now level %d.", _cold->characterProfile.level));
   }
 }
 
 
 void Player::handleInput() {
-  if (_isSetToKill || _isAttacking || _isUsingSkill || _isSheathingWeapon || _isUnsheathingWeapon) {
+  // Jumping and attacking are buffered, so they are still performed if they
+  // were pressed shortly before the player is able to act again.
+  const HotState& state = hot();
+  if (state.isSetToKill || state.isAttacking || state.isUsingSkill ||
+      state.isSheathingWeapon || state.isUnsheathingWeapon) {
     return;
   }
 
 
-  if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_E)) {
+  if (IS_ACTION_JUST_PRESSED(InputManager::Action::INTERACT)) {
     if (_interactableObject) {
       interact(_interactableObject);
     }
     return;
-  } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_UP_ARROW)) {
+  } else if (IS_ACTION_JUST_PRESSED(InputManager::Action::ENTER_PORTAL)) {
     if (_portal) {
       interact(_portal);
     }
     return;
   }
 
-  if (IS_KEY_PRESSED(EventKeyboard::KeyCode::KEY_DOWN_ARROW)) {
+  if (IS_ACTION_PRESSED(InputManager::Action::CROUCH)) {
     crouch();
-    if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_LEFT_ALT)) {
-      jumpDown();
-    }
   }
 
-  if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_LEFT_CTRL)) {
-    if (!_isWeaponSheathed) {
+  if (CONSUME_BUFFERED_ACTION(InputManager::Action::ATTACK, PLAYER_INPUT_BUFFER_FRAMES)) {
+    if (!hot().isWeaponSheathed) {
       attack();
     }
   }
 
-  if (IS_KEY_PRESSED(EventKeyboard::KeyCode::KEY_LEFT_ARROW)) {
+  if (IS_ACTION_PRESSED(InputManager::Action::MOVE_LEFT)) {
     moveLeft();
-  } else if (IS_KEY_PRESSED(EventKeyboard::KeyCode::KEY_RIGHT_ARROW)) {
+  } else if (IS_ACTION_PRESSED(InputManager::Action::MOVE_RIGHT)) {
     moveRight();
   }
 
-  if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_R)) {
+  if (IS_ACTION_JUST_PRESSED(InputManager::Action::SHEATHE_WEAPON)) {
     if (_equipmentSlots[Equipment::Type::WEAPON]
-        && _isWeaponSheathed && !_isUnsheathingWeapon) {
+        && hot().isWeaponSheathed && !hot().isUnsheathingWeapon) {
       unsheathWeapon();
-    } else if (!_isWeaponSheathed && !_isSheathingWeapon) {
+    } else if (!hot().isWeaponSheathed && !hot().isSheathingWeapon) {
       sheathWeapon();
     }
   }
 
-  // Hotkeys
-  for (auto keyCode : HotkeyManager::_kBindableKeys) {
-    Keybindable* action = HotkeyManager::getInstance()->getHotkeyAction(keyCode);
-    if (IS_KEY_JUST_PRESSED(keyCode) && action) {
+  // Hotkeys. Only the bound keys pressed this frame are visited,
+  // which is none of them in most frames.
+  const InputManager::KeySet pressedHotkeys =
+    InputManager::getInstance()->getKeysJustPressed() & HotkeyManager::getInstance()->getBoundKeys();
+  if (pressedHotkeys.any()) {
+    for (auto keyCode : HotkeyManager::_kBindableKeys) {
+      if (!pressedHotkeys.test(keycode_util::toIndex(keyCode))) {
+        continue;
+      }
+      Keybindable* action = HotkeyManager::getInstance()->getHotkeyAction(keyCode);
       if (dynamic_cast<Skill*>(action)) {
         activateSkill(dynamic_cast<Skill*>(action));
       } else if (dynamic_cast<Consumable*>(action)) {
@@ -230,34 +255,33 @@ void Player::handleInput() {
     }
   }
 
-  if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_Z)) {
-    if (!_inRangeItems.empty()) {
-      pickupItem(*_inRangeItems.begin());
+  if (IS_ACTION_JUST_PRESSED(InputManager::Action::PICK_UP_ITEM)) {
+    if (Item* item = PickupSystem::getInstance()->findNearestItem(this)) {
+      pickupItem(item);
     }
   }
 
-  if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_ALT)) {
-    jump();
+  if (CONSUME_BUFFERED_ACTION(InputManager::Action::JUMP, PLAYER_INPUT_BUFFER_FRAMES)) {
+    if (hot().isCrouching) {
+      jumpDown();
+    } else {
+      jump();
+    }
   }
 
-  if (_isCrouching && !IS_KEY_PRESSED(EventKeyboard::KeyCode::KEY_DOWN_ARROW)) {
+  if (hot().isCrouching && !IS_ACTION_PRESSED(InputManager::Action::CROUCH)) {
     getUp();
   }
 }
 
 
-void Player::updateKillTargetObjectives(Character* killedCharacter) {
-  if (!killedCharacter->isSetToKill()) {
-    return;
-  }
-
-  for (auto quest : _questBook.getInProgressQuests()) {
-    auto ko = dynamic_cast<KillTargetObjective*>(quest->getCurrentStage().objective.get());
-    if (ko && ko->getCharacterName() == killedCharacter->getCharacterProfile().name) {
-      ko->incrementCurrentAmount();
-    }
+void Player::updateKillTargetObjectives(AssetId killedNameId, int numKilled) {
+  // Only the quests which are currently waiting for this character
+  // to be killed are looked up, see QuestBook::indexQuest().
+  for (auto quest : _questBook.getQuestsByObjective(Quest::Objective::Type::KILL, killedNameId)) {
+    static_cast<KillTargetObjective*>(quest->getCurrentStage().objective.get())->incrementCurrentAmount(numKilled);
   }
-  _questBook.update(Quest::Objective::Type::KILL);
+  _questBook.update(Quest::Objective::Type::KILL, killedNameId);
 }
 
 
@@ -265,4 +289,9 @@ QuestBook& Player::getQuestBook() {
   return _questBook;
 }
 
+
+void Player::onItemAmountChanged(AssetId itemNameId, int deltaAmount) {
+  _questBook.onItemAmountChanged(itemNameId, deltaAmount);
+}
+
 }  // namespace vigilante
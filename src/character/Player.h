@@ -4,6 +4,8 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <Box2D/Box2D.h>
 #include "Character.h"
@@ -20,24 +22,28 @@ class Player : public Character, public Controllable {
 
   virtual bool showOnMap(float x, float y) override;  // Character
   
-  virtual void inflictDamage(Character* target, int damage) override;  // Character
   virtual void receiveDamage(Character* source, int damage) override;  // Character
+  virtual void onKilled() override;  // Character
 
   virtual void addItem(std::shared_ptr<Item> item, int amount=1) override;  // Character
   virtual void removeItem(Item* item, int amount=1) override;  // Character
-  virtual void equip(Equipment* equipment) override;  // Character
-  virtual void unequip(Equipment::Type equipmentType) override;  // Character
+  virtual void addItems(const std::vector<std::pair<std::shared_ptr<Item>, int>>& items) override;  // Character
+  virtual void removeItems(const std::vector<std::pair<Item*, int>>& items) override;  // Character
   virtual void pickupItem(Item* item) override;  // Character
   virtual void addExp(const int exp) override;  // Character
 
   virtual void handleInput() override;  // Controllable
 
 
-  void updateKillTargetObjectives(Character* killedCharacter);
+  // Called by CombatSystem::resolve() with the number of characters named
+  // `killedNameId` killed by the player or its allies in a batch of hits.
+  void updateKillTargetObjectives(AssetId killedNameId, int numKilled);
 
   QuestBook& getQuestBook();
 
  private:
+  virtual void onItemAmountChanged(AssetId itemNameId, int deltaAmount) override;  // Character
+
   QuestBook _questBook;
 };
 
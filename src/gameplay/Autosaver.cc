@@ -0,0 +1,83 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "Autosaver.h"
+
+#include <cocos2d.h>
+#include "character/Player.h"
+#include "gameplay/GameplayBenchmark.h"
+#include "gameplay/RenderStressTest.h"
+#include "gameplay/GameState.h"
+#include "input/InputManager.h"
+#include "map/GameMapManager.h"
+#include "map/WorldEpoch.h"
+
+#define AUTOSAVE_INTERVAL 300.0f  // in seconds
+#define AUTOSAVE_FILE_NAME "autosave.bin"
+
+using std::string;
+
+namespace vigilante {
+
+Autosaver* Autosaver::getInstance() {
+  static Autosaver instance;
+  return &instance;
+}
+
+Autosaver::Autosaver()
+    : _isEnabled(true),
+      _isRequested(),
+      _timer(),
+      _filePath(cocos2d::FileUtils::getInstance()->getWritablePath() + AUTOSAVE_FILE_NAME) {}
+
+
+void Autosaver::update(float delta) {
+  if (!_isEnabled) {
+    return;
+  }
+
+  _timer += delta;
+  if (_timer >= AUTOSAVE_INTERVAL) {
+    _isRequested = true;
+  }
+
+  if (!_isRequested || !canSave()) {
+    return;
+  }
+
+  GameState gameState;
+  gameState.setFilePath(_filePath);
+
+  // If the previous save is still being written, try again in the next frame.
+  if (gameState.saveAsync()) {
+    _isRequested = false;
+    _timer = 0;
+  }
+}
+
+void Autosaver::request() {
+  _isRequested = true;
+}
+
+bool Autosaver::canSave() const {
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  return player && !player->isKilled() &&
+         GameMapManager::getInstance()->getGameMap() &&
+         !world_epoch::isInTransition() &&
+         InputManager::getInstance()->getReplayMode() == InputManager::ReplayMode::NONE &&
+         !GameplayBenchmark::getInstance()->isRunning() &&
+         !RenderStressTest::getInstance()->isRunning();
+}
+
+
+bool Autosaver::isEnabled() const {
+  return _isEnabled;
+}
+
+void Autosaver::setEnabled(bool enabled) {
+  _isEnabled = enabled;
+}
+
+const string& Autosaver::getFilePath() const {
+  return _filePath;
+}
+
+}  // namespace vigilante
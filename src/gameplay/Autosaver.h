@@ -0,0 +1,44 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_AUTOSAVER_H_
+#define VIGILANTE_AUTOSAVER_H_
+
+#include <string>
+
+namespace vigilante {
+
+// Saves the game every once in a while, and whenever a GameMap has been loaded
+// (see GameMapManager::loadGameMap()), so that the players won't lose much
+// progress if the game crashes.
+//
+// The saves are written asynchronously (see GameState::saveAsync()).
+// A requested autosave is postponed until the game is in a consistent state,
+// e.g., not during a GameMap transition or a replay.
+// All methods must be called on the main thread.
+class Autosaver final {
+ public:
+  static Autosaver* getInstance();
+
+  void update(float delta);
+
+  // Autosaves as soon as possible.
+  void request();
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+
+  const std::string& getFilePath() const;
+
+ private:
+  Autosaver();
+
+  bool canSave() const;
+
+  bool _isEnabled;
+  bool _isRequested;
+  float _timer;
+  std::string _filePath;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_AUTOSAVER_H_
@@ -0,0 +1,151 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "CameraSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Constants.h"
+#include "map/GameMap.h"
+#include "util/RandUtil.h"
+
+#define CAMERA_FOLLOW_RATE .1f  // the fraction of the distance covered per 1/60 seconds
+#define CAMERA_DEAD_ZONE_WIDTH 24
+#define CAMERA_DEAD_ZONE_HEIGHT 16
+
+using cocos2d::Camera;
+using cocos2d::Director;
+using cocos2d::Rect;
+using cocos2d::Size;
+using cocos2d::Vec2;
+
+namespace vigilante {
+
+CameraSystem* CameraSystem::getInstance() {
+  static CameraSystem instance;
+  return &instance;
+}
+
+CameraSystem::CameraSystem()
+    : _camera(),
+      _position(),
+      _deadZone(CAMERA_DEAD_ZONE_WIDTH, CAMERA_DEAD_ZONE_HEIGHT),
+      _shakePower(),
+      _shakeDuration(),
+      _shakeTime(),
+      _shakeOffset(),
+      _viewRect(),
+      _viewAabb() {
+  _viewAabb.lowerBound.SetZero();
+  _viewAabb.upperBound.SetZero();
+}
+
+void CameraSystem::setCamera(Camera* camera) {
+  _camera = camera;
+  _position = camera->getPosition();
+  _shakeOffset = Vec2::ZERO;
+  publishView();
+}
+
+void CameraSystem::update(float delta, const b2Vec2& target, const GameMap* gameMap) {
+  const Size& winSize = Director::getInstance()->getWinSize();
+  const Vec2 center = _position + Vec2(winSize.width / 2, winSize.height / 2);
+
+  // Only the part of the distance beyond the dead zone is followed.
+  Vec2 distance = Vec2(target.x * kPpm, target.y * kPpm) - center;
+  distance.x -= std::copysign(std::min(std::abs(distance.x), _deadZone.width / 2), distance.x);
+  distance.y -= std::copysign(std::min(std::abs(distance.y), _deadZone.height / 2), distance.y);
+
+  // The same rate at any frame rate.
+  const float rate = 1.0f - std::pow(1.0f - CAMERA_FOLLOW_RATE, delta * 60.0f);
+  _position += distance * rate;
+
+  bound(gameMap);
+  updateShake(delta);
+  publishView();
+}
+
+void CameraSystem::snapTo(const b2Vec2& target, const GameMap* gameMap) {
+  const Size& winSize = Director::getInstance()->getWinSize();
+  _position = Vec2(target.x * kPpm - winSize.width / 2, target.y * kPpm - winSize.height / 2);
+  bound(gameMap);
+  publishView();
+}
+
+void CameraSystem::setDeadZone(const Size& deadZone) {
+  _deadZone = deadZone;
+}
+
+void CameraSystem::shake(float power, float duration) {
+  _shakePower = power;
+  _shakeDuration = duration;
+  _shakeTime = 0;
+}
+
+
+const Rect& CameraSystem::getViewRect() const {
+  return _viewRect;
+}
+
+const b2AABB& CameraSystem::getViewAabb() const {
+  return _viewAabb;
+}
+
+Vec2 CameraSystem::getCenter() const {
+  return Vec2(_viewRect.getMidX(), _viewRect.getMidY());
+}
+
+bool CameraSystem::isInView(const b2Vec2& pos, float margin) const {
+  return pos.x >= _viewAabb.lowerBound.x - margin && pos.x <= _viewAabb.upperBound.x + margin &&
+         pos.y >= _viewAabb.lowerBound.y - margin && pos.y <= _viewAabb.upperBound.y + margin;
+}
+
+
+void CameraSystem::bound(const GameMap* gameMap) {
+  if (!gameMap) {
+    return;
+  }
+
+  const Size& winSize = Director::getInstance()->getWinSize();
+  const float mapWidth = gameMap->getWidth();
+  const float mapHeight = gameMap->getHeight();
+
+  _position.x = std::max(0.0f, std::min(_position.x, mapWidth - winSize.width));
+  _position.y = std::max(0.0f, std::min(_position.y, mapHeight - winSize.height));
+
+  // If the map is smaller than the window, place it at the center of the window.
+  if (mapWidth < winSize.width) {
+    _position.x = -(winSize.width - mapWidth) / 2;
+  }
+  if (mapHeight < winSize.height) {
+    _position.y = -(winSize.height - mapHeight) / 2;
+  }
+}
+
+void CameraSystem::updateShake(float delta) {
+  if (_shakeTime >= _shakeDuration) {
+    _shakeOffset = Vec2::ZERO;
+    return;
+  }
+
+  // The offset is applied on top of the followed position,
+  // so the camera never drifts because of a shake.
+  const float power = _shakePower * (_shakeDuration - _shakeTime) / _shakeDuration;
+  _shakeOffset.x = (rand_util::randFloat(0.0f, 1.0f, rand_util::Stream::CAMERA) - 0.5f) * 2 * power;
+  _shakeOffset.y = (rand_util::randFloat(0.0f, 1.0f, rand_util::Stream::CAMERA) - 0.5f) * 2 * power;
+  _shakeTime += delta;
+}
+
+void CameraSystem::publishView() {
+  const Vec2 position = _position + _shakeOffset;
+  if (_camera) {
+    _camera->setPosition(position);
+  }
+
+  const Size& winSize = Director::getInstance()->getWinSize();
+  _viewRect = Rect(position, winSize);
+  _viewAabb.lowerBound.Set(position.x / kPpm, position.y / kPpm);
+  _viewAabb.upperBound.Set((position.x + winSize.width) / kPpm,
+                           (position.y + winSize.height) / kPpm);
+}
+
+}  // namespace vigilante
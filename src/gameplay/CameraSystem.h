@@ -0,0 +1,67 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_CAMERA_SYSTEM_H_
+#define VIGILANTE_CAMERA_SYSTEM_H_
+
+#include <cocos2d.h>
+#include <Box2D/Box2D.h>
+
+namespace vigilante {
+
+class GameMap;
+
+// Owns the game camera, i.e., following the target (with a dead zone),
+// keeping the view within the GameMap's bounds, and shaking.
+//
+// Each update() publishes the world-space region which is visible in the
+// current frame (shake included), in pixels and in meters, which is what the
+// culling and LOD code should query (e.g., tile chunk culling, the npcs'
+// update LOD, fx spawning).
+//
+// The camera system must only be used by the main thread.
+class CameraSystem final {
+ public:
+  static CameraSystem* getInstance();
+
+  // The camera's position is the bottom-left corner of the view.
+  void setCamera(cocos2d::Camera* camera);
+  void update(float delta, const b2Vec2& target, const GameMap* gameMap);
+
+  // Moves to `target` immediately (e.g., after a GameMap has been loaded).
+  void snapTo(const b2Vec2& target, const GameMap* gameMap);
+
+  // The size (in pixels) of the region around the center of the view
+  // within which the target can move without the camera following it.
+  void setDeadZone(const cocos2d::Size& deadZone);
+  void shake(float power, float duration);
+
+  const cocos2d::Rect& getViewRect() const;  // in pixels
+  const b2AABB& getViewAabb() const;  // in meters
+  cocos2d::Vec2 getCenter() const;  // in pixels
+
+  // Whether `pos` (in meters) is in view, or within `margin` meters of it.
+  bool isInView(const b2Vec2& pos, float margin=0) const;
+
+ private:
+  CameraSystem();
+
+  // Clamps the view (without shake) so that it doesn't go beyond the GameMap.
+  void bound(const GameMap* gameMap);
+  void updateShake(float delta);
+  void publishView();
+
+  cocos2d::Camera* _camera;
+  cocos2d::Vec2 _position;  // without shake
+  cocos2d::Size _deadZone;
+
+  float _shakePower;
+  float _shakeDuration;
+  float _shakeTime;
+  cocos2d::Vec2 _shakeOffset;
+
+  cocos2d::Rect _viewRect;
+  b2AABB _viewAabb;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_CAMERA_SYSTEM_H_
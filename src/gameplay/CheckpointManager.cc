@@ -0,0 +1,109 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "CheckpointManager.h"
+
+#include "character/Player.h"
+#include "gameplay/GameplayBenchmark.h"
+#include "gameplay/GameState.h"
+#include "gameplay/RenderStressTest.h"
+#include "input/InputManager.h"
+#include "map/GameMapManager.h"
+#include "map/WorldEpoch.h"
+#include "ui/notifications/Notifications.h"
+#include "util/Logger.h"
+
+#define RETRY_DELAY 1.5f  // in seconds
+
+using std::string;
+
+namespace vigilante {
+
+CheckpointManager* CheckpointManager::getInstance() {
+  static CheckpointManager instance;
+  return &instance;
+}
+
+CheckpointManager::CheckpointManager()
+    : _snapshot(),
+      _isRequested(),
+      _isRetryPending(),
+      _retryTimer() {}
+
+
+void CheckpointManager::update(float delta) {
+  if (_isRetryPending) {
+    _retryTimer -= delta;
+    if (_retryTimer > 0 || !canRestoreCheckpoint()) {
+      return;
+    }
+
+    _isRetryPending = false;
+    GameState gameState;
+    if (!gameState.restoreInPlace(_snapshot)) {
+      VGLOG(LOG_ERR, "Failed to retry from the checkpoint.");
+      return;
+    }
+    Notifications::getInstance()->show("Retrying from the last checkpoint.");
+    return;
+  }
+
+  if (!_isRequested || !canTakeCheckpoint()) {
+    return;
+  }
+
+  GameState gameState;
+  if (gameState.saveToMemory(&_snapshot)) {
+    _isRequested = false;
+  }
+}
+
+void CheckpointManager::request() {
+  _isRequested = true;
+}
+
+void CheckpointManager::onPlayerKilled() {
+  // Let the player see what has happened first.
+  if (retry()) {
+    _retryTimer = RETRY_DELAY;
+  }
+}
+
+bool CheckpointManager::retry() {
+  if (_snapshot.empty()) {
+    return false;
+  }
+
+  _isRetryPending = true;
+  _retryTimer = 0;
+  return true;
+}
+
+bool CheckpointManager::canTakeCheckpoint() const {
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  return player && !player->isKilled() &&
+         GameMapManager::getInstance()->getGameMap() &&
+         !world_epoch::isInTransition() &&
+         InputManager::getInstance()->getReplayMode() == InputManager::ReplayMode::NONE &&
+         !GameplayBenchmark::getInstance()->isRunning() &&
+         !RenderStressTest::getInstance()->isRunning();
+}
+
+bool CheckpointManager::canRestoreCheckpoint() const {
+  return GameMapManager::getInstance()->getPlayer() &&
+         GameMapManager::getInstance()->getGameMap() &&
+         !world_epoch::isInTransition() &&
+         !InputManager::getInstance()->isReplayRunning();
+}
+
+
+bool CheckpointManager::hasCheckpoint() const {
+  return !_snapshot.empty();
+}
+
+void CheckpointManager::clear() {
+  _snapshot.clear();
+  _isRequested = false;
+  _isRetryPending = false;
+  _retryTimer = 0;
+}
+
+}  // namespace vigilante
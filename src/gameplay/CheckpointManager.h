@@ -0,0 +1,52 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_CHECKPOINT_MANAGER_H_
+#define VIGILANTE_CHECKPOINT_MANAGER_H_
+
+#include <string>
+
+namespace vigilante {
+
+// Keeps an in-memory snapshot of the game (see GameState::saveToMemory()),
+// taken whenever a GameMap has been loaded (see GameMapManager::loadGameMap())
+// or a trigger runs the "checkpoint" console command, and restores it
+// RETRY_DELAY seconds after the player has been killed. Since the snapshot
+// is restored into the resident GameMap (see GameState::restoreInPlace()),
+// retrying doesn't have to wait for the shade or for any asset to be loaded.
+//
+// Like the autosaves (see Autosaver), a requested checkpoint is postponed
+// until the game is in a consistent state, e.g., not during a GameMap
+// transition or a replay. All methods must be called on the main thread.
+class CheckpointManager final {
+ public:
+  static CheckpointManager* getInstance();
+
+  void update(float delta);
+
+  // Takes a checkpoint as soon as possible.
+  void request();
+
+  // Called by Player::onKilled().
+  void onPlayerKilled();
+
+  // Restores the latest checkpoint as soon as possible.
+  // Returns false if there's no checkpoint.
+  bool retry();
+
+  bool hasCheckpoint() const;
+  void clear();
+
+ private:
+  CheckpointManager();
+
+  bool canTakeCheckpoint() const;
+  bool canRestoreCheckpoint() const;
+
+  std::string _snapshot;  // empty if there's no checkpoint
+  bool _isRequested;
+  bool _isRetryPending;
+  float _retryTimer;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_CHECKPOINT_MANAGER_H_
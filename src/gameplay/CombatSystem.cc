@@ -0,0 +1,190 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "CombatSystem.h"
+
+#include <algorithm>
+
+#include "character/Npc.h"
+#include "character/Player.h"
+#include "gameplay/CameraSystem.h"
+#include "map/GameMapManager.h"
+#include "ui/floating_damages/FloatingDamages.h"
+#include "ui/notifications/Notifications.h"
+#include "util/StringUtil.h"
+#include "util/TraceProfiler.h"
+
+#define CAMERA_SHAKE_POWER 8
+#define CAMERA_SHAKE_DURATION .1f
+
+using std::pair;
+
+namespace vigilante {
+
+namespace {
+
+// Whether the kills made by `attacker` count towards the player's quests.
+bool isCreditedToPlayer(const Character* attacker, const Player* player) {
+  if (attacker == player) {
+    return true;
+  }
+  const Npc* npc = dynamic_cast<const Npc*>(attacker);
+  return npc && npc->getDisposition() == Npc::Disposition::ALLY && npc->isInPlayerParty();
+}
+
+}  // namespace
+
+
+CombatSystem* CombatSystem::getInstance() {
+  static CombatSystem instance;
+  return &instance;
+}
+
+CombatSystem::CombatSystem()
+    : _pendingHits(),
+      _resolvingHits(),
+      _alerts(),
+      _damageTotals(),
+      _kills() {}
+
+
+void CombatSystem::enqueueHit(Character* attacker, Character* target, int damage) {
+  _pendingHits.push_back({attacker, target, damage});
+}
+
+void CombatSystem::resolve() {
+  if (_pendingHits.empty()) {
+    return;
+  }
+
+  VGTRACE_ZONE("CombatSystem::resolve");
+
+  // The hits landed while resolving this batch (if any) go to the next one.
+  _resolvingHits.swap(_pendingHits);
+
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  bool shouldShakeCamera = false;
+  int acquiredExp = 0;
+
+  for (size_t i = 0; i < _resolvingHits.size(); i++) {
+    // Copied, since cancel() may clear the hit while it's being resolved.
+    const Hit hit = _resolvingHits[i];
+    if (!hit.attacker || !hit.target || hit.target->isSetToKill()) {
+      continue;
+    }
+
+    const pair<Character*, Character*> alert = {hit.attacker, hit.target};
+    if (std::find(_alerts.begin(), _alerts.end(), alert) == _alerts.end()) {
+      _alerts.push_back(alert);
+    }
+
+    // e.g., the player has just been hit by another enemy in this batch.
+    if (hit.target->isInvincible()) {
+      continue;
+    }
+
+    hit.target->receiveDamage(hit.attacker, hit.damage);
+    addDamageTotal(hit.target, hit.damage);
+    shouldShakeCamera |= (player && (hit.attacker == player || hit.target == player));
+
+    if (!hit.target->isSetToKill()) {
+      continue;
+    }
+    if (player && hit.attacker == player) {
+      acquiredExp += hit.target->getCharacterProfile().exp;
+    }
+    if (player && isCreditedToPlayer(hit.attacker, player)) {
+      addKill(hit.target->getCharacterProfile().nameId);
+    }
+  }
+
+  // Those who have just been killed aren't locked on to.
+  for (const auto& alert : _alerts) {
+    Character* attacker = alert.first;
+    Character* target = alert.second;
+    if (!attacker->isSetToKill()) {
+      target->lockOn(attacker);
+      for (const auto& targetAlly : target->getAllies()) {
+        targetAlly->lockOn(attacker);
+      }
+    }
+    if (!target->isSetToKill()) {
+      for (const auto& ally : attacker->getAllies()) {
+        ally->lockOn(target);
+      }
+    }
+  }
+
+  for (const auto& damageTotal : _damageTotals) {
+    FloatingDamages::getInstance()->show(damageTotal.first, damageTotal.second);
+  }
+
+  if (shouldShakeCamera) {
+    CameraSystem::getInstance()->shake(CAMERA_SHAKE_POWER, CAMERA_SHAKE_DURATION);
+  }
+
+  if (acquiredExp > 0) {
+    char buf[64];
+    Notifications::getInstance()->show(string_util::formatTo(buf, "Acquired %d exp", acquiredExp));
+  }
+
+  for (const auto& kill : _kills) {
+    player->updateKillTargetObjectives(kill.first, kill.second);
+  }
+
+  _resolvingHits.clear();
+  _alerts.clear();
+  _damageTotals.clear();
+  _kills.clear();
+}
+
+void CombatSystem::cancel(const Character* character) {
+  for (auto hits : {&_pendingHits, &_resolvingHits}) {
+    for (auto& hit : *hits) {
+      if (hit.attacker == character || hit.target == character) {
+        hit.attacker = nullptr;
+        hit.target = nullptr;
+      }
+    }
+  }
+
+  _alerts.erase(std::remove_if(_alerts.begin(), _alerts.end(),
+                               [character](const pair<Character*, Character*>& alert) {
+    return alert.first == character || alert.second == character;
+  }), _alerts.end());
+
+  _damageTotals.erase(std::remove_if(_damageTotals.begin(), _damageTotals.end(),
+                                     [character](const pair<Character*, int>& damageTotal) {
+    return damageTotal.first == character;
+  }), _damageTotals.end());
+}
+
+size_t CombatSystem::getNumPendingHits() const {
+  return _pendingHits.size();
+}
+
+
+void CombatSystem::addDamageTotal(Character* target, int damage) {
+  auto it = std::find_if(_damageTotals.begin(), _damageTotals.end(),
+                         [target](const pair<Character*, int>& damageTotal) {
+    return damageTotal.first == target;
+  });
+
+  if (it != _damageTotals.end()) {
+    it->second += damage;
+  } else {
+    _damageTotals.push_back({target, damage});
+  }
+}
+
+void CombatSystem::addKill(AssetId nameId) {
+  auto it = std::find_if(_kills.begin(), _kills.end(), [nameId](const pair<AssetId, int>& kill) {
+    return kill.first == nameId;
+  });
+
+  if (it != _kills.end()) {
+    it->second++;
+  } else {
+    _kills.push_back({nameId, 1});
+  }
+}
+
+}  // namespace vigilante
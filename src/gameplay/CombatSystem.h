@@ -0,0 +1,69 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_COMBAT_SYSTEM_H_
+#define VIGILANTE_COMBAT_SYSTEM_H_
+
+#include <utility>
+#include <vector>
+
+#include "util/AssetId.h"
+
+namespace vigilante {
+
+// Forward Declaration
+class Character;
+
+// Resolves the hits landed during a frame in one batch.
+//
+// Character::inflictDamage() only enqueues a hit (from the contact handlers,
+// the melee attack callbacks and the projectiles), and resolve() is called
+// once per frame by GameMapManager::update(), after all actors are updated:
+// 1. Character::receiveDamage() is applied to each target in order (the
+//    stats, the sfx, the exp and the loot). The hits on a target which has
+//    been killed by an earlier hit in the same batch are dropped.
+// 2. The alerts (the attacker, the target and their allies locking on to
+//    each other) are propagated once per pair of attacker and target.
+// 3. Each target gets a single floating damage label with the total damage
+//    of the batch, and the camera is shaken at most once.
+// 4. The exp acquired by the player is shown in a single notification,
+//    and the quests are updated once per type of killed character.
+//
+// So a multi-target spell no longer multiplies the UI and the quest work.
+//
+// The combat system must only be used by the main thread.
+class CombatSystem final {
+ public:
+  static CombatSystem* getInstance();
+
+  void enqueueHit(Character* attacker, Character* target, int damage);
+  void resolve();
+
+  // Drops the pending hits made by or on `character`,
+  // e.g., when it is removed from the map.
+  void cancel(const Character* character);
+
+  size_t getNumPendingHits() const;
+
+ private:
+  struct Hit final {
+    Character* attacker;
+    Character* target;
+    int damage;
+  };
+
+  CombatSystem();
+
+  void addDamageTotal(Character* target, int damage);
+  void addKill(AssetId nameId);
+
+  std::vector<CombatSystem::Hit> _pendingHits;
+  std::vector<CombatSystem::Hit> _resolvingHits;
+
+  // The scratch buffers of resolve().
+  std::vector<std::pair<Character*, Character*>> _alerts;  // attacker, target
+  std::vector<std::pair<Character*, int>> _damageTotals;  // target, total damage
+  std::vector<std::pair<AssetId, int>> _kills;  // killed character's nameId, count
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_COMBAT_SYSTEM_H_
@@ -0,0 +1,78 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "CooldownSystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace vigilante {
+
+CooldownSystem* CooldownSystem::getInstance() {
+  static CooldownSystem instance;
+  return &instance;
+}
+
+CooldownSystem::CooldownSystem()
+    : _time(),
+      _readyTimes(),
+      _durations(),
+      _isAllocated(),
+      _freeIndices() {}
+
+
+int CooldownSystem::allocate(float duration) {
+  int index;
+  if (!_freeIndices.empty()) {
+    index = _freeIndices.back();
+    _freeIndices.pop_back();
+  } else {
+    index = static_cast<int>(_readyTimes.size());
+    _readyTimes.push_back(0);
+    _durations.push_back(0);
+    _isAllocated.push_back(false);
+  }
+
+  _readyTimes[index] = _time;
+  _durations[index] = std::max(duration, 0.0f);
+  _isAllocated[index] = true;
+  return index;
+}
+
+void CooldownSystem::release(int index) {
+  assert(_isAllocated[index]);
+  _isAllocated[index] = false;
+  _freeIndices.push_back(index);
+}
+
+void CooldownSystem::update(float delta) {
+  _time += delta;
+}
+
+
+void CooldownSystem::trigger(int index) {
+  _readyTimes[index] = _time + _durations[index];
+}
+
+void CooldownSystem::reset(int index) {
+  _readyTimes[index] = _time;
+}
+
+bool CooldownSystem::isReady(int index) const {
+  return _time >= _readyTimes[index];
+}
+
+float CooldownSystem::getRemainingTime(int index) const {
+  return static_cast<float>(std::max(_readyTimes[index] - _time, 0.0));
+}
+
+float CooldownSystem::getProgress(int index) const {
+  if (_durations[index] == 0) {
+    return 1.0f;
+  }
+  return 1.0f - std::min(getRemainingTime(index) / _durations[index], 1.0f);
+}
+
+void CooldownSystem::setDuration(int index, float duration) {
+  _durations[index] = std::max(duration, 0.0f);
+}
+
+}  // namespace vigilante
@@ -0,0 +1,53 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_COOLDOWN_SYSTEM_H_
+#define VIGILANTE_COOLDOWN_SYSTEM_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace vigilante {
+
+// Keeps the cooldown timestamps of all the skills learned by live characters
+// in contiguous arrays. A cooldown is just the time (on the game clock) at
+// which the skill becomes ready again, so update() only has to advance the
+// game clock, and whether a skill is ready is answered by a time compare.
+//
+// Each Character only holds an index per skill (see Character::addSkill()),
+// which stays valid until it is released (the slots are recycled).
+//
+// The cooldown system must only be used by the main thread.
+class CooldownSystem final {
+ public:
+  static CooldownSystem* getInstance();
+
+  int allocate(float duration);
+  void release(int index);
+
+  // Advances the game clock. It isn't advanced while the game is paused.
+  void update(float delta);
+
+  // Starts the cooldown, i.e., it won't be ready until `duration` seconds later.
+  void trigger(int index);
+  // Makes it ready immediately.
+  void reset(int index);
+
+  bool isReady(int index) const;
+  float getRemainingTime(int index) const;
+  // 0 right after trigger(), and 1 once it is ready.
+  float getProgress(int index) const;
+
+  void setDuration(int index, float duration);
+
+ private:
+  CooldownSystem();
+
+  double _time;
+  std::vector<double> _readyTimes;
+  std::vector<float> _durations;
+  std::vector<uint8_t> _isAllocated;
+  std::vector<int> _freeIndices;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_COOLDOWN_SYSTEM_H_
@@ -1,121 +1,66 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "DialogueTree.h"
 
+#include <algorithm>
 #include <cassert>
 #include <stack>
+#include <utility>
 
 #include <cocos2d.h>
+#include <json/document.h>
 #include "std/make_unique.h"
 #include "character/Npc.h"
-#include "util/ds/Algorithm.h"
 #include "util/JsonUtil.h"
 #include "util/Logger.h"
+#include "util/ProfileCache.h"
 
 using std::pair;
 using std::stack;
 using std::string;
 using std::vector;
 using std::unordered_map;
-using rapidjson::Document;
 
 namespace vigilante {
 
-unordered_map<string, string> DialogueTree::_latestNpcDialogueTree;
+unordered_map<AssetId, string> DialogueTree::_latestNpcDialogueTree;
 
 DialogueTree::DialogueTree(const string& jsonFileName, Npc* owner)
-    : _nodeMapper(),
+    : _jsonFileName(),
+      _profile(),
       _rootNode(),
-      _currentNode(),
       _toggleJoinPartyNode(),
       _toggleWaitNode(),
       _tradeNode(),
+      _ownerState(OwnerState::UNKNOWN),
+      _currentNode(),
       _isQuestDialogueTree(),
       _owner(owner) {
   import(jsonFileName);
 }
 
-DialogueTree::DialogueTree(DialogueTree&& other) noexcept
-    : _nodeMapper(std::move(other._nodeMapper)),
-      _rootNode(std::move(other._rootNode)),
-      _currentNode(other._currentNode), 
-      _toggleJoinPartyNode(other._toggleJoinPartyNode),
-      _toggleWaitNode(other._toggleWaitNode),
-      _tradeNode(other._tradeNode),
-      _isQuestDialogueTree(),
-      _owner(other._owner) {}
-
-DialogueTree& DialogueTree::operator=(DialogueTree&& other) noexcept {
-  _nodeMapper = std::move(other._nodeMapper);
-  _rootNode = std::move(other._rootNode);
-  _currentNode = other._currentNode;
-  _toggleJoinPartyNode = other._toggleJoinPartyNode;
-  _toggleWaitNode = other._toggleWaitNode;
-  _tradeNode = other._tradeNode;
-  _isQuestDialogueTree = other._isQuestDialogueTree;
-  _owner = other._owner;
-  return *this;
-}
-
 
 void DialogueTree::import(const string& jsonFileName) {
   if (jsonFileName.empty()) {
     return;
   }
 
-  VGLOG(LOG_INFO, "Loading dialogue tree...");
-  Document json = json_util::parseJson(jsonFileName);
-
-  // Convert rapidjson tree into our DialogueTree using tree DFS.
-  // DFS 大師 !!!!!!! XDDDDDDDDD
-  stack<pair<rapidjson::Value::Object, Node*>> st;  // <jsonObject, parent>
-  st.push({json.GetObject(), nullptr});
-
-  while (!st.empty()) {
-    rapidjson::Value::Object jsonNode = st.top().first;
-    DialogueTree::Node* parent = st.top().second;
-    st.pop();
-
-
-    // Construct this node.
-    auto node = std::make_unique<DialogueTree::Node>(this);
-
-    if (jsonNode.HasMember("nodeName")) {
-      node->_nodeName = jsonNode["nodeName"].GetString();
-      _nodeMapper.insert({node->_nodeName, node.get()});
-    }
-
-    for (const auto& line : jsonNode["lines"].GetArray()) {
-      node->_lines.push_back(line.GetString());
-    }
-    for (const auto& cmd : jsonNode["exec"].GetArray()) {
-      node->_cmds.push_back(cmd.GetString());
-    }
-
-    if (jsonNode.HasMember("childrenRef")) {
-      node->_childrenRef = jsonNode["childrenRef"].GetString();
-    } else {
-      // Push this node's children onto the stack in reverse order.
-      const auto& children = jsonNode["children"].GetArray();
-      for (int i = children.Size() - 1; i >= 0; i--) {
-        st.push({children[i].GetObject(), node.get()});
-      }
-    }
+  _jsonFileName = jsonFileName;
+  _profile = profile_cache::get<DialogueTree::Profile>(jsonFileName);
+  _toggleJoinPartyNode.reset();
+  _toggleWaitNode.reset();
+  _tradeNode.reset();
+  _ownerState = OwnerState::UNKNOWN;
 
-
-    if (!_rootNode) {
-      _rootNode = std::move(node);
-      _currentNode = _rootNode.get();
-    } else {
-      assert(parent != nullptr);
-      parent->_children.push_back(std::move(node));
-    }
-  }
+  // The root node is copied from the shared tree,
+  // since the npcs may append different options to it.
+  _rootNode = std::make_unique<DialogueTree::Node>(_profile->nodes.front());
+  _currentNode = _rootNode.get();
 
 
   // What's the effect of a "QuestDialogueTree"?
   // e.g., if `_isQuestDialogue` == ture, then the dialogue to
   //       toggle following/dismiss won't be present.
-  _isQuestDialogueTree = json["isQuestDialogueTree"].GetBool();
+  _isQuestDialogueTree = _profile->isQuestDialogueTree;
 
   if (_isQuestDialogueTree) {
     return;
@@ -124,65 +69,100 @@ void DialogueTree::import(const string& jsonFileName) {
   // If the dialogue tree's owner is a recruitable Npc,
   // then add the following DialogueTree::Nodes as root node's children.
   // (1) toggle join/leave (recruit/dismiss) party
-  // (2) toggle wait/follow (if this Npc already belongs to a party)
+  // (2) toggle wait/follow (only visible if this Npc belongs to a party, see update())
   if (_owner->getNpcProfile().isRecruitable) {
-    auto toggleJoinPartyNode = std::make_unique<DialogueTree::Node>(this);
-    toggleJoinPartyNode->_lines.resize(1);
-    toggleJoinPartyNode->_cmds.resize(1);
-    _toggleJoinPartyNode = toggleJoinPartyNode.get();
-    _rootNode->_children.push_back(std::move(toggleJoinPartyNode));
-
-    if (_owner->getParty()) {
-      auto toggleWaitNode = std::make_unique<DialogueTree::Node>(this);
-      toggleWaitNode->_lines.resize(1);
-      toggleWaitNode->_cmds.resize(1);
-      _toggleWaitNode = toggleWaitNode.get();
-      _rootNode->_children.push_back(std::move(toggleWaitNode));
-    }
+    _toggleJoinPartyNode = std::make_unique<DialogueTree::Node>();
+    _toggleJoinPartyNode->_lines.resize(1);
+    _toggleJoinPartyNode->_cmds.resize(1);
+    _rootNode->_children.push_back(_toggleJoinPartyNode.get());
+
+    _toggleWaitNode = std::make_unique<DialogueTree::Node>();
+    _toggleWaitNode->_lines.resize(1);
+    _toggleWaitNode->_cmds.resize(1);
+    _rootNode->_children.push_back(_toggleWaitNode.get());
   }
 
   // If the dialogue tree's owner is a tradable Npc,
   // then add trade dialogue as a root node's child.
   if (_owner->getNpcProfile().isTradable) {
-    auto tradeNode = std::make_unique<DialogueTree::Node>(this);
-    tradeNode->_lines.push_back("Let's trade.");
-    tradeNode->_cmds.push_back("tradeWithPlayer");
-    _tradeNode = tradeNode.get();
-    _rootNode->_children.push_back(std::move(tradeNode));
+    _tradeNode = std::make_unique<DialogueTree::Node>();
+    _tradeNode->_lines.push_back(TextId("Let's trade."));
+    _tradeNode->_cmds.push_back("tradeWithPlayer");
+    _tradeNode->_script = ScriptRunner::compile(_tradeNode->_cmds);
+    _rootNode->_children.push_back(_tradeNode.get());
   }
 
   update();
 }
 
 void DialogueTree::update() {
-  if (_toggleJoinPartyNode) {
-    if (!_owner->isInPlayerParty()) {
-      _toggleJoinPartyNode->_lines.front() = "Follow me.";
-      _toggleJoinPartyNode->_cmds.front() = "joinPlayerParty";
-    } else {
-      _toggleJoinPartyNode->_lines.front() = "It's time for us to part ways";
-      _toggleJoinPartyNode->_cmds.front() = "leavePlayerParty";
-    }
+  // These scripts are shared by all dialogue trees.
+  static const ScriptRunner::Script kJoinPartyScript = ScriptRunner::compile({"joinPlayerParty"});
+  static const ScriptRunner::Script kLeavePartyScript = ScriptRunner::compile({"leavePlayerParty"});
+  static const ScriptRunner::Script kWaitScript = ScriptRunner::compile({"playerPartyMemberWait"});
+  static const ScriptRunner::Script kFollowScript = ScriptRunner::compile({"playerPartyMemberFollow"});
+  static const TextId kJoinPartyLine("Follow me.");
+  static const TextId kLeavePartyLine("It's time for us to part ways");
+  static const TextId kWaitLine("Wait here.");
+  static const TextId kFollowLine("Continue to follow me.");
+
+  if (!_toggleJoinPartyNode) {
+    return;
   }
-  
-  if (_toggleWaitNode) {
-    if (!_owner->isWaitingForPlayer()) {
-      _toggleWaitNode->_lines.front() = "Wait here.";
-      _toggleWaitNode->_cmds.front() = "playerPartyMemberWait";
-    } else {
-      _toggleWaitNode->_lines.front() = "Continue to follow me.";
-      _toggleWaitNode->_cmds.front() = "playerPartyMemberFollow";
-    }
+
+  const uint8_t ownerState = getOwnerState();
+  if (ownerState == _ownerState) {
+    return;
+  }
+  _ownerState = ownerState;
+
+  if (!(ownerState & OwnerState::IN_PLAYER_PARTY)) {
+    _toggleJoinPartyNode->_lines.front() = kJoinPartyLine;
+    _toggleJoinPartyNode->_cmds.front() = "joinPlayerParty";
+    _toggleJoinPartyNode->_script = kJoinPartyScript;
+  } else {
+    _toggleJoinPartyNode->_lines.front() = kLeavePartyLine;
+    _toggleJoinPartyNode->_cmds.front() = "leavePlayerParty";
+    _toggleJoinPartyNode->_script = kLeavePartyScript;
+  }
+
+  if (!(ownerState & OwnerState::WAITING_FOR_PLAYER)) {
+    _toggleWaitNode->_lines.front() = kWaitLine;
+    _toggleWaitNode->_cmds.front() = "playerPartyMemberWait";
+    _toggleWaitNode->_script = kWaitScript;
+  } else {
+    _toggleWaitNode->_lines.front() = kFollowLine;
+    _toggleWaitNode->_cmds.front() = "playerPartyMemberFollow";
+    _toggleWaitNode->_script = kFollowScript;
+  }
+
+  // The toggle wait/follow node stays right after the toggle join/leave node.
+  vector<DialogueTree::Node*>& rootChildren = _rootNode->_children;
+  auto it = std::find(rootChildren.begin(), rootChildren.end(), _toggleWaitNode.get());
+  const bool isToggleWaitNodeVisible = ownerState & OwnerState::HAS_PARTY;
+  if (!isToggleWaitNodeVisible && it != rootChildren.end()) {
+    rootChildren.erase(it);
+  } else if (isToggleWaitNodeVisible && it == rootChildren.end()) {
+    it = std::find(rootChildren.begin(), rootChildren.end(), _toggleJoinPartyNode.get());
+    rootChildren.insert(it + 1, _toggleWaitNode.get());
   }
 }
 
 
-DialogueTree::Node* DialogueTree::getNode(const string& nodeName) const {
-  auto it = _nodeMapper.find(nodeName);
-  if (it == _nodeMapper.end()) {
+const string& DialogueTree::getJsonFileName() const {
+  return _jsonFileName;
+}
+
+DialogueTree::Node* DialogueTree::getNode(const string& nodeName) {
+  auto it = _profile->namedNodes.find(nodeName);
+  if (it == _profile->namedNodes.end()) {
     return nullptr;
   }
-  return it->second;
+  return (it->second == &_profile->nodes.front()) ? _rootNode.get() : it->second;
+}
+
+const vector<DialogueTree::Node*>& DialogueTree::getChildren(const DialogueTree::Node* node) const {
+  return (node->_isRefToRoot) ? _rootNode->_children : node->_children;
 }
 
 
@@ -199,30 +179,125 @@ void DialogueTree::setCurrentNode(DialogueTree::Node* node) {
 }
 
 void DialogueTree::resetCurrentNode() {
-  _currentNode = _rootNode.get();
+  _currentNode = getRootNode();
 }
 
 
-string DialogueTree::getLatestNpcDialogueTree(const string& npcJsonFileName) {
-  auto it = _latestNpcDialogueTree.find(npcJsonFileName);
-  return (it != _latestNpcDialogueTree.end()) ? it->second : "";
+const string& DialogueTree::getLatestNpcDialogueTree(AssetId npcId) {
+  static const string kNoUpdate;
+  auto it = _latestNpcDialogueTree.find(npcId);
+  return (it != _latestNpcDialogueTree.end()) ? it->second : kNoUpdate;
 }
 
-void DialogueTree::setLatestNpcDialogueTree(const string& npcJsonFileName,
-                                            const string& dialogueTreeJsonFileName) {
-  _latestNpcDialogueTree[npcJsonFileName] = dialogueTreeJsonFileName;
+void DialogueTree::setLatestNpcDialogueTree(AssetId npcId, const string& dialogueTreeJsonFileName) {
+  _latestNpcDialogueTree[npcId] = dialogueTreeJsonFileName;
+}
+
+
+uint8_t DialogueTree::getOwnerState() const {
+  uint8_t ownerState = 0;
+  if (_owner->getParty()) {
+    ownerState |= OwnerState::HAS_PARTY;
+  }
+  if (_owner->isInPlayerParty()) {
+    ownerState |= OwnerState::IN_PLAYER_PARTY;
+  }
+  if (_owner->isWaitingForPlayer()) {
+    ownerState |= OwnerState::WAITING_FOR_PLAYER;
+  }
+  return ownerState;
 }
 
 
 
-DialogueTree::Node::Node(DialogueTree* tree)
-    : _tree(tree), _nodeName(), _lines(), _cmds(), _children() {}
+DialogueTree::Profile::Profile(const string& jsonFileName)
+    : isQuestDialogueTree(),
+      nodes(),
+      namedNodes() {
+  VGLOG(LOG_INFO, "Loading dialogue tree...");
+
+  // The json is only needed while building the nodes.
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  const rapidjson::Value& rootNode = jsonDocument.get();
+  isQuestDialogueTree = rootNode["isQuestDialogueTree"].GetBool();
+
+  // Build all nodes using tree DFS, and then resolve their children.
+  // DFS 大師 !!!!!!! XDDDDDDDDD
+  stack<pair<const rapidjson::Value*, DialogueTree::Node*>> st;  // <json, parent>
+  st.push({&rootNode, nullptr});
+
+  while (!st.empty()) {
+    const rapidjson::Value* jsonNode = st.top().first;
+    DialogueTree::Node* parent = st.top().second;
+    st.pop();
+
+    nodes.emplace_back();
+    DialogueTree::Node& node = nodes.back();
+    if (parent) {
+      parent->_children.push_back(&node);
+    }
+
+    if (jsonNode->HasMember("nodeName")) {
+      node._nodeName = (*jsonNode)["nodeName"].GetString();
+      namedNodes.insert({node._nodeName, &node});
+    }
+
+    const auto& lines = (*jsonNode)["lines"].GetArray();
+    node._lines.reserve(lines.Size());
+    for (const auto& line : lines) {
+      node._lines.push_back(TextId(line.GetString()));
+    }
+
+    const auto& cmds = (*jsonNode)["exec"].GetArray();
+    node._cmds.reserve(cmds.Size());
+    for (const auto& cmd : cmds) {
+      node._cmds.push_back(cmd.GetString());
+    }
+    node._script = ScriptRunner::compile(node._cmds);
+
+    if (jsonNode->HasMember("childrenRef")) {
+      node._childrenRef = (*jsonNode)["childrenRef"].GetString();
+    } else if (jsonNode->HasMember("children")) {
+      // Pushed in reverse, so that the children are popped (and appended) in order.
+      const auto& children = (*jsonNode)["children"].GetArray();
+      node._children.reserve(children.Size());
+      for (auto it = children.End(); it != children.Begin(); ) {
+        st.push({--it, &node});
+      }
+    }
+  }
+
+  for (auto& node : nodes) {
+    if (node._childrenRef.empty()) {
+      continue;
+    }
+
+    auto it = namedNodes.find(node._childrenRef);
+    if (it == namedNodes.end()) {
+      VGLOG(LOG_ERR, "Dialogue node not found: %s", node._childrenRef.c_str());
+    } else if (it->second == &nodes.front()) {
+      node._isRefToRoot = true;
+    } else {
+      node._children = it->second->_children;
+    }
+  }
+}
+
+
+DialogueTree::Node::Node()
+    : _nodeName(),
+      _lines(),
+      _cmds(),
+      _script(),
+      _childrenRef(),
+      _children(),
+      _isRefToRoot() {}
 
 const string& DialogueTree::Node::getNodeName() const {
   return _nodeName;
 }
 
-const vector<string>& DialogueTree::Node::getLines() const {
+const vector<TextId>& DialogueTree::Node::getLines() const {
   return _lines;
 }
 
@@ -230,13 +305,12 @@ const vector<string>& DialogueTree::Node::getCmds() const {
   return _cmds;
 }
 
-vector<DialogueTree::Node*> DialogueTree::Node::getChildren() const {
-  if (_childrenRef.empty()) {
-    return uniqueVec2RawVec<Dialogue>(_children);
-  }
+const ScriptRunner::Script& DialogueTree::Node::getScript() const {
+  return _script;
+}
 
-  DialogueTree::Node* refNode = _tree->getNode(_childrenRef);
-  return uniqueVec2RawVec<Dialogue>(refNode->_children);
+const string& DialogueTree::Node::getChildrenRef() const {
+  return _childrenRef;
 }
 
 }  // namespace vigilante
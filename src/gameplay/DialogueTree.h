@@ -2,85 +2,137 @@
 #ifndef VIGILANTE_DIALOGUE_TREE_H_
 #define VIGILANTE_DIALOGUE_TREE_H_
 
+#include <cstdint>
+#include <deque>
 #include <string>
 #include <vector>
 #include <memory>
 #include <unordered_map>
 
 #include "Importable.h"
+#include "gameplay/ScriptRunner.h"
+#include "util/AssetId.h"
+#include "util/TextId.h"
 
 namespace vigilante {
 
+class GameState;
 class Npc;
 
 class DialogueTree : public Importable {
  public:
   DialogueTree(const std::string& jsonFileName, Npc* owner);
   DialogueTree(const DialogueTree&) = delete;
-  DialogueTree(DialogueTree&& other) noexcept;
+  DialogueTree(DialogueTree&&) noexcept = default;
   DialogueTree& operator=(const DialogueTree&) = delete;
-  DialogueTree& operator=(DialogueTree&& other) noexcept;
+  DialogueTree& operator=(DialogueTree&&) noexcept = default;
   virtual ~DialogueTree() = default;
 
+  // Re-evaluates the options which depend on the owner's state
+  // (e.g., recruit / dismiss). Nothing is rebuilt unless that state has changed.
   virtual void update();
 
 
   class Node final {
    public:
-    explicit Node(DialogueTree* tree);
+    Node();
     ~Node() = default;
 
     const std::string& getNodeName() const;
-    const std::vector<std::string>& getLines() const;
+    const std::vector<TextId>& getLines() const;
     const std::vector<std::string>& getCmds() const;
+    const ScriptRunner::Script& getScript() const;  // compiled from getCmds()
     const std::string& getChildrenRef() const;
-    std::vector<Node*> getChildren() const;
 
    private:
-    DialogueTree* _tree;
-
     std::string _nodeName;  // only required when `childrenRef` exists. See comment below.
-    std::vector<std::string> _lines;
+    std::vector<TextId> _lines;
     std::vector<std::string> _cmds;  // the command to execute after all lines are shown.
+    ScriptRunner::Script _script;
 
     // We have two (mutually exclusive) methods for keeping children:
     //
     // (a) childrenRef: we reference another node's children by its `nodeName`.
     //                               ~~~~~~~~~~~~               ~~~
     //                                    |______________________|
-    // (b) children: we actually keep unique_ptr<Node> to the nodes.
+    // (b) children: the child nodes.
+    //
+    // Either way, the children are resolved into `_children` once the tree is built.
+    // If the referenced node is the root node, then `_isRefToRoot` is true instead,
+    // since the options of the root node differ between npcs (see DialogueTree::getChildren()).
     std::string _childrenRef;
-    std::vector<std::unique_ptr<Node>> _children;
+    std::vector<Node*> _children;
+    bool _isRefToRoot;
 
     friend class DialogueTree;
   };
 
 
+  // The immutable nodes of a dialogue tree, shared by all the DialogueTrees
+  // imported from the same file (see util/ProfileCache.h), e.g., by all the
+  // villagers who say the same things. Each DialogueTree only keeps
+  // its own cursor and root node (whose options depend on the owner).
+  struct Profile final {
+    explicit Profile(const std::string& jsonFileName);
+    ~Profile() = default;
+
+    bool isQuestDialogueTree;
+
+    // A deque never relocates its elements when growing, so the nodes
+    // may refer to each other by pointers. nodes[0] is the root node.
+    std::deque<DialogueTree::Node> nodes;
+
+    // nodeName -> that node
+    std::unordered_map<std::string, DialogueTree::Node*> namedNodes;
+  };
+
+
+  // Replaces the whole tree with the one in `jsonFileName`.
   virtual void import(const std::string& jsonFileName) override;  // Importable
+  const std::string& getJsonFileName() const;
+
+  // Returns nullptr if there's no such node.
+  DialogueTree::Node* getNode(const std::string& nodeName);
+  // The options currently visible to the player after `node`.
+  const std::vector<DialogueTree::Node*>& getChildren(const DialogueTree::Node* node) const;
 
-  DialogueTree::Node* getNode(const std::string& nodeName) const;
-  
   DialogueTree::Node* getRootNode() const;
   DialogueTree::Node* getCurrentNode() const;
   void setCurrentNode(DialogueTree::Node* node);
   void resetCurrentNode();
 
-  static std::string getLatestNpcDialogueTree(const std::string& npcJsonFileName);
-  static void setLatestNpcDialogueTree(const std::string& npcJsonFileName,
-                                       const std::string& dialogueTreeJsonFileName);
+  // Returns an empty string if there's no update for this npc.
+  static const std::string& getLatestNpcDialogueTree(AssetId npcId);
+  static void setLatestNpcDialogueTree(AssetId npcId, const std::string& dialogueTreeJsonFileName);
 
  private:
-  static std::unordered_map<std::string, std::string> _latestNpcDialogueTree;
+  // npc json id -> dialogue tree json file name
+  // Saved and restored by GameState.
+  static std::unordered_map<AssetId, std::string> _latestNpcDialogueTree;
+  friend class GameState;
+
+  // The bits of the owner's state which the options depend on.
+  enum OwnerState : uint8_t {
+    HAS_PARTY = 1 << 0,
+    IN_PLAYER_PARTY = 1 << 1,
+    WAITING_FOR_PLAYER = 1 << 2,
+    UNKNOWN = 0xff
+  };
 
-  // <nodeName, DialogueTree::Node*>
-  std::unordered_map<std::string, DialogueTree::Node*> _nodeMapper;
-  std::unique_ptr<DialogueTree::Node> _rootNode;
-  DialogueTree::Node* _currentNode;
+  uint8_t getOwnerState() const;
 
-  DialogueTree::Node* _toggleJoinPartyNode;
-  DialogueTree::Node* _toggleWaitNode;
-  DialogueTree::Node* _tradeNode;
+  std::string _jsonFileName;
+  std::shared_ptr<const DialogueTree::Profile> _profile;
 
+  // The nodes owned by this DialogueTree. They're heap allocated,
+  // so they stay at the same addresses when this tree is moved.
+  std::unique_ptr<DialogueTree::Node> _rootNode;
+  std::unique_ptr<DialogueTree::Node> _toggleJoinPartyNode;
+  std::unique_ptr<DialogueTree::Node> _toggleWaitNode;
+  std::unique_ptr<DialogueTree::Node> _tradeNode;
+  uint8_t _ownerState;  // which the options were last evaluated with
+
+  DialogueTree::Node* _currentNode;
   bool _isQuestDialogueTree;
   Npc* _owner;
 };
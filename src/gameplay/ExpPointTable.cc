@@ -2,20 +2,29 @@
 #include "ExpPointTable.h"
 
 #include <array>
+#include <climits>
 #include <fstream>
 #include <stdexcept>
 
+#include <cocos2d.h>
+#include "util/ds/BinaryStream.h"
 #include "util/Logger.h"
+#include "util/MappedFile.h"
+
+#define EXP_POINT_TABLE_PACK_MAGIC 0x50584556  // "VEXP"
+#define EXP_POINT_TABLE_PACK_VERSION 1
 
 using std::string;
 using std::array;
 using std::ifstream;
 using std::runtime_error;
+using cocos2d::FileUtils;
 
 namespace vigilante {
 
 namespace {
 
+// level -> the exp needed to reach the next level
 array<int, exp_point_table::kLevelCap> levelUpExp;
 
 }  // namespace
@@ -34,11 +43,50 @@ void import(const string& tableFileName) {
     int level;
     int exp;
     fin >> level >> exp;
-    levelUpExp[level] = exp;
+    if (level >= 0 && level < kLevelCap) {
+      levelUpExp[level] = exp;
+    }
   }
 }
 
+bool importPack(const string& packFileName) {
+  const string fullPath = FileUtils::getInstance()->fullPathForFilename(packFileName);
+  if (fullPath.empty()) {
+    return false;
+  }
+
+  MappedFile file(fullPath);
+  BinaryReader reader(file.getData(), file.getData() + file.getSize());
+  const uint32_t magic = reader.read<uint32_t>();
+  const uint32_t version = reader.read<uint32_t>();
+  const uint32_t numLevels = reader.readCount();
+  if (!file.isOpen() || !reader.isOk() ||
+      magic != EXP_POINT_TABLE_PACK_MAGIC || version != EXP_POINT_TABLE_PACK_VERSION) {
+    VGLOG(LOG_ERR, "Invalid exp point table pack: %s", fullPath.c_str());
+    return false;
+  }
+
+  array<int, kLevelCap> exps{};
+  for (uint32_t level = 0; level < numLevels; level++) {
+    const int exp = reader.read<int32_t>();
+    if (level < exps.size()) {
+      exps[level] = exp;
+    }
+  }
+  if (!reader.isOk()) {
+    VGLOG(LOG_ERR, "Invalid exp point table pack: %s", fullPath.c_str());
+    return false;
+  }
+
+  VGLOG(LOG_INFO, "Loading exp point table from pack...");
+  levelUpExp = exps;
+  return true;
+}
+
 int getNextLevelExp(int currentLevel) {
+  if (currentLevel < 0 || currentLevel >= kLevelCap) {
+    return INT_MAX;
+  }
   return levelUpExp[currentLevel];
 }
 
@@ -9,6 +9,11 @@ namespace vigilante {
 namespace exp_point_table {
 
 void import(const std::string& tableFileName);
+// Imports the table compiled by scripts/TablePacker.py.
+// Returns false if there's no such pack or it's invalid.
+bool importPack(const std::string& packFileName);
+
+// Returns INT_MAX if `currentLevel` is beyond the table.
 int getNextLevelExp(int currentLevel);
 
 const int kLevelCap = 100;
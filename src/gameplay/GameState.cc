@@ -1,35 +1,845 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "GameState.h"
 
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
 
-using std::endl;
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <zlib.h>
+
+#include "Constants.h"
+#include "character/Npc.h"
+#include "character/NpcPool.h"
+#include "character/Party.h"
+#include "character/Player.h"
+#include "gameplay/CameraSystem.h"
+#include "gameplay/DialogueTree.h"
+#include "item/Consumable.h"
+#include "map/DormantWorld.h"
+#include "map/GameMapManager.h"
+#include "map/WorldEpoch.h"
+#include "map/WorldState.h"
+#include "quest/KillTargetObjective.h"
+#include "skill/Skill.h"
+#include "util/ds/BinaryStream.h"
+#include "util/AssetId.h"
+#include "util/MappedFile.h"
+#include "util/ThreadPool.h"
+#include "util/Logger.h"
+
+#define GAME_SAVE_MAGIC 0x53534756  // "VGSS"
+#define GAME_SAVE_VERSION 2
+#define GAME_SAVE_MAX_SIZE (64 << 20)  // of the uncompressed sections
+#define NO_STRING UINT32_MAX  // the index of an empty name
+
+using std::pair;
 using std::string;
-using std::ifstream;
-using std::ofstream;
+using std::vector;
+using std::shared_ptr;
+using std::unordered_map;
 
 namespace vigilante {
 
-GameState::GameState() {}
+std::atomic<bool> GameState::_isWriting(false);
+
+namespace {
+
+const string& readName(BinaryReader& reader, const vector<string>& strings) {
+  static const string kNoName;
+  const uint32_t index = reader.read<uint32_t>();
+  return (index < strings.size()) ? strings[index] : kNoName;
+}
+
+}  // namespace
+
+
+class GameState::StringTable final {
+ public:
+  StringTable() : _indices(), _strings() {}
+
+  void write(BinaryWriter& writer, const string& s) {
+    if (s.empty()) {
+      writer.write<uint32_t>(NO_STRING);
+      return;
+    }
+
+    auto it = _indices.find(s);
+    if (it == _indices.end()) {
+      it = _indices.insert({s, static_cast<uint32_t>(_strings.size())}).first;
+      _strings.push_back(s);
+    }
+    writer.write<uint32_t>(it->second);
+  }
+
+  const vector<string>& getStrings() const {
+    return _strings;
+  }
+
+ private:
+  unordered_map<string, uint32_t> _indices;
+  vector<string> _strings;
+};
+
 
+GameState::GameState()
+    : _filePath(),
+      _tmxMapFileName(),
+      _playerX(),
+      _playerY(),
+      _stats(),
+      _items(),
+      _equipments(),
+      _skills(),
+      _hotkeys(),
+      _quests(),
+      _partyMembers(),
+      _waitingMembers(),
+      _portalStates(),
+      _latestNpcDialogueTrees(),
+      _npcSpawningBlacklist(),
+      _mapStates() {}
 
-void GameState::load() {
-  ifstream fin(_filePath);
-  fin >> *this;
+
+bool GameState::save() {
+  string sections;
+  if (!serialize(&sections)) {
+    return false;
+  }
+  return writeFile(_filePath, sections);
+}
+
+bool GameState::saveAsync() {
+  // Don't pile up the writes if the disk can't keep up, e.g., the previous
+  // autosave is still being written. The next one will catch up.
+  bool isWriting = false;
+  if (!_isWriting.compare_exchange_strong(isWriting, true)) {
+    return false;
+  }
+
+  // Only the snapshot is taken on the main thread. It's moved into the task,
+  // so the game may go on while it's compressed and written.
+  auto sections = std::make_shared<string>();
+  if (!serialize(sections.get())) {
+    _isWriting = false;
+    return false;
+  }
+
+  const string filePath = _filePath;
+  ThreadPool::getInstance()->post([filePath, sections]() {
+    GameState::writeFile(filePath, *sections);
+    _isWriting = false;
+  });
+  return true;
 }
 
-void GameState::save() {
-  ofstream fout(_filePath);
-  fout << *this;
+bool GameState::load() {
+  MappedFile file(_filePath);
+  if (!file.isOpen()) {
+    VGLOG(LOG_ERR, "Unable to load game: failed to open %s", _filePath.c_str());
+    return false;
+  }
+
+  BinaryReader header(file.getData(), file.getData() + file.getSize());
+  const uint32_t magic = header.read<uint32_t>();
+  const uint32_t version = header.read<uint32_t>();
+  const uint32_t sectionsSize = header.read<uint32_t>();
+  if (!header.isOk() || magic != GAME_SAVE_MAGIC || version != GAME_SAVE_VERSION ||
+      sectionsSize > GAME_SAVE_MAX_SIZE) {
+    VGLOG(LOG_ERR, "Unable to load game: %s is not a compatible save file", _filePath.c_str());
+    return false;
+  }
+
+  // The sections are deflated as a whole, see writeFile().
+  const size_t headerSize = 3 * sizeof(uint32_t);
+  string sections(sectionsSize, '\0');
+  uLongf uncompressedSize = sectionsSize;
+  if (uncompress(reinterpret_cast<Bytef*>(&sections[0]), &uncompressedSize,
+                 reinterpret_cast<const Bytef*>(file.getData() + headerSize),
+                 file.getSize() - headerSize) != Z_OK || uncompressedSize != sectionsSize) {
+    VGLOG(LOG_ERR, "Unable to load game: %s is corrupted", _filePath.c_str());
+    return false;
+  }
+
+  if (!deserialize(sections)) {
+    VGLOG(LOG_ERR, "Unable to load game: %s is corrupted", _filePath.c_str());
+    return false;
+  }
+
+  // The world state must be restored before the GameMap is loaded,
+  // since it determines which npcs are spawned and which portals are locked.
+  restoreWorldState();
+
+  GameMapManager::getInstance()->loadGameMap(_tmxMapFileName, [state = *this]() {
+    if (Player* player = GameMapManager::getInstance()->getPlayer()) {
+      state.restorePlayer(player);
+    }
+  });
+  return true;
+}
+
+bool GameState::saveToMemory(string* snapshot) {
+  return serialize(snapshot);
+}
+
+bool GameState::restoreInPlace(const string& snapshot) {
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  Player* player = gmMgr->getPlayer();
+  GameMap* gameMap = gmMgr->getGameMap();
+  if (!player || !gameMap || world_epoch::isInTransition()) {
+    VGLOG(LOG_ERR, "Unable to restore checkpoint: no game is in progress.");
+    return false;
+  }
+
+  if (!deserialize(snapshot)) {
+    VGLOG(LOG_ERR, "Unable to restore checkpoint: the snapshot is corrupted");
+    return false;
+  }
+  if (_tmxMapFileName != gameMap->getTmxTiledMapFileName()) {
+    VGLOG(LOG_ERR, "Unable to restore checkpoint: it was taken in [%s]", _tmxMapFileName.c_str());
+    return false;
+  }
+
+  // Pauses all NPCs from acting, and drops the callbacks (e.g., the deferred
+  // spawns) of the objects which are about to be replaced.
+  world_epoch::beginTransition();
+
+  restoreWorldState();
+  gmMgr->resetGameMap();
+
+  // Revive the player. The hotkeys are unbound before reset()
+  // drops the items which they refer to.
+  HotkeyManager* hotkeyManager = HotkeyManager::getInstance();
+  for (const auto keyCode : HotkeyManager::_kBindableKeys) {
+    hotkeyManager->clearHotkeyAction(keyCode);
+  }
+  player->removeFromMap();
+  player->reset();
+  player->showOnMap(_playerX * kPpm, _playerY * kPpm);
+  restorePlayer(player);
+
+  world_epoch::endTransition();
+
+  const b2Vec2& playerPos = player->getBody()->GetPosition();
+  CameraSystem::getInstance()->snapTo(playerPos, gameMap);
+  gameMap->spawnQueuedActors({playerPos.x * kPpm, playerPos.y * kPpm});
+  return true;
+}
+
+
+bool GameState::serialize(string* sections) {
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  if (!player || !GameMapManager::getInstance()->getGameMap()) {
+    VGLOG(LOG_ERR, "Unable to save game: no game is in progress.");
+    return false;
+  }
+  capture(player);
+
+  // The other sections are written first, since the string table
+  // is only complete after all of them have been written.
+  StringTable strings;
+  vector<pair<Section, BinaryWriter>> sectionWriters;
+  for (const auto section : {Section::WORLD, Section::PLAYER, Section::INVENTORY,
+                             Section::SKILLS, Section::HOTKEYS, Section::QUESTS,
+                             Section::PARTY, Section::PORTALS, Section::DIALOGUE_TREES,
+                             Section::NPC_SPAWNING_BLACKLIST, Section::MAP_STATES}) {
+    sectionWriters.push_back({section, BinaryWriter()});
+    writeSection(section, sectionWriters.back().second, strings);
+  }
+
+  BinaryWriter stringTableWriter;
+  stringTableWriter.write<uint32_t>(strings.getStrings().size());
+  for (const auto& s : strings.getStrings()) {
+    stringTableWriter.writeString(s);
+  }
+
+  // Each section is written as (tag, size, payload).
+  BinaryWriter writer;
+  writer.write<uint32_t>(Section::STRING_TABLE);
+  writer.writeString(stringTableWriter.getBuffer());
+  for (const auto& p : sectionWriters) {
+    writer.write<uint32_t>(p.first);
+    writer.writeString(p.second.getBuffer());
+  }
+
+  *sections = writer.getBuffer();
+  return true;
+}
+
+bool GameState::writeFile(const string& filePath, const string& sections) {
+  uLongf compressedSize = compressBound(sections.size());
+  string data(3 * sizeof(uint32_t) + compressedSize, '\0');
+  if (compress2(reinterpret_cast<Bytef*>(&data[3 * sizeof(uint32_t)]), &compressedSize,
+                reinterpret_cast<const Bytef*>(sections.data()), sections.size(),
+                Z_BEST_SPEED) != Z_OK) {
+    VGLOG(LOG_ERR, "Unable to save game: failed to compress %s", filePath.c_str());
+    return false;
+  }
+
+  const uint32_t header[] = {GAME_SAVE_MAGIC, GAME_SAVE_VERSION, static_cast<uint32_t>(sections.size())};
+  std::memcpy(&data[0], header, sizeof(header));
+  data.resize(sizeof(header) + compressedSize);
+
+  // Write to a temporary file first, flush it to the disk, and then atomically
+  // rename it, so that the previous save won't be lost if the game crashes midway.
+  const string tmpFilePath = filePath + ".tmp";
+#ifdef _WIN32
+  std::ofstream fout(tmpFilePath, std::ios::binary | std::ios::trunc);
+  fout.write(data.data(), data.size());
+  fout.close();
+  const bool isWritten = static_cast<bool>(fout);
+#else
+  bool isWritten = false;
+  const int fd = ::open(tmpFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    isWritten = ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()) &&
+                ::fsync(fd) == 0;
+    isWritten &= ::close(fd) == 0;
+  }
+#endif
+
+  if (!isWritten || std::rename(tmpFilePath.c_str(), filePath.c_str()) != 0) {
+    VGLOG(LOG_ERR, "Unable to save game: failed to write %s", filePath.c_str());
+    std::remove(tmpFilePath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool GameState::deserialize(const string& sections) {
+  const string filePath = _filePath;
+  *this = GameState();
+  _filePath = filePath;
+
+  BinaryReader reader(sections.data(), sections.data() + sections.size());
+  vector<string> strings;
+  while (!reader.isEof()) {
+    const uint32_t tag = reader.read<uint32_t>();
+    const string payload = reader.readString();
+    if (!reader.isOk()) {
+      break;
+    }
+
+    BinaryReader sectionReader(payload.data(), payload.data() + payload.size());
+    if (tag == Section::STRING_TABLE) {
+      strings.resize(sectionReader.readCount());
+      for (auto& s : strings) {
+        s = sectionReader.readString();
+      }
+      if (!sectionReader.isOk()) {
+        break;
+      }
+    } else if (!readSection(static_cast<Section>(tag), sectionReader, strings)) {
+      break;
+    }
+  }
+
+  return reader.isOk() && reader.isEof() && !_tmxMapFileName.empty();
+}
+
+
+void GameState::capture(Player* player) {
+  _tmxMapFileName = GameMapManager::getInstance()->getGameMap()->getTmxTiledMapFileName();
+  _playerX = player->getBody()->GetPosition().x;
+  _playerY = player->getBody()->GetPosition().y;
+
+  const Character::Profile& profile = player->getCharacterProfile();
+  _stats = {
+    profile.level,
+    profile.exp,
+    player->getStat(StatsSystem::Stat::HEALTH),
+    player->getStat(StatsSystem::Stat::MAGICKA),
+    player->getStat(StatsSystem::Stat::STAMINA),
+    profile.strength,
+    profile.dexterity,
+    profile.intelligence,
+    profile.luck
+  };
+
+  _items.clear();
+  for (const auto& items : player->getInventory()) {
+    for (const auto item : items) {
+      _items.push_back({item->getItemProfile().jsonFileName, item->getAmount()});
+    }
+  }
+  for (int i = 0; i < Equipment::Type::SIZE; i++) {
+    Equipment* equipment = player->getEquipmentSlots()[i];
+    _equipments[i] = (equipment) ? equipment->getItemProfile().jsonFileName : "";
+  }
+
+  _skills.clear();
+  for (const auto& skills : player->getSkillBook()) {
+    for (const auto skill : skills) {
+      _skills.push_back(skill->getSkillProfile().jsonFileName);
+    }
+  }
+
+  for (int i = 0; i < HotkeyManager::BindableKeys::SIZE; i++) {
+    Keybindable* action = HotkeyManager::getInstance()->getHotkeyAction(HotkeyManager::_kBindableKeys[i]);
+    if (Skill* skill = dynamic_cast<Skill*>(action)) {
+      _hotkeys[i] = {Hotkey::Type::SKILL, skill->getSkillProfile().jsonFileName};
+    } else if (Consumable* consumable = dynamic_cast<Consumable*>(action)) {
+      _hotkeys[i] = {Hotkey::Type::ITEM, consumable->getItemProfile().jsonFileName};
+    } else {
+      _hotkeys[i] = {Hotkey::Type::NONE, ""};
+    }
+  }
+
+  _quests.clear();
+  for (const auto quest : player->getQuestBook().getAllQuests()) {
+    int objectiveProgress = 0;
+    if (!quest->isCompleted() && quest->getCurrentStageIdx() >= 0) {
+      const auto& objective = quest->getCurrentStage().objective;
+      if (objective && objective->getObjectiveType() == Quest::Objective::Type::KILL) {
+        objectiveProgress = static_cast<KillTargetObjective*>(objective.get())->getCurrentAmount();
+      }
+    }
+    _quests.push_back({quest->getQuestProfile().jsonFileName, quest->isUnlocked(),
+                       quest->getCurrentStageIdx(), objectiveProgress});
+  }
+
+  _partyMembers.clear();
+  _waitingMembers.clear();
+  if (shared_ptr<Party> party = player->getParty()) {
+    for (const auto& member : party->getMembers()) {
+      _partyMembers.push_back(member->getCharacterProfile().jsonFileName);
+    }
+    for (const auto& p : party->getWaitingMembersLocationInfo()) {
+      // The dormant members aren't constructed, but are still members of the party.
+      if (p.second.isDormant) {
+        _partyMembers.push_back(p.first.getName());
+      }
+      _waitingMembers.push_back({p.first.getName(), p.second.tmxMapId.getName(), p.second.x, p.second.y});
+    }
+  }
+
+  _portalStates.clear();
+  _portalStates.reserve(GameMap::Portal::_allPortalStates.size());
+  for (const auto& p : GameMap::Portal::_allPortalStates) {
+    _portalStates.push_back({p.first.getTmxMapId().getName(), p.first.getTargetPortalId(), p.second});
+  }
+
+  _latestNpcDialogueTrees.clear();
+  for (const auto& p : DialogueTree::_latestNpcDialogueTree) {
+    _latestNpcDialogueTrees.push_back({p.first.getName(), p.second});
+  }
+
+  _npcSpawningBlacklist.clear();
+  for (const auto& npcId : Npc::_npcSpawningBlacklist) {
+    _npcSpawningBlacklist.push_back(npcId.getName());
+  }
+
+  // Only the maps which have been re-encoded since the last save cost anything here.
+  WorldState* worldState = WorldState::getInstance();
+  _mapStates.clear();
+  for (const auto tmxMapId : worldState->getChangedMaps()) {
+    _mapStates.push_back({tmxMapId.getName(), worldState->getChunk(tmxMapId)});
+  }
+}
+
+void GameState::restoreWorldState() const {
+  GameMap::Portal::_allPortalStates.clear();
+  GameMap::Portal::_allPortalStates.reserve(_portalStates.size());
+  for (const auto& portalState : _portalStates) {
+    GameMap::Portal::_allPortalStates[{AssetId(portalState.tmxMapFileName), portalState.targetPortalId}] =
+        portalState.isLocked;
+  }
+
+  DialogueTree::_latestNpcDialogueTree.clear();
+  for (const auto& p : _latestNpcDialogueTrees) {
+    DialogueTree::_latestNpcDialogueTree[AssetId(p.first)] = p.second;
+  }
+
+  Npc::_npcSpawningBlacklist.clear();
+  for (const auto& npcJsonFileName : _npcSpawningBlacklist) {
+    Npc::_npcSpawningBlacklist.insert(AssetId(npcJsonFileName));
+  }
+
+  // The pending respawns and the merchants' goods aren't saved.
+  DormantWorld::getInstance()->clear();
+
+  // The chunks are applied to the maps as they are entered, see GameMap::createObjects().
+  WorldState* worldState = WorldState::getInstance();
+  worldState->clear();
+  for (const auto& p : _mapStates) {
+    if (!worldState->restoreChunk(AssetId(p.first), p.second)) {
+      VGLOG(LOG_WARN, "Discarding the corrupted world state of map [%s].", p.first.c_str());
+    }
+  }
+}
+
+void GameState::restorePlayer(Player* player) const {
+  player->setPosition(_playerX, _playerY);
+
+  Character::Profile& profile = player->getCharacterProfile();
+  profile.level = _stats.level;
+  profile.exp = _stats.exp;
+  profile.strength = _stats.strength;
+  profile.dexterity = _stats.dexterity;
+  profile.intelligence = _stats.intelligence;
+  profile.luck = _stats.luck;
+  player->updateDerivedStats();
+  player->setStat(StatsSystem::Stat::HEALTH, _stats.health);
+  player->setStat(StatsSystem::Stat::MAGICKA, _stats.magicka);
+  player->setStat(StatsSystem::Stat::STAMINA, _stats.stamina);
+
+  // The hotkeys refer to the skills and items, so they're unbound
+  // before any of those is removed.
+  HotkeyManager* hotkeyManager = HotkeyManager::getInstance();
+  for (const auto keyCode : HotkeyManager::_kBindableKeys) {
+    hotkeyManager->clearHotkeyAction(keyCode);
+  }
+
+  // Replace the inventory and the equipment. The non-virtual calls
+  // skip Player's per-call notifications.
+  for (int i = 0; i < Equipment::Type::SIZE; i++) {
+    player->unequip(static_cast<Equipment::Type>(i));
+  }
+
+  vector<pair<Item*, int>> ownedItems;
+  for (const auto& items : player->getInventory()) {
+    for (const auto item : items) {
+      ownedItems.push_back({item, item->getAmount()});
+    }
+  }
+  player->Character::removeItems(ownedItems);
+
+  vector<pair<shared_ptr<Item>, int>> items;
+  items.reserve(_items.size());
+  for (const auto& p : _items) {
+    if (!p.first.empty() && p.second > 0) {
+      items.push_back({Item::create(p.first), p.second});
+    }
+  }
+  player->Character::addItems(items);
+
+  for (const auto& equipmentJsonFileName : _equipments) {
+    if (equipmentJsonFileName.empty()) {
+      continue;
+    }
+    player->Character::addItem(Item::create(equipmentJsonFileName), 1);
+    for (const auto item : player->getInventory()[Item::Type::EQUIPMENT]) {
+      if (item->getItemProfile().jsonFileName == equipmentJsonFileName) {
+        player->equip(dynamic_cast<Equipment*>(item));
+        break;
+      }
+    }
+  }
+
+  // Replace the skills.
+  vector<Skill*> learnedSkills;
+  for (const auto& skills : player->getSkillBook()) {
+    learnedSkills.insert(learnedSkills.end(), skills.begin(), skills.end());
+  }
+  for (const auto skill : learnedSkills) {
+    player->removeSkill(skill);
+  }
+  for (const auto& skillJsonFileName : _skills) {
+    if (!skillJsonFileName.empty()) {
+      player->addSkill(Skill::create(skillJsonFileName, player));
+    }
+  }
+
+  // Rebind the hotkeys.
+  for (int i = 0; i < HotkeyManager::BindableKeys::SIZE; i++) {
+    const Hotkey& hotkey = _hotkeys[i];
+    Keybindable* action = nullptr;
+
+    if (hotkey.type == Hotkey::Type::SKILL) {
+      for (const auto& skills : player->getSkillBook()) {
+        for (const auto skill : skills) {
+          if (skill->getSkillProfile().jsonFileName == hotkey.jsonFileName) {
+            action = skill;
+          }
+        }
+      }
+    } else if (hotkey.type == Hotkey::Type::ITEM) {
+      for (const auto item : player->getInventory()[Item::Type::CONSUMABLE]) {
+        if (item->getItemProfile().jsonFileName == hotkey.jsonFileName) {
+          action = dynamic_cast<Consumable*>(item);
+        }
+      }
+    }
+
+    if (action) {
+      hotkeyManager->setHotkeyAction(HotkeyManager::_kBindableKeys[i], action);
+    }
+  }
+
+  // The quests are restored after the inventory,
+  // since the collect objectives are synced with it.
+  QuestBook& questBook = player->getQuestBook();
+  questBook.reset();
+  for (const auto& quest : _quests) {
+    questBook.restoreQuest(quest.jsonFileName, quest.isUnlocked, quest.stageIdx, quest.objectiveProgress);
+  }
+
+  // Replace the party members. The waiting members are also members
+  // of the party, but are placed where they're waiting.
+  shared_ptr<Party> party = player->getParty();
+  if (!party) {
+    return;
+  }
+
+  const vector<Character*> allies = player->getAllies();
+  for (auto ally : allies) {
+    party->dismiss(ally, /*addToMap=*/false);
+  }
+  party->clearWaitingMembers();
+
+  GameMap* gameMap = GameMapManager::getInstance()->getGameMap();
+  for (const auto& memberJsonFileName : _partyMembers) {
+    if (memberJsonFileName.empty()) {
+      continue;
+    }
+    Npc* member = gameMap->showDynamicActor<Npc>(NpcPool::getInstance()->acquire(memberJsonFileName),
+                                                 _playerX * kPpm, _playerY * kPpm);
+    party->recruit(member);
+  }
+
+  for (const auto& waitingMember : _waitingMembers) {
+    const AssetId characterId(waitingMember.characterJsonFileName);
+    Character* member = party->getMember(characterId);
+    if (!member) {
+      continue;
+    }
+
+    const AssetId tmxMapId(waitingMember.tmxMapFileName);
+    party->addWaitingMember(characterId, tmxMapId, waitingMember.x, waitingMember.y);
+    if (tmxMapId == gameMap->getTmxTiledMapId()) {
+      member->setPosition(waitingMember.x, waitingMember.y);
+    } else {
+      party->hibernateWaitingMember(member);
+    }
+  }
+}
+
+
+void GameState::writeSection(GameState::Section section,
+                             BinaryWriter& writer,
+                             StringTable& strings) const {
+  switch (section) {
+    case Section::WORLD:
+      strings.write(writer, _tmxMapFileName);
+      writer.write(_playerX);
+      writer.write(_playerY);
+      break;
+
+    case Section::PLAYER:
+      writer.write(_stats);
+      break;
+
+    case Section::INVENTORY:
+      writer.write<uint32_t>(_items.size());
+      for (const auto& p : _items) {
+        strings.write(writer, p.first);
+        writer.write<int32_t>(p.second);
+      }
+      writer.write<uint32_t>(_equipments.size());
+      for (const auto& equipmentJsonFileName : _equipments) {
+        strings.write(writer, equipmentJsonFileName);
+      }
+      break;
+
+    case Section::SKILLS:
+      writer.write<uint32_t>(_skills.size());
+      for (const auto& skillJsonFileName : _skills) {
+        strings.write(writer, skillJsonFileName);
+      }
+      break;
+
+    case Section::HOTKEYS:
+      writer.write<uint32_t>(_hotkeys.size());
+      for (const auto& hotkey : _hotkeys) {
+        writer.write<uint8_t>(hotkey.type);
+        strings.write(writer, hotkey.jsonFileName);
+      }
+      break;
+
+    case Section::QUESTS:
+      writer.write<uint32_t>(_quests.size());
+      for (const auto& quest : _quests) {
+        strings.write(writer, quest.jsonFileName);
+        writer.write<uint8_t>(quest.isUnlocked);
+        writer.write(quest.stageIdx);
+        writer.write(quest.objectiveProgress);
+      }
+      break;
+
+    case Section::PARTY:
+      writer.write<uint32_t>(_partyMembers.size());
+      for (const auto& memberJsonFileName : _partyMembers) {
+        strings.write(writer, memberJsonFileName);
+      }
+      writer.write<uint32_t>(_waitingMembers.size());
+      for (const auto& waitingMember : _waitingMembers) {
+        strings.write(writer, waitingMember.characterJsonFileName);
+        strings.write(writer, waitingMember.tmxMapFileName);
+        writer.write(waitingMember.x);
+        writer.write(waitingMember.y);
+      }
+      break;
+
+    case Section::PORTALS:
+      writer.write<uint32_t>(_portalStates.size());
+      for (const auto& portalState : _portalStates) {
+        strings.write(writer, portalState.tmxMapFileName);
+        writer.write(portalState.targetPortalId);
+        writer.write<uint8_t>(portalState.isLocked);
+      }
+      break;
+
+    case Section::DIALOGUE_TREES:
+      writer.write<uint32_t>(_latestNpcDialogueTrees.size());
+      for (const auto& p : _latestNpcDialogueTrees) {
+        strings.write(writer, p.first);
+        strings.write(writer, p.second);
+      }
+      break;
+
+    case Section::NPC_SPAWNING_BLACKLIST:
+      writer.write<uint32_t>(_npcSpawningBlacklist.size());
+      for (const auto& npcJsonFileName : _npcSpawningBlacklist) {
+        strings.write(writer, npcJsonFileName);
+      }
+      break;
+
+    case Section::MAP_STATES:
+      writer.write<uint32_t>(_mapStates.size());
+      for (const auto& p : _mapStates) {
+        strings.write(writer, p.first);
+        writer.writeString(p.second);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool GameState::readSection(GameState::Section section,
+                            BinaryReader& reader,
+                            const vector<string>& strings) {
+  switch (section) {
+    case Section::WORLD:
+      _tmxMapFileName = readName(reader, strings);
+      _playerX = reader.read<float>();
+      _playerY = reader.read<float>();
+      break;
+
+    case Section::PLAYER:
+      _stats = reader.read<Stats>();
+      break;
+
+    case Section::INVENTORY:
+      _items.resize(reader.readCount());
+      for (auto& p : _items) {
+        p.first = readName(reader, strings);
+        p.second = reader.read<int32_t>();
+      }
+      for (uint32_t i = 0, count = reader.readCount(); i < count; i++) {
+        const string& equipmentJsonFileName = readName(reader, strings);
+        if (i < _equipments.size()) {
+          _equipments[i] = equipmentJsonFileName;
+        }
+      }
+      break;
+
+    case Section::SKILLS:
+      _skills.resize(reader.readCount());
+      for (auto& skillJsonFileName : _skills) {
+        skillJsonFileName = readName(reader, strings);
+      }
+      break;
+
+    case Section::HOTKEYS:
+      for (uint32_t i = 0, count = reader.readCount(); i < count; i++) {
+        const auto type = static_cast<Hotkey::Type>(reader.read<uint8_t>());
+        const string& jsonFileName = readName(reader, strings);
+        if (i < _hotkeys.size()) {
+          _hotkeys[i] = {type, jsonFileName};
+        }
+      }
+      break;
+
+    case Section::QUESTS:
+      _quests.resize(reader.readCount());
+      for (auto& quest : _quests) {
+        quest.jsonFileName = readName(reader, strings);
+        quest.isUnlocked = reader.read<uint8_t>();
+        quest.stageIdx = reader.read<int32_t>();
+        quest.objectiveProgress = reader.read<int32_t>();
+      }
+      break;
+
+    case Section::PARTY:
+      _partyMembers.resize(reader.readCount());
+      for (auto& memberJsonFileName : _partyMembers) {
+        memberJsonFileName = readName(reader, strings);
+      }
+      _waitingMembers.resize(reader.readCount());
+      for (auto& waitingMember : _waitingMembers) {
+        waitingMember.characterJsonFileName = readName(reader, strings);
+        waitingMember.tmxMapFileName = readName(reader, strings);
+        waitingMember.x = reader.read<float>();
+        waitingMember.y = reader.read<float>();
+      }
+      break;
+
+    case Section::PORTALS:
+      _portalStates.resize(reader.readCount());
+      for (auto& portalState : _portalStates) {
+        portalState.tmxMapFileName = readName(reader, strings);
+        portalState.targetPortalId = reader.read<int32_t>();
+        portalState.isLocked = reader.read<uint8_t>();
+      }
+      break;
+
+    case Section::DIALOGUE_TREES:
+      _latestNpcDialogueTrees.resize(reader.readCount());
+      for (auto& p : _latestNpcDialogueTrees) {
+        p.first = readName(reader, strings);
+        p.second = readName(reader, strings);
+      }
+      break;
+
+    case Section::NPC_SPAWNING_BLACKLIST:
+      _npcSpawningBlacklist.resize(reader.readCount());
+      for (auto& npcJsonFileName : _npcSpawningBlacklist) {
+        npcJsonFileName = readName(reader, strings);
+      }
+      break;
+
+    case Section::MAP_STATES:
+      _mapStates.resize(reader.readCount());
+      for (auto& p : _mapStates) {
+        p.first = readName(reader, strings);
+        p.second = reader.readString();
+      }
+      break;
+
+    default:
+      // A section written by a newer version.
+      break;
+  }
+
+  return reader.isOk();
 }
 
 
-ifstream& operator>>(ifstream& ifs, GameState& state) {
-  return ifs;
+const string& GameState::getFilePath() const {
+  return _filePath;
 }
 
-ofstream& operator<<(ofstream& ofs, const GameState& state) {
-  return ofs;
+void GameState::setFilePath(const string& filePath) {
+  _filePath = filePath;
 }
 
 }  // namespace vigilante
@@ -2,26 +2,173 @@
 #ifndef VIGILANTE_GAME_STATE_H_
 #define VIGILANTE_GAME_STATE_H_
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "input/HotkeyManager.h"
+#include "item/Equipment.h"
 
 namespace vigilante {
 
+// Forward declaration
+class BinaryReader;
+class BinaryWriter;
+class Player;
+
+// A saved game, i.e., the player (profile, inventory, equipment, skills
+// and hotkeys), its quests and party, and the global world state (portals,
+// dialogue trees, the npc spawning blacklist and the changes of each map,
+// see WorldState).
+//
+// The save file is a compact binary file, which consists of a header
+// (magic, version and the size of the sections) followed by a number of
+// sections deflated with zlib. Each section is prefixed with its tag and
+// its size, so the sections unknown to this version can be skipped. All asset names (e.g., the json file names) are written once
+// in the STRING_TABLE section, and are referred to by their indices elsewhere.
+// Hence loading a game is a single linear read without any json parsing.
+
 class GameState {
  public:
-  explicit GameState();
+  GameState();
   virtual ~GameState() = default;
 
-  virtual void load();
-  virtual void save();
+  // Captures the current game and writes it to the file path.
+  // Returns false if there's no game to save or the file can't be written.
+  virtual bool save();
+
+  // Same as save(), but only the snapshot is taken on the calling (main)
+  // thread, and it's compressed and written by a worker thread (see ThreadPool),
+  // so that it won't stall the game. Returns false if the previous save
+  // is still being written.
+  virtual bool saveAsync();
+
+  // Reads the file path and restores the game from it. The GameMap is loaded
+  // asynchronously, and the player is restored after it has been loaded.
+  // Returns false (without touching the current game) if the file
+  // can't be read or is corrupted.
+  virtual bool load();
+
+  // Captures the current game into `snapshot` (the uncompressed sections),
+  // e.g., a checkpoint (see CheckpointManager). Nothing is written to the disk.
+  // Returns false if there's no game to save.
+  bool saveToMemory(std::string* snapshot);
+
+  // Restores the game from a `snapshot` of saveToMemory() directly into the
+  // current GameMap (see GameMapManager::resetGameMap()), reviving the player
+  // if it has been killed. Nothing is loaded, so it takes effect at once.
+  // Must be called at the start of a frame, e.g., by CheckpointManager::update().
+  // Returns false (without touching the current game) if the snapshot
+  // is corrupted or was taken in another GameMap.
+  bool restoreInPlace(const std::string& snapshot);
 
   const std::string& getFilePath() const;
   void setFilePath(const std::string& filePath);
 
-  friend std::ifstream& operator>>(std::ifstream& is, GameState& state);
-  friend std::ofstream& operator<<(std::ofstream& os, const GameState& state);
-
  private:
+  enum Section : uint32_t {
+    STRING_TABLE = 1,
+    WORLD,
+    PLAYER,
+    INVENTORY,
+    SKILLS,
+    HOTKEYS,
+    QUESTS,
+    PARTY,
+    PORTALS,
+    DIALOGUE_TREES,
+    NPC_SPAWNING_BLACKLIST,
+    MAP_STATES
+  };
+
+  struct Stats final {
+    int32_t level;
+    int32_t exp;
+    int32_t health;
+    int32_t magicka;
+    int32_t stamina;
+    int32_t strength;
+    int32_t dexterity;
+    int32_t intelligence;
+    int32_t luck;
+  };
+
+  struct Hotkey final {
+    enum Type : uint8_t {
+      NONE,
+      SKILL,
+      ITEM
+    };
+
+    Hotkey::Type type;
+    std::string jsonFileName;
+  };
+
+  struct QuestState final {
+    std::string jsonFileName;
+    bool isUnlocked;
+    int32_t stageIdx;
+    int32_t objectiveProgress;
+  };
+
+  struct WaitingMember final {
+    std::string characterJsonFileName;
+    std::string tmxMapFileName;
+    float x;
+    float y;
+  };
+
+  struct PortalState final {
+    std::string tmxMapFileName;
+    int32_t targetPortalId;
+    bool isLocked;
+  };
+
+  // Interns the asset names written to the STRING_TABLE section.
+  class StringTable;
+
+  // Captures the current game and writes all sections to `sections`.
+  // Returns false if there's no game in progress.
+  bool serialize(std::string* sections);
+  // Compresses `sections`, and then writes it to `filePath` crash-safely.
+  // Safe to be called from any thread.
+  static bool writeFile(const std::string& filePath, const std::string& sections);
+  // Replaces this state (except the file path) with the one in `sections`.
+  // Returns false if they're corrupted.
+  bool deserialize(const std::string& sections);
+
+  void capture(Player* player);
+  void restoreWorldState() const;
+  void restorePlayer(Player* player) const;
+
+  void writeSection(GameState::Section section, BinaryWriter& writer, StringTable& strings) const;
+  // Returns false if the section is corrupted. Unknown sections are ignored.
+  bool readSection(GameState::Section section,
+                   BinaryReader& reader,
+                   const std::vector<std::string>& strings);
+
+  static std::atomic<bool> _isWriting;
+
   std::string _filePath;
+
+  std::string _tmxMapFileName;
+  float _playerX;
+  float _playerY;
+  Stats _stats;
+  std::vector<std::pair<std::string, int>> _items;
+  std::array<std::string, Equipment::Type::SIZE> _equipments;
+  std::vector<std::string> _skills;
+  std::array<Hotkey, HotkeyManager::BindableKeys::SIZE> _hotkeys;
+  std::vector<QuestState> _quests;
+  std::vector<std::string> _partyMembers;
+  std::vector<WaitingMember> _waitingMembers;
+  std::vector<PortalState> _portalStates;
+  std::vector<std::pair<std::string, std::string>> _latestNpcDialogueTrees;
+  std::vector<std::string> _npcSpawningBlacklist;
+  std::vector<std::pair<std::string, std::string>> _mapStates;  // see WorldState
 };
 
 }  // namespace vigilante
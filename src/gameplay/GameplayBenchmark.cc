@@ -0,0 +1,223 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "GameplayBenchmark.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Constants.h"
+#include "character/Npc.h"
+#include "character/NpcPool.h"
+#include "character/Player.h"
+#include "item/Item.h"
+#include "map/GameMapManager.h"
+#include "quest/QuestBook.h"
+#include "util/Logger.h"
+#include "util/StatsUtil.h"
+
+#define SPAWN_SPACING 16  // in pixels, between the npcs of the same faction
+#define SPAWN_DISTANCE 64  // in pixels, from the player to the nearest npc of each faction
+
+using std::array;
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::shared_ptr;
+
+namespace vigilante {
+
+const array<string, GameplayBenchmark::Section::SECTION_SIZE> GameplayBenchmark::_kSectionStr = {{
+  "frame",
+  "physics",
+  "ai",
+  "contacts",
+  "quests"
+}};
+
+const array<FrameProfiler::Section, GameplayBenchmark::Section::SECTION_SIZE>
+GameplayBenchmark::_kProfilerSections = {{
+  FrameProfiler::Section::FRAME,
+  FrameProfiler::Section::PHYSICS_STEP,
+  FrameProfiler::Section::GAME_MAP_UPDATE,
+  FrameProfiler::Section::CONTACT_CALLBACKS,
+  FrameProfiler::Section::QUEST_EVENTS
+}};
+
+GameplayBenchmark* GameplayBenchmark::getInstance() {
+  static GameplayBenchmark instance;
+  return &instance;
+}
+
+GameplayBenchmark::GameplayBenchmark()
+    : _isRunning(),
+      _wasProfilerEnabled(),
+      _config(),
+      _elapsedTime(),
+      _npcs(),
+      _collectItem(),
+      _samples() {}
+
+
+bool GameplayBenchmark::start(const GameplayBenchmark::Config& config) {
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  GameMap* gameMap = gmMgr->getGameMap();
+  Player* player = gmMgr->getPlayer();
+  if (_isRunning || !gameMap || !player || !player->getBody()) {
+    return false;
+  }
+
+  _config = config;
+  _elapsedTime = 0;
+  _samples.clear();
+  _samples.reserve(static_cast<size_t>(config.duration / kFixedTimeStep) + 1);
+  _collectItem = (config.collectItemJson.empty()) ? nullptr : Item::create(config.collectItemJson);
+
+  // The factions are lined up on both sides of the player, and
+  // each npc is locked on to its counterpart in the other faction.
+  const float playerX = player->getBody()->GetPosition().x * kPpm;
+  const float playerY = player->getBody()->GetPosition().y * kPpm;
+  _npcs.clear();
+  for (int i = 0; i < config.numNpcs; i++) {
+    const float offset = SPAWN_DISTANCE + i * SPAWN_SPACING;
+
+    shared_ptr<Npc> hostileNpc = NpcPool::getInstance()->acquire(config.hostileNpcJson);
+    hostileNpc->setDisposition(Npc::Disposition::ENEMY);
+    Npc* hostile = gameMap->showDynamicActor<Npc>(hostileNpc, playerX + offset, playerY);
+
+    shared_ptr<Npc> allyNpc = NpcPool::getInstance()->acquire(config.allyNpcJson);
+    allyNpc->setDisposition(Npc::Disposition::ALLY);
+    Npc* ally = gameMap->showDynamicActor<Npc>(allyNpc, playerX - offset, playerY);
+
+    if (hostile && ally) {
+      hostile->lockOn(ally);
+      ally->lockOn(hostile);
+    }
+    _npcs.push_back(hostileNpc);
+    _npcs.push_back(allyNpc);
+  }
+
+  FrameProfiler* profiler = FrameProfiler::getInstance();
+  _wasProfilerEnabled = profiler->isEnabled();
+  profiler->setEnabled(true);
+  _isRunning = true;
+
+  VGLOG(LOG_INFO, "Benchmark started: %d vs %d npcs for %.1f s",
+        config.numNpcs, config.numNpcs, config.duration);
+  return true;
+}
+
+void GameplayBenchmark::update() {
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  if (!_isRunning || !player) {
+    return;
+  }
+
+  FrameProfiler::ScopedTimer timer(FrameProfiler::Section::QUEST_EVENTS);
+
+  // One kill of each hostile npc per frame, as if they respawned.
+  for (const auto& weakNpc : _npcs) {
+    shared_ptr<Npc> npc = weakNpc.lock();
+    if (npc && npc->getDisposition() == Npc::Disposition::ENEMY) {
+      player->getQuestBook().update(Quest::Objective::Type::KILL, npc->getCharacterProfile().nameId);
+    }
+  }
+
+  // The inventory deltas feed the collect objectives (see Character::onItemAmountChanged()).
+  if (_collectItem) {
+    player->addItem(_collectItem);
+    player->removeItem(_collectItem.get());
+  }
+}
+
+void GameplayBenchmark::onFrameEnd(float delta) {
+  if (!_isRunning) {
+    return;
+  }
+
+  FrameProfiler* profiler = FrameProfiler::getInstance();
+  array<float, Section::SECTION_SIZE> sample;
+  for (int i = 0; i < Section::SECTION_SIZE; i++) {
+    sample[i] = profiler->getLastFrameTime(_kProfilerSections[i]);
+  }
+  _samples.push_back(sample);
+
+  _elapsedTime += delta;
+}
+
+bool GameplayBenchmark::isRunning() const {
+  return _isRunning;
+}
+
+bool GameplayBenchmark::hasFinished() const {
+  return _isRunning && _elapsedTime >= _config.duration;
+}
+
+void GameplayBenchmark::finish() {
+  if (!_isRunning) {
+    return;
+  }
+
+  writeResults(_config.resultFileName);
+
+  GameMap* gameMap = GameMapManager::getInstance()->getGameMap();
+  for (const auto& weakNpc : _npcs) {
+    shared_ptr<Npc> npc = weakNpc.lock();
+    if (npc && gameMap && !npc->isKilled() && npc->getBody()) {
+      gameMap->removeDynamicActor(npc.get());
+      NpcPool::getInstance()->release(std::move(npc));
+    }
+  }
+  _npcs.clear();
+  _collectItem.reset();
+  _samples.clear();
+
+  FrameProfiler::getInstance()->setEnabled(_wasProfilerEnabled);
+  _isRunning = false;
+}
+
+
+bool GameplayBenchmark::writeResults(const string& fileName) {
+  for (int i = 0; i < Section::SECTION_SIZE; i++) {
+    VGLOG(LOG_INFO, "Benchmark %s: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+          _kSectionStr[i].c_str(), getPercentile(static_cast<Section>(i), 50),
+          getPercentile(static_cast<Section>(i), 90), getPercentile(static_cast<Section>(i), 99),
+          getPercentile(static_cast<Section>(i), 100));
+  }
+
+  ofstream fout(fileName, std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_ERR, "Unable to write benchmark results to: %s", fileName.c_str());
+    return false;
+  }
+
+  fout << "{\n";
+  fout << "  \"hostileNpc\": \"" << _config.hostileNpcJson << "\",\n";
+  fout << "  \"allyNpc\": \"" << _config.allyNpcJson << "\",\n";
+  fout << "  \"npcsPerFaction\": " << _config.numNpcs << ",\n";
+  fout << "  \"frames\": " << _samples.size() << ",\n";
+  fout << "  \"sections\": {";
+
+  for (int i = 0; i < Section::SECTION_SIZE; i++) {
+    const Section section = static_cast<Section>(i);
+    fout << ((i == 0) ? "\n" : ",\n");
+    fout << "    \"" << _kSectionStr[i] << "\": {";
+    stats_util::writePercentiles(fout, getSectionTimes(section));
+    fout << "}";
+  }
+
+  fout << "\n  }\n}\n";
+  return true;
+}
+
+float GameplayBenchmark::getPercentile(GameplayBenchmark::Section section, float percentile) const {
+  return stats_util::getPercentile(getSectionTimes(section), percentile);
+}
+
+vector<float> GameplayBenchmark::getSectionTimes(GameplayBenchmark::Section section) const {
+  vector<float> times(_samples.size());
+  for (size_t i = 0; i < _samples.size(); i++) {
+    times[i] = _samples[i][section];
+  }
+  return times;
+}
+
+}  // namespace vigilante
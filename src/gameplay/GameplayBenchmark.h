@@ -0,0 +1,88 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_GAMEPLAY_BENCHMARK_H_
+#define VIGILANTE_GAMEPLAY_BENCHMARK_H_
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/FrameProfiler.h"
+
+namespace vigilante {
+
+// Forward declaration
+class Item;
+class Npc;
+
+// Measures how many combatants the game can handle.
+//
+// start() spawns the hostile and the allied npcs around the player, and pits
+// them against each other. Then GameScene runs the game with fixed time steps
+// as fast as possible (like a replay being played back, nothing is rendered
+// within a time slice) until `duration` seconds of game time have elapsed,
+// while kill and collect quest events are generated every frame.
+// The per-frame timings of physics, AI, contact callbacks and quests
+// are taken from FrameProfiler, and their percentiles are logged
+// and written as json to `resultFileName` when the benchmark finishes.
+// All methods must be called on the main thread.
+class GameplayBenchmark final {
+ public:
+  struct Config final {
+    std::string hostileNpcJson;
+    std::string allyNpcJson;
+    std::string collectItemJson;  // added to and removed from the player every frame
+    int numNpcs;  // of each faction
+    float duration;  // in seconds of game time
+    std::string resultFileName;
+  };
+
+  static GameplayBenchmark* getInstance();
+
+  // Returns false if there's no game in progress or a benchmark is running.
+  bool start(const GameplayBenchmark::Config& config);
+
+  // Called by GameScene within each frame of the benchmark.
+  // Generates the kill and collect quest events of this frame.
+  void update();
+  // Called by GameScene after each frame of the benchmark.
+  // Records the timings of this frame.
+  void onFrameEnd(float delta);
+
+  bool isRunning() const;
+  bool hasFinished() const;
+  // Writes the results, and removes the spawned npcs from the GameMap.
+  void finish();
+
+ private:
+  enum Section {
+    FRAME,
+    PHYSICS,
+    AI,
+    CONTACTS,
+    QUESTS,
+    SECTION_SIZE
+  };
+
+  GameplayBenchmark();
+
+  bool writeResults(const std::string& fileName);
+  float getPercentile(GameplayBenchmark::Section section, float percentile) const;
+  std::vector<float> getSectionTimes(GameplayBenchmark::Section section) const;  // in ms, one per frame
+
+  static const std::array<std::string, Section::SECTION_SIZE> _kSectionStr;
+  static const std::array<FrameProfiler::Section, Section::SECTION_SIZE> _kProfilerSections;
+
+  bool _isRunning;
+  bool _wasProfilerEnabled;
+  GameplayBenchmark::Config _config;
+  float _elapsedTime;  // in seconds of game time
+
+  std::vector<std::weak_ptr<Npc>> _npcs;
+  std::shared_ptr<Item> _collectItem;
+  std::vector<std::array<float, Section::SECTION_SIZE>> _samples;  // in milliseconds
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_GAMEPLAY_BENCHMARK_H_
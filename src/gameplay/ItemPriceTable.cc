@@ -1,25 +1,45 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "ItemPriceTable.h"
 
+#include <algorithm>
 #include <fstream>
-#include <unordered_map>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
+#include <cocos2d.h>
+#include "util/ds/BinaryStream.h"
+#include "util/AssetId.h"
 #include "util/Logger.h"
+#include "util/MappedFile.h"
+
+#define ITEM_PRICE_TABLE_PACK_MAGIC 0x54504956  // "VIPT"
+#define ITEM_PRICE_TABLE_PACK_VERSION 1
 
 using std::string;
-using std::unordered_map;
+using std::vector;
 using std::ifstream;
+using std::out_of_range;
 using std::runtime_error;
+using cocos2d::FileUtils;
 
 namespace vigilante {
 
 namespace {
 
-unordered_map<string, int> prices;
+// item json id -> price (or -1 if the item has no price)
+vector<int> prices;
+
+void setPrice(const string& itemJsonFileName, int price) {
+  const AssetId id(itemJsonFileName);
+  if (prices.size() <= id.getValue()) {
+    prices.resize(id.getValue() + 1, -1);
+  }
+  prices[id.getValue()] = price;
+}
 
 }  // namespace
-  
+
 namespace item_price_table {
 
 void import(const string& tableFileName) {
@@ -34,13 +54,59 @@ void import(const string& tableFileName) {
     int price;
     fin >> itemJsonFileName >> price;
     if (!itemJsonFileName.empty()) {
-      prices[itemJsonFileName] = price;
+      setPrice(itemJsonFileName, price);
     }
   }
 }
 
+bool importPack(const string& packFileName) {
+  const string fullPath = FileUtils::getInstance()->fullPathForFilename(packFileName);
+  if (fullPath.empty()) {
+    return false;
+  }
+
+  MappedFile file(fullPath);
+  BinaryReader reader(file.getData(), file.getData() + file.getSize());
+  const uint32_t magic = reader.read<uint32_t>();
+  const uint32_t version = reader.read<uint32_t>();
+  const uint32_t numItems = reader.readCount();
+  if (!file.isOpen() || !reader.isOk() ||
+      magic != ITEM_PRICE_TABLE_PACK_MAGIC || version != ITEM_PRICE_TABLE_PACK_VERSION) {
+    VGLOG(LOG_ERR, "Invalid item price table pack: %s", fullPath.c_str());
+    return false;
+  }
+
+  vector<std::pair<string, int>> entries(numItems);
+  for (auto& entry : entries) {
+    entry.first = reader.readString();
+    entry.second = reader.read<int32_t>();
+  }
+  if (!reader.isOk()) {
+    VGLOG(LOG_ERR, "Invalid item price table pack: %s", fullPath.c_str());
+    return false;
+  }
+
+  VGLOG(LOG_INFO, "Loading item price table from pack...");
+  for (const auto& entry : entries) {
+    setPrice(entry.first, entry.second);
+  }
+  return true;
+}
+
 int getPrice(Item* item) {
-  return prices.at(item->getItemProfile().jsonFileName);
+  const AssetId id = item->getItemProfile().id;
+  if (id.getValue() >= prices.size() || prices[id.getValue()] < 0) {
+    throw out_of_range("No price for item: " + id.getName());
+  }
+  return prices[id.getValue()];
+}
+
+void getPrices(const vector<Item*>& items, vector<int>* itemPrices) {
+  itemPrices->resize(items.size());
+  for (size_t i = 0; i < items.size(); i++) {
+    const uint32_t id = items[i]->getItemProfile().id.getValue();
+    (*itemPrices)[i] = (id < prices.size()) ? std::max(prices[id], 0) : 0;
+  }
 }
 
 }  // namespace item_price_table
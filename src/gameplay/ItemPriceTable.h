@@ -3,6 +3,7 @@
 #define VIGILANTE_ITEM_PRICE_TABLE_H_
 
 #include <string>
+#include <vector>
 
 #include "item/Item.h"
 
@@ -11,7 +12,14 @@ namespace vigilante {
 namespace item_price_table {
 
 void import(const std::string& tableFileName);
+// Imports the table compiled by scripts/TablePacker.py.
+// Returns false if there's no such pack or it's invalid.
+bool importPack(const std::string& packFileName);
+
 int getPrice(Item* item);
+// Writes the price of each of `items` to `itemPrices` (in the same order),
+// e.g., for a whole inventory view. Items without a price are priced at 0.
+void getPrices(const std::vector<Item*>& items, std::vector<int>* itemPrices);
 
 }  // namespace item_price_table
 
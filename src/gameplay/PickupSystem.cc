@@ -0,0 +1,130 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "PickupSystem.h"
+
+#include <algorithm>
+
+#include "character/Player.h"
+#include "item/Item.h"
+#include "map/GameMapManager.h"
+#include "map/WorldEpoch.h"
+
+using std::vector;
+
+namespace vigilante {
+
+const float PickupSystem::_kPickupRadius = .3f;
+const float PickupSystem::_kMagnetRadius = 1.5f;
+const float PickupSystem::_kMagnetSpeed = 3.0f;
+
+PickupSystem* PickupSystem::getInstance() {
+  static PickupSystem instance;
+  return &instance;
+}
+
+PickupSystem::PickupSystem()
+    : _isAutoLootEnabled(),
+      _isMagnetEnabled(),
+      _queriedActors(),
+      _items() {}
+
+
+void PickupSystem::update(float delta) {
+  if (!_isAutoLootEnabled && !_isMagnetEnabled) {
+    return;
+  }
+
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  if (!player || !player->getBody() || player->isSetToKill() || world_epoch::isInTransition()) {
+    return;
+  }
+
+  const b2Vec2& playerPos = player->getBody()->GetPosition();
+  const float radius = (_isMagnetEnabled) ? _kMagnetRadius : _kPickupRadius;
+  _items.clear();
+  queryItems(playerPos, radius, _items);
+
+  // Picking up an item deletes it, so all the items are moved first.
+  const float maxDistance = _kMagnetSpeed * delta;
+  size_t numPickedItems = 0;
+  for (auto item : _items) {
+    b2Vec2 d = playerPos - item->getBody()->GetPosition();
+    const float distance = d.Length();
+
+    if (distance > _kPickupRadius) {
+      // The items which are still falling are left to the b2World.
+      if (!_isMagnetEnabled || !item->isSettled()) {
+        continue;
+      }
+      d *= std::min(maxDistance, distance - _kPickupRadius) / distance;
+      const b2Vec2 pos = item->getBody()->GetPosition() + d;
+      item->setPosition(pos.x, pos.y);
+      if (distance - maxDistance > _kPickupRadius) {
+        continue;
+      }
+    }
+    _items[numPickedItems++] = item;
+  }
+
+  _items.resize(numPickedItems);
+  for (auto item : _items) {
+    player->pickupItem(item);
+  }
+}
+
+Item* PickupSystem::findNearestItem(const Character* character) {
+  if (!character->getBody()) {
+    return nullptr;
+  }
+
+  const b2Vec2& pos = character->getBody()->GetPosition();
+  _items.clear();
+  queryItems(pos, _kPickupRadius, _items);
+
+  Item* nearestItem = nullptr;
+  float nearestDistanceSquared = b2_maxFloat;
+  for (auto item : _items) {
+    const float distanceSquared = (item->getBody()->GetPosition() - pos).LengthSquared();
+    if (distanceSquared < nearestDistanceSquared) {
+      nearestItem = item;
+      nearestDistanceSquared = distanceSquared;
+    }
+  }
+  return nearestItem;
+}
+
+
+bool PickupSystem::isAutoLootEnabled() const {
+  return _isAutoLootEnabled;
+}
+
+void PickupSystem::setAutoLootEnabled(bool autoLootEnabled) {
+  _isAutoLootEnabled = autoLootEnabled;
+}
+
+bool PickupSystem::isMagnetEnabled() const {
+  return _isMagnetEnabled;
+}
+
+void PickupSystem::setMagnetEnabled(bool magnetEnabled) {
+  _isMagnetEnabled = magnetEnabled;
+}
+
+
+void PickupSystem::queryItems(const b2Vec2& center, float radius, vector<Item*>& items) {
+  GameMap* gameMap = GameMapManager::getInstance()->getGameMap();
+  if (!gameMap) {
+    return;
+  }
+
+  // The spatial index is rebuilt once per frame, so it may still refer
+  // to the items which have been removed from the map since then.
+  _queriedActors.clear();
+  gameMap->queryDynamicActors(center, radius, ActorRegistry::Group::ITEM, _queriedActors);
+  for (auto actor : _queriedActors) {
+    if (gameMap->isShown(actor) && actor->getBody()) {
+      items.push_back(static_cast<Item*>(actor));
+    }
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,62 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_PICKUP_SYSTEM_H_
+#define VIGILANTE_PICKUP_SYSTEM_H_
+
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+namespace vigilante {
+
+// Forward Declarations
+class Character;
+class DynamicActor;
+class Item;
+
+// Finds the items around the player with a radius query against the spatial
+// index of the GameMap (see ActorRegistry), rather than tracking the contacts
+// between the feet fixtures and the items, so that the items don't need any
+// fixture which collides with characters, and a settled item can drop out of
+// the broadphase altogether (see Item::freezeIfSettled()).
+//
+// Optionally, the items within _kPickupRadius of the player are picked up
+// automatically (auto-loot), and the settled items within _kMagnetRadius
+// are drawn towards the player and picked up once they arrive (magnet).
+//
+// All methods must be called on the main thread.
+class PickupSystem final {
+ public:
+  static PickupSystem* getInstance();
+
+  // Auto-loots and attracts the items around the player, if enabled.
+  void update(float delta);
+
+  // Returns the nearest item within _kPickupRadius of `character`, or nullptr.
+  Item* findNearestItem(const Character* character);
+
+  bool isAutoLootEnabled() const;
+  void setAutoLootEnabled(bool autoLootEnabled);
+  bool isMagnetEnabled() const;
+  void setMagnetEnabled(bool magnetEnabled);
+
+  static const float _kPickupRadius;  // in meters
+  static const float _kMagnetRadius;  // in meters
+  static const float _kMagnetSpeed;  // in meters per second
+
+ private:
+  PickupSystem();
+
+  // Appends the items shown on the current GameMap within `radius` of `center`.
+  void queryItems(const b2Vec2& center, float radius, std::vector<Item*>& items);
+
+  bool _isAutoLootEnabled;
+  bool _isMagnetEnabled;
+
+  // The scratch buffers of the queries.
+  std::vector<DynamicActor*> _queriedActors;
+  std::vector<Item*> _items;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_PICKUP_SYSTEM_H_
@@ -0,0 +1,274 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "RenderStressTest.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+
+#include "Constants.h"
+#include "character/Npc.h"
+#include "character/NpcPool.h"
+#include "character/Player.h"
+#include "map/FxManager.h"
+#include "map/GameMapManager.h"
+#include "ui/floating_damages/FloatingDamages.h"
+#include "ui/notifications/Notifications.h"
+#include "util/Logger.h"
+#include "util/RandUtil.h"
+#include "util/StatsUtil.h"
+#include "util/StringUtil.h"
+
+#define SPAWN_SPACING 24  // in pixels, between the npcs
+#define NOTIFICATION_INTERVAL .5f  // in seconds
+#define TEXTURE_SWITCH_SAMPLE_INTERVAL 1.0f  // in seconds
+#define MAX_FLOATING_DAMAGE 999
+
+using std::function;
+using std::ofstream;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using cocos2d::Director;
+using cocos2d::EventCustom;
+using cocos2d::Label;
+using cocos2d::Node;
+using cocos2d::Renderer;
+using cocos2d::Scene;
+using cocos2d::Sprite;
+using cocos2d::SpriteBatchNode;
+using cocos2d::Texture2D;
+
+namespace vigilante {
+
+RenderStressTest* RenderStressTest::getInstance() {
+  static RenderStressTest instance;
+  return &instance;
+}
+
+RenderStressTest::RenderStressTest()
+    : _isRunning(),
+      _config(),
+      _elapsedTime(),
+      _notificationTimer(),
+      _textureSwitchTimer(),
+      _nextNpcIndex(),
+      _npcs(),
+      _samples(),
+      _textureSwitches(),
+      _afterDrawListener() {}
+
+
+bool RenderStressTest::start(const RenderStressTest::Config& config) {
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  GameMap* gameMap = gmMgr->getGameMap();
+  Player* player = gmMgr->getPlayer();
+  if (_isRunning || !gameMap || !player || !player->getBody()) {
+    return false;
+  }
+
+  _config = config;
+  _elapsedTime = 0;
+  _notificationTimer = 0;
+  _textureSwitchTimer = 0;
+  _nextNpcIndex = 0;
+  _samples.clear();
+  _textureSwitches.clear();
+
+  // The npcs are lined up on both sides of the player, and
+  // the line is clamped to the bounds of the GameMap.
+  const float playerX = player->getBody()->GetPosition().x * kPpm;
+  const float playerY = player->getBody()->GetPosition().y * kPpm;
+  const float width = (config.numNpcs - 1) * SPAWN_SPACING;
+  const float beginX = std::max(0.0f, std::min(playerX - width / 2, gameMap->getWidth() - width));
+  _npcs.clear();
+  for (int i = 0; i < config.numNpcs; i++) {
+    const float x = std::min(beginX + i * SPAWN_SPACING, gameMap->getWidth());
+    shared_ptr<Npc> npc = NpcPool::getInstance()->acquire(config.npcJson);
+    npc->setDisposition(Npc::Disposition::ALLY);
+    npc->setSandboxing(true);
+    gameMap->showDynamicActor<Npc>(npc, x, playerY);
+    _npcs.push_back(npc);
+  }
+
+  _afterDrawListener = Director::getInstance()->getEventDispatcher()->addCustomEventListener(
+      Director::EVENT_AFTER_DRAW, [this](EventCustom*) { onAfterDraw(); });
+  _isRunning = true;
+
+  VGLOG(LOG_INFO, "Render stress test started: %d npcs, %d events per frame for %.1f s",
+        config.numNpcs, config.eventsPerFrame, config.duration);
+  return true;
+}
+
+void RenderStressTest::update(float delta) {
+  if (!_isRunning) {
+    return;
+  }
+
+  _elapsedTime += delta;
+  if (_elapsedTime >= _config.duration) {
+    finish();
+    Notifications::getInstance()->show("Render stress test finished");
+    return;
+  }
+
+  for (int i = 0; i < _config.eventsPerFrame && !_npcs.empty(); i++) {
+    shared_ptr<Npc> npc = _npcs[_nextNpcIndex].lock();
+    _nextNpcIndex = (_nextNpcIndex + 1) % _npcs.size();
+    if (!npc || npc->isKilled() || !npc->getBody()) {
+      continue;
+    }
+    FxManager::getInstance()->createDustFx(npc.get());
+    FloatingDamages::getInstance()->show(npc.get(), rand_util::randInt(1, MAX_FLOATING_DAMAGE, rand_util::Stream::FX));
+  }
+
+  _notificationTimer += delta;
+  if (_notificationTimer >= NOTIFICATION_INTERVAL) {
+    _notificationTimer = 0;
+    Notifications::getInstance()->show(
+        string_util::format("Render stress test: %.0f s", _config.duration - _elapsedTime));
+  }
+}
+
+bool RenderStressTest::isRunning() const {
+  return _isRunning;
+}
+
+void RenderStressTest::finish() {
+  if (!_isRunning) {
+    return;
+  }
+
+  Director::getInstance()->getEventDispatcher()->removeEventListener(_afterDrawListener);
+  _afterDrawListener = nullptr;
+
+  writeResults(_config.resultFileName);
+
+  GameMap* gameMap = GameMapManager::getInstance()->getGameMap();
+  for (const auto& weakNpc : _npcs) {
+    shared_ptr<Npc> npc = weakNpc.lock();
+    if (npc && gameMap && !npc->isKilled() && npc->getBody()) {
+      gameMap->removeDynamicActor(npc.get());
+      NpcPool::getInstance()->release(std::move(npc));
+    }
+  }
+  _npcs.clear();
+  _samples.clear();
+  _textureSwitches.clear();
+
+  _isRunning = false;
+}
+
+
+void RenderStressTest::onAfterDraw() {
+  // The renderer stats are only complete once the frame has been drawn,
+  // and they're cleared before the next one is.
+  Director* director = Director::getInstance();
+  Renderer* renderer = director->getRenderer();
+  _samples.push_back({director->getDeltaTime() * 1000,
+                      static_cast<unsigned int>(renderer->getDrawnBatches()),
+                      static_cast<unsigned int>(renderer->getDrawnVertices() / 4)});
+
+  _textureSwitchTimer += director->getDeltaTime();
+  if (_textureSwitchTimer >= TEXTURE_SWITCH_SAMPLE_INTERVAL) {
+    _textureSwitchTimer = 0;
+    _textureSwitches.push_back(countTextureSwitches());
+  }
+}
+
+int RenderStressTest::countTextureSwitches() const {
+  Scene* scene = Director::getInstance()->getRunningScene();
+  if (!scene) {
+    return 0;
+  }
+
+  int numSwitches = 0;
+  const Texture2D* lastTexture = nullptr;
+  auto draw = [&numSwitches, &lastTexture](const Texture2D* texture) {
+    if (texture && texture != lastTexture) {
+      lastTexture = texture;
+      numSwitches++;
+    }
+  };
+
+  // The children have been sorted by visit(), which draws
+  // the ones with a negative local z order before their parent.
+  function<void (Node*)> visit = [&visit, &draw](Node* node) {
+    if (!node->isVisible()) {
+      return;
+    }
+    if (auto batchNode = dynamic_cast<SpriteBatchNode*>(node)) {
+      draw(batchNode->getTexture());
+      return;
+    }
+
+    const cocos2d::Vector<Node*>& children = node->getChildren();
+    auto it = children.begin();
+    for (; it != children.end() && (*it)->getLocalZOrder() < 0; ++it) {
+      visit(*it);
+    }
+    if (auto sprite = dynamic_cast<Sprite*>(node)) {
+      if (!sprite->getBatchNode()) {
+        draw(sprite->getTexture());
+      }
+    } else if (auto label = dynamic_cast<Label*>(node)) {
+      if (label->getFontAtlas()) {
+        draw(label->getFontAtlas()->getTexture(0));
+      }
+    }
+    for (; it != children.end(); ++it) {
+      visit(*it);
+    }
+  };
+  visit(scene);
+
+  return numSwitches;
+}
+
+bool RenderStressTest::writeResults(const string& fileName) const {
+  vector<float> frameTimes(_samples.size());
+  vector<unsigned int> drawCalls(_samples.size());
+  vector<unsigned int> quads(_samples.size());
+  for (size_t i = 0; i < _samples.size(); i++) {
+    frameTimes[i] = _samples[i].frameTime;
+    drawCalls[i] = _samples[i].numDrawCalls;
+    quads[i] = _samples[i].numQuads;
+  }
+
+  const float averageFrameTime = stats_util::getAverage(frameTimes);
+  const float averageFps = (averageFrameTime > 0) ? 1000 / averageFrameTime : 0;
+  VGLOG(LOG_INFO, "Render stress test: %.1f fps, frame p50 %.3f ms, p99 %.3f ms",
+        averageFps, stats_util::getPercentile(frameTimes, 50),
+        stats_util::getPercentile(frameTimes, 99));
+  VGLOG(LOG_INFO, "Render stress test: %.1f draw calls (max %.0f), %.1f quads, %.1f texture switches",
+        stats_util::getAverage(drawCalls), stats_util::getPercentile(drawCalls, 100),
+        stats_util::getAverage(quads), stats_util::getAverage(_textureSwitches));
+
+  ofstream fout(fileName, std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_ERR, "Unable to write render stress test results to: %s", fileName.c_str());
+    return false;
+  }
+
+  fout << "{\n";
+  fout << "  \"npc\": \"" << _config.npcJson << "\",\n";
+  fout << "  \"npcs\": " << _config.numNpcs << ",\n";
+  fout << "  \"eventsPerFrame\": " << _config.eventsPerFrame << ",\n";
+  fout << "  \"frames\": " << _samples.size() << ",\n";
+  fout << "  \"averageFps\": " << averageFps << ",\n";
+  fout << "  \"frameTime\": {";
+  stats_util::writePercentiles(fout, frameTimes);
+  fout << "},\n";
+  fout << "  \"drawCalls\": {"
+       << "\"average\": " << stats_util::getAverage(drawCalls) << ", "
+       << "\"max\": " << stats_util::getPercentile(drawCalls, 100) << "},\n";
+  fout << "  \"quads\": {"
+       << "\"average\": " << stats_util::getAverage(quads) << ", "
+       << "\"max\": " << stats_util::getPercentile(quads, 100) << "},\n";
+  fout << "  \"textureSwitches\": {"
+       << "\"average\": " << stats_util::getAverage(_textureSwitches) << ", "
+       << "\"max\": " << stats_util::getPercentile(_textureSwitches, 100) << "}\n";
+  fout << "}\n";
+  return true;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,85 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_RENDER_STRESS_TEST_H_
+#define VIGILANTE_RENDER_STRESS_TEST_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// Forward declaration
+class Npc;
+
+// A fixed rendering workload to validate the batching, atlas and culling
+// changes against, on the devices themselves.
+//
+// start() spreads `numNpcs` wandering npcs (with whatever equipment their
+// json gives them) over the current GameMap, centered at the player, so that
+// only some of them are on screen at a time. Then every frame, the next
+// `eventsPerFrame` of them emit a dust fx and a floating damage, and a
+// notification is shown every NOTIFICATION_INTERVAL seconds.
+//
+// Unlike GameplayBenchmark, the game runs in real time and every frame is
+// rendered. The fps, draw calls and quads of each frame are taken from the
+// renderer after it's drawn. cocos2d-x doesn't count the texture binds, so
+// they're estimated once per second by walking the scene graph in visiting
+// order and counting the texture switches between the sprites (and sprite
+// batch nodes) which are drawn. The averages and percentiles are logged and
+// written as json to `resultFileName` when the test finishes.
+//
+// All methods must be called on the main thread.
+class RenderStressTest final {
+ public:
+  struct Config final {
+    std::string npcJson;
+    int numNpcs;
+    int eventsPerFrame;
+    float duration;  // in seconds of wall time
+    std::string resultFileName;
+  };
+
+  static RenderStressTest* getInstance();
+
+  // Returns false if there's no game in progress or a test is running.
+  bool start(const RenderStressTest::Config& config);
+
+  // Called by GameScene every frame. Generates the fx, floating damages
+  // and notifications of this frame, and finishes the test when it's over.
+  void update(float delta);
+
+  bool isRunning() const;
+  // Writes the results, and removes the spawned npcs from the GameMap.
+  void finish();
+
+ private:
+  struct Sample final {
+    float frameTime;  // in milliseconds
+    unsigned int numDrawCalls;
+    unsigned int numQuads;
+  };
+
+  RenderStressTest();
+
+  void onAfterDraw();
+  int countTextureSwitches() const;
+  bool writeResults(const std::string& fileName) const;
+
+  bool _isRunning;
+  RenderStressTest::Config _config;
+  float _elapsedTime;  // in seconds of wall time
+  float _notificationTimer;
+  float _textureSwitchTimer;
+  size_t _nextNpcIndex;
+
+  std::vector<std::weak_ptr<Npc>> _npcs;
+  std::vector<RenderStressTest::Sample> _samples;
+  std::vector<int> _textureSwitches;  // one per second
+  cocos2d::EventListenerCustom* _afterDrawListener;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_RENDER_STRESS_TEST_H_
@@ -0,0 +1,154 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ScriptRunner.h"
+
+#include <stdexcept>
+
+#include "Constants.h"
+#include "character/Player.h"
+#include "map/GameMapManager.h"
+#include "ui/console/Console.h"
+#include "ui/dialogue/DialogueManager.h"
+#include "util/StringUtil.h"
+#include "util/Logger.h"
+
+using std::string;
+using std::vector;
+
+namespace vigilante {
+
+const float ScriptRunner::_kDefaultPlayerRadius = 16.0f;
+
+ScriptRunner* ScriptRunner::getInstance() {
+  static ScriptRunner instance;
+  return &instance;
+}
+
+ScriptRunner::ScriptRunner() : _coroutines() {}
+
+
+ScriptRunner::Script ScriptRunner::compile(const vector<string>& cmds) {
+  auto instructions = std::make_shared<vector<Instruction>>();
+  instructions->reserve(cmds.size());
+
+  for (const auto& cmd : cmds) {
+    const vector<string> args = string_util::split(cmd);
+    if (args.empty()) {
+      continue;
+    }
+
+    Instruction instruction{Opcode::COMMAND, {}, {0, 0, 0}};
+    try {
+      if (args[0] == "wait" && args.size() >= 2) {
+        instruction.opcode = Opcode::WAIT;
+        instruction.operands[0] = std::stof(args[1]);
+      } else if (args[0] == "waitForDialogueEnd") {
+        instruction.opcode = Opcode::WAIT_FOR_DIALOGUE_END;
+      } else if (args[0] == "waitForPlayer" && args.size() >= 3) {
+        instruction.opcode = Opcode::WAIT_FOR_PLAYER;
+        instruction.operands[0] = std::stof(args[1]);
+        instruction.operands[1] = std::stof(args[2]);
+        instruction.operands[2] = (args.size() >= 4) ? std::stof(args[3]) : _kDefaultPlayerRadius;
+      } else {
+        instruction.cmd = CommandParser::compile(cmd);
+      }
+    } catch (const std::exception& ex) {
+      VGLOG(LOG_ERR, "Invalid script command: %s", cmd.c_str());
+      continue;
+    }
+
+    instructions->push_back(std::move(instruction));
+  }
+
+  return instructions;
+}
+
+void ScriptRunner::run(const ScriptRunner::Script& script) {
+  if (!script || script->empty()) {
+    return;
+  }
+
+  Coroutine coroutine{script, 0, 0};
+  if (!resume(coroutine)) {
+    _coroutines.push_back(std::move(coroutine));
+  }
+}
+
+void ScriptRunner::update(float delta) {
+  if (_coroutines.empty()) {
+    return;
+  }
+
+  // The resumed scripts may run other scripts,
+  // so swap them out before resuming them.
+  vector<Coroutine> coroutines;
+  coroutines.swap(_coroutines);
+
+  for (auto& coroutine : coroutines) {
+    if (isWaiting(coroutine, delta) || !resume(coroutine)) {
+      _coroutines.push_back(std::move(coroutine));
+    }
+  }
+}
+
+void ScriptRunner::clear() {
+  _coroutines.clear();
+}
+
+size_t ScriptRunner::getNumActiveScripts() const {
+  return _coroutines.size();
+}
+
+
+bool ScriptRunner::resume(Coroutine& coroutine) {
+  const vector<Instruction>& instructions = *coroutine.script;
+
+  while (coroutine.pc < instructions.size()) {
+    const Instruction& instruction = instructions[coroutine.pc++];
+
+    switch (instruction.opcode) {
+      case Opcode::COMMAND:
+        Console::getInstance()->executeCmd(instruction.cmd);
+        break;
+
+      case Opcode::WAIT:
+        coroutine.waitTimer = instruction.operands[0];
+        return false;
+
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
+bool ScriptRunner::isWaiting(Coroutine& coroutine, float delta) const {
+  // A suspended coroutine is waiting on the instruction which suspended it.
+  const Instruction& instruction = (*coroutine.script)[coroutine.pc - 1];
+
+  switch (instruction.opcode) {
+    case Opcode::WAIT:
+      coroutine.waitTimer -= delta;
+      return coroutine.waitTimer > 0;
+
+    case Opcode::WAIT_FOR_DIALOGUE_END:
+      return DialogueManager::getInstance()->getSubtitles()->getLayer()->isVisible();
+
+    case Opcode::WAIT_FOR_PLAYER: {
+      Player* player = GameMapManager::getInstance()->getPlayer();
+      if (!player || !player->getBody()) {
+        return true;
+      }
+      const b2Vec2& pos = player->getBody()->GetPosition();
+      const float dx = pos.x * kPpm - instruction.operands[0];
+      const float dy = pos.y * kPpm - instruction.operands[1];
+      const float radius = instruction.operands[2];
+      return dx * dx + dy * dy > radius * radius;
+    }
+
+    default:
+      return false;
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,75 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_SCRIPT_RUNNER_H_
+#define VIGILANTE_SCRIPT_RUNNER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ui/console/CommandParser.h"
+
+namespace vigilante {
+
+// Runs scripts, i.e., sequences of console commands (e.g., the commands of
+// a GameMap::Trigger or of a dialogue), as coroutines. In addition to the
+// commands of CommandParser, a script may contain the following ones,
+// which suspend it until:
+//
+//   wait <seconds>               the time is up
+//   waitForDialogueEnd           the subtitles are dismissed
+//   waitForPlayer <x> <y> [r]    the player is within `r` pixels of (x, y)
+//
+// Scripts are compiled once when they're loaded (see compile()), so running
+// them doesn't have to tokenize the commands again. A script which doesn't
+// suspend runs to the end within run(), so only the suspended scripts cost
+// anything per frame (see update()).
+class ScriptRunner final {
+ public:
+  enum class Opcode {
+    COMMAND,
+    WAIT,
+    WAIT_FOR_DIALOGUE_END,
+    WAIT_FOR_PLAYER
+  };
+
+  struct Instruction final {
+    ScriptRunner::Opcode opcode;
+    CommandParser::Command cmd;  // only used by COMMAND
+    float operands[3];
+  };
+
+  // Compiled scripts are immutable, and shared by all the coroutines running them.
+  using Script = std::shared_ptr<const std::vector<ScriptRunner::Instruction>>;
+
+  static ScriptRunner* getInstance();
+  static ScriptRunner::Script compile(const std::vector<std::string>& cmds);
+
+  void run(const ScriptRunner::Script& script);
+
+  // Resumes the suspended scripts whose conditions are met.
+  void update(float delta);
+  void clear();
+
+  size_t getNumActiveScripts() const;
+
+ private:
+  struct Coroutine final {
+    ScriptRunner::Script script;
+    size_t pc;  // the index of the next instruction
+    float waitTimer;  // in seconds
+  };
+
+  ScriptRunner();
+
+  // Runs `coroutine` until it suspends. Returns true if it has finished.
+  bool resume(ScriptRunner::Coroutine& coroutine);
+  bool isWaiting(ScriptRunner::Coroutine& coroutine, float delta) const;
+
+  static const float _kDefaultPlayerRadius;
+
+  std::vector<ScriptRunner::Coroutine> _coroutines;  // the suspended ones
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_SCRIPT_RUNNER_H_
@@ -0,0 +1,123 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "StatsSystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "EventBus.h"
+
+using std::array;
+
+namespace vigilante {
+
+const float StatsSystem::_kRegenInterval = 5.0f;
+const int StatsSystem::_kBaseRegenDelta = 5;
+
+StatsSystem* StatsSystem::getInstance() {
+  static StatsSystem instance;
+  return &instance;
+}
+
+StatsSystem::StatsSystem()
+    : _owners(),
+      _values(),
+      _fullValues(),
+      _regenDeltas(),
+      _regenTimers(),
+      _isRegenEnabled(),
+      _hasRegenTicked(),
+      _freeIndices() {}
+
+
+int StatsSystem::allocate(Character* owner,
+                          const array<int, StatsSystem::Stat::SIZE>& values,
+                          const array<int, StatsSystem::Stat::SIZE>& fullValues) {
+  assert(owner != nullptr);
+
+  int index;
+  if (!_freeIndices.empty()) {
+    index = _freeIndices.back();
+    _freeIndices.pop_back();
+  } else {
+    index = static_cast<int>(_owners.size());
+    _owners.push_back(nullptr);
+    for (int i = 0; i < Stat::SIZE; i++) {
+      _values[i].push_back(0);
+      _fullValues[i].push_back(0);
+      _regenDeltas[i].push_back(0);
+    }
+    _regenTimers.push_back(0);
+    _isRegenEnabled.push_back(false);
+    _hasRegenTicked.push_back(false);
+  }
+
+  _owners[index] = owner;
+  for (int i = 0; i < Stat::SIZE; i++) {
+    _fullValues[i][index] = fullValues[i];
+    _values[i][index] = std::min(values[i], fullValues[i]);
+    _regenDeltas[i][index] = _kBaseRegenDelta;
+  }
+  _regenTimers[index] = 0;
+  _isRegenEnabled[index] = false;
+  return index;
+}
+
+void StatsSystem::release(int index) {
+  _owners[index] = nullptr;
+  _isRegenEnabled[index] = false;
+  _freeIndices.push_back(index);
+}
+
+void StatsSystem::update(float delta) {
+  const size_t size = _owners.size();
+  float* regenTimers = _regenTimers.data();
+  const uint8_t* isRegenEnabled = _isRegenEnabled.data();
+  uint8_t* hasRegenTicked = _hasRegenTicked.data();
+
+  // The loops below are branchless, so that the compiler can vectorize them.
+  for (size_t i = 0; i < size; i++) {
+    regenTimers[i] += (isRegenEnabled[i]) ? delta : 0;
+    hasRegenTicked[i] = regenTimers[i] >= _kRegenInterval;
+    regenTimers[i] = (hasRegenTicked[i]) ? 0 : regenTimers[i];
+  }
+
+  for (int s = 0; s < Stat::SIZE; s++) {
+    int* values = _values[s].data();
+    const int* fullValues = _fullValues[s].data();
+    const int* regenDeltas = _regenDeltas[s].data();
+    for (size_t i = 0; i < size; i++) {
+      const int value = values[i] + hasRegenTicked[i] * regenDeltas[i];
+      values[i] = (value < fullValues[i]) ? value : fullValues[i];
+    }
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    if (hasRegenTicked[i]) {
+      EventBus::getInstance()->post(StatChangedEvent{_owners[i]});
+    }
+  }
+}
+
+
+int StatsSystem::get(int index, StatsSystem::Stat stat) const {
+  return _values[stat][index];
+}
+
+void StatsSystem::set(int index, StatsSystem::Stat stat, int value) {
+  _values[stat][index] = std::max(0, std::min(value, _fullValues[stat][index]));
+}
+
+void StatsSystem::modify(int index, StatsSystem::Stat stat, int delta) {
+  set(index, stat, _values[stat][index] + delta);
+}
+
+void StatsSystem::setFull(int index, StatsSystem::Stat stat, int fullValue) {
+  _fullValues[stat][index] = fullValue;
+  set(index, stat, _values[stat][index]);
+}
+
+void StatsSystem::setRegenEnabled(int index, bool regenEnabled) {
+  _isRegenEnabled[index] = regenEnabled;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,72 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_STATS_SYSTEM_H_
+#define VIGILANTE_STATS_SYSTEM_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace vigilante {
+
+// Forward Declaration
+class Character;
+
+// Keeps the vitals (health, magicka and stamina) of all live characters
+// in structure-of-arrays form, so that regeneration is run as a single pass
+// over contiguous arrays every frame (see update()), instead of being
+// ticked by each character separately.
+//
+// Each Character only holds an index into these arrays, which stays valid
+// until it is released (the slots are recycled, not compacted).
+// The current values are always clamped to [0, full value].
+//
+// The stats system must only be used by the main thread, though the
+// values can be read concurrently while nothing writes to them
+// (e.g., by Npc::think()).
+class StatsSystem final {
+ public:
+  enum Stat {
+    HEALTH,
+    MAGICKA,
+    STAMINA,
+    SIZE
+  };
+
+  static StatsSystem* getInstance();
+
+  int allocate(Character* owner,
+               const std::array<int, StatsSystem::Stat::SIZE>& values,
+               const std::array<int, StatsSystem::Stat::SIZE>& fullValues);
+  void release(int index);
+
+  // Advances the regen timers of all characters with regen enabled,
+  // and regenerates the vitals of those whose timers are up.
+  void update(float delta);
+
+  int get(int index, StatsSystem::Stat stat) const;
+  void set(int index, StatsSystem::Stat stat, int value);
+  void modify(int index, StatsSystem::Stat stat, int delta);
+  void setFull(int index, StatsSystem::Stat stat, int fullValue);
+
+  // Regen is only enabled for the characters shown on the map and not killed.
+  void setRegenEnabled(int index, bool regenEnabled);
+
+ private:
+  StatsSystem();
+
+  static const float _kRegenInterval;
+  static const int _kBaseRegenDelta;
+
+  std::vector<Character*> _owners;  // nullptr if the slot is free
+  std::array<std::vector<int>, StatsSystem::Stat::SIZE> _values;
+  std::array<std::vector<int>, StatsSystem::Stat::SIZE> _fullValues;
+  std::array<std::vector<int>, StatsSystem::Stat::SIZE> _regenDeltas;
+  std::vector<float> _regenTimers;
+  std::vector<uint8_t> _isRegenEnabled;
+  std::vector<uint8_t> _hasRegenTicked;  // scratch space of update()
+  std::vector<int> _freeIndices;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_STATS_SYSTEM_H_
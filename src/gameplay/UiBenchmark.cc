@@ -0,0 +1,233 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "UiBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+
+#include "AssetManager.h"
+#include "character/Npc.h"
+#include "character/NpcPool.h"
+#include "character/Player.h"
+#include "item/Item.h"
+#include "map/GameMapManager.h"
+#include "quest/KillTargetObjective.h"
+#include "quest/QuestBook.h"
+#include "std/make_unique.h"
+#include "ui/WindowManager.h"
+#include "ui/dialogue/DialogueManager.h"
+#include "ui/pause_menu/PauseMenu.h"
+#include "ui/pause_menu/inventory/InventoryPane.h"
+#include "ui/pause_menu/quest/QuestPane.h"
+#include "ui/trade/TradeWindow.h"
+#include "util/Logger.h"
+#include "util/StatsUtil.h"
+
+#define ITEM_ASSETS_DIR "Database/item/"
+
+using std::ifstream;
+using std::ofstream;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+
+namespace vigilante {
+
+namespace {
+
+struct QuestState final {
+  string jsonFileName;
+  bool isUnlocked;
+  int stageIdx;
+  int objectiveProgress;
+};
+
+// Returns the time taken by `f` in milliseconds.
+template <typename F>
+float measure(F&& f) {
+  const steady_clock::time_point beginTime = steady_clock::now();
+  f();
+  return std::chrono::duration<float, std::milli>(steady_clock::now() - beginTime).count();
+}
+
+// Scrolls `listView` down to the bottom and back, and samples each step.
+template <typename ListViewType>
+void measureScrolling(ListViewType* listView, vector<float>& samples) {
+  const int numSteps = static_cast<int>(listView->getNumObjects()) - 1;
+  for (int i = 0; i < numSteps; i++) {
+    samples.push_back(measure([listView]() { listView->selectDown(); }));
+  }
+  for (int i = 0; i < numSteps; i++) {
+    samples.push_back(measure([listView]() { listView->selectUp(); }));
+  }
+}
+
+}  // namespace
+
+UiBenchmark* UiBenchmark::getInstance() {
+  static UiBenchmark instance;
+  return &instance;
+}
+
+
+bool UiBenchmark::run(const UiBenchmark::Config& config) {
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  if (!player) {
+    return false;
+  }
+
+  _samples.clear();
+  VGLOG(LOG_INFO, "UI benchmark started: %d iterations, %d of each item",
+        config.iterations, config.itemAmount);
+
+  // Fill the inventory. The same amounts are removed afterwards,
+  // so the items which the player already had are left intact.
+  vector<pair<shared_ptr<Item>, int>> items;
+  for (const auto& itemJson : asset_manager::listJsonFiles(ITEM_ASSETS_DIR)) {
+    items.push_back({Item::create(itemJson), config.itemAmount});
+  }
+  player->addItems(items);
+
+  // Save the state of the quests like GameState does,
+  // and then put every quest in progress.
+  QuestBook& questBook = player->getQuestBook();
+  vector<QuestState> questStates;
+  for (const auto quest : questBook.getAllQuests()) {
+    int objectiveProgress = 0;
+    if (!quest->isCompleted() && quest->getCurrentStageIdx() >= 0) {
+      const auto& objective = quest->getCurrentStage().objective;
+      if (objective && objective->getObjectiveType() == Quest::Objective::Type::KILL) {
+        objectiveProgress = static_cast<KillTargetObjective*>(objective.get())->getCurrentAmount();
+      }
+    }
+    questStates.push_back({quest->getQuestProfile().jsonFileName, quest->isUnlocked(),
+                           quest->getCurrentStageIdx(), objectiveProgress});
+  }
+  ifstream fin(asset_manager::kQuestsList);
+  string questJson;
+  questBook.reset();
+  while (std::getline(fin, questJson)) {
+    if (!questJson.empty()) {
+      questBook.restoreQuest(questJson, /*isUnlocked=*/true, /*stageIdx=*/0, /*objectiveProgress=*/0);
+    }
+  }
+
+  VGLOG(LOG_INFO, "UI benchmark: %d kinds of items, %d quests",
+        static_cast<int>(items.size()), static_cast<int>(questBook.getInProgressQuests().size()));
+
+  // The panes are refreshed entirely by show(), as if they were dirty.
+  PauseMenu* pauseMenu = PauseMenu::getInstance();
+  const bool wasPauseMenuVisible = pauseMenu->isVisible();
+  pauseMenu->setVisible(true);
+  for (int i = 0; i < config.iterations; i++) {
+    for (int pane = 0; pane < PauseMenu::Pane::SIZE; pane++) {
+      getSamples("pauseMenu." + PauseMenu::_kPaneNames[pane]).push_back(measure([pauseMenu, pane]() {
+        pauseMenu->show(static_cast<PauseMenu::Pane>(pane));
+      }));
+    }
+  }
+
+  pauseMenu->show(PauseMenu::Pane::INVENTORY);
+  if (auto inventoryPane = dynamic_cast<InventoryPane*>(pauseMenu->getCurrentPane())) {
+    measureScrolling(inventoryPane->getItemListView(), getSamples("itemListView.scroll"));
+  }
+  pauseMenu->show(PauseMenu::Pane::QUESTS);
+  if (auto questPane = dynamic_cast<QuestPane*>(pauseMenu->getCurrentPane())) {
+    measureScrolling(questPane->getQuestListView(), getSamples("questListView.scroll"));
+  }
+  pauseMenu->show(PauseMenu::Pane::INVENTORY);
+  pauseMenu->setVisible(wasPauseMenuVisible);
+
+  // The npc isn't shown on the GameMap, since
+  // only its inventory and dialogue tree are used.
+  shared_ptr<Npc> npc = NpcPool::getInstance()->acquire(config.npcJson);
+  WindowManager* windowManager = WindowManager::getInstance();
+  for (int i = 0; i < config.iterations; i++) {
+    getSamples("tradeWindow.open").push_back(measure([windowManager, player, &npc]() {
+      windowManager->push(std::make_unique<TradeWindow>(/*buyer=*/player, /*seller=*/npc.get()));
+    }));
+    windowManager->pop();
+  }
+
+  DialogueManager* dialogueMgr = DialogueManager::getInstance();
+  DialogueMenu* dialogueMenu = dialogueMgr->getDialogueMenu();
+  DialogueTree& dialogueTree = npc->getDialogueTree();
+  if (DialogueTree::Node* rootNode = dialogueTree.getRootNode()) {
+    Npc* targetNpc = dialogueMgr->getTargetNpc();
+    dialogueMgr->setTargetNpc(npc.get());
+    for (int i = 0; i < config.iterations; i++) {
+      getSamples("dialogueMenu.open").push_back(measure([dialogueMenu, &dialogueTree, rootNode]() {
+        DialogueListView* dialogueListView = dialogueMenu->getDialogueListView();
+        dialogueListView->setObjects<vector>(dialogueTree.getChildren(rootNode));
+        dialogueListView->updatePosition();
+        dialogueMenu->getLayer()->setVisible(true);
+      }));
+      dialogueMenu->getLayer()->setVisible(false);
+    }
+    dialogueMgr->setTargetNpc(targetNpc);
+  }
+  NpcPool::getInstance()->release(std::move(npc));
+
+  // Restore the quests and the inventory.
+  questBook.reset();
+  for (const auto& quest : questStates) {
+    questBook.restoreQuest(quest.jsonFileName, quest.isUnlocked, quest.stageIdx, quest.objectiveProgress);
+  }
+  vector<pair<Item*, int>> addedItems;
+  for (const auto& p : items) {
+    addedItems.push_back({p.first.get(), p.second});
+  }
+  player->removeItems(addedItems);
+
+  writeResults(config);
+  return true;
+}
+
+
+UiBenchmark::Samples& UiBenchmark::getSamples(const string& name) {
+  auto it = std::find_if(_samples.begin(), _samples.end(),
+                         [&name](const pair<string, Samples>& p) { return p.first == name; });
+  if (it != _samples.end()) {
+    return it->second;
+  }
+  _samples.push_back({name, Samples()});
+  return _samples.back().second;
+}
+
+bool UiBenchmark::writeResults(const UiBenchmark::Config& config) const {
+  for (const auto& p : _samples) {
+    VGLOG(LOG_INFO, "UI benchmark %s: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+          p.first.c_str(), stats_util::getPercentile(p.second, 50),
+          stats_util::getPercentile(p.second, 90), stats_util::getPercentile(p.second, 99),
+          stats_util::getPercentile(p.second, 100));
+  }
+
+  ofstream fout(config.resultFileName, std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_ERR, "Unable to write UI benchmark results to: %s", config.resultFileName.c_str());
+    return false;
+  }
+
+  fout << "{\n";
+  fout << "  \"npc\": \"" << config.npcJson << "\",\n";
+  fout << "  \"iterations\": " << config.iterations << ",\n";
+  fout << "  \"itemAmount\": " << config.itemAmount << ",\n";
+  fout << "  \"sections\": {";
+
+  for (size_t i = 0; i < _samples.size(); i++) {
+    const Samples& samples = _samples[i].second;
+    fout << ((i == 0) ? "\n" : ",\n");
+    fout << "    \"" << _samples[i].first << "\": {"
+         << "\"samples\": " << samples.size() << ", ";
+    stats_util::writePercentiles(fout, samples);
+    fout << "}";
+  }
+
+  fout << "\n  }\n}\n";
+  return true;
+}
+
+}  // namespace vigilante
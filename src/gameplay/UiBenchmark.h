@@ -0,0 +1,51 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_UI_BENCHMARK_H_
+#define VIGILANTE_UI_BENCHMARK_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vigilante {
+
+// Measures how responsive the menus are with a large save.
+//
+// run() fills the player's inventory with `itemAmount` of every item in the
+// database, and puts every quest of the quests list in progress. Then, within
+// the same frame, it times each of the following `iterations` times:
+// PauseMenu::show() of every pane, a scroll step of the inventory and the
+// quest list views (down to the bottom and back), opening a TradeWindow,
+// and opening the DialogueMenu of the first dialogue of `npcJson`.
+// The percentiles of each are logged and written as json to `resultFileName`,
+// and the player's inventory and quests are restored afterwards.
+//
+// All methods must be called on the main thread.
+class UiBenchmark final {
+ public:
+  struct Config final {
+    std::string npcJson;  // the trader and the speaker
+    int iterations;
+    int itemAmount;  // of each item
+    std::string resultFileName;
+  };
+
+  static UiBenchmark* getInstance();
+
+  // Returns false if there's no game in progress.
+  bool run(const UiBenchmark::Config& config);
+
+ private:
+  using Samples = std::vector<float>;  // in milliseconds
+
+  UiBenchmark() = default;
+
+  // Returns the samples of `name`, which are added on demand.
+  UiBenchmark::Samples& getSamples(const std::string& name);
+  bool writeResults(const UiBenchmark::Config& config) const;
+
+  std::vector<std::pair<std::string, UiBenchmark::Samples>> _samples;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_UI_BENCHMARK_H_
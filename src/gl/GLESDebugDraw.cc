@@ -20,151 +20,99 @@
  */
 #include "GLESDebugDraw.h"
 
-#include <cstdio>
-#include <cstdarg>
-#include <cstring>
-#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 
-#include "std/make_unique.h"
+#define SOLID_FILL_ALPHA .2f
+#define SOLID_FILL_COLOR_SCALE .5f
+#define CIRCLE_MIN_SEGMENTS 8
+#define CIRCLE_MAX_SEGMENTS 64
+#define CIRCLE_PIXELS_PER_SEGMENT 4.0f
 
-using std::unique_ptr;
+using std::vector;
 using cocos2d::GLProgram;
 using cocos2d::GLProgramCache;
 
 
-GLESDebugDraw::GLESDebugDraw() : _ratio(1.0f) {
+GLESDebugDraw::GLESDebugDraw()
+    : _ratio(1.0f),
+      _shaderProgram(),
+      _vbo(),
+      _triangleVertices(),
+      _lineVertices(),
+      _unitCircles() {
   initShader();
 }
 
-GLESDebugDraw::GLESDebugDraw(float32 ratio) : _ratio(ratio) {
+GLESDebugDraw::GLESDebugDraw(float32 ratio)
+    : _ratio(ratio),
+      _shaderProgram(),
+      _vbo(),
+      _triangleVertices(),
+      _lineVertices(),
+      _unitCircles() {
   initShader();
 }
 
+GLESDebugDraw::~GLESDebugDraw() {
+  if (_vbo) {
+    glDeleteBuffers(1, &_vbo);
+  }
+}
+
 
 void GLESDebugDraw::initShader() {
-  _shaderProgram = GLProgramCache::getInstance()->getGLProgram(GLProgram::SHADER_NAME_POSITION_U_COLOR);
-  _colorLocation = glGetUniformLocation(_shaderProgram->getProgram(), "u_color");
+  _shaderProgram = GLProgramCache::getInstance()->getGLProgram(GLProgram::SHADER_NAME_POSITION_COLOR);
+  glGenBuffers(1, &_vbo);
 }
 
-void GLESDebugDraw::DrawPolygon(const b2Vec2* old_vertices, int vertexCount, const b2Color& color) {
-  _shaderProgram->use();
-  _shaderProgram->setUniformsForBuiltins();
-
-  unique_ptr<b2Vec2[]> vertices = std::make_unique<b2Vec2[]>(vertexCount);
-  
+void GLESDebugDraw::DrawPolygon(const b2Vec2* vertices, int vertexCount, const b2Color& color) {
   for (int i = 0; i < vertexCount; i++) {
-    vertices[i] = old_vertices[i];
-    vertices[i] *= _ratio;
+    addLine(vertices[i], vertices[(i + 1) % vertexCount], color, 1);
   }
-
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r, color.g, color.b, 1);
-
-  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 0, vertices.get());
-  glDrawArrays(GL_LINE_LOOP, 0, vertexCount);
-
-  CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES(1, vertexCount);
-  CHECK_GL_ERROR_DEBUG();
 }
 
-void GLESDebugDraw::DrawSolidPolygon(const b2Vec2* old_vertices, int vertexCount, const b2Color& color) {
-  _shaderProgram->use();
-  _shaderProgram->setUniformsForBuiltins();
-
-  unique_ptr<b2Vec2[]> vertices = std::make_unique<b2Vec2[]>(vertexCount);
+void GLESDebugDraw::DrawSolidPolygon(const b2Vec2* vertices, int vertexCount, const b2Color& color) {
+  const b2Color fillColor(color.r * SOLID_FILL_COLOR_SCALE,
+                          color.g * SOLID_FILL_COLOR_SCALE,
+                          color.b * SOLID_FILL_COLOR_SCALE);
 
-  for (int i = 0; i < vertexCount; i++) {
-    vertices[i] = old_vertices[i];
-    vertices[i] *= _ratio;
+  // Triangulate it as a triangle fan.
+  for (int i = 1; i < vertexCount - 1; i++) {
+    addTriangle(vertices[0], vertices[i], vertices[i + 1], fillColor, SOLID_FILL_ALPHA);
   }
-
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r * .5f, color.g * .5f, color.b * .5f, .2f);
-
-  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 0, vertices.get());
-  glDrawArrays(GL_TRIANGLE_FAN, 0, vertexCount);
-
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r, color.g, color.b, 1);
-  glDrawArrays(GL_LINE_LOOP, 0, vertexCount);
-
-  CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES(2, vertexCount * 2);
-  CHECK_GL_ERROR_DEBUG();
+  DrawPolygon(vertices, vertexCount, color);
 }
 
 void GLESDebugDraw::DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color) {
-  _shaderProgram->use();
-  _shaderProgram->setUniformsForBuiltins();
-
-  const float32 k_segments = 16.0f;
-  int vertexCount = 16;
-  const float32 k_increment = 2.0f * b2_pi / k_segments;
-  float32 theta = 0.0f;
+  const vector<b2Vec2>& unitCircle = getUnitCircle(radius);
+  const size_t n = unitCircle.size();
 
-  unique_ptr<GLfloat[]> glVertices = std::make_unique<GLfloat[]>(vertexCount * 2);
-
-  for (int i = 0; i < k_segments; ++i) {
-    b2Vec2 v = center + radius * b2Vec2(cosf(theta), sinf(theta));
-    glVertices[i * 2] = v.x * _ratio;
-    glVertices[i * 2 + 1] = v.y * _ratio;
-    theta += k_increment;
+  for (size_t i = 0; i < n; i++) {
+    addLine(center + radius * unitCircle[i], center + radius * unitCircle[(i + 1) % n], color, 1);
   }
-
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r, color.g, color.b, 1);
-  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 0, glVertices.get());
-  glDrawArrays(GL_LINE_LOOP, 0, vertexCount);
-
-  CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES(1,vertexCount);
-  CHECK_GL_ERROR_DEBUG();
 }
 
 void GLESDebugDraw::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color) {
-  _shaderProgram->use();
-  _shaderProgram->setUniformsForBuiltins();
-
-  const float32 k_segments = 16.0f;
-  int vertexCount = 16;
-  const float32 k_increment = 2.0f * b2_pi / k_segments;
-  float32 theta = 0.0f;
-
-  unique_ptr<GLfloat[]> glVertices = std::make_unique<GLfloat[]>(vertexCount * 2);
-
-  for (int i = 0; i < k_segments; ++i) {
-    b2Vec2 v = center + radius * b2Vec2(cosf(theta), sinf(theta));
-    glVertices[i * 2] = v.x * _ratio;
-    glVertices[i * 2 + 1] = v.y * _ratio;
-    theta += k_increment;
+  const vector<b2Vec2>& unitCircle = getUnitCircle(radius);
+  const size_t n = unitCircle.size();
+  const b2Color fillColor(color.r * SOLID_FILL_COLOR_SCALE,
+                          color.g * SOLID_FILL_COLOR_SCALE,
+                          color.b * SOLID_FILL_COLOR_SCALE);
+
+  for (size_t i = 0; i < n; i++) {
+    addTriangle(center, center + radius * unitCircle[i], center + radius * unitCircle[(i + 1) % n],
+                fillColor, SOLID_FILL_ALPHA);
   }
-
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r * .5f, color.g * .5f, color.b * .5f, .2f);
-  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 0, glVertices.get());
-  glDrawArrays(GL_TRIANGLE_FAN, 0, vertexCount);
-
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r, color.g, color.b, 1);
-  glDrawArrays(GL_LINE_LOOP, 0, vertexCount);
+  DrawCircle(center, radius, color);
 
   // Draw the axis line
-  DrawSegment(center,center+radius*axis,color);
-
-  CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES(2, vertexCount * 2);
-  CHECK_GL_ERROR_DEBUG();
+  DrawSegment(center, center + radius * axis, color);
 }
 
 void GLESDebugDraw::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color) {
-  _shaderProgram->use();
-  _shaderProgram->setUniformsForBuiltins();
-
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r, color.g, color.b, 1);
-
-  GLfloat glVertices[] = {
-    p1.x * _ratio,
-    p1.y * _ratio,
-    p2.x * _ratio,
-    p2.y * _ratio
-  };
-
-  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 0, glVertices);
-  glDrawArrays(GL_LINES, 0, 2);
-
-  CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES(1,2);
-  CHECK_GL_ERROR_DEBUG();
+  addLine(p1, p2, color, 1);
 }
 
 void GLESDebugDraw::DrawTransform(const b2Transform& xf) {
@@ -179,43 +127,111 @@ void GLESDebugDraw::DrawTransform(const b2Transform& xf) {
 }
 
 void GLESDebugDraw::DrawPoint(const b2Vec2& p, float32 size, const b2Color& color) {
+  // Draw it as a small quad (`size` is in pixels).
+  const float32 halfSize = size / 2 / _ratio;
+  const b2Vec2 p1(p.x - halfSize, p.y - halfSize);
+  const b2Vec2 p2(p.x + halfSize, p.y - halfSize);
+  const b2Vec2 p3(p.x + halfSize, p.y + halfSize);
+  const b2Vec2 p4(p.x - halfSize, p.y + halfSize);
+
+  addTriangle(p1, p2, p3, color, 1);
+  addTriangle(p1, p3, p4, color, 1);
+}
+
+void GLESDebugDraw::DrawAABB(b2AABB* aabb, const b2Color& color) {
+  b2Vec2 vertices[4] = {
+    {aabb->lowerBound.x, aabb->lowerBound.y},
+    {aabb->upperBound.x, aabb->lowerBound.y},
+    {aabb->upperBound.x, aabb->upperBound.y},
+    {aabb->lowerBound.x, aabb->upperBound.y}
+  };
+  DrawPolygon(vertices, 4, color);
+}
+
+
+void GLESDebugDraw::flush() {
+  if (_triangleVertices.empty() && _lineVertices.empty()) {
+    return;
+  }
+
   _shaderProgram->use();
   _shaderProgram->setUniformsForBuiltins();
 
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r, color.g, color.b, 1);
+  // Upload the triangles followed by the lines into the same buffer.
+  const size_t numTriangleVertices = _triangleVertices.size();
+  const size_t numLineVertices = _lineVertices.size();
+  _triangleVertices.insert(_triangleVertices.end(), _lineVertices.begin(), _lineVertices.end());
 
-  GLfloat glVertices[] = {
-    p.x * _ratio,
-    p.y * _ratio
-  };
+  glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * _triangleVertices.size(),
+               _triangleVertices.data(), GL_STREAM_DRAW);
+
+  cocos2d::GL::enableVertexAttribs(cocos2d::GL::VERTEX_ATTRIB_FLAG_POSITION |
+                                   cocos2d::GL::VERTEX_ATTRIB_FLAG_COLOR);
+  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        reinterpret_cast<GLvoid*>(offsetof(Vertex, x)));
+  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        reinterpret_cast<GLvoid*>(offsetof(Vertex, r)));
 
-  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 0, glVertices);
-  glDrawArrays(GL_POINTS, 0, 1);
+  cocos2d::GL::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-  CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES(1,1);
+  if (numTriangleVertices > 0) {
+    glDrawArrays(GL_TRIANGLES, 0, numTriangleVertices);
+  }
+  if (numLineVertices > 0) {
+    glDrawArrays(GL_LINES, numTriangleVertices, numLineVertices);
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES((numTriangleVertices > 0) + (numLineVertices > 0),
+                                             numTriangleVertices + numLineVertices);
   CHECK_GL_ERROR_DEBUG();
+
+  // Keep the capacity for the next frame.
+  _triangleVertices.clear();
+  _lineVertices.clear();
 }
 
-void GLESDebugDraw::DrawAABB(b2AABB* aabb, const b2Color& color) {
-  _shaderProgram->use();
-  _shaderProgram->setUniformsForBuiltins();
 
-  _shaderProgram->setUniformLocationWith4f(_colorLocation, color.r, color.g, color.b, 1);
-
-  GLfloat glVertices[] = {
-    aabb->lowerBound.x * _ratio,
-    aabb->lowerBound.y * _ratio,
-    aabb->upperBound.x * _ratio,
-    aabb->lowerBound.y * _ratio,
-    aabb->upperBound.x * _ratio,
-    aabb->upperBound.y * _ratio,
-    aabb->lowerBound.x * _ratio,
-    aabb->upperBound.y * _ratio
-  };
+const vector<b2Vec2>& GLESDebugDraw::getUnitCircle(float32 radius) {
+  // Larger circles get more segments. The segment count is rounded up
+  // to a power of two, so that there are only a few buckets.
+  int numSegments = CIRCLE_MIN_SEGMENTS;
+  const float32 circumference = 2.0f * b2_pi * radius * _ratio;
+  while (numSegments < CIRCLE_MAX_SEGMENTS &&
+         numSegments * CIRCLE_PIXELS_PER_SEGMENT < circumference) {
+    numSegments *= 2;
+  }
+
+  auto it = _unitCircles.find(numSegments);
+  if (it != _unitCircles.end()) {
+    return it->second;
+  }
 
-  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 0, glVertices);
-  glDrawArrays(GL_LINE_LOOP, 0, 4);
+  vector<b2Vec2>& unitCircle = _unitCircles[numSegments];
+  unitCircle.reserve(numSegments);
 
-  CC_INCREMENT_GL_DRAWN_BATCHES_AND_VERTICES(1,4);
-  CHECK_GL_ERROR_DEBUG();
+  const float32 increment = 2.0f * b2_pi / numSegments;
+  for (int i = 0; i < numSegments; i++) {
+    unitCircle.push_back({std::cos(increment * i), std::sin(increment * i)});
+  }
+  return unitCircle;
+}
+
+void GLESDebugDraw::addLine(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color, float alpha) {
+  addVertex(_lineVertices, p1, color, alpha);
+  addVertex(_lineVertices, p2, color, alpha);
+}
+
+void GLESDebugDraw::addTriangle(const b2Vec2& p1, const b2Vec2& p2, const b2Vec2& p3,
+                                const b2Color& color, float alpha) {
+  addVertex(_triangleVertices, p1, color, alpha);
+  addVertex(_triangleVertices, p2, color, alpha);
+  addVertex(_triangleVertices, p3, color, alpha);
+}
+
+void GLESDebugDraw::addVertex(vector<GLESDebugDraw::Vertex>& vertices, const b2Vec2& p,
+                              const b2Color& color, float alpha) {
+  vertices.push_back({p.x * _ratio, p.y * _ratio, color.r, color.g, color.b, alpha});
 }
@@ -21,18 +21,26 @@
 #ifndef VIGILANTE_RENDER_H_
 #define VIGILANTE_RENDER_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include <cocos2d.h>
 #include <Box2D/Box2D.h>
 
 struct b2AABB;
 
 // This class implements debug drawing callbacks that are invoked
-// inside b2World::Step.
+// inside b2World::DrawDebugData().
+//
+// The primitives are not drawn right away. Instead, they are accumulated
+// into one vertex buffer (with per-vertex colors) per frame, and drawn
+// with (at most) two draw calls in flush(): one for the triangles,
+// and one for the lines.
 class GLESDebugDraw : public b2Draw {
  public:
   GLESDebugDraw();
   explicit GLESDebugDraw(float32 ratio);
-  virtual ~GLESDebugDraw() = default;
+  virtual ~GLESDebugDraw();
 
   virtual void DrawPolygon(const b2Vec2* vertices, int vertexCount, const b2Color& color) override;
   virtual void DrawSolidPolygon(const b2Vec2* vertices, int vertexCount, const b2Color& color) override;
@@ -43,12 +51,39 @@ class GLESDebugDraw : public b2Draw {
   virtual void DrawPoint(const b2Vec2& p, float32 size, const b2Color& color) override;
   virtual void DrawAABB(b2AABB* aabb, const b2Color& color);
 
+  // Draws all the primitives accumulated so far, and then clears them.
+  void flush();
+
  private:
+  struct Vertex final {
+    GLfloat x;
+    GLfloat y;
+    GLfloat r;
+    GLfloat g;
+    GLfloat b;
+    GLfloat a;
+  };
+
   void initShader();
 
+  // Returns the vertices of a unit circle, tessellated based on `radius`.
+  const std::vector<b2Vec2>& getUnitCircle(float32 radius);
+
+  void addLine(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color, float alpha);
+  void addTriangle(const b2Vec2& p1, const b2Vec2& p2, const b2Vec2& p3,
+                   const b2Color& color, float alpha);
+  void addVertex(std::vector<GLESDebugDraw::Vertex>& vertices, const b2Vec2& p,
+                 const b2Color& color, float alpha);
+
   float32 _ratio;
   cocos2d::GLProgram* _shaderProgram;
-  GLint _colorLocation;
+  GLuint _vbo;
+
+  std::vector<GLESDebugDraw::Vertex> _triangleVertices;
+  std::vector<GLESDebugDraw::Vertex> _lineVertices;
+
+  // Each bucket (segment count) -> vertices of a unit circle.
+  std::unordered_map<int, std::vector<b2Vec2>> _unitCircles;
 };
 
 #endif // VIGILANTE_RENDERER_H_
@@ -0,0 +1,349 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "GpuTimer.h"
+
+#include <cfloat>
+#include <cstdint>
+
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+#include <EGL/egl.h>
+#endif
+
+#include "util/Logger.h"
+#include "util/TraceProfiler.h"
+
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+#define HAS_TIMER_QUERY 1
+#define TIME_ELAPSED GL_TIME_ELAPSED_EXT
+#define QUERY_RESULT GL_QUERY_RESULT_EXT
+#define QUERY_RESULT_AVAILABLE GL_QUERY_RESULT_AVAILABLE_EXT
+#elif (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32) || (CC_TARGET_PLATFORM == CC_PLATFORM_LINUX)
+#define HAS_TIMER_QUERY 1
+#define TIME_ELAPSED GL_TIME_ELAPSED
+#define QUERY_RESULT GL_QUERY_RESULT
+#define QUERY_RESULT_AVAILABLE GL_QUERY_RESULT_AVAILABLE
+#else
+#define HAS_TIMER_QUERY 0
+#endif
+
+using std::array;
+using std::string;
+using std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+using cocos2d::CameraFlag;
+using cocos2d::CustomCommand;
+using cocos2d::Director;
+using cocos2d::EventCustom;
+using cocos2d::Mat4;
+using cocos2d::Node;
+using cocos2d::Renderer;
+using cocos2d::Scene;
+
+namespace vigilante {
+
+namespace {
+
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+PFNGLGENQUERIESEXTPROC genQueriesFunc;
+PFNGLBEGINQUERYEXTPROC beginQueryFunc;
+PFNGLENDQUERYEXTPROC endQueryFunc;
+PFNGLGETQUERYOBJECTUIVEXTPROC getQueryObjectuivFunc;
+PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64vFunc;
+#elif HAS_TIMER_QUERY
+PFNGLGENQUERIESPROC genQueriesFunc;
+PFNGLBEGINQUERYPROC beginQueryFunc;
+PFNGLENDQUERYPROC endQueryFunc;
+PFNGLGETQUERYOBJECTUIVPROC getQueryObjectuivFunc;
+PFNGLGETQUERYOBJECTUI64VPROC getQueryObjectui64vFunc;
+#endif
+
+bool initTimerQueryFuncs() {
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+  if (!cocos2d::Configuration::getInstance()->checkForGLExtension("GL_EXT_disjoint_timer_query")) {
+    return false;
+  }
+  genQueriesFunc = reinterpret_cast<PFNGLGENQUERIESEXTPROC>(eglGetProcAddress("glGenQueriesEXT"));
+  beginQueryFunc = reinterpret_cast<PFNGLBEGINQUERYEXTPROC>(eglGetProcAddress("glBeginQueryEXT"));
+  endQueryFunc = reinterpret_cast<PFNGLENDQUERYEXTPROC>(eglGetProcAddress("glEndQueryEXT"));
+  getQueryObjectuivFunc = reinterpret_cast<PFNGLGETQUERYOBJECTUIVEXTPROC>(
+      eglGetProcAddress("glGetQueryObjectuivEXT"));
+  getQueryObjectui64vFunc = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(
+      eglGetProcAddress("glGetQueryObjectui64vEXT"));
+#elif HAS_TIMER_QUERY
+  if (!GLEW_ARB_timer_query) {
+    return false;
+  }
+  genQueriesFunc = glGenQueries;
+  beginQueryFunc = glBeginQuery;
+  endQueryFunc = glEndQuery;
+  getQueryObjectuivFunc = glGetQueryObjectuiv;
+  getQueryObjectui64vFunc = glGetQueryObjectui64v;
+#endif
+#if HAS_TIMER_QUERY
+  return genQueriesFunc && beginQueryFunc && endQueryFunc &&
+         getQueryObjectuivFunc && getQueryObjectui64vFunc;
+#else
+  return false;
+#endif
+}
+
+// The wrappers below are only called once initTimerQueryFuncs() has succeeded.
+GLuint genTimerQuery() {
+  GLuint id = 0;
+#if HAS_TIMER_QUERY
+  genQueriesFunc(1, &id);
+#endif
+  return id;
+}
+
+void beginTimerQuery(GLuint id) {
+#if HAS_TIMER_QUERY
+  beginQueryFunc(TIME_ELAPSED, id);
+#endif
+}
+
+void endTimerQuery() {
+#if HAS_TIMER_QUERY
+  endQueryFunc(TIME_ELAPSED);
+#endif
+}
+
+bool isTimerQueryResultAvailable(GLuint id) {
+  GLuint isAvailable = GL_FALSE;
+#if HAS_TIMER_QUERY
+  getQueryObjectuivFunc(id, QUERY_RESULT_AVAILABLE, &isAvailable);
+#endif
+  return isAvailable != GL_FALSE;
+}
+
+uint64_t getTimerQueryResult(GLuint id) {  // in nanoseconds
+#if HAS_TIMER_QUERY
+  GLuint64 result = 0;
+  getQueryObjectui64vFunc(id, QUERY_RESULT, &result);
+  return result;
+#else
+  return 0;
+#endif
+}
+
+// Reads and clears whether the GPU's timer has been disrupted (e.g., by a change
+// of its frequency or a power event), in which case the results are garbage.
+bool isDisjoint() {
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+  GLint disjoint = 0;
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  return disjoint != 0;
+#else
+  return false;
+#endif
+}
+
+// Begins its pass before everything else drawn by the camera which it's
+// visible to, and ends it after everything else.
+class PassMarker : public Node {
+ public:
+  static PassMarker* create(GpuTimer::Pass pass) {
+    PassMarker* marker = new (std::nothrow) PassMarker(pass);
+    if (marker && marker->init()) {
+      marker->autorelease();
+      return marker;
+    }
+    delete marker;
+    return nullptr;
+  }
+
+  void draw(Renderer* renderer, const Mat4&, uint32_t) override {
+    if (!GpuTimer::getInstance()->isAvailable()) {
+      return;
+    }
+    _beginCommand.init(-FLT_MAX);
+    _beginCommand.func = [this]() { GpuTimer::getInstance()->begin(_pass); };
+    renderer->addCommand(&_beginCommand);
+    _endCommand.init(FLT_MAX);
+    _endCommand.func = [this]() { GpuTimer::getInstance()->end(_pass); };
+    renderer->addCommand(&_endCommand);
+  }
+
+ private:
+  explicit PassMarker(GpuTimer::Pass pass) : _pass(pass), _beginCommand(), _endCommand() {}
+
+  const GpuTimer::Pass _pass;
+  CustomCommand _beginCommand;
+  CustomCommand _endCommand;
+};
+
+}  // namespace
+
+const int GpuTimer::_kNumFrames;
+const int GpuTimer::_kMaxQueriesPerFrame;
+
+const array<string, GpuTimer::Pass::PASS_SIZE> GpuTimer::_kPassStr = {{
+  "GPU world",
+  "GPU hud",
+  "GPU debug draw"
+}};
+
+GpuTimer* GpuTimer::getInstance() {
+  static GpuTimer instance;
+  return &instance;
+}
+
+GpuTimer::GpuTimer()
+    : _frames(),
+      _currentFrameIndex(),
+      _passStack(),
+      _passStackSize(),
+      _isQueryOpen(),
+      _isTimingFrame(),
+      _times(),
+      _isAvailable(),
+      _isInitialized(),
+      _isEnabled() {
+  _times.fill(-1);
+}
+
+void GpuTimer::setScene(Scene* scene) {
+  if (!_isInitialized) {
+    _isInitialized = true;
+    _isAvailable = initTimerQueryFuncs();
+    if (!_isAvailable) {
+      VGLOG(LOG_INFO, "GPU timer queries are unsupported, the GPU time won't be measured.");
+      return;
+    }
+
+    // The queries are never deleted, as the GL context is gone by the time this is destroyed.
+    for (auto& frame : _frames) {
+      for (auto& query : frame.queries) {
+        query.id = genTimerQuery();
+      }
+    }
+    Director::getInstance()->getEventDispatcher()->addCustomEventListener(
+        Director::EVENT_AFTER_DRAW, [this](EventCustom*) { endFrame(); });
+  }
+
+  if (!_isAvailable) {
+    return;
+  }
+  scene->addChild(PassMarker::create(Pass::WORLD));
+  PassMarker* hudMarker = PassMarker::create(Pass::HUD);
+  hudMarker->setCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
+  scene->addChild(hudMarker);
+}
+
+bool GpuTimer::isAvailable() const {
+  return _isAvailable;
+}
+
+bool GpuTimer::isEnabled() const {
+  return _isEnabled;
+}
+
+void GpuTimer::setEnabled(bool enabled) {
+  _isEnabled = enabled;
+  if (!enabled) {
+    _times.fill(-1);
+  }
+}
+
+void GpuTimer::begin(GpuTimer::Pass pass) {
+  if (!_isTimingFrame || _passStackSize >= Pass::PASS_SIZE) {
+    return;
+  }
+  _passStack[_passStackSize++] = pass;
+  beginQuery(pass);
+}
+
+void GpuTimer::end(GpuTimer::Pass pass) {
+  if (!_isTimingFrame || _passStackSize == 0 || _passStack[_passStackSize - 1] != pass) {
+    return;
+  }
+  endQuery();
+  if (--_passStackSize > 0) {
+    beginQuery(_passStack[_passStackSize - 1]);
+  }
+}
+
+float GpuTimer::getTime(GpuTimer::Pass pass) const {
+  return _times[pass];
+}
+
+
+void GpuTimer::endFrame() {
+  Frame& currentFrame = _frames[_currentFrameIndex];
+  if (_isTimingFrame) {
+    endQuery();
+    _passStackSize = 0;
+    if (currentFrame.numQueries > 0) {
+      currentFrame.isPending = true;
+      _currentFrameIndex = (_currentFrameIndex + 1) % _kNumFrames;
+    }
+  }
+
+  // The frame to be issued next is the oldest one in the ring. If the last
+  // query of a frame isn't available yet, the frames after it aren't either.
+  for (int i = 0; i < _kNumFrames; i++) {
+    Frame& frame = _frames[(_currentFrameIndex + i) % _kNumFrames];
+    if (!frame.isPending) {
+      continue;
+    }
+    if (!isTimerQueryResultAvailable(frame.queries[frame.numQueries - 1].id)) {
+      break;
+    }
+    readBack(frame);
+  }
+
+  // If the GPU is still behind by _kNumFrames, the next frame isn't timed.
+  Frame& nextFrame = _frames[_currentFrameIndex];
+  _isTimingFrame = (_isEnabled || TraceProfiler::getInstance()->isCapturing()) && !nextFrame.isPending;
+  if (_isTimingFrame) {
+    nextFrame.numQueries = 0;
+  }
+}
+
+void GpuTimer::readBack(GpuTimer::Frame& frame) {
+  frame.isPending = false;
+  if (isDisjoint()) {
+    return;
+  }
+
+  array<uint64_t, Pass::PASS_SIZE> passTimes{};  // in nanoseconds
+  array<bool, Pass::PASS_SIZE> isPassDrawn{};
+  TraceProfiler* traceProfiler = TraceProfiler::getInstance();
+  for (int i = 0; i < frame.numQueries; i++) {
+    const Query& query = frame.queries[i];
+    const uint64_t elapsedTime = getTimerQueryResult(query.id);
+    passTimes[query.pass] += elapsedTime;
+    isPassDrawn[query.pass] = true;
+    traceProfiler->addGpuEvent(_kPassStr[query.pass].c_str(), query.beginTime,
+                               nanoseconds(static_cast<int64_t>(elapsedTime)));
+  }
+
+  if (!_isEnabled) {
+    return;
+  }
+  for (int pass = 0; pass < Pass::PASS_SIZE; pass++) {
+    _times[pass] = (isPassDrawn[pass]) ? passTimes[pass] / 1e6f : -1;
+  }
+}
+
+void GpuTimer::beginQuery(GpuTimer::Pass pass) {
+  endQuery();
+  Frame& frame = _frames[_currentFrameIndex];
+  if (frame.numQueries >= _kMaxQueriesPerFrame) {
+    return;  // the rest of this frame isn't timed
+  }
+
+  Query& query = frame.queries[frame.numQueries++];
+  query.pass = pass;
+  query.beginTime = steady_clock::now();
+  beginTimerQuery(query.id);
+  _isQueryOpen = true;
+}
+
+void GpuTimer::endQuery() {
+  if (_isQueryOpen) {
+    endTimerQuery();
+    _isQueryOpen = false;
+  }
+}
+
+}  // namespace vigilante
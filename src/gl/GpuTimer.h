@@ -0,0 +1,102 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_GPU_TIMER_H_
+#define VIGILANTE_GPU_TIMER_H_
+
+#include <array>
+#include <chrono>
+#include <string>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// Measures how long the GPU spends on each render pass with timer queries
+// (GL_ARB_timer_query on desktop, GL_EXT_disjoint_timer_query on Android),
+// so that a GPU-bound frame can be told apart from a CPU-bound one.
+//
+// The results are read back a few frames later (the queries are kept in a
+// ring of _kNumFrames), so reading them never stalls the pipeline. If the
+// GPU falls further behind, the frames in between aren't timed.
+//
+// A timer query can't be nested in another one, so a pass which begins
+// within another one (e.g., the debug draw within the world) suspends it,
+// and the outer pass is resumed with another query once it ends.
+//
+// Without either extension (e.g., macOS, iOS), nothing is measured and
+// getTime() always returns -1.
+//
+// Only the frames drawn while it's enabled (e.g., while the PerformanceHud
+// is visible) or while a trace is being captured are timed. The passes
+// are added to the trace on their own track (see TraceProfiler::addGpuEvent()).
+//
+// All methods must be called on the main thread, which is also the GL thread.
+class GpuTimer final {
+ public:
+  enum Pass {
+    WORLD,
+    HUD,
+    DEBUG_DRAW,
+    PASS_SIZE
+  };
+
+  static const std::array<std::string, Pass::PASS_SIZE> _kPassStr;
+
+  static GpuTimer* getInstance();
+
+  // Looks up the extension (once), and adds the nodes which begin and end
+  // the WORLD and HUD passes to `scene`. They're drawn by its default camera
+  // and the USER1 camera respectively, i.e., before and after everything else.
+  void setScene(cocos2d::Scene* scene);
+
+  bool isAvailable() const;
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+
+  // Must be called from the render commands, e.g., b2DebugRenderer::onDraw().
+  void begin(GpuTimer::Pass pass);
+  void end(GpuTimer::Pass pass);
+
+  // The milliseconds which the GPU spent on `pass` in the latest frame
+  // which has been read back, or -1 if it wasn't drawn (or measured).
+  float getTime(GpuTimer::Pass pass) const;
+
+ private:
+  struct Query final {
+    unsigned int id;
+    GpuTimer::Pass pass;
+    std::chrono::steady_clock::time_point beginTime;  // when it was issued
+  };
+
+  static const int _kNumFrames = 4;
+  static const int _kMaxQueriesPerFrame = 8;
+
+  struct Frame final {
+    std::array<GpuTimer::Query, _kMaxQueriesPerFrame> queries;
+    int numQueries;
+    bool isPending;  // issued, but not read back yet
+  };
+
+  GpuTimer();
+
+  // Called after each frame has been drawn (Director::EVENT_AFTER_DRAW).
+  void endFrame();
+  void readBack(GpuTimer::Frame& frame);
+  void beginQuery(GpuTimer::Pass pass);
+  void endQuery();
+
+  std::array<GpuTimer::Frame, _kNumFrames> _frames;
+  int _currentFrameIndex;
+  std::array<GpuTimer::Pass, Pass::PASS_SIZE> _passStack;  // the passes which have begun
+  int _passStackSize;
+  bool _isQueryOpen;
+  bool _isTimingFrame;
+
+  std::array<float, Pass::PASS_SIZE> _times;  // in milliseconds
+  bool _isAvailable;
+  bool _isInitialized;
+  bool _isEnabled;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_GPU_TIMER_H_
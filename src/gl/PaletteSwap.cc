@@ -0,0 +1,85 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "PaletteSwap.h"
+
+#include "gl/ShaderRegistry.h"
+#include "util/Logger.h"
+
+#define PALETTE_SIZE 256
+
+using std::string;
+using cocos2d::Director;
+using cocos2d::GLProgramState;
+using cocos2d::Texture2D;
+
+namespace vigilante {
+
+const char* PaletteSwap::_kShaderName = "vigilante_palette_swap";
+
+// The index is stored as (index / 255) in the red channel, so it has to be
+// remapped to the center of the corresponding texel of the palette.
+const char* PaletteSwap::_kFragmentShader = R"(
+#ifdef GL_ES
+precision lowp float;
+#endif
+
+varying vec4 v_fragmentColor;
+varying vec2 v_texCoord;
+uniform sampler2D u_palette;
+
+void main() {
+  vec4 indexed = texture2D(CC_Texture0, v_texCoord);
+  float u = (indexed.r * 255.0 + 0.5) / 256.0;
+  vec4 color = texture2D(u_palette, vec2(u, 0.5));
+  gl_FragColor = v_fragmentColor * vec4(color.rgb, color.a * indexed.a);
+}
+)";
+
+PaletteSwap* PaletteSwap::getInstance() {
+  static PaletteSwap instance;
+  return &instance;
+}
+
+PaletteSwap::PaletteSwap() : _shaderProgram(), _programStates() {
+  initShader();
+}
+
+PaletteSwap::~PaletteSwap() {
+  for (const auto& p : _programStates) {
+    p.second->release();
+  }
+}
+
+
+GLProgramState* PaletteSwap::getProgramState(const string& paletteFileName) {
+  auto it = _programStates.find(paletteFileName);
+  if (it != _programStates.end()) {
+    return it->second;
+  }
+
+  Texture2D* palette = Director::getInstance()->getTextureCache()->addImage(paletteFileName);
+  if (!palette) {
+    VGLOG(LOG_ERR, "Failed to load palette: %s", paletteFileName.c_str());
+    return nullptr;
+  }
+  if (palette->getPixelsWide() != PALETTE_SIZE) {
+    VGLOG(LOG_WARN, "Palette [%s] should be %dx1.", paletteFileName.c_str(), PALETTE_SIZE);
+  }
+  palette->setAliasTexParameters();  // the colors must not be interpolated
+
+  // GLProgramState::create() is used instead of getOrCreateWithGLProgram(),
+  // since each palette needs its own uniform value.
+  GLProgramState* programState = GLProgramState::create(_shaderProgram);
+  programState->setUniformTexture("u_palette", palette);
+  programState->retain();
+
+  _programStates.insert({paletteFileName, programState});
+  return programState;
+}
+
+
+void PaletteSwap::initShader() {
+  // Normally it has been warmed up in the LoadingScene already.
+  _shaderProgram = ShaderRegistry::getInstance()->getProgram(_kShaderName);
+}
+
+}  // namespace vigilante
@@ -0,0 +1,47 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_PALETTE_SWAP_H_
+#define VIGILANTE_PALETTE_SWAP_H_
+
+#include <string>
+#include <unordered_map>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// Palette-indexed sprites.
+//
+// Instead of the actual colors, the red channel of an indexed sprite's texture
+// holds the index (0~255) into a 256x1 palette texture, and the fragment shader
+// looks up the color from the palette. This way, the color variants of an enemy
+// (or an equipment) can share a single texture directory, and each variant
+// only costs a tiny palette texture.
+//
+// The GLProgramState of each palette is shared by all of the sprites using it,
+// so that they can still be drawn by the same batch node (see BatchNodeRegistry).
+class PaletteSwap final {
+ public:
+  static PaletteSwap* getInstance();
+
+  // Returns nullptr if the palette texture cannot be loaded.
+  cocos2d::GLProgramState* getProgramState(const std::string& paletteFileName);
+
+  // Compiled along with the other game programs by ShaderRegistry.
+  static const char* _kShaderName;
+  static const char* _kFragmentShader;
+
+ private:
+  PaletteSwap();
+  ~PaletteSwap();
+
+  void initShader();
+
+  cocos2d::GLProgram* _shaderProgram;
+
+  // palette file name -> GLProgramState (retained)
+  std::unordered_map<std::string, cocos2d::GLProgramState*> _programStates;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_PALETTE_SWAP_H_
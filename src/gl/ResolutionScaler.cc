@@ -0,0 +1,226 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ResolutionScaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Constants.h"
+#include "util/Logger.h"
+
+using cocos2d::Camera;
+using cocos2d::CameraBackgroundBrush;
+using cocos2d::CameraFlag;
+using cocos2d::Color4F;
+using cocos2d::Director;
+using cocos2d::Scene;
+using cocos2d::Size;
+using cocos2d::Sprite;
+using cocos2d::Vec3;
+using cocos2d::experimental::FrameBuffer;
+using cocos2d::experimental::RenderTarget;
+using cocos2d::experimental::RenderTargetDepthStencil;
+
+namespace vigilante {
+
+const float ResolutionScaler::_kDownscaleFrameTime = 1.0f / 55.0f;
+const float ResolutionScaler::_kUpscaleFrameTime = 1.0f / 58.0f;
+const float ResolutionScaler::_kMeasureInterval = 1.0f;
+const float ResolutionScaler::_kMinUpscaleDelay = 10.0f;
+const float ResolutionScaler::_kMaxUpscaleDelay = 120.0f;
+
+ResolutionScaler* ResolutionScaler::getInstance() {
+  static ResolutionScaler instance;
+  return &instance;
+}
+
+ResolutionScaler::ResolutionScaler()
+    : _scene(),
+      _worldCamera(),
+      _hudCamera(),
+      _blitCamera(),
+      _blitSprite(),
+      _frameBuffer(),
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID || CC_TARGET_PLATFORM == CC_PLATFORM_IOS
+      _mode(Mode::DYNAMIC),
+#else
+      _mode(Mode::NATIVE),
+#endif
+      _isHudNative(true),
+      _scale(),
+      _measuredTime(),
+      _numMeasuredFrames(),
+      _timeSinceRescale(),
+      _upscaleDelay(_kMinUpscaleDelay),
+      _hasJustUpscaled() {}
+
+ResolutionScaler::~ResolutionScaler() {
+  CC_SAFE_RELEASE(_frameBuffer);
+}
+
+void ResolutionScaler::setScene(Scene* scene, Camera* worldCamera, Camera* hudCamera) {
+  _scene = scene;
+  _worldCamera = worldCamera;
+  _hudCamera = hudCamera;
+
+  // The blit sprite is drawn by its own camera, after the world
+  // and before the HUD (unless the HUD is rendered offscreen as well).
+  const Size& winSize = Director::getInstance()->getWinSize();
+  _blitCamera = Camera::createOrthographic(winSize.width, winSize.height, 1, 1000);
+  _blitCamera->setCameraFlag(CameraFlag::USER2);
+  const Vec3& eyePos = _worldCamera->getPosition3D();
+  _blitCamera->setPosition3D(eyePos);
+  _blitCamera->lookAt(eyePos);
+  _blitCamera->setPosition(0, 0);
+  _scene->addChild(_blitCamera);
+
+  _blitSprite = Sprite::create();
+  _blitSprite->setAnchorPoint({0, 0});
+  _blitSprite->setVisible(false);
+  _blitSprite->setCameraMask(static_cast<uint16_t>(CameraFlag::USER2));
+  _scene->addChild(_blitSprite);
+
+  const Mode mode = _mode;
+  _mode = Mode::NATIVE;
+  setMode(mode);
+}
+
+void ResolutionScaler::update(float delta) {
+  if (_mode == Mode::DYNAMIC && _scene) {
+    updateDynamicScale(delta);
+  }
+}
+
+ResolutionScaler::Mode ResolutionScaler::getMode() const {
+  return _mode;
+}
+
+void ResolutionScaler::setMode(ResolutionScaler::Mode mode) {
+  _mode = mode;
+  _measuredTime = 0;
+  _numMeasuredFrames = 0;
+  _timeSinceRescale = 0;
+  _upscaleDelay = _kMinUpscaleDelay;
+  _hasJustUpscaled = false;
+
+  if (!_scene) {
+    return;  // applied in setScene()
+  }
+
+  switch (mode) {
+    case Mode::NATIVE:
+      setScale(0);
+      break;
+    case Mode::VIRTUAL:
+      setScale(1);
+      break;
+    case Mode::DYNAMIC:
+      setScale(getMaxScale());
+      break;
+  }
+}
+
+bool ResolutionScaler::isHudNative() const {
+  return _isHudNative;
+}
+
+void ResolutionScaler::setHudNative(bool isHudNative) {
+  _isHudNative = isHudNative;
+  if (_scene) {
+    const int scale = _scale;
+    setScale(0);
+    setScale(scale);
+  }
+}
+
+int ResolutionScaler::getScale() const {
+  return _scale;
+}
+
+
+int ResolutionScaler::getMaxScale() const {
+  const Size& frameSize = Director::getInstance()->getOpenGLView()->getFrameSize();
+  const int scale = static_cast<int>(std::min(frameSize.width / kVirtualWidth,
+                                              frameSize.height / kVirtualHeight));
+  return std::max(scale, 1);
+}
+
+void ResolutionScaler::setScale(int scale) {
+  if (scale == _scale && (scale == 0 || _frameBuffer)) {
+    return;
+  }
+
+  _worldCamera->setFrameBufferObject(nullptr);
+  _hudCamera->setFrameBufferObject(nullptr);
+  _blitSprite->setVisible(false);
+  CC_SAFE_RELEASE_NULL(_frameBuffer);
+  _scale = scale;
+
+  if (scale == 0) {
+    VGLOG(LOG_INFO, "Rendering at the native resolution");
+    return;
+  }
+
+  const int width = kVirtualWidth * scale;
+  const int height = kVirtualHeight * scale;
+  _frameBuffer = FrameBuffer::create(1, width, height);
+  if (!_frameBuffer) {
+    VGLOG(LOG_ERR, "Failed to create a %dx%d framebuffer, rendering at the native resolution",
+          width, height);
+    _scale = 0;
+    return;
+  }
+  _frameBuffer->retain();
+  _frameBuffer->attachRenderTarget(RenderTarget::create(width, height));
+  _frameBuffer->attachDepthStencilTarget(RenderTargetDepthStencil::create(width, height));
+  _frameBuffer->setClearColor(Color4F::BLACK);
+
+  _worldCamera->setFrameBufferObject(_frameBuffer);
+  if (!_isHudNative) {
+    _hudCamera->setFrameBufferObject(_frameBuffer);
+  }
+  _blitCamera->setDepth((_isHudNative) ? _hudCamera->getDepth() - 1 : _hudCamera->getDepth() + 1);
+
+  // The render target is upside down, and must not be interpolated.
+  const Size& winSize = Director::getInstance()->getWinSize();
+  _blitSprite->setTexture(_frameBuffer->getRenderTarget()->getTexture());
+  _blitSprite->setTextureRect({0, 0, static_cast<float>(width), static_cast<float>(height)});
+  _blitSprite->getTexture()->setAliasTexParameters();
+  _blitSprite->setFlippedY(true);
+  _blitSprite->setScale(winSize.width / _blitSprite->getContentSize().width,
+                        winSize.height / _blitSprite->getContentSize().height);
+  _blitSprite->setVisible(true);
+  VGLOG(LOG_INFO, "Rendering the world at %dx%d (%dx)", width, height, scale);
+}
+
+void ResolutionScaler::updateDynamicScale(float delta) {
+  _measuredTime += delta;
+  _numMeasuredFrames++;
+  _timeSinceRescale += delta;
+  if (_measuredTime < _kMeasureInterval) {
+    return;
+  }
+
+  const float averageFrameTime = _measuredTime / _numMeasuredFrames;
+  _measuredTime = 0;
+  _numMeasuredFrames = 0;
+
+  if (averageFrameTime > _kDownscaleFrameTime && _scale > 1) {
+    // If the last upscale didn't hold, wait longer before trying again.
+    if (_hasJustUpscaled) {
+      _upscaleDelay = std::min(_upscaleDelay * 2, _kMaxUpscaleDelay);
+    }
+    setScale(_scale - 1);
+    _timeSinceRescale = 0;
+    _hasJustUpscaled = false;
+  } else if (averageFrameTime < _kUpscaleFrameTime && _scale < getMaxScale() &&
+             _timeSinceRescale >= _upscaleDelay) {
+    setScale(_scale + 1);
+    _timeSinceRescale = 0;
+    _hasJustUpscaled = true;
+  } else if (_hasJustUpscaled && _timeSinceRescale >= _kMinUpscaleDelay) {
+    _hasJustUpscaled = false;
+    _upscaleDelay = _kMinUpscaleDelay;
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,84 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_RESOLUTION_SCALER_H_
+#define VIGILANTE_RESOLUTION_SCALER_H_
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// Renders the game world into an offscreen framebuffer at a multiple of the
+// virtual resolution (kVirtualWidth x kVirtualHeight), and then upscales it
+// to the window with nearest filtering in one blit. The art is pixel art
+// anyway, so the world looks the same, but the fill-rate cost no longer
+// grows with the size of the screen (e.g., 4K monitors, high-dpi phones).
+//
+// NATIVE:  the world is rendered straight to the window (no offscreen pass).
+// VIRTUAL: the world is rendered at the virtual resolution (1x).
+// DYNAMIC: the scale (1x ~ the window's scale) is lowered whenever the frames
+//          are too slow, and raised again after a while if they can keep up.
+//
+// The HUD camera is rendered at the native resolution by default, so that the
+// text stays sharp. Optionally, it can be rendered offscreen along with the world.
+//
+// All methods must be called on the main thread.
+class ResolutionScaler final {
+ public:
+  enum class Mode {
+    NATIVE,
+    VIRTUAL,
+    DYNAMIC
+  };
+
+  static ResolutionScaler* getInstance();
+
+  // The blit sprite and its camera are added to `scene`.
+  void setScene(cocos2d::Scene* scene, cocos2d::Camera* worldCamera, cocos2d::Camera* hudCamera);
+
+  // Measures the frame time in DYNAMIC mode. `delta` is the wall time of the last frame.
+  void update(float delta);
+
+  ResolutionScaler::Mode getMode() const;
+  void setMode(ResolutionScaler::Mode mode);
+  bool isHudNative() const;
+  void setHudNative(bool isHudNative);
+
+  // The current multiple of the virtual resolution, or 0 in NATIVE mode.
+  int getScale() const;
+
+ private:
+  ResolutionScaler();
+  ~ResolutionScaler();
+
+  // The largest scale which is still no larger than the window.
+  int getMaxScale() const;
+  void setScale(int scale);
+  void updateDynamicScale(float delta);
+
+  static const float _kDownscaleFrameTime;
+  static const float _kUpscaleFrameTime;
+  static const float _kMeasureInterval;
+  static const float _kMinUpscaleDelay;
+  static const float _kMaxUpscaleDelay;
+
+  cocos2d::Scene* _scene;
+  cocos2d::Camera* _worldCamera;
+  cocos2d::Camera* _hudCamera;
+  cocos2d::Camera* _blitCamera;
+  cocos2d::Sprite* _blitSprite;
+  cocos2d::experimental::FrameBuffer* _frameBuffer;  // retained
+
+  ResolutionScaler::Mode _mode;
+  bool _isHudNative;
+  int _scale;
+
+  // DYNAMIC mode.
+  float _measuredTime;
+  int _numMeasuredFrames;
+  float _timeSinceRescale;
+  float _upscaleDelay;  // doubled whenever an upscale didn't hold
+  bool _hasJustUpscaled;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_RESOLUTION_SCALER_H_
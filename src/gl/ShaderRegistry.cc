@@ -0,0 +1,379 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ShaderRegistry.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+#include <EGL/egl.h>
+#endif
+
+#include "gl/PaletteSwap.h"
+#include "util/Logger.h"
+#include "util/StringUtil.h"
+#include "util/ds/BinaryStream.h"
+
+#define SHADER_CACHE_MAGIC 0x48534756  // "VGSH"
+#define SHADER_CACHE_VERSION 1
+#define SHADER_CACHE_DIR "shader_cache/"
+
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+#define HAS_PROGRAM_BINARY 1
+#define PROGRAM_BINARY_LENGTH GL_PROGRAM_BINARY_LENGTH_OES
+#elif (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32) || (CC_TARGET_PLATFORM == CC_PLATFORM_LINUX)
+#define HAS_PROGRAM_BINARY 1
+#define PROGRAM_BINARY_LENGTH GL_PROGRAM_BINARY_LENGTH
+#else
+#define HAS_PROGRAM_BINARY 0
+#endif
+
+using std::ifstream;
+using std::ofstream;
+using std::string;
+using std::vector;
+using cocos2d::FileUtils;
+using cocos2d::GLProgram;
+using cocos2d::GLProgramCache;
+
+namespace vigilante {
+
+namespace {
+
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+PFNGLGETPROGRAMBINARYOESPROC getProgramBinaryOES;
+PFNGLPROGRAMBINARYOESPROC programBinaryOES;
+#endif
+
+bool initProgramBinaryFuncs() {
+#if HAS_PROGRAM_BINARY
+  GLint numFormats = 0;
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &numFormats);
+  if (numFormats > 0) {
+    getProgramBinaryOES = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(
+        eglGetProcAddress("glGetProgramBinaryOES"));
+    programBinaryOES = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(
+        eglGetProcAddress("glProgramBinaryOES"));
+  }
+  return numFormats > 0 && getProgramBinaryOES && programBinaryOES;
+#else
+  if (GLEW_ARB_get_program_binary) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  }
+  return numFormats > 0;
+#endif
+#else
+  return false;
+#endif
+}
+
+bool getProgramBinary(GLuint program, GLenum* format, string* binary) {
+#if HAS_PROGRAM_BINARY
+  GLint length = 0;
+  glGetProgramiv(program, PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return false;
+  }
+
+  binary->resize(length);
+  GLsizei actualLength = 0;
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+  getProgramBinaryOES(program, length, &actualLength, format, &(*binary)[0]);
+#else
+  glGetProgramBinary(program, length, &actualLength, format, &(*binary)[0]);
+#endif
+  binary->resize(actualLength);
+  return actualLength > 0;
+#else
+  return false;
+#endif
+}
+
+bool setProgramBinary(GLuint program, GLenum format, const string& binary) {
+#if HAS_PROGRAM_BINARY
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+  programBinaryOES(program, format, binary.data(), static_cast<GLint>(binary.size()));
+#else
+  glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+#endif
+  // The driver rejects the binaries of other drivers (or other versions).
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  return status == GL_TRUE;
+#else
+  return false;
+#endif
+}
+
+// FNV-1a, same as hashTag() in util/Logger.h, over both shaders.
+uint32_t hashSources(const char* vertexShader, const char* fragmentShader) {
+  uint32_t hash = 2166136261u;
+  for (const char* source : {vertexShader, "\n", fragmentShader}) {
+    for (const char* c = source; *c; c++) {
+      hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+  }
+  return hash;
+}
+
+// GLProgram can only be initialized from the sources, but its
+// attribute/uniform parsers are accessible to subclasses.
+class BinaryGLProgram : public GLProgram {
+ public:
+  static GLProgram* create(GLenum format, const string& binary) {
+    BinaryGLProgram* program = new (std::nothrow) BinaryGLProgram();
+    if (!program) {
+      return nullptr;
+    }
+
+    program->_program = glCreateProgram();
+    if (!setProgramBinary(program->_program, format, binary)) {
+      delete program;  // deletes _program as well
+      return nullptr;
+    }
+    program->parseVertexAttribs();
+    program->parseUniforms();
+    program->updateUniforms();
+    program->autorelease();
+    return program;
+  }
+};
+
+}  // namespace
+
+
+ShaderRegistry* ShaderRegistry::getInstance() {
+  static ShaderRegistry instance;
+  return &instance;
+}
+
+ShaderRegistry::ShaderRegistry()
+    : _isInitialized(),
+      _driverVersion(),
+      _cacheDir(),
+      _isProgramBinarySupported(),
+      _primingVbo() {}
+
+ShaderRegistry::~ShaderRegistry() {
+  if (_primingVbo) {
+    glDeleteBuffers(1, &_primingVbo);
+  }
+}
+
+void ShaderRegistry::warmUp(AssetLoader& loader) {
+  init();
+
+  for (const auto& source : getSources()) {
+    auto binaryFormat = std::make_shared<GLenum>();
+    auto binary = std::make_shared<string>();
+    loader.addTask([this, &source, binaryFormat, binary]() {
+      *binary = readCachedBinary(source, binaryFormat.get());
+    }, [this, &source, binaryFormat, binary]() {
+      if (GLProgramCache::getInstance()->getGLProgram(source.name)) {
+        return;
+      }
+      if (GLProgram* program = link(source, *binaryFormat, *binary)) {
+        prime(program);
+        GLProgramCache::getInstance()->addGLProgram(program, source.name);
+      }
+    });
+  }
+
+  loader.addTask([]() {}, [this]() {
+    for (const auto name : getBuiltinProgramNames()) {
+      prime(GLProgramCache::getInstance()->getGLProgram(name));
+    }
+  });
+}
+
+GLProgram* ShaderRegistry::getProgram(const string& name) {
+  GLProgramCache* programCache = GLProgramCache::getInstance();
+  if (GLProgram* program = programCache->getGLProgram(name)) {
+    return program;
+  }
+
+  const Source* source = getSource(name);
+  if (!source) {
+    VGLOG(LOG_ERR, "Unknown GL program: %s", name.c_str());
+    return nullptr;
+  }
+
+  VGLOG(LOG_WARN, "GL program [%s] hasn't been warmed up", name.c_str());
+  init();
+  GLenum binaryFormat = 0;
+  const string binary = readCachedBinary(*source, &binaryFormat);
+  GLProgram* program = link(*source, binaryFormat, binary);
+  if (program) {
+    programCache->addGLProgram(program, name);
+  }
+  return program;
+}
+
+
+const vector<ShaderRegistry::Source>& ShaderRegistry::getSources() {
+  static const vector<Source> sources = {
+    {PaletteSwap::_kShaderName, cocos2d::ccPositionTextureColor_vert, PaletteSwap::_kFragmentShader},
+  };
+  return sources;
+}
+
+const vector<const char*>& ShaderRegistry::getBuiltinProgramNames() {
+  static const vector<const char*> names = {
+    GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP,  // sprites
+    GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR,  // sprites outside of batch nodes
+    GLProgram::SHADER_NAME_POSITION_COLOR,  // GLESDebugDraw
+    GLProgram::SHADER_NAME_POSITION_LENGTH_TEXTURE_COLOR,  // DrawNode
+    GLProgram::SHADER_NAME_LABEL_NORMAL,
+    GLProgram::SHADER_NAME_LABEL_OUTLINE,
+  };
+  return names;
+}
+
+void ShaderRegistry::init() {
+  if (_isInitialized) {
+    return;
+  }
+  _isInitialized = true;
+
+  _driverVersion = string_util::format("%s|%s|%s",
+                                       reinterpret_cast<const char*>(glGetString(GL_VENDOR)),
+                                       reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+                                       reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+  _cacheDir = FileUtils::getInstance()->getWritablePath() + SHADER_CACHE_DIR;
+  _isProgramBinarySupported = initProgramBinaryFuncs();
+  VGLOG(LOG_INFO, "GL driver: %s (program binaries %s)", _driverVersion.c_str(),
+        (_isProgramBinarySupported) ? "supported" : "unsupported");
+
+  // A degenerate triangle, so nothing is actually drawn.
+  const GLfloat vertices[9] = {};
+  glGenBuffers(1, &_primingVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, _primingVbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+const ShaderRegistry::Source* ShaderRegistry::getSource(const string& name) const {
+  for (const auto& source : getSources()) {
+    if (name == source.name) {
+      return &source;
+    }
+  }
+  return nullptr;
+}
+
+GLProgram* ShaderRegistry::link(const ShaderRegistry::Source& source,
+                                GLenum binaryFormat, const string& binary) {
+  if (!binary.empty()) {
+    if (GLProgram* program = BinaryGLProgram::create(binaryFormat, binary)) {
+      return program;
+    }
+    VGLOG(LOG_WARN, "Rejected cached GL program binary: %s", source.name);
+  }
+
+  GLProgram* program = new (std::nothrow) GLProgram();
+  if (!program || !program->initWithByteArrays(source.vertexShader, source.fragmentShader)) {
+    VGLOG(LOG_ERR, "Failed to compile GL program: %s", source.name);
+    CC_SAFE_DELETE(program);
+    return nullptr;
+  }
+
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32) || (CC_TARGET_PLATFORM == CC_PLATFORM_LINUX)
+  if (_isProgramBinarySupported) {
+    glProgramParameteri(program->getProgram(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+#endif
+  if (!program->link()) {
+    VGLOG(LOG_ERR, "Failed to link GL program: %s", source.name);
+    delete program;
+    return nullptr;
+  }
+  program->updateUniforms();
+  program->autorelease();
+
+  saveBinary(source, program);
+  return program;
+}
+
+void ShaderRegistry::prime(GLProgram* program) {
+  if (!program) {
+    return;
+  }
+
+  program->use();
+  program->setUniformsForBuiltins();
+  glBindBuffer(GL_ARRAY_BUFFER, _primingVbo);
+  cocos2d::GL::enableVertexAttribs(cocos2d::GL::VERTEX_ATTRIB_FLAG_POSITION);
+  glVertexAttribPointer(GLProgram::VERTEX_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  CHECK_GL_ERROR_DEBUG();
+}
+
+
+string ShaderRegistry::getCacheFileName(const ShaderRegistry::Source& source) const {
+  return _cacheDir + source.name + ".bin";
+}
+
+string ShaderRegistry::readCachedBinary(const ShaderRegistry::Source& source,
+                                        GLenum* binaryFormat) const {
+  if (!_isProgramBinarySupported) {
+    return "";
+  }
+
+  ifstream fin(getCacheFileName(source), std::ios::binary);
+  if (!fin.is_open()) {
+    return "";
+  }
+  const string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+  BinaryReader reader(content.data(), content.data() + content.size());
+  if (reader.read<uint32_t>() != SHADER_CACHE_MAGIC ||
+      reader.read<uint32_t>() != SHADER_CACHE_VERSION ||
+      reader.readString() != _driverVersion ||
+      reader.read<uint32_t>() != hashSources(source.vertexShader, source.fragmentShader)) {
+    return "";
+  }
+  *binaryFormat = reader.read<uint32_t>();
+  string binary = reader.readString();
+  return (reader.isOk()) ? binary : "";
+}
+
+void ShaderRegistry::saveBinary(const ShaderRegistry::Source& source, GLProgram* program) const {
+  GLenum binaryFormat = 0;
+  string binary;
+  if (!_isProgramBinarySupported ||
+      !getProgramBinary(program->getProgram(), &binaryFormat, &binary)) {
+    return;
+  }
+
+  BinaryWriter writer;
+  writer.write<uint32_t>(SHADER_CACHE_MAGIC);
+  writer.write<uint32_t>(SHADER_CACHE_VERSION);
+  writer.writeString(_driverVersion);
+  writer.write<uint32_t>(hashSources(source.vertexShader, source.fragmentShader));
+  writer.write<uint32_t>(binaryFormat);
+  writer.writeString(binary);
+
+  // Written to a temporary file first, so that a crash
+  // never leaves a truncated cache file behind.
+  const string cacheFileName = getCacheFileName(source);
+  const string tmpFileName = cacheFileName + ".tmp";
+  FileUtils::getInstance()->createDirectory(_cacheDir);
+
+  ofstream fout(tmpFileName, std::ios::binary | std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_WARN, "Unable to write GL program binary: %s", cacheFileName.c_str());
+    return;
+  }
+  fout.write(writer.getBuffer().data(), writer.getBuffer().size());
+  fout.close();
+
+  if (std::rename(tmpFileName.c_str(), cacheFileName.c_str()) != 0) {
+    std::remove(tmpFileName.c_str());
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,85 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_SHADER_REGISTRY_H_
+#define VIGILANTE_SHADER_REGISTRY_H_
+
+#include <string>
+#include <vector>
+
+#include <cocos2d.h>
+#include "AssetLoader.h"
+
+namespace vigilante {
+
+// Compiles and links all of the game's GL programs during the loading stage,
+// so that the driver doesn't have to do it in the middle of a frame the first
+// time a program is used (e.g., when the first palette-swapped enemy appears).
+//
+// Where the driver supports program binaries (GL_OES_get_program_binary on
+// Android, GL_ARB_get_program_binary on Windows/Linux), the linked programs
+// are saved to <writable path>/shader_cache/, keyed by the driver's vendor,
+// renderer and version strings along with a hash of the sources, and they're
+// loaded from there on later launches instead of being compiled again.
+// A cache file which doesn't match the current driver is simply recompiled.
+//
+// The builtin programs of cocos2d-x used by the game (e.g., the one used by
+// GLESDebugDraw) are compiled by GLProgramCache itself, so they're only
+// primed, i.e., drawn once with a degenerate triangle, since some drivers
+// defer part of the compilation until the first draw call.
+//
+// All methods must be called on the main thread.
+class ShaderRegistry final {
+ public:
+  static ShaderRegistry* getInstance();
+
+  // Adds the tasks which warm up all of the programs to `loader`:
+  // the cache files are read on the worker threads, and the programs
+  // are linked and primed on the main thread.
+  void warmUp(AssetLoader& loader);
+
+  // Returns the game program named `name`, which is linked right
+  // away if it hasn't been warmed up yet, or nullptr if it's unknown.
+  cocos2d::GLProgram* getProgram(const std::string& name);
+
+ private:
+  struct Source final {
+    const char* name;
+    const char* vertexShader;
+    const char* fragmentShader;
+  };
+
+  ShaderRegistry();
+  ~ShaderRegistry();
+
+  // The sources of the game programs, and the names of the builtin ones.
+  // (Functions rather than static tables, since they refer to the
+  // static strings of other translation units.)
+  static const std::vector<ShaderRegistry::Source>& getSources();
+  static const std::vector<const char*>& getBuiltinProgramNames();
+
+  // Queries the driver and creates the priming vbo, if not yet done.
+  void init();
+  const ShaderRegistry::Source* getSource(const std::string& name) const;
+
+  // Links the game program from `binary` if possible, or from its sources
+  // otherwise (in which case the binary is saved for the next launch).
+  cocos2d::GLProgram* link(const ShaderRegistry::Source& source,
+                           GLenum binaryFormat, const std::string& binary);
+  void prime(cocos2d::GLProgram* program);
+
+  std::string getCacheFileName(const ShaderRegistry::Source& source) const;
+  // Returns an empty string if there's no valid cache file.
+  // This may be called on any thread.
+  std::string readCachedBinary(const ShaderRegistry::Source& source, GLenum* binaryFormat) const;
+  void saveBinary(const ShaderRegistry::Source& source, cocos2d::GLProgram* program) const;
+
+  bool _isInitialized;
+  // GL_VENDOR, GL_RENDERER and GL_VERSION.
+  std::string _driverVersion;
+  std::string _cacheDir;
+  bool _isProgramBinarySupported;
+  GLuint _primingVbo;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_SHADER_REGISTRY_H_
@@ -1,13 +1,47 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "HotkeyManager.h"
 
-#include "input/InputManager.h"
+#include <cstdint>
+
 #include "ui/pause_menu/PauseMenuDialog.h"
+#include "util/KeyCodeUtil.h"
 #include "util/Logger.h"
 
 using std::array;
 using cocos2d::Event;
 using cocos2d::EventKeyboard;
+using vigilante::HotkeyManager;
+
+namespace {
+
+// The slots of the key codes (HotkeyManager::BindableKeys), or
+// BindableKeys::SIZE for the keys which aren't bindable.
+struct BindableKeyTable final {
+  uint8_t bindableKeys[vigilante::keycode_util::kNumKeyCodes];
+};
+
+constexpr void setBindableKey(BindableKeyTable& table, EventKeyboard::KeyCode keyCode,
+                              HotkeyManager::BindableKeys bindableKey) {
+  table.bindableKeys[vigilante::keycode_util::toIndex(keyCode)] = bindableKey;
+}
+
+constexpr BindableKeyTable makeBindableKeyTable() {
+  BindableKeyTable table{};
+  for (auto& bindableKey : table.bindableKeys) {
+    bindableKey = HotkeyManager::BindableKeys::SIZE;
+  }
+  setBindableKey(table, EventKeyboard::KeyCode::KEY_LEFT_SHIFT, HotkeyManager::BindableKeys::LEFT_SHIFT);
+  setBindableKey(table, EventKeyboard::KeyCode::KEY_LEFT_CTRL, HotkeyManager::BindableKeys::LEFT_CTRL);
+  setBindableKey(table, EventKeyboard::KeyCode::KEY_X, HotkeyManager::BindableKeys::X);
+  setBindableKey(table, EventKeyboard::KeyCode::KEY_C, HotkeyManager::BindableKeys::C);
+  setBindableKey(table, EventKeyboard::KeyCode::KEY_V, HotkeyManager::BindableKeys::V);
+  return table;
+}
+
+constexpr BindableKeyTable kBindableKeyTable = makeBindableKeyTable();
+
+}  // namespace
+
 
 namespace vigilante {
 
@@ -24,48 +58,42 @@ HotkeyManager* HotkeyManager::getInstance() {
   return &instance;
 }
 
-HotkeyManager::HotkeyManager() : _hotkeys() {}
+HotkeyManager::HotkeyManager() : _hotkeys(), _boundKeys() {}
 
 
 Keybindable* HotkeyManager::getHotkeyAction(EventKeyboard::KeyCode keyCode) const {
-  for (size_t i = 0; i < _kBindableKeys.size(); i++) {
-    if (keyCode == _kBindableKeys[i]) {
-      return _hotkeys[i];
-    }
-  }
-  return nullptr;
+  const BindableKeys bindableKey = getBindableKey(keyCode);
+  return (bindableKey != BindableKeys::SIZE) ? _hotkeys[bindableKey] : nullptr;
 }
 
 void HotkeyManager::setHotkeyAction(EventKeyboard::KeyCode keyCode, Keybindable* keybindable) {
-  for (size_t i = 0; i < _kBindableKeys.size(); i++) {
-    if (keyCode == _kBindableKeys[i]) {
-      clearHotkeyAction(keybindable->getHotkey());
-      if (_hotkeys[i]) {
-        clearHotkeyAction(_hotkeys[i]->getHotkey());
-      }
-
-      _hotkeys[i] = keybindable;
-      keybindable->setHotkey(keyCode);
-      return;
-    }
+  const BindableKeys bindableKey = getBindableKey(keyCode);
+  if (bindableKey == BindableKeys::SIZE) {
+    return;
+  }
+
+  clearHotkeyAction(keybindable->getHotkey());
+  if (_hotkeys[bindableKey]) {
+    clearHotkeyAction(_hotkeys[bindableKey]->getHotkey());
   }
+
+  _hotkeys[bindableKey] = keybindable;
+  _boundKeys.set(keycode_util::toIndex(keyCode));
+  keybindable->setHotkey(keyCode);
 }
 
 void HotkeyManager::clearHotkeyAction(EventKeyboard::KeyCode keyCode) {
-  // If keyCode == KeyCode::KEY_NONE, return at once.
-  if (!static_cast<bool>(keyCode)) {
+  // KeyCode::KEY_NONE isn't bindable, so this returns at once.
+  const BindableKeys bindableKey = getBindableKey(keyCode);
+  if (bindableKey == BindableKeys::SIZE) {
     return;
   }
 
-  for (size_t i = 0; i < _kBindableKeys.size(); i++) {
-    if (keyCode == _kBindableKeys[i]) {
-      if (_hotkeys[i]) {
-        _hotkeys[i]->setHotkey(EventKeyboard::KeyCode::KEY_NONE);
-      }
-      _hotkeys[i] = nullptr;
-      return;
-    }
+  if (_hotkeys[bindableKey]) {
+    _hotkeys[bindableKey]->setHotkey(EventKeyboard::KeyCode::KEY_NONE);
   }
+  _hotkeys[bindableKey] = nullptr;
+  _boundKeys.reset(keycode_util::toIndex(keyCode));
 }
 
 void HotkeyManager::promptHotkey(Keybindable* keybindable, PauseMenuDialog* pauseMenuDialog) {
@@ -81,4 +109,14 @@ void HotkeyManager::promptHotkey(Keybindable* keybindable, PauseMenuDialog* paus
   InputManager::getInstance()->setSpecialOnKeyPressed(onKeyPressedEvLstnr);
 }
 
+const InputManager::KeySet& HotkeyManager::getBoundKeys() const {
+  return _boundKeys;
+}
+
+HotkeyManager::BindableKeys HotkeyManager::getBindableKey(EventKeyboard::KeyCode keyCode) {
+  const size_t i = keycode_util::toIndex(keyCode);
+  return (i < keycode_util::kNumKeyCodes) ?
+    static_cast<BindableKeys>(kBindableKeyTable.bindableKeys[i]) : BindableKeys::SIZE;
+}
+
 } // namespace vigilante
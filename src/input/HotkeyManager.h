@@ -6,12 +6,17 @@
 #include <functional>
 
 #include <cocos2d.h>
+#include "input/InputManager.h"
 #include "input/Keybindable.h"
 
 namespace vigilante {
 
 class PauseMenuDialog;
 
+// Binds Keybindables (skills and consumables) to the bindable keys.
+// The key codes are mapped to their slots with a table built at compile time,
+// and the keys which currently have an action are kept in a KeySet, so that
+// Player::handleInput() only has to visit the bound keys pressed this frame.
 class HotkeyManager {
  public:
   static HotkeyManager* getInstance();
@@ -33,10 +38,17 @@ class HotkeyManager {
   void clearHotkeyAction(cocos2d::EventKeyboard::KeyCode keyCode);
   void promptHotkey(Keybindable* keybindable, PauseMenuDialog* pauseMenuDialog);
 
+  // The keys which currently have a hotkey action.
+  const InputManager::KeySet& getBoundKeys() const;
+
  private:
   HotkeyManager();
 
+  // Returns BindableKeys::SIZE if `keyCode` isn't bindable.
+  static HotkeyManager::BindableKeys getBindableKey(cocos2d::EventKeyboard::KeyCode keyCode);
+
   std::array<Keybindable*, BindableKeys::SIZE> _hotkeys;
+  InputManager::KeySet _boundKeys;
 };
 
 } // namespace vigilante
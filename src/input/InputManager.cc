@@ -1,14 +1,26 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "input/InputManager.h"
 
+#include <fstream>
+
 #include "ui/TextField.h"
 #include "util/Logger.h"
 
-using std::set;
+#define REPLAY_FILE_MAGIC "vigilante-replay"
+#define REPLAY_FILE_VERSION 1
+
+#define ACTION_BUFFER_SIZE 32
+#define GAMEPAD_STICK_DEAD_ZONE .5f
+
+using std::string;
+using std::ifstream;
+using std::ofstream;
 using cocos2d::Scene;
 using cocos2d::Event;
 using cocos2d::EventKeyboard;
 using cocos2d::EventListenerKeyboard;
+using cocos2d::Controller;
+using cocos2d::EventListenerController;
 
 namespace vigilante {
 
@@ -20,9 +32,33 @@ InputManager* InputManager::getInstance() {
 InputManager::InputManager()
     : _scene(),
       _keyboardEvLstnr(),
+      _controllerEvLstnr(),
       _isCapsLocked(),
-      _pressedKeys(),
-      _specialOnKeyPressed() {}
+      _heldKeys(),
+      _keysPressedSinceSnapshot(),
+      _currentKeys(),
+      _previousKeys(),
+      _heldButtons(),
+      _buttonsPressedSinceSnapshot(),
+      _currentButtons(),
+      _leftStickX(),
+      _actionBindings(),
+      _currentActions(),
+      _previousActions(),
+      _actionBuffer(),
+      _frame(),
+      _specialOnKeyPressed(),
+      _replayMode(ReplayMode::NONE),
+      _replayHeader(),
+      _replayFileName(),
+      _isReplayRunning(),
+      _replayFrame(),
+      _numReplayFrames(),
+      _replayEventIndex(),
+      _replayEvents(),
+      _pendingKeyEvents() {
+  setDefaultActionBindings();
+}
 
 
 bool InputManager::isActivated() const {
@@ -35,31 +71,69 @@ void InputManager::activate(Scene* scene) {
 
   // Capture "this" by value.
   _keyboardEvLstnr->onKeyPressed = [this](EventKeyboard::KeyCode keyCode, Event* e) {
-    if (keyCode == EventKeyboard::KeyCode::KEY_CAPS_LOCK) {
-      _isCapsLocked = !_isCapsLocked;
-    }
-
-    if (!_specialOnKeyPressed) {
-      // We keep track of which keys have been pressed
-      // only when there is no active _specialOnKeyPressed event listener,
-      // because _specialOnKeyPressed will do whatever it needs to do
-      // with these keys.
-      _pressedKeys.insert(keyCode);
-    } else {
-      // Execute the additional onKeyPressed handler for special events.
-      // (e.g., prompting for a hotkey, receiving TextField input, etc)
-      _specialOnKeyPressed(keyCode, e);
+    switch (_replayMode) {
+      case ReplayMode::NONE:
+        onKeyPressed(keyCode, e);
+        break;
+      case ReplayMode::RECORDING:
+        if (_isReplayRunning) {
+          _pendingKeyEvents.push_back({_replayFrame, keyCode, true});
+        }
+        break;
+      case ReplayMode::PLAYBACK:
+      default:
+        break;
     }
   };
 
   _keyboardEvLstnr->onKeyReleased = [this](EventKeyboard::KeyCode keyCode, Event*) {
-    _pressedKeys.erase(keyCode);
+    switch (_replayMode) {
+      case ReplayMode::NONE:
+        onKeyReleased(keyCode);
+        break;
+      case ReplayMode::RECORDING:
+        if (_isReplayRunning) {
+          _pendingKeyEvents.push_back({_replayFrame, keyCode, false});
+        }
+        break;
+      case ReplayMode::PLAYBACK:
+      default:
+        break;
+    }
   };
-  
+
   _scene->getEventDispatcher()->addEventListenerWithSceneGraphPriority(_keyboardEvLstnr, scene);
+
+  // The gamepad isn't recorded in replays, so it's ignored while
+  // a replay is in progress.
+  _controllerEvLstnr = EventListenerController::create();
+
+  _controllerEvLstnr->onKeyDown = [this](Controller*, int keyCode, Event*) {
+    if (_replayMode == ReplayMode::NONE) {
+      onButtonPressed(keyCode);
+    }
+  };
+
+  _controllerEvLstnr->onKeyUp = [this](Controller*, int keyCode, Event*) {
+    if (_replayMode == ReplayMode::NONE) {
+      onButtonReleased(keyCode);
+    }
+  };
+
+  _controllerEvLstnr->onAxisEvent = [this](Controller* controller, int keyCode, Event*) {
+    if (_replayMode == ReplayMode::NONE) {
+      onAxisChanged(keyCode, controller->getKeyStatus(keyCode).value);
+    }
+  };
+
+  _scene->getEventDispatcher()->addEventListenerWithSceneGraphPriority(_controllerEvLstnr, scene);
+  Controller::startDiscoveryController();
 }
 
 void InputManager::deactivate() {
+  Controller::stopDiscoveryController();
+  _scene->getEventDispatcher()->removeEventListener(_controllerEvLstnr);
+  _controllerEvLstnr = nullptr;
   _scene->getEventDispatcher()->removeEventListener(_keyboardEvLstnr);
   _keyboardEvLstnr = nullptr;
   _scene = nullptr;
@@ -67,12 +141,27 @@ void InputManager::deactivate() {
 
 
 bool InputManager::isKeyPressed(EventKeyboard::KeyCode keyCode) const {
-  return _pressedKeys.find(keyCode) != _pressedKeys.end();
+  return isValidKeyCode(keyCode) && _currentKeys.test(static_cast<size_t>(keyCode));
+}
+
+bool InputManager::isKeyJustPressed(EventKeyboard::KeyCode keyCode) const {
+  if (!isValidKeyCode(keyCode)) {
+    return false;
+  }
+  const size_t i = static_cast<size_t>(keyCode);
+  return _currentKeys.test(i) && !_previousKeys.test(i);
+}
+
+InputManager::KeySet InputManager::getKeysJustPressed() const {
+  return _currentKeys & ~_previousKeys;
 }
 
-bool InputManager::isKeyJustPressed(EventKeyboard::KeyCode keyCode) {
-  // std::set::erase() returns the number of elements erased.
-  return _pressedKeys.erase(keyCode) > 0;
+bool InputManager::isKeyJustReleased(EventKeyboard::KeyCode keyCode) const {
+  if (!isValidKeyCode(keyCode)) {
+    return false;
+  }
+  const size_t i = static_cast<size_t>(keyCode);
+  return !_currentKeys.test(i) && _previousKeys.test(i);
 }
 
 
@@ -85,6 +174,78 @@ bool InputManager::isShiftPressed() const {
 }
 
 
+bool InputManager::isActionPressed(InputManager::Action action) const {
+  return _currentActions.test(static_cast<size_t>(action));
+}
+
+bool InputManager::isActionJustPressed(InputManager::Action action) const {
+  const size_t i = static_cast<size_t>(action);
+  return _currentActions.test(i) && !_previousActions.test(i);
+}
+
+bool InputManager::isActionJustReleased(InputManager::Action action) const {
+  const size_t i = static_cast<size_t>(action);
+  return !_currentActions.test(i) && _previousActions.test(i);
+}
+
+bool InputManager::consumeBufferedAction(InputManager::Action action, uint64_t maxAge) {
+  const uint64_t minFrame = (_frame > maxAge) ? _frame - maxAge : 0;
+  return _actionBuffer.consume(action, minFrame);
+}
+
+void InputManager::clearBufferedActions() {
+  _actionBuffer.clear();
+}
+
+void InputManager::bindKey(InputManager::Action action, EventKeyboard::KeyCode keyCode) {
+  _actionBindings[static_cast<size_t>(action)].keyCodes.push_back(keyCode);
+}
+
+void InputManager::bindButton(InputManager::Action action, Controller::Key button) {
+  _actionBindings[static_cast<size_t>(action)].buttons.push_back(button);
+}
+
+void InputManager::clearBindings(InputManager::Action action) {
+  _actionBindings[static_cast<size_t>(action)] = ActionBinding{};
+}
+
+void InputManager::setDefaultActionBindings() {
+  for (size_t i = 0; i < _actionBindings.size(); i++) {
+    clearBindings(static_cast<Action>(i));
+  }
+
+  bindKey(Action::MOVE_LEFT, EventKeyboard::KeyCode::KEY_LEFT_ARROW);
+  bindButton(Action::MOVE_LEFT, Controller::Key::BUTTON_DPAD_LEFT);
+  _actionBindings[static_cast<size_t>(Action::MOVE_LEFT)].leftStickDirection = -1;
+
+  bindKey(Action::MOVE_RIGHT, EventKeyboard::KeyCode::KEY_RIGHT_ARROW);
+  bindButton(Action::MOVE_RIGHT, Controller::Key::BUTTON_DPAD_RIGHT);
+  _actionBindings[static_cast<size_t>(Action::MOVE_RIGHT)].leftStickDirection = 1;
+
+  bindKey(Action::CROUCH, EventKeyboard::KeyCode::KEY_DOWN_ARROW);
+  bindButton(Action::CROUCH, Controller::Key::BUTTON_DPAD_DOWN);
+
+  bindKey(Action::JUMP, EventKeyboard::KeyCode::KEY_ALT);
+  bindKey(Action::JUMP, EventKeyboard::KeyCode::KEY_LEFT_ALT);
+  bindButton(Action::JUMP, Controller::Key::BUTTON_A);
+
+  bindKey(Action::ATTACK, EventKeyboard::KeyCode::KEY_LEFT_CTRL);
+  bindButton(Action::ATTACK, Controller::Key::BUTTON_X);
+
+  bindKey(Action::INTERACT, EventKeyboard::KeyCode::KEY_E);
+  bindButton(Action::INTERACT, Controller::Key::BUTTON_B);
+
+  bindKey(Action::ENTER_PORTAL, EventKeyboard::KeyCode::KEY_UP_ARROW);
+  bindButton(Action::ENTER_PORTAL, Controller::Key::BUTTON_DPAD_UP);
+
+  bindKey(Action::PICK_UP_ITEM, EventKeyboard::KeyCode::KEY_Z);
+  bindButton(Action::PICK_UP_ITEM, Controller::Key::BUTTON_Y);
+
+  bindKey(Action::SHEATHE_WEAPON, EventKeyboard::KeyCode::KEY_R);
+  bindButton(Action::SHEATHE_WEAPON, Controller::Key::BUTTON_RIGHT_SHOULDER);
+}
+
+
 bool InputManager::hasSpecialOnKeyPressed() const {
   return static_cast<bool>(_specialOnKeyPressed);
 }
@@ -97,4 +258,308 @@ void InputManager::clearSpecialOnKeyPressed() {
   _specialOnKeyPressed = nullptr;
 }
 
+
+bool InputManager::startRecording(const string& fileName, const InputManager::ReplayHeader& header) {
+  if (_replayMode != ReplayMode::NONE) {
+    VGLOG(LOG_ERR, "Unable to start recording: a replay is in progress.");
+    return false;
+  }
+
+  // Make sure the file is writable before the session begins,
+  // rather than finding it out after the session has been recorded.
+  if (!ofstream(fileName)) {
+    VGLOG(LOG_ERR, "Unable to open replay file: %s", fileName.c_str());
+    return false;
+  }
+
+  _replayMode = ReplayMode::RECORDING;
+  _replayHeader = header;
+  _replayFileName = fileName;
+  _isReplayRunning = false;
+  _replayEvents.clear();
+  _pendingKeyEvents.clear();
+  return true;
+}
+
+bool InputManager::startPlayback(const string& fileName, InputManager::ReplayHeader* header) {
+  if (_replayMode != ReplayMode::NONE) {
+    VGLOG(LOG_ERR, "Unable to start playback: a replay is in progress.");
+    return false;
+  }
+
+  ifstream fin(fileName);
+  if (!fin) {
+    VGLOG(LOG_ERR, "Unable to open replay file: %s", fileName.c_str());
+    return false;
+  }
+
+  string magic;
+  int version = 0;
+  string seedTag;
+  string mapTag;
+  string playerTag;
+  ReplayHeader replayHeader{};
+  fin >> magic >> version
+      >> seedTag >> replayHeader.seed
+      >> mapTag >> replayHeader.tmxMapFileName
+      >> playerTag >> replayHeader.playerX >> replayHeader.playerY;
+
+  if (!fin || magic != REPLAY_FILE_MAGIC || version != REPLAY_FILE_VERSION ||
+      seedTag != "seed" || mapTag != "map" || playerTag != "player") {
+    VGLOG(LOG_ERR, "Invalid replay file: %s", fileName.c_str());
+    return false;
+  }
+
+  // Each of the following lines is either a key event
+  // "<frame> <+|-> <keyCode>", or "end <numFrames>".
+  _replayEvents.clear();
+  _numReplayFrames = 0;
+  string token;
+  while (fin >> token) {
+    if (token == "end") {
+      fin >> _numReplayFrames;
+      break;
+    }
+
+    KeyEvent keyEvent{};
+    string action;
+    int keyCode = 0;
+    keyEvent.frame = std::stoull(token);
+    fin >> action >> keyCode;
+    keyEvent.keyCode = static_cast<EventKeyboard::KeyCode>(keyCode);
+    keyEvent.isPressed = action == "+";
+    _replayEvents.push_back(keyEvent);
+  }
+
+  if (!fin) {
+    VGLOG(LOG_ERR, "Truncated replay file: %s", fileName.c_str());
+    _replayEvents.clear();
+    return false;
+  }
+
+  _replayMode = ReplayMode::PLAYBACK;
+  _replayHeader = replayHeader;
+  _replayFileName = fileName;
+  _isReplayRunning = false;
+  _replayEventIndex = 0;
+  _pendingKeyEvents.clear();
+
+  if (header) {
+    *header = replayHeader;
+  }
+  return true;
+}
+
+void InputManager::beginReplay() {
+  if (_replayMode == ReplayMode::NONE) {
+    return;
+  }
+
+  resetInputState();
+  _pendingKeyEvents.clear();
+  _isReplayRunning = true;
+  _replayFrame = 0;
+  _replayEventIndex = 0;
+}
+
+bool InputManager::stopReplay() {
+  const ReplayMode replayMode = _replayMode;
+  _replayMode = ReplayMode::NONE;
+  _isReplayRunning = false;
+  resetInputState();
+  _pendingKeyEvents.clear();
+
+  if (replayMode != ReplayMode::RECORDING) {
+    _replayEvents.clear();
+    return true;
+  }
+
+  ofstream fout(_replayFileName);
+  fout << REPLAY_FILE_MAGIC << ' ' << REPLAY_FILE_VERSION << '\n'
+       << "seed " << _replayHeader.seed << '\n'
+       << "map " << _replayHeader.tmxMapFileName << '\n'
+       << "player " << _replayHeader.playerX << ' ' << _replayHeader.playerY << '\n';
+
+  for (const auto& keyEvent : _replayEvents) {
+    fout << keyEvent.frame << ' ' << ((keyEvent.isPressed) ? '+' : '-') << ' '
+         << static_cast<int>(keyEvent.keyCode) << '\n';
+  }
+  fout << "end " << _replayFrame << '\n';
+  _replayEvents.clear();
+
+  if (!fout) {
+    VGLOG(LOG_ERR, "Unable to write replay file: %s", _replayFileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+void InputManager::beginFrame() {
+  _frame++;
+
+  if (_isReplayRunning) {
+    applyReplayEvents();
+  }
+
+  _previousKeys = _currentKeys;
+  _currentKeys = _heldKeys | _keysPressedSinceSnapshot;
+  _keysPressedSinceSnapshot.reset();
+
+  _currentButtons = _heldButtons | _buttonsPressedSinceSnapshot;
+  _buttonsPressedSinceSnapshot.reset();
+
+  _previousActions = _currentActions;
+  for (size_t i = 0; i < _actionBindings.size(); i++) {
+    _currentActions.set(i, isBindingActive(_actionBindings[i]));
+    if (_currentActions.test(i) && !_previousActions.test(i)) {
+      _actionBuffer.push({_frame, static_cast<Action>(i), false});
+    }
+  }
+}
+
+void InputManager::applyReplayEvents() {
+  if (_replayMode == ReplayMode::RECORDING) {
+    for (auto& keyEvent : _pendingKeyEvents) {
+      keyEvent.frame = _replayFrame;
+      _replayEvents.push_back(keyEvent);
+    }
+  } else {
+    while (_replayEventIndex < _replayEvents.size() &&
+           _replayEvents[_replayEventIndex].frame == _replayFrame) {
+      _pendingKeyEvents.push_back(_replayEvents[_replayEventIndex++]);
+    }
+  }
+
+  for (const auto& keyEvent : _pendingKeyEvents) {
+    if (keyEvent.isPressed) {
+      onKeyPressed(keyEvent.keyCode, nullptr);
+    } else {
+      onKeyReleased(keyEvent.keyCode);
+    }
+  }
+  _pendingKeyEvents.clear();
+  _replayFrame++;
+}
+
+InputManager::ReplayMode InputManager::getReplayMode() const {
+  return _replayMode;
+}
+
+bool InputManager::isReplayRunning() const {
+  return _isReplayRunning;
+}
+
+bool InputManager::hasPlaybackFinished() const {
+  return _replayMode == ReplayMode::PLAYBACK && _isReplayRunning &&
+         _replayFrame >= _numReplayFrames;
+}
+
+uint64_t InputManager::getReplayFrame() const {
+  return _replayFrame;
+}
+
+
+void InputManager::onKeyPressed(EventKeyboard::KeyCode keyCode, Event* e) {
+  if (keyCode == EventKeyboard::KeyCode::KEY_CAPS_LOCK) {
+    _isCapsLocked = !_isCapsLocked;
+  }
+
+  if (!_specialOnKeyPressed) {
+    // We keep track of which keys have been pressed
+    // only when there is no active _specialOnKeyPressed event listener,
+    // because _specialOnKeyPressed will do whatever it needs to do
+    // with these keys.
+    if (isValidKeyCode(keyCode)) {
+      _heldKeys.set(static_cast<size_t>(keyCode));
+      _keysPressedSinceSnapshot.set(static_cast<size_t>(keyCode));
+    }
+  } else {
+    // Execute the additional onKeyPressed handler for special events.
+    // (e.g., prompting for a hotkey, receiving TextField input, etc)
+    _specialOnKeyPressed(keyCode, e);
+  }
+}
+
+void InputManager::onKeyReleased(EventKeyboard::KeyCode keyCode) {
+  if (isValidKeyCode(keyCode)) {
+    _heldKeys.reset(static_cast<size_t>(keyCode));
+  }
+}
+
+void InputManager::onButtonPressed(int button) {
+  if (isValidButton(button)) {
+    _heldButtons.set(button - Controller::Key::JOYSTICK_LEFT_X);
+    _buttonsPressedSinceSnapshot.set(button - Controller::Key::JOYSTICK_LEFT_X);
+  }
+}
+
+void InputManager::onButtonReleased(int button) {
+  if (isValidButton(button)) {
+    _heldButtons.reset(button - Controller::Key::JOYSTICK_LEFT_X);
+  }
+}
+
+void InputManager::onAxisChanged(int axis, float value) {
+  if (axis == Controller::Key::JOYSTICK_LEFT_X) {
+    _leftStickX = value;
+  }
+}
+
+void InputManager::resetInputState() {
+  _heldKeys.reset();
+  _keysPressedSinceSnapshot.reset();
+  _currentKeys.reset();
+  _previousKeys.reset();
+  _heldButtons.reset();
+  _buttonsPressedSinceSnapshot.reset();
+  _currentButtons.reset();
+  _leftStickX = 0;
+  _currentActions.reset();
+  _previousActions.reset();
+  _actionBuffer.clear();
+}
+
+bool InputManager::isValidKeyCode(EventKeyboard::KeyCode keyCode) {
+  return keycode_util::toIndex(keyCode) < keycode_util::kNumKeyCodes;
+}
+
+bool InputManager::isValidButton(int button) {
+  return button >= Controller::Key::JOYSTICK_LEFT_X && button < Controller::Key::KEY_MAX;
+}
+
+bool InputManager::isBindingActive(const InputManager::ActionBinding& binding) const {
+  for (auto keyCode : binding.keyCodes) {
+    if (isKeyPressed(keyCode)) {
+      return true;
+    }
+  }
+  for (auto button : binding.buttons) {
+    if (_currentButtons.test(button - Controller::Key::JOYSTICK_LEFT_X)) {
+      return true;
+    }
+  }
+  return binding.leftStickDirection * _leftStickX > GAMEPAD_STICK_DEAD_ZONE;
+}
+
+
+InputManager::ActionBuffer::ActionBuffer()
+    : CircularBuffer<InputManager::ActionEvent>(ACTION_BUFFER_SIZE) {}
+
+bool InputManager::ActionBuffer::consume(InputManager::Action action, uint64_t minFrame) {
+  // Walk from the latest press back to the oldest one within the window.
+  int i = _tail;
+  while (i != _head) {
+    i = (i - 1 + static_cast<int>(_capacity)) % static_cast<int>(_capacity);
+    ActionEvent& actionEvent = _data[i];
+    if (actionEvent.frame < minFrame) {
+      break;
+    }
+    if (actionEvent.action == action && !actionEvent.isConsumed) {
+      actionEvent.isConsumed = true;
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace vigilante
@@ -2,12 +2,20 @@
 #ifndef VIGILANTE_INPUT_MANAGER_H_
 #define VIGILANTE_INPUT_MANAGER_H_
 
-#include <set>
+#include <array>
+#include <bitset>
+#include <cstdint>
 #include <stack>
+#include <string>
 #include <functional>
+#include <vector>
 
 #include <cocos2d.h>
+#include <base/CCController.h>
+#include <base/CCEventListenerController.h>
 #include "input/Keybindable.h"
+#include "util/KeyCodeUtil.h"
+#include "util/ds/CircularBuffer.h"
 
 #define IS_KEY_PRESSED(keyCode) \
   InputManager::getInstance()->isKeyPressed(keyCode)
@@ -15,6 +23,18 @@
 #define IS_KEY_JUST_PRESSED(keyCode) \
   InputManager::getInstance()->isKeyJustPressed(keyCode)
 
+#define IS_KEY_JUST_RELEASED(keyCode) \
+  InputManager::getInstance()->isKeyJustReleased(keyCode)
+
+#define IS_ACTION_PRESSED(action) \
+  InputManager::getInstance()->isActionPressed(action)
+
+#define IS_ACTION_JUST_PRESSED(action) \
+  InputManager::getInstance()->isActionJustPressed(action)
+
+#define CONSUME_BUFFERED_ACTION(action, maxAge) \
+  InputManager::getInstance()->consumeBufferedAction(action, maxAge)
+
 
 namespace vigilante {
 
@@ -27,13 +47,57 @@ class InputManager {
   void activate(cocos2d::Scene* scene);
   void deactivate();
 
+  // The following queries are answered from a snapshot of the keyboard
+  // taken at the beginning of each frame (see beginFrame()), so they don't
+  // change during a frame, and every caller sees the same result.
   bool isKeyPressed(cocos2d::EventKeyboard::KeyCode keyCode) const;
-  bool isKeyJustPressed(cocos2d::EventKeyboard::KeyCode keyCode);
+  bool isKeyJustPressed(cocos2d::EventKeyboard::KeyCode keyCode) const;
+  bool isKeyJustReleased(cocos2d::EventKeyboard::KeyCode keyCode) const;
+
+  // Indexed by keycode_util::toIndex().
+  using KeySet = std::bitset<keycode_util::kNumKeyCodes>;
+  InputManager::KeySet getKeysJustPressed() const;
 
   bool isCapsLocked() const;
   bool isShiftPressed() const;
 
 
+  // Actions.
+  // The gameplay polls actions rather than keys. Each action is bound to
+  // a number of keys and gamepad buttons (see setDefaultActionBindings()),
+  // and its state is captured along with the keyboard in beginFrame().
+  enum class Action {
+    MOVE_LEFT,
+    MOVE_RIGHT,
+    CROUCH,
+    JUMP,
+    ATTACK,
+    INTERACT,
+    ENTER_PORTAL,
+    PICK_UP_ITEM,
+    SHEATHE_WEAPON,
+    SIZE
+  };
+
+  bool isActionPressed(InputManager::Action action) const;
+  bool isActionJustPressed(InputManager::Action action) const;
+  bool isActionJustReleased(InputManager::Action action) const;
+
+  // The presses of the actions are also kept in a ring buffer along with
+  // the frames they were captured in, so an action pressed while the player
+  // can't act yet (e.g., jumping near the end of an attack) can still be
+  // performed shortly afterwards. Returns true if the action has been pressed
+  // within the last `maxAge` frames (0 means this frame only), and the press
+  // hasn't been consumed yet. The press is consumed.
+  bool consumeBufferedAction(InputManager::Action action, uint64_t maxAge);
+  void clearBufferedActions();
+
+  void bindKey(InputManager::Action action, cocos2d::EventKeyboard::KeyCode keyCode);
+  void bindButton(InputManager::Action action, cocos2d::Controller::Key button);
+  void clearBindings(InputManager::Action action);
+  void setDefaultActionBindings();
+
+
   using OnKeyPressedEvLstnr =
     std::function<void (cocos2d::EventKeyboard::KeyCode, cocos2d::Event*)>;
 
@@ -41,19 +105,138 @@ class InputManager {
   void setSpecialOnKeyPressed(const OnKeyPressedEvLstnr& onKeyPressed);
   void clearSpecialOnKeyPressed();
 
+
+  // Replays.
+  // While a replay is being recorded or played back, the key events are
+  // applied at the beginning of each frame (see beginFrame()) instead of as
+  // soon as they're received, so a recorded session can be reproduced frame
+  // by frame (along with the RNG seed and a fixed time step, see GameScene).
+  // The keyboard is ignored during playback, and the gamepad is ignored
+  // while a replay is running.
+  enum class ReplayMode {
+    NONE,
+    RECORDING,
+    PLAYBACK
+  };
+
+  // The state which a replay starts from.
+  struct ReplayHeader final {
+    uint64_t seed;
+    std::string tmxMapFileName;
+    float playerX;  // in meters
+    float playerY;  // in meters
+  };
+
+  bool startRecording(const std::string& fileName, const InputManager::ReplayHeader& header);
+  bool startPlayback(const std::string& fileName, InputManager::ReplayHeader* header);
+
+  // Must be called once the game is in the state described by the header.
+  // The key events received before then are discarded.
+  void beginReplay();
+
+  // Writes the recorded session to its file. Returns false on failure.
+  bool stopReplay();
+
+  // Must be called at the beginning of each frame (by every scene which
+  // handles input). Takes the snapshot of the keyboard, the gamepad
+  // and the actions for this frame.
+  void beginFrame();
+
+  InputManager::ReplayMode getReplayMode() const;
+  bool isReplayRunning() const;
+  bool hasPlaybackFinished() const;
+  uint64_t getReplayFrame() const;
+
  private:
+  struct KeyEvent final {
+    uint64_t frame;
+    cocos2d::EventKeyboard::KeyCode keyCode;
+    bool isPressed;
+  };
+
+  // The gamepad buttons (and axes) are indexed from
+  // cocos2d::Controller::Key::JOYSTICK_LEFT_X.
+  static const size_t _kNumButtons =
+    cocos2d::Controller::Key::KEY_MAX - cocos2d::Controller::Key::JOYSTICK_LEFT_X;
+  using ButtonSet = std::bitset<_kNumButtons>;
+  using ActionSet = std::bitset<static_cast<size_t>(InputManager::Action::SIZE)>;
+
+  struct ActionBinding final {
+    std::vector<cocos2d::EventKeyboard::KeyCode> keyCodes;
+    std::vector<cocos2d::Controller::Key> buttons;
+    int leftStickDirection;  // -1: left, 1: right, 0: unbound
+  };
+
+  struct ActionEvent final {
+    uint64_t frame;
+    InputManager::Action action;
+    bool isConsumed;
+  };
+
+  class ActionBuffer : public CircularBuffer<InputManager::ActionEvent> {
+   public:
+    ActionBuffer();
+    virtual ~ActionBuffer() = default;
+
+    bool consume(InputManager::Action action, uint64_t minFrame);
+  };
+
   InputManager();
 
+  static bool isValidKeyCode(cocos2d::EventKeyboard::KeyCode keyCode);
+  static bool isValidButton(int button);
+  bool isBindingActive(const InputManager::ActionBinding& binding) const;
+
+  void onKeyPressed(cocos2d::EventKeyboard::KeyCode keyCode, cocos2d::Event* e);
+  void onKeyReleased(cocos2d::EventKeyboard::KeyCode keyCode);
+  void onButtonPressed(int button);
+  void onButtonReleased(int button);
+  void onAxisChanged(int axis, float value);
+  void resetInputState();
+  // Applies the key events recorded in (or played back from) the replay
+  // in the current frame.
+  void applyReplayEvents();
+
   cocos2d::Scene* _scene;
   cocos2d::EventListenerKeyboard* _keyboardEvLstnr;
+  cocos2d::EventListenerController* _controllerEvLstnr;
 
   bool _isCapsLocked;
 
-  // Pressed Keys are stored in this set.
-  // Relevant method: isKeyPressed(), isKeyJustPressed()
-  std::set<cocos2d::EventKeyboard::KeyCode> _pressedKeys;
+  // The keys which are being held down, updated as soon as
+  // the key events are received.
+  InputManager::KeySet _heldKeys;
+  // The keys pressed since the last snapshot, so that a key which is
+  // pressed and released within a single frame isn't missed.
+  InputManager::KeySet _keysPressedSinceSnapshot;
+  // The snapshots of the current and the previous frame.
+  // Relevant methods: isKeyPressed(), isKeyJustPressed(), isKeyJustReleased()
+  InputManager::KeySet _currentKeys;
+  InputManager::KeySet _previousKeys;
+
+  // Same as above, but for the gamepad.
+  InputManager::ButtonSet _heldButtons;
+  InputManager::ButtonSet _buttonsPressedSinceSnapshot;
+  InputManager::ButtonSet _currentButtons;
+  float _leftStickX;
+
+  std::array<InputManager::ActionBinding, static_cast<size_t>(InputManager::Action::SIZE)> _actionBindings;
+  InputManager::ActionSet _currentActions;
+  InputManager::ActionSet _previousActions;
+  InputManager::ActionBuffer _actionBuffer;
+  uint64_t _frame;
 
   OnKeyPressedEvLstnr _specialOnKeyPressed;
+
+  InputManager::ReplayMode _replayMode;
+  InputManager::ReplayHeader _replayHeader;
+  std::string _replayFileName;
+  bool _isReplayRunning;
+  uint64_t _replayFrame;
+  uint64_t _numReplayFrames;  // playback only
+  size_t _replayEventIndex;  // playback only
+  std::vector<InputManager::KeyEvent> _replayEvents;
+  std::vector<InputManager::KeyEvent> _pendingKeyEvents;  // received in the current frame
 };
 
 }  // namespace vigilante
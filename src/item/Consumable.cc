@@ -2,6 +2,7 @@
 #include "Consumable.h"
 
 #include "util/JsonUtil.h"
+#include "util/ProfileCache.h"
 
 using std::string;
 using cocos2d::EventKeyboard; 
@@ -11,29 +12,31 @@ namespace vigilante {
 
 Consumable::Consumable(const string& jsonFileName)
     : Item(jsonFileName),
-      _consumableProfile(jsonFileName) {}
+      _consumableProfile(profile_cache::get<Consumable::Profile>(jsonFileName)),
+      _hotkey() {}
 
 
 void Consumable::import(const string& jsonFileName) {
   Item::import(jsonFileName);
-  _consumableProfile = Consumable::Profile(jsonFileName);
+  _consumableProfile = profile_cache::get<Consumable::Profile>(jsonFileName);
 }
 
 EventKeyboard::KeyCode Consumable::getHotkey() const {
-  return _consumableProfile.hotkey;
+  return _hotkey;
 }
 
 void Consumable::setHotkey(EventKeyboard::KeyCode hotkey) {
-  _consumableProfile.hotkey = hotkey;
+  _hotkey = hotkey;
 }
 
-Consumable::Profile& Consumable::getConsumableProfile() {
-  return _consumableProfile;
+const Consumable::Profile& Consumable::getConsumableProfile() const {
+  return *_consumableProfile;
 }
 
 
-Consumable::Profile::Profile(const string& jsonFileName) : hotkey() {
-  Document json = json_util::parseJson(jsonFileName);
+Consumable::Profile::Profile(const string& jsonFileName) {
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  Document& json = jsonDocument.get();
 
   duration = json["duration"].GetFloat();
 
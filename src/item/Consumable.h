@@ -2,6 +2,7 @@
 #ifndef VIGILANTE_CONSUMABLE_H_
 #define VIGILANTE_CONSUMABLE_H_
 
+#include <memory>
 #include <string>
 
 #include <cocos2d.h>
@@ -32,21 +33,24 @@ class Consumable : public Item, public Keybindable {
 
     int bonusMoveSpeed;
     int bonusJumpHeight;
-
-    cocos2d::EventKeyboard::KeyCode hotkey;
   };
 
   explicit Consumable(const std::string& jsonFileName);
   virtual ~Consumable() = default;
+
+  // Recycled through ObjectPool<Consumable>.
+  static void* operator new(size_t size) { return ObjectPool<Consumable>::allocate(size); }
+  static void operator delete(void* p, size_t size) { ObjectPool<Consumable>::deallocate(p, size); }
   virtual void import (const std::string& jsonFileName) override;  // Importable
 
   virtual cocos2d::EventKeyboard::KeyCode getHotkey() const override;  // Keybindable
   virtual void setHotkey(cocos2d::EventKeyboard::KeyCode hotkey) override;  // Keybindable
 
-  Consumable::Profile& getConsumableProfile();
+  const Consumable::Profile& getConsumableProfile() const;
 
  protected:
-  Consumable::Profile _consumableProfile;
+  std::shared_ptr<const Consumable::Profile> _consumableProfile;  // see Item::_itemProfile
+  cocos2d::EventKeyboard::KeyCode _hotkey;  // per item, so it isn't in the shared profile
 };
 
 }  // namespace vigilante
@@ -3,6 +3,7 @@
 
 #include <json/document.h>
 #include "util/JsonUtil.h"
+#include "util/ProfileCache.h"
 
 using std::array;
 using std::string;
@@ -22,20 +23,21 @@ const array<string, Equipment::Type::SIZE> Equipment::_kEquipmentTypeStr = {{
 
 Equipment::Equipment(const string& jsonFileName)
     : Item(jsonFileName),
-      _equipmentProfile(jsonFileName) {}
+      _equipmentProfile(profile_cache::get<Equipment::Profile>(jsonFileName)) {}
 
 void Equipment::import(const string& jsonFileName) {
   Item::import(jsonFileName);
-  _equipmentProfile = Equipment::Profile(jsonFileName);
+  _equipmentProfile = profile_cache::get<Equipment::Profile>(jsonFileName);
 }
 
-Equipment::Profile& Equipment::getEquipmentProfile() {
-  return _equipmentProfile;
+const Equipment::Profile& Equipment::getEquipmentProfile() const {
+  return *_equipmentProfile;
 }
 
 
 Equipment::Profile::Profile(const string& jsonFileName) {
-  Document json = json_util::parseJson(jsonFileName);
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  Document& json = jsonDocument.get();
 
   equipmentType = static_cast<Equipment::Type>(json["equipmentType"].GetInt());
   bonusPhysicalDamage = json["bonusPhysicalDamage"].GetInt();
@@ -48,6 +50,10 @@ Equipment::Profile::Profile(const string& jsonFileName) {
 
   bonusMoveSpeed = json["bonusMoveSpeed"].GetInt();
   bonusJumpHeight = json["bonusJumpHeight"].GetInt();
+
+  if (json.HasMember("palette")) {
+    palette = json["palette"].GetString();
+  }
 }
 
 }  // namespace vigilante
@@ -3,6 +3,7 @@
 #define VIGILANTE_EQUIPMENT_H_
 
 #include <array>
+#include <memory>
 #include <string>
 
 #include "Item.h"
@@ -37,18 +38,24 @@ class Equipment : public Item {
 
     int bonusMoveSpeed;
     int bonusJumpHeight;
+
+    std::string palette;  // optional, see PaletteSwap
   };
 
   static const std::array<std::string, Equipment::Type::SIZE> _kEquipmentTypeStr;
 
   explicit Equipment(const std::string& jsonFileName);
   virtual ~Equipment() = default;
+
+  // Recycled through ObjectPool<Equipment>.
+  static void* operator new(size_t size) { return ObjectPool<Equipment>::allocate(size); }
+  static void operator delete(void* p, size_t size) { ObjectPool<Equipment>::deallocate(p, size); }
   virtual void import(const std::string& jsonFileName) override;  // Importable
 
-  Equipment::Profile& getEquipmentProfile();
+  const Equipment::Profile& getEquipmentProfile() const;
 
  private:
-  Equipment::Profile _equipmentProfile;
+  std::shared_ptr<const Equipment::Profile> _equipmentProfile;  // see Item::_itemProfile
 };
 
 }  // namespace vigilante
@@ -4,6 +4,7 @@
 #include <json/document.h>
 #include "AssetManager.h"
 #include "Constants.h"
+#include "TextureLoader.h"
 #include "std/make_unique.h"
 #include "item/Equipment.h"
 #include "item/Consumable.h"
@@ -13,18 +14,19 @@
 #include "util/box2d/b2BodyBuilder.h"
 #include "util/JsonUtil.h"
 #include "util/Logger.h"
+#include "util/ProfileCache.h"
 
 #define ITEM_NUM_ANIMATIONS 0
-#define ITEM_NUM_FIXTURES 2
+#define ITEM_NUM_FIXTURES 1
 
 #define ITEM_CATEGORY_BITS kItem
 #define ITEM_MASK_BITS kGround | kPlatform | kWall
 
+#define ITEM_SETTLED_VELOCITY_SQUARED .0001f
+
 using std::string;
 using std::unique_ptr;
-using cocos2d::Sprite;
 using vigilante::category_bits::kItem;
-using vigilante::category_bits::kFeet;
 using vigilante::category_bits::kWall;
 using vigilante::category_bits::kGround;
 using vigilante::category_bits::kPlatform;
@@ -32,28 +34,34 @@ using rapidjson::Document;
 
 namespace vigilante {
 
+const float Item::_kSettleTime = .5f;
+
 unique_ptr<Item> Item::create(const string& jsonFileName) {
-  if (jsonFileName.find("equipment") != jsonFileName.npos) {
-    return std::make_unique<Equipment>(jsonFileName);
-  } else if (jsonFileName.find("consumable") != jsonFileName.npos) {
-    return std::make_unique<Consumable>(jsonFileName);
-  } else if (jsonFileName.find("key") != jsonFileName.npos) {
-    return std::make_unique<Key>(jsonFileName);
-  } else if (jsonFileName.find("misc") != jsonFileName.npos) {
-    return std::make_unique<MiscItem>(jsonFileName);
+  // The type has been resolved when the profile was parsed (and cached),
+  // and the constructors below will reuse the same cached profile.
+  const Item::Profile& itemProfile = *profile_cache::get<Item::Profile>(jsonFileName);
+
+  switch (itemProfile.itemType) {
+    case Item::Type::EQUIPMENT:
+      return std::make_unique<Equipment>(jsonFileName);
+    case Item::Type::CONSUMABLE:
+      return std::make_unique<Consumable>(jsonFileName);
+    case Item::Type::MISC:
+      if (itemProfile.isKey) {
+        return std::make_unique<Key>(jsonFileName);
+      }
+      return std::make_unique<MiscItem>(jsonFileName);
+    default:
+      VGLOG(LOG_ERR, "Unable to determine item type: %s", jsonFileName.c_str());
+      return nullptr;
   }
-
-  VGLOG(LOG_ERR, "Unable to determine item type.");
-  return nullptr;
 }
 
 Item::Item(const string& jsonFileName)
     : DynamicActor(ITEM_NUM_ANIMATIONS, ITEM_NUM_FIXTURES),
-      _itemProfile(jsonFileName),
-      _amount(1) {
-  _bodySprite = Sprite::create(getIconPath());
-  _bodySprite->getTexture()->setAliasTexParameters();
-}
+      _itemProfile(profile_cache::get<Item::Profile>(jsonFileName)),
+      _amount(1),
+      _settleTimer() {}
 
 
 bool Item::showOnMap(float x, float y) {
@@ -62,6 +70,7 @@ bool Item::showOnMap(float x, float y) {
   }
 
   _isShownOnMap = true;
+  _settleTimer = 0;
 
   defineBody(b2BodyType::b2_dynamicBody,
              x,
@@ -69,15 +78,38 @@ bool Item::showOnMap(float x, float y) {
              ITEM_CATEGORY_BITS,
              ITEM_MASK_BITS);  
 
-  _bodySprite = Sprite::create(getIconPath());
-  _bodySprite->getTexture()->setAliasTexParameters();
-  GameMapManager::getInstance()->getLayer()->addChild(_bodySprite,
-                                                      graphical_layers::kItem);
+  // If the icon hasn't been preloaded, a placeholder is shown
+  // until it is loaded, instead of stalling on the png decode.
+  _bodySprite = TextureLoader::getInstance()->createSprite(getIconPath());
+  GameMapManager::getInstance()->getRenderBuckets()->get(graphical_layers::kItem)->addChild(_bodySprite);
   return true;
 }
 
+void Item::update(float delta) {
+  if (isSettled()) {
+    return;
+  }
+
+  DynamicActor::update(delta);
+  freezeIfSettled(delta);
+}
+
+void Item::setPosition(float x, float y) {
+  DynamicActor::setPosition(x, y);
+
+  // A frozen item isn't synced by TransformSync.
+  if (isSettled()) {
+    _bodySprite->setPosition(x * kPpm, y * kPpm);
+  }
+}
+
+bool Item::isTransformSyncNeeded() const {
+  // A frozen item only moves by setPosition(), so its sprite doesn't need to be synced.
+  return DynamicActor::isTransformSyncNeeded() && !isSettled();
+}
+
 void Item::import(const string& jsonFileName) {
-  _itemProfile = Item::Profile(jsonFileName);
+  _itemProfile = profile_cache::get<Item::Profile>(jsonFileName);
 }
 
 
@@ -92,39 +124,54 @@ void Item::defineBody(b2BodyType bodyType,
     .position(x, y, kPpm)
     .buildBody();
 
-  bodyBuilder.newRectangleFixture(kIconSize / 2, kIconSize / 2, kPpm)
-    .categoryBits(categoryBits)
-    .maskBits(maskBits | kFeet)  // Enable collision detection with feet fixtures
-    .setSensor(true)
-    .setUserData(this)
-    .buildFixture();
-
-  bodyBuilder.newRectangleFixture(kIconSize / 2, kIconSize / 2, kPpm)
+  _fixtures[FixtureType::BODY] = bodyBuilder.newRectangleFixture(kIconSize / 2, kIconSize / 2, kPpm)
     .categoryBits(categoryBits)
     .maskBits(maskBits)
     .setUserData(this)
     .buildFixture();
 }
 
+void Item::freezeIfSettled(float delta) {
+  if (_body->IsAwake() &&
+      _body->GetLinearVelocity().LengthSquared() > ITEM_SETTLED_VELOCITY_SQUARED) {
+    _settleTimer = 0;
+    return;
+  }
+
+  _settleTimer += delta;
+  if (_settleTimer < _kSettleTime) {
+    return;
+  }
+
+  _body->SetActive(false);
+
+  const b2Vec2& b2bodyPos = _body->GetPosition();
+  _bodySprite->setPosition(b2bodyPos.x * kPpm, b2bodyPos.y * kPpm);
+}
+
 
-Item::Profile& Item::getItemProfile() {
-  return _itemProfile;
+const Item::Profile& Item::getItemProfile() const {
+  return *_itemProfile;
 }
 
 const string& Item::getName() const {
-  return _itemProfile.name;
+  return _itemProfile->name;
 }
 
 const string& Item::getDesc() const {
-  return _itemProfile.desc;
+  return _itemProfile->desc.getText();
 }
 
-string Item::getIconPath() const {
-  return _itemProfile.textureResDir + "/icon.png";
+const string& Item::getIconPath() const {
+  return Item::getIconPath(*_itemProfile);
+}
+
+const string& Item::getIconPath(const Item::Profile& itemProfile) {
+  return itemProfile.iconPath;
 }
 
 bool Item::isGold() const {
-  return _itemProfile.jsonFileName == asset_manager::kGoldCoin;
+  return _itemProfile->jsonFileName == asset_manager::kGoldCoin;
 }
 
 
@@ -136,14 +183,24 @@ void Item::setAmount(int amount) {
   _amount = amount;
 }
 
+bool Item::isSettled() const {
+  return _body && !_body->IsActive();
+}
+
 
-Item::Profile::Profile(const string& jsonFileName) : jsonFileName(jsonFileName) {
-  Document json = json_util::parseJson(jsonFileName);
+Item::Profile::Profile(const string& jsonFileName)
+    : jsonFileName(jsonFileName),
+      id(jsonFileName) {
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  Document& json = jsonDocument.get();
 
   itemType = static_cast<Item::Type>(json["itemType"].GetInt());
   textureResDir = json["textureResDir"].GetString();
+  iconPath = textureResDir + "/icon.png";
   name = json["name"].GetString();
-  desc = json["desc"].GetString();
+  nameId = AssetId(name);
+  desc = TextId(json["desc"].GetString());
+  isKey = json.HasMember("targetTmxMapFileName");
 }
 
 }  // namespace vigilante
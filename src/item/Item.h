@@ -9,6 +9,9 @@
 #include <Box2D/Box2D.h>
 #include "DynamicActor.h"
 #include "Importable.h"
+#include "util/AssetId.h"
+#include "util/TextId.h"
+#include "util/ds/ObjectPool.h"
 
 namespace vigilante {
 
@@ -26,28 +29,40 @@ class Item : public DynamicActor, public Importable {
     virtual ~Profile() = default;
 
     std::string jsonFileName;
+    AssetId id;  // interned `jsonFileName`
     Item::Type itemType;
     std::string textureResDir;
+    std::string iconPath;  // `textureResDir` + "/icon.png"
     std::string name;
-    std::string desc;
+    AssetId nameId;  // interned `name`
+    TextId desc;
+    bool isKey;  // a MISC item which unlocks a portal (see Key::Profile)
   };
 
   // Create an item by automatically deducing its concrete type
   // based on the json passed in.
   static std::unique_ptr<Item> create(const std::string& jsonFileName);
 
+  // The icon of an item, which is also shown on the map when it's dropped.
+  static const std::string& getIconPath(const Item::Profile& itemProfile);
+
   virtual ~Item() = default;
   virtual bool showOnMap(float x, float y) override;  // DynamicActor
+  virtual void update(float delta) override;  // DynamicActor
+  virtual void setPosition(float x, float y) override;  // DynamicActor
+  virtual bool isTransformSyncNeeded() const override;  // DynamicActor
   virtual void import(const std::string& jsonFileName) override;  // Importable
 
-  Item::Profile& getItemProfile();
+  const Item::Profile& getItemProfile() const;
   const std::string& getName() const;
   const std::string& getDesc() const;
-  std::string getIconPath() const;
+  const std::string& getIconPath() const;
   bool isGold() const;
 
   int getAmount() const;
   void setAmount(int amount);
+  // Whether this item has settled on the ground, see freezeIfSettled().
+  bool isSettled() const;
 
  protected:
   explicit Item(const std::string& jsonFileName);
@@ -58,8 +73,26 @@ class Item : public DynamicActor, public Importable {
                   short categoryBits,
                   short maskBits);
 
-  Item::Profile _itemProfile;
+  // Once an item has settled on the ground for _kSettleTime seconds, its
+  // b2Body is deactivated, i.e., it has no broadphase proxies and it's not
+  // simulated at all, so that it no longer costs anything during b2World::Step().
+  // The body is kept only for its position, and the item is picked up through
+  // the spatial index of the GameMap instead of contacts (see PickupSystem).
+  void freezeIfSettled(float delta);
+
+  static const float _kSettleTime;
+
+  enum FixtureType {
+    BODY
+  };
+
+  // The immutable prototype shared by all the items of the same json
+  // (see profile_cache), so an item sitting in an inventory only costs
+  // this pointer and its amount. Its b2Body and sprite are only created
+  // once it's dropped onto the map, see showOnMap().
+  std::shared_ptr<const Item::Profile> _itemProfile;
   int _amount;
+  float _settleTimer;
 };
 
 }  // namespace vigilante
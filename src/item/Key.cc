@@ -2,6 +2,7 @@
 #include "Key.h"
 
 #include "util/JsonUtil.h"
+#include "util/ProfileCache.h"
 
 using std::string;
 using rapidjson::Document;
@@ -10,17 +11,19 @@ namespace vigilante {
 
 Key::Key(const string& jsonFileName)
     : MiscItem(jsonFileName),
-      _keyProfile(jsonFileName) {}
+      _keyProfile(profile_cache::get<Key::Profile>(jsonFileName)) {}
 
 const Key::Profile& Key::getKeyProfile() const {
-  return _keyProfile;
+  return *_keyProfile;
 }
 
 
 Key::Profile::Profile(const string& jsonFileName) {
-  Document json = json_util::parseJson(jsonFileName);
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  Document& json = jsonDocument.get();
 
   targetTmxFileName = json["targetTmxMapFileName"].GetString();
+  targetTmxMapId = AssetId(targetTmxFileName);
   targetPortalId = json["targetPortalId"].GetInt();
 }
 
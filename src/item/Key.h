@@ -2,9 +2,11 @@
 #ifndef VIGILANTE_KEY_H_
 #define VIGILANTE_KEY_H_
 
+#include <memory>
 #include <string>
 
 #include "MiscItem.h"
+#include "util/AssetId.h"
 
 namespace vigilante {
 
@@ -15,16 +17,21 @@ class Key : public MiscItem {
     ~Profile() = default;
 
     std::string targetTmxFileName;
+    AssetId targetTmxMapId;  // interned `targetTmxFileName`
     int targetPortalId;
   };
 
   explicit Key(const std::string& jsonFileName);
   virtual ~Key() = default;
 
+  // Recycled through ObjectPool<Key>.
+  static void* operator new(size_t size) { return ObjectPool<Key>::allocate(size); }
+  static void operator delete(void* p, size_t size) { ObjectPool<Key>::deallocate(p, size); }
+
   const Key::Profile& getKeyProfile() const;
 
  private:
-  Key::Profile _keyProfile;
+  std::shared_ptr<const Key::Profile> _keyProfile;  // see Item::_itemProfile
 };
 
 }  // namespace vigilante
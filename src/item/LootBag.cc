@@ -0,0 +1,31 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "LootBag.h"
+
+#define LOOT_BAG_NAME "Loot Bag"
+
+namespace vigilante {
+
+LootBag::LootBag(LootBag::Contents contents)
+    : Item(contents.front().first->getItemProfile().jsonFileName),
+      _contents(std::move(contents)) {
+  // Nothing should mistake it for the item it looks like, e.g., stacking,
+  // so it gets a profile of its own instead of the shared prototype.
+  auto profile = std::make_shared<Item::Profile>(*_itemProfile);
+  profile->itemType = Item::Type::MISC;
+  profile->id = AssetId();
+  profile->name = LOOT_BAG_NAME;
+  profile->nameId = AssetId(profile->name);
+  profile->isKey = false;
+  _itemProfile = std::move(profile);
+}
+
+void LootBag::import(const std::string&) {
+  // It isn't backed by any json file of its own, so there's nothing
+  // to reload (and its profile must not be replaced by the look-alike's).
+}
+
+const LootBag::Contents& LootBag::getContents() const {
+  return _contents;
+}
+
+}  // namespace vigilante
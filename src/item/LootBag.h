@@ -0,0 +1,34 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_LOOT_BAG_H_
+#define VIGILANTE_LOOT_BAG_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Item.h"
+
+namespace vigilante {
+
+// A single pickup holding the whole drop list of a kill (see
+// GameMap::dropLoot()). It looks like the first of its items on the
+// map, and picking it up adds all of its items at once.
+class LootBag : public Item {
+ public:
+  using Contents = std::vector<std::pair<std::shared_ptr<Item>, int>>;
+
+  // `contents` must not be empty.
+  explicit LootBag(Contents contents);
+  virtual ~LootBag() = default;
+  virtual void import(const std::string& jsonFileName) override;  // Importable
+
+  const LootBag::Contents& getContents() const;
+
+ private:
+  LootBag::Contents _contents;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_LOOT_BAG_H_
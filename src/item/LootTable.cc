@@ -0,0 +1,215 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "LootTable.h"
+
+#include <algorithm>
+
+#include "util/JsonUtil.h"
+#include "util/Logger.h"
+#include "util/ProfileCache.h"
+
+using std::string;
+using std::vector;
+using std::unordered_set;
+
+namespace vigilante {
+
+// Guards against the tables which (indirectly) nest themselves.
+const int LootTable::_kMaxDepth = 8;
+
+LootTable::LootTable(const string& jsonFileName)
+    : _rolls(),
+      _numPoolRolls(),
+      _pool(),
+      _probabilities(),
+      _aliases() {
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  parse(jsonDocument.get());
+}
+
+LootTable::LootTable(const rapidjson::Value& json)
+    : _rolls(),
+      _numPoolRolls(),
+      _pool(),
+      _probabilities(),
+      _aliases() {
+  parse(json);
+}
+
+
+void LootTable::roll(rand_util::Generator& generator, LootTable::Drops& drops) const {
+  roll(generator, drops, 0);
+}
+
+void LootTable::collectItemJsons(unordered_set<string>& itemJsons) const {
+  collectItemJsons(itemJsons, 0);
+}
+
+
+LootTable::Entry LootTable::parseEntry(const rapidjson::Value& json) {
+  Entry entry{"", "", 1, 1};
+  if (json.HasMember("item")) {
+    entry.itemJson = json["item"].GetString();
+  } else if (json.HasMember("table")) {
+    entry.tableJson = json["table"].GetString();
+  }
+  if (json.HasMember("minAmount")) {
+    entry.minAmount = json["minAmount"].GetInt();
+  }
+  if (json.HasMember("maxAmount")) {
+    entry.maxAmount = json["maxAmount"].GetInt();
+  }
+  return entry;
+}
+
+void LootTable::parse(const rapidjson::Value& json) {
+  if (json.HasMember("droppedItems")) {
+    for (const auto& keyValue : json["droppedItems"].GetObject()) {
+      Entry entry = parseEntry(keyValue.value);
+      entry.itemJson = keyValue.name.GetString();
+      _rolls.push_back({std::move(entry), keyValue.value["chance"].GetInt()});
+    }
+  }
+  if (json.HasMember("lootTables")) {
+    for (const auto& keyValue : json["lootTables"].GetObject()) {
+      Entry entry = parseEntry(keyValue.value);
+      entry.tableJson = keyValue.name.GetString();
+      _rolls.push_back({std::move(entry), keyValue.value["chance"].GetInt()});
+    }
+  }
+
+  if (json.HasMember("lootPool")) {
+    const auto& poolJson = json["lootPool"];
+    _numPoolRolls = (poolJson.HasMember("rolls")) ? poolJson["rolls"].GetInt() : 1;
+
+    vector<float> weights;
+    for (const auto& entryJson : poolJson["entries"].GetArray()) {
+      const float weight = entryJson["weight"].GetFloat();
+      if (weight > 0) {
+        _pool.push_back(parseEntry(entryJson));
+        weights.push_back(weight);
+      }
+    }
+    buildAliasTable(weights);
+  }
+}
+
+void LootTable::buildAliasTable(const vector<float>& weights) {
+  const int n = static_cast<int>(weights.size());
+  _probabilities.assign(n, 1.0f);
+  _aliases.assign(n, 0);
+  if (n == 0) {
+    _numPoolRolls = 0;
+    return;
+  }
+
+  float totalWeight = 0;
+  for (const auto weight : weights) {
+    totalWeight += weight;
+  }
+
+  // Scale the weights so that they average 1, and then let each of the "small"
+  // entries (< 1) be topped up by a "large" one (>= 1), its alias.
+  vector<float> scaled(n);
+  vector<int> small;
+  vector<int> large;
+  for (int i = 0; i < n; i++) {
+    scaled[i] = weights[i] * n / totalWeight;
+    if (scaled[i] < 1.0f) {
+      small.push_back(i);
+    } else {
+      large.push_back(i);
+    }
+  }
+
+  while (!small.empty() && !large.empty()) {
+    const int s = small.back();
+    const int l = large.back();
+    small.pop_back();
+    large.pop_back();
+
+    _probabilities[s] = scaled[s];
+    _aliases[s] = l;
+    scaled[l] = (scaled[l] + scaled[s]) - 1.0f;
+    if (scaled[l] < 1.0f) {
+      small.push_back(l);
+    } else {
+      large.push_back(l);
+    }
+  }
+
+  // Whatever is left is (up to the rounding errors) exactly 1.
+  for (const auto i : large) {
+    _probabilities[i] = 1.0f;
+  }
+  for (const auto i : small) {
+    _probabilities[i] = 1.0f;
+  }
+}
+
+void LootTable::roll(rand_util::Generator& generator, LootTable::Drops& drops, int depth) const {
+  if (depth > _kMaxDepth) {
+    VGLOG(LOG_ERR, "Loot tables nested too deeply, is there a cycle?");
+    return;
+  }
+
+  for (const auto& roll : _rolls) {
+    if (generator.randInt(0, 100) <= roll.chance) {
+      rollEntry(roll.entry, generator, drops, depth);
+    }
+  }
+
+  const int n = static_cast<int>(_pool.size());
+  for (int i = 0; i < _numPoolRolls; i++) {
+    const int column = generator.randInt(0, n - 1);
+    const int picked = (generator.randFloat() < _probabilities[column]) ? column : _aliases[column];
+    rollEntry(_pool[picked], generator, drops, depth);
+  }
+}
+
+void LootTable::rollEntry(const LootTable::Entry& entry, rand_util::Generator& generator,
+                          LootTable::Drops& drops, int depth) const {
+  if (!entry.tableJson.empty()) {
+    profile_cache::get<LootTable>(entry.tableJson)->roll(generator, drops, depth + 1);
+    return;
+  }
+  if (entry.itemJson.empty()) {
+    return;
+  }
+
+  const int amount = generator.randInt(entry.minAmount, entry.maxAmount);
+  if (amount <= 0) {
+    return;
+  }
+
+  // Merge the amounts of the same item, so that it's spawned as a single stack.
+  auto it = std::find_if(drops.begin(), drops.end(), [&entry](const std::pair<string, int>& drop) {
+    return drop.first == entry.itemJson;
+  });
+  if (it != drops.end()) {
+    it->second += amount;
+  } else {
+    drops.push_back({entry.itemJson, amount});
+  }
+}
+
+void LootTable::collectItemJsons(unordered_set<string>& itemJsons, int depth) const {
+  if (depth > _kMaxDepth) {
+    return;
+  }
+
+  auto collect = [&itemJsons, depth](const Entry& entry) {
+    if (!entry.itemJson.empty()) {
+      itemJsons.insert(entry.itemJson);
+    } else if (!entry.tableJson.empty()) {
+      profile_cache::get<LootTable>(entry.tableJson)->collectItemJsons(itemJsons, depth + 1);
+    }
+  };
+  for (const auto& roll : _rolls) {
+    collect(roll.entry);
+  }
+  for (const auto& entry : _pool) {
+    collect(entry);
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,93 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_LOOT_TABLE_H_
+#define VIGILANTE_LOOT_TABLE_H_
+
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <json/document.h>
+#include "util/RandUtil.h"
+
+namespace vigilante {
+
+// What a kill (or anything else which drops loot) may drop. A loot table is
+// compiled once from its json, cached along with the profile which owns it
+// (e.g., Npc::Profile), and shared by all of its instances.
+//
+// A table consists of:
+// 1. independent rolls, each of which drops its entry with its own chance:
+//
+//   "droppedItems": {
+//     "Resources/Database/item/gold_coin.json": {"chance": 50, "minAmount": 1, "maxAmount": 3}
+//   },
+//   "lootTables": {
+//     "Resources/Database/loot/gems.json": {"chance": 10}
+//   },
+//
+// 2. a weighted pool, from which "rolls" entries are picked in O(1) each
+//    with an alias table (an entry without "item" or "table" drops nothing):
+//
+//   "lootPool": {
+//     "rolls": 1,
+//     "entries": [
+//       {"item": "Resources/Database/item/rusty_axe.json", "weight": 1},
+//       {"table": "Resources/Database/loot/potions.json", "weight": 4},
+//       {"weight": 15}
+//     ]
+//   }
+//
+// The nested tables (json files of the same format) are looked up
+// in profile_cache when they're rolled.
+class LootTable final {
+ public:
+  // item json -> amount, with each item json appearing only once.
+  using Drops = std::vector<std::pair<std::string, int>>;
+
+  explicit LootTable(const std::string& jsonFileName);  // see profile_cache
+  explicit LootTable(const rapidjson::Value& json);
+
+  // Appends the rolled drops to `drops`.
+  void roll(rand_util::Generator& generator, LootTable::Drops& drops) const;
+
+  // Collects all the items this table (and its nested tables) may drop.
+  void collectItemJsons(std::unordered_set<std::string>& itemJsons) const;
+
+ private:
+  struct Entry final {
+    std::string itemJson;  // empty if it's a nested table or nothing
+    std::string tableJson;  // empty if it's an item or nothing
+    int minAmount;
+    int maxAmount;
+  };
+
+  struct Roll final {
+    LootTable::Entry entry;
+    int chance;  // [0, 100]
+  };
+
+  static LootTable::Entry parseEntry(const rapidjson::Value& json);
+
+  void parse(const rapidjson::Value& json);
+  // Vose's alias method.
+  void buildAliasTable(const std::vector<float>& weights);
+
+  void roll(rand_util::Generator& generator, LootTable::Drops& drops, int depth) const;
+  void rollEntry(const LootTable::Entry& entry, rand_util::Generator& generator,
+                 LootTable::Drops& drops, int depth) const;
+  void collectItemJsons(std::unordered_set<std::string>& itemJsons, int depth) const;
+
+  static const int _kMaxDepth;
+
+  std::vector<LootTable::Roll> _rolls;
+
+  int _numPoolRolls;
+  std::vector<LootTable::Entry> _pool;
+  std::vector<float> _probabilities;  // of picking the entry itself rather than its alias
+  std::vector<int> _aliases;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_LOOT_TABLE_H_
@@ -12,6 +12,10 @@ class MiscItem : public Item {
  public:
   explicit MiscItem(const std::string& jsonFileName);
   virtual ~MiscItem() = default;
+
+  // Recycled through ObjectPool<MiscItem>.
+  static void* operator new(size_t size) { return ObjectPool<MiscItem>::allocate(size); }
+  static void operator delete(void* p, size_t size) { ObjectPool<MiscItem>::deallocate(p, size); }
 };
 
 }  // namespace vigilante
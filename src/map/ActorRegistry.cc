@@ -0,0 +1,245 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ActorRegistry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "character/Npc.h"
+#include "item/Item.h"
+#include "map/object/Chest.h"
+#include "util/Logger.h"
+
+#define INVALID_SLOT std::numeric_limits<uint32_t>::max()
+
+using std::vector;
+using std::shared_ptr;
+
+namespace vigilante {
+
+const float ActorRegistry::_kCellSize = 2.0f;
+
+ActorRegistry::ActorRegistry()
+    : _groups(),
+      _groupSlots(),
+      _slots(),
+      _freeSlot(INVALID_SLOT),
+      _slotMapper(),
+      _numCellsX(1),
+      _numCellsY(1),
+      _cellStarts(2, 0),
+      _cellEntries() {}
+
+
+void ActorRegistry::setBounds(float width, float height) {
+  _numCellsX = std::max(1, static_cast<int>(std::ceil(width / _kCellSize)));
+  _numCellsY = std::max(1, static_cast<int>(std::ceil(height / _kCellSize)));
+  _cellStarts.assign(_numCellsX * _numCellsY + 1, 0);
+  _cellEntries.clear();
+}
+
+ActorRegistry::Handle ActorRegistry::insert(shared_ptr<DynamicActor> actor) {
+  if (!actor || contains(actor.get())) {
+    VGLOG(LOG_ERR, "Failed to register DynamicActor: %p", actor.get());
+    return {INVALID_SLOT, 0};
+  }
+
+  uint32_t slotIndex = _freeSlot;
+  if (slotIndex != INVALID_SLOT) {
+    _freeSlot = _slots[slotIndex].denseIndex;
+  } else {
+    slotIndex = static_cast<uint32_t>(_slots.size());
+    _slots.push_back({0, Group::OTHER, 0});
+  }
+
+  const ActorRegistry::Group group = ActorRegistry::getGroupOf(actor.get());
+  Slot& slot = _slots[slotIndex];
+  slot.group = group;
+  slot.denseIndex = static_cast<uint32_t>(_groups[group].size());
+
+  _slotMapper[actor.get()] = slotIndex;
+  _groups[group].push_back(std::move(actor));
+  _groupSlots[group].push_back(slotIndex);
+  return {slotIndex, slot.generation};
+}
+
+shared_ptr<DynamicActor> ActorRegistry::erase(const DynamicActor* actor) {
+  auto it = _slotMapper.find(actor);
+  if (it == _slotMapper.end()) {
+    return nullptr;
+  }
+
+  const uint32_t slotIndex = it->second;
+  _slotMapper.erase(it);
+
+  Slot& slot = _slots[slotIndex];
+  auto& actors = _groups[slot.group];
+  auto& slots = _groupSlots[slot.group];
+  const uint32_t denseIndex = slot.denseIndex;
+
+  // Move the last actor of this group into the hole.
+  shared_ptr<DynamicActor> erasedActor = std::move(actors[denseIndex]);
+  if (denseIndex != actors.size() - 1) {
+    actors[denseIndex] = std::move(actors.back());
+    slots[denseIndex] = slots.back();
+    _slots[slots[denseIndex]].denseIndex = denseIndex;
+  }
+  actors.pop_back();
+  slots.pop_back();
+
+  // Invalidate all outstanding handles to this slot,
+  // and then put it back onto the free list.
+  slot.generation++;
+  slot.denseIndex = _freeSlot;
+  _freeSlot = slotIndex;
+  return erasedActor;
+}
+
+bool ActorRegistry::contains(const DynamicActor* actor) const {
+  return _slotMapper.find(actor) != _slotMapper.end();
+}
+
+void ActorRegistry::clear() {
+  for (auto& actors : _groups) {
+    actors.clear();
+  }
+  for (auto& slots : _groupSlots) {
+    slots.clear();
+  }
+  _slotMapper.clear();
+
+  // Keep the slots around (instead of clearing them) so that
+  // the handles to the cleared actors won't be reused.
+  _freeSlot = INVALID_SLOT;
+  for (uint32_t i = 0; i < _slots.size(); i++) {
+    _slots[i].generation++;
+    _slots[i].denseIndex = _freeSlot;
+    _freeSlot = i;
+  }
+  _cellStarts.assign(_cellStarts.size(), 0);
+  _cellEntries.clear();
+}
+
+
+DynamicActor* ActorRegistry::get(ActorRegistry::Handle handle) const {
+  if (!isValid(handle)) {
+    return nullptr;
+  }
+  const Slot& slot = _slots[handle.index];
+  return _groups[slot.group][slot.denseIndex].get();
+}
+
+ActorRegistry::Handle ActorRegistry::getHandle(const DynamicActor* actor) const {
+  auto it = _slotMapper.find(actor);
+  if (it == _slotMapper.end()) {
+    return {INVALID_SLOT, 0};
+  }
+  return {it->second, _slots[it->second].generation};
+}
+
+bool ActorRegistry::isValid(ActorRegistry::Handle handle) const {
+  return handle.index < _slots.size() &&
+         _slots[handle.index].generation == handle.generation;
+}
+
+
+size_t ActorRegistry::size() const {
+  return _slotMapper.size();
+}
+
+bool ActorRegistry::empty() const {
+  return _slotMapper.empty();
+}
+
+const vector<shared_ptr<DynamicActor>>& ActorRegistry::getGroup(ActorRegistry::Group group) const {
+  return _groups[group];
+}
+
+
+void ActorRegistry::rebuildSpatialIndex() {
+  // Counting sort all actors with a b2Body by the cell they are in,
+  // so that the entries of each cell are contiguous in _cellEntries.
+  const size_t numCells = _cellStarts.size() - 1;
+  _cellStarts.assign(numCells + 1, 0);
+
+  size_t numEntries = 0;
+  for (const auto& actors : _groups) {
+    for (const auto& actor : actors) {
+      const b2Body* body = actor->getBody();
+      if (body) {
+        const b2Vec2& pos = body->GetPosition();
+        _cellStarts[getCellIndex(pos.x, pos.y) + 1]++;
+        numEntries++;
+      }
+    }
+  }
+
+  for (size_t i = 1; i <= numCells; i++) {
+    _cellStarts[i] += _cellStarts[i - 1];
+  }
+
+  _cellEntries.resize(numEntries);
+  vector<uint32_t> cursors(_cellStarts.begin(), _cellStarts.end() - 1);
+
+  for (int group = 0; group < Group::SIZE; group++) {
+    for (const auto& actor : _groups[group]) {
+      const b2Body* body = actor->getBody();
+      if (body) {
+        const b2Vec2& pos = body->GetPosition();
+        const int cellIndex = getCellIndex(pos.x, pos.y);
+        _cellEntries[cursors[cellIndex]++] = {actor.get(), pos, static_cast<Group>(group)};
+      }
+    }
+  }
+}
+
+void ActorRegistry::queryRadius(const b2Vec2& center,
+                                float radius,
+                                ActorRegistry::Group group,
+                                vector<DynamicActor*>& result) const {
+  const int minCellX = clampCellX(center.x - radius);
+  const int maxCellX = clampCellX(center.x + radius);
+  const int minCellY = clampCellY(center.y - radius);
+  const int maxCellY = clampCellY(center.y + radius);
+  const float radiusSquared = radius * radius;
+
+  for (int y = minCellY; y <= maxCellY; y++) {
+    for (int x = minCellX; x <= maxCellX; x++) {
+      const int cellIndex = y * _numCellsX + x;
+      for (uint32_t i = _cellStarts[cellIndex]; i < _cellStarts[cellIndex + 1]; i++) {
+        const Entry& entry = _cellEntries[i];
+        if (entry.group == group &&
+            (entry.position - center).LengthSquared() <= radiusSquared) {
+          result.push_back(entry.actor);
+        }
+      }
+    }
+  }
+}
+
+
+ActorRegistry::Group ActorRegistry::getGroupOf(const DynamicActor* actor) {
+  if (dynamic_cast<const Npc*>(actor)) {
+    return Group::NPC;
+  } else if (dynamic_cast<const Item*>(actor)) {
+    return Group::ITEM;
+  } else if (dynamic_cast<const Chest*>(actor)) {
+    return Group::CHEST;
+  }
+  return Group::OTHER;
+}
+
+int ActorRegistry::getCellIndex(float x, float y) const {
+  return clampCellY(y) * _numCellsX + clampCellX(x);
+}
+
+int ActorRegistry::clampCellX(float x) const {
+  // Actors outside of the bounds are put into the cells on the border.
+  return std::min(std::max(static_cast<int>(std::floor(x / _kCellSize)), 0), _numCellsX - 1);
+}
+
+int ActorRegistry::clampCellY(float y) const {
+  return std::min(std::max(static_cast<int>(std::floor(y / _kCellSize)), 0), _numCellsY - 1);
+}
+
+}  // namespace vigilante
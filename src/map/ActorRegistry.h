@@ -0,0 +1,130 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_ACTOR_REGISTRY_H_
+#define VIGILANTE_ACTOR_REGISTRY_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+#include "DynamicActor.h"
+
+namespace vigilante {
+
+// A dense, contiguous registry of the DynamicActors shown on a GameMap.
+//
+// Actors are grouped by their concrete type, and each group is stored in
+// a contiguous vector, so that updating them is a linear sweep. Removal
+// swaps the last actor of the group into the hole, so the order of iteration
+// is not stable, but handles are: a Handle stays valid until the actor
+// it refers to is erased, after which get() returns nullptr.
+//
+// The registry also maintains a uniform-grid spatial index of the actors'
+// b2Body positions, which is rebuilt once per frame by rebuildSpatialIndex().
+class ActorRegistry final {
+ public:
+  enum Group {
+    NPC,
+    ITEM,
+    CHEST,
+    OTHER,
+    SIZE
+  };
+
+  struct Handle final {
+    uint32_t index;
+    uint32_t generation;
+  };
+
+  ActorRegistry();
+
+  // Resets the bounds (in meters) covered by the spatial index.
+  void setBounds(float width, float height);
+
+  Handle insert(std::shared_ptr<DynamicActor> actor);
+  std::shared_ptr<DynamicActor> erase(const DynamicActor* actor);
+  bool contains(const DynamicActor* actor) const;
+  void clear();
+
+  DynamicActor* get(Handle handle) const;
+  Handle getHandle(const DynamicActor* actor) const;
+  bool isValid(Handle handle) const;
+
+  size_t size() const;
+  bool empty() const;
+  const std::vector<std::shared_ptr<DynamicActor>>& getGroup(ActorRegistry::Group group) const;
+
+  // Invokes `func` with each registered actor, one group after another.
+  // `func` may insert actors (e.g., a skill which spawns a projectile),
+  // but it must not erase any actor.
+  template <typename Func>
+  void forEach(Func&& func) const;
+
+  // Same as forEach(), but only visits the actors of `group`.
+  template <typename Func>
+  void forEachInGroup(ActorRegistry::Group group, Func&& func) const;
+
+  // Spatial index.
+  void rebuildSpatialIndex();
+  void queryRadius(const b2Vec2& center,
+                   float radius,
+                   ActorRegistry::Group group,
+                   std::vector<DynamicActor*>& result) const;
+
+  static const float _kCellSize;  // in meters
+
+ private:
+  struct Slot final {
+    uint32_t generation;
+    ActorRegistry::Group group;
+    uint32_t denseIndex;  // index into _groups[group], or the next free slot
+  };
+
+  struct Entry final {
+    DynamicActor* actor;
+    b2Vec2 position;
+    ActorRegistry::Group group;
+  };
+
+  static ActorRegistry::Group getGroupOf(const DynamicActor* actor);
+  int getCellIndex(float x, float y) const;
+  int clampCellX(float x) const;
+  int clampCellY(float y) const;
+
+  std::array<std::vector<std::shared_ptr<DynamicActor>>, Group::SIZE> _groups;
+  std::array<std::vector<uint32_t>, Group::SIZE> _groupSlots;  // dense index -> slot index
+  std::vector<ActorRegistry::Slot> _slots;
+  uint32_t _freeSlot;
+  std::unordered_map<const DynamicActor*, uint32_t> _slotMapper;
+
+  int _numCellsX;
+  int _numCellsY;
+  std::vector<uint32_t> _cellStarts;  // _cellStarts[i]..[i+1] is the range in _cellEntries
+  std::vector<ActorRegistry::Entry> _cellEntries;
+};
+
+
+
+template <typename Func>
+void ActorRegistry::forEach(Func&& func) const {
+  for (int group = 0; group < Group::SIZE; group++) {
+    forEachInGroup(static_cast<Group>(group), func);
+  }
+}
+
+template <typename Func>
+void ActorRegistry::forEachInGroup(ActorRegistry::Group group, Func&& func) const {
+  // Note that the group may grow while we are iterating it,
+  // so we cannot use iterators or a range-based for loop here.
+  const auto& actors = _groups[group];
+  for (size_t i = 0; i < actors.size(); i++) {
+    DynamicActor* actor = actors[i].get();
+    func(actor);
+  }
+}
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_ACTOR_REGISTRY_H_
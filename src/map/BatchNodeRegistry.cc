@@ -0,0 +1,92 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "BatchNodeRegistry.h"
+
+#include <algorithm>
+
+#include "util/TraceProfiler.h"
+
+#define SLICE_SIZE 32  // the number of children of a batch node updated by one job
+
+using cocos2d::GLProgramState;
+using cocos2d::Sprite;
+using cocos2d::SpriteBatchNode;
+using cocos2d::Texture2D;
+
+namespace vigilante {
+
+BatchNodeRegistry::BatchNodeRegistry(RenderBuckets* renderBuckets)
+    : _renderBuckets(renderBuckets),
+      _batchNodes(),
+      _slices() {}
+
+
+void BatchNodeRegistry::addChild(Sprite* sprite, int zOrder, GLProgramState* programState) {
+  getBatchNode(sprite->getTexture(), zOrder, programState)->addChild(sprite);
+}
+
+SpriteBatchNode* BatchNodeRegistry::getBatchNode(Texture2D* texture, int zOrder,
+                                                 GLProgramState* programState) {
+  const Key key = std::make_tuple(texture, zOrder, programState);
+  auto it = _batchNodes.find(key);
+  if (it != _batchNodes.end()) {
+    return it->second;
+  }
+
+  SpriteBatchNode* batchNode = SpriteBatchNode::createWithTexture(texture);
+  batchNode->getTexture()->setAliasTexParameters();  // disable texture antialiasing
+  if (programState) {
+    batchNode->setGLProgramState(programState);
+  }
+  _renderBuckets->get(zOrder)->addChild(batchNode);
+  _batchNodes.insert({key, batchNode});
+  return batchNode;
+}
+
+void BatchNodeRegistry::updateTransforms(JobPool& jobPool) {
+  VGTRACE_ZONE("BatchNodeRegistry::updateTransforms");
+
+  // Sorting the children may move their quads within the atlas,
+  // so all batch nodes are sorted on the main thread first.
+  _slices.clear();
+  for (const auto& entry : _batchNodes) {
+    SpriteBatchNode* batchNode = entry.second;
+    if (!batchNode->isVisible()) {
+      continue;
+    }
+    batchNode->sortAllChildren();
+
+    const size_t numChildren = batchNode->getChildrenCount();
+    for (size_t begin = 0; begin < numChildren; begin += SLICE_SIZE) {
+      _slices.push_back({batchNode, begin, std::min(begin + SLICE_SIZE, numChildren)});
+    }
+  }
+
+  // Each child (along with its own children) only writes its own quads
+  // into the atlas of its batch node, at the indices assigned when it was
+  // added. The quad count and the dirty flag of the atlas are written too,
+  // but each child sets them to the value they already have by now.
+  jobPool.parallelFor(_slices.size(), [this](size_t i) {
+    const Slice& slice = _slices[i];
+    const auto& children = slice.batchNode->getChildren();
+    for (size_t j = slice.begin; j < slice.end; j++) {
+      children.at(j)->updateTransform();
+    }
+  });
+}
+
+void BatchNodeRegistry::removeEmptyBatchNodes() {
+  for (auto it = _batchNodes.begin(); it != _batchNodes.end();) {
+    if (it->second->getChildrenCount() == 0) {
+      it->second->removeFromParent();
+      it = _batchNodes.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t BatchNodeRegistry::getNumBatchNodes() const {
+  return _batchNodes.size();
+}
+
+}  // namespace vigilante
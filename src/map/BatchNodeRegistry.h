@@ -0,0 +1,78 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_BATCH_NODE_REGISTRY_H_
+#define VIGILANTE_BATCH_NODE_REGISTRY_H_
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <cocos2d.h>
+#include "map/RenderBuckets.h"
+#include "util/JobPool.h"
+
+namespace vigilante {
+
+// The SpriteBatchNodes shared by all actors on the same graphical layer.
+//
+// There's one batch node per (texture, graphical layer, shader) tuple, so the sprites
+// whose frames come from the same atlas page (see scripts/AtlasPacker.py)
+// are drawn in a single draw call, no matter how many characters there are.
+// The batch nodes are added to the render bucket of their graphical layer
+// (see RenderBuckets) when they're created.
+//
+// A sprite can only be batched if all of its frames are on the same atlas
+// page, which is guaranteed by AtlasPacker.py for each texture directory.
+//
+// The quads of a batch node are normally regenerated by SpriteBatchNode::draw()
+// during the visit of the scene graph, one sprite after another on the main
+// thread, which grows with the crowds. updateTransforms() regenerates the quads
+// of all batch nodes ahead of the visit with a JobPool instead, so that draw()
+// only finds clean sprites, and just submits one BatchCommand per batch node
+// in z order as usual.
+//
+// All methods must be called on the main thread.
+class BatchNodeRegistry final {
+ public:
+  explicit BatchNodeRegistry(RenderBuckets* renderBuckets);
+
+  // Adds `sprite` to the batch node of its texture on graphical layer `zOrder`.
+  // If `programState` is given (e.g., see PaletteSwap), the sprite will be drawn
+  // with it instead of the default shader. To remove the sprite, simply call
+  // sprite->removeFromParent().
+  void addChild(cocos2d::Sprite* sprite, int zOrder,
+                cocos2d::GLProgramState* programState=nullptr);
+
+  cocos2d::SpriteBatchNode* getBatchNode(cocos2d::Texture2D* texture, int zOrder,
+                                         cocos2d::GLProgramState* programState=nullptr);
+
+  // Regenerates the quads of the dirty sprites of all batch nodes
+  // in parallel. Called once per frame, after the sprites have been
+  // synced with their bodies (see GameMapManager::update()).
+  void updateTransforms(JobPool& jobPool);
+
+  // Removes the batch nodes which no longer have any children
+  // from their buckets, so that their textures can be released.
+  void removeEmptyBatchNodes();
+
+  // Each batch node is one draw call.
+  size_t getNumBatchNodes() const;
+
+ private:
+  RenderBuckets* _renderBuckets;
+
+  // (texture, zOrder, programState) -> batch node
+  using Key = std::tuple<cocos2d::Texture2D*, int, cocos2d::GLProgramState*>;
+  std::map<BatchNodeRegistry::Key, cocos2d::SpriteBatchNode*> _batchNodes;
+
+  // A contiguous range of the children of a batch node, updated by one job.
+  struct Slice final {
+    cocos2d::SpriteBatchNode* batchNode;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<BatchNodeRegistry::Slice> _slices;  // reused across frames
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_BATCH_NODE_REGISTRY_H_
@@ -0,0 +1,143 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "DormantWorld.h"
+
+#include <algorithm>
+
+#include "util/ThreadPool.h"
+
+using std::lock_guard;
+using std::mutex;
+
+namespace vigilante {
+
+const float DormantWorld::_kTickInterval = 1.0f;
+const float DormantWorld::_kRespawnTime = 180.0f;
+const float DormantWorld::_kRestockTime = 600.0f;
+
+DormantWorld* DormantWorld::getInstance() {
+  static DormantWorld instance;
+  return &instance;
+}
+
+DormantWorld::DormantWorld()
+    : _mutex(),
+      _mapRecords(),
+      _pendingTime(),
+      _isTickInFlight() {}
+
+void DormantWorld::update(float delta) {
+  _pendingTime += delta;
+  if (_pendingTime < _kTickInterval || _isTickInFlight) {
+    return;
+  }
+
+  const float elapsedTime = _pendingTime;
+  _pendingTime = 0;
+  _isTickInFlight = true;
+  ThreadPool::getInstance()->post([this, elapsedTime]() {
+    tick(elapsedTime);
+  }, [this]() {
+    _isTickInFlight = false;
+  });
+}
+
+
+void DormantWorld::onNpcKilled(AssetId tmxMapId, int npcIndex) {
+  lock_guard<mutex> lock(_mutex);
+  auto& respawns = _mapRecords[tmxMapId].respawns;
+  auto it = std::find_if(respawns.begin(), respawns.end(), [npcIndex](const Timer& timer) {
+    return timer.npcIndex == npcIndex;
+  });
+  if (it != respawns.end()) {
+    it->remainingTime = _kRespawnTime;
+  } else {
+    respawns.push_back({npcIndex, _kRespawnTime});
+  }
+}
+
+bool DormantWorld::isRespawnPending(AssetId tmxMapId, int npcIndex) const {
+  lock_guard<mutex> lock(_mutex);
+  auto it = _mapRecords.find(tmxMapId);
+  if (it == _mapRecords.end()) {
+    return false;
+  }
+  const auto& respawns = it->second.respawns;
+  return std::any_of(respawns.begin(), respawns.end(), [npcIndex](const Timer& timer) {
+    return timer.npcIndex == npcIndex;
+  });
+}
+
+void DormantWorld::storeMerchantStock(AssetId tmxMapId, int npcIndex, DormantWorld::Stock stock) {
+  lock_guard<mutex> lock(_mutex);
+  auto& merchantStocks = _mapRecords[tmxMapId].merchantStocks;
+  auto it = std::find_if(merchantStocks.begin(), merchantStocks.end(),
+                         [npcIndex](const MerchantStock& merchantStock) {
+    return merchantStock.npcIndex == npcIndex;
+  });
+
+  // The restock timer keeps running across the visits.
+  if (it != merchantStocks.end()) {
+    it->stock = std::move(stock);
+    it->isTaken = false;
+  } else {
+    merchantStocks.push_back({npcIndex, _kRestockTime, std::move(stock), /*isTaken=*/false});
+  }
+}
+
+bool DormantWorld::takeMerchantStock(AssetId tmxMapId, int npcIndex, DormantWorld::Stock& stock) {
+  lock_guard<mutex> lock(_mutex);
+  auto recordIt = _mapRecords.find(tmxMapId);
+  if (recordIt == _mapRecords.end()) {
+    return false;
+  }
+  auto& merchantStocks = recordIt->second.merchantStocks;
+  auto it = std::find_if(merchantStocks.begin(), merchantStocks.end(),
+                         [npcIndex](const MerchantStock& merchantStock) {
+    return merchantStock.npcIndex == npcIndex;
+  });
+  if (it == merchantStocks.end() || it->isTaken) {
+    return false;
+  }
+  stock = std::move(it->stock);
+  it->stock.clear();
+  it->isTaken = true;
+  return true;
+}
+
+void DormantWorld::clear() {
+  lock_guard<mutex> lock(_mutex);
+  _mapRecords.clear();
+  _pendingTime = 0;
+}
+
+
+void DormantWorld::tick(float elapsedTime) {
+  lock_guard<mutex> lock(_mutex);
+  for (auto it = _mapRecords.begin(); it != _mapRecords.end();) {
+    MapRecord& record = it->second;
+
+    for (auto& timer : record.respawns) {
+      timer.remainingTime -= elapsedTime;
+    }
+    record.respawns.erase(std::remove_if(record.respawns.begin(), record.respawns.end(),
+                                         [](const Timer& timer) {
+      return timer.remainingTime <= 0;
+    }), record.respawns.end());
+
+    for (auto& merchantStock : record.merchantStocks) {
+      merchantStock.remainingTime -= elapsedTime;
+    }
+    record.merchantStocks.erase(std::remove_if(record.merchantStocks.begin(), record.merchantStocks.end(),
+                                               [](const MerchantStock& merchantStock) {
+      return merchantStock.remainingTime <= 0;
+    }), record.merchantStocks.end());
+
+    if (record.respawns.empty() && record.merchantStocks.empty()) {
+      it = _mapRecords.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,87 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_DORMANT_WORLD_H_
+#define VIGILANTE_DORMANT_WORLD_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "util/AssetId.h"
+
+namespace vigilante {
+
+// A cheap abstract simulation of the maps which aren't loaded.
+//
+// A GameMap is destroyed once the player leaves it, so instead of its actors
+// only a compact record of each map is kept here, and its timers keep running:
+//
+// - the respawnable Npcs which have been killed there, and when they'll respawn
+//   (before this, they were back as soon as the map was entered again);
+// - the goods of its merchants, which are kept until they restock
+//   (before this, a merchant restocked whenever the map was entered again).
+//
+// The Npcs are referred to by their indices in the map's GameMapSpec::npcs,
+// and the records are materialized into the actors by GameMap as it's entered.
+// The records are advanced every _kTickInterval on a worker thread, so only
+// the accumulation of the elapsed time is left on the main thread.
+//
+// The records aren't saved, i.e., a loaded game starts with an idle world.
+// All methods must be called on the main thread.
+class DormantWorld final {
+ public:
+  using Stock = std::vector<std::pair<std::string, int>>;  // item json -> amount
+
+  static DormantWorld* getInstance();
+
+  // Called once per frame while the game isn't paused.
+  void update(float delta);
+
+  void onNpcKilled(AssetId tmxMapId, int npcIndex);
+  bool isRespawnPending(AssetId tmxMapId, int npcIndex) const;
+
+  void storeMerchantStock(AssetId tmxMapId, int npcIndex, DormantWorld::Stock stock);
+  // Moves the stock of the merchant into `stock`. Returns false if
+  // it hasn't been stored, or if the merchant has restocked since then.
+  bool takeMerchantStock(AssetId tmxMapId, int npcIndex, DormantWorld::Stock& stock);
+
+  void clear();
+
+  static const float _kTickInterval;
+  static const float _kRespawnTime;
+  static const float _kRestockTime;
+
+ private:
+  struct Timer final {
+    int npcIndex;
+    float remainingTime;
+  };
+
+  struct MerchantStock final {
+    int npcIndex;
+    float remainingTime;
+    DormantWorld::Stock stock;
+    bool isTaken;  // whether `stock` has been handed to the merchant shown on the map
+  };
+
+  struct MapRecord final {
+    std::vector<DormantWorld::Timer> respawns;
+    std::vector<DormantWorld::MerchantStock> merchantStocks;
+  };
+
+  DormantWorld();
+
+  // Runs on a worker thread.
+  void tick(float elapsedTime);
+
+  mutable std::mutex _mutex;  // guards _mapRecords
+  std::unordered_map<AssetId, DormantWorld::MapRecord> _mapRecords;
+
+  float _pendingTime;
+  bool _isTickInFlight;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_DORMANT_WORLD_H_
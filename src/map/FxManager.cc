@@ -5,12 +5,16 @@
 #include "StaticActor.h"
 #include "DynamicActor.h"
 #include "character/Character.h"
+#include "gameplay/CameraSystem.h"
 #include "map/GameMapManager.h"
+#include "util/Headless.h"
+#include "util/MainThread.h"
+
+#define FX_SPRITE_POOL_MAX_SIZE 32  // per texture
+#define FX_VIEW_MARGIN .5f  // in meters
 
 using std::string;
-using cocos2d::FileUtils;
-using cocos2d::Layer;
-using cocos2d::Vector;
+using std::vector;
 using cocos2d::Sequence;
 using cocos2d::CallFunc;
 using cocos2d::FiniteTimeAction;
@@ -20,7 +24,6 @@ using cocos2d::Action;
 using cocos2d::Animate;
 using cocos2d::Animation;
 using cocos2d::Sprite;
-using cocos2d::SpriteBatchNode;
 using cocos2d::SpriteFrame;
 using cocos2d::SpriteFrameCache;
 
@@ -33,7 +36,12 @@ FxManager* FxManager::getInstance() {
 
 
 void FxManager::createDustFx(Character* c) {
+  // Nobody would see it.
   const b2Vec2& feetPos = c->getBody()->GetPosition();
+  if (!CameraSystem::getInstance()->isInView(feetPos, FX_VIEW_MARGIN)) {
+    return;
+  }
+
   float x = feetPos.x * kPpm;
   float y = (feetPos.y - .1f) * kPpm;
 
@@ -50,14 +58,31 @@ Sprite* FxManager::createHintBubbleFx(const b2Body* body,
 }
 
 
+size_t FxManager::getNumCachedAnimations() const {
+  return _animationCache.size();
+}
+
+size_t FxManager::getNumPooledSprites() const {
+  size_t numSprites = 0;
+  for (const auto& p : _spritePool) {
+    numSprites += p.second.size();
+  }
+  return numSprites;
+}
+
+
 Sprite* FxManager::createFx(const string& textureResDir,
                             const string& framesName,
                             float x,
                             float y,
                             unsigned int loopCount,
                             float frameInterval) {
+  VGASSERT_MAIN_THREAD();
+  if (headless::isEnabled()) {
+    return nullptr;
+  }
+
   bool shouldRepeatForever = loopCount == (unsigned int) -1;
-  Layer* gameMapLayer = GameMapManager::getInstance()->getLayer();
 
   // If the cocos2d::Animation* is not present in cache,
   // then create one and cache this animation object.
@@ -77,15 +102,11 @@ Sprite* FxManager::createFx(const string& textureResDir,
   }
 
   // Select the first frame (e.g., dust_white/0.png) as the default look of the sprite.
-  Sprite* sprite = Sprite::createWithSpriteFrameName(framesNamePrefix + "_" +
-                                                     framesName + "/0.png");
+  SpriteFrame* spriteFrame = SpriteFrameCache::getInstance()->getSpriteFrameByName(
+      framesNamePrefix + "_" + framesName + "/0.png");
+  Sprite* sprite = acquireSprite(spriteFrame);
   sprite->setPosition(x, y);
-
-  string spritesheetFileName = FxManager::getSpritesheetFileName(textureResDir);
-  SpriteBatchNode* spritesheet = SpriteBatchNode::create(spritesheetFileName);
-  spritesheet->addChild(sprite);
-  spritesheet->getTexture()->setAliasTexParameters();
-  gameMapLayer->addChild(spritesheet, graphical_layers::kFx);
+  GameMapManager::getInstance()->getBatchNodeRegistry()->addChild(sprite, graphical_layers::kFx);
 
   // Run animation.
   Animate* animate = Animate::create(_animationCache[cacheKey]);
@@ -94,8 +115,8 @@ Sprite* FxManager::createFx(const string& textureResDir,
     sprite->runAction(RepeatForever::create(animate));
 
   } else {
-    auto cleanup = [gameMapLayer, spritesheet]() {
-      gameMapLayer->removeChild(spritesheet);
+    auto cleanup = [this, sprite]() {
+      recycleSprite(sprite);
     };
     sprite->runAction(Sequence::createWithTwoActions(
         Repeat::create(animate, loopCount),
@@ -108,15 +129,45 @@ Sprite* FxManager::createFx(const string& textureResDir,
 }
 
 void FxManager::removeFx(Sprite* sprite) {
-  sprite->stopAllActions();
-  sprite->removeFromParent();
+  VGASSERT_MAIN_THREAD();
+  recycleSprite(sprite);
+}
+
+
+Sprite* FxManager::acquireSprite(SpriteFrame* spriteFrame) {
+  vector<Sprite*>& pool = _spritePool[spriteFrame->getTexture()];
+  if (pool.empty()) {
+    return Sprite::createWithSpriteFrame(spriteFrame);
+  }
+
+  // The sprite is retained by the pool, and will be retained
+  // by its batch node once it's added to the map.
+  Sprite* sprite = pool.back();
+  pool.pop_back();
+  sprite->setSpriteFrame(spriteFrame);
+  sprite->setVisible(true);
+  sprite->setOpacity(255);
+  sprite->setScale(1.0f);
+  sprite->setFlippedX(false);
+  sprite->autorelease();
+  return sprite;
 }
 
-string FxManager::getSpritesheetFileName(const string& textureResDir) {
-  // Example: Texture/fx/dust/spritesheet.png
-  //          |_____________| |_____________|
-  //           textureResDir
-  return textureResDir + "/spritesheet.png";
+void FxManager::recycleSprite(Sprite* sprite) {
+  // It has already been recycled.
+  if (!sprite->getParent()) {
+    return;
+  }
+
+  vector<Sprite*>& pool = _spritePool[sprite->getTexture()];
+
+  // Keep the sprite alive after it's removed from its batch node.
+  if (pool.size() < FX_SPRITE_POOL_MAX_SIZE) {
+    sprite->retain();
+    pool.push_back(sprite);
+  }
+  sprite->stopAllActions();
+  sprite->removeFromParent();
 }
 
 }  // namespace vigilante
@@ -4,6 +4,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <cocos2d.h>
 #include <Box2D/Box2D.h>
@@ -13,6 +14,10 @@ namespace vigilante {
 // Forward Declaration
 class Character;
 
+// The fx sprites are pooled. Each fx texture has one persistent batch node
+// on graphical_layers::kFx (see BatchNodeRegistry), and the sprites which
+// have finished playing (or have been removed via removeFx()) are recycled
+// for the next fx using the same texture instead of being freed.
 class FxManager {
  public:
   static FxManager* getInstance();
@@ -24,6 +29,10 @@ class FxManager {
 
   void removeFx(cocos2d::Sprite* sprite);
 
+  // For MemoryTracker. The fx animations are never evicted.
+  size_t getNumCachedAnimations() const;
+  size_t getNumPooledSprites() const;
+
  private:
   FxManager() = default;
 
@@ -34,9 +43,13 @@ class FxManager {
                             unsigned int loopCount=1,
                             float frameInterval=10.0f);
 
-  static std::string getSpritesheetFileName(const std::string& textureResDir);
+  cocos2d::Sprite* acquireSprite(cocos2d::SpriteFrame* spriteFrame);
+  void recycleSprite(cocos2d::Sprite* sprite);
 
   std::unordered_map<std::string, cocos2d::Animation*> _animationCache;
+
+  // texture -> the recycled sprites which aren't shown on the map (retained).
+  std::unordered_map<cocos2d::Texture2D*, std::vector<cocos2d::Sprite*>> _spritePool;
 };
 
 }  // namespace vigilante
@@ -2,31 +2,44 @@
 #include "GameMap.h"
 
 #include <algorithm>
+#include <cmath>
+#include <new>
 #include <thread>
 
 #include "std/make_unique.h"
 #include "AssetManager.h"
 #include "CallbackManager.h"
 #include "Constants.h"
+#include "TextureLoader.h"
 #include "character/Character.h"
 #include "character/Player.h"
 #include "character/Npc.h"
 #include "character/Party.h"
+#include "character/NpcPool.h"
+#include "gameplay/ScriptRunner.h"
+#include "input/InputManager.h"
 #include "item/Equipment.h"
 #include "item/Consumable.h"
 #include "item/Key.h"
+#include "map/DormantWorld.h"
 #include "map/FxManager.h"
 #include "map/GameMapManager.h"
+#include "map/WorldEpoch.h"
+#include "map/WorldState.h"
 #include "map/object/Chest.h"
 #include "ui/Colorscheme.h"
 #include "ui/Shade.h"
-#include "ui/console/Console.h"
 #include "ui/control_hints/ControlHints.h"
 #include "ui/notifications/Notifications.h"
 #include "util/box2d/b2BodyBuilder.h"
+#include "util/DeferredTaskScheduler.h"
+#include "util/LoadProfiler.h"
+#include "util/ProfileCache.h"
 #include "util/StringUtil.h"
 #include "util/RandUtil.h"
 
+#define ITEM_STACK_RADIUS .5f  // in meters
+
 using std::pair;
 using std::vector;
 using std::unordered_set;
@@ -37,7 +50,7 @@ using std::shared_ptr;
 using cocos2d::Color4B;
 using cocos2d::Director;
 using cocos2d::TMXTiledMap;
-using cocos2d::TMXObjectGroup;
+using cocos2d::TMXMapInfo;
 using cocos2d::Sequence;
 using cocos2d::FadeIn;
 using cocos2d::FadeOut;
@@ -46,29 +59,98 @@ using cocos2d::EventKeyboard;
 
 namespace vigilante {
 
+namespace {
+
+// TMXTiledMap::buildWithMapInfo() is protected, so we need this thin
+// subclass to build a TMXTiledMap from an already-parsed TMXMapInfo
+// without parsing the .tmx file a second time on the main thread.
+class PrebuiltTmxTiledMap : public TMXTiledMap {
+ public:
+  static TMXTiledMap* create(TMXMapInfo* mapInfo, const string& tmxMapFileName) {
+    PrebuiltTmxTiledMap* ret = new (std::nothrow) PrebuiltTmxTiledMap();
+    if (ret) {
+      ret->setContentSize(cocos2d::Size::ZERO);
+      ret->buildWithMapInfo(mapInfo);
+      ret->_tmxFile = tmxMapFileName;
+      ret->autorelease();
+    }
+    return ret;
+  }
+};
+
+}  // namespace
+
 GameMap::Portal::StateMap GameMap::Portal::_allPortalStates;
 
-GameMap::GameMap(b2World* world, const string& tmxMapFileName)
+const float GameMap::_kChunkWidth = kVirtualWidth;
+bool GameMap::_isLootBagEnabled = false;
+
+GameMap::GameMap(b2World* world, shared_ptr<GameMapSpec> spec, TMXTiledMap* tmxTiledMap)
     : _world(world),
-      _tmxTiledMap(TMXTiledMap::create(tmxMapFileName)),
-      _tmxTiledMapFileName(tmxMapFileName),
+      _spec(std::move(spec)),
+      _tmxTiledMapBodies(),
+      _tmxTiledMap((tmxTiledMap) ? tmxTiledMap : buildTmxTiledMap(*_spec)),
+      _tmxTiledMapFileName(_spec->tmxMapFileName),
+      _tmxTiledMapId(_tmxTiledMapFileName),
+      _tileChunkRenderer(std::make_unique<TileChunkRenderer>(_tmxTiledMap)),
       _dynamicActors(),
+      _recentlyDroppedItems(),
       _triggers(),
-      _portals() {}
+      _sortedTriggers(),
+      _maxTriggerWidth(),
+      _hasNonPlayerTriggers(),
+      _portals(),
+      _chunks(),
+      _queuedSpawns(),
+      _npcIndices() {}
+
+TMXTiledMap* GameMap::buildTmxTiledMap(const GameMapSpec& spec) {
+  return PrebuiltTmxTiledMap::create(spec.getTmxMapInfo(), spec.tmxMapFileName);
+}
 
 
 void GameMap::createObjects() {
-  // Create box2d objects from layers.
-  createPolylines("Ground", category_bits::kGround, true, kGroundFriction);
-  createPolylines("Wall", category_bits::kWall, true, kWallFriction);
-  createRectangles("Platform", category_bits::kPlatform, true, kGroundFriction);
-  createPolylines("PivotMarker", category_bits::kPivotMarker, false, 0);
-  createPolylines("CliffMarker", category_bits::kCliffMarker, false, 0);
+  LoadProfiler::ScopedTimer timer(LoadProfiler::Section::MAP_OBJECTS);
+
+  _dynamicActors.setBounds(getWidth() / kPpm, getHeight() / kPpm);
+
+  if (isStreamed()) {
+    _chunks.resize(static_cast<size_t>(std::ceil(getWidth() / _kChunkWidth)) + 1);
+  }
+
+  // Create box2d objects from layers. All of the vertices have been
+  // prepared by GameMapSpec::create(), so all we need to do here
+  // is to commit them to the b2World, in one batch. If the map has a tile
+  // collision grid, then the terrain is handled by TileCollider instead,
+  // and only the markers are committed.
+  vector<b2BatchBuilder::BodySpec> bodySpecs;
+  vector<b2BatchBuilder::FixtureSpec> fixtureSpecs;
+  for (int i = 0; i < GameMapSpec::StaticLayerType::SIZE; i++) {
+    if (hasTileCollisionGrid() && (i == GameMapSpec::StaticLayerType::GROUND ||
+                                   i == GameMapSpec::StaticLayerType::WALL ||
+                                   i == GameMapSpec::StaticLayerType::PLATFORM)) {
+      continue;
+    }
+    appendStaticLayer(_spec->staticLayers[i], bodySpecs, fixtureSpecs);
+  }
+
+  vector<b2Body*> bodies;
+  b2BatchBuilder batchBuilder(_world, kPpm);
+  batchBuilder.build(bodySpecs.data(), bodySpecs.size(),
+                     fixtureSpecs.data(), fixtureSpecs.size(), &bodies);
+  batchBuilder.commit();
+  _tmxTiledMapBodies.insert(bodies.begin(), bodies.end());
 
   createTriggers();
   createPortals();
   createChests();
   createNpcs();
+  preloadItemIcons();
+
+  // The members waiting for their leader in this map are shown here.
+  if (Player* player = GameMapManager::getInstance()->getPlayer()) {
+    player->getParty()->wakeWaitingMembers(_tmxTiledMapId);
+  }
 }
 
 void GameMap::deleteObjects() {
@@ -78,35 +160,179 @@ void GameMap::deleteObjects() {
   }
 
   // Destroy DynamicActor's b2body and textures.
-  for (auto& actor : _dynamicActors) {
+  _dynamicActors.forEach([](DynamicActor* actor) {
     actor->removeFromMap();
+  });
+  _recentlyDroppedItems.clear();
+
+  // The Npcs may be reused by the next map, see NpcPool.
+  vector<DynamicActor*> npcs;
+  _dynamicActors.forEachInGroup(ActorRegistry::Group::NPC, [&npcs](DynamicActor* actor) {
+    npcs.push_back(actor);
+  });
+  for (auto npc : npcs) {
+    storeDormantState(static_cast<Npc*>(npc));
+    NpcPool::getInstance()->release(std::static_pointer_cast<Npc>(_dynamicActors.erase(npc)));
   }
 }
 
+void GameMap::resetObjects() {
+  _dynamicActors.forEach([](DynamicActor* actor) {
+    actor->removeFromMap();
+  });
+  _recentlyDroppedItems.clear();
+
+  // Unlike deleteObjects(), the dormant states of the Npcs aren't stored,
+  // since DormantWorld is restored along with the rest of the world.
+  vector<DynamicActor*> npcs;
+  _dynamicActors.forEachInGroup(ActorRegistry::Group::NPC, [&npcs](DynamicActor* actor) {
+    npcs.push_back(actor);
+  });
+  for (auto npc : npcs) {
+    NpcPool::getInstance()->release(std::static_pointer_cast<Npc>(_dynamicActors.erase(npc)));
+  }
+  _dynamicActors.clear();
+  _npcIndices.clear();
+  _queuedSpawns.clear();
+  _chunks.assign(_chunks.size(), Chunk{});
+
+  _sortedTriggers.clear();
+  _triggers.clear();
+  _maxTriggerWidth = 0;
+  _hasNonPlayerTriggers = false;
+  _portals.clear();  // destroys their bodies
+
+  createTriggers();
+  createPortals();
+  createChests();
+  createNpcs();
+}
+
 unique_ptr<Player> GameMap::createPlayer() const {
   auto player = std::make_unique<Player>(asset_manager::kPlayerJson);
 
-  const TMXObjectGroup* objGroup = _tmxTiledMap->getObjectGroup("Player");
-  const auto& valMap = objGroup->getObjects().at(0).asValueMap();
-  float x = valMap.at("x").asFloat();
-  float y = valMap.at("y").asFloat();
-
-  player->showOnMap(x, y);
+  player->showOnMap(_spec->playerSpawnPos.x, _spec->playerSpawnPos.y);
   return player;
 }
 
 Item* GameMap::createItem(const string& itemJson, float x, float y, int amount) {
-  Item* item = showDynamicActor<Item>(Item::create(itemJson), x, y);
-  item->setAmount(amount);
+  shared_ptr<Item> newItem = Item::create(itemJson);
 
-  float offsetX = rand_util::randFloat(-.3f, .3f);
-  float offsetY = 3.0f;
-  item->getBody()->ApplyLinearImpulse({offsetX, offsetY},
-                                      item->getBody()->GetWorldCenter(),
-                                      true);
+  if (Item* item = findStackableItem(newItem->getItemProfile(), {x / kPpm, y / kPpm})) {
+    item->setAmount(item->getAmount() + amount);
+    return item;
+  }
+
+  Item* item = showDynamicActor<Item>(std::move(newItem), x, y);
+  item->setAmount(amount);
+  applyDropImpulse(item);
+  _recentlyDroppedItems.push_back(item);
   return item;
 }
 
+void GameMap::createItems(const vector<pair<string, int>>& items, float x, float y) {
+  if (items.empty()) {
+    return;
+  }
+
+  // These are usually cached already, see preloadItemIcons().
+  for (const auto& item : items) {
+    const auto itemProfile = profile_cache::get<Item::Profile>(item.first);
+    TextureLoader::getInstance()->preload(Item::getIconPath(*itemProfile));
+  }
+
+  const world_epoch::Epoch epoch = world_epoch::current();
+  size_t nextIndex = 0;
+  DeferredTaskScheduler::getInstance()->post([this, items, x, y, epoch, nextIndex]() mutable {
+    // This GameMap may have been deleted since then.
+    if (!world_epoch::isCurrent(epoch)) {
+      return true;
+    }
+    const auto& item = items[nextIndex++];
+    createItem(item.first, x, y, item.second);
+    return nextIndex >= items.size();
+  });
+}
+
+void GameMap::dropLoot(const vector<pair<string, int>>& drops, float x, float y) {
+  if (!_isLootBagEnabled || drops.size() <= 1) {
+    createItems(drops, x, y);
+    return;
+  }
+
+  LootBag::Contents contents;
+  contents.reserve(drops.size());
+  for (const auto& drop : drops) {
+    contents.push_back({Item::create(drop.first), drop.second});
+  }
+
+  Item* lootBag = showDynamicActor<Item>(std::make_shared<LootBag>(std::move(contents)), x, y);
+  applyDropImpulse(lootBag);
+}
+
+bool GameMap::isLootBagEnabled() {
+  return _isLootBagEnabled;
+}
+
+void GameMap::setLootBagEnabled(bool lootBagEnabled) {
+  _isLootBagEnabled = lootBagEnabled;
+}
+
+void GameMap::queryDynamicActors(const b2Vec2& center,
+                                 float radius,
+                                 ActorRegistry::Group group,
+                                 vector<DynamicActor*>& result) const {
+  _dynamicActors.queryRadius(center, radius, group, result);
+}
+
+const ActorRegistry& GameMap::getDynamicActors() const {
+  return _dynamicActors;
+}
+
+void GameMap::spawnQueuedActors(const cocos2d::Vec2& center) {
+  if (_queuedSpawns.empty()) {
+    return;
+  }
+
+  vector<QueuedSpawn> queuedSpawns;
+  queuedSpawns.swap(_queuedSpawns);
+  std::sort(queuedSpawns.begin(), queuedSpawns.end(), [&center](const QueuedSpawn& lhs, const QueuedSpawn& rhs) {
+    return center.distanceSquared({lhs.x, lhs.y}) < center.distanceSquared({rhs.x, rhs.y});
+  });
+
+  // A replay has to see the same actors in the same frames as its recording,
+  // which the frame budget of the DeferredTaskScheduler doesn't guarantee.
+  const float radius = Director::getInstance()->getWinSize().width;
+  const bool isReplayRunning = InputManager::getInstance()->isReplayRunning();
+  size_t nextIndex = 0;
+  while (nextIndex < queuedSpawns.size() &&
+         (isReplayRunning ||
+          center.distanceSquared({queuedSpawns[nextIndex].x, queuedSpawns[nextIndex].y}) <= radius * radius)) {
+    spawn(queuedSpawns[nextIndex++]);
+  }
+  if (nextIndex == queuedSpawns.size()) {
+    return;
+  }
+
+  const world_epoch::Epoch epoch = world_epoch::current();
+  DeferredTaskScheduler::getInstance()->post(
+      [this, queuedSpawns = std::move(queuedSpawns), epoch, nextIndex]() mutable {
+    // This GameMap may have been deleted since then.
+    if (!world_epoch::isCurrent(epoch)) {
+      return true;
+    }
+    spawn(queuedSpawns[nextIndex++]);
+    return nextIndex >= queuedSpawns.size();
+  });
+}
+
+void GameMap::onNpcKilled(Npc* npc) {
+  auto it = _npcIndices.find(npc);
+  if (it != _npcIndices.end()) {
+    DormantWorld::getInstance()->onNpcKilled(_tmxTiledMapId, it->second);
+  }
+}
+
 
 unordered_set<b2Body*>& GameMap::getTmxTiledMapBodies() {
   return _tmxTiledMapBodies;
@@ -116,10 +342,22 @@ const string& GameMap::getTmxTiledMapFileName() const {
   return _tmxTiledMapFileName;
 }
 
+AssetId GameMap::getTmxTiledMapId() const {
+  return _tmxTiledMapId;
+}
+
 TMXTiledMap* GameMap::getTmxTiledMap() const {
   return _tmxTiledMap;
 }
 
+const shared_ptr<GameMapSpec>& GameMap::getSpec() const {
+  return _spec;
+}
+
+bool GameMap::hasTileCollisionGrid() const {
+  return !_spec->tileCollisionGrid.isEmpty();
+}
+
 float GameMap::getWidth() const {
   return _tmxTiledMap->getMapSize().width * _tmxTiledMap->getTileSize().width;
 }
@@ -129,169 +367,439 @@ float GameMap::getHeight() const {
 }
 
 
-void GameMap::createRectangles(const string& layerName, short categoryBits,
-                               bool collidable, float friction) {
-  TMXObjectGroup* objGroup = _tmxTiledMap->getObjectGroup(layerName);
-  //log("%s\n", _map->getProperty("backgroundMusic").asString().c_str());
-  
-  for (const auto& rectObj : objGroup->getObjects()) {
-    const auto& valMap = rectObj.asValueMap();
-    float x = valMap.at("x").asFloat();
-    float y = valMap.at("y").asFloat();
-    float w = valMap.at("width").asFloat();
-    float h = valMap.at("height").asFloat();
+void GameMap::appendStaticLayer(const GameMapSpec::StaticLayer& layer,
+                                vector<b2BatchBuilder::BodySpec>& bodySpecs,
+                                vector<b2BatchBuilder::FixtureSpec>& fixtureSpecs) const {
+  // Only read by WorldContactListener, and outlived by `_spec`.
+  void* userData = (layer.oneWay.isEnabled) ? const_cast<GameMapSpec::OneWay*>(&layer.oneWay) : nullptr;
+
+  b2BatchBuilder::FixtureSpec fixtureSpec{};
+  fixtureSpec.categoryBits = layer.categoryBits;
+  fixtureSpec.maskBits = static_cast<short>(0xFFFF);
+  fixtureSpec.isSensor = !layer.collidable;
+  fixtureSpec.friction = layer.friction;
+  fixtureSpec.userData = userData;
+
+  for (const auto& rect : layer.rectangles) {
+    bodySpecs.push_back({b2BodyType::b2_staticBody,
+                         {rect.x + rect.width / 2, rect.y + rect.height / 2},
+                         fixtureSpecs.size(), 1});
+
+    fixtureSpec.shape = b2BatchBuilder::FixtureSpec::Shape::RECTANGLE;
+    fixtureSpec.halfSize.Set(rect.width / 2, rect.height / 2);
+    fixtureSpecs.push_back(fixtureSpec);
+  }
+
+  if (layer.polylines.empty()) {
+    return;
+  }
+
+  // All the polylines of a layer share one static body, and each
+  // welded polyline becomes one b2ChainShape fixture of that body.
+  bodySpecs.push_back({b2BodyType::b2_staticBody, {0, 0}, fixtureSpecs.size(), layer.polylines.size()});
+
+  for (const auto& polyline : layer.polylines) {
+    fixtureSpec.shape = b2BatchBuilder::FixtureSpec::Shape::POLYLINE;
+    fixtureSpec.vertices = polyline.vertices.data();
+    fixtureSpec.numVertices = polyline.vertices.size();
+    fixtureSpecs.push_back(fixtureSpec);
+  }
+}
+
+void GameMap::createTriggers() {
+  for (int i = 0; i < static_cast<int>(_spec->triggers.size()); i++) {
+    const GameMapSpec::TriggerSpec& triggerSpec = _spec->triggers[i];
+    const GameMapSpec::Rectangle& rect = triggerSpec.rect;
+
+    b2AABB aabb;
+    aabb.lowerBound.Set(rect.x / kPpm, rect.y / kPpm);
+    aabb.upperBound.Set((rect.x + rect.width) / kPpm, (rect.y + rect.height) / kPpm);
+
+    _triggers.push_back(std::make_unique<GameMap::Trigger>(triggerSpec.cmds,
+                                                           triggerSpec.canBeTriggeredOnlyOnce,
+                                                           triggerSpec.canBeTriggeredOnlyByPlayer,
+                                                           aabb,
+                                                           _tmxTiledMapId,
+                                                           i));
+    if (WorldState::getInstance()->hasTriggered(_tmxTiledMapId, i)) {
+      _triggers.back()->setTriggered(true);
+    }
+
+    _sortedTriggers.push_back(_triggers.back().get());
+    _maxTriggerWidth = std::max(_maxTriggerWidth, aabb.upperBound.x - aabb.lowerBound.x);
+    _hasNonPlayerTriggers |= !triggerSpec.canBeTriggeredOnlyByPlayer;
+  }
+
+  std::sort(_sortedTriggers.begin(), _sortedTriggers.end(),
+            [](const GameMap::Trigger* t1, const GameMap::Trigger* t2) {
+    return t1->getAabb().lowerBound.x < t2->getAabb().lowerBound.x;
+  });
+}
 
+void GameMap::createPortals() {
+  for (const auto& portalSpec : _spec->portals) {
+    const GameMapSpec::Rectangle& rect = portalSpec.rect;
     b2BodyBuilder bodyBuilder(_world);
 
     b2Body* body = bodyBuilder.type(b2BodyType::b2_staticBody)
-      .position(x + w / 2, y + h / 2, kPpm)
+      .position(rect.x + rect.width / 2, rect.y + rect.height / 2, kPpm)
       .buildBody();
 
-    bodyBuilder.newRectangleFixture(w / 2, h / 2, kPpm)
-      .categoryBits(categoryBits)
-      .setSensor(!collidable)
-      .friction(friction)
+    _portals.push_back(std::make_unique<GameMap::Portal>(portalSpec.targetTmxMapFileName,
+                                                         portalSpec.targetPortalId,
+                                                         portalSpec.willInteractOnContact,
+                                                         portalSpec.isLocked,
+                                                         portalSpec.isSeamless,
+                                                         body,
+                                                         static_cast<int>(_portals.size())));
+
+    bodyBuilder.newRectangleFixture(rect.width / 2, rect.height / 2, kPpm)
+      .categoryBits(category_bits::kPortal)
+      .setSensor(true)
+      .friction(0)
+      .setUserData(_portals.back().get())
       .buildFixture();
+  }
+}
+
+void GameMap::createNpcs() {
+  const DormantWorld* dormantWorld = DormantWorld::getInstance();
+
+  for (int i = 0; i < static_cast<int>(_spec->npcs.size()); i++) {
+    const GameMapSpec::NpcSpec& npcSpec = _spec->npcs[i];
+    if (dormantWorld->isRespawnPending(_tmxTiledMapId, i)) {
+      continue;
+    }
 
-    _tmxTiledMapBodies.insert(body);
+    if (isStreamed()) {
+      // Instantiated later by activateChunk().
+      _chunks[getChunkIndex(npcSpec.x)].npcs.push_back({npcSpec.json, npcSpec.x, npcSpec.y, -1, i});
+    } else {
+      // Instantiated later by spawnQueuedActors().
+      _queuedSpawns.push_back({/*isNpc=*/true, i, npcSpec.x, npcSpec.y});
+    }
   }
 }
 
-void GameMap::createPolylines(const string& layerName, short categoryBits,
-                              bool collidable, float friction) {
-  float scaleFactor = Director::getInstance()->getContentScaleFactor();
+void GameMap::preloadItemIcons() const {
+  unordered_set<string> itemJsons;
+  for (const auto& chestSpec : _spec->chests) {
+    for (const auto& itemJson : string_util::split(chestSpec.items)) {
+      itemJsons.insert(itemJson);
+    }
+  }
+  for (const auto& npcSpec : _spec->npcs) {
+    profile_cache::get<Npc::Profile>(npcSpec.json)->lootTable->collectItemJsons(itemJsons);
+  }
 
-  for (const auto& lineObj : _tmxTiledMap->getObjectGroup(layerName)->getObjects()) {
-    const auto& valMap = lineObj.asValueMap();
-    float xRef = valMap.at("x").asFloat();
-    float yRef = valMap.at("y").asFloat();
+  for (const auto& itemJson : itemJsons) {
+    const auto itemProfile = profile_cache::get<Item::Profile>(itemJson);
+    TextureLoader::getInstance()->preload(Item::getIconPath(*itemProfile));
+  }
+}
 
-    const auto& valVec = valMap.at("polylinePoints").asValueVector();
-    b2Vec2 vertices[valVec.size()];
-    for (size_t i = 0; i < valVec.size(); i++) {
-      float x = valVec.at(i).asValueMap().at("x").asFloat() / scaleFactor;
-      float y = valVec.at(i).asValueMap().at("y").asFloat() / scaleFactor;
-      vertices[i] = {xRef + x, yRef - y};
+void GameMap::createChests() {
+  for (int i = 0; i < static_cast<int>(_spec->chests.size()); i++) {
+    const GameMapSpec::ChestSpec& chestSpec = _spec->chests[i];
+
+    if (isStreamed()) {
+      const bool isOpened = WorldState::getInstance()->isChestOpened(_tmxTiledMapId, i);
+      vector<string> itemJsons = (isOpened) ? vector<string>{} : string_util::split(chestSpec.items);
+      // Instantiated later by activateChunk().
+      _chunks[getChunkIndex(chestSpec.x)].chests.push_back(
+          {std::move(itemJsons), chestSpec.x, chestSpec.y, isOpened, i});
+    } else {
+      // Instantiated later by spawnQueuedActors().
+      _queuedSpawns.push_back({/*isNpc=*/false, i, chestSpec.x, chestSpec.y});
     }
+  }
+}
 
-    b2BodyBuilder bodyBuilder(_world);
 
-    b2Body* body = bodyBuilder.type(b2BodyType::b2_staticBody)
-      .position(0, 0, kPpm)
-      .buildBody();
+bool GameMap::isStreamed() const {
+  return _spec->isStreamed;
+}
 
-    bodyBuilder.newPolylineFixture(vertices, valVec.size(), kPpm)
-      .categoryBits(categoryBits)
-      .setSensor(!collidable)
-      .friction(friction)
-      .buildFixture();
+void GameMap::updateChunks(const cocos2d::Vec2& cameraCenter) {
+  if (!isStreamed()) {
+    return;
+  }
+
+  // The chunks within half a screen (plus one chunk) of the camera are activated,
+  // but they won't be hibernated until they are two chunks away from the screen.
+  // This hysteresis prevents a chunk at the border from thrashing.
+  const float halfWidth = Director::getInstance()->getWinSize().width / 2;
+  const int lastIndex = static_cast<int>(_chunks.size()) - 1;
+  const int firstActiveIndex = std::max(0, getChunkIndex(cameraCenter.x - halfWidth) - 1);
+  const int lastActiveIndex = std::min(lastIndex, getChunkIndex(cameraCenter.x + halfWidth) + 1);
+
+  for (int i = 0; i <= lastIndex; i++) {
+    if (_chunks[i].isActive && (i < firstActiveIndex - 1 || i > lastActiveIndex + 1)) {
+      hibernateChunk(i, firstActiveIndex, lastActiveIndex);
+    }
+  }
 
-    _tmxTiledMapBodies.insert(body);
+  for (int i = firstActiveIndex; i <= lastActiveIndex; i++) {
+    if (!_chunks[i].isActive) {
+      activateChunk(i);
+    }
   }
 }
 
-void GameMap::createTriggers() {
-  for (const auto& rectObj : _tmxTiledMap->getObjectGroup("Trigger")->getObjects()) {
-    const auto& valMap = rectObj.asValueMap();
-    float x = valMap.at("x").asFloat();
-    float y = valMap.at("y").asFloat();
-    float w = valMap.at("width").asFloat();
-    float h = valMap.at("height").asFloat();
-    vector<string> cmds = string_util::split(valMap.at("cmds").asString(), ';');
-    bool canBeTriggeredOnlyOnce = valMap.at("canBeTriggeredOnlyOnce").asBool();
-    bool canBeTriggeredOnlyByPlayer = valMap.at("canBeTriggeredOnlyByPlayer").asBool();
+void GameMap::updateTileChunks(const cocos2d::Rect& viewRect) {
+  _tileChunkRenderer->update(viewRect);
+}
 
-    b2BodyBuilder bodyBuilder(_world);
+int GameMap::getChunkIndex(float x) const {
+  const int lastIndex = static_cast<int>(_chunks.size()) - 1;
+  return std::max(0, std::min(lastIndex, static_cast<int>(x / _kChunkWidth)));
+}
 
-    b2Body* body = bodyBuilder.type(b2BodyType::b2_staticBody)
-      .position(x + w / 2, y + h / 2, kPpm)
-      .buildBody();
+void GameMap::activateChunk(int index) {
+  Chunk& chunk = _chunks[index];
+  chunk.isActive = true;
 
-    _triggers.push_back(std::make_unique<GameMap::Trigger>(cmds,
-                                                           canBeTriggeredOnlyOnce,
-                                                           canBeTriggeredOnlyByPlayer,
-                                                           body));
+  for (const auto& hibernatedNpc : chunk.npcs) {
+    if (!Npc::isNpcAllowedToSpawn(AssetId(hibernatedNpc.json))) {
+      continue;
+    }
 
-    bodyBuilder.newRectangleFixture(w / 2, h / 2, kPpm)
-      .categoryBits(category_bits::kInteractable)
-      .setSensor(true)
-      .friction(0)
-      .setUserData(_triggers.back().get())
-      .buildFixture();
+    shared_ptr<Npc> npc = acquireNpc(hibernatedNpc.json, hibernatedNpc.index);
+    if (hibernatedNpc.health > 0) {
+      npc->setStat(StatsSystem::Stat::HEALTH, hibernatedNpc.health);
+    }
+    chunk.actors.push_back(npc);
+    showDynamicActor(std::move(npc), hibernatedNpc.x, hibernatedNpc.y);
+  }
+
+  for (const auto& hibernatedChest : chunk.chests) {
+    auto chest = std::make_shared<Chest>(hibernatedChest.itemJsons, hibernatedChest.isOpened);
+    chest->bind(_tmxTiledMapId, hibernatedChest.index);
+    chunk.actors.push_back(chest);
+    showDynamicActor(std::move(chest), hibernatedChest.x, hibernatedChest.y);
   }
+
+  chunk.npcs.clear();
+  chunk.chests.clear();
 }
 
-void GameMap::createPortals() {
-  for (const auto& rectObj : _tmxTiledMap->getObjectGroup("Portal")->getObjects()) {
-    const auto& valMap = rectObj.asValueMap();
-    float x = valMap.at("x").asFloat();
-    float y = valMap.at("y").asFloat();
-    float w = valMap.at("width").asFloat();
-    float h = valMap.at("height").asFloat();
-    string targetTmxMapFilePath = valMap.at("targetMap").asString();
-    int targetPortalId = valMap.at("targetPortalID").asInt();
-    bool willInteractOnContact = valMap.at("willInteractOnContact").asBool();
-    bool isLocked = valMap.at("isLocked").asBool();
+void GameMap::hibernateChunk(int index, int firstActiveIndex, int lastActiveIndex) {
+  Chunk& chunk = _chunks[index];
+  chunk.isActive = false;
 
-    b2BodyBuilder bodyBuilder(_world);
+  vector<std::weak_ptr<DynamicActor>> actors;
+  actors.swap(chunk.actors);
 
-    b2Body* body = bodyBuilder.type(b2BodyType::b2_staticBody)
-      .position(x + w / 2, y + h / 2, kPpm)
-      .buildBody();
+  for (const auto& weakActor : actors) {
+    shared_ptr<DynamicActor> actor = weakActor.lock();
 
-    _portals.push_back(std::make_unique<GameMap::Portal>(targetTmxMapFilePath,
-                                                         targetPortalId,
-                                                         willInteractOnContact,
-                                                         isLocked,
-                                                         body));
+    // Skip the actors which have been removed from this map
+    // (e.g., an Npc who has joined the player's party).
+    if (!actor || !isShown(actor.get()) || !actor->getBody()) {
+      continue;
+    }
 
-    bodyBuilder.newRectangleFixture(w / 2, h / 2, kPpm)
-      .categoryBits(category_bits::kPortal)
-      .setSensor(true)
-      .friction(0)
-      .setUserData(_portals.back().get())
-      .buildFixture();
+    // If this actor has wandered into a chunk which is still active,
+    // then that chunk takes over the actor.
+    const b2Vec2& pos = actor->getBody()->GetPosition();
+    const int currentIndex = getChunkIndex(pos.x * kPpm);
+    if (currentIndex != index && currentIndex >= firstActiveIndex && currentIndex <= lastActiveIndex) {
+      _chunks[currentIndex].actors.push_back(actor);
+      continue;
+    }
+
+    if (Npc* npc = dynamic_cast<Npc*>(actor.get())) {
+      if (!npc->isKilled()) {
+        auto it = _npcIndices.find(npc);
+        chunk.npcs.push_back({npc->getCharacterProfile().jsonFileName,
+                              pos.x * kPpm,
+                              pos.y * kPpm,
+                              npc->getStat(StatsSystem::Stat::HEALTH),
+                              (it != _npcIndices.end()) ? it->second : -1});
+      }
+      storeDormantState(npc);
+    } else if (Chest* chest = dynamic_cast<Chest*>(actor.get())) {
+      chunk.chests.push_back({chest->getItemJsons(),
+                              pos.x * kPpm,
+                              pos.y * kPpm,
+                              chest->isOpened(),
+                              chest->getIndex()});
+    }
+
+    removeDynamicActor(actor.get());
+
+    // The hibernated Npcs may be reused by any chunk, see NpcPool.
+    if (shared_ptr<Npc> npc = std::dynamic_pointer_cast<Npc>(actor)) {
+      actor.reset();
+      NpcPool::getInstance()->release(std::move(npc));
+    }
   }
 }
 
-void GameMap::createNpcs() {
-  for (const auto& rectObj : _tmxTiledMap->getObjectGroup("Npcs")->getObjects()) {
-    const auto& valMap = rectObj.asValueMap();
-    float x = valMap.at("x").asFloat();
-    float y = valMap.at("y").asFloat();
-    string json = valMap.at("json").asString();
-
-    if (Npc::isNpcAllowedToSpawn(json)) {
-      showDynamicActor(std::make_shared<Npc>(json), x, y);
+void GameMap::updateTriggers() {
+  if (_triggers.empty()) {
+    return;
+  }
+
+  for (auto trigger : _sortedTriggers) {
+    trigger->beginOverlapUpdate();
+  }
+
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  vector<pair<GameMap::Trigger*, Character*>> enteredTriggers;
+
+  auto checkTriggers = [this, player, &enteredTriggers](Character* character) {
+    const b2Fixture* feetFixture = character->getFixtures()[Character::FixtureType::FEET];
+    if (!character->getBody() || !feetFixture) {
+      return;
+    }
+    const b2AABB& feetAabb = feetFixture->GetAABB(0);
+
+    // Only the triggers whose left edges are within
+    // [feet.left - _maxTriggerWidth, feet.right] may overlap the feet.
+    auto it = std::lower_bound(_sortedTriggers.begin(), _sortedTriggers.end(),
+                               feetAabb.lowerBound.x - _maxTriggerWidth,
+                               [](const GameMap::Trigger* trigger, float x) {
+      return trigger->getAabb().lowerBound.x < x;
+    });
+    for (; it != _sortedTriggers.end() && (*it)->getAabb().lowerBound.x <= feetAabb.upperBound.x; ++it) {
+      GameMap::Trigger* trigger = *it;
+      if ((trigger->canBeTriggeredOnlyByPlayer() && character != player) ||
+          !b2TestOverlap(trigger->getAabb(), feetAabb)) {
+        continue;
+      }
+      if (trigger->addOverlappingCharacter(character)) {
+        enteredTriggers.push_back({trigger, character});
+      }
     }
+  };
+
+  if (player) {
+    checkTriggers(player);
   }
+  if (_hasNonPlayerTriggers) {
+    _dynamicActors.forEachInGroup(ActorRegistry::Group::NPC, [&checkTriggers](DynamicActor* actor) {
+      checkTriggers(static_cast<Npc*>(actor));
+    });
+  }
+
+  // The scripts may change the actors, so they're run afterwards.
+  for (const auto& p : enteredTriggers) {
+    p.second->interact(p.first);
+  }
+}
+
+Item* GameMap::findStackableItem(const Item::Profile& itemProfile, const b2Vec2& pos) const {
+  if (!itemProfile.id.isValid()) {
+    return nullptr;
+  }
+
+  auto isStackable = [this, &itemProfile, &pos](DynamicActor* actor) -> Item* {
+    // The spatial index may still refer to the actors removed during this frame.
+    if (!_dynamicActors.contains(actor)) {
+      return nullptr;
+    }
+    Item* item = dynamic_cast<Item*>(actor);
+    if (!item || item->getItemProfile().id != itemProfile.id || !item->getBody()) {
+      return nullptr;
+    }
+    const b2Vec2 d = item->getBody()->GetPosition() - pos;
+    return (d.LengthSquared() <= ITEM_STACK_RADIUS * ITEM_STACK_RADIUS) ? item : nullptr;
+  };
+
+  for (auto item : _recentlyDroppedItems) {
+    if (Item* stackableItem = isStackable(item)) {
+      return stackableItem;
+    }
+  }
+
+  vector<DynamicActor*> nearbyItems;
+  _dynamicActors.queryRadius(pos, ITEM_STACK_RADIUS, ActorRegistry::Group::ITEM, nearbyItems);
+  for (auto actor : nearbyItems) {
+    if (Item* stackableItem = isStackable(actor)) {
+      return stackableItem;
+    }
+  }
+  return nullptr;
+}
 
-  auto player = GameMapManager::getInstance()->getPlayer();
-  if (!player) {
+void GameMap::applyDropImpulse(Item* item) const {
+  float offsetX = rand_util::randFloat(-.3f, .3f, rand_util::Stream::ITEM);
+  float offsetY = 3.0f;
+  item->getBody()->ApplyLinearImpulse({offsetX, offsetY},
+                                      item->getBody()->GetWorldCenter(),
+                                      true);
+}
+
+bool GameMap::isShown(DynamicActor* actor) const {
+  return _dynamicActors.contains(actor);
+}
+
+void GameMap::spawn(const GameMap::QueuedSpawn& queuedSpawn) {
+  if (queuedSpawn.isNpc) {
+    const GameMapSpec::NpcSpec& npcSpec = _spec->npcs[queuedSpawn.index];
+    if (Npc::isNpcAllowedToSpawn(AssetId(npcSpec.json))) {
+      showDynamicActor(acquireNpc(npcSpec.json, queuedSpawn.index), npcSpec.x, npcSpec.y);
+    }
     return;
   }
 
-  for (const auto& p : player->getParty()->getWaitingMembersLocationInfo()) {
-    const string& characterJsonFileName = p.first;
-    const Party::WaitingLocationInfo& location = p.second;
+  const GameMapSpec::ChestSpec& chestSpec = _spec->chests[queuedSpawn.index];
+  const bool isOpened = WorldState::getInstance()->isChestOpened(_tmxTiledMapId, queuedSpawn.index);
+  auto chest = std::make_shared<Chest>((isOpened) ? vector<string>{} : string_util::split(chestSpec.items),
+                                       isOpened);
+  chest->bind(_tmxTiledMapId, queuedSpawn.index);
+  showDynamicActor(std::move(chest), chestSpec.x, chestSpec.y);
+}
+
+shared_ptr<Npc> GameMap::acquireNpc(const string& json, int index) {
+  shared_ptr<Npc> npc = NpcPool::getInstance()->acquire(json);
+  if (index < 0) {
+    return npc;
+  }
+  _npcIndices[npc.get()] = index;
+
+  // The pooled Npc has just been reset, i.e., restocked with its default goods,
+  // so they're replaced with what it had when the player left, if it hasn't restocked yet.
+  DormantWorld::Stock stock;
+  if (!npc->getNpcProfile().isTradable ||
+      !DormantWorld::getInstance()->takeMerchantStock(_tmxTiledMapId, index, stock)) {
+    return npc;
+  }
 
-    // If this Npc is waiting for its leader in the current map,
-    // then we should show it on this map.
-    if (location.tmxMapFileName == _tmxTiledMapFileName) {
-      player->getParty()->getMember(characterJsonFileName)->showOnMap(location.x * kPpm,
-                                                                      location.y * kPpm);
+  vector<pair<Item*, int>> defaultItems;
+  for (const auto& items : npc->getInventory()) {
+    for (auto item : items) {
+      defaultItems.push_back({item, item->getAmount()});
     }
   }
+  npc->removeItems(defaultItems);
+
+  vector<pair<shared_ptr<Item>, int>> storedItems;
+  storedItems.reserve(stock.size());
+  for (const auto& p : stock) {
+    storedItems.push_back({Item::create(p.first), p.second});
+  }
+  npc->addItems(storedItems);
+  return npc;
 }
 
-void GameMap::createChests() {
-  for (const auto& rectObj : _tmxTiledMap->getObjectGroup("Chest")->getObjects()) {
-    const auto& valMap = rectObj.asValueMap();
-    float x = valMap.at("x").asFloat();
-    float y = valMap.at("y").asFloat();
-    string items = valMap.at("items").asString();
-    showDynamicActor(std::make_shared<Chest>(items), x, y);
+void GameMap::storeDormantState(Npc* npc) {
+  auto it = _npcIndices.find(npc);
+  if (it == _npcIndices.end()) {
+    return;
+  }
+
+  if (npc->getNpcProfile().isTradable && !npc->isKilled()) {
+    DormantWorld::Stock stock;
+    for (const auto& items : npc->getInventory()) {
+      for (const auto item : items) {
+        stock.push_back({item->getItemProfile().jsonFileName, item->getAmount()});
+      }
+    }
+    DormantWorld::getInstance()->storeMerchantStock(_tmxTiledMapId, it->second, std::move(stock));
   }
+  _npcIndices.erase(it);
 }
 
 
@@ -299,16 +807,18 @@ void GameMap::createChests() {
 GameMap::Trigger::Trigger(const vector<string>& cmds,
                           const bool canBeTriggeredOnlyOnce,
                           const bool canBeTriggeredOnlyByPlayer,
-                          b2Body* body)
-    : _cmds(cmds),
+                          const b2AABB& aabb,
+                          AssetId tmxMapId,
+                          int triggerIndex)
+    : _script(ScriptRunner::compile(cmds)),
       _canBeTriggeredOnlyOnce(canBeTriggeredOnlyOnce),
       _canBeTriggeredOnlyByPlayer(canBeTriggeredOnlyByPlayer),
       _hasTriggered(),
-      _body(body) {}
-
-GameMap::Trigger::~Trigger() {
-  _body->GetWorld()->DestroyBody(_body);
-}
+      _aabb(aabb),
+      _tmxMapId(tmxMapId),
+      _index(triggerIndex),
+      _overlappingCharacters(),
+      _previouslyOverlappingCharacters() {}
 
 
 void GameMap::Trigger::onInteract(Character* user) {
@@ -321,10 +831,11 @@ void GameMap::Trigger::onInteract(Character* user) {
   }
 
   _hasTriggered = true;
-
-  for (const auto& cmd : _cmds) {
-    Console::getInstance()->executeCmd(cmd);
+  if (_canBeTriggeredOnlyOnce) {
+    WorldState::getInstance()->setTriggered(_tmxMapId, _index);
   }
+
+  ScriptRunner::getInstance()->run(_script);
 }
 
 bool GameMap::Trigger::willInteractOnContact() const {
@@ -348,19 +859,37 @@ void GameMap::Trigger::setTriggered(bool triggered) {
   _hasTriggered = triggered;
 }
 
+const b2AABB& GameMap::Trigger::getAabb() const {
+  return _aabb;
+}
+
+void GameMap::Trigger::beginOverlapUpdate() {
+  _previouslyOverlappingCharacters.swap(_overlappingCharacters);
+  _overlappingCharacters.clear();
+}
+
+bool GameMap::Trigger::addOverlappingCharacter(const Character* character) {
+  _overlappingCharacters.push_back(character);
+  return std::find(_previouslyOverlappingCharacters.begin(),
+                   _previouslyOverlappingCharacters.end(),
+                   character) == _previouslyOverlappingCharacters.end();
+}
+
 
 
 GameMap::Portal::Portal(const string& targetTmxMapFileName, int targetPortalId,
-                        bool willInteractOnContact, bool isLocked, b2Body* body)
+                        bool willInteractOnContact, bool isLocked, bool isSeamless,
+                        b2Body* body, int portalId)
     : _targetTmxMapFileName(targetTmxMapFileName),
+      _targetTmxMapId(targetTmxMapFileName),
       _targetPortalId(targetPortalId),
       _willInteractOnContact(willInteractOnContact),
       _isLocked(isLocked),
+      _isSeamless(isSeamless),
       _body(body),
+      _portalId(portalId),
       _hintBubbleFxSprite() {
-  if (GameMap::Portal::hasSavedLockUnlockState(targetTmxMapFileName, targetPortalId)) {
-    _isLocked = GameMap::Portal::isLocked(targetTmxMapFileName, targetPortalId);
-  }
+  GameMap::Portal::getSavedLockUnlockState(_targetTmxMapId, targetPortalId, _isLocked);
 }
 
 GameMap::Portal::~Portal() {
@@ -391,19 +920,25 @@ void GameMap::Portal::onInteract(Character* user) {
     //     then teleport the ally's body to its party leader.
     // (2) If `ally` is waiting for its party leader,
     //     AND if this new map is not where `ally` is waiting at,
-    //     then we'll remove it from the map temporarily.
-    //     Whether it will be shown again is determined in
-    //     GameMap::spawnNpcs().
-    for (auto ally : user->getAllies()) {
+    //     then it becomes dormant until that map is entered again
+    //     (see Party::wakeWaitingMembers()).
+    const AssetId newMapId = GameMapManager::getInstance()->getGameMap()->getTmxTiledMapId();
+    const vector<Character*> allies = user->getAllies();  // the dormant allies leave the party
+    for (auto ally : allies) {
       if (!ally->isWaitingForPartyLeader()) {
         ally->setPosition(portalPos.x, portalPos.y);
-      } else if (newMapFileName != ally->getParty()->getWaitingMemberLocationInfo(
-                 ally->getCharacterProfile().jsonFileName).tmxMapFileName) {
-        ally->removeFromMap();
+      } else if (newMapId != ally->getParty()->getWaitingMemberLocationInfo(
+                 ally->getCharacterProfile().id).tmxMapId) {
+        ally->getParty()->hibernateWaitingMember(ally);
       }
     }
   };
 
+  // A doorway to an adjacent room skips the shade if the room is ready.
+  if (_isSeamless &&
+      GameMapManager::getInstance()->loadGameMapSeamlessly(newMapFileName, afterLoadingGameMap)) {
+    return;
+  }
   GameMapManager::getInstance()->loadGameMap(newMapFileName,
                                              afterLoadingGameMap);
 }
@@ -472,8 +1007,8 @@ bool GameMap::Portal::canBeUnlockedBy(Character* user) const {
                       [gameMap, this](const Item* item) {
                           const Key* key = dynamic_cast<const Key*>(item);
                           return key &&
-                            key->getKeyProfile().targetTmxFileName == gameMap->_tmxTiledMapFileName &&
-                            key->getKeyProfile().targetPortalId == getPortalId();
+                            key->getKeyProfile().targetTmxMapId == gameMap->_tmxTiledMapId &&
+                            key->getKeyProfile().targetPortalId == _portalId;
                       }) != miscItems.end();
 }
 
@@ -500,93 +1035,35 @@ int GameMap::Portal::getTargetPortalId() const {
   return _targetPortalId;
 }
 
-
-bool GameMap::Portal::hasSavedLockUnlockState(const string& tmxMapFileName,
-                                              int targetPortalId) {
-  auto mapIt = GameMap::Portal::_allPortalStates.find(tmxMapFileName);
-  if (mapIt == GameMap::Portal::_allPortalStates.end()) {
-    return false;
-  }
-
-  return std::find_if(mapIt->second.begin(),
-                      mapIt->second.end(),
-                      [targetPortalId](const pair<int, bool>& entry) {
-                          return entry.first == targetPortalId;
-                      }) != mapIt->second.end();
+bool GameMap::Portal::isSeamless() const {
+  return _isSeamless;
 }
 
-bool GameMap::Portal::isLocked(const string& tmxMapFileName,
-                               int targetPortalId) {
-  auto mapIt = GameMap::Portal::_allPortalStates.find(tmxMapFileName);
-
-  // If we cannot find the associated vector for this tiled map
-  // in the unordered_map, then simply return false.
-  if (mapIt == GameMap::Portal::_allPortalStates.end()) {
-    VGLOG(LOG_WARN, "Unable to find the corresponding portal vector");
-    return false;
-  }
-
-  // Otherwise, we've found the associated vector of this TiledMap.
-  // Now we should find the corresponding entry in that vector
-  // and return entry.second which holds the lock state of the Portal.
-  for (const auto& entry : mapIt->second) {
-    if (entry.first == targetPortalId) {
-      return entry.second;
-    }
-  }
-
-  // If we end up here, then the vector `mapIt->second` doesn't contain
-  // the corresponding entry. We should simply return false.
-  VGLOG(LOG_WARN, "Unable to find the corresponding entry in the portal vector");
-  return false;
+b2Body* GameMap::Portal::getBody() const {
+  return _body;
 }
 
-void GameMap::Portal::setLocked(const string& tmxMapFileName,
-                                int targetPortalId,
-                                bool locked) {
-  auto mapIt = GameMap::Portal::_allPortalStates.find(tmxMapFileName);
-
-  // If we cannot find the associated vector for this tiled map
-  // in the unordered_map, then insert a new vector which is
-  // initialized with {targetPortalId, locked} and return early.
-  if (mapIt == GameMap::Portal::_allPortalStates.end()) {
-    GameMap::Portal::_allPortalStates.insert({tmxMapFileName, {{targetPortalId, locked}}});
-    return;
-  }
 
+size_t GameMap::Portal::getNumSavedLockUnlockStates() {
+  return GameMap::Portal::_allPortalStates.size();
+}
 
-  // Otherwise, we've found the associated vector of this TiledMap.
-  // Now we should find the corresponding entry in that vector,
-  // update that entry, and return early.
-  for (auto& entry : mapIt->second) {
-    if (entry.first == targetPortalId) {
-      entry.second = locked;
-      return;
-    }
+bool GameMap::Portal::getSavedLockUnlockState(AssetId tmxMapId, int targetPortalId, bool& isLocked) {
+  auto it = GameMap::Portal::_allPortalStates.find({tmxMapId, targetPortalId});
+  if (it == GameMap::Portal::_allPortalStates.end()) {
+    return false;
   }
-
-  // If we end up here, then the vector `mapIt->second` doesn't contain
-  // the corresponding entry, and thus we have to insert it manually.
-  mapIt->second.push_back({targetPortalId, locked});
+  isLocked = it->second;
+  return true;
 }
 
-
-void GameMap::Portal::saveLockUnlockState() const {
-  GameMap::Portal::setLocked(_targetTmxMapFileName, _targetPortalId, _isLocked);
+void GameMap::Portal::setLocked(AssetId tmxMapId, int targetPortalId, bool locked) {
+  GameMap::Portal::_allPortalStates[{tmxMapId, targetPortalId}] = locked;
 }
 
 
-int GameMap::Portal::getPortalId() const {
-  const auto& portals = GameMapManager::getInstance()->getGameMap()->_portals;
-
-  for (size_t i = 0; i < portals.size(); i++) {
-    if (portals.at(i).get() == this) {
-      return i;
-    }
-  }
-
-  VGLOG(LOG_ERR, "Unable to find the portal ID of: %p", this);
-  return -1;
+void GameMap::Portal::saveLockUnlockState() const {
+  GameMap::Portal::setLocked(_targetTmxMapId, _targetPortalId, _isLocked);
 }
 
 }  // namespace vigilante
@@ -2,7 +2,11 @@
 #ifndef VIGILANTE_GAME_MAP_H_
 #define VIGILANTE_GAME_MAP_H_
 
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 #include <string>
 #include <memory>
@@ -11,27 +15,42 @@
 #include <Box2D/Box2D.h>
 #include "DynamicActor.h"
 #include "Interactable.h"
+#include "gameplay/ScriptRunner.h"
 #include "item/Item.h"
+#include "item/LootBag.h"
+#include "map/ActorRegistry.h"
+#include "map/GameMapSpec.h"
+#include "map/TileChunkRenderer.h"
+#include "util/AssetId.h"
 #include "util/Logger.h"
+#include "util/box2d/b2BatchBuilder.h"
 
 namespace vigilante {
 
 class Character;
+class Npc;
+class GameState;
 class Player;
 
 class GameMap {
  public:
 
+  // A trigger is not a b2Body. Its region is kept in GameMap's trigger index
+  // and checked against the feet of the characters which can fire it once
+  // per step (see GameMap::updateTriggers()), so it doesn't cost any
+  // broadphase proxies or contact pairs.
   class Trigger : public Interactable {
    public:
     Trigger(const std::vector<std::string>& cmds,
             const bool canBeTriggeredOnlyOnce,
             const bool canBeTriggeredOnlyByPlayer,
-            b2Body* body);
-    virtual ~Trigger();
+            const b2AABB& aabb,
+            AssetId tmxMapId,
+            int triggerIndex);
+    virtual ~Trigger() = default;
 
     // Executes certain commands via ui/console/Console.cc
-    // when the player's body collides with `this->_body`
+    // when a character's feet enter `this->_aabb`
     virtual void onInteract(Character* user) override;  // Interactable
     virtual bool willInteractOnContact() const override;  // Interactable
     virtual void showHintUI() override {}  // Interactable
@@ -41,16 +60,29 @@ class GameMap {
     bool canBeTriggeredOnlyByPlayer() const;
     bool hasTriggered() const;
     void setTriggered(bool triggered);
+    const b2AABB& getAabb() const;  // in meters
+
+    // The characters overlapping this trigger are collected anew every step.
+    // Returns true if `character` wasn't overlapping it in the previous step,
+    // i.e., it has just entered this trigger.
+    void beginOverlapUpdate();
+    bool addOverlappingCharacter(const Character* character);
 
    protected:
     virtual void createHintBubbleFx() override {}  // Interactable
     virtual void removeHintBubbleFx() override {}  // Interactable
 
-    std::vector<std::string> _cmds;
+    ScriptRunner::Script _script;
     bool _canBeTriggeredOnlyOnce;
     bool _canBeTriggeredOnlyByPlayer;
     bool _hasTriggered;
-    b2Body* _body;
+    b2AABB _aabb;
+    AssetId _tmxMapId;
+    int _index;  // in GameMapSpec::triggers, see WorldState
+
+    // Only compared, never dereferenced.
+    std::vector<const Character*> _overlappingCharacters;
+    std::vector<const Character*> _previouslyOverlappingCharacters;
   };
 
 
@@ -60,7 +92,9 @@ class GameMap {
            int targetPortalId,
            bool willInteractOnContact,
            bool isLocked,
-           b2Body* body);
+           bool isSeamless,
+           b2Body* body,
+           int portalId);
     virtual ~Portal();
 
     virtual void onInteract(Character* user) override;  // Interactable
@@ -75,6 +109,11 @@ class GameMap {
 
     const std::string& getTargetTmxMapFileName() const;
     int getTargetPortalId() const;
+    bool isSeamless() const;
+    b2Body* getBody() const;
+
+    // The number of lock/unlock states saved across all GameMaps (see MemoryTracker).
+    static size_t getNumSavedLockUnlockStates();
 
 
    protected:
@@ -87,39 +126,99 @@ class GameMap {
 
     // The following static methods and `StateMap`
     // holds the state of *ALL* portals in current game.
-    static bool hasSavedLockUnlockState(const std::string& tmxMapFileName,
-                                        int targetPortalId);
-
-    static bool isLocked(const std::string& tmxMapFileName,
-                         int targetPortalId);
-
-    static void setLocked(const std::string& tmxMapFileName,
-                          int targetPortalId,
-                          bool locked);
-    using StateMap
-      = std::unordered_map<std::string, std::vector<std::pair<int, bool>>>;
+    // Returns false if there's no saved state for this portal.
+    static bool getSavedLockUnlockState(AssetId tmxMapId, int targetPortalId, bool& isLocked);
+    static void setLocked(AssetId tmxMapId, int targetPortalId, bool locked);
+
+    // (tmx map id, target portal id), packed into a single integer.
+    class StateKey final {
+     public:
+      StateKey(AssetId tmxMapId, int targetPortalId)
+          : _tmxMapId(tmxMapId), _targetPortalId(targetPortalId) {}
+
+      bool operator==(const StateKey& other) const {
+        return _tmxMapId == other._tmxMapId && _targetPortalId == other._targetPortalId;
+      }
+
+      AssetId getTmxMapId() const { return _tmxMapId; }
+      int getTargetPortalId() const { return _targetPortalId; }
+      uint64_t getValue() const {
+        return (static_cast<uint64_t>(_tmxMapId.getValue()) << 32) |
+               static_cast<uint32_t>(_targetPortalId);
+      }
+
+     private:
+      AssetId _tmxMapId;
+      int _targetPortalId;
+    };
+
+    struct StateKeyHash final {
+      size_t operator()(const StateKey& key) const {
+        return std::hash<uint64_t>()(key.getValue());
+      }
+    };
+
+    // (tmx map id, target portal id) -> isLocked
+    // Saved and restored by GameState.
+    using StateMap = std::unordered_map<StateKey, bool, StateKeyHash>;
     static StateMap _allPortalStates;
+    friend class vigilante::GameState;
 
     // Save the current portal's lock/unlock state in `_allPortalStates`.
     void saveLockUnlockState() const;
-    int getPortalId() const;
 
     std::string _targetTmxMapFileName;  // new (target) .tmx filename
+    AssetId _targetTmxMapId;  // interned `_targetTmxMapFileName`
     int _targetPortalId;  // the portal id in the new (target) map
     bool _willInteractOnContact;  // interact with the portal on contact?
     bool _isLocked;
+    bool _isSeamless;  // see GameMapManager::loadGameMapSeamlessly()
     b2Body* _body;
+    int _portalId;  // in GameMap::_portals, which the Keys refer to
     cocos2d::Sprite* _hintBubbleFxSprite;
   };
 
-  GameMap(b2World* world, const std::string& tmxMapFileName);
+  // Builds the TMXTiledMap from the TMXMapInfo which has already been
+  // parsed by GameMapSpec::create(), unless a resident `tmxTiledMap`
+  // (see GameMapCache) is given. Must be called on the main thread.
+  GameMap(b2World* world,
+          std::shared_ptr<GameMapSpec> spec,
+          cocos2d::TMXTiledMap* tmxTiledMap=nullptr);
   virtual ~GameMap() = default;
 
+  // Builds an autoreleased TMXTiledMap from `spec`, e.g., ahead of time
+  // (see GameMapManager::prebuildGameMap()). Must be called on the main thread.
+  static cocos2d::TMXTiledMap* buildTmxTiledMap(const GameMapSpec& spec);
+
   void createObjects();
   void deleteObjects();
+
+  // Recreates the triggers, portals, chests and Npcs from the GameMapSpec
+  // (and the current WorldState) in place, e.g., to retry from a checkpoint
+  // (see GameState::restoreInPlace()). The static bodies, the TMXTiledMap
+  // and the textures are kept, and the Npcs go back to NpcPool to be reused.
+  // The party members aren't touched.
+  void resetObjects();
   std::unique_ptr<Player> createPlayer() const;
+
+  // If an identical item (i.e., with the same id) is already lying within
+  // ITEM_STACK_RADIUS of (x, y) (in pixels), `amount` is merged into its stack
+  // and that item is returned instead of a new one.
   Item* createItem(const std::string& itemJson, float x, float y, int amount=1);
 
+  // Spawns a batch of items (item json -> amount), e.g., the contents of
+  // a chest, at (x, y) in pixels. Their profiles and icons are loaded right
+  // away, but the items are shown on the map one by one by the
+  // DeferredTaskScheduler, so that a large batch is spread across frames.
+  // The rest of the batch is dropped if a GameMap transition begins.
+  void createItems(const std::vector<std::pair<std::string, int>>& items, float x, float y);
+
+  // Drops all the `drops` (item json -> amount) of a single kill at (x, y).
+  // In loot bag mode, they're dropped as a single LootBag instead.
+  void dropLoot(const std::vector<std::pair<std::string, int>>& drops, float x, float y);
+  static bool isLootBagEnabled();
+  static void setLootBagEnabled(bool lootBagEnabled);
+
 
   template <typename ReturnType = DynamicActor>
   ReturnType* showDynamicActor(std::shared_ptr<DynamicActor> actor, float x, float y);
@@ -127,32 +226,139 @@ class GameMap {
   template <typename ReturnType = DynamicActor>
   std::shared_ptr<ReturnType> removeDynamicActor(DynamicActor* actor);
 
+  // Appends the shown actors of `group` whose b2Body is within `radius`
+  // (in meters) of `center` to `result`. The positions are those of
+  // the last frame (see ActorRegistry::rebuildSpatialIndex()).
+  void queryDynamicActors(const b2Vec2& center,
+                          float radius,
+                          ActorRegistry::Group group,
+                          std::vector<DynamicActor*>& result) const;
+  const ActorRegistry& getDynamicActors() const;
+
+  // Spawns the Npcs and chests of a non-streamed map which createObjects() has queued:
+  // those within a screen of `center` (in pixels, e.g., where the player has entered)
+  // right away, and the rest one by one by the DeferredTaskScheduler, nearest first,
+  // so that the shade doesn't have to wait for the whole map to be populated.
+  void spawnQueuedActors(const cocos2d::Vec2& center);
+
+  // Queues the respawn of `npc` in DormantWorld, if it was spawned from GameMapSpec::npcs.
+  void onNpcKilled(Npc* npc);
+
+
+  // Streaming (chunked) maps.
+  // If the .tmx file has the "isStreamed" map property set, then the map is
+  // split into horizontal chunks of _kChunkWidth pixels, and Npcs and chests
+  // are only instantiated for the chunks near the camera. The chunks further
+  // away are hibernated into a compact state (see GameMap::Chunk).
+  bool isStreamed() const;
+  void updateChunks(const cocos2d::Vec2& cameraCenter);
+
+  // Only the tile chunks within `viewRect` are drawn, see TileChunkRenderer.
+  void updateTileChunks(const cocos2d::Rect& viewRect);
 
   std::unordered_set<b2Body*>& getTmxTiledMapBodies();
   cocos2d::TMXTiledMap* getTmxTiledMap() const;
+  const std::shared_ptr<GameMapSpec>& getSpec() const;
+  bool hasTileCollisionGrid() const;  // see GameMapSpec::tileCollisionGrid
   const std::string& getTmxTiledMapFileName() const;
+  AssetId getTmxTiledMapId() const;
   float getWidth() const;
   float getHeight() const;
 
  private:
-  void createRectangles(const std::string& layerName, short categoryBits,
-                        bool collidable, float friction);
-  void createPolylines(const std::string& layerName, short categoryBits,
-                       bool collidable, float friction);
+  // Appends the bodies and fixtures of `layer` to the specs of the batch.
+  void appendStaticLayer(const GameMapSpec::StaticLayer& layer,
+                         std::vector<b2BatchBuilder::BodySpec>& bodySpecs,
+                         std::vector<b2BatchBuilder::FixtureSpec>& fixtureSpecs) const;
 
   void createTriggers();
   void createPortals();
   void createNpcs();
   void createChests();
 
+  // Starts loading the icons of the items which may show up on this map
+  // (the chest contents and the items dropped by the npcs) in the background,
+  // so that opening a chest or killing an npc won't stall on png decoding.
+  void preloadItemIcons() const;
+
+  struct HibernatedNpc final {
+    std::string json;
+    float x;
+    float y;
+    int health;
+    int index;  // in GameMapSpec::npcs, see DormantWorld
+  };
+
+  struct HibernatedChest final {
+    std::vector<std::string> itemJsons;
+    float x;
+    float y;
+    bool isOpened;
+    int index;  // in GameMapSpec::chests, see WorldState
+  };
+
+  struct Chunk final {
+    bool isActive;
+    std::vector<GameMap::HibernatedNpc> npcs;
+    std::vector<GameMap::HibernatedChest> chests;
+    std::vector<std::weak_ptr<DynamicActor>> actors;  // instantiated from this chunk
+  };
+
+  int getChunkIndex(float x) const;
+  void activateChunk(int index);
+  void hibernateChunk(int index, int firstActiveIndex, int lastActiveIndex);
+  bool isShown(DynamicActor* actor) const;
+
+  struct QueuedSpawn final {
+    bool isNpc;
+    int index;  // in GameMapSpec::npcs or GameMapSpec::chests
+    float x;
+    float y;
+  };
+
+  void spawn(const GameMap::QueuedSpawn& queuedSpawn);
+
+  // Acquires the Npc of GameMapSpec::npcs[index] with its goods restored from
+  // DormantWorld, or stores its goods there before it leaves the map.
+  std::shared_ptr<Npc> acquireNpc(const std::string& json, int index);
+  void storeDormantState(Npc* npc);
+
+  // Lets the characters whose feet have entered a trigger interact with it.
+  // Called by GameMapManager once per step after the contacts are dispatched.
+  void updateTriggers();
+
+  Item* findStackableItem(const Item::Profile& itemProfile, const b2Vec2& pos) const;
+  void applyDropImpulse(Item* item) const;
+
+  static const float _kChunkWidth;
+  static bool _isLootBagEnabled;
+
   b2World* _world;
+  std::shared_ptr<GameMapSpec> _spec;
   std::unordered_set<b2Body*> _tmxTiledMapBodies;
   cocos2d::TMXTiledMap* _tmxTiledMap;
   std::string _tmxTiledMapFileName;
+  AssetId _tmxTiledMapId;  // interned `_tmxTiledMapFileName`
+  std::unique_ptr<TileChunkRenderer> _tileChunkRenderer;
+
+  ActorRegistry _dynamicActors;
 
-  std::unordered_set<std::shared_ptr<DynamicActor>> _dynamicActors;
+  // The items dropped since the last ActorRegistry::rebuildSpatialIndex(),
+  // which can't be found by queryDynamicActors() yet.
+  std::vector<Item*> _recentlyDroppedItems;
   std::vector<std::unique_ptr<GameMap::Trigger>> _triggers;
+
+  // The trigger index, i.e., `_triggers` sorted by the left edges of their
+  // AABBs. With the widest trigger's width, the triggers which may overlap
+  // an AABB are found by a binary search.
+  std::vector<GameMap::Trigger*> _sortedTriggers;
+  float _maxTriggerWidth;  // in meters
+  bool _hasNonPlayerTriggers;
   std::vector<std::unique_ptr<GameMap::Portal>> _portals;
+  std::vector<GameMap::Chunk> _chunks;
+  std::vector<GameMap::QueuedSpawn> _queuedSpawns;  // see spawnQueuedActors()
+  // The shown Npcs which have been spawned from GameMapSpec::npcs -> their indices.
+  std::unordered_map<const DynamicActor*, int> _npcIndices;
 
   friend class GameMapManager;
 };
@@ -163,9 +369,7 @@ template <typename ReturnType>
 ReturnType* GameMap::showDynamicActor(std::shared_ptr<DynamicActor> actor, float x, float y) {
   ReturnType* shownActor = dynamic_cast<ReturnType*>(actor.get());
 
-  std::shared_ptr<DynamicActor> key(std::shared_ptr<DynamicActor>(), actor.get());
-  auto it = _dynamicActors.find(key);
-  if (it != _dynamicActors.end()) {
+  if (_dynamicActors.contains(actor.get())) {
     VGLOG(LOG_ERR, "This DynamicActor is already being shown: %p", actor.get());
     return nullptr;
   }
@@ -178,19 +382,15 @@ ReturnType* GameMap::showDynamicActor(std::shared_ptr<DynamicActor> actor, float
 
 template <typename ReturnType>
 std::shared_ptr<ReturnType> GameMap::removeDynamicActor(DynamicActor* actor) {
-  std::shared_ptr<ReturnType> removedActor(nullptr);
-
-  std::shared_ptr<DynamicActor> key(std::shared_ptr<DynamicActor>(), actor);
-  auto it = _dynamicActors.find(key);
-  if (it == _dynamicActors.end()) {
+  std::shared_ptr<DynamicActor> removedActor = _dynamicActors.erase(actor);
+  if (!removedActor) {
     VGLOG(LOG_ERR, "This DynamicActor has not yet been shown: %p", actor);
     return nullptr;
   }
+  _npcIndices.erase(actor);
 
-  removedActor = std::move(std::dynamic_pointer_cast<ReturnType>(*it));
   removedActor->removeFromMap();
-  _dynamicActors.erase(it);
-  return removedActor;
+  return std::dynamic_pointer_cast<ReturnType>(removedActor);
 }
 
 }  // namespace vigilante
@@ -0,0 +1,132 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "GameMapCache.h"
+
+#include "map/TileChunkRenderer.h"
+#include "util/Logger.h"
+
+using std::list;
+using std::string;
+using std::shared_ptr;
+using cocos2d::TMXTiledMap;
+using cocos2d::TMXLayer;
+using cocos2d::V3F_C4B_T2F_Quad;
+
+namespace vigilante {
+
+GameMapCache::GameMapCache(size_t memoryBudget)
+    : _lruList(),
+      _lruMap(),
+      _memoryBudget(memoryBudget),
+      _stats() {}
+
+GameMapCache::~GameMapCache() {
+  clear();
+}
+
+
+void GameMapCache::put(shared_ptr<GameMapSpec> spec, TMXTiledMap* tmxTiledMap) {
+  const string tmxMapFileName = spec->tmxMapFileName;
+
+  auto it = _lruMap.find(tmxMapFileName);
+  if (it != _lruMap.end()) {
+    evict(it->second);
+  }
+
+  tmxTiledMap->retain();
+  size_t memoryUsage = GameMapCache::estimateMemoryUsage(*spec, tmxTiledMap);
+  _lruList.push_front({{std::move(spec), tmxTiledMap}, memoryUsage});
+  _lruMap[tmxMapFileName] = _lruList.begin();
+  _stats.memoryUsage += memoryUsage;
+
+  evictUntilWithinBudget();
+}
+
+GameMapCache::Entry GameMapCache::take(const string& tmxMapFileName) {
+  auto it = _lruMap.find(tmxMapFileName);
+  if (it == _lruMap.end()) {
+    _stats.misses++;
+    return {nullptr, nullptr};
+  }
+
+  _stats.hits++;
+  _stats.memoryUsage -= it->second->memoryUsage;
+
+  GameMapCache::Entry entry = std::move(it->second->entry);
+  entry.tmxTiledMap->autorelease();
+  _lruList.erase(it->second);
+  _lruMap.erase(it);
+  return entry;
+}
+
+bool GameMapCache::contains(const string& tmxMapFileName) const {
+  return _lruMap.find(tmxMapFileName) != _lruMap.end();
+}
+
+void GameMapCache::clear() {
+  while (!_lruList.empty()) {
+    evict(std::prev(_lruList.end()));
+  }
+}
+
+
+size_t GameMapCache::getMemoryBudget() const {
+  return _memoryBudget;
+}
+
+void GameMapCache::setMemoryBudget(size_t memoryBudget) {
+  _memoryBudget = memoryBudget;
+  evictUntilWithinBudget();
+}
+
+const GameMapCache::Stats& GameMapCache::getStats() const {
+  return _stats;
+}
+
+
+size_t GameMapCache::estimateMemoryUsage(const GameMapSpec& spec, TMXTiledMap* tmxTiledMap) {
+  size_t memoryUsage = sizeof(GameMapSpec);
+
+  // Each tile of a TMXLayer takes one gid and one quad.
+  for (const auto child : tmxTiledMap->getChildren()) {
+    const TMXLayer* layer = dynamic_cast<const TMXLayer*>(child);
+    if (layer) {
+      const auto& layerSize = layer->getLayerSize();
+      memoryUsage += layerSize.width * layerSize.height *
+                     (sizeof(uint32_t) + sizeof(V3F_C4B_T2F_Quad));
+    }
+  }
+
+  memoryUsage += TileChunkRenderer::estimateMemoryUsage(tmxTiledMap);
+
+  for (const auto& layer : spec.staticLayers) {
+    memoryUsage += layer.rectangles.size() * sizeof(GameMapSpec::Rectangle);
+    for (const auto& polyline : layer.polylines) {
+      memoryUsage += polyline.vertices.size() * sizeof(b2Vec2);
+    }
+  }
+
+  memoryUsage += spec.triggers.size() * sizeof(GameMapSpec::TriggerSpec);
+  memoryUsage += spec.portals.size() * sizeof(GameMapSpec::PortalSpec);
+  memoryUsage += spec.npcs.size() * sizeof(GameMapSpec::NpcSpec);
+  memoryUsage += spec.chests.size() * sizeof(GameMapSpec::ChestSpec);
+  return memoryUsage;
+}
+
+void GameMapCache::evict(list<GameMapCache::Node>::iterator it) {
+  VGLOG(LOG_INFO, "Evicting cached map: %s (%zu bytes)",
+        it->entry.spec->tmxMapFileName.c_str(), it->memoryUsage);
+
+  _stats.evictions++;
+  _stats.memoryUsage -= it->memoryUsage;
+  it->entry.tmxTiledMap->release();
+  _lruMap.erase(it->entry.spec->tmxMapFileName);
+  _lruList.erase(it);
+}
+
+void GameMapCache::evictUntilWithinBudget() {
+  while (!_lruList.empty() && _stats.memoryUsage > _memoryBudget) {
+    evict(std::prev(_lruList.end()));
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,78 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_GAME_MAP_CACHE_H_
+#define VIGILANTE_GAME_MAP_CACHE_H_
+
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <cocos2d.h>
+#include "map/GameMapSpec.h"
+
+namespace vigilante {
+
+// An LRU of recently visited maps. Each entry keeps the TMXTiledMap node
+// (and thus its tileset textures) and the GameMapSpec of a map resident,
+// but not its b2Bodies, so that re-entering a map can skip both
+// parsing the .tmx file and uploading the textures.
+//
+// All methods must be called on the main thread.
+class GameMapCache final {
+ public:
+  struct Entry final {
+    std::shared_ptr<GameMapSpec> spec;
+    cocos2d::TMXTiledMap* tmxTiledMap;
+  };
+
+  struct Stats final {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t memoryUsage;  // in bytes (estimated)
+  };
+
+  explicit GameMapCache(size_t memoryBudget);
+  ~GameMapCache();
+
+  // Puts a map into the cache. `tmxTiledMap` will be retained.
+  void put(std::shared_ptr<GameMapSpec> spec, cocos2d::TMXTiledMap* tmxTiledMap);
+
+  // Removes the specified map from the cache and returns it.
+  // The returned TMXTiledMap is autoreleased, so the caller should
+  // add it to the scene graph within the current frame.
+  // If no such map is cached, then entry.spec will be nullptr.
+  GameMapCache::Entry take(const std::string& tmxMapFileName);
+
+  bool contains(const std::string& tmxMapFileName) const;
+  void clear();
+
+  size_t getMemoryBudget() const;
+  void setMemoryBudget(size_t memoryBudget);
+  const GameMapCache::Stats& getStats() const;
+
+ private:
+  struct Node final {
+    GameMapCache::Entry entry;
+    size_t memoryUsage;
+  };
+
+  static size_t estimateMemoryUsage(const GameMapSpec& spec,
+                                    cocos2d::TMXTiledMap* tmxTiledMap);
+
+  void evict(std::list<GameMapCache::Node>::iterator it);
+  void evictUntilWithinBudget();
+
+  // Most recently used maps are at the front.
+  std::list<GameMapCache::Node> _lruList;
+  std::unordered_map<std::string, std::list<GameMapCache::Node>::iterator> _lruMap;
+
+  size_t _memoryBudget;
+  GameMapCache::Stats _stats;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_GAME_MAP_CACHE_H_
@@ -1,28 +1,61 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "GameMapManager.h"
 
+#include <algorithm>
+#include <chrono>
 #include <thread>
 
 #include <Box2D/Box2D.h>
 #include "std/make_unique.h"
+#include "AnimationCache.h"
 #include "AssetManager.h"
-#include "CallbackManager.h"
+#include "AudioManager.h"
 #include "Constants.h"
+#include "ContentPackManager.h"
+#include "FrameAnimator.h"
+#include "TextureResidency.h"
 #include "character/Npc.h"
 #include "character/Player.h"
+#include "gameplay/Autosaver.h"
+#include "gameplay/CameraSystem.h"
+#include "gameplay/CheckpointManager.h"
+#include "gameplay/CombatSystem.h"
+#include "gameplay/CooldownSystem.h"
+#include "gameplay/PickupSystem.h"
+#include "gameplay/ScriptRunner.h"
+#include "gameplay/StatsSystem.h"
 #include "item/Equipment.h"
+#include "map/WorldEpoch.h"
 #include "skill/MagicalMissile.h"
 #include "ui/Shade.h"
+#include "ui/notifications/Notifications.h"
 #include "ui/pause_menu/PauseMenu.h"
 #include "util/box2d/b2BodyBuilder.h"
+#include "util/FrameProfiler.h"
+#include "util/Logger.h"
+#include "util/MainThread.h"
+#include "util/MemoryTracker.h"
+#include "util/Telemetry.h"
+#include "util/ThreadPool.h"
+#include "util/TraceProfiler.h"
+
+#define GAME_MAP_CACHE_MEMORY_BUDGET (32 * 1024 * 1024)  // 32 MiB
+
+#define DEFAULT_LOD_MARGIN (kVirtualWidth / 4.0f)
+#define LOW_LOD_MARGIN_SCALE 4.0f
 
 using std::string;
+using std::vector;
 using std::thread;
+using std::shared_ptr;
+using std::unordered_set;
 using std::function;
 using cocos2d::Director;
+using cocos2d::Rect;
 using cocos2d::Layer;
+using cocos2d::Texture2D;
+using cocos2d::TextureCache;
 using cocos2d::TMXTiledMap;
-using cocos2d::TMXObjectGroup;
 using cocos2d::Sequence;
 using cocos2d::FadeIn;
 using cocos2d::FadeOut;
@@ -30,6 +63,9 @@ using cocos2d::CallFunc;
 
 namespace vigilante {
 
+const float GameMapManager::_kPrefetchDistance = 3.0f;
+const int GameMapManager::_kLowLodUpdateInterval = 4;
+
 GameMapManager* GameMapManager::getInstance() {
   static GameMapManager instance({0, kGravity});
   return &instance;
@@ -37,18 +73,106 @@ GameMapManager* GameMapManager::getInstance() {
 
 GameMapManager::GameMapManager(const b2Vec2& gravity)
     : _layer(Layer::create()),
+      _renderBuckets(std::make_unique<RenderBuckets>(_layer)),
+      _batchNodeRegistry(std::make_unique<BatchNodeRegistry>(_renderBuckets.get())),
+      _particleSystem(std::make_unique<ParticleSystem>(_renderBuckets.get())),
+      _lightMap(std::make_unique<LightMap>(_renderBuckets.get())),
       _worldContactListener(std::make_unique<WorldContactListener>()),
       _world(std::make_unique<b2World>(gravity)),
+      _projectilePool(std::make_unique<ProjectilePool>(_world.get())),
+      _physicsQueryService(std::make_unique<PhysicsQueryService>(_world.get())),
       _gameMap(),
-      _player() {
+      _player(),
+      _jobPool(std::make_unique<JobPool>(
+          std::max(static_cast<int>(thread::hardware_concurrency()) - 1, 0))),
+      _npcUpdates(),
+      _thinkingNpcs(),
+      _transformSync(),
+      _tileCollider(_worldContactListener.get()),
+      _frameCount(),
+      _gameMapCache(GAME_MAP_CACHE_MEMORY_BUDGET),
+      _prefetchedGameMaps(),
+      _pendingPrefetches(),
+      _numBulletBodies(),
+      _continuousPhysicsMode(ContinuousPhysicsMode::AUTO),
+      _lodMargin(DEFAULT_LOD_MARGIN),
+      _isAwaitingContentPack() {
   _world->SetAllowSleeping(true);
-  _world->SetContinuousPhysics(true);
+  _world->SetContinuousPhysics(false);  // see setBullet()
   _world->SetContactListener(_worldContactListener.get());
+  _world->SetDestructionListener(_worldContactListener.get());
 }
 
 void GameMapManager::update(float delta) {
-  for (auto& actor : _gameMap->_dynamicActors) {
-    actor->update(delta);
+  VGTRACE_ZONE("GameMapManager::update");
+  FrameAnimator::advanceClock(delta);
+
+  // Resolve the queries made by the AI during the last frame
+  // against the b2World which has just been stepped.
+  _physicsQueryService->resolvePendingQueries();
+
+  // Regenerate the vitals of all characters in one pass, see StatsSystem.
+  StatsSystem::getInstance()->update(delta);
+  CooldownSystem::getInstance()->update(delta);
+
+  // Resume the scripts (e.g., cutscenes started by triggers), see ScriptRunner.
+  ScriptRunner::getInstance()->update(delta);
+
+  const ActorRegistry& actors = _gameMap->_dynamicActors;
+  _frameCount++;
+
+  // Npcs are updated based on their update LOD, see GameMapManager::UpdateLod.
+  // The frames in which the LOW LOD Npcs are updated are staggered,
+  // so that they won't all be updated in the same frame.
+  const Rect& viewRect = CameraSystem::getInstance()->getViewRect();
+  unsigned int npcIndex = 0;
+  _npcUpdates.clear();
+
+  actors.forEachInGroup(ActorRegistry::Group::NPC, [this, delta, &viewRect, &npcIndex](DynamicActor* actor) {
+    Npc* npc = static_cast<Npc*>(actor);
+    const GameMapManager::UpdateLod lod = getUpdateLod(viewRect, npc->getBody());
+    npc->setInView(lod == UpdateLod::HIGH);
+
+    if (lod != UpdateLod::LOW) {
+      _npcUpdates.push_back({npc, delta});
+    } else if ((_frameCount + npcIndex) % _kLowLodUpdateInterval == 0) {
+      _npcUpdates.push_back({npc, delta * _kLowLodUpdateInterval});
+    }
+    npcIndex++;
+  });
+
+  // The player's allies are heading for their slots in the party's formation.
+  if (_player) {
+    _player->getParty()->updateFormation();
+  }
+
+  _thinkingNpcs.clear();
+  for (const auto& npcUpdate : _npcUpdates) {
+    _thinkingNpcs.push_back(npcUpdate.npc);
+  }
+  if (_player) {
+    for (const auto& ally : _player->getAllies()) {
+      if (Npc* npc = dynamic_cast<Npc*>(ally)) {
+        _thinkingNpcs.push_back(npc);
+      }
+    }
+  }
+
+  // Let all Npcs think in parallel. Nothing else touches the game state
+  // until they're done, and then their actions are applied one by one.
+  const vector<Npc*>& thinkingNpcs = _thinkingNpcs;
+  _jobPool->parallelFor(thinkingNpcs.size(), [&thinkingNpcs](size_t i) {
+    thinkingNpcs[i]->think();
+  });
+
+  for (const auto& npcUpdate : _npcUpdates) {
+    npcUpdate.npc->update(npcUpdate.delta);
+  }
+
+  for (auto group : {ActorRegistry::Group::ITEM, ActorRegistry::Group::CHEST, ActorRegistry::Group::OTHER}) {
+    actors.forEachInGroup(group, [delta](DynamicActor* actor) {
+      actor->update(delta);
+    });
   }
 
   if (_player) {
@@ -57,83 +181,519 @@ void GameMapManager::update(float delta) {
     for (const auto& ally : _player->getAllies()) {
       ally->update(delta);
     }
+
+    prefetchNearbyPortalTargets();
+  }
+
+  PickupSystem::getInstance()->update(delta);
+
+  // Resolve the hits landed during this frame in one batch, see CombatSystem.
+  CombatSystem::getInstance()->resolve();
+
+  // Sync the sprites of all actors (including those spawned during this frame)
+  // with their b2Bodies in one pass, see TransformSync.
+  actors.forEach([this](DynamicActor* actor) {
+    _transformSync.add(actor);
+  });
+  if (_player) {
+    _transformSync.add(_player.get());
+
+    for (const auto& ally : _player->getAllies()) {
+      _transformSync.add(ally);
+    }
+  }
+  _transformSync.flush();
+  _batchNodeRegistry->updateTransforms(*_jobPool);
+
+  _particleSystem->update(delta);
+
+  _gameMap->_dynamicActors.rebuildSpatialIndex();
+  _gameMap->_recentlyDroppedItems.clear();
+}
+
+
+void GameMapManager::stepWorld(float timeStep) {
+  _gameMap->_dynamicActors.forEach([](DynamicActor* actor) {
+    actor->recordPreviousBodyPosition();
+  });
+
+  if (_player) {
+    _player->recordPreviousBodyPosition();
+
+    for (const auto& ally : _player->getAllies()) {
+      ally->recordPreviousBodyPosition();
+    }
+  }
+
+  // Note that the world is stepped on the main thread as a whole, so far-apart
+  // clusters of fighting Npcs (which are all awake) are solved one after
+  // another on a single core. b2World::Step() is not reentrant (the contact
+  // manager, the broadphase and the island stack are shared by all islands),
+  // and splitting a map into several b2Worlds would require migrating bodies
+  // between them and duplicating the static layers. Only the sandboxing Npcs
+  // are put to sleep (see Npc::act()), and thus skipped by Box2D.
+  {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::PHYSICS_STEP);
+    _world->Step(timeStep, kVelocityIterations, kPositionIterations);
+  }
+
+  // The terrain of a tile-aligned map isn't in the b2World, see TileCollider.
+  if (_tileCollider.isEnabled()) {
+    _gameMap->_dynamicActors.forEach([this, timeStep](DynamicActor* actor) {
+      _tileCollider.resolve(actor, timeStep);
+    });
+
+    if (_player) {
+      _tileCollider.resolve(_player.get(), timeStep);
+
+      for (const auto& ally : _player->getAllies()) {
+        _tileCollider.resolve(ally, timeStep);
+      }
+    }
+    _tileCollider.endStep();
+  }
+
+  _worldContactListener->dispatchContactEvents();
+  _gameMap->updateTriggers();
+}
+
+GameMapManager::UpdateLod GameMapManager::getUpdateLod(const Rect& viewRect,
+                                                       const b2Body* body) const {
+  if (!body) {
+    return UpdateLod::HIGH;
+  }
+
+  const b2Vec2& pos = body->GetPosition();
+  const float x = pos.x * kPpm;
+  const float y = pos.y * kPpm;
+
+  // The distance (in pixels) between the body and the view rect.
+  const float dx = std::max({viewRect.getMinX() - x, x - viewRect.getMaxX(), 0.0f});
+  const float dy = std::max({viewRect.getMinY() - y, y - viewRect.getMaxY(), 0.0f});
+
+  const float lowLodMargin = _lodMargin * LOW_LOD_MARGIN_SCALE;
+  if (dx <= _lodMargin && dy <= _lodMargin) {
+    return UpdateLod::HIGH;
+  } else if (dx <= lowLodMargin && dy <= lowLodMargin) {
+    return UpdateLod::MEDIUM;
   }
+  return UpdateLod::LOW;
 }
 
 
 void GameMapManager::loadGameMap(const string& tmxMapFileName,
                                  const function<void ()>& afterLoadingGameMap) {
-  auto workerThreadLambda = [this, tmxMapFileName, afterLoadingGameMap]() {
-    // Pauses all NPCs from acting, preventing new callbacks
-    // from being generated.
-    Npc::setNpcsAllowedToAct(false);
-
-    // Block this thread with a spinlock until all callbacks have finished.
-    while (CallbackManager::getInstance()->getPendingCount() > 0);
-
-    // No pending callbacks. Now it's safe to load the new GameMap.
-    Shade::getInstance()->getImageView()->runAction(Sequence::createWithTwoActions(
-        CallFunc::create([this, tmxMapFileName, afterLoadingGameMap]() {
-          doLoadGameMap(tmxMapFileName);
-          afterLoadingGameMap();
-        }),
-        FadeOut::create(Shade::_kFadeOutTime)
-    ));
-
-    // Resume NPCs to act.
-    Npc::setNpcsAllowedToAct(true);
+  // The target map may be in a content pack which hasn't been downloaded yet,
+  // in which case it's loaded once the pack has been mounted.
+  ContentPackManager* contentPackManager = ContentPackManager::getInstance();
+  if (!contentPackManager->isAvailable(tmxMapFileName)) {
+    if (_isAwaitingContentPack) {
+      return;
+    }
+    _isAwaitingContentPack = true;
+    Notifications::getInstance()->show("Downloading...");
+    contentPackManager->requestMap(tmxMapFileName, [this, tmxMapFileName, afterLoadingGameMap](bool isAvailable) {
+      _isAwaitingContentPack = false;
+      if (!isAvailable) {
+        Notifications::getInstance()->show("Unable to download the map, please try again later.");
+        return;
+      }
+      loadGameMap(tmxMapFileName, afterLoadingGameMap);
+    });
+    return;
+  }
+
+  // If the target map is still resident in _gameMapCache, then we can skip
+  // both parsing and building it. Otherwise, if it has been prefetched,
+  // then we can at least skip parsing it.
+  const bool isCached = _gameMapCache.contains(tmxMapFileName);
+  shared_ptr<GameMapSpec> prefetchedSpec = (isCached) ? nullptr
+                                                      : takePrefetchedGameMap(tmxMapFileName);
+
+  const auto beginTime = std::chrono::steady_clock::now();
+
+  auto workerThreadLambda = [this, tmxMapFileName, afterLoadingGameMap, isCached, prefetchedSpec, beginTime]() {
+    // Parse the .tmx file and prebuild all body specs in this worker thread,
+    // so that the main thread only has to commit the b2Bodies later.
+    shared_ptr<GameMapSpec> spec;
+    if (!isCached) {
+      spec = (prefetchedSpec) ? prefetchedSpec : GameMapSpec::create(tmxMapFileName);
+    }
+
+    // There's no need to wait for the pending callbacks of the previous
+    // GameMap's Npcs: those bound to world_epoch are skipped once the
+    // transition has begun, and the rest are cancelled when the Npcs are
+    // removed from the map (see Character::removeFromMap()). Note that
+    // cocos2d::Node is not thread-safe, so we must not run actions on the
+    // shade from this worker thread.
+    ThreadPool::runOnMainThread([this, spec, tmxMapFileName, afterLoadingGameMap, beginTime]() {
+      Shade::getInstance()->getImageView()->runAction(Sequence::create(
+          CallFunc::create([this, spec, tmxMapFileName, afterLoadingGameMap]() {
+            GameMap* gameMap = nullptr;
+            if (spec) {
+              gameMap = doLoadGameMap(spec);
+            } else {
+              // The map was resident in _gameMapCache when loadGameMap() was called.
+              // If it has been evicted since then, parse it synchronously as a last resort.
+              GameMapCache::Entry entry = _gameMapCache.take(tmxMapFileName);
+              gameMap = (entry.spec) ? doLoadGameMap(entry.spec, entry.tmxTiledMap)
+                                     : doLoadGameMap(GameMapSpec::create(tmxMapFileName));
+            }
+
+            if (gameMap) {
+              afterLoadingGameMap();
+              Autosaver::getInstance()->request();
+              CheckpointManager::getInstance()->request();
+            }
+
+            // Resume NPCs to act.
+            world_epoch::endTransition();
+
+            // Populate the neighborhood of where the player has entered,
+            // and stream in the rest of the map during the next frames.
+            if (gameMap && _player) {
+              const b2Vec2& playerPos = _player->getBody()->GetPosition();
+              gameMap->spawnQueuedActors({playerPos.x * kPpm, playerPos.y * kPpm});
+            }
+          }),
+          FadeOut::create(Shade::_kFadeOutTime),
+          CallFunc::create([tmxMapFileName, beginTime]() {
+            const std::chrono::duration<float> loadTime = std::chrono::steady_clock::now() - beginTime;
+            Telemetry::getInstance()->addMapLoadTime(tmxMapFileName, loadTime.count());
+          }),
+          nullptr
+      ));
+    });
   };
 
   // 1. Fade in the shade
-  // 2. Create another thread which executes the above lambda independently.
+  // 2. Run the above lambda on a worker thread of the ThreadPool.
   Shade::getInstance()->getImageView()->runAction(Sequence::createWithTwoActions(
       FadeIn::create(Shade::_kFadeInTime),
       CallFunc::create([workerThreadLambda]() {
-        thread(workerThreadLambda).detach();
+        // Pauses all NPCs from acting, and drops the callbacks
+        // which they have scheduled.
+        world_epoch::beginTransition();
+        ThreadPool::getInstance()->post(workerThreadLambda);
       })
   ));
 }
 
-GameMap* GameMapManager::doLoadGameMap(const string& tmxMapFileName) {
+bool GameMapManager::loadGameMapSeamlessly(const string& tmxMapFileName,
+                                           const function<void ()>& afterLoadingGameMap) {
+  if (!_gameMapCache.contains(tmxMapFileName) || world_epoch::isInTransition() ||
+      _isAwaitingContentPack || !ContentPackManager::getInstance()->isAvailable(tmxMapFileName)) {
+    return false;
+  }
+
+  // The portal may have been interacted with during b2World::Step() or while
+  // the actors are being iterated over, so the current GameMap can't be deleted
+  // right away. In the meantime, the NPCs are paused as usual.
+  world_epoch::beginTransition();
+
+  ThreadPool::runOnMainThread([this, tmxMapFileName, afterLoadingGameMap]() {
+    const auto beginTime = std::chrono::steady_clock::now();
+
+    // It may have been evicted from _gameMapCache since then.
+    GameMapCache::Entry entry = _gameMapCache.take(tmxMapFileName);
+    GameMap* gameMap = (entry.spec) ? doLoadGameMap(entry.spec, entry.tmxTiledMap)
+                                    : doLoadGameMap(GameMapSpec::create(tmxMapFileName));
+    if (gameMap) {
+      afterLoadingGameMap();
+      Autosaver::getInstance()->request();
+      CheckpointManager::getInstance()->request();
+    }
+
+    world_epoch::endTransition();
+
+    if (gameMap && _player) {
+      const b2Vec2& playerPos = _player->getBody()->GetPosition();
+      CameraSystem::getInstance()->snapTo(playerPos, gameMap);
+      gameMap->spawnQueuedActors({playerPos.x * kPpm, playerPos.y * kPpm});
+    }
+
+    const std::chrono::duration<float> loadTime = std::chrono::steady_clock::now() - beginTime;
+    Telemetry::getInstance()->addMapLoadTime(tmxMapFileName, loadTime.count());
+  });
+  return true;
+}
+
+void GameMapManager::resetGameMap() {
+  if (!_gameMap) {
+    return;
+  }
+
+  _gameMap->resetObjects();
+  _physicsQueryService->clear();
+  _particleSystem->clear();
+}
+
+GameMap* GameMapManager::doLoadGameMap(shared_ptr<GameMapSpec> spec,
+                                       TMXTiledMap* tmxTiledMap) {
+  VGTRACE_ZONE("GameMapManager::doLoadGameMap");
+  if (!spec) {
+    VGLOG(LOG_ERR, "Unable to load GameMap: invalid GameMapSpec");
+    return nullptr;
+  }
+
   // Remove deceased party member from player's party, remove their
   // b2body and texture, and add them to the party's deceasedMember unordered_set.
   if (_player) {
-    for (auto ally : _player->getAllies()) {
+    // Copied, since dismissing a member invalidates the view.
+    const vector<Character*> allies = _player->getAllies();
+    for (auto ally : allies) {
       if (ally->isKilled()) {
         _player->getParty()->dismiss(ally, /*addToMap=*/false);
       }
     }
   }
 
-  // Clean up previous GameMap.
-  if (_gameMap) {
-    _layer->removeChild(_gameMap->getTmxTiledMap());
-    _gameMap->deleteObjects();
-    _gameMap.reset();  // deletes the underlying GameMap object and _gameMap = nullptr.
-  }
+  unloadGameMap();
+
+  // The animations which are no longer referenced by any actor
+  // (e.g., those of the npcs in the previous GameMap) can be freed now.
+  AnimationCache::getInstance()->evictUnused();
+  _batchNodeRegistry->removeEmptyBatchNodes();
+  _particleSystem->clear();
+
+  // Now that the previous GameMap's animations are gone,
+  // only the new GameMap's spritesheets have to stay in VRAM.
+  TextureResidency::getInstance()->switchWorkingSet(*spec);
 
   // Load the new GameMap.
-  _gameMap = std::make_unique<GameMap>(_world.get(), tmxMapFileName);
+  _gameMap = std::make_unique<GameMap>(_world.get(), std::move(spec), tmxTiledMap);
   _gameMap->createObjects();
-  _layer->addChild(_gameMap->getTmxTiledMap(), graphical_layers::kTmxTiledMap);
+  ContentPackManager::getInstance()->setCurrentMap(_gameMap->getTmxTiledMapFileName());
+  _tileCollider.setGrid(&_gameMap->getSpec()->tileCollisionGrid);
+  _physicsQueryService->setTileCollisionGrid(&_gameMap->getSpec()->tileCollisionGrid);
+  _renderBuckets->get(graphical_layers::kTmxTiledMap)->addChild(_gameMap->getTmxTiledMap());
+  _lightMap->reset(*_gameMap->getSpec());
 
   // If the player object hasn't been created yet, then spawn it.
   if (!_player) {
     _player = _gameMap->createPlayer();
   }
 
+  evictUnreachablePrefetchedGameMaps();
+  AudioManager::getInstance()->onGameMapLoaded(*_gameMap->getSpec());
+
+  // Catch whatever is leaked across the GameMap transitions.
+  MemoryTracker::getInstance()->onGameMapLoaded(_gameMap.get());
   return _gameMap.get();
 }
 
+void GameMapManager::unloadGameMap() {
+  // Clean up previous GameMap, but keep its TMXTiledMap and GameMapSpec
+  // resident in _gameMapCache for instant backtracking.
+  if (_gameMap) {
+    _gameMapCache.put(_gameMap->getSpec(), _gameMap->getTmxTiledMap());
+    _gameMap->getTmxTiledMap()->removeFromParent();
+    _gameMap->deleteObjects();
+    _gameMap.reset();  // deletes the underlying GameMap object and _gameMap = nullptr.
+    _physicsQueryService->clear();
+    _physicsQueryService->setTileCollisionGrid(nullptr);
+  }
+
+  // The player and its allies are carried over to the next map.
+  if (_tileCollider.isEnabled() && _player) {
+    _tileCollider.restore(_player.get());
+    for (const auto& ally : _player->getAllies()) {
+      _tileCollider.restore(ally);
+    }
+  }
+  _tileCollider.setGrid(nullptr);
+}
+
+
+void GameMapManager::prefetchNearbyPortalTargets() {
+  if (!_gameMap) {
+    return;
+  }
+
+  const CameraSystem* cameraSystem = CameraSystem::getInstance();
+  bool hasBuiltGameMap = false;  // at most one per frame
+
+  for (const auto& portal : _gameMap->_portals) {
+    if (!cameraSystem->isInView(portal->getBody()->GetPosition(), _kPrefetchDistance)) {
+      continue;
+    }
+
+    const string& targetTmxMapFileName = portal->getTargetTmxMapFileName();
+    if (targetTmxMapFileName == _gameMap->getTmxTiledMapFileName()) {
+      continue;
+    }
+
+    prefetchGameMap(targetTmxMapFileName);
+    if (portal->isSeamless() && !hasBuiltGameMap) {
+      hasBuiltGameMap = prebuildGameMap(targetTmxMapFileName);
+    }
+  }
+}
+
+bool GameMapManager::prebuildGameMap(const string& tmxMapFileName) {
+  auto it = _prefetchedGameMaps.find(tmxMapFileName);
+  if (it == _prefetchedGameMaps.end()) {
+    return false;
+  }
+
+  TextureCache* textureCache = Director::getInstance()->getTextureCache();
+  for (const auto tileset : it->second->getTmxMapInfo()->getTilesets()) {
+    if (!textureCache->getTextureForKey(tileset->_sourceImage)) {
+      return false;
+    }
+  }
+
+  shared_ptr<GameMapSpec> spec = takePrefetchedGameMap(tmxMapFileName);
+  TMXTiledMap* tmxTiledMap = GameMap::buildTmxTiledMap(*spec);
+  _gameMapCache.put(std::move(spec), tmxTiledMap);
+  VGLOG(LOG_INFO, "Prebuilt: %s", tmxMapFileName.c_str());
+  return true;
+}
+
+void GameMapManager::prefetchGameMap(const string& tmxMapFileName) {
+  // Its content pack may still be downloading, see ContentPackManager::setCurrentMap().
+  if (!ContentPackManager::getInstance()->isAvailable(tmxMapFileName) ||
+      _gameMapCache.contains(tmxMapFileName) ||
+      _prefetchedGameMaps.find(tmxMapFileName) != _prefetchedGameMaps.end() ||
+      _pendingPrefetches.find(tmxMapFileName) != _pendingPrefetches.end()) {
+    return;
+  }
+
+  _pendingPrefetches.insert(tmxMapFileName);
+
+  ThreadPool::getInstance()->post([this, tmxMapFileName]() {
+    shared_ptr<GameMapSpec> spec = GameMapSpec::create(tmxMapFileName);
+
+    ThreadPool::runOnMainThread([this, tmxMapFileName, spec]() {
+      _pendingPrefetches.erase(tmxMapFileName);
+      if (!spec) {
+        return;
+      }
+
+      // Warm up the tileset textures, so that TMXLayer won't
+      // have to load them synchronously when the map is built.
+      for (const auto tileset : spec->getTmxMapInfo()->getTilesets()) {
+        Director::getInstance()->getTextureCache()->addImageAsync(tileset->_sourceImage,
+                                                                  [](Texture2D*) {});
+      }
+      TextureResidency::getInstance()->prefetchWorkingSet(*spec);
+      _prefetchedGameMaps.insert({tmxMapFileName, spec});
+      VGLOG(LOG_INFO, "Prefetched: %s", tmxMapFileName.c_str());
+    });
+  });
+}
+
+shared_ptr<GameMapSpec> GameMapManager::takePrefetchedGameMap(const string& tmxMapFileName) {
+  auto it = _prefetchedGameMaps.find(tmxMapFileName);
+  if (it == _prefetchedGameMaps.end()) {
+    return nullptr;
+  }
+
+  // A GameMapSpec can only be used to build one GameMap,
+  // so we have to remove it from the cache.
+  shared_ptr<GameMapSpec> spec = std::move(it->second);
+  _prefetchedGameMaps.erase(it);
+  return spec;
+}
+
+void GameMapManager::evictUnreachablePrefetchedGameMaps() {
+  unordered_set<string> reachableTmxMapFileNames;
+  for (const auto& portalSpec : _gameMap->_spec->portals) {
+    reachableTmxMapFileNames.insert(portalSpec.targetTmxMapFileName);
+  }
+
+  for (auto it = _prefetchedGameMaps.begin(); it != _prefetchedGameMaps.end();) {
+    if (reachableTmxMapFileNames.find(it->first) == reachableTmxMapFileNames.end()) {
+      it = _prefetchedGameMaps.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
 
 Layer* GameMapManager::getLayer() const {
+  VGASSERT_MAIN_THREAD();
   return _layer;
 }
 
+RenderBuckets* GameMapManager::getRenderBuckets() const {
+  VGASSERT_MAIN_THREAD();
+  return _renderBuckets.get();
+}
+
+BatchNodeRegistry* GameMapManager::getBatchNodeRegistry() const {
+  VGASSERT_MAIN_THREAD();
+  return _batchNodeRegistry.get();
+}
+
+ParticleSystem* GameMapManager::getParticleSystem() const {
+  VGASSERT_MAIN_THREAD();
+  return _particleSystem.get();
+}
+
+LightMap* GameMapManager::getLightMap() const {
+  VGASSERT_MAIN_THREAD();
+  return _lightMap.get();
+}
+
 b2World* GameMapManager::getWorld() const {
   return _world.get();
 }
 
+WorldContactListener* GameMapManager::getWorldContactListener() const {
+  return _worldContactListener.get();
+}
+
+ProjectilePool* GameMapManager::getProjectilePool() const {
+  return _projectilePool.get();
+}
+
+void GameMapManager::setBullet(b2Body* body, bool bullet) {
+  if (body->IsBullet() == bullet) {
+    return;
+  }
+
+  body->SetBullet(bullet);
+  _numBulletBodies += (bullet) ? 1 : -1;
+  updateContinuousPhysics();
+}
+
+GameMapManager::ContinuousPhysicsMode GameMapManager::getContinuousPhysicsMode() const {
+  return _continuousPhysicsMode;
+}
+
+void GameMapManager::setContinuousPhysicsMode(GameMapManager::ContinuousPhysicsMode mode) {
+  _continuousPhysicsMode = mode;
+  updateContinuousPhysics();
+}
+
+void GameMapManager::updateContinuousPhysics() {
+  switch (_continuousPhysicsMode) {
+    case ContinuousPhysicsMode::ALWAYS:
+      _world->SetContinuousPhysics(true);
+      break;
+    case ContinuousPhysicsMode::NEVER:
+      _world->SetContinuousPhysics(false);
+      break;
+    default:
+      _world->SetContinuousPhysics(_numBulletBodies > 0);
+      break;
+  }
+}
+
+float GameMapManager::getLodMargin() const {
+  return _lodMargin;
+}
+
+void GameMapManager::setLodMargin(float lodMargin) {
+  _lodMargin = lodMargin;
+}
+
+PhysicsQueryService* GameMapManager::getPhysicsQueryService() const {
+  return _physicsQueryService.get();
+}
+
 GameMap* GameMapManager::getGameMap() const {
   return _gameMap.get();
 }
@@ -142,4 +702,8 @@ Player* GameMapManager::getPlayer() const {
   return _player.get();
 }
 
+GameMapCache& GameMapManager::getGameMapCache() {
+  return _gameMapCache;
+}
+
 }  // namespace vigilante
@@ -6,18 +6,35 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <cocos2d.h>
 #include <Box2D/Box2D.h>
+#include "BatchNodeRegistry.h"
+#include "Constants.h"
 #include "GameMap.h"
+#include "GameMapCache.h"
+#include "GameMapSpec.h"
+#include "LightMap.h"
+#include "ParticleSystem.h"
+#include "PhysicsQueryService.h"
+#include "RenderBuckets.h"
+#include "TileCollider.h"
+#include "TransformSync.h"
 #include "WorldContactListener.h"
 #include "Controllable.h"
+#include "ProjectilePool.h"
 #include "character/Character.h"
 #include "item/Item.h"
+#include "util/JobPool.h"
 
 namespace vigilante {
 
 // Forward Declaration
+class MapLoadBenchmark;
+class Npc;
 class Player;
 
 class GameMapManager {
@@ -27,6 +44,12 @@ class GameMapManager {
 
   void update(float delta);
 
+  // Steps _world by `timeStep` (kFixedTimeStep, or twice as much in battery
+  // saver mode, see FramePacer). Before stepping, the b2Body position of
+  // every DynamicActor is recorded for physics interpolation
+  // (see DynamicActor::getInterpolatedBodyPosition()).
+  void stepWorld(float timeStep=kFixedTimeStep);
+
   // Safely loads the specified GameMap using a worker thread
   // which executes independently in background.
   //
@@ -58,23 +81,149 @@ class GameMapManager {
   void loadGameMap(const std::string& tmxMapFileName,
                    const std::function<void ()>& afterLoadingGameMap=[]() {});
 
+  // Swaps to the specified GameMap without the shade, e.g., walking through
+  // a doorway between adjacent rooms (a portal with the "isSeamless" property).
+  // The target map must have been built ahead of time (see prebuildGameMap()),
+  // so that only its b2Bodies have to be committed. The maps are swapped at
+  // the start of the next frame, and then the camera snaps to the player.
+  //
+  // Returns false if the target map isn't ready, in which case nothing is done
+  // and the caller should fall back to loadGameMap().
+  bool loadGameMapSeamlessly(const std::string& tmxMapFileName,
+                             const std::function<void ()>& afterLoadingGameMap);
+
+  // Recreates the objects of the current GameMap in place (see GameMap::resetObjects()),
+  // without reloading the map or any of its assets. Must be called while
+  // the world is in transition (see world_epoch), e.g., by GameState::restoreInPlace().
+  void resetGameMap();
+
+  // Continuous collision (TOI) is only solved while there are bullet bodies,
+  // e.g., projectiles and dashing characters (see Skill::Profile::isBullet).
+  // All other bodies rely on discrete collision.
+  void setBullet(b2Body* body, bool bullet);
+
+  // AUTO: continuous collision follows the bullet bodies, see setBullet().
+  // ALWAYS / NEVER: overrides it, e.g., to measure its cost
+  //                 (see the "physics" console command).
+  enum ContinuousPhysicsMode {
+    AUTO,
+    ALWAYS,
+    NEVER
+  };
+
+  GameMapManager::ContinuousPhysicsMode getContinuousPhysicsMode() const;
+  void setContinuousPhysicsMode(GameMapManager::ContinuousPhysicsMode mode);
+
+  // The margin (in pixels) around the view within which the Npcs are
+  // updated at HIGH LOD, see GameMapManager::UpdateLod.
+  float getLodMargin() const;
+  void setLodMargin(float lodMargin);
+
+  // Parses the GameMapSpec of `tmxMapFileName` on a worker thread and starts
+  // loading its tileset textures, so that a later loadGameMap() of it can skip
+  // both (e.g., the initial map, see GameSceneWarmUp).
+  void prefetchGameMap(const std::string& tmxMapFileName);
+
   cocos2d::Layer* getLayer() const;
+  RenderBuckets* getRenderBuckets() const;
+  BatchNodeRegistry* getBatchNodeRegistry() const;
+  ParticleSystem* getParticleSystem() const;
+  LightMap* getLightMap() const;
   b2World* getWorld() const;
+  WorldContactListener* getWorldContactListener() const;
+  ProjectilePool* getProjectilePool() const;
+  PhysicsQueryService* getPhysicsQueryService() const;
   GameMap* getGameMap() const;
   Player* getPlayer() const;
+  GameMapCache& getGameMapCache();
 
  private:
   explicit GameMapManager(const b2Vec2& gravity);
 
+  // Update LOD (level of detail) of the Npcs on the current map.
+  // HIGH: within the camera's view (plus _lodMargin). Updated every frame.
+  // MEDIUM: slightly out of view. Updated every frame, but the sprites
+  //         and animations are not synced (see Character::isInView()).
+  // LOW: far out of view (beyond LOW_LOD_MARGIN_SCALE * _lodMargin).
+  //      Same as MEDIUM, but only updated every _kLowLodUpdateInterval
+  //      frames (with the accumulated delta).
+  enum UpdateLod {
+    HIGH,
+    MEDIUM,
+    LOW
+  };
+
+  GameMapManager::UpdateLod getUpdateLod(const cocos2d::Rect& viewRect, const b2Body* body) const;
+  void updateContinuousPhysics();
+
+  // The Npcs on the current map to be updated in this frame.
+  struct NpcUpdate final {
+    Npc* npc;
+    float delta;
+  };
+
+  // Predictive preloading of the maps reachable from the current map's portals.
+  // When a portal is within _kPrefetchDistance of the view (see CameraSystem), the target map's
+  // GameMapSpec is parsed by a worker thread and its tileset textures are
+  // loaded asynchronously, so that walking through that portal later won't
+  // have to parse the .tmx file again.
+  //
+  // The targets of the seamless portals are built into _gameMapCache as well
+  // (see prebuildGameMap()), as if they had been visited.
+  void prefetchNearbyPortalTargets();
+  // Returns true if the TMXTiledMap of `tmxMapFileName` has been built in this call.
+  // It's only built once its GameMapSpec has been prefetched and its tileset
+  // textures have been loaded, so that building it won't block on I/O.
+  bool prebuildGameMap(const std::string& tmxMapFileName);
+  std::shared_ptr<GameMapSpec> takePrefetchedGameMap(const std::string& tmxMapFileName);
+  void evictUnreachablePrefetchedGameMaps();
+
   // Internal function - NOT safe if used with CallbackManager!
-  // Used by GameMap::loadGameMap().
-  GameMap* doLoadGameMap(const std::string& tmxMapFileName);
+  // Used by GameMap::loadGameMap(). Must be called on the main thread,
+  // since it commits the b2Bodies described by `spec` to _world.
+  // If `tmxTiledMap` is given, it will be reused instead of building a new one.
+  GameMap* doLoadGameMap(std::shared_ptr<GameMapSpec> spec,
+                         cocos2d::TMXTiledMap* tmxTiledMap=nullptr);
+  // Used by doLoadGameMap(). Deletes the objects of the current GameMap, if any.
+  void unloadGameMap();
 
   cocos2d::Layer* _layer;
+  std::unique_ptr<RenderBuckets> _renderBuckets;
+  std::unique_ptr<BatchNodeRegistry> _batchNodeRegistry;
+  std::unique_ptr<ParticleSystem> _particleSystem;
+  std::unique_ptr<LightMap> _lightMap;
   std::unique_ptr<WorldContactListener> _worldContactListener;
   std::unique_ptr<b2World> _world;
+  std::unique_ptr<ProjectilePool> _projectilePool;
+  std::unique_ptr<PhysicsQueryService> _physicsQueryService;
   std::unique_ptr<GameMap> _gameMap;
   std::unique_ptr<Player> _player;
+
+  // Runs Npc::think() of all Npcs in parallel, see GameMapManager::update().
+  std::unique_ptr<JobPool> _jobPool;
+  std::vector<GameMapManager::NpcUpdate> _npcUpdates;
+  std::vector<Npc*> _thinkingNpcs;  // including the player's allies
+  TransformSync _transformSync;
+  TileCollider _tileCollider;
+
+  static const float _kPrefetchDistance;
+  static const int _kLowLodUpdateInterval;
+
+  unsigned int _frameCount;
+
+  // Recently visited maps, see GameMapCache.
+  GameMapCache _gameMapCache;
+
+  // The following two are only accessed by the main thread.
+  std::unordered_map<std::string, std::shared_ptr<GameMapSpec>> _prefetchedGameMaps;
+  std::unordered_set<std::string> _pendingPrefetches;
+
+  int _numBulletBodies;
+  GameMapManager::ContinuousPhysicsMode _continuousPhysicsMode;
+  float _lodMargin;
+  bool _isAwaitingContentPack;  // see loadGameMap()
+
+  friend class MapLoadBenchmark;
 };
 
 }  // namespace vigilante
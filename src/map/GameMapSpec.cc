@@ -0,0 +1,716 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "GameMapSpec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#include <zlib.h>
+#include "Constants.h"
+#include "util/ds/BinaryStream.h"
+#include "util/MappedFile.h"
+#include "util/StringUtil.h"
+#include "util/Logger.h"
+
+#define COMPILED_MAP_MAGIC 0x534d4756  // "VGMS"
+#define COMPILED_MAP_VERSION 6
+#define COMPILED_MAP_DIR "map_cache/"
+#define WELD_EPSILON .5f  // in pixels
+#define MAX_WALKABLE_SLOPE 1.0f  // dy/dx
+#define PLATFORM_ONE_WAY_TOLERANCE .15f  // in meters
+#define COLLISION_LAYER_NAME "Collision"
+
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::unique_ptr;
+using cocos2d::Color3B;
+using cocos2d::Data;
+using cocos2d::Director;
+using cocos2d::FileUtils;
+using cocos2d::TMXMapInfo;
+using cocos2d::ValueVector;
+
+namespace vigilante {
+
+namespace {
+
+const ValueVector kEmptyValueVector;
+
+void writeRectangle(BinaryWriter& writer, const GameMapSpec::Rectangle& rect) {
+  writer.write(rect.x);
+  writer.write(rect.y);
+  writer.write(rect.width);
+  writer.write(rect.height);
+}
+
+bool isSamePoint(const b2Vec2& p1, const b2Vec2& p2) {
+  return (p1 - p2).LengthSquared() <= WELD_EPSILON * WELD_EPSILON;
+}
+
+// Appends `other` to the end of `vertices` if they share an endpoint.
+// `other` may be reversed in order to make them connect.
+bool tryWeld(vector<b2Vec2>& vertices, const vector<b2Vec2>& other) {
+  if (isSamePoint(vertices.back(), other.front())) {
+    vertices.insert(vertices.end(), other.begin() + 1, other.end());
+  } else if (isSamePoint(vertices.back(), other.back())) {
+    vertices.insert(vertices.end(), other.rbegin() + 1, other.rend());
+  } else if (isSamePoint(vertices.front(), other.back())) {
+    vertices.insert(vertices.begin(), other.begin(), other.end() - 1);
+  } else if (isSamePoint(vertices.front(), other.front())) {
+    vertices.insert(vertices.begin(), other.rbegin(), other.rend() - 1);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Removes the interior vertices which lie on the straight line formed by
+// their neighbors, since each of them costs an extra edge (broadphase proxy).
+void removeCollinearVertices(vector<b2Vec2>& vertices) {
+  if (vertices.size() <= 2) {
+    return;
+  }
+
+  vector<b2Vec2> result;
+  result.reserve(vertices.size());
+  result.push_back(vertices.front());
+
+  for (size_t i = 1; i < vertices.size() - 1; i++) {
+    const b2Vec2 d1 = vertices[i] - result.back();
+    const b2Vec2 d2 = vertices[i + 1] - vertices[i];
+    if (std::abs(b2Cross(d1, d2)) > WELD_EPSILON * (d1.Length() + d2.Length()) ||
+        b2Dot(d1, d2) <= 0) {
+      result.push_back(vertices[i]);
+    }
+  }
+
+  result.push_back(vertices.back());
+  vertices = std::move(result);
+}
+
+// Welds the polylines which share endpoints into longer chains.
+void weldPolylines(vector<GameMapSpec::Polyline>& polylines) {
+  bool hasWelded = true;
+  while (hasWelded) {
+    hasWelded = false;
+    for (size_t i = 0; i < polylines.size(); i++) {
+      for (size_t j = i + 1; j < polylines.size(); j++) {
+        if (tryWeld(polylines[i].vertices, polylines[j].vertices)) {
+          polylines.erase(polylines.begin() + j);
+          hasWelded = true;
+          j--;
+        }
+      }
+    }
+  }
+
+  for (auto& polyline : polylines) {
+    removeCollinearVertices(polyline.vertices);
+  }
+}
+
+// Parses "r,g,b", or returns `defaultColor` if it's malformed.
+Color3B parseColor(const string& s, const Color3B& defaultColor) {
+  const vector<string> components = string_util::split(s, ',');
+  if (components.size() != 3) {
+    VGLOG(LOG_WARN, "Malformed color: [%s]", s.c_str());
+    return defaultColor;
+  }
+  return Color3B(static_cast<GLubyte>(std::atoi(components[0].c_str())),
+                 static_cast<GLubyte>(std::atoi(components[1].c_str())),
+                 static_cast<GLubyte>(std::atoi(components[2].c_str())));
+}
+
+GameMapSpec::Rectangle readRectangle(BinaryReader& reader) {
+  GameMapSpec::Rectangle rect;
+  rect.x = reader.read<float>();
+  rect.y = reader.read<float>();
+  rect.width = reader.read<float>();
+  rect.height = reader.read<float>();
+  return rect;
+}
+
+}  // namespace
+
+unique_ptr<GameMapSpec> GameMapSpec::create(const string& tmxMapFileName) {
+  // Note that we can't use TMXMapInfo::create() here, since it calls
+  // autorelease() which touches the main thread's AutoreleasePool.
+  unique_ptr<GameMapSpec> spec(new GameMapSpec(tmxMapFileName));
+  spec->_tmxMapInfo = new (std::nothrow) TMXMapInfo();
+
+  if (!spec->_tmxMapInfo || !spec->_tmxMapInfo->initWithTMXFile(tmxMapFileName)) {
+    VGLOG(LOG_ERR, "Failed to parse tmx file: %s", tmxMapFileName.c_str());
+    return nullptr;
+  }
+
+  const auto& properties = spec->_tmxMapInfo->getProperties();
+  auto it = properties.find("isStreamed");
+  spec->isStreamed = it != properties.end() && it->second.asBool();
+  it = properties.find("bgm");
+  if (it != properties.end()) {
+    spec->bgm = it->second.asString();
+  }
+  it = properties.find("sfx");
+  if (it != properties.end()) {
+    for (auto& fileName : string_util::split(it->second.asString(), ',')) {
+      string_util::strip(fileName);
+      spec->sfx.push_back(std::move(fileName));
+    }
+  }
+  it = properties.find("textures");
+  if (it != properties.end()) {
+    for (auto& textureResDir : string_util::split(it->second.asString(), ',')) {
+      string_util::strip(textureResDir);
+      spec->textures.push_back(std::move(textureResDir));
+    }
+  }
+  it = properties.find("ambientLight");
+  if (it != properties.end()) {
+    spec->ambientLight = parseColor(it->second.asString(), Color3B::WHITE);
+  }
+
+  // The tiles aren't in the compiled map cache, but the nav graph
+  // built from them is, so the grid has to be parsed before loading it.
+  spec->parseCollisionLayer();
+
+  // Try the compiled map cache first.
+  const string compiledFileName = GameMapSpec::getCompiledFileName(tmxMapFileName);
+  const uint64_t sourceDigest = GameMapSpec::getSourceDigest(tmxMapFileName);
+  if (sourceDigest && spec->loadCompiled(compiledFileName, sourceDigest)) {
+    return spec;
+  }
+
+  float scaleFactor = Director::getInstance()->getContentScaleFactor();
+
+  spec->parsePolylines(spec->staticLayers[StaticLayerType::GROUND], scaleFactor);
+  spec->parsePolylines(spec->staticLayers[StaticLayerType::WALL], scaleFactor);
+  spec->parseRectangles(spec->staticLayers[StaticLayerType::PLATFORM]);
+  spec->parsePolylines(spec->staticLayers[StaticLayerType::PIVOT_MARKER], scaleFactor);
+  spec->parsePolylines(spec->staticLayers[StaticLayerType::CLIFF_MARKER], scaleFactor);
+
+  // Weld adjacent ground and wall segments into a few long chains.
+  // The markers are left untouched, since each of them should
+  // trigger its own BeginContact().
+  weldPolylines(spec->staticLayers[StaticLayerType::GROUND].polylines);
+  weldPolylines(spec->staticLayers[StaticLayerType::WALL].polylines);
+
+  spec->parseTriggers();
+  spec->parsePortals();
+  spec->parseNpcs();
+  spec->parseChests();
+  spec->parseLights();
+  spec->parsePlayerSpawnPos();
+  spec->buildNavGraph();
+  if (sourceDigest) {
+    spec->saveCompiled(compiledFileName, sourceDigest);
+  }
+  return spec;
+}
+
+GameMapSpec::GameMapSpec(const string& tmxMapFileName)
+    : tmxMapFileName(tmxMapFileName),
+      isStreamed(),
+      bgm(),
+      sfx(),
+      textures(),
+      ambientLight(Color3B::WHITE),
+      staticLayers({{
+        {"Ground", category_bits::kGround, true, kGroundFriction, {}, {}, {}},
+        {"Wall", category_bits::kWall, true, kWallFriction, {}, {}, {}},
+        {"Platform", category_bits::kPlatform, true, kGroundFriction,
+         {true, {0, 1}, PLATFORM_ONE_WAY_TOLERANCE}, {}, {}},
+        {"PivotMarker", category_bits::kPivotMarker, false, 0, {}, {}, {}},
+        {"CliffMarker", category_bits::kCliffMarker, false, 0, {}, {}, {}}
+      }}),
+      triggers(),
+      portals(),
+      npcs(),
+      chests(),
+      lights(),
+      tileCollisionGrid(),
+      playerSpawnPos(0, 0),
+      navGraph(),
+      _tmxMapInfo() {}
+
+GameMapSpec::~GameMapSpec() {
+  CC_SAFE_RELEASE(_tmxMapInfo);
+}
+
+
+TMXMapInfo* GameMapSpec::getTmxMapInfo() const {
+  return _tmxMapInfo;
+}
+
+
+string GameMapSpec::getCompiledFileName(const string& tmxMapFileName) {
+  // Example: Map/prison_cell_a.tmx -> <writable path>/map_cache/Map_prison_cell_a.tmx.bin
+  string fileName = tmxMapFileName;
+  std::replace(fileName.begin(), fileName.end(), '/', '_');
+  return FileUtils::getInstance()->getWritablePath() + COMPILED_MAP_DIR + fileName + ".bin";
+}
+
+uint64_t GameMapSpec::getSourceDigest(const string& tmxMapFileName) {
+  // The .tmx file is keyed by its content rather than its mtime, since stat()
+  // can't see into the APK on Android. The file is only a few KBs, so reading
+  // it once more (TMXMapInfo has already read it) is cheap.
+  const Data data = FileUtils::getInstance()->getDataFromFile(tmxMapFileName);
+  if (data.isNull()) {
+    return 0;
+  }
+
+  uLong crc = ::crc32(0L, Z_NULL, 0);
+  crc = ::crc32(crc, data.getBytes(), static_cast<uInt>(data.getSize()));
+  return (static_cast<uint64_t>(data.getSize()) << 32) | static_cast<uint32_t>(crc);
+}
+
+bool GameMapSpec::loadCompiled(const string& compiledFileName, uint64_t sourceDigest) {
+  MappedFile file(compiledFileName);
+  if (!file.isOpen()) {
+    return false;
+  }
+
+  BinaryReader reader(file.getData(), file.getData() + file.getSize());
+  if (reader.read<uint32_t>() != COMPILED_MAP_MAGIC ||
+      reader.read<uint32_t>() != COMPILED_MAP_VERSION ||
+      reader.read<uint64_t>() != sourceDigest) {
+    return false;  // stale or incompatible, will be regenerated.
+  }
+
+  for (auto& layer : staticLayers) {
+    layer.rectangles.resize(reader.readCount());
+    for (auto& rect : layer.rectangles) {
+      rect = readRectangle(reader);
+    }
+
+    layer.polylines.resize(reader.readCount());
+    for (auto& polyline : layer.polylines) {
+      polyline.vertices.resize(reader.readCount());
+      for (auto& vertex : polyline.vertices) {
+        vertex.x = reader.read<float>();
+        vertex.y = reader.read<float>();
+      }
+    }
+  }
+
+  triggers.resize(reader.readCount());
+  for (auto& trigger : triggers) {
+    trigger.rect = readRectangle(reader);
+    trigger.cmds.resize(reader.readCount());
+    for (auto& cmd : trigger.cmds) {
+      cmd = reader.readString();
+    }
+    trigger.canBeTriggeredOnlyOnce = reader.read<uint8_t>();
+    trigger.canBeTriggeredOnlyByPlayer = reader.read<uint8_t>();
+  }
+
+  portals.resize(reader.readCount());
+  for (auto& portal : portals) {
+    portal.rect = readRectangle(reader);
+    portal.targetTmxMapFileName = reader.readString();
+    portal.targetPortalId = reader.read<int32_t>();
+    portal.willInteractOnContact = reader.read<uint8_t>();
+    portal.isLocked = reader.read<uint8_t>();
+    portal.isSeamless = reader.read<uint8_t>();
+  }
+
+  npcs.resize(reader.readCount());
+  for (auto& npc : npcs) {
+    npc.x = reader.read<float>();
+    npc.y = reader.read<float>();
+    npc.json = reader.readString();
+  }
+
+  chests.resize(reader.readCount());
+  for (auto& chest : chests) {
+    chest.x = reader.read<float>();
+    chest.y = reader.read<float>();
+    chest.items = reader.readString();
+  }
+
+  lights.resize(reader.readCount());
+  for (auto& light : lights) {
+    light.x = reader.read<float>();
+    light.y = reader.read<float>();
+    light.radius = reader.read<float>();
+    light.color.r = reader.read<uint8_t>();
+    light.color.g = reader.read<uint8_t>();
+    light.color.b = reader.read<uint8_t>();
+  }
+
+  playerSpawnPos.x = reader.read<float>();
+  playerSpawnPos.y = reader.read<float>();
+
+  const size_t numNavNodes = reader.readCount();
+  for (size_t i = 0; i < numNavNodes && reader.isOk(); i++) {
+    NavGraph::Node node;
+    node.left.x = reader.read<float>();
+    node.left.y = reader.read<float>();
+    node.right.x = reader.read<float>();
+    node.right.y = reader.read<float>();
+    node.isPlatform = reader.read<uint8_t>();
+    navGraph.addNode(node);
+  }
+
+  const size_t numNavEdges = reader.readCount();
+  for (size_t i = 0; i < numNavEdges && reader.isOk(); i++) {
+    NavGraph::Edge edge;
+    edge.from = reader.read<int32_t>();
+    edge.to = reader.read<int32_t>();
+    edge.type = static_cast<NavGraph::EdgeType>(reader.read<uint8_t>());
+    edge.x = reader.read<float>();
+    edge.isTowardsRight = reader.read<uint8_t>();
+    edge.cost = reader.read<float>();
+    if (edge.from < 0 || edge.from >= static_cast<int32_t>(numNavNodes) ||
+        edge.to < 0 || edge.to >= static_cast<int32_t>(numNavNodes)) {
+      break;
+    }
+    navGraph.addEdge(edge);
+  }
+
+  if (!reader.isOk() || !reader.isEof() || navGraph.getEdges().size() != numNavEdges) {
+    VGLOG(LOG_WARN, "Corrupted compiled map: %s", compiledFileName.c_str());
+    for (auto& layer : staticLayers) {
+      layer.rectangles.clear();
+      layer.polylines.clear();
+    }
+    triggers.clear();
+    portals.clear();
+    npcs.clear();
+    chests.clear();
+    lights.clear();
+    navGraph.clear();
+    return false;
+  }
+
+  navGraph.buildIndex();
+  return true;
+}
+
+void GameMapSpec::saveCompiled(const string& compiledFileName, uint64_t sourceDigest) const {
+  BinaryWriter writer;
+  writer.write<uint32_t>(COMPILED_MAP_MAGIC);
+  writer.write<uint32_t>(COMPILED_MAP_VERSION);
+  writer.write<uint64_t>(sourceDigest);
+
+  for (const auto& layer : staticLayers) {
+    writer.write<uint32_t>(layer.rectangles.size());
+    for (const auto& rect : layer.rectangles) {
+      writeRectangle(writer, rect);
+    }
+
+    writer.write<uint32_t>(layer.polylines.size());
+    for (const auto& polyline : layer.polylines) {
+      writer.write<uint32_t>(polyline.vertices.size());
+      for (const auto& vertex : polyline.vertices) {
+        writer.write(vertex.x);
+        writer.write(vertex.y);
+      }
+    }
+  }
+
+  writer.write<uint32_t>(triggers.size());
+  for (const auto& trigger : triggers) {
+    writeRectangle(writer, trigger.rect);
+    writer.write<uint32_t>(trigger.cmds.size());
+    for (const auto& cmd : trigger.cmds) {
+      writer.writeString(cmd);
+    }
+    writer.write<uint8_t>(trigger.canBeTriggeredOnlyOnce);
+    writer.write<uint8_t>(trigger.canBeTriggeredOnlyByPlayer);
+  }
+
+  writer.write<uint32_t>(portals.size());
+  for (const auto& portal : portals) {
+    writeRectangle(writer, portal.rect);
+    writer.writeString(portal.targetTmxMapFileName);
+    writer.write<int32_t>(portal.targetPortalId);
+    writer.write<uint8_t>(portal.willInteractOnContact);
+    writer.write<uint8_t>(portal.isLocked);
+    writer.write<uint8_t>(portal.isSeamless);
+  }
+
+  writer.write<uint32_t>(npcs.size());
+  for (const auto& npc : npcs) {
+    writer.write(npc.x);
+    writer.write(npc.y);
+    writer.writeString(npc.json);
+  }
+
+  writer.write<uint32_t>(chests.size());
+  for (const auto& chest : chests) {
+    writer.write(chest.x);
+    writer.write(chest.y);
+    writer.writeString(chest.items);
+  }
+
+  writer.write<uint32_t>(lights.size());
+  for (const auto& light : lights) {
+    writer.write(light.x);
+    writer.write(light.y);
+    writer.write(light.radius);
+    writer.write<uint8_t>(light.color.r);
+    writer.write<uint8_t>(light.color.g);
+    writer.write<uint8_t>(light.color.b);
+  }
+
+  writer.write(playerSpawnPos.x);
+  writer.write(playerSpawnPos.y);
+
+  writer.write<uint32_t>(navGraph.getNodes().size());
+  for (const auto& node : navGraph.getNodes()) {
+    writer.write(node.left.x);
+    writer.write(node.left.y);
+    writer.write(node.right.x);
+    writer.write(node.right.y);
+    writer.write<uint8_t>(node.isPlatform);
+  }
+
+  writer.write<uint32_t>(navGraph.getEdges().size());
+  for (const auto& edge : navGraph.getEdges()) {
+    writer.write<int32_t>(edge.from);
+    writer.write<int32_t>(edge.to);
+    writer.write<uint8_t>(edge.type);
+    writer.write(edge.x);
+    writer.write<uint8_t>(edge.isTowardsRight);
+    writer.write(edge.cost);
+  }
+
+  // The map loader and the prefetcher may compile the same map concurrently,
+  // so write to a temporary file first and then atomically rename it.
+  FileUtils::getInstance()->createDirectory(FileUtils::getInstance()->getWritablePath() +
+                                            COMPILED_MAP_DIR);
+  const string tmpFileName = string_util::format("%s.%p.tmp", compiledFileName.c_str(), this);
+
+  ofstream fout(tmpFileName, std::ios::binary | std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_WARN, "Unable to write compiled map: %s", compiledFileName.c_str());
+    return;
+  }
+  fout.write(writer.getBuffer().data(), writer.getBuffer().size());
+  fout.close();
+
+  if (std::rename(tmpFileName.c_str(), compiledFileName.c_str()) != 0) {
+    std::remove(tmpFileName.c_str());
+  }
+}
+
+
+const ValueVector& GameMapSpec::getObjects(const string& objGroupName) const {
+  for (const auto objGroup : _tmxMapInfo->getObjectGroups()) {
+    if (objGroup->getGroupName() == objGroupName) {
+      return objGroup->getObjects();
+    }
+  }
+
+  VGLOG(LOG_WARN, "%s: object group [%s] not found",
+        tmxMapFileName.c_str(), objGroupName.c_str());
+  return kEmptyValueVector;
+}
+
+void GameMapSpec::parseCollisionLayer() {
+  for (auto layerInfo : _tmxMapInfo->getLayers()) {
+    if (layerInfo->_name != COLLISION_LAYER_NAME || !layerInfo->_tiles) {
+      continue;
+    }
+
+    const int numCols = static_cast<int>(layerInfo->_layerSize.width);
+    const int numRows = static_cast<int>(layerInfo->_layerSize.height);
+    const cocos2d::Size& tileSize = _tmxMapInfo->getTileSize();
+    tileCollisionGrid.reset(numCols, numRows, tileSize.width / kPpm, tileSize.height / kPpm);
+
+    auto& tileProperties = _tmxMapInfo->getTileProperties();
+    for (int y = 0; y < numRows; y++) {
+      for (int x = 0; x < numCols; x++) {
+        const uint32_t gid = layerInfo->_tiles[x + y * numCols] & cocos2d::kTMXFlippedMask;
+        if (!gid) {
+          continue;
+        }
+
+        auto it = tileProperties.find(static_cast<int>(gid));
+        const bool isOneWay = it != tileProperties.end() &&
+                              it->second.getType() == cocos2d::Value::Type::MAP &&
+                              it->second.asValueMap().count("oneWay") &&
+                              it->second.asValueMap().at("oneWay").asBool();
+        // The rows of a tile layer are counted from the top.
+        tileCollisionGrid.setTile(x, numRows - 1 - y, (isOneWay) ? TileCollisionGrid::Tile::PLATFORM :
+                                                                  TileCollisionGrid::Tile::SOLID);
+      }
+    }
+
+    // It's only collision data, so TMXTiledMap doesn't have to build a TMXLayer for it.
+    layerInfo->_visible = false;
+    VGLOG(LOG_INFO, "%s: tile collision grid %dx%d (%zu bytes)", tmxMapFileName.c_str(),
+          numCols, numRows, tileCollisionGrid.getMemoryUsage());
+    return;
+  }
+}
+
+void GameMapSpec::parseRectangles(GameMapSpec::StaticLayer& layer) const {
+  const ValueVector& objects = getObjects(layer.name);
+  layer.rectangles.reserve(objects.size());
+
+  for (const auto& rectObj : objects) {
+    const auto& valMap = rectObj.asValueMap();
+    layer.rectangles.push_back({
+      valMap.at("x").asFloat(),
+      valMap.at("y").asFloat(),
+      valMap.at("width").asFloat(),
+      valMap.at("height").asFloat()
+    });
+  }
+}
+
+void GameMapSpec::parsePolylines(GameMapSpec::StaticLayer& layer, float scaleFactor) const {
+  const ValueVector& objects = getObjects(layer.name);
+  layer.polylines.reserve(objects.size());
+
+  for (const auto& lineObj : objects) {
+    const auto& valMap = lineObj.asValueMap();
+    float xRef = valMap.at("x").asFloat();
+    float yRef = valMap.at("y").asFloat();
+
+    const auto& valVec = valMap.at("polylinePoints").asValueVector();
+    GameMapSpec::Polyline polyline;
+    polyline.vertices.reserve(valVec.size());
+
+    for (const auto& point : valVec) {
+      float x = point.asValueMap().at("x").asFloat() / scaleFactor;
+      float y = point.asValueMap().at("y").asFloat() / scaleFactor;
+      polyline.vertices.push_back({xRef + x, yRef - y});
+    }
+    layer.polylines.push_back(std::move(polyline));
+  }
+}
+
+void GameMapSpec::parseTriggers() {
+  for (const auto& rectObj : getObjects("Trigger")) {
+    const auto& valMap = rectObj.asValueMap();
+    triggers.push_back({
+      {
+        valMap.at("x").asFloat(),
+        valMap.at("y").asFloat(),
+        valMap.at("width").asFloat(),
+        valMap.at("height").asFloat()
+      },
+      string_util::split(valMap.at("cmds").asString(), ';'),
+      valMap.at("canBeTriggeredOnlyOnce").asBool(),
+      valMap.at("canBeTriggeredOnlyByPlayer").asBool()
+    });
+  }
+}
+
+void GameMapSpec::parsePortals() {
+  for (const auto& rectObj : getObjects("Portal")) {
+    const auto& valMap = rectObj.asValueMap();
+    auto it = valMap.find("isSeamless");
+    portals.push_back({
+      {
+        valMap.at("x").asFloat(),
+        valMap.at("y").asFloat(),
+        valMap.at("width").asFloat(),
+        valMap.at("height").asFloat()
+      },
+      valMap.at("targetMap").asString(),
+      valMap.at("targetPortalID").asInt(),
+      valMap.at("willInteractOnContact").asBool(),
+      valMap.at("isLocked").asBool(),
+      it != valMap.end() && it->second.asBool()
+    });
+  }
+}
+
+void GameMapSpec::parseNpcs() {
+  for (const auto& rectObj : getObjects("Npcs")) {
+    const auto& valMap = rectObj.asValueMap();
+    npcs.push_back({
+      valMap.at("x").asFloat(),
+      valMap.at("y").asFloat(),
+      valMap.at("json").asString()
+    });
+  }
+}
+
+void GameMapSpec::parseChests() {
+  for (const auto& rectObj : getObjects("Chest")) {
+    const auto& valMap = rectObj.asValueMap();
+    chests.push_back({
+      valMap.at("x").asFloat(),
+      valMap.at("y").asFloat(),
+      valMap.at("items").asString()
+    });
+  }
+}
+
+void GameMapSpec::parseLights() {
+  for (const auto& pointObj : getObjects("Light")) {
+    const auto& valMap = pointObj.asValueMap();
+    auto it = valMap.find("color");
+    lights.push_back({
+      valMap.at("x").asFloat(),
+      valMap.at("y").asFloat(),
+      valMap.at("radius").asFloat(),
+      (it != valMap.end()) ? parseColor(it->second.asString(), Color3B::WHITE) : Color3B::WHITE
+    });
+  }
+}
+
+void GameMapSpec::parsePlayerSpawnPos() {
+  const ValueVector& objects = getObjects("Player");
+  if (objects.empty()) {
+    return;
+  }
+
+  const auto& valMap = objects.at(0).asValueMap();
+  playerSpawnPos = {valMap.at("x").asFloat(), valMap.at("y").asFloat()};
+}
+
+void GameMapSpec::buildNavGraph() {
+  // Each walkable segment of the ground becomes a node.
+  for (const auto& polyline : staticLayers[StaticLayerType::GROUND].polylines) {
+    for (size_t i = 1; i < polyline.vertices.size(); i++) {
+      const b2Vec2& p1 = polyline.vertices[i - 1];
+      const b2Vec2& p2 = polyline.vertices[i];
+      if (std::abs(p2.y - p1.y) <= std::abs(p2.x - p1.x) * MAX_WALKABLE_SLOPE) {
+        navGraph.addSurface(p1, p2, /*isPlatform=*/false);
+      }
+    }
+  }
+
+  // So does the top edge of each platform.
+  for (const auto& rect : staticLayers[StaticLayerType::PLATFORM].rectangles) {
+    navGraph.addSurface({rect.x, rect.y + rect.height},
+                        {rect.x + rect.width, rect.y + rect.height}, /*isPlatform=*/true);
+  }
+
+  // And each run of solid tiles or platform tiles with an empty tile above it.
+  const TileCollisionGrid& grid = tileCollisionGrid;
+  const float tileWidth = grid.getTileWidth() * kPpm;
+  const float tileHeight = grid.getTileHeight() * kPpm;
+  for (int row = 0; row < grid.getNumRows(); row++) {
+    const float y = (row + 1) * tileHeight;
+    int firstCol = 0;
+    TileCollisionGrid::Tile runTile = TileCollisionGrid::Tile::EMPTY;
+    for (int col = 0; col <= grid.getNumCols(); col++) {
+      const TileCollisionGrid::Tile tile =
+          (grid.getTile(col, row + 1) == TileCollisionGrid::Tile::EMPTY) ? grid.getTile(col, row) :
+                                                                         TileCollisionGrid::Tile::EMPTY;
+      if (tile == runTile) {
+        continue;
+      }
+      if (runTile != TileCollisionGrid::Tile::EMPTY) {
+        navGraph.addSurface({firstCol * tileWidth, y}, {col * tileWidth, y},
+                            /*isPlatform=*/runTile == TileCollisionGrid::Tile::PLATFORM);
+      }
+      firstCol = col;
+      runTile = tile;
+    }
+  }
+
+  navGraph.buildEdges();
+}
+
+}  // namespace vigilante
@@ -0,0 +1,171 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_GAME_MAP_SPEC_H_
+#define VIGILANTE_GAME_MAP_SPEC_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include <cocos2d.h>
+#include <Box2D/Box2D.h>
+#include "map/NavGraph.h"
+#include "map/TileCollisionGrid.h"
+
+namespace vigilante {
+
+// A GameMapSpec is the plain-data form of a .tmx file. It holds everything
+// GameMap needs to populate the b2World (vertices, fixture params, portal/
+// trigger/npc/chest placement), but it does not own any b2Body or Node.
+//
+// GameMapSpec::create() only touches the filesystem and the cpu, so it is safe
+// to call it from a worker thread. The resulting spec is then handed over to
+// the main thread, which commits the b2Bodies and builds the TMXTiledMap from
+// the already-parsed TMXMapInfo (see GameMap::GameMap()).
+//
+// Note that TMXLayer takes over the tiles owned by TMXMapInfo, so a GameMapSpec
+// can only be used to build one GameMap.
+class GameMapSpec final {
+ public:
+  struct Rectangle final {
+    float x;
+    float y;
+    float width;
+    float height;
+  };
+
+  struct Polyline final {
+    std::vector<b2Vec2> vertices;  // in pixels, already offset by the object's origin
+  };
+
+  // A one-way layer (e.g., "Platform") is only solid for the feet which
+  // touch it from the side `normal` points to, i.e., whose body is more than
+  // `tolerance` meters beyond the layer's body along `normal` when the
+  // contact begins. See WorldContactListener::BeginContact().
+  struct OneWay final {
+    bool isEnabled;
+    b2Vec2 normal;
+    float tolerance;
+  };
+
+  // A static body layer, e.g., "Ground", "Wall", "Platform"...
+  struct StaticLayer final {
+    std::string name;
+    short categoryBits;
+    bool collidable;
+    float friction;
+    GameMapSpec::OneWay oneWay;  // the fixtures' user data if enabled
+
+    std::vector<GameMapSpec::Rectangle> rectangles;
+    std::vector<GameMapSpec::Polyline> polylines;
+  };
+
+  struct TriggerSpec final {
+    GameMapSpec::Rectangle rect;
+    std::vector<std::string> cmds;
+    bool canBeTriggeredOnlyOnce;
+    bool canBeTriggeredOnlyByPlayer;
+  };
+
+  struct PortalSpec final {
+    GameMapSpec::Rectangle rect;
+    std::string targetTmxMapFileName;
+    int targetPortalId;
+    bool willInteractOnContact;
+    bool isLocked;
+    bool isSeamless;  // optional, see GameMapManager::loadGameMapSeamlessly()
+  };
+
+  struct NpcSpec final {
+    float x;
+    float y;
+    std::string json;
+  };
+
+  struct ChestSpec final {
+    float x;
+    float y;
+    std::string items;
+  };
+
+  // A point light from the "Light" object group, see LightMap.
+  struct LightSpec final {
+    float x;
+    float y;
+    float radius;  // in pixels
+    cocos2d::Color3B color;
+  };
+
+  enum StaticLayerType {
+    GROUND,
+    WALL,
+    PLATFORM,
+    PIVOT_MARKER,
+    CLIFF_MARKER,
+    SIZE
+  };
+
+  // Parses the specified .tmx file. Safe to call from any thread.
+  // Returns nullptr if the .tmx file cannot be parsed.
+  static std::unique_ptr<GameMapSpec> create(const std::string& tmxMapFileName);
+
+  ~GameMapSpec();
+
+  // The parsed TMXMapInfo. GameMapSpec holds one reference to it,
+  // and it must be released on the main thread (i.e., ~GameMapSpec()
+  // must run on the main thread).
+  cocos2d::TMXMapInfo* getTmxMapInfo() const;
+
+  std::string tmxMapFileName;
+  bool isStreamed;  // the "isStreamed" map property, see GameMap::updateChunks()
+  std::string bgm;  // the "bgm" map property (optional), see AudioManager
+  std::vector<std::string> sfx;  // the "sfx" map property, a comma-separated list to be preloaded
+  std::vector<std::string> textures;  // the "textures" map property, see TextureResidency
+  // The "ambientLight" map property ("r,g,b"). The map is only lit
+  // by its lights if this is given, i.e., not white (see LightMap).
+  cocos2d::Color3B ambientLight;
+  std::array<GameMapSpec::StaticLayer, StaticLayerType::SIZE> staticLayers;
+  // Built from the "Collision" tile layer, if any. If it isn't empty, then the
+  // "Ground", "Wall" and "Platform" layers aren't committed to the b2World.
+  TileCollisionGrid tileCollisionGrid;
+  std::vector<GameMapSpec::TriggerSpec> triggers;
+  std::vector<GameMapSpec::PortalSpec> portals;
+  std::vector<GameMapSpec::NpcSpec> npcs;
+  std::vector<GameMapSpec::ChestSpec> chests;
+  std::vector<GameMapSpec::LightSpec> lights;
+  b2Vec2 playerSpawnPos;
+  NavGraph navGraph;  // built from the "Ground" and "Platform" layers (or `tileCollisionGrid`)
+
+ private:
+  explicit GameMapSpec(const std::string& tmxMapFileName);
+
+  // Compiled map cache. The object groups of each .tmx file are stored as
+  // a flat binary blob under <writable path>/map_cache/, keyed by the .tmx
+  // file's path, size and crc32, so that subsequent loads can skip walking
+  // the ValueMap/ValueVector trees of TMXMapInfo.
+  static std::string getCompiledFileName(const std::string& tmxMapFileName);
+  static uint64_t getSourceDigest(const std::string& tmxMapFileName);  // 0 if unreadable
+  bool loadCompiled(const std::string& compiledFileName, uint64_t sourceDigest);
+  void saveCompiled(const std::string& compiledFileName, uint64_t sourceDigest) const;
+
+  const cocos2d::ValueVector& getObjects(const std::string& objGroupName) const;
+  // Any tile of the layer is solid, unless its tile has the "oneWay" property set,
+  // in which case it's a platform. The layer itself isn't rendered.
+  void parseCollisionLayer();
+  void parseRectangles(GameMapSpec::StaticLayer& layer) const;
+  void parsePolylines(GameMapSpec::StaticLayer& layer, float scaleFactor) const;
+  void parseTriggers();
+  void parsePortals();
+  void parseNpcs();
+  void parseChests();
+  void parseLights();
+  void parsePlayerSpawnPos();
+  void buildNavGraph();
+
+  cocos2d::TMXMapInfo* _tmxMapInfo;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_GAME_MAP_SPEC_H_
@@ -0,0 +1,264 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "LightMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Constants.h"
+#include "util/Logger.h"
+
+#define LIGHT_MAP_DOWNSCALE 4  // the light map is 1/4 of the view in each dimension
+#define LIGHT_MAP_MAX_LIGHTS 64  // per frame
+#define LIGHT_FALLOFF_TEXTURE_SIZE 64
+
+using std::vector;
+using cocos2d::Color3B;
+using cocos2d::Color4B;
+using cocos2d::Director;
+using cocos2d::GLProgram;
+using cocos2d::GLProgramState;
+using cocos2d::Mat4;
+using cocos2d::Node;
+using cocos2d::QuadCommand;
+using cocos2d::Rect;
+using cocos2d::RenderTexture;
+using cocos2d::Renderer;
+using cocos2d::Size;
+using cocos2d::Texture2D;
+using cocos2d::V3F_C4B_T2F_Quad;
+
+namespace vigilante {
+
+// The quads of the lights of the current frame, which are
+// drawn into the light map with a single QuadCommand.
+class LightMap::LightBatch : public Node {
+ public:
+  static LightMap::LightBatch* create(Texture2D* texture) {
+    LightBatch* batch = new (std::nothrow) LightBatch(texture);
+    if (batch && batch->init()) {
+      batch->autorelease();
+      return batch;
+    }
+    CC_SAFE_DELETE(batch);
+    return nullptr;
+  }
+
+  virtual bool init() override {
+    if (!Node::init()) {
+      return false;
+    }
+    setGLProgramState(GLProgramState::getOrCreateWithGLProgramName(
+        GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP, _texture));
+    return true;
+  }
+
+  // Returns false if the batch is full.
+  bool add(float x, float y, float halfWidth, float halfHeight, const Color3B& color) {
+    if (_size >= LIGHT_MAP_MAX_LIGHTS) {
+      return false;
+    }
+
+    V3F_C4B_T2F_Quad& quad = _quads[_size++];
+    quad.bl.vertices.set(x - halfWidth, y - halfHeight, 0);
+    quad.br.vertices.set(x + halfWidth, y - halfHeight, 0);
+    quad.tl.vertices.set(x - halfWidth, y + halfHeight, 0);
+    quad.tr.vertices.set(x + halfWidth, y + halfHeight, 0);
+    quad.bl.colors = quad.br.colors = quad.tl.colors = quad.tr.colors = Color4B(color);
+    return true;
+  }
+
+  void clear() {
+    _size = 0;
+  }
+
+  virtual void draw(Renderer* renderer, const Mat4& transform, uint32_t flags) override {
+    if (_size == 0) {
+      return;
+    }
+    // Overlapping lights add up.
+    _quadCommand.init(_globalZOrder, _texture, getGLProgramState(), {GL_ONE, GL_ONE},
+                      _quads.data(), _size, transform, flags);
+    renderer->addCommand(&_quadCommand);
+  }
+
+ private:
+  explicit LightBatch(Texture2D* texture)
+      : _texture(texture),
+        _size(),
+        _quads(LIGHT_MAP_MAX_LIGHTS),
+        _quadCommand() {
+    _texture->retain();
+
+    for (auto& quad : _quads) {
+      quad.bl.texCoords = {0, 1};
+      quad.br.texCoords = {1, 1};
+      quad.tl.texCoords = {0, 0};
+      quad.tr.texCoords = {1, 0};
+    }
+  }
+
+  virtual ~LightBatch() {
+    _texture->release();
+  }
+
+  Texture2D* _texture;  // retained
+  size_t _size;
+  vector<V3F_C4B_T2F_Quad> _quads;
+  QuadCommand _quadCommand;
+};
+
+
+LightMap::Light::Light() : radius(), color(Color3B::WHITE) {}
+
+LightMap::Light::Light(float radius, const Color3B& color) : radius(radius), color(color) {}
+
+LightMap::Light::Light(const rapidjson::Value& json) : Light() {
+  radius = json["radius"].GetFloat();
+  if (json.HasMember("color") && json["color"].IsArray() && json["color"].Size() == 3) {
+    color = Color3B(static_cast<GLubyte>(json["color"][0].GetInt()),
+                    static_cast<GLubyte>(json["color"][1].GetInt()),
+                    static_cast<GLubyte>(json["color"][2].GetInt()));
+  }
+}
+
+
+LightMap::LightMap(RenderBuckets* renderBuckets)
+    : _renderBuckets(renderBuckets),
+      _ambientColor(Color3B::WHITE),
+      _staticLights(),
+      _dynamicLights(),
+      _renderTexture(),
+      _lightBatch() {}
+
+LightMap::~LightMap() {
+  CC_SAFE_RELEASE(_renderTexture);
+  CC_SAFE_RELEASE(_lightBatch);
+}
+
+
+void LightMap::reset(const GameMapSpec& spec) {
+  _ambientColor = spec.ambientLight;
+  _staticLights.clear();
+  _dynamicLights.clear();
+
+  if (!isEnabled()) {
+    if (_renderTexture) {
+      _renderTexture->setVisible(false);
+    }
+    return;
+  }
+
+  for (const auto& light : spec.lights) {
+    _staticLights.push_back({light.x, light.y, {light.radius, light.color}});
+  }
+
+  if (!_renderTexture) {
+    Texture2D* falloffTexture = LightMap::createFalloffTexture();
+    if (!falloffTexture) {
+      VGLOG(LOG_ERR, "Failed to create the light falloff texture.");
+      _ambientColor = Color3B::WHITE;
+      return;
+    }
+    _lightBatch = LightBatch::create(falloffTexture);
+    _lightBatch->retain();
+    falloffTexture->release();
+
+    const Size& winSize = Director::getInstance()->getWinSize();
+    _renderTexture = RenderTexture::create(winSize.width / LIGHT_MAP_DOWNSCALE,
+                                           winSize.height / LIGHT_MAP_DOWNSCALE,
+                                           Texture2D::PixelFormat::RGBA8888);
+    _renderTexture->retain();
+    // Unlike the tiles, the light map has to be filtered when it's
+    // stretched over the view, otherwise its texels would show.
+    _renderTexture->getSprite()->getTexture()->setAntiAliasTexParameters();
+    _renderTexture->getSprite()->setBlendFunc({GL_DST_COLOR, GL_ZERO});  // multiply
+    _renderBuckets->get(graphical_layers::kLightMap)->addChild(_renderTexture);
+  }
+  _renderTexture->setVisible(true);
+}
+
+bool LightMap::isEnabled() const {
+  return _ambientColor != Color3B::WHITE;
+}
+
+void LightMap::submit(const LightMap::Light& light, float x, float y) {
+  if (isEnabled() && light.radius > 0) {
+    _dynamicLights.push_back({x, y, light});
+  }
+}
+
+void LightMap::update(const Rect& viewRect) {
+  if (!isEnabled() || !_renderTexture) {
+    _dynamicLights.clear();
+    return;
+  }
+
+  // The render target maps the window to the whole light map,
+  // so the lights are placed relative to the view, scaled to the window.
+  const Size& winSize = Director::getInstance()->getWinSize();
+  const float scaleX = winSize.width / viewRect.size.width;
+  const float scaleY = winSize.height / viewRect.size.height;
+
+  // The dynamic lights (e.g., the player's lantern) go first,
+  // in case there are more than LIGHT_MAP_MAX_LIGHTS lights in view.
+  _lightBatch->clear();
+  bool isFull = false;
+  for (const auto* lights : {&_dynamicLights, &_staticLights}) {
+    for (size_t i = 0; i < lights->size() && !isFull; i++) {
+      const PlacedLight& placedLight = (*lights)[i];
+      if (!viewRect.intersectsCircle({placedLight.x, placedLight.y}, placedLight.light.radius)) {
+        continue;
+      }
+      isFull = !_lightBatch->add((placedLight.x - viewRect.origin.x) * scaleX,
+                                 (placedLight.y - viewRect.origin.y) * scaleY,
+                                 placedLight.light.radius * scaleX,
+                                 placedLight.light.radius * scaleY,
+                                 placedLight.light.color);
+    }
+  }
+  _dynamicLights.clear();
+
+  // Like TileChunkRenderer, this only queues the draw commands,
+  // which are executed before the scene when the frame is rendered.
+  _renderTexture->beginWithClear(_ambientColor.r / 255.0f, _ambientColor.g / 255.0f,
+                                 _ambientColor.b / 255.0f, 1.0f);
+  _lightBatch->visit(Director::getInstance()->getRenderer(), Mat4::IDENTITY,
+                     Node::FLAGS_TRANSFORM_DIRTY);
+  _renderTexture->end();
+
+  const Size& lightMapSize = _renderTexture->getSprite()->getContentSize();
+  _renderTexture->setPosition(viewRect.getMidX(), viewRect.getMidY());
+  _renderTexture->setScale(viewRect.size.width / lightMapSize.width,
+                           viewRect.size.height / lightMapSize.height);
+}
+
+
+Texture2D* LightMap::createFalloffTexture() {
+  // A quadratic falloff. The color is premultiplied by the intensity,
+  // since the lights are blended additively.
+  const int size = LIGHT_FALLOFF_TEXTURE_SIZE;
+  const float halfSize = size / 2.0f;
+  vector<unsigned char> pixels(size * size * 4);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const float dx = (x + .5f - halfSize) / halfSize;
+      const float dy = (y + .5f - halfSize) / halfSize;
+      const float t = std::max(0.0f, 1.0f - std::sqrt(dx * dx + dy * dy));
+      const unsigned char intensity = static_cast<unsigned char>(t * t * 255.0f);
+      unsigned char* pixel = &pixels[(x + y * size) * 4];
+      pixel[0] = pixel[1] = pixel[2] = pixel[3] = intensity;
+    }
+  }
+
+  Texture2D* texture = new (std::nothrow) Texture2D();
+  if (!texture || !texture->initWithData(pixels.data(), pixels.size(),
+                                         Texture2D::PixelFormat::RGBA8888,
+                                         size, size, Size(size, size))) {
+    CC_SAFE_DELETE(texture);
+    return nullptr;
+  }
+  texture->setAntiAliasTexParameters();
+  return texture;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,89 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_LIGHT_MAP_H_
+#define VIGILANTE_LIGHT_MAP_H_
+
+#include <vector>
+
+#include <cocos2d.h>
+#include <json/document.h>
+#include "map/GameMapSpec.h"
+#include "map/RenderBuckets.h"
+
+namespace vigilante {
+
+// Point lights for dark maps (i.e., those with the "ambientLight" property).
+//
+// Every frame, the lights within the view are accumulated (additively) into
+// a low-resolution render target which is cleared to the ambient color, and
+// then it's stretched over the view and multiplied with everything drawn
+// below graphical_layers::kLightMap in one full-screen pass. The render
+// target is 1/LIGHT_MAP_DOWNSCALE of the view in each dimension and takes at
+// most LIGHT_MAP_MAX_LIGHTS lights per frame, so the cost per frame is small
+// and fixed no matter how many lights a map has. On the other maps,
+// nothing is drawn at all.
+//
+// There are two kinds of lights:
+// 1. the static ones placed in the "Light" object group of the .tmx file
+//    (point objects with the "radius" and optionally "color" properties).
+// 2. the dynamic ones which must be submitted again every frame (e.g., the
+//    player's lantern, a flying spell with a "light" in its json):
+//
+//   "light": {
+//     "radius": 48,           // pixels
+//     "color": [120, 200, 255]
+//   }
+//
+// All methods must be called on the main thread.
+class LightMap final {
+ public:
+  struct Light final {
+    Light();
+    Light(float radius, const cocos2d::Color3B& color);
+    explicit Light(const rapidjson::Value& json);
+
+    float radius;  // in pixels, 0 if there's no light
+    cocos2d::Color3B color;
+  };
+
+  explicit LightMap(RenderBuckets* renderBuckets);
+  ~LightMap();
+
+  // Takes the ambient color and the static lights of the new GameMap.
+  void reset(const GameMapSpec& spec);
+
+  // Whether the current GameMap is lit by its lights.
+  bool isEnabled() const;
+
+  // Adds a light at (x, y) (in pixels) for the current frame only.
+  void submit(const LightMap::Light& light, float x, float y);
+
+  // Renders the lights within `viewRect` (in pixels) into the light map
+  // and moves it over the view. Called once per frame after the camera
+  // has been updated.
+  void update(const cocos2d::Rect& viewRect);
+
+ private:
+  struct PlacedLight final {
+    float x;
+    float y;
+    LightMap::Light light;
+  };
+
+  class LightBatch;
+
+  // A white radial gradient, from which all lights are drawn.
+  static cocos2d::Texture2D* createFalloffTexture();
+
+  RenderBuckets* _renderBuckets;
+  cocos2d::Color3B _ambientColor;
+  std::vector<LightMap::PlacedLight> _staticLights;
+  std::vector<LightMap::PlacedLight> _dynamicLights;  // of the current frame
+
+  // Created on the first dark GameMap.
+  cocos2d::RenderTexture* _renderTexture;  // retained
+  LightMap::LightBatch* _lightBatch;  // retained
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_LIGHT_MAP_H_
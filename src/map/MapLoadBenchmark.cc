@@ -0,0 +1,195 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "MapLoadBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include <cocos2d.h>
+#include "Constants.h"
+#include "character/Player.h"
+#include "map/GameMapManager.h"
+#include "map/GameMapSpec.h"
+#include "map/WorldEpoch.h"
+#include "util/LoadProfiler.h"
+#include "util/Logger.h"
+
+#define MAP_ASSETS_DIR "Map/"
+#define TMX_EXTENSION ".tmx"
+
+using std::ofstream;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+using cocos2d::Director;
+using cocos2d::FileUtils;
+
+namespace vigilante {
+
+namespace {
+
+float getElapsedTime(const steady_clock::time_point& beginTime) {
+  return std::chrono::duration<float, std::milli>(steady_clock::now() - beginTime).count();
+}
+
+}  // namespace
+
+MapLoadBenchmark* MapLoadBenchmark::getInstance() {
+  static MapLoadBenchmark instance;
+  return &instance;
+}
+
+
+bool MapLoadBenchmark::run(const string& resultFileName) {
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  Player* player = gmMgr->getPlayer();
+  if (!gmMgr->getGameMap() || !player || !player->getBody()) {
+    return false;
+  }
+
+  const string originalTmxMapFileName = gmMgr->getGameMap()->getTmxTiledMapFileName();
+  const b2Vec2 originalPlayerPos = player->getBody()->GetPosition();
+  const vector<string> tmxMapFileNames = getTmxMapFileNames();
+  VGLOG(LOG_INFO, "Map load benchmark started: %d maps", static_cast<int>(tmxMapFileNames.size()));
+
+  // Like GameMapManager::loadGameMap(), the npcs mustn't act
+  // and their callbacks are dropped while the maps are swapped.
+  world_epoch::beginTransition();
+
+  _results.clear();
+  for (const auto& tmxMapFileName : tmxMapFileNames) {
+    Result result{tmxMapFileName};
+
+    // Unload the previous map first, so that its teardown
+    // isn't counted in the load time of this one.
+    gmMgr->unloadGameMap();
+
+    steady_clock::time_point beginTime = steady_clock::now();
+    shared_ptr<GameMapSpec> spec = GameMapSpec::create(tmxMapFileName);
+    result.parseTime = getElapsedTime(beginTime);
+    if (!spec) {
+      VGLOG(LOG_ERR, "Map load benchmark: unable to parse %s", tmxMapFileName.c_str());
+      continue;
+    }
+
+    LoadProfiler* loadProfiler = LoadProfiler::getInstance();
+    const double createObjectsBeginTime = loadProfiler->getTotalTime(LoadProfiler::Section::MAP_OBJECTS);
+    const long textureMemoryBefore = getTextureMemory();
+    beginTime = steady_clock::now();
+    GameMap* gameMap = gmMgr->doLoadGameMap(std::move(spec));
+    result.loadTime = getElapsedTime(beginTime);
+    result.createObjectsTime = static_cast<float>(
+        loadProfiler->getTotalTime(LoadProfiler::Section::MAP_OBJECTS) - createObjectsBeginTime);
+    result.textureMemoryDelta = getTextureMemory() - textureMemoryBefore;
+    if (!gameMap) {
+      continue;
+    }
+
+    result.numBodies = gmMgr->getWorld()->GetBodyCount();
+    const b2BroadPhase& broadPhase = gmMgr->getWorld()->GetContactManager().m_broadPhase;
+    result.treeHeight = broadPhase.GetTreeHeight();
+    result.treeQuality = broadPhase.GetTreeQuality();
+    result.numNpcs = static_cast<int>(gameMap->getSpec()->npcs.size());
+    result.numChests = static_cast<int>(gameMap->getSpec()->chests.size());
+
+    beginTime = steady_clock::now();
+    gmMgr->unloadGameMap();
+    result.teardownTime = getElapsedTime(beginTime);
+
+    _results.push_back(result);
+  }
+
+  // Bring the player back to where the benchmark was started.
+  gmMgr->doLoadGameMap(GameMapSpec::create(originalTmxMapFileName));
+  player->setPosition(originalPlayerPos.x, originalPlayerPos.y);
+  world_epoch::endTransition();
+  if (GameMap* gameMap = gmMgr->getGameMap()) {
+    gameMap->spawnQueuedActors({originalPlayerPos.x * kPpm, originalPlayerPos.y * kPpm});
+  }
+
+  writeResults(resultFileName);
+  return true;
+}
+
+
+long MapLoadBenchmark::getTextureMemory() {
+  // TextureCache doesn't expose its textures, so parse the summary
+  // line of its debug info, like PerformanceHud does.
+  const string info = Director::getInstance()->getTextureCache()->getCachedTextureInfo();
+  const char* summary = std::strstr(info.c_str(), "dumpDebugInfo:");
+  long numTextures = 0;
+  unsigned long textureMemory = 0;
+  if (!summary ||
+      std::sscanf(summary, "dumpDebugInfo: %ld textures, for %lu KB", &numTextures, &textureMemory) != 2) {
+    return 0;
+  }
+  return static_cast<long>(textureMemory);
+}
+
+vector<string> MapLoadBenchmark::getTmxMapFileNames() {
+  vector<string> tmxMapFileNames;
+
+  const string fullPath = FileUtils::getInstance()->fullPathForFilename(MAP_ASSETS_DIR);
+  if (fullPath.empty()) {
+    return tmxMapFileNames;
+  }
+
+  vector<string> files;
+  FileUtils::getInstance()->listFilesRecursively(fullPath, &files);
+  for (const auto& file : files) {
+    // Strip the search path, e.g., "/.../Resources/Map/a/b.tmx" -> "Map/a/b.tmx".
+    const size_t pos = file.rfind(MAP_ASSETS_DIR);
+    if (pos != string::npos && FileUtils::getInstance()->getFileExtension(file) == TMX_EXTENSION) {
+      tmxMapFileNames.push_back(file.substr(pos));
+    }
+  }
+  std::sort(tmxMapFileNames.begin(), tmxMapFileNames.end());
+  return tmxMapFileNames;
+}
+
+bool MapLoadBenchmark::writeResults(const string& fileName) const {
+  VGLOG(LOG_INFO, "%-48s %9s %9s %9s %9s %7s %7s %7s %5s %7s %10s",
+        "map", "parse ms", "load ms", "objs ms", "tear ms", "bodies", "tree h", "tree q",
+        "npcs", "chests", "tex KB");
+  for (const auto& result : _results) {
+    VGLOG(LOG_INFO, "%-48s %9.2f %9.2f %9.2f %9.2f %7d %7d %7.2f %5d %7d %10ld",
+          result.tmxMapFileName.c_str(), result.parseTime, result.loadTime,
+          result.createObjectsTime, result.teardownTime, result.numBodies,
+          result.treeHeight, result.treeQuality,
+          result.numNpcs, result.numChests, result.textureMemoryDelta);
+  }
+
+  ofstream fout(fileName, std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_ERR, "Unable to write map load benchmark results to: %s", fileName.c_str());
+    return false;
+  }
+
+  fout << "{\n";
+  fout << "  \"maps\": [";
+
+  for (size_t i = 0; i < _results.size(); i++) {
+    const Result& result = _results[i];
+    fout << ((i == 0) ? "\n" : ",\n");
+    fout << "    {\"map\": \"" << result.tmxMapFileName << "\", "
+         << "\"parseMs\": " << result.parseTime << ", "
+         << "\"loadMs\": " << result.loadTime << ", "
+         << "\"createObjectsMs\": " << result.createObjectsTime << ", "
+         << "\"teardownMs\": " << result.teardownTime << ", "
+         << "\"bodies\": " << result.numBodies << ", "
+         << "\"treeHeight\": " << result.treeHeight << ", "
+         << "\"treeQuality\": " << result.treeQuality << ", "
+         << "\"npcs\": " << result.numNpcs << ", "
+         << "\"chests\": " << result.numChests << ", "
+         << "\"textureMemoryDeltaKb\": " << result.textureMemoryDelta << "}";
+  }
+
+  fout << "\n  ]\n}\n";
+  return true;
+}
+
+}  // namespace vigilante
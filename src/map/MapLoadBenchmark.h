@@ -0,0 +1,58 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_MAP_LOAD_BENCHMARK_H_
+#define VIGILANTE_MAP_LOAD_BENCHMARK_H_
+
+#include <string>
+#include <vector>
+
+namespace vigilante {
+
+// Loads every .tmx file under Map/ one after another, and reports
+// which maps are heavy, e.g.,
+//
+//   ./Vigilante --headless --exec "mapBenchmark"
+//
+// For each map, the GameMapSpec is parsed on the main thread (from the
+// compiled map cache if it's up to date, see GameMapSpec), and the map
+// is built with GameMapManager::doLoadGameMap() and torn down right after,
+// each of them timed separately. The time spent in GameMap::createObjects()
+// is taken from LoadProfiler, and the texture memory delta from TextureCache.
+// The height and quality of the broadphase tree are those right after loading.
+// The results are logged as a table and written as json to `resultFileName`,
+// and then the map which the player was on is loaded again.
+//
+// All methods must be called on the main thread.
+class MapLoadBenchmark final {
+ public:
+  struct Result final {
+    std::string tmxMapFileName;
+    float parseTime;  // in milliseconds
+    float loadTime;  // in milliseconds, including createObjects()
+    float createObjectsTime;  // in milliseconds
+    float teardownTime;  // in milliseconds
+    int numBodies;
+    int treeHeight;  // of the broadphase's dynamic AABB tree
+    float treeQuality;  // the total area of the tree's nodes / the root's area
+    int numNpcs;
+    int numChests;
+    long textureMemoryDelta;  // in KB
+  };
+
+  static MapLoadBenchmark* getInstance();
+
+  // Returns false if there's no game in progress.
+  bool run(const std::string& resultFileName);
+
+ private:
+  MapLoadBenchmark() = default;
+
+  static long getTextureMemory();  // in KB
+  static std::vector<std::string> getTmxMapFileNames();
+  bool writeResults(const std::string& fileName) const;
+
+  std::vector<MapLoadBenchmark::Result> _results;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_MAP_LOAD_BENCHMARK_H_
@@ -0,0 +1,234 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "NavGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#define NAV_CONNECT_EPSILON 2.0f
+#define NAV_MAX_JUMP_HEIGHT 48.0f
+#define NAV_MAX_JUMP_DISTANCE 48.0f
+#define NAV_FIND_NODE_TOLERANCE 4.0f
+#define NAV_JUMP_COST 32.0f
+#define NAV_DROP_COST 16.0f
+
+using std::vector;
+using std::pair;
+
+namespace vigilante {
+
+NavGraph::NavGraph() : _nodes(), _edges(), _edgeStarts(1, 0) {}
+
+
+void NavGraph::addSurface(const b2Vec2& p1, const b2Vec2& p2, bool isPlatform) {
+  if (p1.x <= p2.x) {
+    _nodes.push_back({p1, p2, isPlatform});
+  } else {
+    _nodes.push_back({p2, p1, isPlatform});
+  }
+}
+
+void NavGraph::buildEdges() {
+  _edges.clear();
+  for (int i = 0; i < static_cast<int>(_nodes.size()); i++) {
+    for (int j = 0; j < static_cast<int>(_nodes.size()); j++) {
+      if (i != j) {
+        tryConnect(i, j);
+      }
+    }
+  }
+  buildIndex();
+}
+
+
+void NavGraph::addNode(const NavGraph::Node& node) {
+  _nodes.push_back(node);
+}
+
+void NavGraph::addEdge(const NavGraph::Edge& edge) {
+  _edges.push_back(edge);
+}
+
+void NavGraph::buildIndex() {
+  std::stable_sort(_edges.begin(), _edges.end(), [](const Edge& e1, const Edge& e2) {
+    return e1.from < e2.from;
+  });
+
+  _edgeStarts.assign(_nodes.size() + 1, 0);
+  for (const auto& edge : _edges) {
+    _edgeStarts[edge.from + 1]++;
+  }
+  for (size_t i = 1; i < _edgeStarts.size(); i++) {
+    _edgeStarts[i] += _edgeStarts[i - 1];
+  }
+}
+
+void NavGraph::clear() {
+  _nodes.clear();
+  _edges.clear();
+  _edgeStarts.assign(1, 0);
+}
+
+
+int NavGraph::findNode(const b2Vec2& pos) const {
+  int result = -1;
+  float resultY = -std::numeric_limits<float>::max();
+
+  // Find the highest surface which is below `pos`.
+  for (int i = 0; i < static_cast<int>(_nodes.size()); i++) {
+    const Node& node = _nodes[i];
+    if (pos.x < node.left.x - NAV_FIND_NODE_TOLERANCE ||
+        pos.x > node.right.x + NAV_FIND_NODE_TOLERANCE) {
+      continue;
+    }
+    const float y = NavGraph::getSurfaceY(node, pos.x);
+    if (y <= pos.y + NAV_FIND_NODE_TOLERANCE && y > resultY) {
+      result = i;
+      resultY = y;
+    }
+  }
+  return result;
+}
+
+bool NavGraph::findPath(int start, int goal, vector<int>& path) const {
+  path.clear();
+
+  const int numNodes = static_cast<int>(_nodes.size());
+  if (start < 0 || start >= numNodes || goal < 0 || goal >= numNodes) {
+    return false;
+  } else if (start == goal) {
+    return true;
+  }
+
+  const b2Vec2 goalCenter = NavGraph::getCenter(_nodes[goal]);
+  auto heuristic = [this, &goalCenter](int node) {
+    return (NavGraph::getCenter(_nodes[node]) - goalCenter).Length();
+  };
+
+  vector<float> costs(numNodes, std::numeric_limits<float>::max());
+  vector<int> cameFrom(numNodes, -1);  // index of the edge taken to reach each node
+  vector<bool> isClosed(numNodes, false);
+
+  // (estimated total cost, node)
+  using OpenEntry = pair<float, int>;
+  std::priority_queue<OpenEntry, vector<OpenEntry>, std::greater<OpenEntry>> openSet;
+  costs[start] = 0;
+  openSet.push({heuristic(start), start});
+
+  while (!openSet.empty()) {
+    const int node = openSet.top().second;
+    openSet.pop();
+
+    if (node == goal) {
+      for (int edge = cameFrom[goal]; edge != -1; edge = cameFrom[_edges[edge].from]) {
+        path.push_back(edge);
+      }
+      std::reverse(path.begin(), path.end());
+      return true;
+    } else if (isClosed[node]) {
+      continue;
+    }
+    isClosed[node] = true;
+
+    for (int i = _edgeStarts[node]; i < _edgeStarts[node + 1]; i++) {
+      const Edge& edge = _edges[i];
+      const float cost = costs[node] + edge.cost;
+      if (!isClosed[edge.to] && cost < costs[edge.to]) {
+        costs[edge.to] = cost;
+        cameFrom[edge.to] = i;
+        openSet.push({cost + heuristic(edge.to), edge.to});
+      }
+    }
+  }
+  return false;
+}
+
+
+const vector<NavGraph::Node>& NavGraph::getNodes() const {
+  return _nodes;
+}
+
+const vector<NavGraph::Edge>& NavGraph::getEdges() const {
+  return _edges;
+}
+
+bool NavGraph::empty() const {
+  return _nodes.empty();
+}
+
+
+float NavGraph::getSurfaceY(const NavGraph::Node& node, float x) {
+  const float width = node.right.x - node.left.x;
+  if (width <= 0) {
+    return std::max(node.left.y, node.right.y);
+  }
+  const float t = std::min(std::max((x - node.left.x) / width, 0.0f), 1.0f);
+  return node.left.y + (node.right.y - node.left.y) * t;
+}
+
+b2Vec2 NavGraph::getCenter(const NavGraph::Node& node) {
+  return {(node.left.x + node.right.x) / 2, (node.left.y + node.right.y) / 2};
+}
+
+void NavGraph::tryConnect(int from, int to) {
+  const Node& a = _nodes[from];
+  const Node& b = _nodes[to];
+  const float distance = (NavGraph::getCenter(b) - NavGraph::getCenter(a)).Length();
+
+  // The surfaces share an end point.
+  if ((a.right - b.left).Length() <= NAV_CONNECT_EPSILON) {
+    _edges.push_back({from, to, EdgeType::WALK, a.right.x, true, distance});
+    return;
+  } else if ((a.left - b.right).Length() <= NAV_CONNECT_EPSILON) {
+    _edges.push_back({from, to, EdgeType::WALK, a.left.x, false, distance});
+    return;
+  }
+
+  // Walk off either end of `a` and fall onto `b`.
+  const float rightOffX = a.right.x + NAV_CONNECT_EPSILON;
+  if (rightOffX >= b.left.x && rightOffX <= b.right.x &&
+      NavGraph::getSurfaceY(b, rightOffX) < a.right.y) {
+    _edges.push_back({from, to, EdgeType::DROP, a.right.x, true, distance + NAV_DROP_COST});
+    return;
+  }
+  const float leftOffX = a.left.x - NAV_CONNECT_EPSILON;
+  if (leftOffX >= b.left.x && leftOffX <= b.right.x &&
+      NavGraph::getSurfaceY(b, leftOffX) < a.left.y) {
+    _edges.push_back({from, to, EdgeType::DROP, a.left.x, false, distance + NAV_DROP_COST});
+    return;
+  }
+
+  const float overlapLeft = std::max(a.left.x, b.left.x);
+  const float overlapRight = std::min(a.right.x, b.right.x);
+
+  if (overlapLeft < overlapRight) {
+    const float x = (overlapLeft + overlapRight) / 2;
+    const float dy = NavGraph::getSurfaceY(b, x) - NavGraph::getSurfaceY(a, x);
+    const bool isTowardsRight = NavGraph::getCenter(b).x >= x;
+
+    // Drop through a platform onto a surface right below it.
+    if (a.isPlatform && dy < 0) {
+      _edges.push_back({from, to, EdgeType::DROP_THROUGH, x, isTowardsRight,
+                        distance + NAV_DROP_COST});
+    // Jump onto a platform right above. Only platforms can be jumped through.
+    } else if (b.isPlatform && dy > 0 && dy <= NAV_MAX_JUMP_HEIGHT) {
+      _edges.push_back({from, to, EdgeType::JUMP, x, isTowardsRight,
+                        distance + NAV_JUMP_COST});
+    }
+    return;
+  }
+
+  // Jump across a gap.
+  if (b.left.x >= a.right.x && b.left.x - a.right.x <= NAV_MAX_JUMP_DISTANCE &&
+      b.left.y - a.right.y <= NAV_MAX_JUMP_HEIGHT) {
+    _edges.push_back({from, to, EdgeType::JUMP, a.right.x, true, distance + NAV_JUMP_COST});
+  } else if (b.right.x <= a.left.x && a.left.x - b.right.x <= NAV_MAX_JUMP_DISTANCE &&
+             b.right.y - a.left.y <= NAV_MAX_JUMP_HEIGHT) {
+    _edges.push_back({from, to, EdgeType::JUMP, a.left.x, false, distance + NAV_JUMP_COST});
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,78 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_NAV_GRAPH_H_
+#define VIGILANTE_NAV_GRAPH_H_
+
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+namespace vigilante {
+
+// A navigation graph for Npc pathfinding, built from the walkable surfaces
+// (the top edges of the "Ground" polylines and the "Platform" rectangles)
+// of a map at load time. Each node is one walkable surface, and each edge
+// describes how to get from one surface to another (walk, jump or drop).
+//
+// All coordinates are in pixels.
+class NavGraph final {
+ public:
+  enum EdgeType {
+    WALK,  // the surfaces are connected
+    JUMP,  // jump onto a higher (or a distant) surface
+    DROP,  // walk off the edge of the surface
+    DROP_THROUGH  // drop through a platform (see Character::jumpDown())
+  };
+
+  struct Node final {
+    b2Vec2 left;
+    b2Vec2 right;
+    bool isPlatform;
+  };
+
+  struct Edge final {
+    int from;
+    int to;
+    NavGraph::EdgeType type;
+    float x;  // where to take off
+    bool isTowardsRight;  // which direction to move after reaching `x`
+    float cost;
+  };
+
+  NavGraph();
+
+  // Building the graph.
+  void addSurface(const b2Vec2& p1, const b2Vec2& p2, bool isPlatform);
+  void buildEdges();
+
+  // Restoring the graph (e.g., from the compiled map cache).
+  void addNode(const NavGraph::Node& node);
+  void addEdge(const NavGraph::Edge& edge);
+  void buildIndex();
+  void clear();
+
+  // Returns the index of the surface which `pos` (e.g., a character's feet)
+  // is standing on or right above, or -1 if there's no such surface.
+  int findNode(const b2Vec2& pos) const;
+
+  // Finds the cheapest path from `start` to `goal` with A*.
+  // The indices of the edges to take are stored into `path`.
+  bool findPath(int start, int goal, std::vector<int>& path) const;
+
+  const std::vector<NavGraph::Node>& getNodes() const;
+  const std::vector<NavGraph::Edge>& getEdges() const;
+  bool empty() const;
+
+ private:
+  static float getSurfaceY(const NavGraph::Node& node, float x);
+  static b2Vec2 getCenter(const NavGraph::Node& node);
+
+  void tryConnect(int from, int to);
+
+  std::vector<NavGraph::Node> _nodes;
+  std::vector<NavGraph::Edge> _edges;  // sorted by `from`
+  std::vector<int> _edgeStarts;  // _edges[_edgeStarts[i]..._edgeStarts[i+1]] are from node i
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_NAV_GRAPH_H_
@@ -0,0 +1,395 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "AssetManager.h"
+#include "Constants.h"
+#include "StaticActor.h"
+#include "TextureResidency.h"
+#include "util/Headless.h"
+#include "util/Logger.h"
+#include "util/RandUtil.h"
+#include "util/StringUtil.h"
+
+#define PARTICLE_BATCH_CAPACITY 1024  // per texture
+
+using std::string;
+using std::vector;
+using cocos2d::BlendFunc;
+using cocos2d::Color4B;
+using cocos2d::GLProgram;
+using cocos2d::GLProgramState;
+using cocos2d::Mat4;
+using cocos2d::Node;
+using cocos2d::QuadCommand;
+using cocos2d::Rect;
+using cocos2d::Renderer;
+using cocos2d::SpriteFrame;
+using cocos2d::SpriteFrameCache;
+using cocos2d::Texture2D;
+using cocos2d::V3F_C4B_T2F_Quad;
+
+namespace vigilante {
+
+namespace {
+
+// Reads either [min, max] or a single number (min == max).
+void readRange(const rapidjson::Value& json, const char* name, float* min, float* max) {
+  auto it = json.FindMember(name);
+  if (it == json.MemberEnd()) {
+    return;
+  }
+  if (it->value.IsArray() && it->value.Size() == 2) {
+    *min = it->value[0].GetFloat();
+    *max = it->value[1].GetFloat();
+  } else if (it->value.IsNumber()) {
+    *min = *max = it->value.GetFloat();
+  }
+}
+
+}  // namespace
+
+
+// The particles of one texture (struct of arrays), and their quads.
+// The texture coordinates of a particle are written into its quad once when
+// it's emitted, and only the vertices and the colors are updated afterwards.
+class ParticleSystem::ParticleBatch : public Node {
+ public:
+  static ParticleSystem::ParticleBatch* create(Texture2D* texture) {
+    ParticleBatch* batch = new (std::nothrow) ParticleBatch(texture);
+    if (batch && batch->init()) {
+      batch->autorelease();
+      return batch;
+    }
+    CC_SAFE_DELETE(batch);
+    return nullptr;
+  }
+
+  virtual bool init() override {
+    if (!Node::init()) {
+      return false;
+    }
+    setGLProgramState(GLProgramState::getOrCreateWithGLProgramName(
+        GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP, _texture));
+    return true;
+  }
+
+  // Returns false if the buffer is full.
+  bool add(const SpriteFrame* frame, float x, float y, float vx, float vy, float lifetime,
+           const ParticleSystem::Emitter& emitter) {
+    if (_size >= PARTICLE_BATCH_CAPACITY) {
+      return false;
+    }
+
+    const size_t i = _size++;
+    _x[i] = x;
+    _y[i] = y;
+    _vx[i] = vx;
+    _vy[i] = vy;
+    _ay[i] = emitter.gravity;
+    _age[i] = 0;
+    _invLifetime[i] = 1.0f / std::max(lifetime, kFixedTimeStep);
+    _startScale[i] = emitter.startScale;
+    _deltaScale[i] = emitter.endScale - emitter.startScale;
+    _startOpacity[i] = emitter.startOpacity;
+    _deltaOpacity[i] = emitter.endOpacity - emitter.startOpacity;
+    _halfWidth[i] = frame->getRect().size.width / 2;
+    _halfHeight[i] = frame->getRect().size.height / 2;
+    setTextureCoords(frame, _quads[i]);
+    return true;
+  }
+
+  void step(float delta) {
+    const size_t n = _size;
+    float* x = _x.data();
+    float* y = _y.data();
+    float* vx = _vx.data();
+    float* vy = _vy.data();
+    const float* ay = _ay.data();
+    float* age = _age.data();
+
+    for (size_t i = 0; i < n; i++) {
+      age[i] += delta;
+      vy[i] += ay[i] * delta;
+      x[i] += vx[i] * delta;
+      y[i] += vy[i] * delta;
+    }
+
+    // Expired particles are replaced by the last one.
+    for (size_t i = 0; i < _size;) {
+      if (_age[i] * _invLifetime[i] >= 1.0f) {
+        move(_size - 1, i);
+        _size--;
+      } else {
+        i++;
+      }
+    }
+
+    updateQuads();
+  }
+
+  void clear() {
+    _size = 0;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  virtual void draw(Renderer* renderer, const Mat4& transform, uint32_t flags) override {
+    if (_size == 0) {
+      return;
+    }
+    _quadCommand.init(_globalZOrder, _texture, getGLProgramState(), _blendFunc,
+                      _quads.data(), _size, transform, flags);
+    renderer->addCommand(&_quadCommand);
+  }
+
+ private:
+  explicit ParticleBatch(Texture2D* texture)
+      : _texture(texture),
+        _blendFunc((texture->hasPremultipliedAlpha()) ? BlendFunc::ALPHA_PREMULTIPLIED
+                                                       : BlendFunc::ALPHA_NON_PREMULTIPLIED),
+        _size(),
+        _x(PARTICLE_BATCH_CAPACITY),
+        _y(PARTICLE_BATCH_CAPACITY),
+        _vx(PARTICLE_BATCH_CAPACITY),
+        _vy(PARTICLE_BATCH_CAPACITY),
+        _ay(PARTICLE_BATCH_CAPACITY),
+        _age(PARTICLE_BATCH_CAPACITY),
+        _invLifetime(PARTICLE_BATCH_CAPACITY),
+        _startScale(PARTICLE_BATCH_CAPACITY),
+        _deltaScale(PARTICLE_BATCH_CAPACITY),
+        _startOpacity(PARTICLE_BATCH_CAPACITY),
+        _deltaOpacity(PARTICLE_BATCH_CAPACITY),
+        _halfWidth(PARTICLE_BATCH_CAPACITY),
+        _halfHeight(PARTICLE_BATCH_CAPACITY),
+        _quads(PARTICLE_BATCH_CAPACITY),
+        _quadCommand() {
+    _texture->retain();
+  }
+
+  virtual ~ParticleBatch() {
+    _texture->release();
+  }
+
+  void move(size_t from, size_t to) {
+    _x[to] = _x[from];
+    _y[to] = _y[from];
+    _vx[to] = _vx[from];
+    _vy[to] = _vy[from];
+    _ay[to] = _ay[from];
+    _age[to] = _age[from];
+    _invLifetime[to] = _invLifetime[from];
+    _startScale[to] = _startScale[from];
+    _deltaScale[to] = _deltaScale[from];
+    _startOpacity[to] = _startOpacity[from];
+    _deltaOpacity[to] = _deltaOpacity[from];
+    _halfWidth[to] = _halfWidth[from];
+    _halfHeight[to] = _halfHeight[from];
+    _quads[to] = _quads[from];
+  }
+
+  void updateQuads() {
+    const bool isPremultiplied = _texture->hasPremultipliedAlpha();
+    for (size_t i = 0; i < _size; i++) {
+      const float t = _age[i] * _invLifetime[i];
+      const float scale = _startScale[i] + _deltaScale[i] * t;
+      const float opacity = std::min(std::max(_startOpacity[i] + _deltaOpacity[i] * t, 0.0f), 255.0f);
+      const float left = _x[i] - _halfWidth[i] * scale;
+      const float right = _x[i] + _halfWidth[i] * scale;
+      const float bottom = _y[i] - _halfHeight[i] * scale;
+      const float top = _y[i] + _halfHeight[i] * scale;
+
+      const GLubyte alpha = static_cast<GLubyte>(opacity);
+      const GLubyte rgb = (isPremultiplied) ? alpha : 255;
+      const Color4B color(rgb, rgb, rgb, alpha);
+
+      V3F_C4B_T2F_Quad& quad = _quads[i];
+      quad.bl.vertices.set(left, bottom, 0);
+      quad.br.vertices.set(right, bottom, 0);
+      quad.tl.vertices.set(left, top, 0);
+      quad.tr.vertices.set(right, top, 0);
+      quad.bl.colors = quad.br.colors = quad.tl.colors = quad.tr.colors = color;
+    }
+  }
+
+  // Same as Sprite::setTextureCoords().
+  void setTextureCoords(const SpriteFrame* frame, V3F_C4B_T2F_Quad& quad) const {
+    const Rect& rect = frame->getRectInPixels();
+    const float atlasWidth = static_cast<float>(_texture->getPixelsWide());
+    const float atlasHeight = static_cast<float>(_texture->getPixelsHigh());
+
+    if (frame->isRotated()) {
+      const float left = rect.origin.x / atlasWidth;
+      const float right = (rect.origin.x + rect.size.height) / atlasWidth;
+      const float top = rect.origin.y / atlasHeight;
+      const float bottom = (rect.origin.y + rect.size.width) / atlasHeight;
+      quad.bl.texCoords = {left, top};
+      quad.br.texCoords = {left, bottom};
+      quad.tl.texCoords = {right, top};
+      quad.tr.texCoords = {right, bottom};
+    } else {
+      const float left = rect.origin.x / atlasWidth;
+      const float right = (rect.origin.x + rect.size.width) / atlasWidth;
+      const float top = rect.origin.y / atlasHeight;
+      const float bottom = (rect.origin.y + rect.size.height) / atlasHeight;
+      quad.bl.texCoords = {left, bottom};
+      quad.br.texCoords = {right, bottom};
+      quad.tl.texCoords = {left, top};
+      quad.tr.texCoords = {right, top};
+    }
+  }
+
+  Texture2D* _texture;  // retained
+  BlendFunc _blendFunc;
+  size_t _size;
+
+  vector<float> _x;
+  vector<float> _y;
+  vector<float> _vx;
+  vector<float> _vy;
+  vector<float> _ay;
+  vector<float> _age;
+  vector<float> _invLifetime;
+  vector<float> _startScale;
+  vector<float> _deltaScale;
+  vector<float> _startOpacity;
+  vector<float> _deltaOpacity;
+  vector<float> _halfWidth;
+  vector<float> _halfHeight;
+  vector<V3F_C4B_T2F_Quad> _quads;
+
+  QuadCommand _quadCommand;
+};
+
+
+ParticleSystem::Emitter::Emitter()
+    : framesName(),
+      count(),
+      minLifetime(.5f),
+      maxLifetime(.5f),
+      minSpeed(),
+      maxSpeed(),
+      minAngle(),
+      maxAngle(360.0f),
+      gravity(),
+      startScale(1.0f),
+      endScale(1.0f),
+      startOpacity(255.0f),
+      endOpacity(0.0f) {}
+
+ParticleSystem::Emitter::Emitter(const rapidjson::Value& json) : Emitter() {
+  framesName = json["framesName"].GetString();
+  count = json["count"].GetInt();
+  readRange(json, "lifetime", &minLifetime, &maxLifetime);
+  readRange(json, "speed", &minSpeed, &maxSpeed);
+  readRange(json, "angle", &minAngle, &maxAngle);
+  readRange(json, "scale", &startScale, &endScale);
+  readRange(json, "opacity", &startOpacity, &endOpacity);
+  if (json.HasMember("gravity")) {
+    gravity = json["gravity"].GetFloat();
+  }
+}
+
+
+ParticleSystem::ParticleSystem(RenderBuckets* renderBuckets)
+    : _renderBuckets(renderBuckets),
+      _particleBatches() {}
+
+ParticleSystem::~ParticleSystem() {
+  for (const auto& p : _particleBatches) {
+    p.second->release();
+  }
+}
+
+
+void ParticleSystem::emit(const ParticleSystem::Emitter& emitter, const string& textureResDir,
+                          float x, float y, bool isFacingRight) {
+  if (emitter.count <= 0 || headless::isEnabled()) {
+    return;
+  }
+
+  // e.g., Texture/skill/ice_spike + spark -> ice_spike_spark/{0,1,...}.png
+  TextureResidency::getInstance()->require(textureResDir);
+  const string framesName = StaticActor::getLastDirName(textureResDir) + "_" + emitter.framesName;
+  const size_t numFrames = std::max<size_t>(asset_manager::getFrameCount(framesName), 1);
+  vector<SpriteFrame*> frames;
+  frames.reserve(numFrames);
+  for (size_t i = 0; i < numFrames; i++) {
+    const string frameName = string_util::format("%s/%zu.png", framesName.c_str(), i);
+    if (SpriteFrame* frame = SpriteFrameCache::getInstance()->getSpriteFrameByName(frameName)) {
+      frames.push_back(frame);
+    }
+  }
+  if (frames.empty()) {
+    VGLOG(LOG_WARN, "No particle frames: %s/%s", textureResDir.c_str(), framesName.c_str());
+    return;
+  }
+
+  // The particles are purely cosmetic, so they mustn't consume
+  // the random numbers of the gameplay (see rand_util::Stream).
+  for (int i = 0; i < emitter.count; i++) {
+    SpriteFrame* frame = frames[rand_util::randInt(0, frames.size() - 1, rand_util::Stream::FX)];
+    ParticleBatch* batch = getParticleBatch(frame->getTexture());
+    if (!batch) {
+      return;
+    }
+
+    const float angle = CC_DEGREES_TO_RADIANS(
+        rand_util::randFloat(emitter.minAngle, emitter.maxAngle, rand_util::Stream::FX));
+    const float speed = rand_util::randFloat(emitter.minSpeed, emitter.maxSpeed, rand_util::Stream::FX);
+    const float lifetime = rand_util::randFloat(emitter.minLifetime, emitter.maxLifetime,
+                                                rand_util::Stream::FX);
+    const float vx = std::cos(angle) * speed;
+    const float vy = std::sin(angle) * speed;
+    if (!batch->add(frame, x, y, (isFacingRight) ? vx : -vx, vy, lifetime, emitter)) {
+      return;
+    }
+  }
+}
+
+void ParticleSystem::update(float delta) {
+  for (const auto& p : _particleBatches) {
+    p.second->step(delta);
+  }
+}
+
+void ParticleSystem::clear() {
+  for (const auto& p : _particleBatches) {
+    p.second->clear();
+    p.second->removeFromParent();
+    p.second->release();
+  }
+  _particleBatches.clear();
+}
+
+size_t ParticleSystem::getNumParticles() const {
+  size_t numParticles = 0;
+  for (const auto& p : _particleBatches) {
+    numParticles += p.second->size();
+  }
+  return numParticles;
+}
+
+
+ParticleSystem::ParticleBatch* ParticleSystem::getParticleBatch(Texture2D* texture) {
+  auto it = _particleBatches.find(texture);
+  if (it != _particleBatches.end()) {
+    return it->second;
+  }
+
+  ParticleBatch* batch = ParticleBatch::create(texture);
+  if (!batch) {
+    return nullptr;
+  }
+  batch->retain();
+  _renderBuckets->get(graphical_layers::kFx)->addChild(batch);
+  _particleBatches.insert({texture, batch});
+  return batch;
+}
+
+}  // namespace vigilante
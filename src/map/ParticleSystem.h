@@ -0,0 +1,87 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_PARTICLE_SYSTEM_H_
+#define VIGILANTE_PARTICLE_SYSTEM_H_
+
+#include <string>
+#include <unordered_map>
+
+#include <cocos2d.h>
+#include <json/document.h>
+#include "map/RenderBuckets.h"
+
+namespace vigilante {
+
+// Lightweight particles for spells and skills.
+//
+// Unlike the fx (see FxManager), a particle isn't a Sprite. The particles
+// whose frames come from the same atlas page live in one fixed-capacity
+// buffer (struct of arrays, so that the update loops can be vectorized by
+// the compiler), and each buffer is drawn with a single QuadCommand on
+// graphical_layers::kFx. A buffer which is full simply drops the particles
+// emitted after that, which is fine for cosmetic effects.
+//
+// The emitters are data-driven, e.g., in a skill's json:
+//
+//   "particles": {
+//     "framesName": "spark",    // <textureResDir>/<last dir name>_spark/{0,1,...}.png
+//     "count": 16,
+//     "lifetime": [0.3, 0.6],   // seconds
+//     "speed": [20, 60],        // pixels per second
+//     "angle": [-30, 30],       // degrees, 0 is towards the direction faced
+//     "gravity": -60,           // pixels per second squared
+//     "scale": [1, 0],          // at birth, at death
+//     "opacity": [255, 0]       // at birth, at death
+//   }
+//
+// All methods must be called on the main thread.
+class ParticleSystem final {
+ public:
+  struct Emitter final {
+    Emitter();
+    explicit Emitter(const rapidjson::Value& json);
+
+    std::string framesName;
+    int count;  // the number of particles per emit(), 0 if there's no emitter
+    float minLifetime;
+    float maxLifetime;
+    float minSpeed;
+    float maxSpeed;
+    float minAngle;
+    float maxAngle;
+    float gravity;
+    float startScale;
+    float endScale;
+    float startOpacity;
+    float endOpacity;
+  };
+
+  explicit ParticleSystem(RenderBuckets* renderBuckets);
+  ~ParticleSystem();
+
+  // Emits the particles of `emitter` at (x, y), using the frames under `textureResDir`.
+  void emit(const ParticleSystem::Emitter& emitter, const std::string& textureResDir,
+            float x, float y, bool isFacingRight=true);
+
+  // Advances and expires the particles of all buffers.
+  void update(float delta);
+
+  // Removes all particles (e.g., when the GameMap is changed),
+  // and releases the buffers of the textures which are no longer shown.
+  void clear();
+
+  size_t getNumParticles() const;
+
+ private:
+  class ParticleBatch;
+
+  ParticleSystem::ParticleBatch* getParticleBatch(cocos2d::Texture2D* texture);
+
+  RenderBuckets* _renderBuckets;
+
+  // texture -> the particle buffer drawing it (retained)
+  std::unordered_map<cocos2d::Texture2D*, ParticleSystem::ParticleBatch*> _particleBatches;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_PARTICLE_SYSTEM_H_
@@ -0,0 +1,194 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "PhysicsQueryService.h"
+
+#include "Constants.h"
+#include "character/Character.h"
+
+#define GROUND_AHEAD_OFFSET_X 2.0f  // in pixels, beyond the body's edge
+#define GROUND_AHEAD_DEPTH 8.0f  // in pixels, below the body's bottom
+#define WALL_AHEAD_DISTANCE 4.0f  // in pixels, beyond the body's edge
+#define TERRAIN_MASK_BITS (kGround | kPlatform | kWall)
+
+using std::vector;
+using vigilante::category_bits::kGround;
+using vigilante::category_bits::kPlatform;
+using vigilante::category_bits::kWall;
+
+namespace vigilante {
+
+namespace {
+
+class RayCastCallback : public b2RayCastCallback {
+ public:
+  explicit RayCastCallback(short maskBits) : _maskBits(maskBits), _hasHit(), _hitPoint() {}
+  virtual ~RayCastCallback() = default;
+
+  virtual float32 ReportFixture(b2Fixture* fixture, const b2Vec2& point,
+                                const b2Vec2&, float32 fraction) override {
+    if (fixture->IsSensor() || !(fixture->GetFilterData().categoryBits & _maskBits)) {
+      return -1;  // ignore this fixture
+    }
+    _hasHit = true;
+    _hitPoint = point;
+    return fraction;  // clip the ray to find the closest hit
+  }
+
+  bool hasHit() const { return _hasHit; }
+  const b2Vec2& getHitPoint() const { return _hitPoint; }
+
+ private:
+  short _maskBits;
+  bool _hasHit;
+  b2Vec2 _hitPoint;
+};
+
+class QueryAABBCallback : public b2QueryCallback {
+ public:
+  QueryAABBCallback(short maskBits, vector<b2Fixture*>& result)
+      : _maskBits(maskBits), _result(result) {}
+  virtual ~QueryAABBCallback() = default;
+
+  virtual bool ReportFixture(b2Fixture* fixture) override {
+    if (fixture->GetFilterData().categoryBits & _maskBits) {
+      _result.push_back(fixture);
+    }
+    return true;  // continue the query
+  }
+
+ private:
+  short _maskBits;
+  vector<b2Fixture*>& _result;
+};
+
+}  // namespace
+
+PhysicsQueryService::PhysicsQueryService(b2World* world)
+    : _world(world),
+      _tileCollisionGrid(),
+      _queries() {}
+
+
+bool PhysicsQueryService::isGroundAhead(Character* character, bool towardsRight) {
+  const b2Body* body = character->getBody();
+  if (!body) {
+    return false;
+  }
+
+  const Character::Profile& profile = character->getCharacterProfile();
+  const float offsetX = (profile.bodyWidth / 2 + GROUND_AHEAD_OFFSET_X) / kPpm;
+  const float depth = (profile.bodyHeight / 2 + GROUND_AHEAD_DEPTH) / kPpm;
+
+  const b2Vec2& pos = body->GetPosition();
+  const b2Vec2 p1 = {pos.x + ((towardsRight) ? offsetX : -offsetX), pos.y};
+  const b2Vec2 p2 = {p1.x, pos.y - depth};
+  const QueryType type = (towardsRight) ? GROUND_AHEAD_RIGHT : GROUND_AHEAD_LEFT;
+  return query({character, nullptr, type}, p1, p2, kGround | kPlatform, /*expectsHit=*/true);
+}
+
+bool PhysicsQueryService::isWallAhead(Character* character, bool towardsRight) {
+  const b2Body* body = character->getBody();
+  if (!body) {
+    return false;
+  }
+
+  const Character::Profile& profile = character->getCharacterProfile();
+  const float distance = (profile.bodyWidth / 2 + WALL_AHEAD_DISTANCE) / kPpm;
+
+  const b2Vec2& p1 = body->GetPosition();
+  const b2Vec2 p2 = {p1.x + ((towardsRight) ? distance : -distance), p1.y};
+  const QueryType type = (towardsRight) ? WALL_AHEAD_RIGHT : WALL_AHEAD_LEFT;
+  return query({character, nullptr, type}, p1, p2, kWall, /*expectsHit=*/true);
+}
+
+bool PhysicsQueryService::hasLineOfSight(Character* character, Character* target) {
+  const b2Body* body = character->getBody();
+  const b2Body* targetBody = target->getBody();
+  if (!body || !targetBody) {
+    return false;
+  }
+
+  return query({character, target, LINE_OF_SIGHT},
+               body->GetPosition(), targetBody->GetPosition(),
+               kGround | kWall, /*expectsHit=*/false);
+}
+
+void PhysicsQueryService::resolvePendingQueries() {
+  for (auto it = _queries.begin(); it != _queries.end();) {
+    Query& q = it->second;
+    if (!q.isRequested) {
+      it = _queries.erase(it);
+      continue;
+    }
+    q.result = rayCast(q.p1, q.p2, q.maskBits) == q.expectsHit;
+    q.isRequested = false;
+    ++it;
+  }
+}
+
+void PhysicsQueryService::clear() {
+  _queries.clear();
+}
+
+void PhysicsQueryService::setTileCollisionGrid(const TileCollisionGrid* grid) {
+  _tileCollisionGrid = (grid && !grid->isEmpty()) ? grid : nullptr;
+}
+
+
+bool PhysicsQueryService::rayCast(const b2Vec2& p1, const b2Vec2& p2,
+                                  short maskBits, b2Vec2* hitPoint) const {
+  // b2World::RayCast() asserts that the segment has a non-zero length.
+  if ((p2 - p1).LengthSquared() <= 0.0f) {
+    return false;
+  }
+
+  // The terrain of a map with a tile collision grid isn't in the b2World,
+  // so it's looked up from the grid, and the b2World is only searched
+  // for a closer hit with the rest of `maskBits`.
+  b2Vec2 end = p2;
+  bool hasGridHit = false;
+  if (_tileCollisionGrid && (maskBits & TERRAIN_MASK_BITS)) {
+    hasGridHit = _tileCollisionGrid->rayCast(p1, p2, maskBits & kPlatform, &end);
+    maskBits &= ~TERRAIN_MASK_BITS;
+    if (!maskBits || (end - p1).LengthSquared() <= 0.0f) {
+      if (hasGridHit && hitPoint) {
+        *hitPoint = end;
+      }
+      return hasGridHit;
+    }
+  }
+
+  RayCastCallback callback(maskBits);
+  _world->RayCast(&callback, p1, end);
+  if (hitPoint && (callback.hasHit() || hasGridHit)) {
+    *hitPoint = (callback.hasHit()) ? callback.getHitPoint() : end;
+  }
+  return callback.hasHit() || hasGridHit;
+}
+
+void PhysicsQueryService::queryAABB(const b2AABB& aabb, short maskBits,
+                                    vector<b2Fixture*>& result) const {
+  QueryAABBCallback callback(maskBits, result);
+  _world->QueryAABB(&callback, aabb);
+}
+
+
+bool PhysicsQueryService::query(const Key& key,
+                                const b2Vec2& p1,
+                                const b2Vec2& p2,
+                                short maskBits,
+                                bool expectsHit) {
+  auto it = _queries.find(key);
+  if (it != _queries.end()) {
+    Query& q = it->second;
+    q.p1 = p1;
+    q.p2 = p2;
+    q.isRequested = true;
+    return q.result;
+  }
+
+  const bool result = rayCast(p1, p2, maskBits) == expectsHit;
+  _queries.insert({key, {p1, p2, maskBits, expectsHit, result, true}});
+  return result;
+}
+
+}  // namespace vigilante
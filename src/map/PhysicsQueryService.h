@@ -0,0 +1,100 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_PHYSICS_QUERY_SERVICE_H_
+#define VIGILANTE_PHYSICS_QUERY_SERVICE_H_
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+#include "map/TileCollisionGrid.h"
+
+namespace vigilante {
+
+class Character;
+
+// Raycast and AABB queries against the b2World for the AI,
+// so that Npcs can sense their surroundings without sensor fixtures.
+//
+// The high-level queries (isGroundAhead(), isWallAhead() and hasLineOfSight())
+// are cached: the first time a query is made, it is resolved right away.
+// After that, the cached result is returned, and all of the queries made
+// since the last resolvePendingQueries() are resolved again in one pass
+// (once per frame, after the b2World has been stepped). The queries which
+// haven't been made again since then are dropped from the cache.
+class PhysicsQueryService final {
+ public:
+  explicit PhysicsQueryService(b2World* world);
+
+  bool isGroundAhead(Character* character, bool towardsRight);
+  bool isWallAhead(Character* character, bool towardsRight);
+  bool hasLineOfSight(Character* character, Character* target);
+
+  void resolvePendingQueries();
+  void clear();
+
+  // If the current map has a tile collision grid, then the queries against
+  // the terrain (kGround, kWall and kPlatform) are made against `grid`,
+  // which doesn't tell the ground from the walls. nullptr to disable.
+  void setTileCollisionGrid(const TileCollisionGrid* grid);
+
+  // Uncached queries.
+  // rayCast() returns true if the segment from p1 to p2 hits a non-sensor
+  // fixture whose category bits match `maskBits`, and optionally
+  // outputs the closest hit point.
+  bool rayCast(const b2Vec2& p1, const b2Vec2& p2, short maskBits, b2Vec2* hitPoint=nullptr) const;
+  void queryAABB(const b2AABB& aabb, short maskBits, std::vector<b2Fixture*>& result) const;
+
+ private:
+  enum QueryType {
+    GROUND_AHEAD_LEFT,
+    GROUND_AHEAD_RIGHT,
+    WALL_AHEAD_LEFT,
+    WALL_AHEAD_RIGHT,
+    LINE_OF_SIGHT
+  };
+
+  // The pointers in the key are only used as identities and never
+  // dereferenced, since they may be dangling by the time the query is resolved.
+  struct Key final {
+    const void* source;
+    const void* target;
+    PhysicsQueryService::QueryType type;
+
+    bool operator==(const Key& other) const {
+      return source == other.source && target == other.target && type == other.type;
+    }
+  };
+
+  struct KeyHasher final {
+    size_t operator()(const Key& key) const {
+      return std::hash<const void*>()(key.source) ^
+             (std::hash<const void*>()(key.target) << 1) ^
+             (static_cast<size_t>(key.type) << 2);
+    }
+  };
+
+  struct Query final {
+    b2Vec2 p1;
+    b2Vec2 p2;
+    short maskBits;
+    bool expectsHit;  // the result is true iff the ray hits something
+    bool result;
+    bool isRequested;
+  };
+
+  bool query(const PhysicsQueryService::Key& key,
+             const b2Vec2& p1,
+             const b2Vec2& p2,
+             short maskBits,
+             bool expectsHit);
+
+  b2World* _world;
+  const TileCollisionGrid* _tileCollisionGrid;
+  std::unordered_map<Key, Query, KeyHasher> _queries;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_PHYSICS_QUERY_SERVICE_H_
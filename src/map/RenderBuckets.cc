@@ -0,0 +1,44 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "RenderBuckets.h"
+
+#include "Constants.h"
+#include "item/Equipment.h"
+
+using cocos2d::Layer;
+using cocos2d::Node;
+
+namespace vigilante {
+
+RenderBuckets::RenderBuckets(Layer* layer) : _layer(layer), _buckets() {
+  for (const int zOrder : {graphical_layers::kTmxTiledMap,
+                           graphical_layers::kChest,
+                           graphical_layers::kSpell,
+                           graphical_layers::kNpcBody,
+                           graphical_layers::kEnemyBody,
+                           graphical_layers::kItem,
+                           graphical_layers::kPlayerBody,
+                           graphical_layers::kDefault,
+                           graphical_layers::kLightMap,
+                           graphical_layers::kFx}) {
+    get(zOrder);
+  }
+
+  // Each type of equipment is drawn on its own layer, see Character::addEquipmentSpriteToMap().
+  for (int type = 0; type < Equipment::Type::SIZE; type++) {
+    get(graphical_layers::kEquipment - type);
+  }
+}
+
+Node* RenderBuckets::get(int zOrder) {
+  auto it = _buckets.find(zOrder);
+  if (it != _buckets.end()) {
+    return it->second;
+  }
+
+  Node* bucket = Node::create();
+  _layer->addChild(bucket, zOrder);
+  _buckets.insert({zOrder, bucket});
+  return bucket;
+}
+
+}  // namespace vigilante
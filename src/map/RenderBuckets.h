@@ -0,0 +1,40 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_RENDER_BUCKETS_H_
+#define VIGILANTE_RENDER_BUCKETS_H_
+
+#include <unordered_map>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// One persistent child node of the GameMapManager layer per graphical layer
+// (see graphical_layers), to which the sprites and batch nodes of the map are
+// added instead of the layer itself.
+//
+// Adding or removing a child marks its parent for re-sorting, and the layer
+// used to be the parent of every item, chest and batch node, so dropping or
+// picking up an item re-sorted all of them by z order. The buckets are created
+// once and never removed, so the layer itself is sorted only once, and only
+// the children of the bucket which has changed are re-sorted.
+//
+// All methods must be called on the main thread.
+class RenderBuckets final {
+ public:
+  explicit RenderBuckets(cocos2d::Layer* layer);
+
+  // Returns the bucket of graphical layer `zOrder`. The buckets of the
+  // graphical layers used by the map are preallocated, and any other
+  // one is created on its first use.
+  cocos2d::Node* get(int zOrder);
+
+ private:
+  cocos2d::Layer* _layer;
+
+  // zOrder -> bucket (owned by `_layer`)
+  std::unordered_map<int, cocos2d::Node*> _buckets;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_RENDER_BUCKETS_H_
@@ -0,0 +1,209 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TileChunkRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using std::string;
+using std::vector;
+using cocos2d::Director;
+using cocos2d::Mat4;
+using cocos2d::Node;
+using cocos2d::Rect;
+using cocos2d::RenderTexture;
+using cocos2d::Renderer;
+using cocos2d::Size;
+using cocos2d::Texture2D;
+using cocos2d::TMXLayer;
+using cocos2d::TMXTiledMap;
+
+namespace vigilante {
+
+const int TileChunkRenderer::_kChunkSizeInTiles = 32;
+const string TileChunkRenderer::_kChunkName = "tile_chunk";
+const string TileChunkRenderer::_kParallaxLayerNamePrefix = "parallax_layer:";
+
+TileChunkRenderer::TileChunkRenderer(TMXTiledMap* tmxTiledMap)
+    : _tmxTiledMap(tmxTiledMap),
+      _chunkSize(tmxTiledMap->getTileSize() * _kChunkSizeInTiles),
+      _numChunksX(static_cast<int>(std::ceil(tmxTiledMap->getMapSize().width / _kChunkSizeInTiles))),
+      _numChunksY(static_cast<int>(std::ceil(tmxTiledMap->getMapSize().height / _kChunkSizeInTiles))),
+      _chunks(_numChunksX * _numChunksY),
+      _shownRange{0, 0, -1, -1},
+      _parallaxLayers() {
+  // Bake the layers which haven't been baked yet. The layers of a
+  // TMXTiledMap reused from GameMapCache are already hidden.
+  vector<TMXLayer*> layers;
+  for (auto child : _tmxTiledMap->getChildren()) {
+    TMXLayer* layer = dynamic_cast<TMXLayer*>(child);
+    if (layer && layer->isVisible()) {
+      layers.push_back(layer);
+    }
+  }
+  for (auto layer : layers) {
+    if (getParallaxFactor(layer) == 1.0f) {
+      bakeLayer(layer, _tmxTiledMap);
+      continue;
+    }
+    Node* node = Node::create();
+    node->setName(_kParallaxLayerNamePrefix + layer->getLayerName());
+    _tmxTiledMap->addChild(node, layer->getLocalZOrder());
+    bakeLayer(layer, node);
+  }
+
+  // Collect all the chunks, including those baked earlier.
+  collectChunks(_tmxTiledMap, _chunks);
+  for (auto child : _tmxTiledMap->getChildren()) {
+    const string& name = child->getName();
+    if (name.compare(0, _kParallaxLayerNamePrefix.size(), _kParallaxLayerNamePrefix) != 0) {
+      continue;
+    }
+    TMXLayer* layer = _tmxTiledMap->getLayer(name.substr(_kParallaxLayerNamePrefix.size()));
+    _parallaxLayers.push_back({child, (layer) ? getParallaxFactor(layer) : 1.0f,
+                               Chunks(_chunks.size()), {0, 0, -1, -1}});
+    collectChunks(child, _parallaxLayers.back().chunks);
+  }
+}
+
+
+void TileChunkRenderer::update(const Rect& viewRect) {
+  if (_chunks.empty()) {
+    return;
+  }
+
+  updateChunks(viewRect, _chunks, _shownRange);
+
+  // A parallax layer is shifted along with the camera by (1 - factor) of its
+  // movement, so the part of the layer in view starts at (view origin * factor).
+  for (auto& parallaxLayer : _parallaxLayers) {
+    const cocos2d::Vec2 offset = viewRect.origin * (1.0f - parallaxLayer.factor);
+    parallaxLayer.node->setPosition(std::round(offset.x), std::round(offset.y));
+    const Rect layerViewRect(viewRect.origin - parallaxLayer.node->getPosition(), viewRect.size);
+    updateChunks(layerViewRect, parallaxLayer.chunks, parallaxLayer.shownRange);
+  }
+}
+
+size_t TileChunkRenderer::estimateMemoryUsage(const TMXTiledMap* tmxTiledMap) {
+  size_t memoryUsage = 0;
+  for (const auto child : tmxTiledMap->getChildren()) {
+    const string& name = child->getName();
+    if (name == _kChunkName) {
+      const Size& size = child->getContentSize();
+      memoryUsage += static_cast<size_t>(size.width * size.height) * 4;  // RGBA8888
+    } else if (name.compare(0, _kParallaxLayerNamePrefix.size(), _kParallaxLayerNamePrefix) == 0) {
+      for (const auto chunk : child->getChildren()) {
+        const Size& size = chunk->getContentSize();
+        memoryUsage += static_cast<size_t>(size.width * size.height) * 4;
+      }
+    }
+  }
+  return memoryUsage;
+}
+
+
+float TileChunkRenderer::getParallaxFactor(TMXLayer* layer) {
+  const cocos2d::Value& factor = layer->getProperty("parallax");
+  return (factor.isNull()) ? 1.0f : factor.asFloat();
+}
+
+void TileChunkRenderer::bakeLayer(TMXLayer* layer, Node* parent) {
+  Renderer* renderer = Director::getInstance()->getRenderer();
+
+  for (int y = 0; y < _numChunksY; y++) {
+    for (int x = 0; x < _numChunksX; x++) {
+      if (!hasTiles(layer, x, y)) {
+        continue;
+      }
+
+      RenderTexture* chunk = RenderTexture::create(_chunkSize.width, _chunkSize.height,
+                                                   Texture2D::PixelFormat::RGBA8888);
+      chunk->getSprite()->getTexture()->setAliasTexParameters();
+
+      // Draw the layer with the bottom-left corner of this chunk at the origin.
+      // visit() only queues the draw commands (which are executed when the
+      // next frame is rendered), so the layer can be hidden right after this.
+      Mat4 transform;
+      Mat4::createTranslation(-x * _chunkSize.width, -y * _chunkSize.height, 0, &transform);
+      chunk->beginWithClear(0, 0, 0, 0);
+      layer->visit(renderer, transform, Node::FLAGS_TRANSFORM_DIRTY);
+      chunk->end();
+
+      chunk->setContentSize(_chunkSize);
+      chunk->setPosition((x + .5f) * _chunkSize.width, (y + .5f) * _chunkSize.height);
+      chunk->setName(_kChunkName);
+      chunk->setTag(x + y * _numChunksX);
+      parent->addChild(chunk, (parent == _tmxTiledMap) ? layer->getLocalZOrder() : 0);
+    }
+  }
+
+  layer->setVisible(false);
+}
+
+bool TileChunkRenderer::hasTiles(const TMXLayer* layer, int chunkX, int chunkY) const {
+  const Size& layerSize = layer->getLayerSize();
+  const int width = static_cast<int>(layerSize.width);
+  const int height = static_cast<int>(layerSize.height);
+  const uint32_t* tiles = layer->getTiles();
+  if (!tiles) {
+    return false;
+  }
+
+  // The tile coordinates start from the top-left corner,
+  // whereas the chunks start from the bottom-left corner.
+  const int beginX = chunkX * _kChunkSizeInTiles;
+  const int endX = std::min(width, beginX + _kChunkSizeInTiles);
+  const int endY = height - chunkY * _kChunkSizeInTiles;
+  const int beginY = std::max(0, endY - _kChunkSizeInTiles);
+
+  for (int y = beginY; y < endY; y++) {
+    for (int x = beginX; x < endX; x++) {
+      if (tiles[x + y * width]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void TileChunkRenderer::collectChunks(Node* parent, TileChunkRenderer::Chunks& chunks) const {
+  for (auto child : parent->getChildren()) {
+    if (child->getName() == _kChunkName && child->getTag() < static_cast<int>(chunks.size())) {
+      child->setVisible(false);
+      chunks[child->getTag()].push_back(child);
+    }
+  }
+}
+
+void TileChunkRenderer::updateChunks(const Rect& viewRect, TileChunkRenderer::Chunks& chunks,
+                                     TileChunkRenderer::ChunkRange& shownRange) {
+  const ChunkRange range = {
+    std::max(0, static_cast<int>(viewRect.getMinX() / _chunkSize.width)),
+    std::max(0, static_cast<int>(viewRect.getMinY() / _chunkSize.height)),
+    std::min(_numChunksX - 1, static_cast<int>(viewRect.getMaxX() / _chunkSize.width)),
+    std::min(_numChunksY - 1, static_cast<int>(viewRect.getMaxY() / _chunkSize.height))
+  };
+
+  if (range.minX == shownRange.minX && range.minY == shownRange.minY &&
+      range.maxX == shownRange.maxX && range.maxY == shownRange.maxY) {
+    return;
+  }
+
+  // Only the chunks around the view are touched, so that this
+  // costs the same no matter how large the map is.
+  setChunksVisible(chunks, shownRange, false);
+  setChunksVisible(chunks, range, true);
+  shownRange = range;
+}
+
+void TileChunkRenderer::setChunksVisible(TileChunkRenderer::Chunks& chunks,
+                                         const TileChunkRenderer::ChunkRange& range, bool visible) {
+  for (int y = range.minY; y <= range.maxY; y++) {
+    for (int x = range.minX; x <= range.maxX; x++) {
+      for (auto chunk : chunks[x + y * _numChunksX]) {
+        chunk->setVisible(visible);
+      }
+    }
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,90 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TILE_CHUNK_RENDERER_H_
+#define VIGILANTE_TILE_CHUNK_RENDERER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// The static tile layers of a TMXTiledMap are baked into fixed-size chunks
+// (_kChunkSizeInTiles x _kChunkSizeInTiles tiles, one RenderTexture per layer
+// per chunk), and only the chunks which intersect the camera's view are drawn.
+// The original TMXLayers are hidden after they've been baked, so the cost of
+// drawing the tiles no longer grows with the width of the map.
+//
+// The chunks are added to the TMXTiledMap itself (with the local z order of
+// the layer they're baked from), so they stay resident along with the
+// TMXTiledMap in GameMapCache, and won't be baked again when it's reused.
+//
+// Parallax background layers are flagged with the "parallax" layer property
+// in the .tmx file, which is their scroll factor relative to the world
+// (e.g., 0 = fixed to the screen, .5 = half as fast, 1 = with the world).
+// Their chunks are baked into a node of their own, which is shifted by
+// (1 - factor) of the camera's movement every frame, so a deep backdrop
+// costs a handful of quads instead of thousands of tiles.
+class TileChunkRenderer final {
+ public:
+  // Must be called on the main thread.
+  explicit TileChunkRenderer(cocos2d::TMXTiledMap* tmxTiledMap);
+
+  // Shows only the chunks which intersect `viewRect` (in pixels),
+  // and scrolls the parallax layers.
+  void update(const cocos2d::Rect& viewRect);
+
+  // The texture memory used by the baked chunks of `tmxTiledMap`.
+  static size_t estimateMemoryUsage(const cocos2d::TMXTiledMap* tmxTiledMap);
+
+ private:
+  // chunk index (x + y * _numChunksX) -> the baked chunks
+  using Chunks = std::vector<std::vector<cocos2d::Node*>>;
+
+  // The range of the chunks currently shown (inclusive).
+  struct ChunkRange final {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+  };
+
+  struct ParallaxLayer final {
+    cocos2d::Node* node;  // the parent of the baked chunks of this layer
+    float factor;
+    TileChunkRenderer::Chunks chunks;
+    TileChunkRenderer::ChunkRange shownRange;
+  };
+
+  // Returns the scroll factor of `layer`, or 1 if it's not a parallax layer.
+  static float getParallaxFactor(cocos2d::TMXLayer* layer);
+
+  // Bakes `layer` into chunks which are added to `parent`.
+  void bakeLayer(cocos2d::TMXLayer* layer, cocos2d::Node* parent);
+  void collectChunks(cocos2d::Node* parent, TileChunkRenderer::Chunks& chunks) const;
+  bool hasTiles(const cocos2d::TMXLayer* layer, int chunkX, int chunkY) const;
+  void updateChunks(const cocos2d::Rect& viewRect, TileChunkRenderer::Chunks& chunks,
+                    TileChunkRenderer::ChunkRange& shownRange);
+  void setChunksVisible(TileChunkRenderer::Chunks& chunks,
+                        const TileChunkRenderer::ChunkRange& range, bool visible);
+
+  static const int _kChunkSizeInTiles;
+  static const std::string _kChunkName;
+  static const std::string _kParallaxLayerNamePrefix;
+
+  cocos2d::TMXTiledMap* _tmxTiledMap;
+  cocos2d::Size _chunkSize;  // in pixels
+  int _numChunksX;
+  int _numChunksY;
+
+  // The baked chunks of all layers which scroll with the world.
+  TileChunkRenderer::Chunks _chunks;
+  TileChunkRenderer::ChunkRange _shownRange;
+
+  std::vector<TileChunkRenderer::ParallaxLayer> _parallaxLayers;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TILE_CHUNK_RENDERER_H_
@@ -0,0 +1,144 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TileCollider.h"
+
+#include <cmath>
+
+#include "Constants.h"
+#include "character/Character.h"
+
+#define TERRAIN_MASK_BITS (kGround | kPlatform | kWall)
+
+using vigilante::category_bits::kFeet;
+using vigilante::category_bits::kGround;
+using vigilante::category_bits::kPlatform;
+using vigilante::category_bits::kWall;
+
+namespace vigilante {
+
+namespace {
+
+// Returns the first non-sensor fixture of `body` which collides with the terrain.
+b2Fixture* getTerrainFixture(b2Body* body) {
+  for (b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+    if (!fixture->IsSensor() && (fixture->GetFilterData().maskBits & TERRAIN_MASK_BITS)) {
+      return fixture;
+    }
+  }
+  return nullptr;
+}
+
+bool isPassingThroughPlatforms(const b2Fixture* fixture) {
+  const b2Filter& filter = fixture->GetFilterData();
+  if (!(filter.maskBits & kPlatform)) {
+    return true;
+  }
+  // See Character::jumpDown().
+  return filter.categoryBits == kFeet &&
+         static_cast<const Character*>(fixture->GetUserData())->isJumpingDown();
+}
+
+}  // namespace
+
+TileCollider::TileCollider(WorldContactListener* worldContactListener)
+    : _worldContactListener(worldContactListener),
+      _grid(),
+      _supports(),
+      _previousSupports() {}
+
+void TileCollider::setGrid(const TileCollisionGrid* grid) {
+  _grid = (grid && !grid->isEmpty()) ? grid : nullptr;
+  _supports.clear();
+  _previousSupports.clear();
+}
+
+bool TileCollider::isEnabled() const {
+  return _grid != nullptr;
+}
+
+void TileCollider::resolve(DynamicActor* actor, float timeStep) {
+  b2Body* body = actor->getBody();
+  if (!_grid || !body || body->GetType() != b2BodyType::b2_dynamicBody) {
+    return;
+  }
+
+  b2Fixture* fixture = getTerrainFixture(body);
+  if (!fixture) {
+    return;
+  }
+
+  const auto it = _previousSupports.find(fixture);
+  const short previousSupportBits = (it != _previousSupports.end()) ? it->second : 0;
+
+  // A body which is asleep or inactive hasn't moved, so it's still
+  // resting on whatever it was resting on.
+  if (!body->IsAwake() || !body->IsActive()) {
+    if (previousSupportBits) {
+      _supports[fixture] = previousSupportBits;
+    }
+    return;
+  }
+
+  const b2Vec2 previousPos = actor->getPreviousBodyPosition();
+  const b2Vec2& currentPos = body->GetPosition();
+  const bool passesThroughPlatforms = isPassingThroughPlatforms(fixture);
+
+  b2AABB aabb;
+  fixture->GetShape()->ComputeAABB(&aabb, {previousPos, b2Rot(body->GetAngle())}, 0);
+  const TileCollisionGrid::SweepResult result =
+      _grid->sweep(aabb, currentPos - previousPos, passesThroughPlatforms);
+
+  b2Vec2 velocity = body->GetLinearVelocity();
+  if (result.isBlockedX || result.isBlockedY) {
+    body->SetTransform(previousPos + result.displacement, body->GetAngle());
+    velocity.x = (result.isBlockedX) ? 0 : velocity.x;
+    velocity.y = (result.isBlockedY) ? 0 : velocity.y;
+  }
+
+  aabb.lowerBound += result.displacement;
+  aabb.upperBound += result.displacement;
+  const TileCollisionGrid::Tile support = _grid->getSupport(aabb, passesThroughPlatforms);
+  const short supportBits = (support == TileCollisionGrid::Tile::SOLID) ? kGround :
+                            (support == TileCollisionGrid::Tile::PLATFORM) ? kPlatform : 0;
+
+  if (supportBits && velocity.y <= 0) {
+    // Box2D would have mixed the frictions as sqrt(a * b), and the normal
+    // impulse of a resting body is its weight, see b2ContactSolver.
+    const float friction = std::sqrt(fixture->GetFriction() * kGroundFriction);
+    const float maxFrictionDeltaV = friction * std::abs(body->GetWorld()->GetGravity().y) * timeStep;
+    velocity.x = (std::abs(velocity.x) <= maxFrictionDeltaV) ?
+        0 : velocity.x - std::copysign(maxFrictionDeltaV, velocity.x);
+    velocity.y = 0;
+    body->SetGravityScale(0);
+  } else {
+    body->SetGravityScale(1);
+  }
+  body->SetLinearVelocity(velocity);
+
+  if (supportBits) {
+    _supports[fixture] = supportBits;
+  }
+
+  // The handlers may set the state of the actor (e.g., landing),
+  // so they're dispatched after the body has been resolved.
+  if (supportBits != previousSupportBits) {
+    if (previousSupportBits) {
+      _worldContactListener->dispatchTerrainContact(fixture, previousSupportBits, /*isBeginContact=*/false);
+    }
+    if (supportBits) {
+      _worldContactListener->dispatchTerrainContact(fixture, supportBits, /*isBeginContact=*/true);
+    }
+  }
+}
+
+void TileCollider::restore(DynamicActor* actor) const {
+  if (b2Body* body = actor->getBody()) {
+    body->SetGravityScale(1);
+  }
+}
+
+void TileCollider::endStep() {
+  _previousSupports.swap(_supports);
+  _supports.clear();
+}
+
+}  // namespace vigilante
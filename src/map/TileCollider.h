@@ -0,0 +1,62 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TILE_COLLIDER_H_
+#define VIGILANTE_TILE_COLLIDER_H_
+
+#include <unordered_map>
+
+#include <Box2D/Box2D.h>
+#include "DynamicActor.h"
+#include "map/TileCollisionGrid.h"
+#include "map/WorldContactListener.h"
+
+namespace vigilante {
+
+// Keeps the b2Bodies out of the static terrain of a TileCollisionGrid,
+// which isn't in the b2World (so Box2D only handles the interactions
+// between the dynamic bodies).
+//
+// After each b2World::Step(), the displacement of each body during the step
+// is swept against the grid, and the body is moved back to where it stops.
+// Only the non-sensor fixture which collides with the terrain is swept
+// (e.g., the feet of a character). A body resting on a tile doesn't fall
+// any further (its gravity is suspended), and receives the ground friction
+// which Box2D would have applied.
+//
+// The contacts with the terrain are reported to the same handlers as
+// the contacts with the "Ground" and "Platform" fixtures (e.g., landing),
+// see WorldContactListener::dispatchTerrainContact().
+//
+// All methods must be called on the main thread.
+class TileCollider final {
+ public:
+  explicit TileCollider(WorldContactListener* worldContactListener);
+
+  // Forgets the supports of all bodies. A nullptr `grid` disables this.
+  void setGrid(const TileCollisionGrid* grid);
+  bool isEnabled() const;
+
+  // Resolves the displacement of `actor`'s b2Body since it was recorded
+  // by DynamicActor::recordPreviousBodyPosition(). Called once per step.
+  void resolve(DynamicActor* actor, float timeStep);
+
+  // Restores the gravity of `actor`'s b2Body, e.g., before it's carried
+  // over to the next map, which may not have a grid.
+  void restore(DynamicActor* actor) const;
+
+  // Forgets the supports of the bodies which haven't been resolved in this
+  // step (e.g., they've been destroyed). Called after the last resolve().
+  void endStep();
+
+ private:
+  WorldContactListener* _worldContactListener;
+  const TileCollisionGrid* _grid;
+
+  // The terrain fixture -> the category bits of the terrain it's resting on,
+  // as of this step and the previous one.
+  std::unordered_map<b2Fixture*, short> _supports;
+  std::unordered_map<b2Fixture*, short> _previousSupports;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TILE_COLLIDER_H_
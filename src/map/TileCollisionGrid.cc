@@ -0,0 +1,249 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TileCollisionGrid.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#define TILE_EPSILON .0001f  // in meters
+#define SUPPORT_TOLERANCE .01f  // in meters, how far above a tile an AABB still rests on it
+
+namespace vigilante {
+
+TileCollisionGrid::TileCollisionGrid()
+    : _numCols(),
+      _numRows(),
+      _tileWidth(1.0f),
+      _tileHeight(1.0f),
+      _numWordsPerRow(),
+      _solidBits(),
+      _platformBits() {}
+
+void TileCollisionGrid::reset(int numCols, int numRows, float tileWidth, float tileHeight) {
+  _numCols = std::max(numCols, 0);
+  _numRows = std::max(numRows, 0);
+  _tileWidth = tileWidth;
+  _tileHeight = tileHeight;
+  _numWordsPerRow = (_numCols + 63) / 64;
+  _solidBits.assign(_numWordsPerRow * _numRows, 0);
+  _platformBits.assign(_numWordsPerRow * _numRows, 0);
+}
+
+void TileCollisionGrid::setTile(int col, int row, TileCollisionGrid::Tile tile) {
+  if (col < 0 || col >= _numCols || row < 0 || row >= _numRows) {
+    return;
+  }
+
+  const size_t index = row * _numWordsPerRow + col / 64;
+  const uint64_t bit = static_cast<uint64_t>(1) << (col % 64);
+  _solidBits[index] = (tile == Tile::SOLID) ? (_solidBits[index] | bit) : (_solidBits[index] & ~bit);
+  _platformBits[index] = (tile == Tile::PLATFORM) ? (_platformBits[index] | bit) : (_platformBits[index] & ~bit);
+}
+
+TileCollisionGrid::Tile TileCollisionGrid::getTile(int col, int row) const {
+  if (isBlocking(col, row, /*includesPlatforms=*/false)) {
+    return Tile::SOLID;
+  }
+  return (isBlocking(col, row, /*includesPlatforms=*/true)) ? Tile::PLATFORM : Tile::EMPTY;
+}
+
+
+TileCollisionGrid::SweepResult TileCollisionGrid::sweep(const b2AABB& aabb,
+                                                        const b2Vec2& displacement,
+                                                        bool passesThroughPlatforms) const {
+  SweepResult result = {displacement, false, false};
+  if (isEmpty()) {
+    return result;
+  }
+
+  // Along x, only the columns which the leading edge enters are checked,
+  // so an AABB which already overlaps a tile can still get out of it.
+  if (displacement.x != 0) {
+    const int firstRow = getRow(aabb.lowerBound.y + TILE_EPSILON);
+    const int lastRow = getRow(aabb.upperBound.y - TILE_EPSILON);
+
+    if (displacement.x > 0) {
+      const int lastCol = getCol(aabb.upperBound.x + displacement.x - TILE_EPSILON);
+      for (int col = getCol(aabb.upperBound.x - TILE_EPSILON) + 1; col <= lastCol; col++) {
+        if (isAnyBlockingInCol(col, firstRow, lastRow)) {
+          result.displacement.x = std::max(0.0f, col * _tileWidth - aabb.upperBound.x);
+          result.isBlockedX = true;
+          break;
+        }
+      }
+    } else {
+      const int lastCol = getCol(aabb.lowerBound.x + displacement.x + TILE_EPSILON);
+      for (int col = getCol(aabb.lowerBound.x + TILE_EPSILON) - 1; col >= lastCol; col--) {
+        if (isAnyBlockingInCol(col, firstRow, lastRow)) {
+          result.displacement.x = std::min(0.0f, (col + 1) * _tileWidth - aabb.lowerBound.x);
+          result.isBlockedX = true;
+          break;
+        }
+      }
+    }
+  }
+
+  // Then along y, from where the AABB has been moved to along x.
+  // The platforms only block the AABBs which are entirely above them.
+  if (displacement.y != 0) {
+    const int firstCol = getCol(aabb.lowerBound.x + result.displacement.x + TILE_EPSILON);
+    const int lastCol = getCol(aabb.upperBound.x + result.displacement.x - TILE_EPSILON);
+
+    if (displacement.y < 0) {
+      const int lastRow = getRow(aabb.lowerBound.y + displacement.y + TILE_EPSILON);
+      for (int row = getRow(aabb.lowerBound.y + TILE_EPSILON) - 1; row >= lastRow; row--) {
+        if (isAnyBlockingInRow(row, firstCol, lastCol, !passesThroughPlatforms)) {
+          result.displacement.y = std::min(0.0f, (row + 1) * _tileHeight - aabb.lowerBound.y);
+          result.isBlockedY = true;
+          break;
+        }
+      }
+    } else {
+      const int lastRow = getRow(aabb.upperBound.y + displacement.y - TILE_EPSILON);
+      for (int row = getRow(aabb.upperBound.y - TILE_EPSILON) + 1; row <= lastRow; row++) {
+        if (isAnyBlockingInRow(row, firstCol, lastCol, /*includesPlatforms=*/false)) {
+          result.displacement.y = std::max(0.0f, row * _tileHeight - aabb.upperBound.y);
+          result.isBlockedY = true;
+          break;
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+TileCollisionGrid::Tile TileCollisionGrid::getSupport(const b2AABB& aabb, bool passesThroughPlatforms) const {
+  if (isEmpty()) {
+    return Tile::EMPTY;
+  }
+
+  // The AABB has to be on top of the row, rather than sunk into it.
+  const int row = getRow(aabb.lowerBound.y - SUPPORT_TOLERANCE);
+  if (aabb.lowerBound.y < (row + 1) * _tileHeight - TILE_EPSILON) {
+    return Tile::EMPTY;
+  }
+
+  const int firstCol = getCol(aabb.lowerBound.x + TILE_EPSILON);
+  const int lastCol = getCol(aabb.upperBound.x - TILE_EPSILON);
+  if (isAnyBlockingInRow(row, firstCol, lastCol, /*includesPlatforms=*/false)) {
+    return Tile::SOLID;
+  }
+  if (!passesThroughPlatforms && isAnyBlockingInRow(row, firstCol, lastCol, /*includesPlatforms=*/true)) {
+    return Tile::PLATFORM;
+  }
+  return Tile::EMPTY;
+}
+
+bool TileCollisionGrid::rayCast(const b2Vec2& p1, const b2Vec2& p2, bool includesPlatforms,
+                                b2Vec2* hitPoint) const {
+  if (isEmpty()) {
+    return false;
+  }
+
+  // Walk the tiles along the segment (Amanatides and Woo), where `t`
+  // is the fraction of the segment at which the current tile is entered.
+  const b2Vec2 d = p2 - p1;
+  int col = getCol(p1.x);
+  int row = getRow(p1.y);
+  const int colStep = (d.x > 0) ? 1 : -1;
+  const int rowStep = (d.y > 0) ? 1 : -1;
+  const float tDeltaX = (d.x != 0) ? _tileWidth / std::abs(d.x) : FLT_MAX;
+  const float tDeltaY = (d.y != 0) ? _tileHeight / std::abs(d.y) : FLT_MAX;
+  float tMaxX = (d.x != 0) ? ((col + (d.x > 0)) * _tileWidth - p1.x) / d.x : FLT_MAX;
+  float tMaxY = (d.y != 0) ? ((row + (d.y > 0)) * _tileHeight - p1.y) / d.y : FLT_MAX;
+  float t = 0;
+
+  int numTiles = std::abs(getCol(p2.x) - col) + std::abs(getRow(p2.y) - row) + 1;
+  for (; numTiles > 0; numTiles--) {
+    if (isBlocking(col, row, includesPlatforms)) {
+      if (hitPoint) {
+        *hitPoint = p1 + t * d;
+      }
+      return true;
+    }
+
+    if (tMaxX < tMaxY) {
+      t = tMaxX;
+      tMaxX += tDeltaX;
+      col += colStep;
+    } else {
+      t = tMaxY;
+      tMaxY += tDeltaY;
+      row += rowStep;
+    }
+  }
+  return false;
+}
+
+
+bool TileCollisionGrid::isEmpty() const {
+  return _numCols == 0 || _numRows == 0;
+}
+
+int TileCollisionGrid::getNumCols() const {
+  return _numCols;
+}
+
+int TileCollisionGrid::getNumRows() const {
+  return _numRows;
+}
+
+float TileCollisionGrid::getTileWidth() const {
+  return _tileWidth;
+}
+
+float TileCollisionGrid::getTileHeight() const {
+  return _tileHeight;
+}
+
+size_t TileCollisionGrid::getMemoryUsage() const {
+  return sizeof(*this) + (_solidBits.capacity() + _platformBits.capacity()) * sizeof(uint64_t);
+}
+
+
+bool TileCollisionGrid::isBlocking(int col, int row, bool includesPlatforms) const {
+  if (col < 0 || col >= _numCols || row < 0 || row >= _numRows) {
+    return false;
+  }
+
+  const size_t index = row * _numWordsPerRow + col / 64;
+  const uint64_t bit = static_cast<uint64_t>(1) << (col % 64);
+  return (_solidBits[index] & bit) || (includesPlatforms && (_platformBits[index] & bit));
+}
+
+bool TileCollisionGrid::isAnyBlockingInCol(int col, int firstRow, int lastRow) const {
+  if (col < 0 || col >= _numCols) {
+    return false;
+  }
+
+  for (int row = std::max(firstRow, 0); row <= std::min(lastRow, _numRows - 1); row++) {
+    if (isBlocking(col, row, /*includesPlatforms=*/false)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TileCollisionGrid::isAnyBlockingInRow(int row, int firstCol, int lastCol, bool includesPlatforms) const {
+  if (row < 0 || row >= _numRows) {
+    return false;
+  }
+
+  for (int col = std::max(firstCol, 0); col <= std::min(lastCol, _numCols - 1); col++) {
+    if (isBlocking(col, row, includesPlatforms)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int TileCollisionGrid::getCol(float x) const {
+  return static_cast<int>(std::floor(x / _tileWidth));
+}
+
+int TileCollisionGrid::getRow(float y) const {
+  return static_cast<int>(std::floor(y / _tileHeight));
+}
+
+}  // namespace vigilante
@@ -0,0 +1,96 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TILE_COLLISION_GRID_H_
+#define VIGILANTE_TILE_COLLISION_GRID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+namespace vigilante {
+
+// The static terrain of a tile-aligned map, built from its "Collision"
+// tile layer (see GameMapSpec::parseCollisionLayer()).
+//
+// Each tile is either empty, solid (i.e., ground or wall), or a one-way
+// platform, and the tiles are stored as two bitfields (one bit per tile),
+// so a map of 1000x100 tiles only costs about 25 KB. The terrain queries
+// are direct lookups into the bitfields: sweep() moves an AABB across
+// the tiles it would pass through, getSupport() checks the tiles right
+// below an AABB, and rayCast() walks the tiles along a segment.
+//
+// When a map has such a grid, its "Ground", "Wall" and "Platform" layers
+// aren't committed to the b2World at all, and the bodies are kept out of
+// the terrain by TileCollider instead.
+//
+// Rows are counted from the bottom of the map, and all of the
+// coordinates are in meters. Read-only after it's built, so the
+// queries may be made from any thread.
+class TileCollisionGrid final {
+ public:
+  enum Tile : uint8_t {
+    EMPTY,
+    SOLID,
+    PLATFORM  // only solid for the AABBs falling onto it from above
+  };
+
+  struct SweepResult final {
+    b2Vec2 displacement;  // how far the AABB can actually be moved
+    bool isBlockedX;
+    bool isBlockedY;
+  };
+
+  TileCollisionGrid();
+
+  // Clears the grid and resizes it to `numCols` x `numRows` empty tiles.
+  void reset(int numCols, int numRows, float tileWidth, float tileHeight);
+  void setTile(int col, int row, TileCollisionGrid::Tile tile);
+
+  // The tiles out of the grid are empty.
+  TileCollisionGrid::Tile getTile(int col, int row) const;
+
+  // Moves `aabb` by `displacement`, first along x and then along y,
+  // and stops it at the first tiles which block it. The platforms are
+  // ignored if `passesThroughPlatforms` is true, e.g., when jumping down.
+  TileCollisionGrid::SweepResult sweep(const b2AABB& aabb,
+                                       const b2Vec2& displacement,
+                                       bool passesThroughPlatforms) const;
+
+  // Returns the tile which `aabb` is resting on (SOLID wins over PLATFORM),
+  // or EMPTY if its bottom edge isn't touching the top of any tile.
+  TileCollisionGrid::Tile getSupport(const b2AABB& aabb, bool passesThroughPlatforms) const;
+
+  // Returns true if the segment from p1 to p2 hits a solid tile
+  // (or a platform, if `includesPlatforms` is true), and optionally
+  // outputs the point where it enters that tile.
+  bool rayCast(const b2Vec2& p1, const b2Vec2& p2, bool includesPlatforms,
+               b2Vec2* hitPoint=nullptr) const;
+
+  bool isEmpty() const;
+  int getNumCols() const;
+  int getNumRows() const;
+  float getTileWidth() const;
+  float getTileHeight() const;
+  size_t getMemoryUsage() const;
+
+ private:
+  bool isBlocking(int col, int row, bool includesPlatforms) const;
+  bool isAnyBlockingInCol(int col, int firstRow, int lastRow) const;
+  bool isAnyBlockingInRow(int row, int firstCol, int lastCol, bool includesPlatforms) const;
+
+  int getCol(float x) const;
+  int getRow(float y) const;
+
+  int _numCols;
+  int _numRows;
+  float _tileWidth;
+  float _tileHeight;
+  size_t _numWordsPerRow;
+  std::vector<uint64_t> _solidBits;
+  std::vector<uint64_t> _platformBits;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TILE_COLLISION_GRID_H_
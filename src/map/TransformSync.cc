@@ -0,0 +1,94 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TransformSync.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VIGILANTE_TRANSFORM_SYNC_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VIGILANTE_TRANSFORM_SYNC_NEON
+#endif
+
+#include "Constants.h"
+#include "util/TraceProfiler.h"
+
+namespace vigilante {
+
+namespace {
+
+// current[i] = (alpha * current[i] + (1 - alpha) * previous[i]) * kPpm,
+// i.e., the same arithmetic as DynamicActor::getInterpolatedBodyPosition().
+void interpolateToPixels(const float* previous, float* current, size_t size, float alpha) {
+  const float beta = 1.0f - alpha;
+  size_t i = 0;
+
+#if defined(VIGILANTE_TRANSFORM_SYNC_SSE)
+  const __m128 alpha4 = _mm_set1_ps(alpha);
+  const __m128 beta4 = _mm_set1_ps(beta);
+  const __m128 ppm4 = _mm_set1_ps(kPpm);
+  for (; i + 4 <= size; i += 4) {
+    const __m128 p = _mm_loadu_ps(previous + i);
+    const __m128 c = _mm_loadu_ps(current + i);
+    const __m128 meters = _mm_add_ps(_mm_mul_ps(alpha4, c), _mm_mul_ps(beta4, p));
+    _mm_storeu_ps(current + i, _mm_mul_ps(meters, ppm4));
+  }
+#elif defined(VIGILANTE_TRANSFORM_SYNC_NEON)
+  const float32x4_t alpha4 = vdupq_n_f32(alpha);
+  const float32x4_t beta4 = vdupq_n_f32(beta);
+  const float32x4_t ppm4 = vdupq_n_f32(kPpm);
+  for (; i + 4 <= size; i += 4) {
+    const float32x4_t p = vld1q_f32(previous + i);
+    const float32x4_t c = vld1q_f32(current + i);
+    const float32x4_t meters = vaddq_f32(vmulq_f32(alpha4, c), vmulq_f32(beta4, p));
+    vst1q_f32(current + i, vmulq_f32(meters, ppm4));
+  }
+#endif
+
+  for (; i < size; i++) {
+    current[i] = (alpha * current[i] + beta * previous[i]) * kPpm;
+  }
+}
+
+}  // namespace
+
+
+TransformSync::TransformSync()
+    : _actors(),
+      _previousX(),
+      _previousY(),
+      _currentX(),
+      _currentY() {}
+
+void TransformSync::add(DynamicActor* actor) {
+  if (!actor->isTransformSyncNeeded()) {
+    return;
+  }
+
+  const b2Vec2& currentBodyPos = actor->getBody()->GetPosition();
+  const b2Vec2 previousBodyPos = actor->getPreviousBodyPosition();
+  _actors.push_back(actor);
+  _previousX.push_back(previousBodyPos.x);
+  _previousY.push_back(previousBodyPos.y);
+  _currentX.push_back(currentBodyPos.x);
+  _currentY.push_back(currentBodyPos.y);
+}
+
+void TransformSync::flush() {
+  VGTRACE_ZONE("TransformSync::flush");
+  const size_t size = _actors.size();
+  const float alpha = DynamicActor::getInterpolationAlpha();
+  interpolateToPixels(_previousX.data(), _currentX.data(), size, alpha);
+  interpolateToPixels(_previousY.data(), _currentY.data(), size, alpha);
+
+  for (size_t i = 0; i < size; i++) {
+    _actors[i]->syncTransform(_currentX[i], _currentY[i]);
+  }
+
+  _actors.clear();
+  _previousX.clear();
+  _previousY.clear();
+  _currentX.clear();
+  _currentY.clear();
+}
+
+}  // namespace vigilante
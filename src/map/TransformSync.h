@@ -0,0 +1,43 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TRANSFORM_SYNC_H_
+#define VIGILANTE_TRANSFORM_SYNC_H_
+
+#include <vector>
+
+#include "DynamicActor.h"
+
+namespace vigilante {
+
+// Syncs the sprites of the DynamicActors with their b2Bodies in one pass,
+// after all of them have been updated (see GameMapManager::update()).
+//
+// The body positions of the actors which need to be synced (see
+// DynamicActor::isTransformSyncNeeded()) are gathered into flat arrays
+// (struct of arrays), interpolated and converted from meters to pixels
+// four at a time (SSE on x86, NEON on ARM, or plain loops elsewhere),
+// and then scattered back through DynamicActor::syncTransform(), which
+// only touches the sprites whose position or facing have changed.
+//
+// All methods must be called on the main thread.
+class TransformSync final {
+ public:
+  TransformSync();
+
+  // Gathers the body position of `actor` if it needs to be synced.
+  void add(DynamicActor* actor);
+
+  // Converts the positions gathered by add(), syncs the sprites,
+  // and clears the gathered actors.
+  void flush();
+
+ private:
+  std::vector<DynamicActor*> _actors;
+  std::vector<float> _previousX;
+  std::vector<float> _previousY;
+  std::vector<float> _currentX;  // replaced by the sprite positions in flush()
+  std::vector<float> _currentY;  // replaced by the sprite positions in flush()
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TRANSFORM_SYNC_H_
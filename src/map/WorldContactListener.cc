@@ -1,8 +1,9 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "WorldContactListener.h"
 
+#include <chrono>
+
 #include <cocos2d.h>
-#include "CallbackManager.h"
 #include "Constants.h"
 #include "Projectile.h"
 #include "character/Character.h"
@@ -15,355 +16,362 @@
 #include "skill/Skill.h"
 #include "skill/MagicalMissile.h"
 #include "skill/ForwardSlash.h"
+#include "util/FrameProfiler.h"
 #include "util/Logger.h"
+#include "util/TraceProfiler.h"
+
+#define CONTACT_EVENTS_INITIAL_CAPACITY 64
 
 using std::unique_ptr;
 using cocos2d::EventKeyboard;
+using vigilante::category_bits::kGround;
+using vigilante::category_bits::kPlatform;
+using vigilante::category_bits::kFeet;
+using vigilante::category_bits::kPivotMarker;
+using vigilante::category_bits::kCliffMarker;
+using vigilante::category_bits::kPortal;
+using vigilante::category_bits::kInteractable;
+using vigilante::category_bits::kPlayer;
+using vigilante::category_bits::kEnemy;
+using vigilante::category_bits::kNpc;
+using vigilante::category_bits::kMeleeWeapon;
+using vigilante::category_bits::kProjectile;
 
 namespace vigilante {
 
+WorldContactListener::WorldContactListener()
+    : _contactHandlers(),
+      _contactEvents(),
+      _passThroughContacts() {
+  _contactEvents.reserve(CONTACT_EVENTS_INITIAL_CAPACITY);
+  registerDefaultContactHandlers();
+}
+
+
 void WorldContactListener::BeginContact(b2Contact* contact) {
   b2Fixture* fixtureA = contact->GetFixtureA();
   b2Fixture* fixtureB = contact->GetFixtureB();
 
-  int cDef = fixtureA->GetFilterData().categoryBits | fixtureB->GetFilterData().categoryBits;
-  switch (cDef) {
-    // When a character lands on the ground, make following changes.
-    case category_bits::kFeet | category_bits::kGround: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      if (feetFixture) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        c->setJumping(false);
-        c->setDoubleJumping(false);
-        c->setOnPlatform(false);
-        // Create dust effect.
-        FxManager::getInstance()->createDustFx(c);
-      }
-      break;
-    }
-    // When a character lands on a platform, make following changes.
-    case category_bits::kFeet | category_bits::kPlatform: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      if (feetFixture) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        c->setJumping(false);
-        c->setDoubleJumping(false);
-        c->setOnPlatform(true);
-        // Create dust effect.
-        FxManager::getInstance()->createDustFx(c);
-      }
-      break;
-    }
-    // When a player bumps into an enemy, the enemy will inflict damage to the player and knock it back.
-    case category_bits::kPlayer | category_bits::kEnemy: {
-      b2Fixture* playerFixture = GetTargetFixture(category_bits::kPlayer, fixtureA, fixtureB);
-      b2Fixture* enemyFixture = GetTargetFixture(category_bits::kEnemy, fixtureA, fixtureB);
-
-      if (playerFixture && enemyFixture) {
-        Character* player = static_cast<Character*>(playerFixture->GetUserData());
-        Character* enemy = static_cast<Character*>(enemyFixture->GetUserData());
-
-        if (!player->isInvincible()) {
-          float knockBackForceX = (player->isFacingRight()) ? -.25f : .25f; // temporary
-          float knockBackForceY = 1.0f; // temporary
-          enemy->inflictDamage(player, 25);
-          enemy->knockBack(player, knockBackForceX, knockBackForceY);
-        }
-      }
-      break;
-    }
-    // When an ally Npc bumps into an enemy, the enemy will inflict damage to the ally and knock it back.
-    case category_bits::kNpc | category_bits::kEnemy: {
-      b2Fixture* npcFixture = GetTargetFixture(category_bits::kNpc, fixtureA, fixtureB);
-      b2Fixture* enemyFixture = GetTargetFixture(category_bits::kEnemy, fixtureA, fixtureB);
-
-      if (npcFixture && enemyFixture) {
-        Character* npc = static_cast<Character*>(npcFixture->GetUserData());
-        Character* enemy = static_cast<Character*>(enemyFixture->GetUserData());
-
-        if (!npc->isInvincible()) {
-          float knockBackForceX = (npc->isFacingRight()) ? -.25f : .25f; // temporary
-          float knockBackForceY = 1.0f; // temporary
-          enemy->inflictDamage(npc, 25);
-          enemy->knockBack(npc, knockBackForceX, knockBackForceY);
-        }
-      }
-      break;
+  // Characters pass through the platforms from below, and collide on the way down.
+  // A contact's decision holds until it ends, and PreSolve() only reapplies it.
+  const int cDef = fixtureA->GetFilterData().categoryBits | fixtureB->GetFilterData().categoryBits;
+  if (cDef == (kFeet | kPlatform)) {
+    b2Fixture* feetFixture = GetTargetFixture(kFeet, fixtureA, fixtureB);
+    b2Fixture* platformFixture = GetTargetFixture(kPlatform, fixtureA, fixtureB);
+    if (isPassingThrough(feetFixture, platformFixture)) {
+      _passThroughContacts.insert(contact);
     }
+  }
 
-    case category_bits::kEnemy | category_bits::kPivotMarker: {
-      b2Fixture* enemyFixture = GetTargetFixture(category_bits::kEnemy, fixtureA, fixtureB);
-      if (enemyFixture) {
-        static_cast<Npc*>(enemyFixture->GetUserData())->reverseDirection();
-      }
-      break;
-    }
-    case category_bits::kEnemy | category_bits::kCliffMarker: {
-      b2Fixture* bodyFixture = GetTargetFixture(category_bits::kEnemy, fixtureA, fixtureB);
-      if (bodyFixture) {
-        static_cast<Character*>(bodyFixture->GetUserData())->doubleJump();
-      }
-      break;
-    }
-    case category_bits::kNpc | category_bits::kCliffMarker: {
-      b2Fixture* bodyFixture = GetTargetFixture(category_bits::kNpc, fixtureA, fixtureB);
-      if (bodyFixture) {
-        static_cast<Character*>(bodyFixture->GetUserData())->doubleJump();
-      }
-      break;
-    }
+  recordContactEvent(contact, /*isBeginContact=*/true);
+}
 
-    // Set enemy as player's current target (so player can inflict damage to enemy).
-    case category_bits::kMeleeWeapon | category_bits::kEnemy: {
-      b2Fixture* weaponFixture = GetTargetFixture(category_bits::kMeleeWeapon, fixtureA, fixtureB);
-      b2Fixture* enemyFixture = GetTargetFixture(category_bits::kEnemy, fixtureA, fixtureB);
-
-      if (weaponFixture && enemyFixture) {
-        Character* attacker = static_cast<Character*>(weaponFixture->GetUserData());
-        Character* enemy = static_cast<Character*>(enemyFixture->GetUserData());
-        attacker->getInRangeTargets().insert(enemy);
-
-        // If player is using skill (e.g., forward slash), than inflict damage
-        // when an enemy contacts player's weapon fixture.
-        if (attacker->isUsingSkill() && dynamic_cast<ForwardSlash*>(attacker->getCurrentlyUsedSkill())) {
-          int skillDmg = attacker->getCurrentlyUsedSkill()->getSkillProfile().physicalDamage;
-          attacker->inflictDamage(enemy, attacker->getDamageOutput() + skillDmg);
-        }
-      }
-      break;
-    }
-    // Set player as enemy's current target (so enemy can inflict damage to player).
-    case category_bits::kMeleeWeapon | category_bits::kPlayer: {
-      b2Fixture* weaponFixture = GetTargetFixture(category_bits::kMeleeWeapon, fixtureA, fixtureB);
-      b2Fixture* playerFixture = GetTargetFixture(category_bits::kPlayer, fixtureA, fixtureB);
-
-      if (weaponFixture && playerFixture) {
-        Character* attacker = static_cast<Character*>(weaponFixture->GetUserData());
-        Character* player = static_cast<Character*>(playerFixture->GetUserData());
-        attacker->getInRangeTargets().insert(player);
-      }
-      break;
-    }
-    // Set Npc as enemy's current target (so enemy can inflict damage to the Npc).
-    case category_bits::kMeleeWeapon | category_bits::kNpc: {
-      b2Fixture* weaponFixture = GetTargetFixture(category_bits::kMeleeWeapon, fixtureA, fixtureB);
-      b2Fixture* npcFixture = GetTargetFixture(category_bits::kNpc, fixtureA, fixtureB);
-
-      if (weaponFixture && npcFixture) {
-        Character* attacker = static_cast<Character*>(weaponFixture->GetUserData());
-        Character* npc = static_cast<Character*>(npcFixture->GetUserData());
-        attacker->getInRangeTargets().insert(npc);
-      }
-      break;
-    }
-    // Add the item to character's _inRangeItems set (so they can pick them up).
-    case category_bits::kFeet | category_bits::kItem: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      b2Fixture* itemFixture = GetTargetFixture(category_bits::kItem, fixtureA, fixtureB);
-
-      if (feetFixture && itemFixture) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        Item* i = static_cast<Item*>(itemFixture->GetUserData());
-        c->getInRangeItems().insert(i);
-      }
-      break;
-    }
-    // When a character gets close to a portal, register it to the character.
-    case category_bits::kFeet | category_bits::kPortal: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      b2Fixture* portalFixture = GetTargetFixture(category_bits::kPortal, fixtureA, fixtureB);
-      
-      if (feetFixture && portalFixture) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        GameMap::Portal* p = static_cast<GameMap::Portal*>(portalFixture->GetUserData());
-        c->setPortal(p);
-        
-        if (p->willInteractOnContact()) {
-          CallbackManager::getInstance()->runAfter([=]() {
-            c->interact(p);
-          }, .1f);
-        } else if (!p->willInteractOnContact() && dynamic_cast<Player*>(c)) {
-          p->showHintUI();
-        }
-      }
-      break;
-    }
-    // When a character gets close to an interactable object or NPC, register it to the character.
-    case category_bits::kFeet | category_bits::kInteractable: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      b2Fixture* interactableFixture = GetTargetFixture(category_bits::kInteractable, fixtureA, fixtureB);
-      
-      if (feetFixture && interactableFixture) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        Interactable* i = static_cast<Interactable*>(interactableFixture->GetUserData());
-
-        c->setInteractableObject(i);
-
-        if (dynamic_cast<Player*>(c) ) {
-          i->showHintUI();
-        }
-
-        if (i->willInteractOnContact()) {
-          CallbackManager::getInstance()->runAfter([=]() {
-            c->interact(i);
-          }, .1f);
-        }
-      }
-      break;
+void WorldContactListener::EndContact(b2Contact* contact) {
+  _passThroughContacts.erase(contact);
+  recordContactEvent(contact, /*isBeginContact=*/false);
+}
+
+void WorldContactListener::SayGoodbye(b2Fixture* fixture) {
+  // This fixture is being destroyed along with its b2Body, so the events
+  // which haven't been dispatched yet must not refer to it anymore.
+  for (auto& event : _contactEvents) {
+    if (event.fixtureA == fixture || event.fixtureB == fixture) {
+      event.fixtureA = nullptr;
+      event.fixtureB = nullptr;
     }
-    // When a project tile hits an enemy, play onHitAnimation and inflict damage.
-    case category_bits::kProjectile | category_bits::kEnemy: {
-      b2Fixture* projectileFixture = GetTargetFixture(category_bits::kProjectile, fixtureA, fixtureB);
-      b2Fixture* enemyFixture = GetTargetFixture(category_bits::kEnemy, fixtureA, fixtureB);
-      
-      if (projectileFixture && enemyFixture) {
-        DynamicActor* p = static_cast<DynamicActor*>(projectileFixture->GetUserData());
-        Character* c = static_cast<Character*>(enemyFixture->GetUserData());
-
-        Projectile* missile = dynamic_cast<Projectile*>(p);
-        missile->onHit(c);
-      }
-      break;
+  }
+}
+
+void WorldContactListener::dispatchContactEvents() {
+  VGTRACE_ZONE("WorldContactListener::dispatchContactEvents");
+
+  // The handlers may destroy b2Bodies, in which case SayGoodbye()
+  // will be called and modify _contactEvents, so we cannot use iterators here.
+  for (size_t i = 0; i < _contactEvents.size(); i++) {
+    const ContactEvent event = _contactEvents[i];
+    if (event.fixtureA && event.fixtureB) {
+      dispatchContactEvent(event);
     }
-    default:
-      break;
   }
+  _contactEvents.clear();
 }
 
-void WorldContactListener::EndContact(b2Contact* contact) {
+void WorldContactListener::registerContactHandler(short categoryBitsA,
+                                                  short categoryBitsB,
+                                                  const ContactHandler& onBeginContact,
+                                                  const ContactHandler& onEndContact) {
+  const int a = WorldContactListener::getCategoryIndex(categoryBitsA);
+  const int b = WorldContactListener::getCategoryIndex(categoryBitsB);
+  if (a < 0 || b < 0) {
+    VGLOG(LOG_ERR, "Invalid category bits: %hd, %hd", categoryBitsA, categoryBitsB);
+    return;
+  }
+
+  _contactHandlers[a][b] = {onBeginContact, onEndContact, false};
+  if (a != b) {
+    _contactHandlers[b][a] = {onBeginContact, onEndContact, true};
+  }
+}
+
+
+int WorldContactListener::getCategoryIndex(uint16 categoryBits) {
+  if (categoryBits == 0 || (categoryBits & (categoryBits - 1)) != 0) {
+    return -1;
+  }
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(categoryBits);
+#else
+  int index = 0;
+  while (!(categoryBits & 1)) {
+    categoryBits >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+void WorldContactListener::recordContactEvent(b2Contact* contact, bool isBeginContact) {
   b2Fixture* fixtureA = contact->GetFixtureA();
   b2Fixture* fixtureB = contact->GetFixtureB();
+  const int a = WorldContactListener::getCategoryIndex(fixtureA->GetFilterData().categoryBits);
+  const int b = WorldContactListener::getCategoryIndex(fixtureB->GetFilterData().categoryBits);
 
-  int cDef = fixtureA->GetFilterData().categoryBits | fixtureB->GetFilterData().categoryBits;
-  switch (cDef) {
-    // When a character leaves the ground, make following changes.
-    case category_bits::kFeet | category_bits::kGround: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      if (feetFixture && feetFixture->GetBody()->GetLinearVelocity().y > .5f) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        // Create dust effect.
-        FxManager::getInstance()->createDustFx(c);
-      }
-      break;
+  // Skip the contacts which no one is interested in.
+  if (a < 0 || b < 0) {
+    return;
+  }
+  const ContactHandlerEntry& entry = _contactHandlers[a][b];
+  if (!(isBeginContact ? entry.onBeginContact : entry.onEndContact)) {
+    return;
+  }
+
+  const ContactEvent event = {fixtureA, fixtureB,
+                              static_cast<uint8>(a), static_cast<uint8>(b),
+                              isBeginContact};
+
+  // If the world isn't locked, then we're not inside b2World::Step()
+  // (e.g., a b2Body is being destroyed), so the contact can be handled now.
+  if (!fixtureA->GetBody()->GetWorld()->IsLocked()) {
+    dispatchContactEvent(event);
+    return;
+  }
+
+  _contactEvents.push_back(event);
+}
+
+void WorldContactListener::dispatchContactEvent(const ContactEvent& event) const {
+  const ContactHandlerEntry& entry = _contactHandlers[event.categoryIndexA][event.categoryIndexB];
+  const ContactHandler& handler = (event.isBeginContact) ? entry.onBeginContact : entry.onEndContact;
+  if (!handler) {
+    return;
+  }
+
+  FrameProfiler* profiler = FrameProfiler::getInstance();
+  const auto beginTime = (profiler->isRecording()) ? std::chrono::steady_clock::now()
+                                                 : std::chrono::steady_clock::time_point();
+
+  if (entry.isFixtureOrderSwapped) {
+    handler(event.fixtureB, event.fixtureA);
+  } else {
+    handler(event.fixtureA, event.fixtureB);
+  }
+
+  if (profiler->isRecording()) {
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - beginTime;
+    profiler->addContactCallbackTime(event.categoryIndexA, event.categoryIndexB, elapsed.count());
+  }
+}
+
+
+void WorldContactListener::registerDefaultContactHandlers() {
+  // When a character lands on / leaves the ground, make following changes.
+  registerContactHandler(kFeet, kGround, [](b2Fixture* feetFixture, b2Fixture*) {
+    Character* c = static_cast<Character*>(feetFixture->GetUserData());
+    c->setJumping(false);
+    c->setDoubleJumping(false);
+    c->setOnPlatform(false);
+    // Create dust effect.
+    FxManager::getInstance()->createDustFx(c);
+  }, [](b2Fixture* feetFixture, b2Fixture*) {
+    if (feetFixture->GetBody()->GetLinearVelocity().y > .5f) {
+      Character* c = static_cast<Character*>(feetFixture->GetUserData());
+      // Create dust effect.
+      FxManager::getInstance()->createDustFx(c);
     }
-    // When a character leaves the platform, make following changes.
-    case category_bits::kFeet | category_bits::kPlatform: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      if (feetFixture && feetFixture->GetBody()->GetLinearVelocity().y < -.5f) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        c->setOnPlatform(false);
-        // Create dust effect.
-        FxManager::getInstance()->createDustFx(c);
-      }
-      break;
+  });
+
+  // When a character lands on / leaves a platform, make following changes.
+  registerContactHandler(kFeet, kPlatform, [](b2Fixture* feetFixture, b2Fixture*) {
+    Character* c = static_cast<Character*>(feetFixture->GetUserData());
+    c->setJumping(false);
+    c->setDoubleJumping(false);
+    c->setOnPlatform(true);
+    // Create dust effect.
+    FxManager::getInstance()->createDustFx(c);
+  }, [](b2Fixture* feetFixture, b2Fixture*) {
+    if (feetFixture->GetBody()->GetLinearVelocity().y < -.5f) {
+      Character* c = static_cast<Character*>(feetFixture->GetUserData());
+      c->setOnPlatform(false);
+      // Create dust effect.
+      FxManager::getInstance()->createDustFx(c);
     }
-    // Clear player's current target (so player cannot inflict damage to enemy from a distance).
-    case category_bits::kMeleeWeapon | category_bits::kEnemy: {
-      b2Fixture* weaponFixture = GetTargetFixture(category_bits::kMeleeWeapon, fixtureA, fixtureB);
-      b2Fixture* enemyFixture = GetTargetFixture(category_bits::kEnemy, fixtureA, fixtureB);
-
-      if (weaponFixture && enemyFixture) {
-        Character* attacker = static_cast<Character*>(weaponFixture->GetUserData());
-        Character* enemy = static_cast<Character*>(enemyFixture->GetUserData());
-        attacker->getInRangeTargets().erase(enemy);
-      }
-      break;
+  });
+
+  // When a player bumps into an enemy, the enemy will inflict damage to the player and knock it back.
+  registerContactHandler(kPlayer, kEnemy, [](b2Fixture* playerFixture, b2Fixture* enemyFixture) {
+    Character* player = static_cast<Character*>(playerFixture->GetUserData());
+    Character* enemy = static_cast<Character*>(enemyFixture->GetUserData());
+
+    if (!player->isInvincible()) {
+      float knockBackForceX = (player->isFacingRight()) ? -.25f : .25f; // temporary
+      float knockBackForceY = 1.0f; // temporary
+      enemy->inflictDamage(player, 25);
+      enemy->knockBack(player, knockBackForceX, knockBackForceY);
     }
-    // Clear enemy's current target (so enemy cannot inflict damage to player from a distance).
-    case category_bits::kMeleeWeapon | category_bits::kPlayer: {
-      b2Fixture* weaponFixture = GetTargetFixture(category_bits::kMeleeWeapon, fixtureA, fixtureB);
-      b2Fixture* playerFixture = GetTargetFixture(category_bits::kPlayer, fixtureA, fixtureB);
-
-      if (weaponFixture && playerFixture) {
-        Character* attacker = static_cast<Character*>(weaponFixture->GetUserData());
-        Character* player = static_cast<Character*>(playerFixture->GetUserData());
-        attacker->getInRangeTargets().erase(player);
-      }
-      break;
+  });
+
+  // When an ally Npc bumps into an enemy, the enemy will inflict damage to the ally and knock it back.
+  registerContactHandler(kNpc, kEnemy, [](b2Fixture* npcFixture, b2Fixture* enemyFixture) {
+    Character* npc = static_cast<Character*>(npcFixture->GetUserData());
+    Character* enemy = static_cast<Character*>(enemyFixture->GetUserData());
+
+    if (!npc->isInvincible()) {
+      float knockBackForceX = (npc->isFacingRight()) ? -.25f : .25f; // temporary
+      float knockBackForceY = 1.0f; // temporary
+      enemy->inflictDamage(npc, 25);
+      enemy->knockBack(npc, knockBackForceX, knockBackForceY);
     }
-    // Clear enemy's current target (so enemy cannot inflict damage to npc from a distance).
-    case category_bits::kMeleeWeapon | category_bits::kNpc: {
-      b2Fixture* weaponFixture = GetTargetFixture(category_bits::kMeleeWeapon, fixtureA, fixtureB);
-      b2Fixture* npcFixture = GetTargetFixture(category_bits::kNpc, fixtureA, fixtureB);
-
-      if (weaponFixture && npcFixture) {
-        Character* attacker = static_cast<Character*>(weaponFixture->GetUserData());
-        Character* npc = static_cast<Character*>(npcFixture->GetUserData());
-        attacker->getInRangeTargets().erase(npc);
-      }
-      break;
+  });
+
+  registerContactHandler(kEnemy, kPivotMarker, [](b2Fixture* enemyFixture, b2Fixture*) {
+    static_cast<Npc*>(enemyFixture->GetUserData())->reverseDirection();
+  });
+
+  registerContactHandler(kEnemy, kCliffMarker, [](b2Fixture* bodyFixture, b2Fixture*) {
+    static_cast<Character*>(bodyFixture->GetUserData())->doubleJump();
+  });
+
+  registerContactHandler(kNpc, kCliffMarker, [](b2Fixture* bodyFixture, b2Fixture*) {
+    static_cast<Character*>(bodyFixture->GetUserData())->doubleJump();
+  });
+
+  // The weapon fixtures only collide while a skill is being used (see
+  // Character::setWeaponFixtureEnabled()). The targets of the normal attacks
+  // are queried with Character::getWeaponHitbox() instead.
+  //
+  // If player is using skill (e.g., forward slash), than inflict damage
+  // when an enemy contacts player's weapon fixture.
+  registerContactHandler(kMeleeWeapon, kEnemy, [](b2Fixture* weaponFixture, b2Fixture* enemyFixture) {
+    Character* attacker = static_cast<Character*>(weaponFixture->GetUserData());
+    Character* enemy = static_cast<Character*>(enemyFixture->GetUserData());
+
+    if (attacker->isUsingSkill() && dynamic_cast<ForwardSlash*>(attacker->getCurrentlyUsedSkill())) {
+      int skillDmg = attacker->getCurrentlyUsedSkill()->getSkillProfile().physicalDamage;
+      attacker->inflictDamage(enemy, attacker->getDamageOutput() + skillDmg);
     }
-    // Remove the item from character's _inRangeItems set.
-    case category_bits::kFeet | category_bits::kItem: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      b2Fixture* itemFixture = GetTargetFixture(category_bits::kItem, fixtureA, fixtureB);
-
-      if (feetFixture && itemFixture) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        Item* i = static_cast<Item*>(itemFixture->GetUserData());
-        c->getInRangeItems().erase(i);
-      }
-      break;
+  });
+
+  // When a character gets close to a portal, register it to the character,
+  // and clear it when the character leaves.
+  registerContactHandler(kFeet, kPortal, [](b2Fixture* feetFixture, b2Fixture* portalFixture) {
+    Character* c = static_cast<Character*>(feetFixture->GetUserData());
+    GameMap::Portal* p = static_cast<GameMap::Portal*>(portalFixture->GetUserData());
+    c->setPortal(p);
+
+    if (p->willInteractOnContact()) {
+      c->interact(p);
+    } else if (!p->willInteractOnContact() && dynamic_cast<Player*>(c)) {
+      p->showHintUI();
     }
-    // When a character leaves an interactable object, clear it from the character.
-    case category_bits::kFeet | category_bits::kPortal: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      b2Fixture* portalFixture = GetTargetFixture(category_bits::kPortal, fixtureA, fixtureB);
-      
-      if (feetFixture && portalFixture) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        GameMap::Portal* p = static_cast<GameMap::Portal*>(portalFixture->GetUserData());
-        c->setPortal(nullptr);
-        p->hideHintUI();
-      }
-      break;
+  }, [](b2Fixture* feetFixture, b2Fixture* portalFixture) {
+    Character* c = static_cast<Character*>(feetFixture->GetUserData());
+    GameMap::Portal* p = static_cast<GameMap::Portal*>(portalFixture->GetUserData());
+    c->setPortal(nullptr);
+    p->hideHintUI();
+  });
+
+  // When a character gets close to an interactable object or NPC, register it to the character,
+  // and clear it when the character leaves.
+  registerContactHandler(kFeet, kInteractable, [](b2Fixture* feetFixture, b2Fixture* interactableFixture) {
+    Character* c = static_cast<Character*>(feetFixture->GetUserData());
+    Interactable* i = static_cast<Interactable*>(interactableFixture->GetUserData());
+
+    c->setInteractableObject(i);
+
+    if (dynamic_cast<Player*>(c) ) {
+      i->showHintUI();
     }
-    // When a character leaves an interactable object, clear it from the character.
-    case category_bits::kFeet | category_bits::kInteractable: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      b2Fixture* interactableFixture = GetTargetFixture(category_bits::kInteractable, fixtureA, fixtureB);
-      
-      if (feetFixture && interactableFixture) {
-        Character* c = static_cast<Character*>(feetFixture->GetUserData());
-        Interactable* i = static_cast<Interactable*>(interactableFixture->GetUserData());
-        c->setInteractableObject(nullptr);
-        i->hideHintUI();
-      }
-      break;
+
+    if (i->willInteractOnContact()) {
+      c->interact(i);
     }
-    default:
-      break;
-  }
+  }, [](b2Fixture* feetFixture, b2Fixture* interactableFixture) {
+    Character* c = static_cast<Character*>(feetFixture->GetUserData());
+    Interactable* i = static_cast<Interactable*>(interactableFixture->GetUserData());
+    c->setInteractableObject(nullptr);
+    i->hideHintUI();
+  });
+
+  // When a project tile hits an enemy, play onHitAnimation and inflict damage.
+  registerContactHandler(kProjectile, kEnemy, [](b2Fixture* projectileFixture, b2Fixture* enemyFixture) {
+    DynamicActor* p = static_cast<DynamicActor*>(projectileFixture->GetUserData());
+    Character* c = static_cast<Character*>(enemyFixture->GetUserData());
+
+    Projectile* missile = dynamic_cast<Projectile*>(p);
+    missile->onHit(c);
+  });
 }
 
 void WorldContactListener::PreSolve(b2Contact* contact, const b2Manifold* oldManifold) {
-  b2Fixture* fixtureA = contact->GetFixtureA();
-  b2Fixture* fixtureB = contact->GetFixtureB();
+  VGTRACE_ZONE("WorldContactListener::PreSolve");
 
-  int cDef = fixtureA->GetFilterData().categoryBits | fixtureB->GetFilterData().categoryBits;
-  switch (cDef) {
-    // Allow player to pass through platforms and collide on the way down.
-    case category_bits::kFeet | category_bits::kPlatform: {
-      b2Fixture* feetFixture = GetTargetFixture(category_bits::kFeet, fixtureA, fixtureB);
-      b2Fixture* platform = GetTargetFixture(category_bits::kPlatform, fixtureA, fixtureB);
+  // b2Contact::Update() re-enables every contact before calling PreSolve(),
+  // so the decisions made in BeginContact() have to be reapplied.
+  if (!_passThroughContacts.empty() && _passThroughContacts.contains(contact)) {
+    contact->SetEnabled(false);
+  }
+}
 
-      float playerY = feetFixture->GetBody()->GetPosition().y;
-      float platformY = platform->GetBody()->GetPosition().y;
+void WorldContactListener::PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) {
 
-      // Enable contact if the player is about to land on the platform.
-      // .15f is a value that works fine in my world.
-      contact->SetEnabled(playerY > platformY + .15f);
-      break;
-    }
-    default:
-      break;
+}
+
+
+void WorldContactListener::setPassingThrough(b2Contact* contact) {
+  if (contact->IsTouching()) {
+    _passThroughContacts.insert(contact);
   }
 }
 
-void WorldContactListener::PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) {
+void WorldContactListener::dispatchTerrainContact(b2Fixture* fixture,
+                                                  short terrainCategoryBits,
+                                                  bool isBeginContact) const {
+  const int a = WorldContactListener::getCategoryIndex(fixture->GetFilterData().categoryBits);
+  const int b = WorldContactListener::getCategoryIndex(terrainCategoryBits);
+  if (a < 0 || b < 0) {
+    return;
+  }
 
+  dispatchContactEvent({fixture, nullptr,
+                        static_cast<uint8>(a), static_cast<uint8>(b),
+                        isBeginContact});
 }
 
+bool WorldContactListener::isPassingThrough(const b2Fixture* feetFixture, const b2Fixture* oneWayFixture) {
+  const Character* c = static_cast<const Character*>(feetFixture->GetUserData());
+  if (c->isJumpingDown()) {
+    return true;
+  }
+
+  const GameMapSpec::OneWay* oneWay = static_cast<const GameMapSpec::OneWay*>(oneWayFixture->GetUserData());
+  if (!oneWay) {
+    return false;
+  }
+
+  // Solid iff the feet are beyond the fixture's body along its normal.
+  const b2Vec2 d = feetFixture->GetBody()->GetPosition() - oneWayFixture->GetBody()->GetPosition();
+  return b2Dot(d, oneWay->normal) <= oneWay->tolerance;
+}
 
 b2Fixture* WorldContactListener::GetTargetFixture(short targetCategoryBits, b2Fixture* f1, b2Fixture* f2) const {
   b2Fixture* targetFixture = nullptr;
@@ -2,22 +2,104 @@
 #ifndef VIGILANTE_WORLD_CONTACT_LISTENER_H_
 #define VIGILANTE_WORLD_CONTACT_LISTENER_H_
 
+#include <array>
+#include <functional>
+#include <vector>
+
 #include <Box2D/Box2D.h>
+#include "util/ds/FlatSet.h"
 
 namespace vigilante {
 
-class WorldContactListener : public b2ContactListener {
+// The contacts which begin/end during b2World::Step() are not handled
+// right away. Instead, they are recorded into a per-step event buffer,
+// and dispatched in one batch by dispatchContactEvents() after the step,
+// when the world is no longer locked. This way the gameplay logic
+// (e.g., dropping items) can freely create/destroy b2Bodies and b2Fixtures.
+//
+// The contacts which end outside of b2World::Step() (i.e., when a b2Body
+// is destroyed) are still handled immediately.
+//
+// Each contact is dispatched to the handlers registered for the pair of
+// category bits of its fixtures (see registerContactHandler()), which
+// are looked up from a table indexed by the category bit positions.
+class WorldContactListener : public b2ContactListener, public b2DestructionListener {
  public:
-  WorldContactListener() = default;
+  // The first argument is the fixture whose category bits is `categoryBitsA`
+  // (as passed to registerContactHandler()), and the second one is the fixture
+  // whose category bits is `categoryBitsB`.
+  using ContactHandler = std::function<void (b2Fixture*, b2Fixture*)>;
+
+  WorldContactListener();
   virtual ~WorldContactListener() = default;
 
-  virtual void BeginContact(b2Contact* contact) override;
-  virtual void EndContact(b2Contact* contact) override;
-  virtual void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override;
-  virtual void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override;
+  virtual void BeginContact(b2Contact* contact) override;  // b2ContactListener
+  virtual void EndContact(b2Contact* contact) override;  // b2ContactListener
+  virtual void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override;  // b2ContactListener
+  virtual void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override;  // b2ContactListener
+
+  virtual void SayGoodbye(b2Joint* joint) override {}  // b2DestructionListener
+  virtual void SayGoodbye(b2Fixture* fixture) override;  // b2DestructionListener
+
+  // Must be called after b2World::Step().
+  void dispatchContactEvents();
+
+  // Lets the feet pass through the one-way fixture of `contact` until they
+  // separate, e.g., when a character jumps down from a platform.
+  void setPassingThrough(b2Contact* contact);
+
+  // Dispatches a contact between `fixture` and the static terrain of
+  // `terrainCategoryBits` which isn't in the b2World (see TileCollider)
+  // right away. The handler receives nullptr as the terrain's fixture.
+  void dispatchTerrainContact(b2Fixture* fixture, short terrainCategoryBits, bool isBeginContact) const;
+
+  // Registers the handlers of the contacts between the fixtures of
+  // `categoryBitsA` and the fixtures of `categoryBitsB`. Both must have
+  // exactly one bit set. The handlers previously registered for the same
+  // pair of category bits will be replaced. Either handler can be nullptr.
+  void registerContactHandler(short categoryBitsA,
+                              short categoryBitsB,
+                              const ContactHandler& onBeginContact,
+                              const ContactHandler& onEndContact=nullptr);
+
+  static const int _kNumCategories = 16;
 
  private:
+  struct ContactHandlerEntry final {
+    ContactHandler onBeginContact;
+    ContactHandler onEndContact;
+    bool isFixtureOrderSwapped;
+  };
+
+  struct ContactEvent final {
+    b2Fixture* fixtureA;
+    b2Fixture* fixtureB;
+    uint8 categoryIndexA;
+    uint8 categoryIndexB;
+    bool isBeginContact;
+  };
+
+  // Returns the position of the bit set in `categoryBits`,
+  // or -1 if not exactly one bit is set.
+  static int getCategoryIndex(uint16 categoryBits);
+
+  void registerDefaultContactHandlers();
+
+  // Whether the one-way fixture (see GameMapSpec::OneWay) of a feet contact
+  // should be passed through, which is decided only once when it begins.
+  static bool isPassingThrough(const b2Fixture* feetFixture, const b2Fixture* oneWayFixture);
+  void recordContactEvent(b2Contact* contact, bool isBeginContact);
+  void dispatchContactEvent(const WorldContactListener::ContactEvent& event) const;
+
   b2Fixture* GetTargetFixture(short targetCategoryBits, b2Fixture* f1, b2Fixture* f2) const;
+
+  std::array<std::array<WorldContactListener::ContactHandlerEntry, _kNumCategories>, _kNumCategories>
+    _contactHandlers;
+  std::vector<WorldContactListener::ContactEvent> _contactEvents;
+
+  // The feet contacts with one-way fixtures which are currently disabled.
+  // Usually there're only a few of them, so PreSolve() is cheap.
+  FlatSet<b2Contact*> _passThroughContacts;
 };
 
 }  // namespace vigilante
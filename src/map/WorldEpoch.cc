@@ -0,0 +1,56 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "WorldEpoch.h"
+
+#include <atomic>
+
+#include "util/Logger.h"
+#include "util/MainThread.h"
+
+using std::atomic;
+
+namespace vigilante {
+
+namespace world_epoch {
+
+namespace {
+
+atomic<Epoch> epoch(0);
+
+}  // namespace
+
+Epoch current() {
+  return epoch.load(std::memory_order_acquire);
+}
+
+bool isCurrent(Epoch epoch) {
+  return current() == epoch;
+}
+
+bool isInTransition() {
+  return current() & 1;
+}
+
+
+void beginTransition() {
+  VGASSERT_MAIN_THREAD();
+
+  if (isInTransition()) {
+    VGLOG(LOG_WARN, "The world is already in transition.");
+    return;
+  }
+  epoch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void endTransition() {
+  VGASSERT_MAIN_THREAD();
+
+  if (!isInTransition()) {
+    VGLOG(LOG_WARN, "The world is not in transition.");
+    return;
+  }
+  epoch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+} // namespace world_epoch
+
+} // namespace vigilante
@@ -0,0 +1,34 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_WORLD_EPOCH_H_
+#define VIGILANTE_WORLD_EPOCH_H_
+
+#include <cstdint>
+
+namespace vigilante {
+
+// The world epoch is advanced twice per GameMap transition: once when the
+// transition begins, and once when the new GameMap has been loaded. While it
+// is odd, the world is in transition and NPCs must not act.
+//
+// Deferred work (e.g., the callbacks scheduled by NPCs) captures the epoch
+// when it's created, and is dropped if the epoch has advanced since then,
+// so a transition doesn't have to wait for such work to finish.
+//
+// The epoch can be read from any thread, but it can only be advanced
+// on the main thread.
+namespace world_epoch {
+
+using Epoch = uint32_t;
+
+Epoch current();
+bool isCurrent(Epoch epoch);
+bool isInTransition();
+
+void beginTransition();
+void endTransition();
+
+} // namespace world_epoch
+
+} // namespace vigilante
+
+#endif // VIGILANTE_WORLD_EPOCH_H_
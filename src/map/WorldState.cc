@@ -0,0 +1,114 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "WorldState.h"
+
+#include "util/ds/BinaryStream.h"
+
+using std::string;
+using std::vector;
+
+namespace vigilante {
+
+namespace {
+
+void writeIndices(BinaryWriter& writer, const FlatSet<int>& indices) {
+  writer.write<uint32_t>(indices.size());
+  for (const auto index : indices) {
+    writer.write<int32_t>(index);
+  }
+}
+
+void readIndices(BinaryReader& reader, FlatSet<int>& indices) {
+  indices.clear();
+  for (uint32_t i = 0, count = reader.readCount(); i < count; i++) {
+    indices.insert(reader.read<int32_t>());
+  }
+}
+
+}  // namespace
+
+WorldState* WorldState::getInstance() {
+  static WorldState instance;
+  return &instance;
+}
+
+WorldState::WorldState() : _mapStates() {}
+
+
+bool WorldState::isChestOpened(AssetId tmxMapId, int chestIndex) const {
+  const MapState* mapState = getMapState(tmxMapId);
+  return mapState && mapState->openedChests.contains(chestIndex);
+}
+
+void WorldState::setChestOpened(AssetId tmxMapId, int chestIndex) {
+  MapState& mapState = getOrCreateMapState(tmxMapId);
+  mapState.openedChests.insert(chestIndex);
+  mapState.isDirty = true;
+}
+
+bool WorldState::hasTriggered(AssetId tmxMapId, int triggerIndex) const {
+  const MapState* mapState = getMapState(tmxMapId);
+  return mapState && mapState->triggeredTriggers.contains(triggerIndex);
+}
+
+void WorldState::setTriggered(AssetId tmxMapId, int triggerIndex) {
+  MapState& mapState = getOrCreateMapState(tmxMapId);
+  mapState.triggeredTriggers.insert(triggerIndex);
+  mapState.isDirty = true;
+}
+
+
+vector<AssetId> WorldState::getChangedMaps() const {
+  vector<AssetId> tmxMapIds;
+  tmxMapIds.reserve(_mapStates.size());
+  for (const auto& p : _mapStates) {
+    tmxMapIds.push_back(p.first);
+  }
+  return tmxMapIds;
+}
+
+const string& WorldState::getChunk(AssetId tmxMapId) {
+  MapState& mapState = getOrCreateMapState(tmxMapId);
+  if (mapState.isDirty) {
+    BinaryWriter writer;
+    writeIndices(writer, mapState.openedChests);
+    writeIndices(writer, mapState.triggeredTriggers);
+    mapState.chunk = writer.getBuffer();
+    mapState.isDirty = false;
+  }
+  return mapState.chunk;
+}
+
+bool WorldState::restoreChunk(AssetId tmxMapId, const string& chunk) {
+  MapState& mapState = getOrCreateMapState(tmxMapId);
+  BinaryReader reader(chunk.data(), chunk.data() + chunk.size());
+  readIndices(reader, mapState.openedChests);
+  readIndices(reader, mapState.triggeredTriggers);
+
+  if (!reader.isOk()) {
+    _mapStates.erase(tmxMapId);
+    return false;
+  }
+  mapState.chunk = chunk;
+  mapState.isDirty = false;
+  return true;
+}
+
+void WorldState::clear() {
+  _mapStates.clear();
+}
+
+
+const WorldState::MapState* WorldState::getMapState(AssetId tmxMapId) const {
+  auto it = _mapStates.find(tmxMapId);
+  return (it != _mapStates.end()) ? &it->second : nullptr;
+}
+
+WorldState::MapState& WorldState::getOrCreateMapState(AssetId tmxMapId) {
+  auto it = _mapStates.find(tmxMapId);
+  if (it == _mapStates.end()) {
+    it = _mapStates.insert({tmxMapId, MapState{FlatSet<int>(), FlatSet<int>(), "", true}}).first;
+  }
+  return it->second;
+}
+
+}  // namespace vigilante
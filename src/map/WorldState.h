@@ -0,0 +1,63 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_WORLD_STATE_H_
+#define VIGILANTE_WORLD_STATE_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "util/AssetId.h"
+#include "util/ds/FlatSet.h"
+
+namespace vigilante {
+
+// The per-map world state which outlives the GameMaps, i.e., the chests
+// which have been opened and the once-only triggers which have been triggered.
+//
+// Only the changes relative to the initial state of each .tmx map are
+// recorded, and the objects are referred to by their indices in the map's
+// GameMapSpec (e.g., GameMapSpec::chests), which are fixed by the .tmx file.
+// The changes of each map are encoded into a chunk for GameState, which is
+// only re-encoded after that map has changed, so saving the game costs time
+// and space proportional to the player's progress instead of the world size.
+//
+// The portals' lock states and the npc spawning blacklist live in
+// GameMap::Portal and Npc respectively.
+// All methods must be called on the main thread.
+class WorldState final {
+ public:
+  static WorldState* getInstance();
+
+  bool isChestOpened(AssetId tmxMapId, int chestIndex) const;
+  void setChestOpened(AssetId tmxMapId, int chestIndex);
+
+  bool hasTriggered(AssetId tmxMapId, int triggerIndex) const;
+  void setTriggered(AssetId tmxMapId, int triggerIndex);
+
+  // The maps which have been changed, and their encoded chunks.
+  std::vector<AssetId> getChangedMaps() const;
+  const std::string& getChunk(AssetId tmxMapId);
+  // Returns false if `chunk` is corrupted.
+  bool restoreChunk(AssetId tmxMapId, const std::string& chunk);
+
+  void clear();
+
+ private:
+  struct MapState final {
+    FlatSet<int> openedChests;
+    FlatSet<int> triggeredTriggers;
+    std::string chunk;
+    bool isDirty;  // whether `chunk` is out of date
+  };
+
+  WorldState();
+
+  const WorldState::MapState* getMapState(AssetId tmxMapId) const;
+  WorldState::MapState& getOrCreateMapState(AssetId tmxMapId);
+
+  std::unordered_map<AssetId, WorldState::MapState> _mapStates;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_WORLD_STATE_H_
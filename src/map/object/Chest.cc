@@ -4,6 +4,7 @@
 #include "Constants.h"
 #include "map/FxManager.h"
 #include "map/GameMapManager.h"
+#include "map/WorldState.h"
 #include "ui/control_hints/ControlHints.h"
 #include "util/box2d/b2BodyBuilder.h"
 #include "util/JsonUtil.h"
@@ -15,6 +16,7 @@
 #define ITEM_CATEGORY_BITS kInteractable
 #define ITEM_MASK_BITS kGround | kPlatform | kWall
 
+using std::pair;
 using std::string;
 using std::vector;
 using cocos2d::Sprite;
@@ -32,12 +34,19 @@ Chest::Chest()
     : DynamicActor(CHEST_NUM_ANIMATIONS, CHEST_NUM_FIXTURES),
       _hintBubbleFxSprite(), 
       _itemJsons(),
-      _isOpened() {}
+      _isOpened(),
+      _tmxMapId(),
+      _index(-1) {}
 
 Chest::Chest(const string& itemJsons) : Chest() {
   _itemJsons = string_util::split(itemJsons);
 }
 
+Chest::Chest(const vector<string>& itemJsons, bool isOpened) : Chest() {
+  _itemJsons = itemJsons;
+  _isOpened = isOpened;
+}
+
 
 bool Chest::showOnMap(float x, float y) {
   if (_isShownOnMap) {
@@ -52,10 +61,10 @@ bool Chest::showOnMap(float x, float y) {
              ITEM_CATEGORY_BITS,
              ITEM_MASK_BITS);
 
-  _bodySprite = Sprite::create("Texture/interactable_object/chest/chest_close.png");
+  _bodySprite = Sprite::create((_isOpened) ? "Texture/interactable_object/chest/chest_open.png"
+                                           : "Texture/interactable_object/chest/chest_close.png");
   _bodySprite->getTexture()->setAliasTexParameters();
-  GameMapManager::getInstance()->getLayer()->addChild(_bodySprite,
-                                                      graphical_layers::kChest);
+  GameMapManager::getInstance()->getRenderBuckets()->get(graphical_layers::kChest)->addChild(_bodySprite);
   return true;
 }
 
@@ -91,21 +100,47 @@ void Chest::onInteract(Character*) {
   }
   _isOpened = true;
 
+  if (_index >= 0) {
+    WorldState::getInstance()->setChestOpened(_tmxMapId, _index);
+  }
+
   _bodySprite->setTexture("Texture/interactable_object/chest/chest_open.png");
   _bodySprite->getTexture()->setAliasTexParameters();
 
-  for (const auto& item : _itemJsons) {
-    float x = _body->GetPosition().x;
-    float y = _body->GetPosition().y;
-    GameMapManager::getInstance()->getGameMap()->createItem(item, x * kPpm, y * kPpm);
+  vector<pair<string, int>> items;
+  items.reserve(_itemJsons.size());
+  for (const auto& itemJson : _itemJsons) {
+    items.push_back({itemJson, 1});
   }
   _itemJsons.clear();
+
+  float x = _body->GetPosition().x;
+  float y = _body->GetPosition().y;
+  GameMapManager::getInstance()->getGameMap()->createItems(items, x * kPpm, y * kPpm);
 }
 
 bool Chest::willInteractOnContact() const {
   return false;
 }
 
+void Chest::bind(AssetId tmxMapId, int chestIndex) {
+  _tmxMapId = tmxMapId;
+  _index = chestIndex;
+}
+
+const vector<string>& Chest::getItemJsons() const {
+  return _itemJsons;
+}
+
+bool Chest::isOpened() const {
+  return _isOpened;
+}
+
+int Chest::getIndex() const {
+  return _index;
+}
+
+
 void Chest::showHintUI() {
   if (_isOpened) {
     return;
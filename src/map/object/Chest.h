@@ -8,6 +8,7 @@
 #include <cocos2d.h>
 #include "DynamicActor.h"
 #include "Interactable.h"
+#include "util/AssetId.h"
 
 namespace vigilante {
 
@@ -15,6 +16,7 @@ class Chest : public DynamicActor, public Interactable {
  public:
   Chest();
   explicit Chest(const std::string& itemsJson);
+  Chest(const std::vector<std::string>& itemJsons, bool isOpened);
   virtual ~Chest() = default;
 
   virtual bool showOnMap(float x, float y) override;  // DynamicActor
@@ -24,6 +26,14 @@ class Chest : public DynamicActor, public Interactable {
   virtual void showHintUI() override;  // Interactable
   virtual void hideHintUI() override;  // Interactable
 
+  // Binds this chest to GameMapSpec::chests[chestIndex] of the map,
+  // so that opening it will be recorded in WorldState.
+  void bind(AssetId tmxMapId, int chestIndex);
+
+  const std::vector<std::string>& getItemJsons() const;
+  bool isOpened() const;
+  int getIndex() const;
+
  protected:
   virtual void createHintBubbleFx() override;  // Interactable
   virtual void removeHintBubbleFx() override;  // Interactable
@@ -38,6 +48,9 @@ class Chest : public DynamicActor, public Interactable {
 
   std::vector<std::string> _itemJsons;
   bool _isOpened;
+
+  AssetId _tmxMapId;
+  int _index;  // -1 if unbound
 };
 
 }  // namespace vigilante
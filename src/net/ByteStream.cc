@@ -0,0 +1,98 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ByteStream.h"
+
+#include <algorithm>
+
+#define MAX_VARINT_BYTES 5  // of a 32-bit integer
+#define MAX_STRING_SIZE 255
+
+using std::string;
+using std::vector;
+
+namespace vigilante {
+
+ByteWriter::ByteWriter() : _bytes() {}
+
+void ByteWriter::writeU8(uint8_t value) {
+  _bytes.push_back(value);
+}
+
+void ByteWriter::writeVarUint(uint32_t value) {
+  while (value >= 0x80) {
+    _bytes.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  _bytes.push_back(static_cast<uint8_t>(value));
+}
+
+void ByteWriter::writeVarInt(int32_t value) {
+  writeVarUint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+}
+
+void ByteWriter::writeString(const string& s) {
+  const size_t size = std::min<size_t>(s.size(), MAX_STRING_SIZE);
+  writeU8(static_cast<uint8_t>(size));
+  _bytes.insert(_bytes.end(), s.begin(), s.begin() + size);
+}
+
+void ByteWriter::clear() {
+  _bytes.clear();
+}
+
+const vector<uint8_t>& ByteWriter::getBytes() const {
+  return _bytes;
+}
+
+
+ByteReader::ByteReader(const uint8_t* data, size_t size)
+    : _data(data),
+      _size(size),
+      _offset(),
+      _isOk(true) {}
+
+uint8_t ByteReader::readU8() {
+  if (!_isOk || _offset >= _size) {
+    _isOk = false;
+    return 0;
+  }
+  return _data[_offset++];
+}
+
+uint32_t ByteReader::readVarUint() {
+  uint32_t value = 0;
+  for (int i = 0; i < MAX_VARINT_BYTES; i++) {
+    const uint8_t byte = readU8();
+    value |= static_cast<uint32_t>(byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  _isOk = false;
+  return 0;
+}
+
+int32_t ByteReader::readVarInt() {
+  const uint32_t value = readVarUint();
+  return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+string ByteReader::readString() {
+  const size_t size = readU8();
+  if (!_isOk || _offset + size > _size) {
+    _isOk = false;
+    return "";
+  }
+  string s(reinterpret_cast<const char*>(_data + _offset), size);
+  _offset += size;
+  return s;
+}
+
+bool ByteReader::isOk() const {
+  return _isOk;
+}
+
+bool ByteReader::isAtEnd() const {
+  return _offset == _size;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,56 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_BYTE_STREAM_H_
+#define VIGILANTE_BYTE_STREAM_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vigilante {
+
+// The packets of the co-op session (see CoopSession) are written and read
+// with these. Integers are written as varints (7 bits per byte, so that the
+// small deltas of a snapshot take a single byte), and the signed ones are
+// zigzag-encoded first, so -1 takes one byte as well.
+class ByteWriter final {
+ public:
+  ByteWriter();
+
+  void writeU8(uint8_t value);
+  void writeVarUint(uint32_t value);
+  void writeVarInt(int32_t value);
+  void writeString(const std::string& s);
+
+  void clear();
+  const std::vector<uint8_t>& getBytes() const;
+
+ private:
+  std::vector<uint8_t> _bytes;
+};
+
+
+// A reader which has run past the end (or read a malformed varint)
+// fails all subsequent reads, so that a truncated packet can be checked
+// once with isOk() at the end instead of after each read.
+class ByteReader final {
+ public:
+  ByteReader(const uint8_t* data, size_t size);
+
+  uint8_t readU8();
+  uint32_t readVarUint();
+  int32_t readVarInt();
+  std::string readString();
+
+  bool isOk() const;
+  bool isAtEnd() const;
+
+ private:
+  const uint8_t* _data;
+  size_t _size;
+  size_t _offset;
+  bool _isOk;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_BYTE_STREAM_H_
@@ -0,0 +1,670 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "CoopSession.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Constants.h"
+#include "character/Npc.h"
+#include "character/Player.h"
+#include "input/InputManager.h"
+#include "map/GameMapManager.h"
+#include "util/Logger.h"
+#include "util/MainThread.h"
+#include "util/TraceProfiler.h"
+
+#define MAX_RENDER_TICK_DRIFT 4  // in ticks, beyond which the render time is resynced
+
+using std::string;
+using std::shared_ptr;
+using std::unordered_map;
+
+namespace vigilante {
+
+namespace {
+
+inline uint16_t toBit(InputManager::Action action) {
+  return static_cast<uint16_t>(1 << static_cast<int>(action));
+}
+
+}  // namespace
+
+const uint16_t CoopSession::kDefaultPort = 7777;
+const float CoopSession::_kTickInterval = 1.0f / 20;
+const float CoopSession::_kInterpolationDelay = .1f;
+const float CoopSession::_kHelloInterval = .5f;
+const float CoopSession::_kTimeout = 5.0f;
+const size_t CoopSession::_kMaxPacketSize;
+const size_t CoopSession::_kNumSnapshots;
+const size_t CoopSession::_kNumResentInputs;
+
+CoopSession* CoopSession::getInstance() {
+  static CoopSession instance;
+  return &instance;
+}
+
+CoopSession::CoopSession()
+    : _role(Role::NONE),
+      _socket(),
+      _peer(),
+      _isConnected(),
+      _tickTimer(),
+      _helloTimer(),
+      _timeSinceReceived(),
+      _statsTimer(),
+      _numBytesSent(),
+      _numBytesReceived(),
+      _uploadRate(),
+      _downloadRate(),
+      _snapshots(),
+      _tick(),
+      _ackedTick(),
+      _netIds(),
+      _nextNetId(1),
+      _snapshotMapFileName(),
+      _remoteAlly(),
+      _remoteHeldActions(),
+      _remotePressedActions(),
+      _lastInputSeq(),
+      _heldActions(),
+      _pressedActions(),
+      _inputSeq(),
+      _sentInputs(),
+      _renderTick(),
+      _isLoadingGameMap(),
+      _replicas() {}
+
+
+bool CoopSession::host(uint16_t port) {
+  VGASSERT_MAIN_THREAD();
+  stop();
+
+  if (!_socket.open(port)) {
+    return false;
+  }
+  _role = Role::HOST;
+  VGLOG(LOG_INFO, "Hosting a co-op session on port %u", port);
+  return true;
+}
+
+bool CoopSession::join(const string& host, uint16_t port) {
+  VGASSERT_MAIN_THREAD();
+  stop();
+
+  if (!UdpSocket::resolve(host, port, &_peer) || !_socket.open(0)) {
+    return false;
+  }
+  _role = Role::CLIENT;
+  VGLOG(LOG_INFO, "Joining the co-op session hosted by %s", UdpSocket::toString(_peer).c_str());
+  return true;
+}
+
+void CoopSession::stop() {
+  VGASSERT_MAIN_THREAD();
+  if (_role == Role::NONE) {
+    return;
+  }
+
+  if (_isConnected) {
+    ByteWriter writer;
+    writer.writeU8(PacketType::BYE);
+    send(writer);
+  }
+
+  if (_role == Role::HOST) {
+    onPeerLeft();
+  } else {
+    clearReplicas();
+    Player* player = GameMapManager::getInstance()->getPlayer();
+    if (player && player->getBody()) {
+      player->getBody()->SetActive(true);
+    }
+  }
+
+  _socket.close();
+  _role = Role::NONE;
+  _isConnected = false;
+  _tickTimer = 0;
+  _helloTimer = 0;
+  _timeSinceReceived = 0;
+  _uploadRate = 0;
+  _downloadRate = 0;
+  _snapshots.fill(Snapshot());
+  _tick = 0;
+  _ackedTick = 0;
+  _netIds.clear();
+  _snapshotMapFileName.clear();
+  _heldActions = 0;
+  _pressedActions = 0;
+  _inputSeq = 0;
+  _sentInputs.fill({0, 0});
+  _isLoadingGameMap = false;
+  VGLOG(LOG_INFO, "The co-op session has ended");
+}
+
+
+void CoopSession::update(float delta) {
+  VGTRACE_ZONE("CoopSession::update");
+  if (_role == Role::NONE) {
+    return;
+  }
+
+  _timeSinceReceived += delta;
+  receive();
+  if (_role == Role::NONE) {
+    return;  // stopped by the host
+  }
+
+  if (_isConnected && _timeSinceReceived > _kTimeout) {
+    VGLOG(LOG_WARN, "The co-op peer has timed out");
+    if (_role == Role::HOST) {
+      onPeerLeft();
+    } else {
+      stop();
+      return;
+    }
+  }
+
+  _statsTimer += delta;
+  if (_statsTimer >= 1.0f) {
+    _uploadRate = _numBytesSent / _statsTimer;
+    _downloadRate = _numBytesReceived / _statsTimer;
+    _numBytesSent = 0;
+    _numBytesReceived = 0;
+    _statsTimer = 0;
+  }
+
+  // A long frame doesn't make up for the ticks it has missed.
+  _tickTimer += delta;
+  const bool isTick = _tickTimer >= _kTickInterval;
+  if (isTick) {
+    _tickTimer = std::min(_tickTimer - _kTickInterval, _kTickInterval);
+  }
+
+  if (_role == Role::HOST) {
+    applyRemoteInput();
+    if (isTick) {
+      sendSnapshot();
+    }
+    return;
+  }
+
+  captureInput();
+  if (!_isConnected) {
+    _helloTimer -= delta;
+    if (_helloTimer <= 0) {
+      _helloTimer = _kHelloInterval;
+      ByteWriter writer;
+      writer.writeU8(PacketType::HELLO);
+      send(writer);
+    }
+    return;
+  }
+  if (isTick) {
+    sendInput();
+  }
+  interpolate(delta);
+}
+
+
+CoopSession::Role CoopSession::getRole() const {
+  return _role;
+}
+
+bool CoopSession::isHost() const {
+  return _role == Role::HOST;
+}
+
+bool CoopSession::isClient() const {
+  return _role == Role::CLIENT;
+}
+
+bool CoopSession::isConnected() const {
+  return _isConnected;
+}
+
+float CoopSession::getUploadRate() const {
+  return _uploadRate;
+}
+
+float CoopSession::getDownloadRate() const {
+  return _downloadRate;
+}
+
+
+void CoopSession::receive() {
+  uint8_t buf[_kMaxPacketSize];
+  UdpSocket::Address from;
+  size_t size = 0;
+
+  while (_role != Role::NONE && (size = _socket.receiveFrom(&from, buf, sizeof(buf))) > 0) {
+    if ((_role == Role::CLIENT || _isConnected) && from != _peer) {
+      continue;
+    }
+
+    ByteReader reader(buf, size);
+    const uint8_t type = reader.readU8();
+    if (type == PacketType::HELLO && _role == Role::HOST && !_isConnected) {
+      _peer = from;
+      _isConnected = true;
+      _ackedTick = 0;
+      _lastInputSeq = 0;
+      VGLOG(LOG_INFO, "A co-op client has joined from %s", UdpSocket::toString(from).c_str());
+    } else if (type == PacketType::SNAPSHOT && _role == Role::CLIENT) {
+      onSnapshotReceived(reader);
+    } else if (type == PacketType::INPUT && _role == Role::HOST && _isConnected) {
+      onInputReceived(reader);
+    } else if (type == PacketType::BYE && _isConnected) {
+      VGLOG(LOG_INFO, "The co-op peer has left");
+      if (_role == Role::HOST) {
+        onPeerLeft();
+        continue;
+      }
+      _isConnected = false;  // there's no one to say bye to
+      stop();
+      return;
+    } else {
+      continue;
+    }
+
+    _numBytesReceived += size;
+    _timeSinceReceived = 0;
+  }
+}
+
+void CoopSession::send(const ByteWriter& writer) {
+  const auto& bytes = writer.getBytes();
+  if (_socket.sendTo(_peer, bytes.data(), bytes.size())) {
+    _numBytesSent += bytes.size();
+  }
+}
+
+void CoopSession::onSnapshotReceived(ByteReader& reader) {
+  // Peek at the baseline which the snapshot has been encoded against.
+  ByteReader header = reader;
+  const uint32_t tick = header.readVarUint();
+  const uint32_t baselineTick = header.readVarUint();
+  if (!header.isOk() || getSnapshot(tick) ||
+      (_tick >= _kNumSnapshots && tick <= _tick - _kNumSnapshots)) {
+    return;  // a duplicate, or too late to be of any use
+  }
+
+  Snapshot snapshot;
+  if (!snapshot.decode((baselineTick != 0) ? getSnapshot(baselineTick) : nullptr, reader)) {
+    return;  // the baseline is gone, so wait for the next one
+  }
+  _snapshots[tick % _kNumSnapshots] = std::move(snapshot);
+  _tick = std::max(_tick, tick);
+
+  if (!_isConnected) {
+    _isConnected = true;
+    _renderTick = _tick - _kInterpolationDelay / _kTickInterval;
+    VGLOG(LOG_INFO, "Joined the co-op session");
+  }
+}
+
+void CoopSession::onInputReceived(ByteReader& reader) {
+  const uint32_t ackedTick = reader.readVarUint();
+  const uint16_t heldActions = static_cast<uint16_t>(reader.readVarUint());
+  const uint8_t numInputs = reader.readU8();
+  if (numInputs > _kNumResentInputs) {
+    return;
+  }
+
+  std::array<InputFrame, _kNumResentInputs> inputs;
+  for (uint8_t i = 0; i < numInputs; i++) {
+    inputs[i].seq = reader.readVarUint();
+    inputs[i].pressedActions = static_cast<uint16_t>(reader.readVarUint());
+  }
+  if (!reader.isOk()) {
+    return;
+  }
+
+  if (ackedTick > _ackedTick && ackedTick <= _tick) {
+    _ackedTick = ackedTick;
+  }
+
+  // The inputs are sent oldest first, and each one is applied only once.
+  for (uint8_t i = 0; i < numInputs; i++) {
+    if (inputs[i].seq > _lastInputSeq) {
+      _remotePressedActions |= inputs[i].pressedActions;
+      _remoteHeldActions = heldActions;
+      _lastInputSeq = inputs[i].seq;
+    }
+  }
+}
+
+void CoopSession::onPeerLeft() {
+  _isConnected = false;
+  _ackedTick = 0;
+  _remoteHeldActions = 0;
+  _remotePressedActions = 0;
+  if (shared_ptr<Npc> ally = _remoteAlly.lock()) {
+    ally->setRemoteControlled(false);
+  }
+  _remoteAlly.reset();
+}
+
+
+void CoopSession::takeSnapshot(Snapshot& snapshot) {
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  snapshot.tmxMapFileName = gmMgr->getGameMap()->getTmxTiledMapFileName();
+  snapshot.actors.clear();
+
+  unordered_map<const Character*, uint32_t> netIds;
+  auto addActor = [this, &snapshot, &netIds](Character* character, Snapshot::Kind kind) {
+    if (character->isKilled() || !character->getBody()) {
+      return;
+    }
+
+    auto it = _netIds.find(character);
+    const uint32_t netId = (it != _netIds.end()) ? it->second : _nextNetId++;
+    netIds.insert({character, netId});
+
+    const b2Vec2& position = character->getBody()->GetPosition();
+    const b2Vec2& velocity = character->getBody()->GetLinearVelocity();
+    Snapshot::ActorState state;
+    state.netId = netId;
+    state.kind = kind;
+    state.jsonFileName = character->getCharacterProfile().jsonFileName;
+    state.x = Snapshot::quantizePosition(position.x);
+    state.y = Snapshot::quantizePosition(position.y);
+    state.vx = Snapshot::quantizeVelocity(velocity.x);
+    state.vy = Snapshot::quantizeVelocity(velocity.y);
+    state.flags = (character->isFacingRight() ? Snapshot::Flag::FACING_RIGHT : 0) |
+                  (character->isJumping() ? Snapshot::Flag::JUMPING : 0) |
+                  (character->isCrouching() ? Snapshot::Flag::CROUCHING : 0) |
+                  (character->isAttacking() ? Snapshot::Flag::ATTACKING : 0) |
+                  (character->isWeaponSheathed() ? Snapshot::Flag::WEAPON_SHEATHED : 0);
+    state.health = character->getStat(StatsSystem::Stat::HEALTH);
+    snapshot.actors.push_back(std::move(state));
+  };
+
+  addActor(gmMgr->getPlayer(), Snapshot::Kind::PLAYER);
+  const auto& npcs = gmMgr->getGameMap()->getDynamicActors().getGroup(ActorRegistry::Group::NPC);
+  for (const auto& actor : npcs) {
+    addActor(static_cast<Npc*>(actor.get()), Snapshot::Kind::NPC);
+  }
+  std::sort(snapshot.actors.begin(), snapshot.actors.end(),
+            [](const Snapshot::ActorState& a, const Snapshot::ActorState& b) { return a.netId < b.netId; });
+
+  // The characters which are no longer shown lose their netIds.
+  _netIds.swap(netIds);
+
+  shared_ptr<Npc> ally = _remoteAlly.lock();
+  auto it = (ally) ? _netIds.find(ally.get()) : _netIds.end();
+  snapshot.controlledNetId = (it != _netIds.end()) ? it->second : 0;
+}
+
+shared_ptr<Npc> CoopSession::getRemoteAlly() const {
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  if (!_isConnected || !player) {
+    return nullptr;
+  }
+
+  // The first member of the party, in the order they've been recruited.
+  const shared_ptr<Party> party = player->getParty();
+  for (auto member : party->getLeaderAndMembers()) {
+    if (member == player || !dynamic_cast<Npc*>(member)) {
+      continue;
+    }
+    for (const auto& m : party->getMembers()) {
+      if (m.get() == member) {
+        return std::static_pointer_cast<Npc>(m);
+      }
+    }
+  }
+  return nullptr;
+}
+
+void CoopSession::applyRemoteInput() {
+  shared_ptr<Npc> ally = getRemoteAlly();
+  shared_ptr<Npc> previousAlly = _remoteAlly.lock();
+  if (ally != previousAlly) {
+    if (previousAlly) {
+      previousAlly->setRemoteControlled(false);
+    }
+    if (ally) {
+      ally->setRemoteControlled(true);
+    }
+    _remoteAlly = ally;
+  }
+
+  if (!ally || !ally->isShownOnMap() || ally->isSetToKill()) {
+    _remotePressedActions = 0;
+    return;
+  }
+
+  // Same as Player::handleInput(). The presses made while the ally is busy
+  // are kept until it's able to act again.
+  if (ally->isAttacking() || ally->isUsingSkill() ||
+      ally->isSheathingWeapon() || ally->isUnsheathingWeapon()) {
+    return;
+  }
+
+  auto isHeld = [this](InputManager::Action action) {
+    return (_remoteHeldActions & toBit(action)) != 0;
+  };
+  auto isPressed = [this](InputManager::Action action) {
+    return (_remotePressedActions & toBit(action)) != 0;
+  };
+
+  if (isHeld(InputManager::Action::CROUCH)) {
+    ally->crouch();
+  }
+
+  if (isPressed(InputManager::Action::ATTACK) && !ally->isWeaponSheathed()) {
+    ally->attack();
+  }
+
+  if (isHeld(InputManager::Action::MOVE_LEFT)) {
+    ally->moveLeft();
+  } else if (isHeld(InputManager::Action::MOVE_RIGHT)) {
+    ally->moveRight();
+  }
+
+  if (isPressed(InputManager::Action::SHEATHE_WEAPON)) {
+    if (ally->getEquipmentSlots()[Equipment::Type::WEAPON] && ally->isWeaponSheathed()) {
+      ally->unsheathWeapon();
+    } else if (!ally->isWeaponSheathed()) {
+      ally->sheathWeapon();
+    }
+  }
+
+  if (isPressed(InputManager::Action::JUMP)) {
+    if (ally->isCrouching()) {
+      ally->jumpDown();
+    } else {
+      ally->jump();
+    }
+  }
+
+  if (ally->isCrouching() && !isHeld(InputManager::Action::CROUCH)) {
+    ally->getUp();
+  }
+
+  _remotePressedActions = 0;
+}
+
+void CoopSession::sendSnapshot() {
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  if (!_isConnected || !gmMgr->getGameMap() || !gmMgr->getPlayer()) {
+    return;
+  }
+
+  // After the GameMap has changed, the client has to start over from a full snapshot.
+  const string& tmxMapFileName = gmMgr->getGameMap()->getTmxTiledMapFileName();
+  if (tmxMapFileName != _snapshotMapFileName) {
+    _snapshotMapFileName = tmxMapFileName;
+    _ackedTick = 0;
+    _netIds.clear();
+  }
+
+  _tick++;
+  Snapshot& snapshot = _snapshots[_tick % _kNumSnapshots];
+  snapshot.tick = _tick;
+  takeSnapshot(snapshot);
+
+  // The acknowledged snapshot may have been overwritten just now if it's too old.
+  const Snapshot* baseline = (_ackedTick != 0) ? getSnapshot(_ackedTick) : nullptr;
+  ByteWriter writer;
+  writer.writeU8(PacketType::SNAPSHOT);
+  snapshot.encode(baseline, writer);
+  if (writer.getBytes().size() > _kMaxPacketSize) {
+    VGLOG(LOG_WARN, "The co-op snapshot of tick %u takes %zu bytes", _tick, writer.getBytes().size());
+  }
+  send(writer);
+}
+
+
+void CoopSession::captureInput() {
+  const InputManager* inputManager = InputManager::getInstance();
+  _heldActions = 0;
+  for (int i = 0; i < static_cast<int>(InputManager::Action::SIZE); i++) {
+    const auto action = static_cast<InputManager::Action>(i);
+    if (inputManager->isActionPressed(action)) {
+      _heldActions |= toBit(action);
+    }
+    if (inputManager->isActionJustPressed(action)) {
+      _pressedActions |= toBit(action);
+    }
+  }
+}
+
+void CoopSession::sendInput() {
+  std::rotate(_sentInputs.begin(), _sentInputs.begin() + 1, _sentInputs.end());
+  _sentInputs.back() = {++_inputSeq, _pressedActions};
+  _pressedActions = 0;
+
+  ByteWriter writer;
+  writer.writeU8(PacketType::INPUT);
+  writer.writeVarUint(_tick);  // the ack
+  writer.writeVarUint(_heldActions);
+  const uint8_t numInputs = static_cast<uint8_t>(std::min<size_t>(_inputSeq, _kNumResentInputs));
+  writer.writeU8(numInputs);
+  for (size_t i = _kNumResentInputs - numInputs; i < _kNumResentInputs; i++) {
+    writer.writeVarUint(_sentInputs[i].seq);
+    writer.writeVarUint(_sentInputs[i].pressedActions);
+  }
+  send(writer);
+}
+
+void CoopSession::interpolate(float delta) {
+  const Snapshot* latest = getSnapshot(_tick);
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  GameMap* gameMap = gmMgr->getGameMap();
+  if (!latest || _isLoadingGameMap) {
+    return;
+  }
+
+  // Follow the host to its GameMap.
+  if (!gameMap || gameMap->getTmxTiledMapFileName() != latest->tmxMapFileName) {
+    clearReplicas();
+    _isLoadingGameMap = true;
+    gmMgr->loadGameMap(latest->tmxMapFileName, [this]() {
+      _isLoadingGameMap = false;
+    });
+    return;
+  }
+
+  _renderTick += delta / _kTickInterval;
+  const float targetTick = _tick - _kInterpolationDelay / _kTickInterval;
+  if (std::abs(_renderTick - targetTick) > MAX_RENDER_TICK_DRIFT) {
+    _renderTick = targetTick;
+  }
+
+  // The snapshots right before and after the render time.
+  const Snapshot* from = nullptr;
+  const Snapshot* to = nullptr;
+  for (int64_t t = static_cast<int64_t>(std::floor(_renderTick));
+       t > 0 && t + static_cast<int64_t>(_kNumSnapshots) > _tick && !from; t--) {
+    from = getSnapshot(static_cast<uint32_t>(t));
+  }
+  if (!from) {
+    from = latest;
+  }
+  for (uint32_t t = from->tick + 1; t <= _tick && !to; t++) {
+    to = getSnapshot(t);
+  }
+  const float alpha = (to) ? std::max(0.0f, std::min(1.0f, (_renderTick - from->tick) / (to->tick - from->tick)))
+                           : 0.0f;
+
+  for (const auto& state : from->actors) {
+    const Snapshot::ActorState* next = (to) ? to->find(state.netId) : nullptr;
+    Character* character = (state.netId == from->controlledNetId) ? gmMgr->getPlayer() : getReplica(state);
+    if (character) {
+      applyActorState(character, state, next, alpha);
+    }
+  }
+
+  for (auto it = _replicas.begin(); it != _replicas.end();) {
+    if (from->find(it->first)) {
+      ++it;
+      continue;
+    }
+    gameMap->removeDynamicActor(it->second.get());
+    it = _replicas.erase(it);
+  }
+}
+
+void CoopSession::applyActorState(Character* character, const Snapshot::ActorState& state,
+                                  const Snapshot::ActorState* next, float alpha) const {
+  b2Vec2 position{Snapshot::dequantizePosition(state.x), Snapshot::dequantizePosition(state.y)};
+  if (next) {
+    position.x += (Snapshot::dequantizePosition(next->x) - position.x) * alpha;
+    position.y += (Snapshot::dequantizePosition(next->y) - position.y) * alpha;
+  }
+  const b2Vec2 velocity{Snapshot::dequantizeVelocity(state.vx), Snapshot::dequantizeVelocity(state.vy)};
+
+  character->setReplicatedState(position, velocity,
+                                state.flags & Snapshot::Flag::FACING_RIGHT,
+                                state.flags & Snapshot::Flag::WEAPON_SHEATHED);
+  character->setJumping(state.flags & Snapshot::Flag::JUMPING);
+  character->setCrouching(state.flags & Snapshot::Flag::CROUCHING);
+  character->setAttacking(state.flags & Snapshot::Flag::ATTACKING);
+  if (character->getStat(StatsSystem::Stat::HEALTH) != state.health) {
+    character->setStat(StatsSystem::Stat::HEALTH, state.health);
+  }
+}
+
+Character* CoopSession::getReplica(const Snapshot::ActorState& state) {
+  auto it = _replicas.find(state.netId);
+  if (it != _replicas.end()) {
+    return it->second.get();
+  }
+
+  shared_ptr<Character> replica;
+  if (state.kind == Snapshot::Kind::PLAYER) {
+    replica = std::make_shared<Player>(state.jsonFileName);
+  } else {
+    auto npc = std::make_shared<Npc>(state.jsonFileName);
+    npc->setRemoteControlled(true);
+    replica = std::move(npc);
+  }
+
+  const float x = Snapshot::dequantizePosition(state.x) * kPpm;
+  const float y = Snapshot::dequantizePosition(state.y) * kPpm;
+  Character* shownReplica = GameMapManager::getInstance()->getGameMap()->showDynamicActor<Character>(replica, x, y);
+  if (shownReplica) {
+    _replicas.insert({state.netId, std::move(replica)});
+  }
+  return shownReplica;
+}
+
+void CoopSession::clearReplicas() {
+  GameMap* gameMap = GameMapManager::getInstance()->getGameMap();
+  for (const auto& p : _replicas) {
+    if (gameMap && gameMap->getDynamicActors().contains(p.second.get())) {
+      gameMap->removeDynamicActor(p.second.get());
+    }
+  }
+  _replicas.clear();
+}
+
+
+Snapshot* CoopSession::getSnapshot(uint32_t tick) {
+  Snapshot& snapshot = _snapshots[tick % _kNumSnapshots];
+  return (tick != 0 && snapshot.tick == tick) ? &snapshot : nullptr;
+}
+
+}  // namespace vigilante
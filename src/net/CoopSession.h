@@ -0,0 +1,158 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_COOP_SESSION_H_
+#define VIGILANTE_COOP_SESSION_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "net/Snapshot.h"
+#include "net/UdpSocket.h"
+
+namespace vigilante {
+
+// Forward declaration
+class Character;
+class Npc;
+
+// Two-player online co-op (see the "coop" console command), where the second
+// player controls the first ally in the host player's party.
+//
+// The host's simulation is authoritative. Every _kTickInterval, the host takes
+// a Snapshot of the characters on its GameMap and sends it to the client over
+// UDP, delta-compressed against the last snapshot acknowledged by the client
+// (or in full if there's none, e.g., after the GameMap has changed), so a tick
+// in which little has moved costs a few dozen bytes.
+//
+// The client doesn't simulate the characters at all. It loads the host's
+// GameMap without spawning its npcs, shows a replica of each character in the
+// snapshots, and moves them by interpolating between the two snapshots around
+// a render time which trails the latest one by _kInterpolationDelay. Its own
+// player stands in for the ally it controls.
+//
+// The client's input is captured by InputManager's actions as usual, and
+// sent to the host once per tick (along with the ack), where it's applied to
+// the ally instead of its AI. The presses of the last few ticks are resent
+// with each input, so that a lost datagram doesn't lose a jump or an attack.
+//
+// Not replicated (yet): the skills, the items, the dialogues and the quests
+// of the client, and the projectiles and the fx, which the client doesn't see.
+//
+// All methods must be called on the main thread.
+class CoopSession final {
+ public:
+  enum class Role {
+    NONE,
+    HOST,
+    CLIENT
+  };
+
+  static CoopSession* getInstance();
+
+  bool host(uint16_t port);
+  bool join(const std::string& host, uint16_t port);
+  void stop();
+
+  // Must be called each frame after the input has been captured and before
+  // the world is stepped (see GameScene::step()).
+  void update(float delta);
+
+  CoopSession::Role getRole() const;
+  bool isHost() const;
+  bool isClient() const;
+  bool isConnected() const;
+  // In bytes per second, averaged over the last second.
+  float getUploadRate() const;
+  float getDownloadRate() const;
+
+  static const uint16_t kDefaultPort;
+
+ private:
+  enum PacketType : uint8_t {
+    HELLO,
+    SNAPSHOT,
+    INPUT,
+    BYE
+  };
+
+  struct InputFrame final {
+    uint32_t seq;
+    uint16_t pressedActions;  // pressed since the previous input was sent
+  };
+
+  static const float _kTickInterval;
+  static const float _kInterpolationDelay;
+  static const float _kHelloInterval;
+  static const float _kTimeout;
+  static const size_t _kMaxPacketSize = 1200;  // below the typical MTU
+  static const size_t _kNumSnapshots = 32;  // kept by both ends, indexed by tick
+  static const size_t _kNumResentInputs = 3;
+
+  CoopSession();
+
+  void receive();
+  void send(const ByteWriter& writer);
+  void onSnapshotReceived(ByteReader& reader);
+  void onInputReceived(ByteReader& reader);
+  void onPeerLeft();
+
+  // Host.
+  void takeSnapshot(Snapshot& snapshot);
+  uint32_t getNetId(const Character* character);
+  std::shared_ptr<Npc> getRemoteAlly() const;
+  void applyRemoteInput();
+  void sendSnapshot();
+
+  // Client.
+  void captureInput();
+  void sendInput();
+  void interpolate(float delta);
+  void applyActorState(Character* character, const Snapshot::ActorState& state,
+                       const Snapshot::ActorState* next, float alpha) const;
+  Character* getReplica(const Snapshot::ActorState& state);
+  void clearReplicas();
+
+  Snapshot* getSnapshot(uint32_t tick);
+
+  CoopSession::Role _role;
+  UdpSocket _socket;
+  UdpSocket::Address _peer;
+  bool _isConnected;
+  float _tickTimer;
+  float _helloTimer;
+  float _timeSinceReceived;
+  float _statsTimer;
+  size_t _numBytesSent;
+  size_t _numBytesReceived;
+  float _uploadRate;
+  float _downloadRate;
+
+  // The snapshots sent by the host, or received by the client.
+  std::array<Snapshot, _kNumSnapshots> _snapshots;
+  uint32_t _tick;  // the latest snapshot
+  uint32_t _ackedTick;  // host: the last snapshot acknowledged, 0 if none
+
+  // Host.
+  std::unordered_map<const Character*, uint32_t> _netIds;
+  uint32_t _nextNetId;
+  std::string _snapshotMapFileName;
+  std::weak_ptr<Npc> _remoteAlly;
+  uint16_t _remoteHeldActions;
+  uint16_t _remotePressedActions;
+  uint32_t _lastInputSeq;
+
+  // Client.
+  uint16_t _heldActions;
+  uint16_t _pressedActions;
+  uint32_t _inputSeq;
+  std::array<CoopSession::InputFrame, _kNumResentInputs> _sentInputs;
+  float _renderTick;
+  bool _isLoadingGameMap;
+  std::unordered_map<uint32_t, std::shared_ptr<Character>> _replicas;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_COOP_SESSION_H_
@@ -0,0 +1,205 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define POSITION_SCALE 64.0f
+#define VELOCITY_SCALE 16.0f
+
+using std::string;
+
+namespace vigilante {
+
+namespace {
+
+// The fields of an ActorState which are written.
+enum Field : uint8_t {
+  SPAWN = 1 << 0,  // followed by the kind and the json file name
+  X = 1 << 1,
+  Y = 1 << 2,
+  VX = 1 << 3,
+  VY = 1 << 4,
+  FLAGS = 1 << 5,
+  HEALTH = 1 << 6
+};
+
+const Snapshot::ActorState kEmptyActorState{};
+
+}  // namespace
+
+int32_t Snapshot::quantizePosition(float meters) {
+  return static_cast<int32_t>(std::lround(meters * POSITION_SCALE));
+}
+
+float Snapshot::dequantizePosition(int32_t value) {
+  return value / POSITION_SCALE;
+}
+
+int32_t Snapshot::quantizeVelocity(float metersPerSecond) {
+  return static_cast<int32_t>(std::lround(metersPerSecond * VELOCITY_SCALE));
+}
+
+float Snapshot::dequantizeVelocity(int32_t value) {
+  return value / VELOCITY_SCALE;
+}
+
+
+void Snapshot::encode(const Snapshot* baseline, ByteWriter& writer) const {
+  writer.writeVarUint(tick);
+  writer.writeVarUint((baseline) ? baseline->tick : 0);
+  if (!baseline) {
+    writer.writeString(tmxMapFileName);
+  }
+  writer.writeVarUint(controlledNetId);
+
+  // The actors which have been removed since the baseline.
+  // Both lists are sorted by netId, so they're merged in one pass.
+  uint32_t numRemoved = 0;
+  if (baseline) {
+    auto it = actors.begin();
+    for (const auto& old : baseline->actors) {
+      while (it != actors.end() && it->netId < old.netId) {
+        ++it;
+      }
+      numRemoved += it == actors.end() || it->netId != old.netId;
+    }
+  }
+  writer.writeVarUint(numRemoved);
+  if (numRemoved > 0) {
+    auto it = actors.begin();
+    uint32_t previousNetId = 0;
+    for (const auto& old : baseline->actors) {
+      while (it != actors.end() && it->netId < old.netId) {
+        ++it;
+      }
+      if (it == actors.end() || it->netId != old.netId) {
+        writer.writeVarUint(old.netId - previousNetId);
+        previousNetId = old.netId;
+      }
+    }
+  }
+
+  // The actors which have changed (or spawned) since the baseline.
+  // The count isn't known until they've been compared, so they're
+  // written into a scratch writer first.
+  ByteWriter changes;
+  uint32_t numChanged = 0;
+  uint32_t previousNetId = 0;
+  for (const auto& actor : actors) {
+    const ActorState* old = (baseline) ? baseline->find(actor.netId) : nullptr;
+    const ActorState& base = (old) ? *old : kEmptyActorState;
+
+    uint8_t fields = (old) ? 0 : Field::SPAWN;
+    fields |= (actor.x != base.x) ? Field::X : 0;
+    fields |= (actor.y != base.y) ? Field::Y : 0;
+    fields |= (actor.vx != base.vx) ? Field::VX : 0;
+    fields |= (actor.vy != base.vy) ? Field::VY : 0;
+    fields |= (actor.flags != base.flags) ? Field::FLAGS : 0;
+    fields |= (actor.health != base.health) ? Field::HEALTH : 0;
+    if (fields == 0) {
+      continue;
+    }
+
+    changes.writeVarUint(actor.netId - previousNetId);
+    previousNetId = actor.netId;
+    changes.writeU8(fields);
+    if (fields & Field::SPAWN) {
+      changes.writeU8(actor.kind);
+      changes.writeString(actor.jsonFileName);
+    }
+    if (fields & Field::X) {
+      changes.writeVarInt(actor.x - base.x);
+    }
+    if (fields & Field::Y) {
+      changes.writeVarInt(actor.y - base.y);
+    }
+    if (fields & Field::VX) {
+      changes.writeVarInt(actor.vx - base.vx);
+    }
+    if (fields & Field::VY) {
+      changes.writeVarInt(actor.vy - base.vy);
+    }
+    if (fields & Field::FLAGS) {
+      changes.writeU8(actor.flags);
+    }
+    if (fields & Field::HEALTH) {
+      changes.writeVarInt(actor.health - base.health);
+    }
+    numChanged++;
+  }
+
+  writer.writeVarUint(numChanged);
+  for (auto byte : changes.getBytes()) {
+    writer.writeU8(byte);
+  }
+}
+
+bool Snapshot::decode(const Snapshot* baseline, ByteReader& reader) {
+  tick = reader.readVarUint();
+  const uint32_t baselineTick = reader.readVarUint();
+  if (baselineTick != 0 && (!baseline || baseline->tick != baselineTick)) {
+    return false;
+  }
+  if (baselineTick == 0) {
+    baseline = nullptr;
+    tmxMapFileName = reader.readString();
+  } else {
+    tmxMapFileName = baseline->tmxMapFileName;
+  }
+  controlledNetId = reader.readVarUint();
+
+  // Start from the baseline without the removed actors.
+  actors.clear();
+  if (baseline) {
+    actors = baseline->actors;
+  }
+  const uint32_t numRemoved = reader.readVarUint();
+  uint32_t netId = 0;
+  for (uint32_t i = 0; i < numRemoved && reader.isOk(); i++) {
+    netId += reader.readVarUint();
+    const auto it = std::lower_bound(actors.begin(), actors.end(), netId,
+                                     [](const ActorState& a, uint32_t id) { return a.netId < id; });
+    if (it != actors.end() && it->netId == netId) {
+      actors.erase(it);
+    }
+  }
+
+  const uint32_t numChanged = reader.readVarUint();
+  netId = 0;
+  for (uint32_t i = 0; i < numChanged && reader.isOk(); i++) {
+    netId += reader.readVarUint();
+    const uint8_t fields = reader.readU8();
+
+    auto it = std::lower_bound(actors.begin(), actors.end(), netId,
+                               [](const ActorState& a, uint32_t id) { return a.netId < id; });
+    if (fields & Field::SPAWN) {
+      ActorState actor{};
+      actor.netId = netId;
+      actor.kind = static_cast<Kind>(reader.readU8());
+      actor.jsonFileName = reader.readString();
+      // A netId may be reused by another actor, in which case it's respawned.
+      it = (it != actors.end() && it->netId == netId) ? actors.erase(it) : it;
+      it = actors.insert(it, std::move(actor));
+    } else if (it == actors.end() || it->netId != netId) {
+      return false;
+    }
+
+    ActorState& actor = *it;
+    actor.x += (fields & Field::X) ? reader.readVarInt() : 0;
+    actor.y += (fields & Field::Y) ? reader.readVarInt() : 0;
+    actor.vx += (fields & Field::VX) ? reader.readVarInt() : 0;
+    actor.vy += (fields & Field::VY) ? reader.readVarInt() : 0;
+    actor.flags = (fields & Field::FLAGS) ? reader.readU8() : actor.flags;
+    actor.health += (fields & Field::HEALTH) ? reader.readVarInt() : 0;
+  }
+  return reader.isOk();
+}
+
+const Snapshot::ActorState* Snapshot::find(uint32_t netId) const {
+  const auto it = std::lower_bound(actors.begin(), actors.end(), netId,
+                                   [](const ActorState& a, uint32_t id) { return a.netId < id; });
+  return (it != actors.end() && it->netId == netId) ? &*it : nullptr;
+}
+
+}  // namespace vigilante
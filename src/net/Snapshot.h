@@ -0,0 +1,68 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_SNAPSHOT_H_
+#define VIGILANTE_SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "net/ByteStream.h"
+
+namespace vigilante {
+
+// The state of the characters on the host's GameMap at a tick of the co-op
+// session (see CoopSession).
+//
+// The values are kept quantized (positions in 1/64 m, velocities in
+// 1/16 m/s), so that the host and the client hold bit-identical copies
+// of a snapshot, which is what the delta compression relies on: a snapshot
+// is encoded against the last one acknowledged by the client, and only
+// the fields which have changed since then are written, as varint deltas.
+// The characters which haven't changed at all aren't written.
+struct Snapshot final {
+  enum Flag : uint8_t {
+    FACING_RIGHT = 1 << 0,
+    JUMPING = 1 << 1,
+    CROUCHING = 1 << 2,
+    ATTACKING = 1 << 3,
+    WEAPON_SHEATHED = 1 << 4
+  };
+
+  enum Kind : uint8_t {
+    NPC,
+    PLAYER
+  };
+
+  struct ActorState final {
+    uint32_t netId;
+    Snapshot::Kind kind;
+    std::string jsonFileName;  // only written when the client hasn't seen the actor
+    int32_t x;
+    int32_t y;
+    int32_t vx;
+    int32_t vy;
+    uint8_t flags;
+    int32_t health;
+  };
+
+  static int32_t quantizePosition(float meters);
+  static float dequantizePosition(int32_t value);
+  static int32_t quantizeVelocity(float metersPerSecond);
+  static float dequantizeVelocity(int32_t value);
+
+  // Writes this snapshot as a delta against `baseline`, or in full if it's nullptr.
+  void encode(const Snapshot* baseline, ByteWriter& writer) const;
+  // Returns false if the data is malformed.
+  bool decode(const Snapshot* baseline, ByteReader& reader);
+
+  const Snapshot::ActorState* find(uint32_t netId) const;
+
+  uint32_t tick;
+  std::string tmxMapFileName;  // only written in full snapshots
+  uint32_t controlledNetId;  // the actor controlled by the client
+  std::vector<Snapshot::ActorState> actors;  // sorted by netId
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_SNAPSHOT_H_
@@ -0,0 +1,162 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "UdpSocket.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "util/Logger.h"
+#include "util/StringUtil.h"
+
+#if defined(_WIN32)
+#define INVALID_UDP_SOCKET static_cast<uintptr_t>(INVALID_SOCKET)
+#else
+#define INVALID_UDP_SOCKET -1
+#endif
+
+using std::string;
+
+namespace vigilante {
+
+bool UdpSocket::Address::operator==(const UdpSocket::Address& other) const {
+  return ip == other.ip && port == other.port;
+}
+
+bool UdpSocket::Address::operator!=(const UdpSocket::Address& other) const {
+  return !(*this == other);
+}
+
+
+bool UdpSocket::resolve(const string& host, uint16_t port, UdpSocket::Address* address) {
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  addrinfo* result = nullptr;
+  if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) {
+    VGLOG(LOG_ERR, "Unable to resolve %s", host.c_str());
+    return false;
+  }
+
+  const sockaddr_in* addr = reinterpret_cast<const sockaddr_in*>(result->ai_addr);
+  address->ip = ntohl(addr->sin_addr.s_addr);
+  address->port = port;
+  freeaddrinfo(result);
+  return true;
+}
+
+string UdpSocket::toString(const UdpSocket::Address& address) {
+  return string_util::format("%u.%u.%u.%u:%u",
+                             (address.ip >> 24) & 0xff, (address.ip >> 16) & 0xff,
+                             (address.ip >> 8) & 0xff, address.ip & 0xff, address.port);
+}
+
+
+UdpSocket::UdpSocket() : _socket(INVALID_UDP_SOCKET) {}
+
+UdpSocket::~UdpSocket() {
+  close();
+}
+
+bool UdpSocket::open(uint16_t port) {
+  close();
+
+#if defined(_WIN32)
+  // cocos2d's network module has called WSAStartup() already on most builds,
+  // but the calls are reference counted, so it's harmless to call it again.
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+    VGLOG(LOG_ERR, "Unable to initialize winsock");
+    return false;
+  }
+#endif
+
+  _socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (_socket == INVALID_UDP_SOCKET) {
+    VGLOG(LOG_ERR, "Unable to create the udp socket");
+    return false;
+  }
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(_socket, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+    VGLOG(LOG_ERR, "Unable to bind the udp socket to port %u", port);
+    close();
+    return false;
+  }
+
+#if defined(_WIN32)
+  u_long isNonBlocking = 1;
+  const bool isSet = ioctlsocket(_socket, FIONBIO, &isNonBlocking) == 0;
+#else
+  const bool isSet = fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+  if (!isSet) {
+    VGLOG(LOG_ERR, "Unable to make the udp socket non-blocking");
+    close();
+    return false;
+  }
+  return true;
+}
+
+void UdpSocket::close() {
+  if (_socket == INVALID_UDP_SOCKET) {
+    return;
+  }
+
+#if defined(_WIN32)
+  closesocket(_socket);
+  WSACleanup();
+#else
+  ::close(_socket);
+#endif
+  _socket = INVALID_UDP_SOCKET;
+}
+
+bool UdpSocket::isOpen() const {
+  return _socket != INVALID_UDP_SOCKET;
+}
+
+bool UdpSocket::sendTo(const UdpSocket::Address& address, const uint8_t* data, size_t size) {
+  if (_socket == INVALID_UDP_SOCKET) {
+    return false;
+  }
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(address.ip);
+  addr.sin_port = htons(address.port);
+  const auto numSent = sendto(_socket, reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+                              reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+  return numSent == static_cast<decltype(numSent)>(size);
+}
+
+size_t UdpSocket::receiveFrom(UdpSocket::Address* address, uint8_t* buf, size_t capacity) {
+  if (_socket == INVALID_UDP_SOCKET) {
+    return 0;
+  }
+
+  sockaddr_in addr{};
+  socklen_t addrLen = sizeof(addr);
+  const auto numReceived = recvfrom(_socket, reinterpret_cast<char*>(buf), static_cast<int>(capacity), 0,
+                                    reinterpret_cast<sockaddr*>(&addr), &addrLen);
+  if (numReceived <= 0) {
+    return 0;  // EWOULDBLOCK, or an error which is handled like a lost datagram
+  }
+
+  address->ip = ntohl(addr.sin_addr.s_addr);
+  address->port = ntohs(addr.sin_port);
+  return static_cast<size_t>(numReceived);
+}
+
+}  // namespace vigilante
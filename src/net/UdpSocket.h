@@ -0,0 +1,52 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_UDP_SOCKET_H_
+#define VIGILANTE_UDP_SOCKET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vigilante {
+
+// A non-blocking IPv4 UDP socket, so that the co-op session (see CoopSession)
+// can poll it once per frame on the main thread without a thread of its own.
+class UdpSocket final {
+ public:
+  struct Address final {
+    uint32_t ip;  // in host byte order
+    uint16_t port;
+
+    bool operator==(const UdpSocket::Address& other) const;
+    bool operator!=(const UdpSocket::Address& other) const;
+  };
+
+  // Returns false if `host` is neither a dotted IPv4 address nor a resolvable name.
+  static bool resolve(const std::string& host, uint16_t port, UdpSocket::Address* address);
+  static std::string toString(const UdpSocket::Address& address);
+
+  UdpSocket();
+  ~UdpSocket();
+
+  // Binds to `port` on all interfaces, or to an ephemeral port if `port` is 0.
+  bool open(uint16_t port);
+  void close();
+  bool isOpen() const;
+
+  bool sendTo(const UdpSocket::Address& address, const uint8_t* data, size_t size);
+  // Returns the size of the datagram received, or 0 if there's none pending.
+  size_t receiveFrom(UdpSocket::Address* address, uint8_t* buf, size_t capacity);
+
+ private:
+  UdpSocket(const UdpSocket&) = delete;
+  UdpSocket& operator=(const UdpSocket&) = delete;
+
+#if defined(_WIN32)
+  uintptr_t _socket;
+#else
+  int _socket;
+#endif
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_UDP_SOCKET_H_
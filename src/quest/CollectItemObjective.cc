@@ -1,6 +1,8 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "CollectItemObjective.h"
 
+#include <algorithm>
+
 #include "character/Player.h"
 #include "item/Item.h"
 #include "map/GameMapManager.h"
@@ -13,20 +15,39 @@ CollectItemObjective::CollectItemObjective(const string& desc,
                                            const string& itemName,
                                            int amount)
     : Quest::Objective(Quest::Objective::Type::COLLECT, desc),
-      _itemName(itemName),
-      _amount(amount) {}
+      _itemNameId(itemName),
+      _amount(amount),
+      _currentAmount() {}
 
 
 bool CollectItemObjective::isCompleted() const {
-  return GameMapManager::getInstance()->getPlayer()->getItemAmount(_itemName) >= _amount;
+  return _currentAmount >= _amount;
+}
+
+AssetId CollectItemObjective::getTargetId() const {
+  return _itemNameId;
 }
 
 const string& CollectItemObjective::getItemName() const {
-  return _itemName;
+  return _itemNameId.getName();
 }
 
 int CollectItemObjective::getAmount() const {
   return _amount;
 }
 
+
+void CollectItemObjective::syncCurrentAmount() {
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  _currentAmount = (player) ? player->getItemAmount(_itemNameId) : 0;
+}
+
+void CollectItemObjective::addCurrentAmount(int deltaAmount) {
+  _currentAmount = std::max(0, _currentAmount + deltaAmount);
+}
+
+int CollectItemObjective::getCurrentAmount() const {
+  return _currentAmount;
+}
+
 }  // namespace vigilante
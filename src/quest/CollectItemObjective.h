@@ -5,6 +5,7 @@
 #include <string>
 
 #include "Quest.h"
+#include "util/AssetId.h"
 
 namespace vigilante {
 
@@ -16,13 +17,22 @@ class CollectItemObjective : public Quest::Objective {
   virtual ~CollectItemObjective() = default;
 
   virtual bool isCompleted() const override;
+  virtual AssetId getTargetId() const override;
 
   const std::string& getItemName() const;
   int getAmount() const;
 
+  // The counter of the collected items, which is initialized from the
+  // player's inventory once, and then kept up to date by the inventory deltas
+  // (see QuestBook::onItemAmountChanged()).
+  void syncCurrentAmount();
+  void addCurrentAmount(int deltaAmount);
+  int getCurrentAmount() const;
+
  private:
-  std::string _itemName;
+  AssetId _itemNameId;
   int _amount;
+  int _currentAmount;
 };
 
 }  // namespace vigilante
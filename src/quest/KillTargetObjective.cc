@@ -9,7 +9,7 @@ KillTargetObjective::KillTargetObjective(const string& desc,
                                          const string& characterName,
                                          int targetAmount)
     : Quest::Objective(Quest::Objective::Type::KILL, desc),
-      _characterName(characterName),
+      _characterNameId(characterName),
       _targetAmount(targetAmount),
       _currentAmount() {}
 
@@ -18,9 +18,13 @@ bool KillTargetObjective::isCompleted() const {
   return _currentAmount >= _targetAmount;
 }
 
+AssetId KillTargetObjective::getTargetId() const {
+  return _characterNameId;
+}
+
 
 const string& KillTargetObjective::getCharacterName() const {
-  return _characterName;
+  return _characterNameId.getName();
 }
 
 int KillTargetObjective::getTargetAmount() const {
@@ -31,8 +35,12 @@ int KillTargetObjective::getCurrentAmount() const {
   return _currentAmount;
 }
 
-void KillTargetObjective::incrementCurrentAmount() {
-  _currentAmount++;
+void KillTargetObjective::incrementCurrentAmount(int amount) {
+  _currentAmount += amount;
+}
+
+void KillTargetObjective::setCurrentAmount(int currentAmount) {
+  _currentAmount = currentAmount;
 }
 
 }  // namespace vigilante
@@ -5,6 +5,7 @@
 #include <string>
 
 #include "Quest.h"
+#include "util/AssetId.h"
 
 namespace vigilante {
 
@@ -16,14 +17,16 @@ class KillTargetObjective : public Quest::Objective {
   virtual ~KillTargetObjective() = default;
 
   virtual bool isCompleted() const override;
+  virtual AssetId getTargetId() const override;
 
   const std::string& getCharacterName() const;
   int getTargetAmount() const;
   int getCurrentAmount() const;
-  void incrementCurrentAmount();
+  void incrementCurrentAmount(int amount=1);
+  void setCurrentAmount(int currentAmount);
 
  private:
-  std::string _characterName;
+  AssetId _characterNameId;
   int _targetAmount;
   int _currentAmount;
 };
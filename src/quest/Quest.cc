@@ -7,8 +7,8 @@
 #include "std/make_unique.h"
 #include "quest/CollectItemObjective.h"
 #include "quest/KillTargetObjective.h"
-#include "ui/console/Console.h"
 #include "util/JsonUtil.h"
+#include "util/ProfileCache.h"
 #include "util/StringUtil.h"
 
 using std::string;
@@ -19,13 +19,13 @@ using rapidjson::Document;
 namespace vigilante {
 
 Quest::Quest(const string& jsonFileName)
-    : _questProfile(jsonFileName),
+    : _questProfile(*profile_cache::get<Quest::Profile>(jsonFileName)),
       _isUnlocked(),
       _currentStageIdx(-1) {}
 
 
 void Quest::import(const string& jsonFileName) {
-  _questProfile = Quest::Profile(jsonFileName);
+  _questProfile = *profile_cache::get<Quest::Profile>(jsonFileName);
 }
 
 void Quest::unlock() {
@@ -40,16 +40,14 @@ void Quest::advanceStage() {
   // Execute the commands that are supposed to run after
   // this stage is completed.
   if (_currentStageIdx >= 0) {
-    for (const auto& cmd : getCurrentStage().cmds) {
-      Console::getInstance()->executeCmd(cmd);
-    }
+    ScriptRunner::getInstance()->run(getCurrentStage().script);
   }
   ++_currentStageIdx;
 
   // Update quest desc (if provided).
   // We can only update quest desc if it hasn't been completed,
   // or we'll get out of index during `getCurrentStage()`.
-  if (!isCompleted() && !getCurrentStage().questDesc.empty()) {
+  if (!isCompleted() && getCurrentStage().questDesc.isValid()) {
     _questProfile.desc = getCurrentStage().questDesc;
   }
 }
@@ -70,17 +68,37 @@ const Quest::Stage& Quest::getCurrentStage() const {
   return _questProfile.stages.at(_currentStageIdx);
 }
 
+int Quest::getCurrentStageIdx() const {
+  return _currentStageIdx;
+}
+
+void Quest::setCurrentStageIdx(int currentStageIdx) {
+  _currentStageIdx = std::max(-1, std::min(currentStageIdx, static_cast<int>(_questProfile.stages.size())));
+
+  // The quest desc is updated by the latest stage which provides one.
+  for (int i = std::min(_currentStageIdx, static_cast<int>(_questProfile.stages.size()) - 1); i >= 0; i--) {
+    if (_questProfile.stages[i].questDesc.isValid()) {
+      _questProfile.desc = _questProfile.stages[i].questDesc;
+      break;
+    }
+  }
+}
+
 
 
 Quest::Objective::Objective(Objective::Type objectiveType, const string& desc)
     : _objectiveType(objectiveType), _desc(desc) {}
 
+AssetId Quest::Objective::getTargetId() const {
+  return AssetId();
+}
+
 Quest::Objective::Type Quest::Objective::getObjectiveType() const {
   return _objectiveType;
 }
 
 const string& Quest::Objective::getDesc() const {
-  return _desc;
+  return _desc.getText();
 }
 
 
@@ -115,10 +133,11 @@ string Quest::Stage::getHint() const {
 
 
 Quest::Profile::Profile(const string& jsonFileName) : jsonFileName(jsonFileName) {
-  Document json = json_util::parseJson(jsonFileName);
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  Document& json = jsonDocument.get();
 
   title = json["title"].GetString();
-  desc = json["desc"].GetString();
+  desc = TextId(json["desc"].GetString());
 
   for (const auto& stageJson : json["stages"].GetArray()) {
     auto objectiveType = static_cast<Quest::Objective::Type>(stageJson["objective"]["objectiveType"].GetInt());
@@ -155,12 +174,13 @@ Quest::Profile::Profile(const string& jsonFileName) : jsonFileName(jsonFileName)
 
     if (stageJson.HasMember("questDesc")) {
       string questDesc = stageJson["questDesc"].GetString();
-      stage.questDesc = questDesc;
+      stage.questDesc = TextId(questDesc);
     }
 
     for (const auto& cmd : stageJson["exec"].GetArray()) {
       stage.cmds.push_back(cmd.GetString());
     }
+    stage.script = ScriptRunner::compile(stage.cmds);
 
     stages.push_back(std::move(stage));
   }
@@ -8,6 +8,9 @@
 #include <unordered_map>
 
 #include "Importable.h"
+#include "gameplay/ScriptRunner.h"
+#include "util/AssetId.h"
+#include "util/TextId.h"
 
 namespace vigilante {
 
@@ -32,6 +35,10 @@ class Quest : public Importable {
 
     virtual bool isCompleted() const = 0;
 
+    // The name of the character / item this objective is about, by which
+    // QuestBook indexes the objectives. Invalid if it's not about any.
+    virtual AssetId getTargetId() const;
+
     Objective::Type getObjectiveType() const;
     const std::string& getDesc() const;
 
@@ -39,7 +46,7 @@ class Quest : public Importable {
     Objective(Objective::Type objectiveType, const std::string& desc);
 
     Objective::Type _objectiveType;
-    std::string _desc;
+    TextId _desc;
   };
 
 
@@ -47,9 +54,10 @@ class Quest : public Importable {
     std::string getHint() const;
 
     bool isFinished;
-    std::string questDesc;  // optionally update questDesc when this stage is reached.
+    TextId questDesc;  // optionally update questDesc when this stage is reached.
     std::unique_ptr<Objective> objective; 
     std::vector<std::string> cmds;
+    ScriptRunner::Script script;  // compiled from `cmds`
   };
 
 
@@ -58,7 +66,7 @@ class Quest : public Importable {
 
     std::string jsonFileName;
     std::string title;
-    std::string desc;
+    TextId desc;
     std::vector<Quest::Stage> stages;
   };
 
@@ -74,6 +82,11 @@ class Quest : public Importable {
   const Quest::Profile& getQuestProfile() const;
   const Quest::Stage& getCurrentStage() const;
 
+  // -1 if this quest hasn't been started yet. Setting it directly (e.g., when
+  // loading a saved game) doesn't run the scripts of the skipped stages.
+  int getCurrentStageIdx() const;
+  void setCurrentStageIdx(int currentStageIdx);
+
  private:
   Quest::Profile _questProfile;
   bool _isUnlocked;
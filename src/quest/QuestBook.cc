@@ -6,8 +6,9 @@
 #include <stdexcept>
 
 #include "std/make_unique.h"
+#include "EventBus.h"
+#include "quest/CollectItemObjective.h"
 #include "quest/KillTargetObjective.h"
-#include "ui/quest_hints/QuestHints.h"
 #include "util/ds/Algorithm.h"
 #include "util/StringUtil.h"
 #include "util/Logger.h"
@@ -21,7 +22,12 @@ using std::runtime_error;
 
 namespace vigilante {
 
-QuestBook::QuestBook(const string& questsListFileName) {
+QuestBook::QuestBook(const string& questsListFileName)
+    : _questJsonFileNames(),
+      _questMapper(),
+      _inProgressQuests(),
+      _completedQuests(),
+      _objectiveIndex() {
   ifstream fin(questsListFileName);
   if (!fin.is_open()) {
     throw runtime_error("Failed to open quest list: " + questsListFileName);
@@ -29,27 +35,44 @@ QuestBook::QuestBook(const string& questsListFileName) {
 
   string line;
   while (std::getline(fin, line)) {
-    _questMapper[line] = std::make_unique<Quest>(line);
+    if (!line.empty()) {
+      _questJsonFileNames.insert(line);
+    }
   }
 }
 
 
 void QuestBook::update(Quest::Objective::Type objectiveType) {
   VGLOG(LOG_INFO, "Updating quests");
-  for (const auto quest : _inProgressQuests) {
-    if (quest->getCurrentStage().objective->getObjectiveType() != objectiveType) {
-      continue;
+
+  // Advancing a quest may start or complete other quests (see Quest::Stage::cmds),
+  // so iterate over a copy.
+  const vector<Quest*> inProgressQuests = _inProgressQuests;
+  for (const auto quest : inProgressQuests) {
+    const auto& objective = quest->getCurrentStage().objective;
+    if (objective && objective->getObjectiveType() == objectiveType) {
+      advanceQuest(quest);
     }
+  }
+}
 
-    while (!quest->isCompleted() && quest->getCurrentStage().objective->isCompleted()) {
-      quest->advanceStage();
+void QuestBook::update(Quest::Objective::Type objectiveType, AssetId targetId) {
+  const vector<Quest*> quests = getQuestsByObjective(objectiveType, targetId);
+  for (const auto quest : quests) {
+    advanceQuest(quest);
+  }
+}
 
-      if (quest->isCompleted()) {
-        markCompleted(quest);
-      } else {
-        QuestHints::getInstance()->show(quest->getCurrentStage().objective->getDesc());
-      }
-    }
+const vector<Quest*>& QuestBook::getQuestsByObjective(Quest::Objective::Type objectiveType,
+                                                      AssetId targetId) const {
+  static const vector<Quest*> kNoQuests;
+  auto it = _objectiveIndex.find(getObjectiveKey(objectiveType, targetId));
+  return (it != _objectiveIndex.end()) ? it->second : kNoQuests;
+}
+
+void QuestBook::onItemAmountChanged(AssetId itemNameId, int deltaAmount) {
+  for (auto quest : getQuestsByObjective(Quest::Objective::Type::COLLECT, itemNameId)) {
+    static_cast<CollectItemObjective*>(quest->getCurrentStage().objective.get())->addCurrentAmount(deltaAmount);
   }
 }
 
@@ -69,8 +92,9 @@ void QuestBook::startQuest(Quest* quest) {
   _inProgressQuests.push_back(quest);
 
   quest->advanceStage();
-  QuestHints::getInstance()->show("Started: " + quest->getQuestProfile().title);
-  QuestHints::getInstance()->show(quest->getCurrentStage().objective->getDesc());
+  indexQuest(quest);
+  EventBus::getInstance()->post(QuestProgressedEvent{quest, "Started: " + quest->getQuestProfile().title});
+  EventBus::getInstance()->post(QuestProgressedEvent{quest, quest->getCurrentStage().objective->getDesc()});
 }
 
 void QuestBook::markCompleted(Quest* quest) {
@@ -84,30 +108,28 @@ void QuestBook::markCompleted(Quest* quest) {
   // and add it to _completedQuests.
   _inProgressQuests.erase(
       std::remove(_inProgressQuests.begin(), _inProgressQuests.end(), quest), _inProgressQuests.end());
+  unindexQuest(quest);
 
   _completedQuests.push_back(quest);
 
-  QuestHints::getInstance()->show("Completed: " + quest->getQuestProfile().title);
+  EventBus::getInstance()->post(QuestProgressedEvent{quest, "Completed: " + quest->getQuestProfile().title});
 }
 
 
 void QuestBook::unlockQuest(const string& questJsonFileName) {
-  auto it = _questMapper.find(questJsonFileName);
-  if (it == _questMapper.end()) {
-    return;
+  if (Quest* quest = getQuest(questJsonFileName)) {
+    unlockQuest(quest);
   }
-  unlockQuest(it->second.get());
 }
 
 void QuestBook::startQuest(const string& questJsonFileName) {
-  auto it = _questMapper.find(questJsonFileName);
-  if (it == _questMapper.end()) {
-    return;
+  if (Quest* quest = getQuest(questJsonFileName)) {
+    startQuest(quest);
   }
-  startQuest(it->second.get());
 }
 
 void QuestBook::markCompleted(const string& questJsonFileName) {
+  // A quest which has never been constructed can't be in progress.
   auto it = _questMapper.find(questJsonFileName);
   if (it == _questMapper.end()) {
     return;
@@ -116,6 +138,44 @@ void QuestBook::markCompleted(const string& questJsonFileName) {
 }
 
 
+void QuestBook::reset() {
+  _questMapper.clear();
+  _inProgressQuests.clear();
+  _completedQuests.clear();
+  _objectiveIndex.clear();
+}
+
+void QuestBook::restoreQuest(const string& questJsonFileName,
+                             bool isUnlocked,
+                             int stageIdx,
+                             int objectiveProgress) {
+  Quest* quest = getQuest(questJsonFileName);
+  if (!quest) {
+    return;
+  }
+
+  if (isUnlocked) {
+    quest->unlock();
+  }
+  quest->setCurrentStageIdx(stageIdx);
+
+  if (quest->isCompleted()) {
+    _completedQuests.push_back(quest);
+    return;
+  }
+  if (quest->getCurrentStageIdx() < 0) {
+    return;
+  }
+
+  const auto& objective = quest->getCurrentStage().objective;
+  if (objective && objective->getObjectiveType() == Quest::Objective::Type::KILL) {
+    static_cast<KillTargetObjective*>(objective.get())->setCurrentAmount(objectiveProgress);
+  }
+  _inProgressQuests.push_back(quest);
+  indexQuest(quest);
+}
+
+
 vector<Quest*> QuestBook::getAllQuests() const {
   vector<Quest*> allQuests(_inProgressQuests.begin(), _inProgressQuests.end());
   allQuests.insert(allQuests.end(), _completedQuests.begin(), _completedQuests.end());
@@ -130,4 +190,79 @@ const vector<Quest*>& QuestBook::getCompletedQuests() const {
   return _completedQuests;
 }
 
+
+Quest* QuestBook::getQuest(const string& questJsonFileName) {
+  auto it = _questMapper.find(questJsonFileName);
+  if (it != _questMapper.end()) {
+    return it->second.get();
+  }
+
+  if (_questJsonFileNames.find(questJsonFileName) == _questJsonFileNames.end()) {
+    VGLOG(LOG_WARN, "Quest [%s] is not listed in the quests list.", questJsonFileName.c_str());
+    return nullptr;
+  }
+
+  // The profile is parsed once and shared via profile_cache.
+  auto& quest = _questMapper[questJsonFileName];
+  quest = std::make_unique<Quest>(questJsonFileName);
+  return quest.get();
+}
+
+
+uint64_t QuestBook::getObjectiveKey(Quest::Objective::Type objectiveType, AssetId targetId) {
+  return (static_cast<uint64_t>(objectiveType) << 32) | targetId.getValue();
+}
+
+void QuestBook::advanceQuest(Quest* quest) {
+  while (!quest->isCompleted() && quest->getCurrentStage().objective &&
+         quest->getCurrentStage().objective->isCompleted()) {
+    unindexQuest(quest);
+    quest->advanceStage();
+
+    if (quest->isCompleted()) {
+      markCompleted(quest);
+    } else {
+      indexQuest(quest);
+      EventBus::getInstance()->post(QuestProgressedEvent{quest, quest->getCurrentStage().objective->getDesc()});
+    }
+  }
+}
+
+void QuestBook::indexQuest(Quest* quest) {
+  if (quest->isCompleted() || !quest->getCurrentStage().objective) {
+    return;
+  }
+
+  const auto& objective = quest->getCurrentStage().objective;
+  if (objective->getObjectiveType() == Quest::Objective::Type::COLLECT) {
+    // The player may already have some of the items.
+    static_cast<CollectItemObjective*>(objective.get())->syncCurrentAmount();
+  }
+
+  auto& quests = _objectiveIndex[getObjectiveKey(objective->getObjectiveType(),
+                                                 objective->getTargetId())];
+  if (std::find(quests.begin(), quests.end(), quest) == quests.end()) {
+    quests.push_back(quest);
+  }
+}
+
+void QuestBook::unindexQuest(Quest* quest) {
+  if (quest->isCompleted() || !quest->getCurrentStage().objective) {
+    return;
+  }
+
+  const auto& objective = quest->getCurrentStage().objective;
+  auto it = _objectiveIndex.find(getObjectiveKey(objective->getObjectiveType(),
+                                                 objective->getTargetId()));
+  if (it == _objectiveIndex.end()) {
+    return;
+  }
+
+  auto& quests = it->second;
+  quests.erase(std::remove(quests.begin(), quests.end(), quest), quests.end());
+  if (quests.empty()) {
+    _objectiveIndex.erase(it);
+  }
+}
+
 }  // namespace vigilante
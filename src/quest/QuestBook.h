@@ -6,8 +6,10 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "Quest.h"
+#include "util/AssetId.h"
 
 namespace vigilante {
 
@@ -16,7 +18,21 @@ class QuestBook {
   explicit QuestBook(const std::string& questsListFileName);
   virtual ~QuestBook() = default;
 
+  // Advances the in-progress quests whose current objectives of `objectiveType`
+  // have been completed.
   void update(const Quest::Objective::Type objectiveType);
+  // Same as above, but only the objectives about `targetId` (e.g., the name of
+  // the killed character) are checked, which are looked up from the index.
+  void update(const Quest::Objective::Type objectiveType, AssetId targetId);
+
+  // Returns the in-progress quests whose current objectives
+  // are of `objectiveType` and about `targetId`.
+  const std::vector<Quest*>& getQuestsByObjective(const Quest::Objective::Type objectiveType,
+                                                  AssetId targetId) const;
+
+  // Updates the counters of the collect objectives about `itemNameId`.
+  // This doesn't advance any quest, see update().
+  void onItemAmountChanged(AssetId itemNameId, int deltaAmount);
 
   void unlockQuest(Quest* quest);
   void startQuest(Quest* quest);
@@ -26,14 +42,43 @@ class QuestBook {
   void startQuest(const std::string& questJsonFileName);
   void markCompleted(const std::string& questJsonFileName);
 
+  // Used when loading a saved game (see GameState). reset() forgets all quests,
+  // and restoreQuest() puts a quest back at `stageIdx` with its objective's
+  // progress (e.g., the number of kills) without running any stage's scripts.
+  void reset();
+  void restoreQuest(const std::string& questJsonFileName,
+                    bool isUnlocked,
+                    int stageIdx,
+                    int objectiveProgress);
+
   std::vector<Quest*> getAllQuests() const;
   const std::vector<Quest*>& getInProgressQuests() const;
   const std::vector<Quest*>& getCompletedQuests() const;
 
  private:
+  // Returns the quest of `questJsonFileName`, which is constructed on demand,
+  // or nullptr if it isn't listed in the quests list.
+  Quest* getQuest(const std::string& questJsonFileName);
+
+  static uint64_t getObjectiveKey(const Quest::Objective::Type objectiveType, AssetId targetId);
+
+  // Advances `quest` while its current objective is completed.
+  void advanceQuest(Quest* quest);
+
+  // Adds / removes `quest` to / from the index by its current objective.
+  void indexQuest(Quest* quest);
+  void unindexQuest(Quest* quest);
+
+  // The json file names of all quests in the game. Only the quests which
+  // have been unlocked or started are constructed and put in _questMapper,
+  // since most of them are never touched in a session.
+  std::unordered_set<std::string> _questJsonFileNames;
   std::unordered_map<std::string, std::unique_ptr<Quest>> _questMapper;
   std::vector<Quest*> _inProgressQuests;
   std::vector<Quest*> _completedQuests;
+
+  // <objective key, in-progress quests>, see getObjectiveKey().
+  std::unordered_map<uint64_t, std::vector<Quest*>> _objectiveIndex;
 };
 
 } // namespace vigilante
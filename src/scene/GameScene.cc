@@ -1,37 +1,69 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "GameScene.h"
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 
-#include <SimpleAudioEngine.h>
 #include "AssetManager.h"
+#include "AudioManager.h"
 #include "CallbackManager.h"
 #include "Constants.h"
+#include "EventBus.h"
+#include "HotReloader.h"
 #include "character/Player.h"
-#include "gameplay/ExpPointTable.h"
-#include "gameplay/ItemPriceTable.h"
+#include "gameplay/Autosaver.h"
+#include "gameplay/CameraSystem.h"
+#include "gameplay/CheckpointManager.h"
+#include "gameplay/GameplayBenchmark.h"
+#include "gameplay/GameState.h"
+#include "gameplay/RenderStressTest.h"
+#include "gl/GpuTimer.h"
+#include "gl/ResolutionScaler.h"
 #include "input/InputManager.h"
+#include "map/DormantWorld.h"
 #include "map/GameMap.h"
+#include "net/CoopSession.h"
+#include "scene/GameSceneWarmUp.h"
+#include "ui/UiModuleRegistry.h"
 #include "skill/Skill.h"
 #include "quest/Quest.h"
 #include "util/box2d/b2DebugRenderer.h"
-#include "util/CameraUtil.h"
-#include "util/KeyCodeUtil.h"
+#include "util/AllocationTracker.h"
+#include "util/DeferredTaskScheduler.h"
+#include "util/FrameArena.h"
+#include "util/FrameBudget.h"
+#include "util/FramePacer.h"
+#include "util/FrameProfiler.h"
+#include "util/Headless.h"
+#include "util/HitchDetector.h"
+#include "util/MainThread.h"
 #include "util/RandUtil.h"
+#include "util/StringUtil.h"
 #include "util/Logger.h"
+#include "util/Telemetry.h"
+#include "util/TraceProfiler.h"
+
+#define PLAYER_LANTERN_RADIUS 96.0f  // in pixels, see LightMap
+#define PLAYER_LANTERN_COLOR cocos2d::Color3B(255, 214, 160)
+#define REPLAY_PLAYBACK_TIME_SLICE .1  // seconds of wall time per rendered frame
 
 using std::string;
 using std::unique_ptr;
+using std::chrono::steady_clock;
 using cocos2d::Vec3;
 using cocos2d::Camera;
 using cocos2d::CameraFlag;
 using cocos2d::Director;
 using cocos2d::Layer;
+using cocos2d::Rect;
 using cocos2d::EventKeyboard;
 using cocos2d::ui::ImageView;
 
 namespace vigilante {
 
+const string GameScene::kSceneCacheKey = "GameScene";
+
 bool GameScene::init() {
   if (!Scene::init()) {
     return false;
@@ -47,12 +79,9 @@ bool GameScene::init() {
   _gameCamera = getDefaultCamera();
   _gameCamera->initOrthographic(winSize.width, winSize.height, 1, 1000);
   _gameCamera->setPosition(0, 0);
-
-  // Initialize CallbackManager.
-  CallbackManager::getInstance()->setScene(this);
+  CameraSystem::getInstance()->setCamera(_gameCamera);
 
   // Initialize Vigilante's utils.
-  vigilante::keycode_util::init();
   vigilante::rand_util::init();
 
   // Initialize HUD camera.
@@ -65,6 +94,10 @@ bool GameScene::init() {
   _hudCamera->lookAt(eyePos);
   _hudCamera->setPosition(0, 0);
   addChild(_hudCamera);
+
+  // The world may be rendered offscreen at a lower resolution, and then upscaled.
+  ResolutionScaler::getInstance()->setScene(this, _gameCamera, _hudCamera);
+  GpuTimer::getInstance()->setScene(this);
   
   // Initialize shade.
   _shade = Shade::getInstance();
@@ -76,10 +109,21 @@ bool GameScene::init() {
   _hud->getLayer()->setCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
   addChild(_hud->getLayer(), graphical_layers::kHud);
 
-  // Initialize console.
-  _console = Console::getInstance();
-  _console->getLayer()->setCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
-  addChild(_console->getLayer(), graphical_layers::kConsole);
+  // The console, the dialogue manager and the pause menu are only constructed
+  // when they're used for the first time, and then wired into this scene.
+  // The pause menu and the dialogue manager are likely to be used,
+  // so preload them when there's time left in a frame.
+  UiModuleRegistry* uiModuleRegistry = UiModuleRegistry::getInstance();
+  uiModuleRegistry->registerModule(UiModuleRegistry::Module::CONSOLE,
+                                   graphical_layers::kConsole, false,
+                                   []() { Console::getInstance(); });
+  uiModuleRegistry->registerModule(UiModuleRegistry::Module::DIALOGUE_MANAGER,
+                                   graphical_layers::kDialogue, true,
+                                   []() { DialogueManager::getInstance(); });
+  uiModuleRegistry->registerModule(UiModuleRegistry::Module::PAUSE_MENU,
+                                   graphical_layers::kPauseMenu, true,
+                                   []() { PauseMenu::getInstance(); });
+  uiModuleRegistry->setScene(this, static_cast<uint16_t>(CameraFlag::USER1));
 
   // Initialize notifications.
   _notifications = Notifications::getInstance();
@@ -100,22 +144,13 @@ bool GameScene::init() {
   _controlHints->getLayer()->setCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
   addChild(_controlHints->getLayer(), graphical_layers::kControlHints);
 
-  // Initialize dialogue manager.
-  _dialogueManager = DialogueManager::getInstance();
-  _dialogueManager->getLayer()->setCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
-  addChild(_dialogueManager->getLayer(), graphical_layers::kDialogue);
-
   // Initialize window manager.
   _windowManager = WindowManager::getInstance();
   _windowManager->setDefaultCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
   _windowManager->setScene(this);
 
-  // Initialize vigilante's exp point table.
-  exp_point_table::import(asset_manager::kExpPointTable);
-
-  // Initialize vigilante's item price table.
-  item_price_table::import(asset_manager::kItemPriceTable);
-
+  // The exp point table and the item price table
+  // have been imported by LoadingScene already.
 
   // Initialize GameMapManager.
   // b2World is created when GameMapManager's ctor is called.
@@ -133,48 +168,291 @@ bool GameScene::init() {
   _b2dr = b2DebugRenderer::create(_gameMapManager->getWorld());
   _b2dr->setVisible(false);
   addChild(_b2dr);
-  
-  // Initialize Pause Menu.
-  _pauseMenu = PauseMenu::getInstance();
-  _pauseMenu->getLayer()->setCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
-  addChild(_pauseMenu->getLayer(), graphical_layers::kPauseMenu);
 
-  // Tick the box2d world.
-  schedule(schedule_selector(GameScene::update));
+  // Initialize FrameProfiler. Its overlay is toggled along with b2dr.
+  _frameProfiler = FrameProfiler::getInstance();
+  _frameProfiler->getLayer()->setCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
+  addChild(_frameProfiler->getLayer(), graphical_layers::kProfiler);
+
+  // Initialize PerformanceHud. It's toggled on its own, see handleInput().
+  _performanceHud = PerformanceHud::getInstance();
+  _performanceHud->getLayer()->setCameraMask(static_cast<uint16_t>(CameraFlag::USER1));
+  addChild(_performanceHud->getLayer(), graphical_layers::kProfiler);
+
+  _physicsTimeAccumulator = 0;
+  _playbackTime = 0;
+  _headlessTime = 0;
+  _hasRunHeadlessCommands = false;
+
+  // All of the singletons' layers have been added to this scene,
+  // so they no longer have to be retained by the warm-up.
+  GameSceneWarmUp::getInstance()->finish();
+  uiModuleRegistry->preloadWhenIdle();
 
   startNewGame();
   return true;
 }
 
+void GameScene::onEnter() {
+  Scene::onEnter();
+
+  // Tick the box2d world. This is done here rather than in init(), since the
+  // selectors are unscheduled whenever this scene is suspended (popped) by
+  // SceneManager, and this is called again when it's resumed.
+  schedule(schedule_selector(GameScene::update));
+}
+
+void GameScene::onExit() {
+  Scene::onExit();
+
+  // The scenes shown in the meantime (e.g., MainMenuScene) are always active.
+  FramePacer::getInstance()->setActivity(FramePacer::Activity::ACTIVE);
+}
+
 void GameScene::update(float delta) {
+  VGTRACE_ZONE("GameScene::update");
+  TraceProfiler::getInstance()->update();
+  recordFrameTime();
+  Telemetry::getInstance()->update(delta);
+  _performanceHud->update(_gameMapManager);
+  ResolutionScaler::getInstance()->update(Director::getInstance()->getDeltaTime());
+
+  InputManager* inputManager = InputManager::getInstance();
+
+  // While the world is paused, only the UI has to be redrawn, so the frame rate is lowered.
+  const bool isWorldPaused = isPauseMenuVisible() || isDialogueVisible() || !_windowManager->isEmpty();
+  FramePacer::getInstance()->setActivity((isWorldPaused && !inputManager->isReplayRunning()) ?
+                                         FramePacer::Activity::IDLE : FramePacer::Activity::ACTIVE);
+
+  if (headless::isEnabled() && updateHeadless()) {
+    VGLOG(LOG_INFO, "Headless run finished: %.1f s of game time", _headlessTime);
+    Director::getInstance()->end();
+    return;
+  }
+
+  if (inputManager->isReplayRunning() &&
+      inputManager->getReplayMode() == InputManager::ReplayMode::PLAYBACK) {
+    stepPlayback();
+    return;
+  }
+
+  if (GameplayBenchmark::getInstance()->isRunning()) {
+    stepBenchmark();
+    return;
+  }
+
+  // While a replay is being recorded, every frame advances the game
+  // by exactly one fixed time step, so it can be played back identically.
+  // The headless frames aren't paced, so they do the same.
+  const bool isFixedTimeStep = inputManager->isReplayRunning() || headless::isEnabled();
+  step((isFixedTimeStep) ? kFixedTimeStep : delta);
+}
+
+void GameScene::step(float delta) {
+  // Run the tasks posted by the other threads (e.g., loading a GameMap),
+  // before the GameMap may be checked below.
+  vigilante::main_thread::drain();
+
   if (!_gameMapManager->getGameMap()) {
     return;
   }
 
+  if (headless::isEnabled()) {
+    _headlessTime += delta;
+  }
+
+  InputManager::getInstance()->beginFrame();
   handleInput();
 
-  if (_pauseMenu->isVisible()) {
+  // The remote input is applied before the world is stepped,
+  // and the session is kept alive even while the game is paused.
+  CoopSession::getInstance()->update(delta);
+
+  if (!isPauseMenuVisible()) {
+    HotReloader::getInstance()->update(delta);
+    Autosaver::getInstance()->update(delta);
+    CheckpointManager::getInstance()->update(delta);
+    DormantWorld::getInstance()->update(delta);
+    RenderStressTest::getInstance()->update(delta);
+    CallbackManager::getInstance()->update(delta);
+
+    // The replays and the benchmarks are always stepped by kFixedTimeStep,
+    // so that they're reproducible regardless of the battery saver mode.
+    const bool isReproducible = InputManager::getInstance()->isReplayRunning() ||
+                                GameplayBenchmark::getInstance()->isRunning();
+    const float physicsTimeStep = (isReproducible) ? kFixedTimeStep
+                                                   : FramePacer::getInstance()->getPhysicsTimeStep();
+
+    _frameProfiler->beginFrame();
+    profileFrame(delta, physicsTimeStep);
+    _frameProfiler->endFrame(_gameMapManager->getWorld());
+    FrameBudget::getInstance()->endFrame();
+  }
+
+  // Notify the UI of the events posted in this frame (even when paused,
+  // e.g., using an item from the PauseMenu).
+  EventBus::getInstance()->dispatch();
+
+  // Spend what's left of the budget on upkeep which can be deferred.
+  DeferredTaskScheduler::getInstance()->update(kDeferredTaskTimeBudget);
+
+  // The temporaries of this frame are no longer used.
+  FrameArena::getInstance()->reset();
+  AllocationTracker::getInstance()->endFrame();
+}
+
+void GameScene::stepPlayback() {
+  InputManager* inputManager = InputManager::getInstance();
+
+  // Nothing is rendered until the time slice is used up,
+  // so the frames are run as fast as the game logic allows.
+  const steady_clock::time_point sliceBeginTime = steady_clock::now();
+  double elapsedTime = 0;
+  while (!inputManager->hasPlaybackFinished() && elapsedTime < REPLAY_PLAYBACK_TIME_SLICE) {
+    step(kFixedTimeStep);
+    elapsedTime = std::chrono::duration<double>(steady_clock::now() - sliceBeginTime).count();
+  }
+  _playbackTime += elapsedTime;
+
+  if (!inputManager->hasPlaybackFinished()) {
     return;
   }
 
-  // If there are no ongoing GameMap transitions, then step the box2d world.
+  const uint64_t numFrames = inputManager->getReplayFrame();
+  VGLOG(LOG_INFO, "Replay finished: %llu frames in %.3f s (%.3f ms per frame)",
+        static_cast<unsigned long long>(numFrames), _playbackTime,
+        (numFrames > 0) ? _playbackTime * 1000 / numFrames : 0.0);
+  _notifications->show("Replay finished");
+
+  inputManager->stopReplay();
+  _playbackTime = 0;
+}
+
+void GameScene::stepBenchmark() {
+  GameplayBenchmark* benchmark = GameplayBenchmark::getInstance();
+
+  const steady_clock::time_point sliceBeginTime = steady_clock::now();
+  double elapsedTime = 0;
+  while (!benchmark->hasFinished() && elapsedTime < REPLAY_PLAYBACK_TIME_SLICE) {
+    step(kFixedTimeStep);
+    benchmark->onFrameEnd(kFixedTimeStep);
+    elapsedTime = std::chrono::duration<double>(steady_clock::now() - sliceBeginTime).count();
+  }
+
+  if (benchmark->hasFinished()) {
+    benchmark->finish();
+    _notifications->show("Benchmark finished");
+  }
+}
+
+void GameScene::recordFrameTime() const {
+  // The frames of a replay being played back or a benchmark are long on purpose.
+  const InputManager* inputManager = InputManager::getInstance();
+  if ((inputManager->isReplayRunning() &&
+       inputManager->getReplayMode() == InputManager::ReplayMode::PLAYBACK) ||
+      GameplayBenchmark::getInstance()->isRunning()) {
+    return;
+  }
+
+  // This is the wall time of the last frame, whose zones have just been recorded.
+  HitchDetector* hitchDetector = HitchDetector::getInstance();
+  const float frameTime = Director::getInstance()->getDeltaTime();
+  Telemetry::getInstance()->addFrameTime(frameTime);
+  if (!hitchDetector->isHitch(frameTime)) {
+    return;
+  }
+
+  HitchDetector::Context context;
+  if (const GameMap* gameMap = _gameMapManager->getGameMap()) {
+    const ActorRegistry& actors = gameMap->getDynamicActors();
+    context.push_back({"map", gameMap->getTmxTiledMapFileName()});
+    context.push_back({"actors", string_util::format("%zu", actors.size())});
+    context.push_back({"npcs", string_util::format("%zu", actors.getGroup(ActorRegistry::Group::NPC).size())});
+    context.push_back({"items", string_util::format("%zu", actors.getGroup(ActorRegistry::Group::ITEM).size())});
+  }
+  if (const b2World* world = _gameMapManager->getWorld()) {
+    context.push_back({"bodies", string_util::format("%d", world->GetBodyCount())});
+    context.push_back({"contacts", string_util::format("%d", world->GetContactCount())});
+  }
+  context.push_back({"callbacks", string_util::format("%d", CallbackManager::getInstance()->getPendingCount())});
+  context.push_back({"targetFps", string_util::format("%.0f", FramePacer::getInstance()->getTargetFps())});
+  hitchDetector->dump(frameTime, context);
+}
+
+void GameScene::profileFrame(float delta, float physicsTimeStep) {
+  FrameProfiler::ScopedTimer frameTimer(FrameProfiler::Section::FRAME);
+
+  // If there are no ongoing GameMap transitions, then step the box2d world
+  // with a fixed time step, as many times as the elapsed time requires.
   if (_shade->getImageView()->getNumberOfRunningActions() == 0) {
-    _gameMapManager->getWorld()->Step(1 / kFps,
-                                      kVelocityIterations,
-                                      kPositionIterations);
-  }
-
-  _gameMapManager->update(delta);
-  _floatingDamages->update(delta);
-  _notifications->update(delta);
-  _questHints->update(delta);
-  _dialogueManager->update(delta);
-  _console->update(delta);
-  _windowManager->update(delta);
-
-  vigilante::camera_util::lerpToTarget(_gameCamera, _gameMapManager->getPlayer()->getBody()->GetPosition());
-  vigilante::camera_util::boundCamera(_gameCamera, _gameMapManager->getGameMap());
-  vigilante::camera_util::updateShake(_gameCamera, delta);
+    _physicsTimeAccumulator += delta;
+
+    int numSubsteps = 0;
+    while (_physicsTimeAccumulator >= physicsTimeStep && numSubsteps < kMaxPhysicsSubsteps) {
+      _gameMapManager->stepWorld(physicsTimeStep);
+      _physicsTimeAccumulator -= physicsTimeStep;
+      numSubsteps++;
+    }
+
+    // If we are falling behind, then drop the remaining time instead of
+    // spending even more substeps on it in the following frames.
+    if (numSubsteps == kMaxPhysicsSubsteps) {
+      _physicsTimeAccumulator = std::min(_physicsTimeAccumulator, physicsTimeStep);
+    }
+
+    // The leftover time is used to interpolate the sprites
+    // between the last two physics states.
+    DynamicActor::setInterpolationAlpha(_physicsTimeAccumulator / physicsTimeStep);
+  }
+
+  {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::GAME_MAP_UPDATE);
+    _gameMapManager->update(delta);
+  }
+  GameplayBenchmark::getInstance()->update();
+  AudioManager::getInstance()->update(delta);
+  {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::HUD);
+    _hud->update(delta);
+  }
+  {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::FLOATING_DAMAGES);
+    _floatingDamages->update(delta);
+  }
+  {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::NOTIFICATIONS);
+    _notifications->update(delta);
+  }
+  {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::QUEST_HINTS);
+    _questHints->update(delta);
+  }
+  UiModuleRegistry* uiModuleRegistry = UiModuleRegistry::getInstance();
+  if (uiModuleRegistry->isInstantiated(UiModuleRegistry::Module::DIALOGUE_MANAGER)) {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::DIALOGUE_MANAGER);
+    DialogueManager::getInstance()->update(delta);
+  }
+  if (uiModuleRegistry->isInstantiated(UiModuleRegistry::Module::CONSOLE)) {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::CONSOLE);
+    Console::getInstance()->update(delta);
+  }
+  {
+    FrameProfiler::ScopedTimer timer(FrameProfiler::Section::WINDOW_MANAGER);
+    _windowManager->update(delta);
+  }
+
+  CameraSystem* cameraSystem = CameraSystem::getInstance();
+  const b2Vec2 playerPos = _gameMapManager->getPlayer()->getInterpolatedBodyPosition();
+  cameraSystem->update(delta, playerPos, _gameMapManager->getGameMap());
+
+  _gameMapManager->getGameMap()->updateChunks(cameraSystem->getCenter());
+  _gameMapManager->getGameMap()->updateTileChunks(cameraSystem->getViewRect());
+
+  // The player's lantern only shows on dark maps.
+  LightMap* lightMap = _gameMapManager->getLightMap();
+  lightMap->submit(LightMap::Light(PLAYER_LANTERN_RADIUS, PLAYER_LANTERN_COLOR),
+                   playerPos.x * kPpm, playerPos.y * kPpm);
+  lightMap->update(cameraSystem->getViewRect());
 }
 
 void GameScene::handleInput() {
@@ -190,10 +468,17 @@ void GameScene::handleInput() {
   if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_0)) {
     bool isVisible = !_b2dr->isVisible();
     _b2dr->setVisible(isVisible);
+    _frameProfiler->setEnabled(isVisible);
     _notifications->show(string("Debug Mode: ") + ((isVisible) ? "on" : "off"));
     return;
   }
 
+  // Toggle PerformanceHud
+  if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_F3)) {
+    _performanceHud->setVisible(!_performanceHud->isVisible());
+    return;
+  }
+
   // Exit window or toggle PauseMenu
   if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_ESCAPE)) {
     if (!_windowManager->isEmpty()) {
@@ -201,46 +486,94 @@ void GameScene::handleInput() {
       return;
     }
 
-    bool isVisible = !_pauseMenu->isVisible();
-    _pauseMenu->setVisible(isVisible);
-    _pauseMenu->update();
+    PauseMenu* pauseMenu = PauseMenu::getInstance();
+    bool isVisible = !pauseMenu->isVisible();
+    pauseMenu->setVisible(isVisible);
+    pauseMenu->update();
     return;
   }
 
   // Toggle Console
   if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_GRAVE)) {
-    _console->setVisible(true);
+    Console::getInstance()->setVisible(true);
     return;
   }
 
+  // The actions buffered while the input goes to the UI
+  // must not be performed by the player afterwards.
   if (!_windowManager->isEmpty()) {
     _windowManager->top()->handleInput();
+    InputManager::getInstance()->clearBufferedActions();
     return;
   }
 
-  if (_pauseMenu->isVisible()) {
-    _pauseMenu->handleInput();
+  if (isPauseMenuVisible()) {
+    PauseMenu::getInstance()->handleInput();
+    InputManager::getInstance()->clearBufferedActions();
     return;
   }
 
-  if (_dialogueManager->getDialogueMenu()->getLayer()->isVisible() ||
-      _dialogueManager->getSubtitles()->getLayer()->isVisible()) {
-    _dialogueManager->handleInput();
+  if (isDialogueVisible()) {
+    DialogueManager::getInstance()->handleInput();
+    InputManager::getInstance()->clearBufferedActions();
     return;
   }
 
-  if (_gameMapManager->getPlayer()) {
+  // The player of the co-op client is moved by the host, see CoopSession.
+  if (_gameMapManager->getPlayer() && !CoopSession::getInstance()->isClient()) {
     _gameMapManager->getPlayer()->handleInput();
   }
 }
 
 
+bool GameScene::updateHeadless() {
+  // The commands (e.g., "replay play") may need a game in progress.
+  if (!_gameMapManager->getGameMap()) {
+    return false;
+  }
+
+  if (!_hasRunHeadlessCommands) {
+    _hasRunHeadlessCommands = true;
+    for (const auto& cmd : headless::getCommands()) {
+      VGLOG(LOG_INFO, "Headless: %s", cmd.c_str());
+      Console::getInstance()->executeCmd(cmd);
+    }
+  }
+
+  if (headless::getDuration() > 0) {
+    return _headlessTime >= headless::getDuration();
+  }
+  return InputManager::getInstance()->getReplayMode() == InputManager::ReplayMode::NONE &&
+         !GameplayBenchmark::getInstance()->isRunning();
+}
+
+bool GameScene::isPauseMenuVisible() const {
+  return UiModuleRegistry::getInstance()->isInstantiated(UiModuleRegistry::Module::PAUSE_MENU) &&
+         PauseMenu::getInstance()->isVisible();
+}
+
+bool GameScene::isDialogueVisible() const {
+  if (!UiModuleRegistry::getInstance()->isInstantiated(UiModuleRegistry::Module::DIALOGUE_MANAGER)) {
+    return false;
+  }
+  const DialogueManager* dialogueManager = DialogueManager::getInstance();
+  return dialogueManager->getDialogueMenu()->getLayer()->isVisible() ||
+         dialogueManager->getSubtitles()->getLayer()->isVisible();
+}
+
+
 void GameScene::startNewGame() {
   _gameMapManager->loadGameMap(asset_manager::kNewGameInitialMap);
 }
 
 void GameScene::loadGame(const string& gameSaveFilePath) {
+  GameState gameState;
+  gameState.setFilePath(gameSaveFilePath);
 
+  if (!gameState.load()) {
+    VGLOG(LOG_ERR, "Starting a new game instead.");
+    startNewGame();
+  }
 }
 
 }  // namespace vigilante
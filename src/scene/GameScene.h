@@ -19,8 +19,10 @@
 #include "ui/floating_damages/FloatingDamages.h"
 #include "ui/notifications/Notifications.h"
 #include "ui/pause_menu/PauseMenu.h"
+#include "ui/perf_hud/PerformanceHud.h"
 #include "ui/quest_hints/QuestHints.h"
 #include "util/box2d/b2DebugRenderer.h"
+#include "util/FrameProfiler.h"
 
 namespace vigilante {
 
@@ -29,7 +31,12 @@ class GameScene : public cocos2d::Scene, public Controllable {
   CREATE_FUNC(GameScene);
   virtual ~GameScene() = default;
 
+  // The key under which GameScene is suspended, see SceneManager::suspendScene().
+  static const std::string kSceneCacheKey;
+
   virtual bool init() override;  // cocos2d::Scene
+  virtual void onEnter() override;  // cocos2d::Scene
+  virtual void onExit() override;  // cocos2d::Scene
   virtual void update(float delta) override;  // cocos2d::Scene
   virtual void handleInput() override;  // Controllable
 
@@ -37,25 +44,55 @@ class GameScene : public cocos2d::Scene, public Controllable {
   void loadGame(const std::string& gameSaveFilePath);
 
  private:
+  // Advances the game by one frame.
+  void step(float delta);
+
+  // The part of step() which is measured by FrameProfiler.
+  // The b2World is stepped by `physicsTimeStep`, see FramePacer.
+  void profileFrame(float delta, float physicsTimeStep);
+
+  // Runs as many frames of the replay being played back as possible
+  // within REPLAY_PLAYBACK_TIME_SLICE, see InputManager::ReplayMode.
+  void stepPlayback();
+
+  // Same as stepPlayback(), but for the benchmark in progress, see GameplayBenchmark.
+  void stepBenchmark();
+
+  // Adds the wall time of the last frame to the telemetry, and dumps the
+  // flight recorder along with the state of the game if it was a hitch,
+  // see HitchDetector.
+  void recordFrameTime() const;
+
+  // Runs the `--exec` commands once the first GameMap has been loaded,
+  // and returns true when the headless run is over, see util/Headless.h.
+  bool updateHeadless();
+
+  // False if the module hasn't even been instantiated, see UiModuleRegistry.
+  bool isPauseMenuVisible() const;
+  bool isDialogueVisible() const;
+
   cocos2d::Camera* _gameCamera;
   cocos2d::Camera* _hudCamera;
   b2DebugRenderer* _b2dr;  // autorelease object
+  float _physicsTimeAccumulator;
+  double _playbackTime;  // wall time spent on the replay being played back
+  double _headlessTime;  // game time elapsed in the headless mode
+  bool _hasRunHeadlessCommands;
 
 
   // For singleton classes, use raw pointers here.
   // Otherwise, use smart pointers (prefer unique_ptr<>).
   Shade* _shade;
   Hud* _hud;
-  Console* _console;
-  PauseMenu* _pauseMenu;
   WindowManager* _windowManager;
   ControlHints *_controlHints;
-  DialogueManager* _dialogueManager;
   FloatingDamages* _floatingDamages;
   QuestHints* _questHints;
   Notifications* _notifications;
   GameMapManager* _gameMapManager;
   FxManager* _fxManager;
+  FrameProfiler* _frameProfiler;
+  PerformanceHud* _performanceHud;
 };
 
 }  // namespace vigilante
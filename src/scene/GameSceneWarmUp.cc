@@ -0,0 +1,82 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "GameSceneWarmUp.h"
+
+#include <chrono>
+
+#include "AssetManager.h"
+#include "character/Character.h"
+#include "map/FxManager.h"
+#include "map/GameMapManager.h"
+#include "ui/Shade.h"
+#include "ui/WindowManager.h"
+#include "ui/control_hints/ControlHints.h"
+#include "ui/floating_damages/FloatingDamages.h"
+#include "ui/hud/Hud.h"
+#include "ui/notifications/Notifications.h"
+#include "ui/quest_hints/QuestHints.h"
+#include "util/Logger.h"
+#include "util/MainThread.h"
+#include "util/ProfileCache.h"
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+using cocos2d::Node;
+
+namespace vigilante {
+
+GameSceneWarmUp* GameSceneWarmUp::getInstance() {
+  static GameSceneWarmUp instance;
+  return &instance;
+}
+
+GameSceneWarmUp::GameSceneWarmUp() : _stages(), _nextStage(), _retainedNodes() {
+  _stages.push_back([this]() {
+    // The b2World is created by GameMapManager's ctor.
+    GameMapManager* gameMapManager = GameMapManager::getInstance();
+    retain(gameMapManager->getLayer());
+    gameMapManager->prefetchGameMap(asset_manager::kNewGameInitialMap);
+  });
+  _stages.push_back([]() {
+    profile_cache::get<Character::Profile>(asset_manager::kPlayerJson);
+  });
+  _stages.push_back([this]() { retain(Shade::getInstance()->getImageView()); });
+  _stages.push_back([this]() { retain(Hud::getInstance()->getLayer()); });
+  _stages.push_back([this]() { retain(Notifications::getInstance()->getLayer()); });
+  _stages.push_back([this]() { retain(QuestHints::getInstance()->getLayer()); });
+  _stages.push_back([this]() { retain(FloatingDamages::getInstance()->getLayer()); });
+  _stages.push_back([this]() { retain(ControlHints::getInstance()->getLayer()); });
+  _stages.push_back([]() { WindowManager::getInstance(); });
+  _stages.push_back([]() { FxManager::getInstance(); });
+}
+
+void GameSceneWarmUp::update(float timeBudget) {
+  // e.g., the prefetched GameMapSpec.
+  main_thread::drain();
+
+  const steady_clock::time_point beginTime = steady_clock::now();
+  while (!isDone()) {
+    _stages[_nextStage++]();
+    if (duration<float>(steady_clock::now() - beginTime).count() >= timeBudget) {
+      break;
+    }
+  }
+}
+
+void GameSceneWarmUp::finish() {
+  if (!isDone()) {
+    VGLOG(LOG_INFO, "Finished warming up GameScene at stage %zu/%zu.", _nextStage, _stages.size());
+  }
+  _nextStage = _stages.size();
+  _retainedNodes.clear();
+}
+
+bool GameSceneWarmUp::isDone() const {
+  return _nextStage >= _stages.size();
+}
+
+
+void GameSceneWarmUp::retain(Node* node) {
+  _retainedNodes.pushBack(node);
+}
+
+}  // namespace vigilante
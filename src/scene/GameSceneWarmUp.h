@@ -0,0 +1,56 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_GAME_SCENE_WARM_UP_H_
+#define VIGILANTE_GAME_SCENE_WARM_UP_H_
+
+#include <functional>
+#include <vector>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// Prepares what GameScene::init() and starting a new game need while
+// MainMenuScene is idling, so that "New Game" doesn't have to do it all at once.
+//
+// The work is split into stages, which are run by update() within a small
+// time budget per frame, in this order:
+// 1. Start parsing kNewGameInitialMap on a worker thread and loading its
+//    tileset textures asynchronously (see GameMapManager::prefetchGameMap()).
+// 2. Parse the player's profile.
+// 3. Construct the singletons which GameScene adds to itself (the b2World,
+//    Hud, Notifications, ...), one per stage. The rarely used ones (e.g.,
+//    Console) are left to UiModuleRegistry.
+//
+// The singletons are all lazily constructed, so GameScene::init() simply
+// constructs the ones whose stages haven't been run yet.
+//
+// Their layers are autoreleased, so the warm-up retains them until
+// GameScene::init() has added them to the scene, and then calls finish().
+//
+// All methods must be called on the main thread.
+class GameSceneWarmUp final {
+ public:
+  static GameSceneWarmUp* getInstance();
+
+  // Runs the next stages within `timeBudget` seconds (at least one stage),
+  // and the tasks posted to the main thread by the worker threads.
+  void update(float timeBudget);
+
+  // Stops warming up, and releases the retained layers.
+  void finish();
+
+  bool isDone() const;
+
+ private:
+  GameSceneWarmUp();
+
+  void retain(cocos2d::Node* node);
+
+  std::vector<std::function<void ()>> _stages;
+  size_t _nextStage;
+  cocos2d::Vector<cocos2d::Node*> _retainedNodes;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_GAME_SCENE_WARM_UP_H_
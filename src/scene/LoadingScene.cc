@@ -0,0 +1,79 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "LoadingScene.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "AssetManager.h"
+#include "gl/ShaderRegistry.h"
+#include "gameplay/ExpPointTable.h"
+#include "gameplay/ItemPriceTable.h"
+#include "scene/MainMenuScene.h"
+#include "scene/SceneManager.h"
+#include "std/make_unique.h"
+#include "util/LabelUtil.h"
+#include "util/StringUtil.h"
+#include "util/Telemetry.h"
+
+using std::thread;
+using cocos2d::Director;
+using cocos2d::Label;
+using vigilante::asset_manager::kBoldFont;
+using vigilante::asset_manager::kRegularFontSize;
+
+namespace vigilante {
+
+// Leave the rest of the frame for rendering the progress.
+const float LoadingScene::_kCommitTimeBudget = 1.0f / 120;
+
+
+bool LoadingScene::init() {
+  if (!Scene::init()) {
+    return false;
+  }
+
+  _beginTime = std::chrono::steady_clock::now();
+  auto winSize = Director::getInstance()->getWinSize();
+
+  _label = label_util::create("Loading...", kBoldFont, kRegularFontSize);
+  _label->getFontAtlas()->setAliasTexParameters();
+  _label->setPosition(winSize.width / 2, winSize.height / 2);
+  addChild(_label);
+
+  // Keep one core for the main thread.
+  const int numWorkerThreads = std::max(static_cast<int>(thread::hardware_concurrency()) - 1, 1);
+  _assetLoader = std::make_unique<AssetLoader>(numWorkerThreads);
+
+  asset_manager::loadSpritesheetsAsync(asset_manager::kSpritesheetsList, *_assetLoader);
+  _assetLoader->addTask([]() {
+    if (!exp_point_table::importPack(asset_manager::kExpPointTablePack)) {
+      exp_point_table::import(asset_manager::kExpPointTable);
+    }
+  });
+  _assetLoader->addTask([]() {
+    if (!item_price_table::importPack(asset_manager::kItemPriceTablePack)) {
+      item_price_table::import(asset_manager::kItemPriceTable);
+    }
+  });
+  ShaderRegistry::getInstance()->warmUp(*_assetLoader);
+  _assetLoader->start();
+
+  schedule(schedule_selector(LoadingScene::update));
+  return true;
+}
+
+void LoadingScene::update(float) {
+  if (!_assetLoader->update(_kCommitTimeBudget)) {
+    const int percentage = static_cast<int>(_assetLoader->getProgress() * 100);
+    _label->setString(string_util::format("Loading... %d%%", percentage));
+    return;
+  }
+
+  unschedule(schedule_selector(LoadingScene::update));
+  _assetLoader.reset();
+  const std::chrono::duration<float> loadTime = std::chrono::steady_clock::now() - _beginTime;
+  Telemetry::getInstance()->addStartupPhase("assetLoading", loadTime.count());
+  SceneManager::getInstance()->replaceScene(MainMenuScene::create());
+}
+
+}  // namespace vigilante
@@ -0,0 +1,35 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_LOADING_SCENE_H_
+#define VIGILANTE_LOADING_SCENE_H_
+
+#include <chrono>
+#include <memory>
+
+#include <cocos2d.h>
+#include <2d/CCLabel.h>
+#include "AssetLoader.h"
+
+namespace vigilante {
+
+// The first scene shown at startup. It loads the spritesheets and the
+// gameplay tables on the worker threads of an AssetLoader while showing
+// the progress, and then replaces itself with MainMenuScene.
+class LoadingScene : public cocos2d::Scene {
+ public:
+  CREATE_FUNC(LoadingScene);
+  virtual ~LoadingScene() = default;
+
+  virtual bool init() override; // cocos2d::Scene
+  virtual void update(float delta) override; // cocos2d::Scene
+
+ private:
+  static const float _kCommitTimeBudget;
+
+  std::chrono::steady_clock::time_point _beginTime;
+  std::unique_ptr<AssetLoader> _assetLoader;
+  cocos2d::Label* _label;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_LOADING_SCENE_H_
@@ -1,11 +1,16 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "MainMenuScene.h"
 
-#include <SimpleAudioEngine.h>
 #include "AssetManager.h"
+#include "AudioManager.h"
 #include "scene/GameScene.h"
+#include "scene/GameSceneWarmUp.h"
 #include "scene/SceneManager.h"
 #include "ui/Colorscheme.h"
+#include "util/Headless.h"
+#include "util/LabelUtil.h"
+
+#define MAIN_THEME_FADE_OUT_DURATION .5f
 
 using std::array;
 using std::string;
@@ -14,7 +19,6 @@ using cocos2d::Scene;
 using cocos2d::Label;
 using cocos2d::ui::ImageView;
 using cocos2d::EventKeyboard;
-using CocosDenshion::SimpleAudioEngine;
 using vigilante::asset_manager::kBoldFont;
 using vigilante::asset_manager::kRegularFontSize;
 
@@ -33,6 +37,9 @@ const string MainMenuScene::_kVersionStr = "0.1.0 Alpha";
 const int MainMenuScene::_kMenuOptionGap = 20;
 const int MainMenuScene::_kFooterLabelPadding = 10;
 
+// Leave most of the frame for the menu itself.
+const float MainMenuScene::_kWarmUpTimeBudget = 1.0f / 240;
+
 
 bool MainMenuScene::init() {
   if (!Scene::init()) {
@@ -48,22 +55,22 @@ bool MainMenuScene::init() {
 
   // Initialize labels.
   for (int i = 0; i < static_cast<int>(Option::SIZE); i++) {
-    Label* label = Label::createWithTTF(_kOptionStr[i], kBoldFont, kRegularFontSize);
+    Label* label = label_util::create(_kOptionStr[i], kBoldFont, kRegularFontSize);
     label->getFontAtlas()->setAliasTexParameters();
     label->setPosition(winSize.width / 2, winSize.height / 2 - _kMenuOptionGap * (i + 1));
     addChild(label);
     _labels.push_back(label);
   }
   _current = 0;
-  _labels[_current]->setTextColor(vigilante::colorscheme::kRed);
+  label_util::setTextColor(_labels[_current], vigilante::colorscheme::kRed);
 
   // Initialize footer labels.
-  Label* copyrightLabel = Label::createWithTTF(_kCopyrightStr, kBoldFont, kRegularFontSize);
+  Label* copyrightLabel = label_util::create(_kCopyrightStr, kBoldFont, kRegularFontSize);
   copyrightLabel->setAnchorPoint({0.5, 0});
   copyrightLabel->setPosition(winSize.width / 2, copyrightLabel->getContentSize().height + _kFooterLabelPadding);
   addChild(copyrightLabel);
 
-  Label* versionLabel = Label::createWithTTF(_kVersionStr, kBoldFont, kRegularFontSize);
+  Label* versionLabel = label_util::create(_kVersionStr, kBoldFont, kRegularFontSize);
   versionLabel->setAnchorPoint({1, 0});
   versionLabel->setPosition(winSize.width - _kFooterLabelPadding, versionLabel->getContentSize().height + _kFooterLabelPadding);
   addChild(versionLabel);
@@ -72,14 +79,27 @@ bool MainMenuScene::init() {
   InputManager::getInstance()->activate(this);
 
   // Play main theme Bgm.
-  SimpleAudioEngine::getInstance()->playBackgroundMusic(asset_manager::kMainThemeBgm.c_str(), true);
+  AudioManager::getInstance()->playBgm(asset_manager::kMainThemeBgm, 0);
 
   schedule(schedule_selector(MainMenuScene::update));
   return true;
 }
 
-void MainMenuScene::update(float) {
+void MainMenuScene::update(float delta) {
+  // There's no one to choose an option in the headless mode. This scene is
+  // paused once GameScene is pushed, so this only happens once.
+  if (headless::isEnabled()) {
+    InputManager::getInstance()->deactivate();
+    SceneManager::getInstance()->pushScene(GameScene::create());
+    return;
+  }
+
+  AudioManager::getInstance()->update(delta);
+  InputManager::getInstance()->beginFrame();
   handleInput();
+
+  // Keep warming up GameScene while the player is choosing an option.
+  GameSceneWarmUp::getInstance()->update(_kWarmUpTimeBudget);
 }
 
 void MainMenuScene::handleInput() {
@@ -87,22 +107,29 @@ void MainMenuScene::handleInput() {
     if (_current == 0) {
       return;
     }
-    _labels[_current--]->setTextColor(vigilante::colorscheme::kWhite);
-    _labels[_current]->setTextColor(vigilante::colorscheme::kRed);
+    label_util::setTextColor(_labels[_current--], vigilante::colorscheme::kWhite);
+    label_util::setTextColor(_labels[_current], vigilante::colorscheme::kRed);
 
   } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_DOWN_ARROW)) {
     if (_current == static_cast<int>(Option::SIZE) - 1) {
       return;
     }
-    _labels[_current++]->setTextColor(vigilante::colorscheme::kWhite);
-    _labels[_current]->setTextColor(vigilante::colorscheme::kRed);
+    label_util::setTextColor(_labels[_current++], vigilante::colorscheme::kWhite);
+    label_util::setTextColor(_labels[_current], vigilante::colorscheme::kRed);
 
   } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_ENTER)) {
     switch (static_cast<Option>(_current)) {
       case Option::NEW_GAME: {
         InputManager::getInstance()->deactivate();
-        SimpleAudioEngine::getInstance()->stopBackgroundMusic();
-        SceneManager::getInstance()->pushScene(GameScene::create());
+        AudioManager::getInstance()->stopBgm(MAIN_THEME_FADE_OUT_DURATION);
+
+        // Go back to the game which the player has quit to this menu from, if it's
+        // still cached. Otherwise GameScene::init() will start a new game.
+        if (Scene* gameScene = SceneManager::getInstance()->resumeScene(GameScene::kSceneCacheKey)) {
+          InputManager::getInstance()->activate(gameScene);
+        } else {
+          SceneManager::getInstance()->pushScene(GameScene::create());
+        }
         break;
       }
       case Option::LOAD_GAME:
@@ -37,6 +37,7 @@ class MainMenuScene : public cocos2d::Scene, public Controllable {
 
   static const int _kMenuOptionGap;
   static const int _kFooterLabelPadding;
+  static const float _kWarmUpTimeBudget;  // in seconds per frame, see GameSceneWarmUp
 
   cocos2d::ui::ImageView* _background;
   std::vector<cocos2d::Label*> _labels;
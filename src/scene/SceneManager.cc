@@ -1,11 +1,33 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "SceneManager.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "util/Headless.h"
+#include "util/Logger.h"
+
+using std::string;
 using cocos2d::Director;
 using cocos2d::Scene;
 
 namespace vigilante {
 
+namespace {
+
+// The renderer doesn't visit the invisible scenes, so in the headless mode
+// nothing is drawn at all while the scenes are still updated as usual.
+void hideIfHeadless(Scene* scene) {
+  if (headless::isEnabled()) {
+    scene->setVisible(false);
+  }
+}
+
+}  // namespace
+
+const size_t SceneManager::_kDefaultTextureBudget = 256 * 1024;
+
 SceneManager* SceneManager::getInstance() {
   static SceneManager instance;
   return &instance;
@@ -14,18 +36,33 @@ SceneManager* SceneManager::getInstance() {
 
 SceneManager::SceneManager()
     : _director(Director::getInstance()),
-      _scenes() {}
+      _scenes(),
+      _suspendedScenes(),
+      _textureBudget(_kDefaultTextureBudget) {}
+
+SceneManager::~SceneManager() {
+  purgeSuspendedScenes();
+}
 
 void SceneManager::runWithScene(Scene* scene) {
+  hideIfHeadless(scene);
   _director->runWithScene(scene);
   _scenes.push(scene);
 }
 
 void SceneManager::pushScene(Scene* scene) {
+  hideIfHeadless(scene);
   _director->pushScene(scene);
   _scenes.push(scene);
 }
 
+void SceneManager::replaceScene(Scene* scene) {
+  hideIfHeadless(scene);
+  _director->replaceScene(scene);
+  _scenes.pop();
+  _scenes.push(scene);
+}
+
 void SceneManager::popScene() {
   _director->popScene();
   _scenes.pop();
@@ -35,4 +72,95 @@ Scene* SceneManager::getCurrentScene() const {
   return _scenes.top();
 }
 
+
+void SceneManager::suspendScene(const string& key) {
+  purgeSuspendedScene(key);
+
+  // Director releases the popped scene.
+  Scene* scene = getCurrentScene();
+  scene->retain();
+  popScene();
+
+  _suspendedScenes.push_back({key, scene});
+  enforceTextureBudget();
+}
+
+Scene* SceneManager::resumeScene(const string& key) {
+  auto it = std::find_if(_suspendedScenes.begin(), _suspendedScenes.end(),
+                         [&key](const SuspendedScene& s) { return s.key == key; });
+  if (it == _suspendedScenes.end()) {
+    return nullptr;
+  }
+
+  Scene* scene = it->scene;
+  _suspendedScenes.erase(it);
+  pushScene(scene);  // retained by Director now
+  scene->release();
+  return scene;
+}
+
+bool SceneManager::hasSuspendedScene(const string& key) const {
+  return std::any_of(_suspendedScenes.begin(), _suspendedScenes.end(),
+                     [&key](const SuspendedScene& s) { return s.key == key; });
+}
+
+void SceneManager::purgeSuspendedScene(const string& key) {
+  auto it = std::find_if(_suspendedScenes.begin(), _suspendedScenes.end(),
+                         [&key](const SuspendedScene& s) { return s.key == key; });
+  if (it == _suspendedScenes.end()) {
+    return;
+  }
+
+  it->scene->release();
+  _suspendedScenes.erase(it);
+}
+
+void SceneManager::purgeSuspendedScenes() {
+  for (const auto& s : _suspendedScenes) {
+    s.scene->release();
+  }
+  _suspendedScenes.clear();
+}
+
+void SceneManager::setTextureBudget(size_t textureBudget) {
+  _textureBudget = textureBudget;
+  enforceTextureBudget();
+}
+
+size_t SceneManager::getTextureBudget() const {
+  return _textureBudget;
+}
+
+
+void SceneManager::enforceTextureBudget() {
+  while (!_suspendedScenes.empty()) {
+    const size_t textureMemory = getTextureMemory();
+    if (textureMemory <= _textureBudget) {
+      return;
+    }
+
+    VGLOG(LOG_INFO, "Texture memory %zu KB exceeds the scene cache budget %zu KB, purging: %s",
+          textureMemory, _textureBudget, _suspendedScenes.front().key.c_str());
+    _suspendedScenes.front().scene->release();
+    _suspendedScenes.erase(_suspendedScenes.begin());
+
+    // Whatever the purged scene was the last user of.
+    _director->getTextureCache()->removeUnusedTextures();
+  }
+}
+
+size_t SceneManager::getTextureMemory() {
+  // TextureCache doesn't expose its textures, so parse the summary
+  // line of its debug info, i.e., "... N textures, for M KB (... MB)".
+  const string info = Director::getInstance()->getTextureCache()->getCachedTextureInfo();
+  const char* summary = std::strstr(info.c_str(), "dumpDebugInfo:");
+  long numTextures = 0;
+  unsigned long textureMemory = 0;
+  if (!summary ||
+      std::sscanf(summary, "dumpDebugInfo: %ld textures, for %lu KB", &numTextures, &textureMemory) != 2) {
+    return 0;
+  }
+  return textureMemory;
+}
+
 }  // namespace vigilante
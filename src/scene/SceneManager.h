@@ -3,6 +3,8 @@
 #define VIGILANTE_SCENE_MANAGER_H_
 
 #include <stack>
+#include <string>
+#include <vector>
 
 #include <cocos2d.h>
 
@@ -12,22 +14,65 @@ namespace vigilante {
 // it doesn't allow me to fucking pop a scene and
 // get the next scene immediately, so I end up implementing
 // this class.
-
+//
+// Scene cache: instead of being destroyed, a popped scene can be kept
+// (retained) under a key with suspendScene(), and pushed back later with
+// resumeScene(), e.g., quitting to the main menu and going back to the game
+// doesn't have to reload the GameMap or rebuild the UI.
+//
+// While a scene is suspended it's neither visited nor updated, since Director
+// cleans up a popped scene (i.e., unschedules its selectors and stops its
+// actions). A cacheable scene must therefore (re)schedule its selectors in
+// onEnter(), which is also called when it's resumed.
+//
+// The textures used by the suspended scenes stay resident as long as the
+// total texture memory is within the cache's texture budget. Otherwise,
+// the least recently suspended scenes are purged until it is.
 class SceneManager final {
  public:
   static SceneManager* getInstance();
-  virtual ~SceneManager() = default;
+  virtual ~SceneManager();
 
   void runWithScene(cocos2d::Scene* scene);
   void pushScene(cocos2d::Scene* scene);
+  void replaceScene(cocos2d::Scene* scene);
   void popScene();
   cocos2d::Scene* getCurrentScene() const;
 
+  // Pops the current scene, but keeps it in the scene cache under `key`.
+  void suspendScene(const std::string& key);
+  // Pushes the scene cached under `key`, and removes it from the cache.
+  // Returns nullptr (and does nothing) if there's no such scene.
+  cocos2d::Scene* resumeScene(const std::string& key);
+  bool hasSuspendedScene(const std::string& key) const;
+
+  // Releases the suspended scene(s), e.g., on low memory.
+  void purgeSuspendedScene(const std::string& key);
+  void purgeSuspendedScenes();
+
+  void setTextureBudget(size_t textureBudget);  // in KB
+  size_t getTextureBudget() const;
+
  private:
+  struct SuspendedScene final {
+    std::string key;
+    cocos2d::Scene* scene;  // retained
+  };
+
   SceneManager();
 
+  // Purges the least recently suspended scenes until the
+  // total texture memory is within `_textureBudget`.
+  void enforceTextureBudget();
+  static size_t getTextureMemory();  // in KB
+
+  static const size_t _kDefaultTextureBudget;
+
   cocos2d::Director* _director;
   std::stack<cocos2d::Scene*> _scenes;
+
+  std::vector<SceneManager::SuspendedScene> _suspendedScenes;  // the least recently suspended first
+  size_t _textureBudget;
 };
 
 }  // namespace vigilante
@@ -6,6 +6,7 @@
 #include "CallbackManager.h"
 #include "character/Character.h"
 #include "map/GameMapManager.h"
+#include "util/ProfileCache.h"
 
 using std::string;
 using std::shared_ptr;
@@ -15,13 +16,13 @@ namespace vigilante {
 
 BackDash::BackDash(const string& jsonFileName, Character* user)
     : Skill(),
-      _skillProfile(jsonFileName),
+      _skillProfile(*profile_cache::get<Skill::Profile>(jsonFileName)),
       _user(user),
       _hasActivated() {}
 
 
 void BackDash::import(const string& jsonFileName) {
-  _skillProfile = Skill::Profile(jsonFileName);
+  _skillProfile = *profile_cache::get<Skill::Profile>(jsonFileName);
 }
 
 EventKeyboard::KeyCode BackDash::getHotkey() const {
@@ -47,10 +48,19 @@ void BackDash::activate() {
   float oldBodyDamping = _user->getBody()->GetLinearDamping();
   _user->getBody()->SetLinearDamping(4.0f);
 
+  if (_skillProfile.isBullet) {
+    GameMapManager::getInstance()->setBullet(_user->getBody(), true);
+  }
+
   CallbackManager::getInstance()->runAfter([=]() {
+    GameMapManager::getInstance()->setBullet(_user->getBody(), false);
     _user->getBody()->SetLinearDamping(oldBodyDamping);
     _user->removeActiveSkill(this);
-  }, _skillProfile.framesDuration);
+  }, _skillProfile.framesDuration, _user);
+}
+
+void BackDash::reset() {
+  _hasActivated = false;
 }
 
 
@@ -63,7 +73,7 @@ const string& BackDash::getName() const {
 }
 
 const string& BackDash::getDesc() const {
-  return _skillProfile.desc;
+  return _skillProfile.desc.getText();
 }
 
 string BackDash::getIconPath() const {
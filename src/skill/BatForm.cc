@@ -6,6 +6,7 @@
 #include "CallbackManager.h"
 #include "character/Character.h"
 #include "map/GameMapManager.h"
+#include "util/ProfileCache.h"
 
 using std::string;
 using std::shared_ptr;
@@ -15,13 +16,13 @@ namespace vigilante {
 
 BatForm::BatForm(const string& jsonFileName, Character* user)
     : Skill(),
-      _skillProfile(jsonFileName),
+      _skillProfile(*profile_cache::get<Skill::Profile>(jsonFileName)),
       _user(user),
       _hasActivated() {}
 
 
 void BatForm::import(const string& jsonFileName) {
-  _skillProfile = Skill::Profile(jsonFileName);
+  _skillProfile = *profile_cache::get<Skill::Profile>(jsonFileName);
 }
 
 EventKeyboard::KeyCode BatForm::getHotkey() const {
@@ -34,7 +35,7 @@ void BatForm::setHotkey(EventKeyboard::KeyCode hotkey) {
 
 bool BatForm::canActivate() {
   return !_user->isWeaponSheathed()
-    && _user->getCharacterProfile().stamina + _skillProfile.deltaStamina >= 0;
+    && _user->getStat(StatsSystem::Stat::STAMINA) + _skillProfile.deltaStamina >= 0;
 }
 
 void BatForm::activate() {
@@ -43,7 +44,7 @@ void BatForm::activate() {
   }
 
   // Modify character's stats.
-  _user->getCharacterProfile().stamina += _skillProfile.deltaStamina;
+  _user->modifyStat(StatsSystem::Stat::STAMINA, _skillProfile.deltaStamina);
 
   float rushPower = (_user->isFacingRight()) ? 5.0f : -5.0f;
   _user->getBody()->SetLinearVelocity({rushPower, 0});
@@ -54,12 +55,21 @@ void BatForm::activate() {
   _user->setInvincible(true);
   _user->getFixtures()[Character::FixtureType::BODY]->SetSensor(true);
 
+  if (_skillProfile.isBullet) {
+    GameMapManager::getInstance()->setBullet(_user->getBody(), true);
+  }
+
   CallbackManager::getInstance()->runAfter([=]() {
+    GameMapManager::getInstance()->setBullet(_user->getBody(), false);
     _user->getBody()->SetLinearDamping(oldBodyDamping);
     _user->setInvincible(false);
     _user->getFixtures()[Character::FixtureType::BODY]->SetSensor(false);
     _user->removeActiveSkill(this);
-  }, _skillProfile.framesDuration);
+  }, _skillProfile.framesDuration, _user);
+}
+
+void BatForm::reset() {
+  _hasActivated = false;
 }
 
 
@@ -72,7 +82,7 @@ const string& BatForm::getName() const {
 }
 
 const string& BatForm::getDesc() const {
-  return _skillProfile.desc;
+  return _skillProfile.desc.getText();
 }
 
 string BatForm::getIconPath() const {
@@ -20,6 +20,7 @@ class BatForm : public Skill {
   virtual void setHotkey(cocos2d::EventKeyboard::KeyCode hotkey) override;  // Skill
   virtual bool canActivate() override;  // Skill
   virtual void activate() override;  // Skill
+  virtual void reset() override;  // Skill
 
   virtual Skill::Profile& getSkillProfile() override;  // Skill
   virtual const std::string& getName() const override;  // Skill
@@ -10,12 +10,14 @@
 #include "map/GameMapManager.h"
 #include "util/box2d/b2BodyBuilder.h"
 #include "util/Logger.h"
+#include "util/ProfileCache.h"
 
 #define MAGICAL_MISSILE_NUM_ANIMATIONS MagicalMissile::AnimationType::SIZE
 #define MAGICAL_MISSILE_NUM_FIXTURES 1
 
 #define MAGICAL_MISSILE_CATEOGRY_BITS kProjectile
 #define MAGICAL_MISSILE_MASK_BITS kPlayer | kEnemy | kWall
+#define MAGICAL_MISSILE_MAX_FLYING_TIME 5.0f
 
 using std::string;
 using std::function;
@@ -31,7 +33,6 @@ using cocos2d::Repeat;
 using cocos2d::RepeatForever;
 using cocos2d::Sprite;
 using cocos2d::SpriteFrame;
-using cocos2d::SpriteBatchNode;
 using cocos2d::SpriteFrameCache;
 using cocos2d::Animation;
 using cocos2d::EventKeyboard;
@@ -44,8 +45,10 @@ namespace vigilante {
 
 MagicalMissile::MagicalMissile(const string& jsonFileName, Character* user)
     : DynamicActor(MAGICAL_MISSILE_NUM_ANIMATIONS, MAGICAL_MISSILE_NUM_FIXTURES),
-      _skillProfile(jsonFileName),
+      _skillProfile(*profile_cache::get<Skill::Profile>(jsonFileName)),
       _user(user),
+      _flyingSpeed(),
+      _flyingTimer(),
       _hasActivated(),
       _hasHit(),
       _launchFxSprite() {}
@@ -65,23 +68,55 @@ bool MagicalMissile::showOnMap(float x, float y) {
              MAGICAL_MISSILE_MASK_BITS);
 
   defineTexture(_skillProfile.textureResDir, x, y);
-  GameMapManager::getInstance()->getLayer()->addChild(_bodySpritesheet,
-                                                      graphical_layers::kSpell);
+
+  // The missiles of the same skill share a batch node, so that a volley
+  // of them (e.g., a group of casters) is still drawn in one draw call.
+  BatchNodeRegistry* batchNodeRegistry = GameMapManager::getInstance()->getBatchNodeRegistry();
+  batchNodeRegistry->addChild(_launchFxSprite, graphical_layers::kSpell);
+  batchNodeRegistry->addChild(_bodySprite, graphical_layers::kSpell);
   return true;
 }
 
+bool MagicalMissile::removeFromMap() {
+  if (_isShownOnMap && _launchFxSprite) {
+    _launchFxSprite->removeFromParent();
+    _launchFxSprite = nullptr;
+  }
+  return DynamicActor::removeFromMap();
+}
+
 void MagicalMissile::update(float delta) {
   DynamicActor::update(delta);
   
-  // If _body goes out of map, then we can delete this object.
+  // If _body goes out of map or has been flying for too long,
+  // then we can delete this object.
   float x = _body->GetPosition().x * kPpm;
   float y = _body->GetPosition().y * kPpm;
   GameMap* gameMap = GameMapManager::getInstance()->getGameMap();
+  _flyingTimer += delta;
 
   if (!_hasHit &&
-      (x < 0 || x > gameMap->getWidth() || y < 0 || y > gameMap->getHeight())) {
+      (x < 0 || x > gameMap->getWidth() || y < 0 || y > gameMap->getHeight() ||
+       _flyingTimer > MAGICAL_MISSILE_MAX_FLYING_TIME)) {
     onHit(nullptr);
   }
+
+  if (!_hasHit) {
+    GameMapManager::getInstance()->getLightMap()->submit(_skillProfile.light, x, y);
+  }
+}
+
+void MagicalMissile::destroyBody() {
+  if (!_body) {
+    return;
+  }
+
+  // Return _body to the pool instead of destroying it.
+  GameMapManager::getInstance()->setBullet(_body, false);
+  GameMapManager::getInstance()->getProjectilePool()->release(_skillProfile.jsonFileName, _body);
+  _body = nullptr;
+  _fixtures[0] = nullptr;
+  _hasPreviousBodyPos = false;
 }
 
 
@@ -120,7 +155,7 @@ void MagicalMissile::onHit(Character* target) {
 
 
 void MagicalMissile::import(const string& jsonFileName) {
-  _skillProfile = Skill::Profile(jsonFileName);
+  _skillProfile = *profile_cache::get<Skill::Profile>(jsonFileName);
 }
 
 EventKeyboard::KeyCode MagicalMissile::getHotkey() const {
@@ -132,7 +167,7 @@ void MagicalMissile::setHotkey(EventKeyboard::KeyCode hotkey) {
 }
 
 bool MagicalMissile::canActivate() {
-  return _user->getCharacterProfile().magicka + _skillProfile.deltaMagicka >= 0;
+  return _user->getStat(StatsSystem::Stat::MAGICKA) + _skillProfile.deltaMagicka >= 0;
 }
 
 void MagicalMissile::activate() {
@@ -146,7 +181,7 @@ void MagicalMissile::activate() {
   float y = _user->getBody()->GetPosition().y;
 
   // Modify character's stats.
-  _user->getCharacterProfile().magicka += _skillProfile.deltaMagicka;
+  _user->modifyStat(StatsSystem::Stat::MAGICKA, _skillProfile.deltaMagicka);
 
   shared_ptr<Skill> activeCopy = _user->getActiveSkill(this);
   assert(activeCopy);
@@ -177,11 +212,20 @@ void MagicalMissile::activate() {
   _launchFxSprite->runAction(Sequence::createWithTwoActions(
     Animate::create(_bodyAnimations[AnimationType::LAUNCH_FX]),
     CallFunc::create([=]() {
-      _bodySpritesheet->removeChild(_launchFxSprite, true);
+      _launchFxSprite->removeFromParent();
+      _launchFxSprite = nullptr;
     })
   ));
 }
 
+void MagicalMissile::reset() {
+  _flyingSpeed = 0;
+  _flyingTimer = 0;
+  _hasActivated = false;
+  _hasHit = false;
+  _launchFxSprite = nullptr;
+}
+
 
 Skill::Profile& MagicalMissile::getSkillProfile() {
   return _skillProfile;
@@ -192,7 +236,7 @@ const string& MagicalMissile::getName() const {
 }
 
 const string& MagicalMissile::getDesc() const {
-  return _skillProfile.desc;
+  return _skillProfile.desc.getText();
 }
 
 string MagicalMissile::getIconPath() const {
@@ -208,30 +252,38 @@ void MagicalMissile::defineBody(b2BodyType bodyType,
   float spellOffset = _user->getCharacterProfile().attackRange / kPpm;
   spellOffset = (_user->isFacingRight()) ? spellOffset : -spellOffset;
 
-  b2World* world = _user->getBody()->GetWorld();
-  b2BodyBuilder bodyBuilder(world);
-
-  _body = bodyBuilder.type(bodyType)
-    .position(x + spellOffset, y, 1)
-    .buildBody();
-
-  float scaleFactor = Director::getInstance()->getContentScaleFactor();
-  b2Vec2 vertices[4];
-  vertices[0] = {-10.0f / scaleFactor,  0.0f / scaleFactor};
-  vertices[1] = {  0.0f / scaleFactor, -2.0f / scaleFactor};
-  vertices[2] = { 10.0f / scaleFactor,  0.0f / scaleFactor};
-  vertices[3] = {  0.0f / scaleFactor,  2.0f / scaleFactor};
-
-  _fixtures[0] = bodyBuilder.newPolygonFixture(vertices, 4, kPpm)
-    .categoryBits(categoryBits)
-    .maskBits(maskBits)
-    .setUserData(this)
-    .buildFixture();
+  // The bodies of magical missiles are pooled (see ProjectilePool),
+  // so this factory is only called when the pool runs out of bodies.
+  auto bodyFactory = [bodyType, categoryBits, maskBits](b2World* world) {
+    b2BodyBuilder bodyBuilder(world);
+
+    b2Body* body = bodyBuilder.type(bodyType)
+      .position(0, 0, 1)
+      .buildBody();
+
+    float scaleFactor = Director::getInstance()->getContentScaleFactor();
+    b2Vec2 vertices[4];
+    vertices[0] = {-10.0f / scaleFactor,  0.0f / scaleFactor};
+    vertices[1] = {  0.0f / scaleFactor, -2.0f / scaleFactor};
+    vertices[2] = { 10.0f / scaleFactor,  0.0f / scaleFactor};
+    vertices[3] = {  0.0f / scaleFactor,  2.0f / scaleFactor};
+
+    bodyBuilder.newPolygonFixture(vertices, 4, kPpm)
+      .categoryBits(categoryBits)
+      .maskBits(maskBits)
+      .buildFixture();
+    return body;
+  };
+
+  _body = GameMapManager::getInstance()->getProjectilePool()->acquire(
+      _skillProfile.jsonFileName, bodyFactory, {x + spellOffset, y}, this);
+  _fixtures[0] = _body->GetFixtureList();
+  if (_skillProfile.isBullet) {
+    GameMapManager::getInstance()->setBullet(_body, true);
+  }
 }
 
 void MagicalMissile::defineTexture(const string& textureResDir, float x, float y) {
-  _bodySpritesheet = SpriteBatchNode::create(textureResDir + "/spritesheet.png");
-
   _bodyAnimations[AnimationType::LAUNCH_FX] = createAnimation(textureResDir, "launch", 5.0f / kPpm);
   _bodyAnimations[AnimationType::FLYING] = createAnimation(textureResDir, "flying", 1.0f / kPpm);
   _bodyAnimations[AnimationType::ON_HIT] = createAnimation(textureResDir, "on_hit", 8.0f / kPpm);
@@ -242,10 +294,6 @@ void MagicalMissile::defineTexture(const string& textureResDir, float x, float y
   _launchFxSprite->setPosition(x, y);
   _bodySprite = Sprite::createWithSpriteFrameName(frameNamePrefix + "_flying/0.png");
   _bodySprite->setPosition(x, y);
-  
-  _bodySpritesheet->addChild(_launchFxSprite);
-  _bodySpritesheet->addChild(_bodySprite);
-  _bodySpritesheet->getTexture()->setAliasTexParameters();
 }
 
 }  // namespace vigilante
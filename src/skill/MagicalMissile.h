@@ -20,7 +20,9 @@ class MagicalMissile : public DynamicActor, public Skill, public Projectile {
   virtual ~MagicalMissile() = default;
 
   virtual bool showOnMap(float x, float y) override;  // DynamicActor
+  virtual bool removeFromMap() override;  // DynamicActor
   virtual void update(float delta) override;  // DynamicActor
+  virtual void destroyBody() override;  // DynamicActor
 
   virtual Character* getUser() const override;  // Projectile
   virtual int getDamage() const override;  // Projectile
@@ -31,6 +33,7 @@ class MagicalMissile : public DynamicActor, public Skill, public Projectile {
   virtual void setHotkey(cocos2d::EventKeyboard::KeyCode hotkey) override;  // Skill
   virtual bool canActivate() override;  // Skill
   virtual void activate() override;  // Skill
+  virtual void reset() override;  // Skill
 
   virtual Skill::Profile& getSkillProfile() override;  // Skill
   virtual const std::string& getName() const override;  // Skill
@@ -49,6 +52,7 @@ class MagicalMissile : public DynamicActor, public Skill, public Projectile {
   Skill::Profile _skillProfile;
   Character* _user;
   float _flyingSpeed;
+  float _flyingTimer;
   bool _hasActivated;
   bool _hasHit;
 
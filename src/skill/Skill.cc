@@ -34,16 +34,23 @@ unique_ptr<Skill> Skill::create(const string& jsonFileName, Character* user) {
 
 
 Skill::Profile::Profile(const string& jsonFileName) : jsonFileName(jsonFileName), hotkey() {
-  Document json = json_util::parseJson(jsonFileName);
+  json_util::JsonDocument jsonDocument(jsonFileName);
+  Document& json = jsonDocument.get();
 
   skillType = static_cast<Skill::Type>(json["skillType"].GetInt());
   characterFramesName = json["characterFramesName"].GetString();
   framesDuration = json["framesDuration"].GetFloat();
   frameInterval = json["frameInterval"].GetFloat();
 
+  frameEvents = (json.HasMember("frameEvents")) ?
+      FrameAnimator::parseEventTrack(json["frameEvents"]) : FrameAnimator::kNoEvents;
+  if (frameEvents[FrameAnimator::Event::END] < 0) {
+    frameEvents[FrameAnimator::Event::END] = FrameAnimator::kAfterLastFrame;
+  }
+
   textureResDir = json["textureResDir"].GetString();
   name = json["name"].GetString();
-  desc = json["desc"].GetString();
+  desc = TextId(json["desc"].GetString());
 
   requiredLevel = json["requiredLevel"].GetInt();
   cooldown = json["cooldown"].GetFloat();
@@ -54,6 +61,19 @@ Skill::Profile::Profile(const string& jsonFileName) : jsonFileName(jsonFileName)
   deltaHealth = json["deltaHealth"].GetInt();
   deltaMagicka = json["deltaMagicka"].GetInt();
   deltaStamina = json["deltaStamina"].GetInt();
+
+  // All the skills so far are fast movers.
+  isBullet = (json.HasMember("isBullet")) ? json["isBullet"].GetBool() : true;
+
+  if (json.HasMember("sfx")) {
+    sfx = json["sfx"].GetString();
+  }
+  if (json.HasMember("particles")) {
+    particles = ParticleSystem::Emitter(json["particles"]);
+  }
+  if (json.HasMember("light")) {
+    light = LightMap::Light(json["light"]);
+  }
 }
 
 }  // namespace vigilante
@@ -6,8 +6,12 @@
 #include <string>
 
 #include <cocos2d.h>
+#include "FrameAnimator.h"
 #include "Importable.h"
 #include "input/Keybindable.h"
+#include "map/LightMap.h"
+#include "map/ParticleSystem.h"
+#include "util/TextId.h"
 
 namespace vigilante {
 
@@ -33,10 +37,13 @@ class Skill : public Importable, public Keybindable {
     std::string characterFramesName;
     float framesDuration;
     float frameInterval;
+    // optional, of the user's animation (characterFramesName). The skill ends at
+    // its END, which is after the last frame by default (see Character::activateSkill()).
+    FrameAnimator::EventTrack frameEvents;
 
     std::string textureResDir;  // the animation of skill itself
     std::string name;
-    std::string desc;
+    TextId desc;
     
     int requiredLevel;
     float cooldown;
@@ -48,6 +55,15 @@ class Skill : public Importable, public Keybindable {
     int deltaMagicka;
     int deltaStamina;
 
+    // Whether the body moved by this skill (the user's, or the projectile's)
+    // needs continuous collision while the skill is active, so that it
+    // doesn't tunnel through thin walls (see GameMapManager::setBullet()).
+    bool isBullet;
+
+    std::string sfx;  // optional, played when the skill is activated (see AudioManager)
+    ParticleSystem::Emitter particles;  // optional, emitted when the skill is activated
+    LightMap::Light light;  // optional, the light of the projectile on dark maps
+
     cocos2d::EventKeyboard::KeyCode hotkey;
   };
 
@@ -64,6 +80,10 @@ class Skill : public Importable, public Keybindable {
   virtual bool canActivate() = 0;
   virtual void activate() = 0;
 
+  // Active skill instances are pooled by their users (see
+  // Character::activateSkill()), and reset before being activated again.
+  virtual void reset() = 0;
+
   virtual Skill::Profile& getSkillProfile() = 0;
   virtual const std::string& getName() const = 0;
   virtual const std::string& getDesc() const = 0;
@@ -0,0 +1,268 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "InventoryQuery.h"
+
+#include <algorithm>
+
+#include "gameplay/ItemPriceTable.h"
+#include "item/Equipment.h"
+#include "util/FrameArena.h"
+#include "util/StringUtil.h"
+
+using std::string;
+using std::vector;
+
+namespace vigilante {
+
+InventoryQuery::InventoryQuery()
+    : _owner(),
+      _itemType(),
+      _sortKey(InventoryQuery::SortKey::NAME),
+      _filter(),
+      _entries(),
+      _entriesRevision(),
+      _areEntriesValid(),
+      _matches(),
+      _results(),
+      _areMatchesValid() {}
+
+
+void InventoryQuery::setOwner(Character* owner) {
+  if (owner != _owner) {
+    _owner = owner;
+    invalidate();
+  }
+}
+
+void InventoryQuery::setItemType(Item::Type itemType) {
+  if (itemType != _itemType) {
+    _itemType = itemType;
+    invalidate();
+  }
+}
+
+
+InventoryQuery::SortKey InventoryQuery::getSortKey() const {
+  return _sortKey;
+}
+
+void InventoryQuery::setSortKey(InventoryQuery::SortKey sortKey) {
+  if (sortKey == _sortKey) {
+    return;
+  }
+
+  _sortKey = sortKey;
+
+  // The sort keys have been computed already, so only the order changes.
+  std::stable_sort(_entries.begin(), _entries.end(), [this](const Entry& e1, const Entry& e2) {
+    return compare(e1, e2);
+  });
+  _areMatchesValid = false;
+}
+
+void InventoryQuery::cycleSortKey() {
+  const int next = (static_cast<int>(_sortKey) + 1) % static_cast<int>(SortKey::SIZE);
+  setSortKey(static_cast<SortKey>(next));
+}
+
+string InventoryQuery::getSortKeyName() const {
+  switch (_sortKey) {
+    case SortKey::NAME:
+      return "Name";
+    case SortKey::PRICE:
+      return "Price";
+    case SortKey::AMOUNT:
+      return "Amount";
+    case SortKey::TYPE:
+      return "Type";
+    default:
+      return "";
+  }
+}
+
+
+const string& InventoryQuery::getFilter() const {
+  return _filter;
+}
+
+void InventoryQuery::setFilter(const string& filter) {
+  string newFilter = filter;
+  string_util::toLower(newFilter);
+
+  if (newFilter == _filter) {
+    return;
+  }
+
+  const bool isNarrowing = string_util::startsWith(newFilter, _filter);
+  _filter = std::move(newFilter);
+
+  if (!_areMatchesValid || !isNarrowing) {
+    _areMatchesValid = false;
+    return;
+  }
+
+  // The new filter is more specific than the previous one,
+  // so only the previous matches have to be tested again.
+  _matches.erase(std::remove_if(_matches.begin(), _matches.end(), [this](size_t i) {
+    return !matchesFilter(_entries[i]);
+  }), _matches.end());
+
+  _results.clear();
+  for (auto i : _matches) {
+    _results.push_back(_entries[i].item);
+  }
+}
+
+
+const vector<Item*>& InventoryQuery::getResults() {
+  if (!_owner) {
+    _results.clear();
+    return _results;
+  }
+
+  if (!_areEntriesValid || _entriesRevision != _owner->getInventoryRevision()) {
+    syncEntries();
+  }
+
+  if (!_areMatchesValid) {
+    _matches.clear();
+    _results.clear();
+    for (size_t i = 0; i < _entries.size(); i++) {
+      if (matchesFilter(_entries[i])) {
+        _matches.push_back(i);
+        _results.push_back(_entries[i].item);
+      }
+    }
+    _areMatchesValid = true;
+  }
+
+  return _results;
+}
+
+
+InventoryQuery::Entry InventoryQuery::createEntry(Item* item, int price) const {
+  Equipment* equipment = dynamic_cast<Equipment*>(item);
+
+  Entry entry{
+    item,
+    item->getItemProfile().nameId.getValue(),
+    item->getName(),
+    price,
+    item->getAmount(),
+    (equipment) ? equipment->getEquipmentProfile().equipmentType : Equipment::Type::SIZE
+  };
+  string_util::toLower(entry.name);
+  return entry;
+}
+
+bool InventoryQuery::compare(const InventoryQuery::Entry& e1,
+                             const InventoryQuery::Entry& e2) const {
+  // Ties are broken by the names, and then the name ids (which are unique).
+  switch (_sortKey) {
+    case SortKey::PRICE:
+      if (e1.price != e2.price) {
+        return e1.price > e2.price;
+      }
+      break;
+    case SortKey::AMOUNT:
+      if (e1.amount != e2.amount) {
+        return e1.amount > e2.amount;
+      }
+      break;
+    case SortKey::TYPE:
+      if (e1.type != e2.type) {
+        return e1.type < e2.type;
+      }
+      break;
+    case SortKey::NAME:
+    default:
+      break;
+  }
+
+  if (e1.name != e2.name) {
+    return e1.name < e2.name;
+  }
+  return e1.nameId < e2.nameId;
+}
+
+void InventoryQuery::insertEntry(InventoryQuery::Entry&& entry) {
+  auto it = std::upper_bound(_entries.begin(), _entries.end(), entry,
+                             [this](const Entry& e1, const Entry& e2) {
+    return compare(e1, e2);
+  });
+  _entries.insert(it, std::move(entry));
+}
+
+bool InventoryQuery::matchesFilter(const InventoryQuery::Entry& entry) const {
+  return _filter.empty() || string_util::startsWith(entry.name, _filter);
+}
+
+
+void InventoryQuery::syncEntries() {
+  const vector<Item*>& items = _owner->getInventory()[_itemType];
+  _entriesRevision = _owner->getInventoryRevision();
+  _areMatchesValid = false;
+
+  if (!_areEntriesValid) {
+    vector<int> prices;
+    item_price_table::getPrices(items, &prices);
+
+    _entries.clear();
+    _entries.reserve(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+      _entries.push_back(createEntry(items[i], prices[i]));
+    }
+    std::sort(_entries.begin(), _entries.end(), [this](const Entry& e1, const Entry& e2) {
+      return compare(e1, e2);
+    });
+    _areEntriesValid = true;
+    return;
+  }
+
+  // The items which are no longer in the inventory may have been deleted,
+  // so the entries are only dereferenced if their items are still there.
+  // These are only needed in this call, see FrameArena.
+  const FrameUnorderedSet<Item*> currentItems(items.begin(), items.end());
+  FrameUnorderedSet<Item*> indexedItems;
+  FrameVector<Entry> movedEntries;
+
+  size_t n = 0;
+  for (size_t i = 0; i < _entries.size(); i++) {
+    Entry& entry = _entries[i];
+    if (!currentItems.count(entry.item) ||
+        entry.nameId != entry.item->getItemProfile().nameId.getValue()) {
+      continue;
+    }
+    indexedItems.insert(entry.item);
+
+    // Only the order by amount is affected by a change of amount.
+    if (entry.amount != entry.item->getAmount()) {
+      entry.amount = entry.item->getAmount();
+      if (_sortKey == SortKey::AMOUNT) {
+        movedEntries.push_back(std::move(entry));
+        continue;
+      }
+    }
+    if (n != i) {
+      _entries[n] = std::move(entry);
+    }
+    n++;
+  }
+  _entries.erase(_entries.begin() + n, _entries.end());
+
+  for (auto& entry : movedEntries) {
+    insertEntry(std::move(entry));
+  }
+
+  for (auto item : items) {
+    if (!indexedItems.count(item)) {
+      insertEntry(createEntry(item, item_price_table::getPrice(item)));
+    }
+  }
+}
+
+void InventoryQuery::invalidate() {
+  _areEntriesValid = false;
+  _areMatchesValid = false;
+}
+
+}  // namespace vigilante
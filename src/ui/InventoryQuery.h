@@ -0,0 +1,84 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_INVENTORY_QUERY_H_
+#define VIGILANTE_INVENTORY_QUERY_H_
+
+#include <string>
+#include <vector>
+
+#include "character/Character.h"
+#include "item/Item.h"
+
+namespace vigilante {
+
+// A sorted and filtered view of one category of a character's inventory,
+// used by ItemListView and TradeListView.
+//
+// The sort keys of each item are computed once when the item enters the view.
+// When the inventory changes (see Character::getInventoryRevision()),
+// only the added / removed / re-counted items are merged into the view,
+// so the whole category is never re-sorted just because a menu is opened.
+// Extending the filter (i.e., typing one more character) only narrows
+// the previous results.
+class InventoryQuery final {
+ public:
+  enum class SortKey {
+    NAME,
+    PRICE,   // most expensive first
+    AMOUNT,  // most first
+    TYPE,    // equipment type
+    SIZE
+  };
+
+  InventoryQuery();
+
+  void setOwner(Character* owner);
+  void setItemType(Item::Type itemType);
+
+  InventoryQuery::SortKey getSortKey() const;
+  void setSortKey(InventoryQuery::SortKey sortKey);
+  void cycleSortKey();
+  std::string getSortKeyName() const;
+
+  // Only the items whose names start with `filter` (case-insensitive) are kept.
+  const std::string& getFilter() const;
+  void setFilter(const std::string& filter);
+
+  const std::vector<Item*>& getResults();
+
+ private:
+  struct Entry final {
+    Item* item;
+    uint32_t nameId;
+    std::string name;  // lowercase
+    int price;
+    int amount;
+    int type;
+  };
+
+  InventoryQuery::Entry createEntry(Item* item, int price) const;
+  bool compare(const InventoryQuery::Entry& e1, const InventoryQuery::Entry& e2) const;
+  void insertEntry(InventoryQuery::Entry&& entry);
+  bool matchesFilter(const InventoryQuery::Entry& entry) const;
+
+  void syncEntries();
+  void invalidate();
+
+  Character* _owner;
+  Item::Type _itemType;
+  InventoryQuery::SortKey _sortKey;
+  std::string _filter;  // lowercase
+
+  // The entries of all items of `_itemType`, sorted by `_sortKey`.
+  std::vector<InventoryQuery::Entry> _entries;
+  uint32_t _entriesRevision;
+  bool _areEntriesValid;
+
+  // The indices of the entries which match `_filter`.
+  std::vector<size_t> _matches;
+  std::vector<Item*> _results;
+  bool _areMatchesValid;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_INVENTORY_QUERY_H_
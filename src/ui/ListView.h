@@ -2,8 +2,8 @@
 #ifndef VIGILANTE_LIST_VIEW_H_
 #define VIGILANTE_LIST_VIEW_H_
 
+#include <cstdint>
 #include <set>
-#include <deque>
 #include <vector>
 #include <string>
 #include <memory>
@@ -18,6 +18,7 @@
 #include "Constants.h"
 #include "ui/TableLayout.h"
 #include "util/ds/SetVector.h"
+#include "util/LabelUtil.h"
 
 namespace vigilante {
 
@@ -39,7 +40,10 @@ class ListView {
   virtual void scrollUp();
   virtual void scrollDown();
 
-  void showFrom(int index);  // show n ListViewItems starting from the specified index.
+  // Shows n ListViewItems starting from the specified index. Only the rows
+  // whose objects (or the states of them, see _getObjectStateCallback)
+  // have changed since they were last shown are rebound.
+  void showFrom(int index);
 
   template <template <typename...> class ContainerType>
   void setObjects(const ContainerType<T>& objects);
@@ -48,6 +52,7 @@ class ListView {
   void hideScrollBar();
 
   T getSelectedObject() const;
+  size_t getNumObjects() const;
   cocos2d::ui::Layout* getLayout() const;
   cocos2d::Size getContentSize() const;
 
@@ -61,7 +66,8 @@ class ListView {
     void setVisible(bool visible);
 
     T getObject() const;
-    void setObject(T object);
+    void setObject(T object, uint64_t objectState=0);
+    bool isBoundTo(T object, uint64_t objectState) const;
 
     cocos2d::ui::Layout* getLayout() const;
     cocos2d::ui::ImageView* getBackground() const;
@@ -78,6 +84,9 @@ class ListView {
     cocos2d::ui::ImageView* _icon;
     cocos2d::Label* _label;
     T _object;
+    uint64_t _objectState;
+    bool _isBound;
+    bool _isSelected;
   };
 
 
@@ -85,12 +94,16 @@ class ListView {
   cocos2d::ui::ImageView* _scrollBar;
  
   std::vector<std::unique_ptr<ListViewItem>> _listViewItems;
-  std::deque<T> _objects;
+  std::vector<T> _objects;
 
   // called at the end of ListViewItem::setSelected()
   std::function<void (ListViewItem*, bool)> _setSelectedCallback;
   // called at the end of ListViewItem::setObject()
   std::function<void (ListViewItem*, T)> _setObjectCallback;
+  // Returns a value which changes whenever the row of an object has to be
+  // rebound (e.g., the amount of an item). If unset, rows are rebound
+  // only when their objects change.
+  std::function<uint64_t (T)> _getObjectStateCallback;
 
   int _visibleItemCount;
   float _width;
@@ -195,14 +208,18 @@ template <typename T>
 void ListView<T>::showFrom(int index) {
   // Show n items starting from the given index.
   for (int i = 0; i < _visibleItemCount; i++) {
-    _listViewItems[i]->setSelected(false);
+    ListViewItem* listViewItem = _listViewItems[i].get();
+    listViewItem->setSelected(false);
 
     if (index + i < (int) _objects.size()) {
-      _listViewItems[i]->setVisible(true);
       T object = _objects[index + i];
-      _listViewItems[i]->setObject(object);
+      const uint64_t objectState = (_getObjectStateCallback) ? _getObjectStateCallback(object) : 0;
+      if (!listViewItem->isBoundTo(object, objectState)) {
+        listViewItem->setObject(object, objectState);
+      }
+      listViewItem->setVisible(true);
     } else {
-      _listViewItems[i]->setVisible(false);
+      listViewItem->setVisible(false);
     }
   }
 
@@ -221,7 +238,8 @@ void ListView<T>::showFrom(int index) {
 template <typename T>
 template <template <typename...> class ContainerType>
 void ListView<T>::setObjects(const ContainerType<T>& objects) {
-  _objects = std::deque<T>(objects.begin(), objects.end());
+  // The previous storage is reused.
+  _objects.assign(objects.begin(), objects.end());
 
   if (_current < 0) {
     _current = 0;
@@ -257,6 +275,11 @@ T ListView<T>::getSelectedObject() const {
   return (_current < _objects.size()) ? _objects[_current] : nullptr;
 }
 
+template <typename T>
+size_t ListView<T>::getNumObjects() const {
+  return _objects.size();
+}
+
 template <typename T>
 cocos2d::ui::Layout* ListView<T>::getLayout() const {
   return _layout;
@@ -296,8 +319,11 @@ ListView<T>::ListViewItem::ListViewItem(ListView<T>* parent, float x, float y)
       _layout(TableLayout::create(parent->_width)),
       _background(cocos2d::ui::ImageView::create(parent->_regularBg)),
       _icon(cocos2d::ui::ImageView::create(asset_manager::kEmptyImage)),
-      _label(cocos2d::Label::createWithTTF("---", parent->_font, parent->_fontSize)),
-      _object() {
+      _label(label_util::create("---", parent->_font, parent->_fontSize)),
+      _object(),
+      _objectState(),
+      _isBound(),
+      _isSelected() {
   _icon->setScale((float) _kListViewIconSize / kIconSize);
 
   _background->setAnchorPoint({0, 1});
@@ -317,6 +343,11 @@ ListView<T>::ListViewItem::ListViewItem(ListView<T>* parent, float x, float y)
 
 template <typename T>
 void ListView<T>::ListViewItem::setSelected(bool selected) {
+  if (selected == _isSelected) {
+    return;
+  }
+  _isSelected = selected;
+
   _background->loadTexture((selected) ? _parent->_highlightedBg : _parent->_regularBg);
 
   if (_parent->_setSelectedCallback) {
@@ -335,12 +366,20 @@ T ListView<T>::ListViewItem::getObject() const {
 }
 
 template <typename T>
-void ListView<T>::ListViewItem::setObject(T object) {
+void ListView<T>::ListViewItem::setObject(T object, uint64_t objectState) {
   _object = object;
+  _objectState = objectState;
+  _isBound = true;
 
   if (_parent->_setObjectCallback) {
     _parent->_setObjectCallback(this, object);
   }
+  _layout->invalidate(_label);
+}
+
+template <typename T>
+bool ListView<T>::ListViewItem::isBoundTo(T object, uint64_t objectState) const {
+  return _isBound && _object == object && _objectState == objectState;
 }
 
 template <typename T>
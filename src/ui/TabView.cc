@@ -3,6 +3,7 @@
 
 #include "std/make_unique.h"
 #include "AssetManager.h"
+#include "util/LabelUtil.h"
 
 using std::vector;
 using std::string;
@@ -72,7 +73,7 @@ Layout* TabView::getLayout() const {
 TabView::Tab::Tab(TabView* parent, const string& text)
     : _parent(parent),
       _background(ImageView::create(parent->_regularBg)), 
-      _label(Label::createWithTTF(text, kRegularFont, kRegularFontSize)),
+      _label(label_util::create(text, kRegularFont, kRegularFontSize)),
       _isSelected(),
       _index(parent->_tabs.size()) {
   _label->getFontAtlas()->setAliasTexParameters();
@@ -35,91 +35,97 @@ void TableLayout::removeAllChildren() {
   reset();
 }
 
+void TableLayout::removeChild(Node* child, bool cleanup) {
+  auto it = _cellIndices.find(child);
+  if (it != _cellIndices.end()) {
+    const size_t index = it->second;
+    const size_t row = getRowOf(index);
+    _cells.erase(_cells.begin() + index);
+    for (auto& r : _rows) {
+      if (r.firstCell > index) {
+        r.firstCell--;
+      }
+    }
+
+    _cellIndices.erase(it);
+    for (size_t i = index; i < _cells.size(); i++) {
+      _cellIndices[_cells[i].node] = i;
+    }
+    _rows[row].isMoved = true;
+    _hasDirtyRows = true;
+  }
+  Layout::removeChild(child, cleanup);
+}
+
 void TableLayout::addChild(Node* child) {
   Layout::addChild(child);
   child->setAnchorPoint({0, 1});
-  child->setPosition(_nextChildPosition);
-  
-  _lastAddedChild = child;
-  _nextChildPosition.x += child->getScaleX() * child->getContentSize().width;
+
+  const TableLayout::Row& row = _rows.back();
+  const float previousEnd = (_cells.size() > row.firstCell) ? getCellEnd(_cells.back()) : 0;
+
+  _cellIndices[child] = _cells.size();
+  _cells.push_back({child, /*isAligned=*/false, Alignment::LEFT,
+                    _nextChildPosition.x - previousEnd, 0, _nextChildPosition.y - row.y, 0});
+  _nextChildPosition.x = arrange(_cells.back(), row.y, previousEnd);
 }
 
 TableLayout* TableLayout::align(TableLayout::Alignment direction) {
   // If there's no last added child node, don't do anything.
-  if (!_lastAddedChild) {
+  if (_cells.empty()) {
     return this;
   }
 
+  TableLayout::Cell& cell = _cells.back();
   switch (direction) {
     case Alignment::LEFT:
-      _lastAddedChild->setAnchorPoint({0, 1});
-      _lastAddedChild->setPositionX(0);
-      _nextChildPosition.x
-        = 0 + _lastAddedChild->getScaleX() * _lastAddedChild->getContentSize().width;
+      cell.node->setAnchorPoint({0, 1});
       break;
     case Alignment::CENTER:
-      _lastAddedChild->setAnchorPoint({0.5, 1});
-      _lastAddedChild->setPositionX(_tableWidth / 2);
-      _nextChildPosition.x
-        = _tableWidth / 2 + _lastAddedChild->getScaleX() * _lastAddedChild->getContentSize().width / 2;
+      cell.node->setAnchorPoint({0.5, 1});
       break;
     case Alignment::RIGHT:
-      _lastAddedChild->setAnchorPoint({1, 1});
-      _lastAddedChild->setPositionX(_tableWidth);
-      _nextChildPosition.x = _tableWidth;
+      cell.node->setAnchorPoint({1, 1});
       break;
     default:
       VGLOG(LOG_ERR, "Bad align value: %d", static_cast<int>(direction));
-      break;
+      return this;
   }
+  cell.isAligned = true;
+  cell.alignment = direction;
+  arrangeLastAddedChild();
   return this;
 }
 
 TableLayout* TableLayout::padLeft(float padding) {
-  if (!_lastAddedChild) {
-    return this;
+  if (!_cells.empty()) {
+    _cells.back().offsetX += padding;
+    arrangeLastAddedChild();
   }
-  float originalX = _lastAddedChild->getPositionX();
-  float newX = originalX + padding;
-  float width = _lastAddedChild->getScaleX() * _lastAddedChild->getContentSize().width;
-  _lastAddedChild->setPositionX(newX);
-  _nextChildPosition.x = newX + width;
   return this;
 }
 
 TableLayout* TableLayout::padRight(float padding) {
-  if (!_lastAddedChild) {
-    return this;
+  if (!_cells.empty()) {
+    _cells.back().offsetX -= padding;
+    arrangeLastAddedChild();
   }
-  float originalX = _lastAddedChild->getPositionX();
-  float newX = originalX - padding;
-  float width = _lastAddedChild->getScaleX() * _lastAddedChild->getContentSize().width;
-  _lastAddedChild->setPositionX(newX);
-  _nextChildPosition.x = newX + width;
   return this;
 }
 
 TableLayout* TableLayout::padTop(float padding) {
-  if (!_lastAddedChild) {
-    return this;
+  if (!_cells.empty()) {
+    _cells.back().offsetY -= padding;
+    arrangeLastAddedChild();
   }
-  float originalY = _lastAddedChild->getPositionY();
-  float newY = originalY - padding;
-  _lastAddedChild->setPositionY(newY);
-  // We don't want to update _nextChildPosition.y here,
-  // otherwise the subsequently added children will placed lower and lower.
   return this;
 }
 
 TableLayout* TableLayout::padBottom(float padding) {
-  if (!_lastAddedChild) {
-    return this;
+  if (!_cells.empty()) {
+    _cells.back().offsetY += padding;
+    arrangeLastAddedChild();
   }
-  float originalY = _lastAddedChild->getPositionY();
-  float newY = originalY + padding;
-  _lastAddedChild->setPositionY(newY);
-  // We don't want to update _nextChildPosition.y here,
-  // otherwise the subsequently added children will placed higher and higher.
   return this;
 }
 
@@ -138,6 +144,7 @@ TableLayout* TableLayout::spaceY(float spacing) {
 TableLayout* TableLayout::row(float height) {
   _nextChildPosition.x = 0;
   _nextChildPosition.y -= height;
+  _rows.push_back({_nextChildPosition.y, _cells.size(), false, false});
   return this;
 }
 
@@ -146,10 +153,147 @@ TableLayout* TableLayout::row() {
 }
 
 void TableLayout::reset() {
-  _lastAddedChild = nullptr;
+  _cells.clear();
+  _rows.assign(1, {0, 0, false, false});
+  _cellIndices.clear();
+  _hasDirtyRows = false;
   _nextChildPosition = {0, 0};
 }
 
+void TableLayout::invalidate(Node* child) {
+  auto it = _cellIndices.find(child);
+  if (it == _cellIndices.end()) {
+    return;
+  }
+
+  _rows[getRowOf(it->second)].isDirty = true;
+  _hasDirtyRows = true;
+
+  if (auto parent = dynamic_cast<TableLayout*>(getParent())) {
+    parent->invalidate(this);
+  }
+}
+
+void TableLayout::resizeRow(size_t row, float height) {
+  if (row + 1 >= _rows.size()) {
+    VGLOG(LOG_ERR, "Cannot resize row %d, which has no next row", static_cast<int>(row));
+    return;
+  }
+
+  const float delta = height - (_rows[row].y - _rows[row + 1].y);
+  if (delta == 0) {
+    return;
+  }
+
+  for (size_t i = row + 1; i < _rows.size(); i++) {
+    _rows[i].y -= delta;
+    _rows[i].isMoved = true;
+  }
+  _nextChildPosition.y -= delta;
+  _hasDirtyRows = true;
+}
+
+
+void TableLayout::doLayout() {
+  if (_hasDirtyRows) {
+    _hasDirtyRows = false;
+
+    for (size_t i = 0; i < _rows.size(); i++) {
+      TableLayout::Row& row = _rows[i];
+      if (!row.isDirty && !row.isMoved) {
+        continue;
+      }
+
+      // If none of the cells has been resized, the row stays where it is.
+      if (!row.isMoved) {
+        bool isResized = false;
+        for (size_t j = row.firstCell; j < getRowEnd(i) && !isResized; j++) {
+          isResized = measure(_cells[j]) != _cells[j].width;
+        }
+        if (!isResized) {
+          row.isDirty = false;
+          continue;
+        }
+      }
+      arrangeRow(i);
+    }
+  }
+  Layout::doLayout();
+}
+
+size_t TableLayout::getRowOf(size_t cellIndex) const {
+  // The empty rows share their firstCell with the next row,
+  // so the last row which starts at or before the cell is the one.
+  for (size_t i = _rows.size(); i > 0; i--) {
+    if (_rows[i - 1].firstCell <= cellIndex) {
+      return i - 1;
+    }
+  }
+  return 0;
+}
+
+size_t TableLayout::getRowEnd(size_t row) const {
+  return (row + 1 < _rows.size()) ? _rows[row + 1].firstCell : _cells.size();
+}
+
+float TableLayout::measure(const TableLayout::Cell& cell) const {
+  return cell.node->getScaleX() * cell.node->getContentSize().width;
+}
+
+float TableLayout::getCellEnd(const TableLayout::Cell& cell) const {
+  return cell.node->getPositionX() + (1 - cell.node->getAnchorPoint().x) * cell.width;
+}
+
+float TableLayout::arrange(TableLayout::Cell& cell, float y, float previousEnd) {
+  cell.width = measure(cell);
+
+  float x = previousEnd + cell.gapX;
+  if (cell.isAligned) {
+    switch (cell.alignment) {
+      case Alignment::LEFT:
+        x = 0;
+        break;
+      case Alignment::CENTER:
+        x = _tableWidth / 2;
+        break;
+      case Alignment::RIGHT:
+        x = _tableWidth;
+        break;
+    }
+  }
+  cell.node->setPosition(x + cell.offsetX, y + cell.offsetY);
+  return getCellEnd(cell);
+}
+
+void TableLayout::arrangeLastAddedChild() {
+  const size_t index = _cells.size() - 1;
+  const size_t row = getRowOf(index);
+  const float previousEnd = (index > _rows[row].firstCell) ? getCellEnd(_cells[index - 1]) : 0;
+  const float end = arrange(_cells.back(), _rows[row].y, previousEnd);
+
+  // Once the row has been changed, the next child starts from the left.
+  if (row == _rows.size() - 1) {
+    _nextChildPosition.x = end;
+  }
+}
+
+void TableLayout::arrangeRow(size_t row) {
+  const size_t rowEnd = getRowEnd(row);
+  const float oldEnd = (rowEnd > _rows[row].firstCell) ? getCellEnd(_cells[rowEnd - 1]) : 0;
+
+  float end = 0;
+  for (size_t i = _rows[row].firstCell; i < rowEnd; i++) {
+    end = arrange(_cells[i], _rows[row].y, end);
+  }
+  _rows[row].isDirty = false;
+  _rows[row].isMoved = false;
+
+  // The next child (if added to this row) follows the new end.
+  if (row == _rows.size() - 1) {
+    _nextChildPosition.x += end - oldEnd;
+  }
+}
+
 
 float TableLayout::getTableWidth() const {
   return _tableWidth;
@@ -173,7 +317,16 @@ float TableLayout::getNextChildPositionY() const {
 
 
 void TableLayout::setTableWidth(float tableWidth) {
+  if (tableWidth == _tableWidth) {
+    return;
+  }
   _tableWidth = tableWidth;
+
+  // The aligned cells depend on the width of the table.
+  for (auto& row : _rows) {
+    row.isMoved = true;
+  }
+  _hasDirtyRows = true;
 }
 
 void TableLayout::setRowHeight(float rowHeight) {
@@ -2,11 +2,22 @@
 #ifndef VIGILANTE_TABLE_LAYOUT_H_
 #define VIGILANTE_TABLE_LAYOUT_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include <cocos2d.h>
 #include <ui/UILayout.h>
 
 namespace vigilante {
 
+// Places its children in rows, in the order they're added.
+//
+// The layout is retained: how each child has been placed (aligned or after
+// the previous child of its row, and its paddings) is recorded, so when
+// the size of a child changes (e.g., a Label's text), invalidate() only marks
+// the row of that child, and the row is relaid out in the next layout pass
+// (doLayout(), called when the layout is visited). A row whose children
+// still measure the same is skipped. resizeRow() moves the rows below it.
 class TableLayout : public cocos2d::ui::Layout {
  public:
   static TableLayout* create(float tableWidth=100.0f, float rowHeight=8.0f);
@@ -20,6 +31,7 @@ class TableLayout : public cocos2d::ui::Layout {
   };
 
   virtual void removeAllChildren() override;  // cocos2d::ui::Layout
+  virtual void removeChild(cocos2d::Node* child, bool cleanup=true) override;  // cocos2d::ui::Layout
 
   virtual void addChild(cocos2d::Node* child) override;
   virtual TableLayout* align(TableLayout::Alignment direction);  // align last added child
@@ -36,7 +48,14 @@ class TableLayout : public cocos2d::ui::Layout {
   virtual TableLayout* row();
 
   void reset();
-  
+
+  // Marks the row of `child` to be relaid out, and propagates to the parent
+  // if this TableLayout is itself a child of another TableLayout.
+  void invalidate(cocos2d::Node* child);
+  // Changes the height between `row` and the next row (the rows are
+  // numbered from 0 in the order they've been started).
+  void resizeRow(size_t row, float height);
+
   float getTableWidth() const;
   float getRowHeight() const;
   cocos2d::Vec2 getNextChildPosition() const;
@@ -50,10 +69,45 @@ class TableLayout : public cocos2d::ui::Layout {
   void setNextChildPositionY(float y);
 
  protected:
+  struct Cell final {
+    cocos2d::Node* node;
+    bool isAligned;
+    TableLayout::Alignment alignment;
+    float gapX;  // from the end of the previous cell of its row, if not aligned
+    float offsetX;  // the horizontal paddings
+    float offsetY;  // from the y of its row, including the vertical paddings
+    float width;  // the cached width of `node`
+  };
+
+  struct Row final {
+    float y;
+    size_t firstCell;  // the cells from `firstCell` to the next row's are in this row
+    bool isDirty;  // the cells have to be measured again
+    bool isMoved;  // the cells have to be arranged again
+  };
+
+  virtual void doLayout() override;  // cocos2d::ui::Layout
+
+  size_t getRowOf(size_t cellIndex) const;
+  size_t getRowEnd(size_t row) const;
+  float measure(const TableLayout::Cell& cell) const;
+  // The x where the next cell of the same row starts.
+  float getCellEnd(const TableLayout::Cell& cell) const;
+  // Places `cell` given the end of the previous cell of its row,
+  // and returns the end of `cell`.
+  float arrange(TableLayout::Cell& cell, float y, float previousEnd);
+  // Re-arranges the last added child after its alignment or paddings have changed.
+  void arrangeLastAddedChild();
+  void arrangeRow(size_t row);
+
   float _tableWidth;  // the width of this table layout
   float _rowHeight;  // the height between any two rows
 
-  cocos2d::Node* _lastAddedChild;
+  std::vector<TableLayout::Cell> _cells;
+  std::vector<TableLayout::Row> _rows;
+  std::unordered_map<cocos2d::Node*, size_t> _cellIndices;
+  bool _hasDirtyRows;
+
   cocos2d::Vec2 _nextChildPosition;  // the x,y of the next child to be added
 };
 
@@ -4,6 +4,7 @@
 #include "AssetManager.h"
 #include "input/InputManager.h"
 #include "util/KeyCodeUtil.h"
+#include "util/LabelUtil.h"
 
 #define CURSOR_CHAR "|"
 #define CURSOR_BLINK_INTERVAL 0.7f
@@ -23,10 +24,11 @@ namespace vigilante {
 
 TextField::TextField(const string& defaultText)
     : _layout(Layout::create()),
-      _label(Label::createWithTTF(CURSOR_CHAR, kRegularFont, kRegularFontSize)),
+      _label(label_util::create(CURSOR_CHAR, kRegularFont, kRegularFontSize)),
       _buffer(),
       _onSubmit(),
       _onDismiss(),
+      _onChange(),
       _onKeyPressed(),
       _extraOnKeyPressed(),
       _dismissKey(DEFAULT_DISMISS_KEY),
@@ -57,6 +59,9 @@ TextField::TextField(const string& defaultText)
       if (!_buffer.empty()) {
         _buffer.pop_back();
         _label->setString(_buffer + CURSOR_CHAR);
+        if (_onChange) {
+          _onChange();
+        }
       }
       return;
     }
@@ -66,6 +71,9 @@ TextField::TextField(const string& defaultText)
     if (c != 0x00) {
       _buffer += c;
       _label->setString(_buffer + CURSOR_CHAR);
+      if (_onChange) {
+        _onChange();
+      }
     }
   };
 
@@ -128,6 +136,10 @@ void TextField::setOnDismiss(const function<void ()>& onDismiss) {
   _onDismiss = onDismiss;
 }
 
+void TextField::setOnChange(const function<void ()>& onChange) {
+  _onChange = onChange;
+}
+
 void TextField::setExtraOnKeyPressed(const InputManager::OnKeyPressedEvLstnr& extraOnKeyPressed) {
   _extraOnKeyPressed = extraOnKeyPressed;
 }
@@ -28,6 +28,8 @@ class TextField {
 
   void setOnSubmit(const std::function<void ()>& onSubmit);
   void setOnDismiss(const std::function<void ()>& onDismiss);
+  // Called whenever the user has typed or erased a character.
+  void setOnChange(const std::function<void ()>& onChange);
   void setExtraOnKeyPressed(const InputManager::OnKeyPressedEvLstnr& extraOnKeyPressed);
 
   void setDismissKey(cocos2d::EventKeyboard::KeyCode dismissKey);
@@ -42,6 +44,7 @@ class TextField {
   std::string _buffer;
   std::function<void ()> _onSubmit;
   std::function<void ()> _onDismiss;
+  std::function<void ()> _onChange;
   InputManager::OnKeyPressedEvLstnr _onKeyPressed;
   InputManager::OnKeyPressedEvLstnr _extraOnKeyPressed;
 
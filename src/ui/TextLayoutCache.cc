@@ -0,0 +1,88 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TextLayoutCache.h"
+
+#include <algorithm>
+
+#include "util/LabelUtil.h"
+
+using std::string;
+using cocos2d::Label;
+
+namespace vigilante {
+
+const size_t TextLayoutCache::_kDefaultCapacity = 8;
+
+TextLayoutCache::TextLayoutCache(Label* label, const string& fontFile, float fontSize, size_t capacity)
+    : _prototype(label),
+      _fontFile(fontFile),
+      _fontSize(fontSize),
+      _capacity(std::max<size_t>(capacity, 1)),
+      _layouts(),
+      _current(),
+      _time(),
+      _isVisible(label->isVisible()) {
+  _layouts.reserve(_capacity);
+  _layouts.push_back({label->getString(), label, _time});
+}
+
+
+void TextLayoutCache::setString(const string& text) {
+  if (_layouts[_current].text == text) {
+    return;
+  }
+
+  size_t next = 0;
+  while (next < _layouts.size() && _layouts[next].text != text) {
+    next++;
+  }
+
+  if (next == _layouts.size()) {
+    if (_layouts.size() < _capacity) {
+      _layouts.push_back({text, createLabel(text), 0});
+    } else {
+      // Lay out the least recently used one again.
+      next = (_current == 0) ? 1 % _layouts.size() : 0;
+      for (size_t i = 0; i < _layouts.size(); i++) {
+        if (i != _current && _layouts[i].lastUsedTime < _layouts[next].lastUsedTime) {
+          next = i;
+        }
+      }
+      // With a capacity of one, there's nothing else to evict.
+      if (next == _current) {
+        _layouts[_current].text = text;
+        _layouts[_current].label->setString(text);
+        return;
+      }
+      _layouts[next].text = text;
+      _layouts[next].label->setString(text);
+    }
+  }
+
+  _layouts[_current].label->setVisible(false);
+  _current = next;
+  _layouts[_current].label->setVisible(_isVisible);
+  _layouts[_current].lastUsedTime = ++_time;
+}
+
+void TextLayoutCache::setVisible(bool visible) {
+  _isVisible = visible;
+  _layouts[_current].label->setVisible(visible);
+}
+
+
+Label* TextLayoutCache::createLabel(const string& text) const {
+  Label* label = label_util::create(text, _fontFile, _fontSize);
+  label->getFontAtlas()->setAliasTexParameters();
+  label->setAnchorPoint(_prototype->getAnchorPoint());
+  label->setPosition(_prototype->getPosition());
+  label->setColor(_prototype->getColor());
+  label->setWidth(_prototype->getWidth());
+  label->enableWrap(_prototype->isWrapEnabled());
+  label->setVisible(false);
+  _prototype->getParent()->addChild(label, _prototype->getLocalZOrder());
+  // The camera mask has only been applied to the labels which existed back then.
+  label->setCameraMask(_prototype->getCameraMask());
+  return label;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,60 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TEXT_LAYOUT_CACHE_H_
+#define VIGILANTE_TEXT_LAYOUT_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <cocos2d.h>
+#include <2d/CCLabel.h>
+
+namespace vigilante {
+
+// Keeps the layouts of the last few strings shown by a label, e.g.,
+// the description label of a list view, whose string changes with
+// each key press while scrolling through the list.
+//
+// Label::setString() lays the whole string out again, i.e., decodes it,
+// looks up its glyphs in the font atlas, breaks it into lines and rebuilds
+// the letter quads. Instead, each of the recent strings keeps a Label of
+// its own (configured like `label`, and added next to it), so showing it
+// again only swaps the visible label. The font, the size and the wrap width
+// are fixed per cache, so the layouts are simply keyed by their strings,
+// and the least recently used one is laid out again if there's no room.
+//
+// All methods must be called on the main thread.
+class TextLayoutCache final {
+ public:
+  // `label` must have been added to its parent, and it's used for the first layout.
+  TextLayoutCache(cocos2d::Label* label, const std::string& fontFile, float fontSize,
+                  size_t capacity=_kDefaultCapacity);
+
+  // Shows `text` in place of the label.
+  void setString(const std::string& text);
+  void setVisible(bool visible);
+
+ private:
+  struct Layout final {
+    std::string text;
+    cocos2d::Label* label;
+    uint64_t lastUsedTime;
+  };
+
+  static const size_t _kDefaultCapacity;
+
+  cocos2d::Label* createLabel(const std::string& text) const;
+
+  cocos2d::Label* _prototype;
+  const std::string _fontFile;
+  const float _fontSize;
+  const size_t _capacity;
+  std::vector<TextLayoutCache::Layout> _layouts;
+  size_t _current;  // the index of the shown layout
+  uint64_t _time;
+  bool _isVisible;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TEXT_LAYOUT_CACHE_H_
@@ -1,16 +1,15 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "TimedLabelService.h"
 
+#include <algorithm>
+
 #include "AssetManager.h"
+#include "util/LabelUtil.h"
+#include "util/StringBuilder.h"
 
 using std::string;
 using cocos2d::Layer;
 using cocos2d::Label;
-using cocos2d::MoveBy;
-using cocos2d::FadeOut;
-using cocos2d::CallFunc;
-using cocos2d::Sequence;
-using cocos2d::CameraFlag;
 using vigilante::asset_manager::kRegularFont;
 using vigilante::asset_manager::kRegularFontSize;
 
@@ -25,56 +24,101 @@ TimedLabelService::TimedLabelService(int startingX, int startingY,
                                      uint8_t maxLabelCount, uint8_t labelLifetime,
                                      TimedLabelService::TimedLabel::Alignment alignment)
     : _layer(Layer::create()),
+      _labelPool(),
+      // CircularBuffer keeps one of its slots empty.
+      _labels(maxLabelCount + 1),
+      _nextLabelIndex(),
+      _labelText(),
       _kStartingX(startingX),
       _kStartingY(startingY),
       _kMaxLabelCount(maxLabelCount),
       _kLabelLifetime(labelLifetime),
-      _kAlignment(alignment) {}
+      _kAlignment(alignment) {
+  // Note that cocos2d::Layer::setCameraMask() can only apply the given mask to
+  // the children that are in the _layer at that moment, so all of the labels
+  // are added to _layer here once and for all.
+  _labelPool.reserve(_kMaxLabelCount);
+  for (int i = 0; i < _kMaxLabelCount; i++) {
+    _labelPool.emplace_back(_kAlignment);
+    _labelPool.back().label->setVisible(false);
+    _layer->addChild(_labelPool.back().label);
+  }
+}
 
 
 void TimedLabelService::update(float delta) {
-  for (auto& notification : _labelQueue) {
-    notification.timer += delta;
-
-    if (notification.timer >= notification.lifetime) {
-      notification.label->runAction(Sequence::createWithTwoActions(
-        FadeOut::create(_kFadeDuration),
-        CallFunc::create([=]() {
-          // After the label fully fades out, remove the label from _layer.
-          _layer->removeChild(notification.label);
-        })
-      ));
-      // Also remove the notification object from _labelQueue.
-      auto& q = _labelQueue;
-      q.erase(std::remove(q.begin(), q.end(), notification), q.end());
+  const float moveUpSpeed = _kDeltaY / _kMoveUpDuration;
+
+  for (auto& timedLabel : _labelPool) {
+    if (!timedLabel.label->isVisible()) {
+      continue;
+    }
+
+    timedLabel.timer += delta;
+    timedLabel.y = std::min(timedLabel.y + moveUpSpeed * delta, timedLabel.targetY);
+    timedLabel.label->setPositionY(timedLabel.y);
+
+    if (timedLabel.timer >= _kLabelLifetime) {
+      const float fadeProgress = (timedLabel.timer - _kLabelLifetime) / _kFadeDuration;
+      timedLabel.label->setOpacity(255 * (1.0f - std::min(fadeProgress, 1.0f)));
     }
   }
+
+  // The labels expire in the order they're shown, so the fully
+  // faded out ones are always at the front of _labels.
+  while (!_labels.empty() &&
+         _labels.front()->timer >= _kLabelLifetime + _kFadeDuration) {
+    releaseLabel(_labels.front());
+    _labels.pop();
+  }
 }
 
 void TimedLabelService::show(const string& message) {
-  // If the number of notifications being displayed has surpassed _kMaxLabelCount,
-  // then remove the earliest notification.
-  if ((int) _labelQueue.size() > _kMaxLabelCount) {
-    _layer->removeChild(_labelQueue.front().label);
-    _labelQueue.pop_front();
+  show(message.c_str());
+}
+
+void TimedLabelService::show(const char* message) {
+  // If the latest message is the same one, and it hasn't started fading out,
+  // then just bump its count and keep it on the screen a little longer.
+  if (!_labels.empty()) {
+    TimedLabel* latest = _labels.back();
+    if (latest->message == message && latest->timer < _kLabelLifetime) {
+      latest->count++;
+      latest->timer = 0;
+      StringBuilder<256> text;
+      text.append(message).appendFormat(" (x%d)", latest->count);
+      text.assignTo(&_labelText);
+      latest->label->setString(_labelText);
+      return;
+    }
+  }
+
+  // If the number of notifications being displayed has reached _kMaxLabelCount,
+  // then reuse the label of the earliest notification.
+  if (_labels.full()) {
+    releaseLabel(_labels.front());
+    _labels.pop();
   }
 
   // Move previous notifications up.
-  for (auto label : _labelQueue) {
-    label.label->runAction(MoveBy::create(_kMoveUpDuration, {_kDeltaX, _kDeltaY}));
+  for (auto& timedLabel : _labelPool) {
+    if (timedLabel.label->isVisible()) {
+      timedLabel.targetY += _kDeltaY;
+    }
   }
 
   // Display the new notification.
-  // Note that cocos2d::Layer::setCameraMask() can only apply the given mask to
-  // the children that are in the _layer at that moment. If we create a label/sprite
-  // afterwards, the mask is the default one, even if we add it as a child of that layer.
-  TimedLabel timedLabel(message, _kLabelLifetime, _kAlignment);
-  timedLabel.label->setPosition(_kStartingX, _kStartingY);
-  timedLabel.label->runAction(MoveBy::create(_kMoveUpDuration, {_kDeltaX, _kDeltaY}));
-  _labelQueue.push_back(timedLabel);
-
-  _layer->addChild(timedLabel.label);
-  _layer->setCameraMask(_layer->getCameraMask());
+  TimedLabel* timedLabel = acquireLabel();
+  timedLabel->message.assign(message);
+  timedLabel->count = 1;
+  timedLabel->timer = 0;
+  timedLabel->y = _kStartingY;
+  timedLabel->targetY = _kStartingY + _kDeltaY;
+  timedLabel->label->setString(message);
+  timedLabel->label->setOpacity(255);
+  timedLabel->label->setPosition(_kStartingX, _kStartingY);
+  timedLabel->label->setVisible(true);
+  _labels.push(timedLabel);
 }
 
 Layer* TimedLabelService::getLayer() const {
@@ -82,21 +126,33 @@ Layer* TimedLabelService::getLayer() const {
 }
 
 
+TimedLabelService::TimedLabel* TimedLabelService::acquireLabel() {
+  // The labels are acquired and released in the same (cyclic) order,
+  // so the next one is always free as long as _labels isn't full.
+  TimedLabel* timedLabel = &_labelPool[_nextLabelIndex];
+  _nextLabelIndex = (_nextLabelIndex + 1) % _labelPool.size();
+  return timedLabel;
+}
+
+void TimedLabelService::releaseLabel(TimedLabelService::TimedLabel* timedLabel) {
+  timedLabel->label->setVisible(false);
+  timedLabel->message.clear();
+}
+
+
 const TimedLabelService::TimedLabel::Alignment TimedLabelService::TimedLabel::kLeft = {0, 1};
 const TimedLabelService::TimedLabel::Alignment TimedLabelService::TimedLabel::kCenter = {0.5, 1};
 const TimedLabelService::TimedLabel::Alignment TimedLabelService::TimedLabel::kRight = {1, 1};
 
-TimedLabelService::TimedLabel::TimedLabel(const string& text, float lifetime,
-                                          TimedLabel::Alignment alignment)
-    : label(Label::createWithTTF(text, kRegularFont, kRegularFontSize)),
-      lifetime(lifetime),
-      timer() {
+TimedLabelService::TimedLabel::TimedLabel(TimedLabel::Alignment alignment)
+    : label(label_util::create("", kRegularFont, kRegularFontSize)),
+      message(),
+      count(),
+      timer(),
+      y(),
+      targetY() {
   label->setAnchorPoint(alignment);
   label->getFontAtlas()->setAliasTexParameters();
 }
 
-bool TimedLabelService::TimedLabel::operator==(const TimedLabel& other) {
-  return this->label == other.label;
-}
-
 }  // namespace vigilante
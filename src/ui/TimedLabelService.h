@@ -3,12 +3,24 @@
 #define VIGILANTE_TIMED_LABEL_SERVICE_H_
 
 #include <string>
+#include <vector>
 
 #include <cocos2d.h>
 #include <2d/CCLabel.h>
+#include "util/ds/CircularBuffer.h"
 
 namespace vigilante {
 
+// A TimedLabelService displays a stack of messages which fade out
+// after a while (e.g., Notifications, QuestHints).
+//
+// All of the labels are allocated up front and reused in a ring, so
+// showing a message never creates a node. If the same message is shown
+// several times in a row (e.g., picking up a pile of items), it's
+// displayed once with a count instead of pushing the older ones away.
+// The strings are reused as well, so a message formatted into a fixed
+// buffer (see string_util::formatTo()) is shown without heap allocations
+// once the strings have grown large enough.
 class TimedLabelService {
  public:
   struct TimedLabel {
@@ -17,18 +29,20 @@ class TimedLabelService {
     static const Alignment kCenter;
     static const Alignment kRight;
 
-    TimedLabel(const std::string& text, float lifetime,
-               TimedLabel::Alignment alignment);
-    bool operator== (const TimedLabel& other);
+    explicit TimedLabel(TimedLabel::Alignment alignment);
 
     cocos2d::Label* label;
-    float lifetime;
+    std::string message;
+    int count;
     float timer;
+    float y;
+    float targetY;
   };
 
   virtual ~TimedLabelService() = default;
 
   void update(float delta);
+  void show(const char* message);
   void show(const std::string& message);
   cocos2d::Layer* getLayer() const;
 
@@ -37,13 +51,22 @@ class TimedLabelService {
                     uint8_t maxLabelCount, uint8_t labelLifetime,
                     TimedLabelService::TimedLabel::Alignment alignment);
 
+  TimedLabelService::TimedLabel* acquireLabel();
+  void releaseLabel(TimedLabelService::TimedLabel* timedLabel);
+
   static const float _kMoveUpDuration;
   static const float _kFadeDuration;
   static const float _kDeltaX;
   static const float _kDeltaY;
  
   cocos2d::Layer* _layer;
-  std::deque<TimedLabelService::TimedLabel> _labelQueue;
+
+  // The pool of labels (fixed size), and the ones being displayed
+  // from the oldest to the newest, including those which are fading out.
+  std::vector<TimedLabelService::TimedLabel> _labelPool;
+  CircularBuffer<TimedLabelService::TimedLabel*> _labels;
+  size_t _nextLabelIndex;
+  std::string _labelText;  // reused by show()
 
   const float _kStartingX;
   const float _kStartingY;
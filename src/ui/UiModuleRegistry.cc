@@ -0,0 +1,94 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "UiModuleRegistry.h"
+
+#include "util/DeferredTaskScheduler.h"
+#include "util/Logger.h"
+
+using std::function;
+using cocos2d::Node;
+using cocos2d::Scene;
+
+namespace vigilante {
+
+UiModuleRegistry* UiModuleRegistry::getInstance() {
+  static UiModuleRegistry instance;
+  return &instance;
+}
+
+UiModuleRegistry::UiModuleRegistry()
+    : _entries(),
+      _scene(),
+      _cameraMask(),
+      _unwiredLayers() {}
+
+
+void UiModuleRegistry::registerModule(UiModuleRegistry::Module module,
+                                      int zOrder,
+                                      bool shouldPreloadWhenIdle,
+                                      const function<void ()>& factory) {
+  Entry& entry = _entries[module];
+  entry.factory = factory;
+  entry.zOrder = zOrder;
+  entry.shouldPreloadWhenIdle = shouldPreloadWhenIdle;
+}
+
+void UiModuleRegistry::setScene(Scene* scene, uint16_t cameraMask) {
+  _scene = scene;
+  _cameraMask = cameraMask;
+
+  for (auto& entry : _entries) {
+    if (entry.layer && !entry.isWired) {
+      wire(entry);
+    }
+  }
+  _unwiredLayers.clear();
+}
+
+void UiModuleRegistry::onInstantiated(UiModuleRegistry::Module module, Node* layer) {
+  Entry& entry = _entries[module];
+  entry.layer = layer;
+
+  if (_scene) {
+    wire(entry);
+  } else {
+    _unwiredLayers.pushBack(layer);
+  }
+}
+
+void UiModuleRegistry::require(UiModuleRegistry::Module module) {
+  const Entry& entry = _entries[module];
+  if (entry.layer) {
+    return;
+  }
+  if (!entry.factory) {
+    VGLOG(LOG_ERR, "UI module [%d] has not been registered.", module);
+    return;
+  }
+  entry.factory();
+}
+
+bool UiModuleRegistry::isInstantiated(UiModuleRegistry::Module module) const {
+  return _entries[module].layer != nullptr;
+}
+
+void UiModuleRegistry::preloadWhenIdle() {
+  for (int i = 0; i < Module::SIZE; i++) {
+    if (!_entries[i].shouldPreloadWhenIdle || _entries[i].layer) {
+      continue;
+    }
+    const Module module = static_cast<Module>(i);
+    DeferredTaskScheduler::getInstance()->post([this, module]() {
+      require(module);
+      return true;
+    }, &_entries[i]);
+  }
+}
+
+
+void UiModuleRegistry::wire(UiModuleRegistry::Entry& entry) {
+  entry.layer->setCameraMask(_cameraMask);
+  _scene->addChild(entry.layer, entry.zOrder);
+  entry.isWired = true;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,79 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_UI_MODULE_REGISTRY_H_
+#define VIGILANTE_UI_MODULE_REGISTRY_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// The rarely used UI singletons (the console, the pause menu and its panes,
+// the dialogue manager) are constructed lazily, i.e., by their first
+// getInstance(), rather than all up front by GameScene::init().
+//
+// Each module tells the registry about its layer from its ctor (see
+// onInstantiated()), and the registry then applies the camera mask and adds the
+// layer to the scene at the module's z order. If there's no scene yet, the layer
+// is retained and wired as soon as there is one (see setScene()).
+//
+// GameScene registers a factory (normally the getInstance() of the module) for
+// each module. The modules which are likely to be used can be instantiated in idle
+// time with preloadWhenIdle(), and the others (e.g., the console) are only
+// instantiated if they're ever used.
+//
+// All methods must be called on the main thread.
+class UiModuleRegistry final {
+ public:
+  enum Module {
+    CONSOLE,
+    DIALOGUE_MANAGER,
+    PAUSE_MENU,
+    SIZE
+  };
+
+  static UiModuleRegistry* getInstance();
+
+  void registerModule(UiModuleRegistry::Module module,
+                      int zOrder,
+                      bool shouldPreloadWhenIdle,
+                      const std::function<void ()>& factory);
+
+  // The layers of the modules which have been instantiated are wired right away.
+  void setScene(cocos2d::Scene* scene, uint16_t cameraMask);
+
+  // Called by the ctor of each module.
+  void onInstantiated(UiModuleRegistry::Module module, cocos2d::Node* layer);
+
+  // Instantiates `module` with its factory if it hasn't been instantiated.
+  void require(UiModuleRegistry::Module module);
+  bool isInstantiated(UiModuleRegistry::Module module) const;
+
+  // Posts the instantiation of the modules registered with `shouldPreloadWhenIdle`
+  // to the DeferredTaskScheduler, one module per task.
+  void preloadWhenIdle();
+
+ private:
+  struct Entry final {
+    std::function<void ()> factory;
+    int zOrder;
+    bool shouldPreloadWhenIdle;
+    cocos2d::Node* layer;  // nullptr until the module has been instantiated
+    bool isWired;
+  };
+
+  UiModuleRegistry();
+
+  void wire(UiModuleRegistry::Entry& entry);
+
+  std::array<UiModuleRegistry::Entry, UiModuleRegistry::Module::SIZE> _entries;
+  cocos2d::Scene* _scene;
+  uint16_t _cameraMask;
+  cocos2d::Vector<cocos2d::Node*> _unwiredLayers;  // retained until they're wired
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_UI_MODULE_REGISTRY_H_
@@ -5,6 +5,7 @@
 
 #include "AssetManager.h"
 #include "ui/TableLayout.h"
+#include "util/LabelUtil.h"
 #include "util/Logger.h"
 
 #define DEFAULT_TITLE "Window Title"
@@ -19,11 +20,12 @@
 using std::string;
 using cocos2d::Vec2;
 using cocos2d::Size;
+using cocos2d::Mat4;
 using cocos2d::Node;
-using cocos2d::Vector;
 using cocos2d::Label;
 using cocos2d::Layer;
 using cocos2d::Director;
+using cocos2d::RenderTexture;
 using cocos2d::ui::Layout;
 using cocos2d::ui::ImageView;
 using vigilante::asset_manager::kBoldFont;
@@ -44,7 +46,7 @@ Window::Window(float width, float height)
     : _layer(Layer::create()),
       _layout(TableLayout::create(width, DEFAULT_ROW_HEIGHT)),
       _contentLayout(Layout::create()),
-      _titleLabel(Label::createWithTTF(DEFAULT_TITLE, kBoldFont, kRegularFontSize)),
+      _titleLabel(label_util::create(DEFAULT_TITLE, kBoldFont, kRegularFontSize)),
       _contentBg(ImageView::create(kWindowContentBg)),
       _topLeftBg(ImageView::create(kWindowTopLeftBg)),
       _topRightBg(ImageView::create(kWindowTopRightBg)),
@@ -54,6 +56,9 @@ Window::Window(float width, float height)
       _leftBg(ImageView::create(kWindowLeftBg)),
       _rightBg(ImageView::create(kWindowRightBg)),
       _bottomBg(ImageView::create(kWindowBottomBg)),
+      _chromeTexture(),
+      _isChromeCached(true),
+      _isChromeDirty(true),
       _position(0, 0),  // Calculated in Window::normalize()
       _size(width, height) {
 
@@ -73,6 +78,46 @@ Window::Window(float width, float height)
 }
 
 
+void Window::renderChrome() {
+  if (!_isChromeCached || !_isChromeDirty) {
+    return;
+  }
+  _isChromeDirty = false;
+
+  // (Re)create the texture if the window has been resized.
+  const Size textureSize(static_cast<int>(_size.width), static_cast<int>(_size.height));
+  if (!_chromeTexture || !_chromeTexture->getSprite()->getContentSize().equals(textureSize)) {
+    if (_chromeTexture) {
+      _layer->removeChild(_chromeTexture);
+    }
+    _chromeTexture = RenderTexture::create(textureSize.width, textureSize.height);
+    _chromeTexture->getSprite()->getTexture()->setAliasTexParameters();
+    _layer->addChild(_chromeTexture, -1);  // below `_contentLayout`
+  }
+
+  // The sprite of a RenderTexture isn't its child, so the camera mask
+  // has to be applied to it separately.
+  _chromeTexture->setCameraMask(_layer->getCameraMask());
+  _chromeTexture->getSprite()->setCameraMask(_layer->getCameraMask());
+  _chromeTexture->setPosition(_position.x + _size.width / 2, _position.y - _size.height / 2);
+  _chromeTexture->setVisible(true);
+
+  // Translate the window's top-left corner to the texture's top-left corner.
+  Mat4 transform;
+  Mat4::createTranslation(-_position.x, _size.height - _position.y, 0, &transform);
+
+  auto renderer = Director::getInstance()->getRenderer();
+  _layout->setVisible(true);
+  _titleLabel->setVisible(true);
+  _chromeTexture->beginWithClear(0, 0, 0, 0);
+  _layout->visit(renderer, transform, Node::FLAGS_TRANSFORM_DIRTY);
+  _titleLabel->visit(renderer, transform, Node::FLAGS_TRANSFORM_DIRTY);
+  _chromeTexture->end();
+  _layout->setVisible(false);
+  _titleLabel->setVisible(false);
+}
+
+
 void Window::move(const Vec2& position) {
   setPosition(position);
   normalize();
@@ -124,6 +169,12 @@ const Size& Window::getSize() const {
 
 
 void Window::setTitle(const string& title) {
+  // Some windows set their title in every update(),
+  // which shouldn't invalidate the cached chrome.
+  if (title == _titleLabel->getString()) {
+    return;
+  }
+
   _titleLabel->setString(title);
   normalize();
 }
@@ -133,20 +184,22 @@ void Window::setVisible(bool visible) {
   _layer->setVisible(visible);
 }
 
+void Window::setChromeCached(bool chromeCached) {
+  _isChromeCached = chromeCached;
+  _isChromeDirty = true;
+
+  _layout->setVisible(!chromeCached);
+  _titleLabel->setVisible(!chromeCached);
+  if (_chromeTexture) {
+    _chromeTexture->setVisible(chromeCached);
+  }
+}
+
 
 void Window::normalize(bool init) {
   TableLayout* layout = dynamic_cast<TableLayout*>(_layout);
   layout->setAnchorPoint({0, 1});  // Make top-left (0, 0)
 
-  // Copy all children to another cocos2d::Vector
-  // so that each child's reference count gets incremented by 1.
-  // (removeChild() and removeAllChild() will decrement child's refCount by 1).
-  Vector<Node*> children = layout->getChildren();
-  if (!init) {
-    layout->removeAllChildren();
-  }
-
-
   const auto winSize = Director::getInstance()->getWinSize();
   _position.x = winSize.width / 2 - _size.width / 2;
   _position.y = winSize.height / 2 + _size.height / 2;
@@ -163,23 +216,30 @@ void Window::normalize(bool init) {
   _rightBg->setScaleY(contentBgSize.height);
   _bottomBg->setScaleX(contentBgSize.width);
 
-  layout->addChild(_topLeftBg);
-  layout->addChild(_topBg);
-  layout->addChild(_topRightBg);
-  layout->row();
+  if (init) {
+    layout->addChild(_topLeftBg);
+    layout->addChild(_topBg);
+    layout->addChild(_topRightBg);
+    layout->row();
 
-  layout->addChild(_leftBg);
-  layout->addChild(_contentBg);
-  layout->addChild(_rightBg);
-  layout->row(_size.height - cornerBgSideLength * 2);
+    layout->addChild(_leftBg);
+    layout->addChild(_contentBg);
+    layout->addChild(_rightBg);
+    layout->row(contentBgSize.height);
 
-  layout->addChild(_bottomLeftBg);
-  layout->addChild(_bottomBg);
-  layout->addChild(_bottomRightBg);
+    layout->addChild(_bottomLeftBg);
+    layout->addChild(_bottomBg);
+    layout->addChild(_bottomRightBg);
 
-  if (init) {
     _layer->addChild(layout);
   } else {
+    // The frame is retained by `layout`, so only the rows
+    // whose cells have been rescaled are relaid out.
+    layout->resizeRow(1, contentBgSize.height);
+    layout->invalidate(_topBg);
+    layout->invalidate(_contentBg);
+    layout->invalidate(_bottomBg);
+
     layout->retain();
     _layer->removeChild(layout);  // child's refCount -= 1
     _layer->addChild(layout);  // child's refCount += 1
@@ -217,6 +277,12 @@ void Window::normalize(bool init) {
     _layer->addChild(_titleLabel);  // child's refCount += 1
     _titleLabel->release();
   }
+
+  // If the chrome is cached, the nodes above are only drawn
+  // into `_chromeTexture` (see renderChrome()).
+  _layout->setVisible(!_isChromeCached);
+  _titleLabel->setVisible(!_isChromeCached);
+  _isChromeDirty = true;
 }
 
 void Window::setPosition(const Vec2& position) {
@@ -26,6 +26,11 @@ class Window : public Controllable {
   virtual void resize(const cocos2d::Size& size);
   virtual void resize(float width, float height);
 
+  // If the chrome (the frame and the title) is cached, it's rendered into
+  // a RenderTexture only when it has changed (e.g., moved, resized or retitled),
+  // and then drawn as a single sprite. Called by WindowManager::update().
+  void renderChrome();
+
   cocos2d::Layer* getLayer() const;
   cocos2d::ui::Layout* getLayout() const;
   cocos2d::ui::Layout* getContentLayout() const;
@@ -36,6 +41,7 @@ class Window : public Controllable {
 
   void setTitle(const std::string& title);
   void setVisible(bool visible);
+  void setChromeCached(bool chromeCached);
 
  protected:
   // Place the window at the center, and place `_titleLabel` as well as
@@ -60,7 +66,10 @@ class Window : public Controllable {
   cocos2d::ui::ImageView* _leftBg;
   cocos2d::ui::ImageView* _rightBg;
   cocos2d::ui::ImageView* _bottomBg;
-  
+
+  cocos2d::RenderTexture* _chromeTexture;
+  bool _isChromeCached;
+  bool _isChromeDirty;
 
   bool _isVisible;
   cocos2d::Vec2 _position;
@@ -2,8 +2,10 @@
 #include "WindowManager.h"
 
 #include "Constants.h"
+#include "util/FrameBudget.h"
 #include "util/Logger.h"
 
+using std::string;
 using std::unique_ptr;
 using cocos2d::Scene;
 using cocos2d::CameraFlag;
@@ -27,6 +29,9 @@ WindowManager::WindowManager()
 
 void WindowManager::update(float delta) {
   for (auto& w : _windows) {
+    const string title = w->getTitle();
+    FrameBudget::ScopedOffender offender(FrameBudget::Subsystem::UI, title);
+    w->renderChrome();
     w->update(delta);
   }
 }
@@ -1,43 +1,86 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "CommandParser.h"
 
+#include <algorithm>
+#include <fstream>
 #include <memory>
 
+#include "AssetManager.h"
+#include "Constants.h"
+#include "HotReloader.h"
 #include "character/Player.h"
 #include "character/Npc.h"
+#include "character/NpcPool.h"
+#include "gameplay/CheckpointManager.h"
 #include "gameplay/DialogueTree.h"
+#include "gameplay/GameplayBenchmark.h"
+#include "gameplay/GameState.h"
+#include "gameplay/PickupSystem.h"
+#include "gameplay/RenderStressTest.h"
+#include "gameplay/UiBenchmark.h"
+#include "gl/ResolutionScaler.h"
+#include "input/InputManager.h"
 #include "item/Item.h"
 #include "map/GameMapManager.h"
+#include "map/MapLoadBenchmark.h"
+#include "net/CoopSession.h"
 #include "ui/dialogue/DialogueManager.h"
 #include "ui/notifications/Notifications.h"
+#include "ui/perf_hud/PerformanceHud.h"
+#include "util/AssetId.h"
+#include "util/FrameBudget.h"
+#include "util/FramePacer.h"
+#include "util/FrameProfiler.h"
+#include "util/HitchDetector.h"
+#include "util/LoadProfiler.h"
+#include "util/MemoryTracker.h"
+#include "util/MicroBenchmark.h"
+#include "util/RandUtil.h"
 #include "util/StringUtil.h"
+#include "util/Telemetry.h"
+#include "util/TraceProfiler.h"
 #include "util/Logger.h"
+#include "util/ds/Trie.h"
 
 #define DEFAULT_ERR_MSG "unable to parse this line"
+#define MAX_COMPILED_CMD_COUNT 128
+#define ITEM_ASSETS_DIR "Database/item/"
+#define CHARACTER_ASSETS_DIR "Database/character/"
+#define DEFAULT_GAME_SAVE_FILE_NAME "save.bin"
+#define DEFAULT_BENCHMARK_NPC_COUNT 20  // of each faction
+#define DEFAULT_BENCHMARK_DURATION 30  // in seconds of game time
+#define DEFAULT_BENCHMARK_RESULT_FILE_NAME "benchmark.json"
+#define DEFAULT_MAP_BENCHMARK_RESULT_FILE_NAME "mapbenchmark.json"
+#define DEFAULT_UI_BENCHMARK_ITERATIONS 20
+#define DEFAULT_UI_BENCHMARK_ITEM_AMOUNT 5  // of each item
+#define DEFAULT_UI_BENCHMARK_RESULT_FILE_NAME "uibenchmark.json"
+#define DEFAULT_RENDER_STRESS_NPC_COUNT 100
+#define DEFAULT_RENDER_STRESS_EVENTS_PER_FRAME 4  // fx and floating damages
+#define DEFAULT_RENDER_STRESS_DURATION 30  // in seconds
+#define DEFAULT_RENDER_STRESS_RESULT_FILE_NAME "renderstress.json"
+#define DEFAULT_MICRO_BENCHMARK_MIN_TIME 0.1f  // in seconds of each case
+#define DEFAULT_MICRO_BENCHMARK_RESULT_FILE_NAME "microbench.json"
+#define DEFAULT_TRACE_DURATION 10  // in seconds
+#define DEFAULT_TRACE_FILE_NAME "trace.json"
+#define MAX_OPEN_TRACE_DURATION 600  // in seconds, of a trace started by "perf trace start"
+#define MAX_SPAWN_COUNT 500
+#define SPAWN_SPACING 16  // in pixels, between the spawned npcs
 
 using std::string;
 using std::vector;
+using std::ifstream;
 using std::unique_ptr;
 using std::shared_ptr;
 using std::out_of_range;
 using std::invalid_argument;
 
-using CmdTable = std::unordered_map<std::string,
-      void (vigilante::CommandParser::*)(const std::vector<std::string>&)>;
+using CmdTable = std::unordered_map<std::string, vigilante::CommandParser::Handler>;
 
 namespace vigilante {
 
-CommandParser::CommandParser() : _success(), _errMsg() {}
-
-void CommandParser::parse(const string& cmd, bool showNotification) {
-  vector<string> args;
-  if (cmd.empty() || (args = string_util::split(cmd)).empty()) {
-    return;
-  }
-
-  _success = false;
-  _errMsg = DEFAULT_ERR_MSG;
+CommandParser::CommandParser() : _success(), _errMsg(), _compiledCmds() {}
 
+const CmdTable& CommandParser::getCommandTable() {
   // Command handler table.
   static const CmdTable cmdTable = {
     {"startQuest",              &CommandParser::startQuest             },
@@ -50,25 +93,144 @@ void CommandParser::parse(const string& cmd, bool showNotification) {
     {"playerPartyMemberFollow", &CommandParser::playerPartyMemberFollow},
     {"tradeWithPlayer",         &CommandParser::tradeWithPlayer        },
     {"killCurrentTarget",       &CommandParser::killCurrentTarget      },
+    {"dumpProfile",             &CommandParser::dumpProfile            },
+    {"dumpLoadProfile",         &CommandParser::dumpLoadProfile        },
+    {"memoryReport",            &CommandParser::memoryReport           },
+    {"renderScale",             &CommandParser::renderScale            },
+    {"batterySaver",            &CommandParser::batterySaver           },
+    {"pickup",                  &CommandParser::pickup                 },
+    {"hotReload",               &CommandParser::hotReload              },
+    {"lootBag",                 &CommandParser::lootBag                },
+    {"seed",                    &CommandParser::seed                   },
+    {"replay",                  &CommandParser::replay                 },
+    {"saveGame",                &CommandParser::saveGame               },
+    {"loadGame",                &CommandParser::loadGame               },
+    {"checkpoint",              &CommandParser::checkpoint             },
+    {"benchmark",               &CommandParser::benchmark              },
+    {"mapBenchmark",            &CommandParser::mapBenchmark           },
+    {"uiBenchmark",             &CommandParser::uiBenchmark            },
+    {"renderStress",            &CommandParser::renderStress           },
+    {"microbench",              &CommandParser::microbench             },
+    {"trace",                   &CommandParser::trace                  },
+    {"hitchBudget",             &CommandParser::hitchBudget            },
+    {"frameBudget",             &CommandParser::frameBudget            },
+    {"telemetry",               &CommandParser::telemetry              },
+    {"coop",                    &CommandParser::coop                   },
+    {"perf",                    &CommandParser::perf                   },
+    {"spawn",                   &CommandParser::spawn                  },
+    {"lod",                     &CommandParser::lod                    },
+    {"physics",                 &CommandParser::physics                },
+    {"mem",                     &CommandParser::mem                    },
   };
- 
-  // Execute the corresponding command handler from _cmdTable.
-  // The obtained value from _cmdTable is a class member function pointer.
-  CmdTable::const_iterator it = cmdTable.find(args[0]);
+  return cmdTable;
+}
+
+CommandParser::Command CommandParser::compile(const string& cmd) {
+  Command compiledCmd{cmd, string_util::split(cmd), nullptr};
+  if (compiledCmd.args.empty()) {
+    return compiledCmd;
+  }
+
+  // Look up the corresponding command handler from the command table.
+  // The obtained value from the table is a class member function pointer.
+  const CmdTable& cmdTable = getCommandTable();
+  CmdTable::const_iterator it = cmdTable.find(compiledCmd.args[0]);
   if (it != cmdTable.end()) {
-    (this->*((*it).second))(args);
+    compiledCmd.handler = it->second;
+  }
+  return compiledCmd;
+}
+
+void CommandParser::parse(const string& cmd, bool showNotification) {
+  auto it = _compiledCmds.find(cmd);
+  if (it == _compiledCmds.end()) {
+    if (_compiledCmds.size() >= MAX_COMPILED_CMD_COUNT) {
+      _compiledCmds.clear();
+    }
+    it = _compiledCmds.emplace(cmd, compile(cmd)).first;
+  }
+  execute(it->second, showNotification);
+}
+
+void CommandParser::execute(const CommandParser::Command& cmd, bool showNotification) {
+  if (cmd.args.empty()) {
+    return;
+  }
+
+  _success = false;
+  _errMsg = DEFAULT_ERR_MSG;
+
+  if (cmd.handler) {
+    (this->*cmd.handler)(cmd.args);
   }
 
   if (!_success) {
-    _errMsg = args[0] + ": " + _errMsg;
+    _errMsg = cmd.args[0] + ": " + _errMsg;
     VGLOG(LOG_ERR, "%s", _errMsg.c_str());
   }
 
   if (showNotification) {
-    Notifications::getInstance()->show((_success) ? cmd : _errMsg);
+    Notifications::getInstance()->show((_success) ? cmd.text : _errMsg);
   }
 }
 
+string CommandParser::complete(const string& line,
+                               vector<string>* candidates,
+                               size_t maxCandidates) const {
+  // The index is built the first time it's needed, since listing
+  // the assets (e.g., all item jsons) takes a while.
+  static Trie cmdNames;
+  static Trie itemAssets;
+  static Trie questAssets;
+  static Trie characterAssets;
+  if (cmdNames.empty()) {
+    for (const auto& p : getCommandTable()) {
+      cmdNames.insert(p.first);
+    }
+    for (const auto& itemJson : asset_manager::listJsonFiles(ITEM_ASSETS_DIR)) {
+      itemAssets.insert(itemJson);
+    }
+    for (const auto& characterJson : asset_manager::listJsonFiles(CHARACTER_ASSETS_DIR)) {
+      characterAssets.insert(characterJson);
+    }
+    // These are the names accepted by QuestBook::startQuest().
+    ifstream fin(asset_manager::kQuestsList);
+    string questJson;
+    while (std::getline(fin, questJson)) {
+      questAssets.insert(questJson);
+    }
+  }
+
+  // The word being completed is the one after the last space.
+  const size_t wordBegin = line.find_last_of(' ') + 1;  // npos + 1 == 0
+  const string word = line.substr(wordBegin);
+  const vector<string> args = string_util::split(line.substr(0, wordBegin));
+
+  const Trie* trie = nullptr;
+  if (args.empty()) {
+    trie = &cmdNames;
+  } else if (args.size() == 1 && (args[0] == "addItem" || args[0] == "removeItem")) {
+    trie = &itemAssets;
+  } else if (args.size() == 1 && args[0] == "startQuest") {
+    trie = &questAssets;
+  } else if (args.size() == 1 && args[0] == "spawn") {
+    trie = &characterAssets;
+  } else {
+    return line;
+  }
+
+  const string completion = trie->complete(word);
+  if (completion.empty()) {
+    return line;
+  }
+
+  if (candidates && completion == word) {
+    trie->getWords(word, candidates, maxCandidates);
+  }
+  return line.substr(0, wordBegin) + completion;
+}
+
+
 void CommandParser::setSuccess() {
   _success = true;
 }
@@ -164,7 +326,7 @@ void CommandParser::updateDialogueTree(const vector<string>& args) {
 
   // TODO: Maybe add some argument check here?
  
-  DialogueTree::setLatestNpcDialogueTree(args[1], args[2]);
+  DialogueTree::setLatestNpcDialogueTree(AssetId(args[1]), args[2]);
   setSuccess();
 }
 
@@ -209,7 +371,7 @@ void CommandParser::playerPartyMemberWait(const vector<string>&) {
     return;
   }
 
-  if (player->getParty()->hasWaitingMember(targetNpc->getCharacterProfile().jsonFileName)) {
+  if (player->getParty()->hasWaitingMember(targetNpc->getCharacterProfile().id)) {
     setError("This Npc is already waiting for player.");
     return;
   }
@@ -229,7 +391,7 @@ void CommandParser::playerPartyMemberFollow(const vector<string>&) {
     return;
   }
 
-  if (!player->getParty()->hasWaitingMember(targetNpc->getCharacterProfile().jsonFileName)) {
+  if (!player->getParty()->hasWaitingMember(targetNpc->getCharacterProfile().id)) {
     setError("This Npc is not waiting for player yet.");
     return;
   }
@@ -263,4 +425,767 @@ void CommandParser::killCurrentTarget(const vector<string>&) {
   setSuccess();
 }
 
+void CommandParser::dumpProfile(const vector<string>& args) {
+  // The file is written under the writable path.
+  const string fileName = (args.size() >= 2) ? args[1] : "profile.csv";
+  FrameProfiler* profiler = FrameProfiler::getInstance();
+
+  if (!profiler->isRecording()) {
+    setError("enable debug mode first");
+    return;
+  }
+
+  if (!profiler->dumpCsv(cocos2d::FileUtils::getInstance()->getWritablePath() + fileName)) {
+    setError("unable to write " + fileName);
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::dumpLoadProfile(const vector<string>& args) {
+  // The file is written under the writable path.
+  const string fileName = (args.size() >= 2) ? args[1] : "load_profile.json";
+
+  if (!LoadProfiler::getInstance()->dumpJson(
+        cocos2d::FileUtils::getInstance()->getWritablePath() + fileName)) {
+    setError("unable to write " + fileName);
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::memoryReport(const vector<string>& args) {
+  // The file is written under the writable path.
+  const string fileName = (args.size() >= 2) ? args[1] : "memory_report.csv";
+
+  if (!MemoryTracker::getInstance()->dumpReport(
+        cocos2d::FileUtils::getInstance()->getWritablePath() + fileName,
+        GameMapManager::getInstance()->getGameMap())) {
+    setError("unable to write " + fileName);
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::renderScale(const vector<string>& args) {
+  ResolutionScaler* resolutionScaler = ResolutionScaler::getInstance();
+  if (args.size() < 2) {
+    Notifications::getInstance()->show("renderScale: " +
+                                       std::to_string(resolutionScaler->getScale()) + "x");
+    setSuccess();
+    return;
+  }
+
+  if (args[1] == "native") {
+    resolutionScaler->setMode(ResolutionScaler::Mode::NATIVE);
+  } else if (args[1] == "virtual") {
+    resolutionScaler->setMode(ResolutionScaler::Mode::VIRTUAL);
+  } else if (args[1] == "dynamic") {
+    resolutionScaler->setMode(ResolutionScaler::Mode::DYNAMIC);
+  } else {
+    setError("usage: renderScale <native|virtual|dynamic> [hud:native|hud:scaled]");
+    return;
+  }
+
+  if (args.size() >= 3) {
+    if (args[2] != "hud:native" && args[2] != "hud:scaled") {
+      setError("usage: renderScale <native|virtual|dynamic> [hud:native|hud:scaled]");
+      return;
+    }
+    resolutionScaler->setHudNative(args[2] == "hud:native");
+  }
+  setSuccess();
+}
+
+void CommandParser::batterySaver(const vector<string>& args) {
+  if (args.size() < 2 || (args[1] != "on" && args[1] != "off")) {
+    setError("usage: batterySaver <on|off>");
+    return;
+  }
+
+  FramePacer::getInstance()->setBatterySaverEnabled(args[1] == "on");
+  setSuccess();
+}
+
+void CommandParser::pickup(const vector<string>& args) {
+  if (args.size() < 3 ||
+      (args[1] != "autoLoot" && args[1] != "magnet") ||
+      (args[2] != "on" && args[2] != "off")) {
+    setError("usage: pickup <autoLoot|magnet> <on|off>");
+    return;
+  }
+
+  const bool enabled = args[2] == "on";
+  if (args[1] == "autoLoot") {
+    PickupSystem::getInstance()->setAutoLootEnabled(enabled);
+  } else {
+    PickupSystem::getInstance()->setMagnetEnabled(enabled);
+  }
+  setSuccess();
+}
+
+void CommandParser::hotReload(const vector<string>& args) {
+  if (args.size() < 2 || (args[1] != "on" && args[1] != "off")) {
+    setError("usage: hotReload <on|off>");
+    return;
+  }
+
+  const bool enabled = args[1] == "on";
+  if (enabled && asset_manager::isDatabasePackLoaded()) {
+    setError("json files are served from the database pack");
+    return;
+  }
+
+  HotReloader::getInstance()->setEnabled(enabled);
+  setSuccess();
+}
+
+void CommandParser::lootBag(const vector<string>& args) {
+  if (args.size() < 2 || (args[1] != "on" && args[1] != "off")) {
+    setError("usage: lootBag <on|off>");
+    return;
+  }
+
+  GameMap::setLootBagEnabled(args[1] == "on");
+  setSuccess();
+}
+
+void CommandParser::seed(const vector<string>& args) {
+  if (args.size() < 2) {
+    Notifications::getInstance()->show("seed: " + std::to_string(rand_util::getSeed()));
+    setSuccess();
+    return;
+  }
+
+  uint64_t seed = 0;
+  try {
+    seed = std::stoull(args[1]);
+  } catch (const invalid_argument& ex) {
+    setError("invalid argument `seed`");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`seed` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  rand_util::seed(seed);
+  setSuccess();
+}
+
+void CommandParser::replay(const vector<string>& args) {
+  if (args.size() < 2 || (args[1] != "record" && args[1] != "play" && args[1] != "stop")) {
+    setError("usage: replay <record|play|stop> [file]");
+    return;
+  }
+
+  InputManager* inputManager = InputManager::getInstance();
+
+  if (args[1] == "stop") {
+    if (inputManager->getReplayMode() == InputManager::ReplayMode::NONE) {
+      setError("no replay is in progress");
+      return;
+    }
+    if (!inputManager->stopReplay()) {
+      setError("unable to write the replay");
+      return;
+    }
+    setSuccess();
+    return;
+  }
+
+  if (inputManager->getReplayMode() != InputManager::ReplayMode::NONE) {
+    setError("a replay is in progress");
+    return;
+  }
+
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  Player* player = gmMgr->getPlayer();
+  if (!gmMgr->getGameMap() || !player) {
+    setError("no game in progress");
+    return;
+  }
+
+  // The file is read from / written under the writable path.
+  const string fileName = (args.size() >= 3) ? args[2] : "replay.txt";
+  const string filePath = cocos2d::FileUtils::getInstance()->getWritablePath() + fileName;
+
+  InputManager::ReplayHeader header{};
+  if (args[1] == "record") {
+    const b2Vec2& playerPos = player->getBody()->GetPosition();
+    header = {rand_util::getSeed(), gmMgr->getGameMap()->getTmxTiledMapFileName(),
+              playerPos.x, playerPos.y};
+    if (!inputManager->startRecording(filePath, header)) {
+      setError("unable to write " + fileName);
+      return;
+    }
+  } else if (!inputManager->startPlayback(filePath, &header)) {
+    setError("unable to read " + fileName);
+    return;
+  }
+
+  // Both recording and playback start from a freshly loaded GameMap
+  // with the RNG reseeded, so that the world state is the same.
+  rand_util::seed(header.seed);
+  gmMgr->loadGameMap(header.tmxMapFileName, [header]() {
+    rand_util::seed(header.seed);
+    GameMapManager::getInstance()->getPlayer()->setPosition(header.playerX, header.playerY);
+    InputManager::getInstance()->beginReplay();
+  });
+  setSuccess();
+}
+
+void CommandParser::saveGame(const vector<string>& args) {
+  // The file is written under the writable path.
+  const string fileName = (args.size() >= 2) ? args[1] : DEFAULT_GAME_SAVE_FILE_NAME;
+
+  GameState gameState;
+  gameState.setFilePath(cocos2d::FileUtils::getInstance()->getWritablePath() + fileName);
+  if (!gameState.save()) {
+    setError("unable to write " + fileName);
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::loadGame(const vector<string>& args) {
+  const string fileName = (args.size() >= 2) ? args[1] : DEFAULT_GAME_SAVE_FILE_NAME;
+
+  GameState gameState;
+  gameState.setFilePath(cocos2d::FileUtils::getInstance()->getWritablePath() + fileName);
+  if (!gameState.load()) {
+    setError("unable to read " + fileName);
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::checkpoint(const vector<string>& args) {
+  CheckpointManager* checkpointManager = CheckpointManager::getInstance();
+
+  // Without any argument (e.g., from a trigger), a checkpoint is taken.
+  if (args.size() < 2) {
+    checkpointManager->request();
+    setSuccess();
+    return;
+  }
+
+  if (args[1] == "retry") {
+    if (!checkpointManager->retry()) {
+      setError("no checkpoint has been taken");
+      return;
+    }
+  } else if (args[1] == "clear") {
+    checkpointManager->clear();
+  } else {
+    setError("usage: checkpoint [retry|clear]");
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::benchmark(const vector<string>& args) {
+  if (args.size() < 3) {
+    setError("usage: benchmark <hostileNpc> <allyNpc> [npcsPerFaction] [seconds] [collectItem]");
+    return;
+  }
+
+  GameplayBenchmark::Config config{args[1], args[2], "",
+                                   DEFAULT_BENCHMARK_NPC_COUNT, DEFAULT_BENCHMARK_DURATION,
+                                   cocos2d::FileUtils::getInstance()->getWritablePath() +
+                                   DEFAULT_BENCHMARK_RESULT_FILE_NAME};
+  try {
+    if (args.size() >= 4) {
+      config.numNpcs = std::stoi(args[3]);
+    }
+    if (args.size() >= 5) {
+      config.duration = std::stof(args[4]);
+    }
+  } catch (const invalid_argument& ex) {
+    setError("invalid argument `npcsPerFaction` or `seconds`");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`npcsPerFaction` or `seconds` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+  if (args.size() >= 6) {
+    config.collectItemJson = args[5];
+  }
+
+  if (config.numNpcs <= 0 || config.duration <= 0) {
+    setError("`npcsPerFaction` and `seconds` have to be positive");
+    return;
+  }
+
+  if (!GameplayBenchmark::getInstance()->start(config)) {
+    setError("no game in progress or a benchmark is running");
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::mapBenchmark(const vector<string>& args) {
+  const string fileName = cocos2d::FileUtils::getInstance()->getWritablePath() +
+                          ((args.size() >= 2) ? args[1] : DEFAULT_MAP_BENCHMARK_RESULT_FILE_NAME);
+
+  if (!MapLoadBenchmark::getInstance()->run(fileName)) {
+    setError("no game in progress");
+    return;
+  }
+  Notifications::getInstance()->show("Map load benchmark results written to: " + fileName);
+  setSuccess();
+}
+
+void CommandParser::uiBenchmark(const vector<string>& args) {
+  if (args.size() < 2) {
+    setError("usage: uiBenchmark <npc> [iterations] [itemAmount]");
+    return;
+  }
+
+  UiBenchmark::Config config{args[1], DEFAULT_UI_BENCHMARK_ITERATIONS,
+                             DEFAULT_UI_BENCHMARK_ITEM_AMOUNT,
+                             cocos2d::FileUtils::getInstance()->getWritablePath() +
+                             DEFAULT_UI_BENCHMARK_RESULT_FILE_NAME};
+  try {
+    if (args.size() >= 3) {
+      config.iterations = std::stoi(args[2]);
+    }
+    if (args.size() >= 4) {
+      config.itemAmount = std::stoi(args[3]);
+    }
+  } catch (const invalid_argument& ex) {
+    setError("invalid argument `iterations` or `itemAmount`");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`iterations` or `itemAmount` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  if (config.iterations <= 0 || config.itemAmount <= 0) {
+    setError("`iterations` and `itemAmount` have to be positive");
+    return;
+  }
+
+  if (!UiBenchmark::getInstance()->run(config)) {
+    setError("no game in progress");
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::renderStress(const vector<string>& args) {
+  if (args.size() < 2) {
+    setError("usage: renderStress <npc> [npcs] [eventsPerFrame] [seconds]");
+    return;
+  }
+
+  RenderStressTest::Config config{args[1], DEFAULT_RENDER_STRESS_NPC_COUNT,
+                                  DEFAULT_RENDER_STRESS_EVENTS_PER_FRAME,
+                                  DEFAULT_RENDER_STRESS_DURATION,
+                                  cocos2d::FileUtils::getInstance()->getWritablePath() +
+                                  DEFAULT_RENDER_STRESS_RESULT_FILE_NAME};
+  try {
+    if (args.size() >= 3) {
+      config.numNpcs = std::stoi(args[2]);
+    }
+    if (args.size() >= 4) {
+      config.eventsPerFrame = std::stoi(args[3]);
+    }
+    if (args.size() >= 5) {
+      config.duration = std::stof(args[4]);
+    }
+  } catch (const invalid_argument& ex) {
+    setError("invalid argument `npcs`, `eventsPerFrame` or `seconds`");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`npcs`, `eventsPerFrame` or `seconds` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  if (config.numNpcs <= 0 || config.eventsPerFrame < 0 || config.duration <= 0) {
+    setError("`npcs` and `seconds` have to be positive");
+    return;
+  }
+
+  if (!RenderStressTest::getInstance()->start(config)) {
+    setError("no game in progress or a render stress test is running");
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::microbench(const vector<string>& args) {
+  const string filter = (args.size() >= 2) ? args[1] : "";
+  float minTime = DEFAULT_MICRO_BENCHMARK_MIN_TIME;
+  try {
+    if (args.size() >= 3) {
+      minTime = std::stof(args[2]);
+    }
+  } catch (const invalid_argument& ex) {
+    setError("invalid argument `minSeconds`");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`minSeconds` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  if (minTime <= 0) {
+    setError("usage: microbench [filter] [minSeconds]");
+    return;
+  }
+
+  const vector<micro_benchmark::Result> results = micro_benchmark::run(minTime, filter);
+  if (results.empty()) {
+    setError("no micro benchmark matches `" + filter + "`");
+    return;
+  }
+
+  const string fileName = cocos2d::FileUtils::getInstance()->getWritablePath() +
+                          DEFAULT_MICRO_BENCHMARK_RESULT_FILE_NAME;
+  if (!micro_benchmark::writeResults(results, fileName)) {
+    setError("unable to write the results");
+    return;
+  }
+  Notifications::getInstance()->show(
+      string_util::format("Micro benchmark results written to: %s", fileName.c_str()));
+  setSuccess();
+}
+
+void CommandParser::trace(const vector<string>& args) {
+  TraceProfiler* traceProfiler = TraceProfiler::getInstance();
+  if (args.size() >= 2 && args[1] == "stop") {
+    if (!traceProfiler->isCapturing()) {
+      setError("no trace is being captured");
+      return;
+    }
+    traceProfiler->stop();
+    setSuccess();
+    return;
+  }
+
+  float duration = DEFAULT_TRACE_DURATION;
+  try {
+    if (args.size() >= 2) {
+      duration = std::stof(args[1]);
+    }
+  } catch (const invalid_argument& ex) {
+    setError("usage: trace [seconds|stop] [fileName]");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`seconds` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  if (duration <= 0) {
+    setError("`seconds` has to be positive");
+    return;
+  }
+
+  // The file is written under the writable path,
+  // and can be opened in chrome://tracing or ui.perfetto.dev.
+  const string fileName = (args.size() >= 3) ? args[2] : DEFAULT_TRACE_FILE_NAME;
+  if (!traceProfiler->start(duration,
+                            cocos2d::FileUtils::getInstance()->getWritablePath() + fileName)) {
+    setError("a trace is already being captured or written");
+    return;
+  }
+  setSuccess();
+}
+
+void CommandParser::hitchBudget(const vector<string>& args) {
+  HitchDetector* hitchDetector = HitchDetector::getInstance();
+  if (args.size() >= 2 && args[1] == "off") {
+    hitchDetector->setEnabled(false);
+    setSuccess();
+    return;
+  }
+
+  float budget = 0;
+  try {
+    if (args.size() < 2) {
+      throw invalid_argument("no budget");
+    }
+    budget = std::stof(args[1]);
+  } catch (const invalid_argument& ex) {
+    setError("usage: hitchBudget <milliseconds|off>");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`milliseconds` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  if (budget <= 0) {
+    setError("`milliseconds` has to be positive");
+    return;
+  }
+
+  hitchDetector->setBudget(budget / 1000);
+  hitchDetector->setEnabled(true);
+  setSuccess();
+}
+
+void CommandParser::frameBudget(const vector<string>& args) {
+  FrameBudget* frameBudget = FrameBudget::getInstance();
+  if (args.size() >= 2 && (args[1] == "on" || args[1] == "off")) {
+    frameBudget->setEnabled(args[1] == "on");
+    setSuccess();
+    return;
+  }
+
+  const FrameBudget::Subsystem subsystem = (args.size() >= 2) ? FrameBudget::getSubsystem(args[1])
+                                                              : FrameBudget::Subsystem::SUBSYSTEM_SIZE;
+  float budget = 0;
+  try {
+    if (args.size() < 3 || subsystem == FrameBudget::Subsystem::SUBSYSTEM_SIZE) {
+      throw invalid_argument("no budget");
+    }
+    budget = std::stof(args[2]);
+  } catch (const invalid_argument& ex) {
+    setError("usage: frameBudget <on|off|physics|ai|gameMap|ui> [milliseconds]");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`milliseconds` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  if (budget <= 0) {
+    setError("`milliseconds` has to be positive");
+    return;
+  }
+
+  frameBudget->setBudget(subsystem, budget);
+  frameBudget->setEnabled(true);
+  setSuccess();
+}
+
+void CommandParser::telemetry(const vector<string>& args) {
+  if (args.size() < 2 || (args[1] != "on" && args[1] != "off")) {
+    setError("usage: telemetry <on|off>");
+    return;
+  }
+
+  Telemetry::getInstance()->setEnabled(args[1] == "on");
+  setSuccess();
+}
+
+void CommandParser::coop(const vector<string>& args) {
+  CoopSession* coopSession = CoopSession::getInstance();
+  if (args.size() >= 2 && args[1] == "stop") {
+    coopSession->stop();
+    setSuccess();
+    return;
+  }
+
+  if (args.size() >= 2 && args[1] == "status") {
+    const char* role = (coopSession->isHost()) ? "host" : (coopSession->isClient()) ? "client" : "none";
+    Notifications::getInstance()->show(string_util::format(
+        "coop: %s, %s, %.0f B/s up, %.0f B/s down", role,
+        (coopSession->isConnected()) ? "connected" : "not connected",
+        coopSession->getUploadRate(), coopSession->getDownloadRate()));
+    setSuccess();
+    return;
+  }
+
+  const bool isHost = args.size() >= 2 && args[1] == "host";
+  const bool isJoin = args.size() >= 3 && args[1] == "join";
+  if (!isHost && !isJoin) {
+    setError("usage: coop <host [port]|join <address> [port]|status|stop>");
+    return;
+  }
+
+  int port = CoopSession::kDefaultPort;
+  try {
+    const size_t portArgIndex = (isHost) ? 2 : 3;
+    if (args.size() > portArgIndex) {
+      port = std::stoi(args[portArgIndex]);
+    }
+  } catch (const invalid_argument& ex) {
+    setError("invalid argument `port`");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`port` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  if (port <= 0 || port > 65535) {
+    setError("`port` has to be within 1-65535");
+    return;
+  }
+
+  if (!GameMapManager::getInstance()->getGameMap()) {
+    setError("no game in progress");
+    return;
+  }
+
+  const bool isStarted = (isHost) ? coopSession->host(static_cast<uint16_t>(port))
+                                  : coopSession->join(args[2], static_cast<uint16_t>(port));
+  if (!isStarted) {
+    setError("unable to start the session");
+    return;
+  }
+  setSuccess();
+}
+
+// The performance tooling under one command, so that it can be driven
+// from the scripts and dialogues as well, e.g., "perf trace start boss.json".
+// Each subcommand is forwarded to the standalone command it stands for.
+void CommandParser::perf(const vector<string>& args) {
+  if (args.size() >= 3 && args[1] == "trace" && args[2] == "start") {
+    const string fileName = (args.size() >= 4) ? args[3] : DEFAULT_TRACE_FILE_NAME;
+    trace({"trace", std::to_string(MAX_OPEN_TRACE_DURATION), fileName});
+    return;
+  }
+
+  if (args.size() >= 3 && args[1] == "trace" && args[2] == "stop") {
+    // The trace is written to the file given to "perf trace start".
+    trace({"trace", "stop"});
+    return;
+  }
+
+  if (args.size() >= 3 && args[1] == "hud" && (args[2] == "on" || args[2] == "off")) {
+    PerformanceHud::getInstance()->setVisible(args[2] == "on");
+    setSuccess();
+    return;
+  }
+
+  if (args.size() >= 4 && args[1] == "budget") {
+    frameBudget({"frameBudget", args[2], args[3]});
+    return;
+  }
+
+  setError("usage: perf <trace start [file]|trace stop|hud <on|off>|budget <subsystem> <milliseconds>>");
+}
+
+void CommandParser::spawn(const vector<string>& args) {
+  if (args.size() < 2) {
+    setError("usage: spawn <npcJson> [count]");
+    return;
+  }
+
+  int count = 1;
+  if (args.size() >= 3) {
+    try {
+      count = std::stoi(args[2]);
+    } catch (const invalid_argument& ex) {
+      setError("invalid argument `count`");
+      return;
+    } catch (const out_of_range& ex) {
+      setError("`count` is too large");
+      return;
+    } catch (...) {
+      setError("unknown error");
+      return;
+    }
+  }
+
+  if (count <= 0 || count > MAX_SPAWN_COUNT) {
+    setError("`count` has to be within 1-" + std::to_string(MAX_SPAWN_COUNT));
+    return;
+  }
+
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  GameMap* gameMap = gmMgr->getGameMap();
+  Player* player = gmMgr->getPlayer();
+  if (!gameMap || !player || !player->getBody()) {
+    setError("no game in progress");
+    return;
+  }
+
+  // The npcs are lined up on both sides of the player (like RenderStressTest),
+  // and the line is clamped to the bounds of the GameMap. Unlike the stress
+  // test, they keep their own disposition, and they're never despawned.
+  const float playerX = player->getBody()->GetPosition().x * kPpm;
+  const float playerY = player->getBody()->GetPosition().y * kPpm;
+  const float width = (count - 1) * SPAWN_SPACING;
+  const float beginX = std::max(0.0f, std::min(playerX - width / 2, gameMap->getWidth() - width));
+  for (int i = 0; i < count; i++) {
+    const float x = std::min(beginX + i * SPAWN_SPACING, gameMap->getWidth());
+    gameMap->showDynamicActor<Npc>(NpcPool::getInstance()->acquire(args[1]), x, playerY);
+  }
+  setSuccess();
+}
+
+void CommandParser::lod(const vector<string>& args) {
+  GameMapManager* gmMgr = GameMapManager::getInstance();
+  if (args.size() < 2) {
+    Notifications::getInstance()->show(
+        string_util::format("lod: %.0f px", gmMgr->getLodMargin()));
+    setSuccess();
+    return;
+  }
+
+  float lodMargin = 0;
+  try {
+    lodMargin = std::stof(args[1]);
+  } catch (const invalid_argument& ex) {
+    setError("usage: lod [pixels]");
+    return;
+  } catch (const out_of_range& ex) {
+    setError("`pixels` is too large");
+    return;
+  } catch (...) {
+    setError("unknown error");
+    return;
+  }
+
+  if (lodMargin < 0) {
+    setError("`pixels` cannot be negative");
+    return;
+  }
+
+  gmMgr->setLodMargin(lodMargin);
+  setSuccess();
+}
+
+void CommandParser::physics(const vector<string>& args) {
+  if (args.size() < 3 || args[1] != "ccd" ||
+      (args[2] != "on" && args[2] != "off" && args[2] != "auto")) {
+    setError("usage: physics ccd <on|off|auto>");
+    return;
+  }
+
+  GameMapManager::getInstance()->setContinuousPhysicsMode(
+      (args[2] == "on") ? GameMapManager::ContinuousPhysicsMode::ALWAYS :
+      (args[2] == "off") ? GameMapManager::ContinuousPhysicsMode::NEVER :
+                           GameMapManager::ContinuousPhysicsMode::AUTO);
+  setSuccess();
+}
+
+void CommandParser::mem(const vector<string>& args) {
+  if (args.size() < 2 || args[1] != "report") {
+    setError("usage: mem report [file]");
+    return;
+  }
+
+  vector<string> memoryReportArgs = {"memoryReport"};
+  memoryReportArgs.insert(memoryReportArgs.end(), args.begin() + 2, args.end());
+  memoryReport(memoryReportArgs);
+}
+
 }  // namespace vigilante
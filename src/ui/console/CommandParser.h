@@ -10,12 +10,35 @@ namespace vigilante {
 
 class CommandParser {
  public:
+  using Handler = void (CommandParser::*)(const std::vector<std::string>&);
+
+  // A command which has been tokenized and resolved to its handler,
+  // so that it can be executed repeatedly without parsing it again.
+  struct Command final {
+    std::string text;
+    std::vector<std::string> args;  // args[0] is the name of the command
+    CommandParser::Handler handler;  // nullptr if there's no such command
+  };
+
   CommandParser();
   virtual ~CommandParser() = default;
 
+  static CommandParser::Command compile(const std::string& cmd);
+
   void parse(const std::string& cmd, bool showNotification);
+  void execute(const CommandParser::Command& cmd, bool showNotification);
+
+  // Completes the last word of `line` with a command name, or with an asset
+  // (e.g., an item json for addItem) if it's an argument of a command.
+  // If the word is still ambiguous afterwards, up to `maxCandidates`
+  // possible completions are stored in `candidates`.
+  std::string complete(const std::string& line,
+                       std::vector<std::string>* candidates,
+                       size_t maxCandidates) const;
 
  private:
+  static const std::unordered_map<std::string, CommandParser::Handler>& getCommandTable();
+
   void setSuccess();
   void setError(const std::string& errMsg);
 
@@ -30,9 +53,41 @@ class CommandParser {
   void playerPartyMemberFollow(const std::vector<std::string>& args);
   void tradeWithPlayer(const std::vector<std::string>& args);
   void killCurrentTarget(const std::vector<std::string>& args);
+  void dumpProfile(const std::vector<std::string>& args);
+  void dumpLoadProfile(const std::vector<std::string>& args);
+  void memoryReport(const std::vector<std::string>& args);
+  void renderScale(const std::vector<std::string>& args);
+  void batterySaver(const std::vector<std::string>& args);
+  void pickup(const std::vector<std::string>& args);
+  void hotReload(const std::vector<std::string>& args);
+  void lootBag(const std::vector<std::string>& args);
+  void seed(const std::vector<std::string>& args);
+  void replay(const std::vector<std::string>& args);
+  void saveGame(const std::vector<std::string>& args);
+  void loadGame(const std::vector<std::string>& args);
+  void checkpoint(const std::vector<std::string>& args);
+  void benchmark(const std::vector<std::string>& args);
+  void mapBenchmark(const std::vector<std::string>& args);
+  void uiBenchmark(const std::vector<std::string>& args);
+  void renderStress(const std::vector<std::string>& args);
+  void microbench(const std::vector<std::string>& args);
+  void trace(const std::vector<std::string>& args);
+  void hitchBudget(const std::vector<std::string>& args);
+  void frameBudget(const std::vector<std::string>& args);
+  void telemetry(const std::vector<std::string>& args);
+  void coop(const std::vector<std::string>& args);
+  void perf(const std::vector<std::string>& args);
+  void spawn(const std::vector<std::string>& args);
+  void lod(const std::vector<std::string>& args);
+  void physics(const std::vector<std::string>& args);
+  void mem(const std::vector<std::string>& args);
 
   bool _success;
   std::string _errMsg;
+
+  // The commands executed by parse() are compiled only once,
+  // since the scripts tend to run the same commands over and over.
+  std::unordered_map<std::string, CommandParser::Command> _compiledCmds;
 };
 
 }  // namespace vigilante
@@ -2,13 +2,17 @@
 #include "Console.h"
 
 #include "input/InputManager.h"
+#include "ui/UiModuleRegistry.h"
+#include "ui/notifications/Notifications.h"
 #include "util/Logger.h"
 
 #define CONSOLE_X 10
 #define CONSOLE_Y 10
 #define DEFAULT_HISTORY_SIZE 32
+#define MAX_COMPLETION_CANDIDATE_COUNT 5
 
 using std::string;
+using std::vector;
 using cocos2d::Layer;
 using cocos2d::Event;
 using cocos2d::EventKeyboard;
@@ -24,7 +28,8 @@ Console::Console()
     : _layer(Layer::create()),
       _textField(),
       _cmdParser(),
-      _cmdHistory() {
+      _cmdHistory(),
+      _completionCandidates() {
 
   auto onSubmit = [this]() {
     executeCmd(_textField.getString(), 
@@ -44,6 +49,8 @@ Console::Console()
     } else if (keyCode == EventKeyboard::KeyCode::KEY_DOWN_ARROW && _cmdHistory.canGoForward()) {
       _cmdHistory.goForward();
       _textField.setString(_cmdHistory.getCurrentLine());
+    } else if (keyCode == EventKeyboard::KeyCode::KEY_TAB) {
+      autocomplete();
     }
   };
 
@@ -55,6 +62,8 @@ Console::Console()
   _layer->setVisible(false);
   _layer->setPosition(CONSOLE_X, CONSOLE_Y);
   _layer->addChild(_textField.getLayout());
+
+  UiModuleRegistry::getInstance()->onInstantiated(UiModuleRegistry::Module::CONSOLE, _layer);
 }
 
 
@@ -78,6 +87,26 @@ void Console::executeCmd(const string& cmd,
   }
 }
 
+void Console::autocomplete() {
+  _completionCandidates.clear();
+  const string& line = _textField.getString();
+  const string completedLine = _cmdParser.complete(line, &_completionCandidates,
+                                                   MAX_COMPLETION_CANDIDATE_COUNT);
+
+  if (completedLine != line) {
+    _textField.setString(completedLine);
+  } else if (_completionCandidates.size() > 1) {
+    for (const auto& candidate : _completionCandidates) {
+      Notifications::getInstance()->show(candidate);
+    }
+  }
+}
+
+void Console::executeCmd(const CommandParser::Command& cmd) {
+  VGLOG(LOG_INFO, "Executing: %s", cmd.text.c_str());
+  _cmdParser.execute(cmd, /*showNotification=*/false);
+}
+
 
 bool Console::isVisible() const {
   return _layer->isVisible();
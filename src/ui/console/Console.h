@@ -4,6 +4,7 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 
 #include <cocos2d.h>
 #include "ui/TextField.h"
@@ -21,6 +22,8 @@ class Console {
   virtual void executeCmd(const std::string& cmd,
                           bool showNotification=false,
                           bool saveInHistory=false);
+  // Executes a command compiled by CommandParser::compile().
+  virtual void executeCmd(const CommandParser::Command& cmd);
 
   bool isVisible() const;
   void setVisible(bool visible);
@@ -30,6 +33,9 @@ class Console {
  private:
   Console();
 
+  // Completes the command being typed, or lists the possible completions.
+  void autocomplete();
+
   class CommandHistory : public CircularBuffer<std::string> {
    public:
     friend class Console;
@@ -51,6 +57,7 @@ class Console {
   TextField _textField;
   CommandParser _cmdParser;
   CommandHistory _cmdHistory;
+  std::vector<std::string> _completionCandidates;  // reused by autocomplete()
 };
 
 } // namespace vigilante
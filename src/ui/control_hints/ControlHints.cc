@@ -4,16 +4,23 @@
 #include <algorithm>
 #include <cassert>
 
+#include "std/make_unique.h"
 #include "AssetManager.h"
+#include "util/DeferredTaskScheduler.h"
 #include "util/KeyCodeUtil.h"
+#include "util/LabelUtil.h"
 #include "util/Logger.h"
 
 #define CONTROL_HINTS_Y 30
 #define CONTROL_HINTS_RIGHT_PADDING_X 64
 #define CONTROL_HINTS_MAX_ITEMS 3
+#define CONTROL_HINTS_MAX_KEYS 2  // per hint
+#define CONTROL_HINTS_ATLAS_FRAME_PREFIX "control_hints/"
 
 using std::array;
+using std::pair;
 using std::string;
+using std::unordered_map;
 using std::vector;
 using cocos2d::Vec2;
 using cocos2d::Size;
@@ -22,8 +29,10 @@ using cocos2d::Layer;
 using cocos2d::Label;
 using cocos2d::Director;
 using cocos2d::EventKeyboard;
+using cocos2d::SpriteFrameCache;
 using cocos2d::ui::Layout;
 using cocos2d::ui::ImageView;
+using cocos2d::ui::Widget;
 using vigilante::asset_manager::kRegularFont;
 using vigilante::asset_manager::kRegularFontSize;
 using vigilante::asset_manager::kControlHints;
@@ -40,67 +49,48 @@ ControlHints* ControlHints::getInstance() {
 
 ControlHints::ControlHints()
     : _layer(Layer::create()),
+      _hints(),
+      _freeHints(),
       _profiles(),
       _currentProfileStack({ControlHints::Profile::GAME}) {
   _layer->setPositionY(CONTROL_HINTS_Y);
 
-  // Install Control Hints presets.
-  // FIXME: maybe refactor this shit...
-  _profiles[ControlHints::Profile::PAUSE_MENU_INVENTORY] = {
-    {{EventKeyboard::KeyCode::KEY_CAPITAL_Q, EventKeyboard::KeyCode::KEY_CAPITAL_E},
-     "<Page>", colorscheme::kWhite},
-
-    {{EventKeyboard::KeyCode::KEY_LEFT_ARROW, EventKeyboard::KeyCode::KEY_RIGHT_ARROW},
-     "<Tab>", colorscheme::kWhite},
+  // Allocate all of the Hints which may ever be inserted.
+  for (int i = 0; i < CONTROL_HINTS_MAX_ITEMS * ControlHints::Profile::SIZE; i++) {
+    _hints.push_back(std::make_unique<Hint>());
+    _hints.back()->getLayout()->setVisible(false);
+    _layer->addChild(_hints.back()->getLayout());
+    _freeHints.push_back(_hints.back().get());
+  }
 
-    {{EventKeyboard::KeyCode::KEY_ENTER},
-     "Confirm", colorscheme::kWhite},
+  // Install Control Hints presets.
+  const vector<EventKeyboard::KeyCode> pageKeys = {
+    EventKeyboard::KeyCode::KEY_CAPITAL_Q, EventKeyboard::KeyCode::KEY_CAPITAL_E
   };
-
-  _profiles[ControlHints::Profile::PAUSE_MENU_EQUIPMENT] = {
-    {{EventKeyboard::KeyCode::KEY_CAPITAL_Q, EventKeyboard::KeyCode::KEY_CAPITAL_E},
-     "<Page>", colorscheme::kWhite},
-
-    {{EventKeyboard::KeyCode::KEY_ENTER},
-     "Confirm", colorscheme::kWhite},
+  const vector<EventKeyboard::KeyCode> tabKeys = {
+    EventKeyboard::KeyCode::KEY_LEFT_ARROW, EventKeyboard::KeyCode::KEY_RIGHT_ARROW
   };
-
-  _profiles[ControlHints::Profile::PAUSE_MENU_SKILLS] = {
-    {{EventKeyboard::KeyCode::KEY_CAPITAL_Q, EventKeyboard::KeyCode::KEY_CAPITAL_E},
-     "<Page>", colorscheme::kWhite},
-
-    {{EventKeyboard::KeyCode::KEY_LEFT_ARROW, EventKeyboard::KeyCode::KEY_RIGHT_ARROW},
-     "<Tab>", colorscheme::kWhite},
-
-    {{EventKeyboard::KeyCode::KEY_ENTER},
-     "Confirm", colorscheme::kWhite},
+  const vector<EventKeyboard::KeyCode> confirmKeys = {
+    EventKeyboard::KeyCode::KEY_ENTER
   };
 
-  _profiles[ControlHints::Profile::PAUSE_MENU_QUESTS] = {
-    {{EventKeyboard::KeyCode::KEY_CAPITAL_Q, EventKeyboard::KeyCode::KEY_CAPITAL_E},
-     "<Page>", colorscheme::kWhite},
+  insert(ControlHints::Profile::PAUSE_MENU_INVENTORY, pageKeys, "<Page>", colorscheme::kWhite);
+  insert(ControlHints::Profile::PAUSE_MENU_INVENTORY, tabKeys, "<Tab>", colorscheme::kWhite);
+  insert(ControlHints::Profile::PAUSE_MENU_INVENTORY, confirmKeys, "Confirm", colorscheme::kWhite);
 
-    {{EventKeyboard::KeyCode::KEY_LEFT_ARROW, EventKeyboard::KeyCode::KEY_RIGHT_ARROW},
-     "<Tab>", colorscheme::kWhite},
-
-    {{EventKeyboard::KeyCode::KEY_ENTER},
-     "Confirm", colorscheme::kWhite},
-  };
+  insert(ControlHints::Profile::PAUSE_MENU_EQUIPMENT, pageKeys, "<Page>", colorscheme::kWhite);
+  insert(ControlHints::Profile::PAUSE_MENU_EQUIPMENT, confirmKeys, "Confirm", colorscheme::kWhite);
 
-  _profiles[ControlHints::Profile::PAUSE_MENU_OPTIONS] = {
-    {{EventKeyboard::KeyCode::KEY_CAPITAL_Q, EventKeyboard::KeyCode::KEY_CAPITAL_E},
-     "<Page>", colorscheme::kWhite},
+  insert(ControlHints::Profile::PAUSE_MENU_SKILLS, pageKeys, "<Page>", colorscheme::kWhite);
+  insert(ControlHints::Profile::PAUSE_MENU_SKILLS, tabKeys, "<Tab>", colorscheme::kWhite);
+  insert(ControlHints::Profile::PAUSE_MENU_SKILLS, confirmKeys, "Confirm", colorscheme::kWhite);
 
-    {{EventKeyboard::KeyCode::KEY_ENTER},
-     "Confirm", colorscheme::kWhite},
-  };
+  insert(ControlHints::Profile::PAUSE_MENU_QUESTS, pageKeys, "<Page>", colorscheme::kWhite);
+  insert(ControlHints::Profile::PAUSE_MENU_QUESTS, tabKeys, "<Tab>", colorscheme::kWhite);
+  insert(ControlHints::Profile::PAUSE_MENU_QUESTS, confirmKeys, "Confirm", colorscheme::kWhite);
 
-  for (auto profile : _profiles) {
-    for (auto& hint : profile) {
-      hint.getLayout()->setVisible(false);
-      _layer->addChild(hint.getLayout());
-    }
-  }
+  insert(ControlHints::Profile::PAUSE_MENU_OPTIONS, pageKeys, "<Page>", colorscheme::kWhite);
+  insert(ControlHints::Profile::PAUSE_MENU_OPTIONS, confirmKeys, "Confirm", colorscheme::kWhite);
 }
 
 
@@ -131,31 +121,39 @@ bool ControlHints::isShown(const vector<EventKeyboard::KeyCode>& keyCodes) {
 
   return std::find_if(hints.begin(),
                       hints.end(),
-                      [keyCodes](const ControlHints::Hint& hint) {
-                          return keyCodes == hint.getKeyCodes();
+                      [keyCodes](const ControlHints::Hint* hint) {
+                          return keyCodes == hint->getKeyCodes();
                       }) != hints.end();
 }
 
 void ControlHints::insert(const vector<EventKeyboard::KeyCode>& keyCodes,
                           const string& text,
                           const Color4B& textColor) {
-  auto& hints = getCurrentProfileHints();
-
-  if (hints.size() >= CONTROL_HINTS_MAX_ITEMS) {
-    VGLOG(LOG_WARN, "Unable to add more control hints! Currently have %d.",
-          CONTROL_HINTS_MAX_ITEMS);
+  if (isShown(keyCodes)) {
     return;
   }
 
-  if (isShown(keyCodes)) {
+  insert(getCurrentProfile(), keyCodes, text, textColor);
+  requestNormalize();
+}
+
+void ControlHints::insert(ControlHints::Profile profile,
+                          const vector<EventKeyboard::KeyCode>& keyCodes,
+                          const string& text,
+                          const Color4B& textColor) {
+  auto& hints = _profiles.at(profile);
+
+  if (hints.size() >= CONTROL_HINTS_MAX_ITEMS || _freeHints.empty()) {
+    VGLOG(LOG_WARN, "Unable to add more control hints! Currently have %d.",
+          CONTROL_HINTS_MAX_ITEMS);
     return;
   }
 
-  hints.push_back({keyCodes, text, textColor});
-  _layer->addChild(hints.back().getLayout());
-  _layer->setCameraMask(_layer->getCameraMask());
-
-  normalize();
+  Hint* hint = _freeHints.back();
+  _freeHints.pop_back();
+  hint->bind(keyCodes, text, textColor);
+  hint->getLayout()->setVisible(profile == getCurrentProfile());
+  hints.push_back(hint);
 }
 
 void ControlHints::remove(const vector<EventKeyboard::KeyCode>& keyCodes) {
@@ -168,13 +166,26 @@ void ControlHints::remove(const vector<EventKeyboard::KeyCode>& keyCodes) {
 
   hints.erase(std::remove_if(hints.begin(),
                              hints.end(),
-                             [this, keyCodes](const ControlHints::Hint& hint) {
-                                 return keyCodes == hint.getKeyCodes() &&
-                                   (_layer->removeChild(hint.getLayout()), true);
+                             [this, keyCodes](ControlHints::Hint* hint) {
+                                 if (keyCodes != hint->getKeyCodes()) {
+                                   return false;
+                                 }
+                                 hint->getLayout()->setVisible(false);
+                                 _freeHints.push_back(hint);
+                                 return true;
                              }),
                hints.end());
 
-  normalize();
+  requestNormalize();
+}
+
+void ControlHints::requestNormalize() {
+  // Several hints are often inserted or removed in the same frame,
+  // so they're only laid out once, see DeferredTaskScheduler.
+  DeferredTaskScheduler::getInstance()->post([this]() {
+    normalize();
+    return true;
+  }, this);
 }
 
 void ControlHints::normalize() {
@@ -188,28 +199,28 @@ void ControlHints::normalize() {
   float nextX = winSize.width - CONTROL_HINTS_RIGHT_PADDING_X;
 
   for (int i = hints.size() - 1; i >= 0; i--) {
-    nextX -= hints[i].getContentSize().width;
+    nextX -= hints[i]->getContentSize().width;
     nextX -= _kHintGap;
-    hints[i].getLayout()->setPositionX(nextX);
+    hints[i]->getLayout()->setPositionX(nextX);
   }
 }
 
 void ControlHints::showAll() {
-  for (auto& hint : getCurrentProfileHints()) {
-    hint.getLayout()->setVisible(true);
+  for (auto hint : getCurrentProfileHints()) {
+    hint->getLayout()->setVisible(true);
   }
 
-  normalize();
+  requestNormalize();
 }
 
 void ControlHints::hideAll() {
-  for (auto& hint : getCurrentProfileHints()) {
-    hint.getLayout()->setVisible(false);
+  for (auto hint : getCurrentProfileHints()) {
+    hint->getLayout()->setVisible(false);
   }
 }
 
 
-vector<ControlHints::Hint>& ControlHints::getCurrentProfileHints() {
+vector<ControlHints::Hint*>& ControlHints::getCurrentProfileHints() {
   return _profiles.at(_currentProfileStack.top());
 }
 
@@ -227,42 +238,80 @@ Layer* ControlHints::getLayer() const {
 }
 
 
-ControlHints::Hint::Hint(const vector<EventKeyboard::KeyCode>& keyCodes,
-                         const string& text,
-                         const Color4B& textColor)
+ControlHints::Hint::Hint()
     : _layout(Layout::create()),
-      _icons(keyCodes.size()),
-      _label(Label::createWithTTF(text, kRegularFont, kRegularFontSize)),
-      _keyCodes(keyCodes) {
-
-  assert(!keyCodes.empty());
+      _icons(CONTROL_HINTS_MAX_KEYS),
+      _label(label_util::create("", kRegularFont, kRegularFontSize)),
+      _keyCodes() {
   _layout->setLayoutType(Layout::Type::HORIZONTAL);
 
-  for (size_t i = 0; i < keyCodes.size(); i++) {
-    // Example: Texture/ui/control_hints/E.png
-    string iconPath = kControlHints +
-                      keycode_util::keyCodeToString(keyCodes.at(i)) + ".png";
-
-    _icons[i] = ImageView::create(iconPath);
-    _icons[i]->setAnchorPoint({0, 1});
-    _icons[i]->setPositionX(i * _icons[i]->getContentSize().width);
-    _layout->addChild(_icons[i]);
+  for (auto& icon : _icons) {
+    icon = ImageView::create();
+    icon->setAnchorPoint({0, 1});
+    icon->setVisible(false);
+    _layout->addChild(icon);
   }
-  
+
   _label->setAnchorPoint({0, 1});
-  _label->setTextColor(textColor);
-  _label->setPositionX(_icons.size() * _icons.front()->getContentSize().width +
-                       _kIconLabelGap);
   _label->getFontAtlas()->setAliasTexParameters();
   _layout->addChild(_label);
 }
 
+void ControlHints::Hint::bind(const vector<EventKeyboard::KeyCode>& keyCodes,
+                              const string& text,
+                              const Color4B& textColor) {
+  assert(!keyCodes.empty() && keyCodes.size() <= _icons.size());
+  _keyCodes = keyCodes;
+
+  float x = 0;
+  for (size_t i = 0; i < _icons.size(); i++) {
+    if (i >= keyCodes.size()) {
+      _icons[i]->setVisible(false);
+      continue;
+    }
+
+    // ImageView::loadTexture() is a no-op if the texture is unchanged,
+    // so rebinding a Hint to the same keys costs nothing.
+    const auto& iconTexture = getIconTexture(keyCodes[i]);
+    _icons[i]->loadTexture(iconTexture.first, iconTexture.second);
+    _icons[i]->setPositionX(x);
+    _icons[i]->setVisible(true);
+    x += _icons[i]->getContentSize().width;
+  }
+
+  _label->setString(text);
+  label_util::setTextColor(_label, textColor);
+  _label->setPositionX(x + _kIconLabelGap);
+}
+
+const pair<string, Widget::TextureResType>& ControlHints::Hint::getIconTexture(
+    EventKeyboard::KeyCode keyCode) {
+  // <keyCode, {texture, texture type}>
+  static unordered_map<int, pair<string, Widget::TextureResType>> iconTextures;
+
+  auto it = iconTextures.find(static_cast<int>(keyCode));
+  if (it != iconTextures.end()) {
+    return it->second;
+  }
+
+  // If the icons have been packed into an atlas (see scripts/AtlasPacker.py)
+  // which is listed in spritesheets.txt, then all of them share one texture.
+  // Otherwise, fall back to the individual files,
+  // e.g., Texture/ui/control_hints/E.png
+  const string keyName = keycode_util::keyCodeToString(keyCode);
+  const string frameName = CONTROL_HINTS_ATLAS_FRAME_PREFIX + keyName + ".png";
+  auto texture = (SpriteFrameCache::getInstance()->getSpriteFrameByName(frameName))
+      ? std::make_pair(frameName, Widget::TextureResType::PLIST)
+      : std::make_pair(kControlHints + keyName + ".png", Widget::TextureResType::LOCAL);
+  return iconTextures.emplace(static_cast<int>(keyCode), std::move(texture)).first->second;
+}
+
 
 Size ControlHints::Hint::getContentSize() const {
   Size ret(0, 0);
 
-  for (auto icon : _icons) {
-    const Size& iconSize = icon->getContentSize();
+  for (size_t i = 0; i < _keyCodes.size(); i++) {
+    const Size& iconSize = _icons[i]->getContentSize();
     ret.width += iconSize.width;
     ret.height = std::max(ret.height, iconSize.height);
   }
@@ -3,8 +3,10 @@
 #define VIGILANTE_CONTROL_HINTS_H_
 
 #include <array>
+#include <memory>
 #include <stack>
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
@@ -21,6 +23,10 @@ namespace vigilante {
 //
 // Each profile may contains up to 3 ControlHints::Hint,
 // where a ControlHints::Hint consists of an icon and a label.
+//
+// The Hints are allocated up front and recycled, so inserting / removing
+// a hint (e.g., when walking past an interactable) only rebinds an existing
+// Hint and toggles its visibility.
 
 class ControlHints {
  public:
@@ -55,33 +61,45 @@ class ControlHints {
  private:
   class Hint final {
    public:
-    Hint(const std::vector<cocos2d::EventKeyboard::KeyCode>& keyCodes,
-         const std::string& text,
-         const cocos2d::Color4B& textColor);
+    Hint();
+
+    void bind(const std::vector<cocos2d::EventKeyboard::KeyCode>& keyCodes,
+              const std::string& text,
+              const cocos2d::Color4B& textColor);
 
     cocos2d::Size getContentSize() const;
     cocos2d::ui::Layout* getLayout() const;
     const std::vector<cocos2d::EventKeyboard::KeyCode>& getKeyCodes() const;
 
    private:
+    static const std::pair<std::string, cocos2d::ui::Widget::TextureResType>& getIconTexture(
+        cocos2d::EventKeyboard::KeyCode keyCode);
+
     static const int _kIconLabelGap;
 
     cocos2d::ui::Layout* _layout;
-    std::vector<cocos2d::ui::ImageView*> _icons;
+    std::vector<cocos2d::ui::ImageView*> _icons;  // some of them may be unused
     cocos2d::Label* _label;
     std::vector<cocos2d::EventKeyboard::KeyCode> _keyCodes;
   };
 
   ControlHints();
+  void insert(ControlHints::Profile profile,
+              const std::vector<cocos2d::EventKeyboard::KeyCode>& keyCodes,
+              const std::string& text,
+              const cocos2d::Color4B& textColor);
+  void requestNormalize();
   void normalize();
   void showAll();
   void hideAll();
-  std::vector<ControlHints::Hint>& getCurrentProfileHints();
+  std::vector<ControlHints::Hint*>& getCurrentProfileHints();
 
   static const int _kHintGap;
 
   cocos2d::Layer* _layer;
-  std::array<std::vector<ControlHints::Hint>, ControlHints::Profile::SIZE> _profiles;
+  std::vector<std::unique_ptr<ControlHints::Hint>> _hints;
+  std::vector<ControlHints::Hint*> _freeHints;
+  std::array<std::vector<ControlHints::Hint*>, ControlHints::Profile::SIZE> _profiles;
   std::stack<ControlHints::Profile> _currentProfileStack;  
 };
 
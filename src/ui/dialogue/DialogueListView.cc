@@ -4,7 +4,7 @@
 #include "AssetManager.h"
 #include "Constants.h"
 #include "gameplay/DialogueTree.h"
-#include "ui/console/Console.h"
+#include "gameplay/ScriptRunner.h"
 #include "ui/dialogue/DialogueManager.h"
 #include "ui/dialogue/DialogueListView.h"
 
@@ -15,6 +15,7 @@
 #define REGULAR_BG vigilante::asset_manager::kEmptyImage
 #define HIGHLIGHTED_BG vigilante::asset_manager::kEmptyImage
 
+using std::vector;
 using cocos2d::Director;
 
 namespace vigilante {
@@ -29,7 +30,7 @@ DialogueListView::DialogueListView(DialogueMenu* dialogMenu)
   };
 
   _setObjectCallback = [](ListView::ListViewItem* listViewItem, Dialogue* dialogue) {
-    listViewItem->getLabel()->setString(dialogue->getLines().front());
+    listViewItem->getLabel()->setString(dialogue->getLines().front().getText());
   };
 }
 
@@ -39,23 +40,23 @@ void DialogueListView::confirm() {
   auto dialogueMenu = dialogueMgr->getDialogueMenu();
   auto subtitles = dialogueMgr->getSubtitles();
 
-  for (const auto& cmd : getSelectedObject()->getCmds()) {
-    Console::getInstance()->executeCmd(cmd);
-  }
+  DialogueTree& dialogueTree = dialogueMgr->getTargetNpc()->getDialogueTree();
+  ScriptRunner::getInstance()->run(getSelectedObject()->getScript());
 
-  if (getSelectedObject()->getChildren().empty()) {
+  const vector<Dialogue*>& children = dialogueTree.getChildren(getSelectedObject());
+  if (children.empty()) {
     subtitles->endSubtitles();
-    dialogueMgr->getTargetNpc()->getDialogueTree().resetCurrentNode();
+    dialogueTree.resetCurrentNode();
   } else {
-    Dialogue* nextDialogue = getSelectedObject()->getChildren().front();
+    Dialogue* nextDialogue = children.front();
     for (const auto& line : nextDialogue->getLines()) {
-      subtitles->addSubtitle(line);
+      subtitles->addSubtitle(line.getText());
     }
     subtitles->showNextSubtitle();
     dialogueMgr->setCurrentDialogue(nextDialogue);
   }
 
-  dialogueMgr->getTargetNpc()->getDialogueTree().update();
+  dialogueTree.update();
   dialogueMenu->getLayer()->setVisible(false);
 }
 
@@ -2,6 +2,7 @@
 #include "DialogueManager.h"
 
 #include "std/make_unique.h"
+#include "ui/UiModuleRegistry.h"
 
 using std::unique_ptr;
 using cocos2d::Layer;
@@ -19,6 +20,8 @@ DialogueManager::DialogueManager()
       _dialogueMenu(std::make_unique<DialogueMenu>()) {
   _layer->addChild(_subtitles->getLayer());
   _layer->addChild(_dialogueMenu->getLayer());
+
+  UiModuleRegistry::getInstance()->onInstantiated(UiModuleRegistry::Module::DIALOGUE_MANAGER, _layer);
 }
 
 
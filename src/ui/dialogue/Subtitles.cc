@@ -4,11 +4,12 @@
 #include <vector>
 
 #include "AssetManager.h"
+#include "gameplay/ScriptRunner.h"
 #include "input/InputManager.h"
-#include "ui/console/Console.h"
 #include "ui/dialogue/DialogueManager.h"
 #include "ui/hud/Hud.h"
 #include "util/ds/Algorithm.h"
+#include "util/LabelUtil.h"
 
 #define SHOW_CHAR_INTERVAL .03f
 #define LETTERBOX_HEIGHT 50
@@ -35,11 +36,13 @@ namespace vigilante {
 
 Subtitles::Subtitles()
     : _layer(Layer::create()),
-      _label(Label::createWithTTF("", kRegularFont, kRegularFontSize)),
+      _label(label_util::create("", kRegularFont, kRegularFontSize)),
       _nextSubtitleIcon(ImageView::create(kDialogueTriangle)),
       _upperLetterbox(ImageView::create(kShade)),
       _lowerLetterbox(ImageView::create(kShade)),
       _currentSubtitle(""),
+      _numChars(),
+      _numRevealedChars(),
       _isTransitioning(),
       _timer() {
   auto winSize = Director::getInstance()->getWinSize();
@@ -67,16 +70,15 @@ Subtitles::Subtitles()
 
 
 void Subtitles::update(float delta) {
-  if (!_layer->isVisible() || _label->getString().size()  == _currentSubtitle.text.size()) {
+  if (!_layer->isVisible() || _numRevealedChars == _numChars) {
     return;
   }
 
   if (_timer >= SHOW_CHAR_INTERVAL) {
-    int nextCharIdx = _label->getString().size();
-    _label->setString(_label->getString() + _currentSubtitle.text.at(nextCharIdx));
+    setLetterVisible(_numRevealedChars++, true);
     _timer = 0;
   }
-  if (_label->getString().size() == _currentSubtitle.text.size()) {
+  if (_numRevealedChars == _numChars) {
     float x = _label->getPositionX() + _label->getContentSize().width / 2;
     float y = _label->getPositionY();
     _nextSubtitleIcon->setPosition({x + 25, y});
@@ -136,13 +138,22 @@ void Subtitles::showNextSubtitle() {
   if (!_subtitleQueue.empty()) {
     _currentSubtitle = _subtitleQueue.front();
     _subtitleQueue.pop();
-    _label->setString("");
+
+    // Lay out the whole line once, and then hide all of its letters.
+    _label->setString(_currentSubtitle.text);
+    _numChars = _label->getStringLength();
+    _numRevealedChars = 0;
+    for (int i = 0; i < _numChars; i++) {
+      setLetterVisible(i, false);
+    }
     _timer = 0;
     return;
   }
 
   _currentSubtitle.text.clear();
   _label->setString("");
+  _numChars = 0;
+  _numRevealedChars = 0;
 
   // If all subtitles has been displayed, show DialogueMenu if possible.
   DialogueManager* dialogueMgr = DialogueManager::getInstance();
@@ -150,14 +161,13 @@ void Subtitles::showNextSubtitle() {
   DialogueListView* dialogueListView = dialogueMenu->getDialogueListView();
   Dialogue* currentDialogue = dialogueMgr->getCurrentDialogue();
 
-  for (const auto& cmd : currentDialogue->getCmds()) {
-    Console::getInstance()->executeCmd(cmd);
-  }
+  ScriptRunner::getInstance()->run(currentDialogue->getScript());
 
-  vector<DialogueTree::Node*> children = currentDialogue->getChildren();
+  DialogueTree& dialogueTree = dialogueMgr->getTargetNpc()->getDialogueTree();
+  const vector<DialogueTree::Node*>& children = dialogueTree.getChildren(currentDialogue);
   if (children.empty()) {  // end of dialogue
     endSubtitles();
-    dialogueMgr->getTargetNpc()->getDialogueTree().resetCurrentNode();
+    dialogueTree.resetCurrentNode();
   } else {  // still has children dialogue
     dialogueListView->setObjects<vector>(children);
     dialogueListView->updatePosition();
@@ -170,6 +180,13 @@ Layer* Subtitles::getLayer() const {
   return _layer;
 }
 
+void Subtitles::setLetterVisible(int index, bool visible) {
+  // Whitespaces don't have letter sprites.
+  if (cocos2d::Sprite* letter = _label->getLetter(index)) {
+    letter->setVisible(visible);
+  }
+}
+
 
 Subtitles::Subtitle::Subtitle(const string& text) : text(text) {}
 
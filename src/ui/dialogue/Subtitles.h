@@ -28,6 +28,8 @@ class Subtitles : public Controllable {
   cocos2d::Layer* getLayer() const;
 
  private:
+  void setLetterVisible(int index, bool visible);
+
   struct Subtitle {
     explicit Subtitle(const std::string& text);
     std::string text;
@@ -41,6 +43,12 @@ class Subtitles : public Controllable {
 
   std::queue<Subtitles::Subtitle> _subtitleQueue;
   Subtitles::Subtitle _currentSubtitle;
+
+  // The whole line is laid out at once, and its letters are revealed
+  // one by one (see Subtitles::update()).
+  int _numChars;
+  int _numRevealedChars;
+
   bool _isTransitioning;
   float _timer;
 };
@@ -1,22 +1,23 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "FloatingDamages.h"
 
+#include <algorithm>
+#include <string>
+
 #include "AssetManager.h"
 #include "Constants.h"
 #include "character/Character.h"
 #include "character/Player.h"
 #include "character/Npc.h"
 #include "ui/Colorscheme.h"
+#include "util/LabelUtil.h"
+
+#define MAX_DAMAGE_LABELS 64
 
-using std::map;
-using std::deque;
 using std::string;
+using std::vector;
 using cocos2d::Layer;
 using cocos2d::Label;
-using cocos2d::MoveBy;
-using cocos2d::FadeOut;
-using cocos2d::CallFunc;
-using cocos2d::Sequence;
 using vigilante::kPpm;
 using vigilante::asset_manager::kRegularFont;
 using vigilante::asset_manager::kRegularFontSize;
@@ -28,74 +29,84 @@ const float FloatingDamages::kDeltaY = 10.0f;
 
 const float FloatingDamages::kMoveUpDuration = .2f;
 const float FloatingDamages::kFadeDuration = .2f;
+const float FloatingDamages::kLifetime = 1.5f;
 
 FloatingDamages* FloatingDamages::getInstance() {
   static FloatingDamages instance;
   return &instance;
 }
 
-FloatingDamages::FloatingDamages() : _layer(Layer::create()) {}
+FloatingDamages::FloatingDamages()
+    : _layer(Layer::create()),
+      _labels(MAX_DAMAGE_LABELS),
+      _freeLabels() {
+  _freeLabels.reserve(MAX_DAMAGE_LABELS);
+
+  // The labels stay in _layer (which retains them) throughout
+  // the game, and they're only hidden while they're not in use.
+  for (size_t i = 0; i < _labels.size(); i++) {
+    DamageLabel& dmg = _labels[i];
+    dmg.label = label_util::create("0", kRegularFont, kRegularFontSize);
+    dmg.label->setVisible(false);
+    _layer->addChild(dmg.label);
+    releaseLabel(i);
+  }
+}
 
 
 void FloatingDamages::update(float delta) {
-  deque<map<Character*, deque<DamageLabel>>::iterator> trash;
-
-  auto it = _damageMap.begin();
-  for (auto& characterDmgs : _damageMap) { // map<Character*, deque<FloatingDamage>>
-    for (auto& dmg : characterDmgs.second) { // FloatingDamage
-      dmg.timer += delta;
-
-      if (dmg.timer >= dmg.lifetime) {
-        dmg.label->runAction(Sequence::createWithTwoActions(
-          FadeOut::create(kFadeDuration),
-          CallFunc::create([=]() {
-            // After the label fully fades out, remove the label from _layer.
-            _layer->removeChild(dmg.label);
-          })
-        ));
-        // Also remove the FloatingDamage object from _damageMap.
-        auto& q = _damageMap[characterDmgs.first];
-        q.erase(std::remove(q.begin(), q.end(), dmg), q.end());
-
-        if (q.empty()) {
-          trash.push_back(it);
-        }
-      }
+  const float moveUpSpeed = kDeltaY / kMoveUpDuration;
+
+  for (size_t i = 0; i < _labels.size(); i++) {
+    DamageLabel& dmg = _labels[i];
+    if (!dmg.isActive) {
+      continue;
     }
-    it++;
-  }
 
-  // Clean up unsued deques in _damageMap.
-  for (auto it : trash) {
-    _damageMap.erase(it);
+    dmg.timer += delta;
+    if (dmg.timer >= kLifetime + kFadeDuration) {
+      releaseLabel(i);
+      continue;
+    }
+
+    if (dmg.offsetY < dmg.targetOffsetY) {
+      dmg.offsetY = std::min(dmg.offsetY + moveUpSpeed * delta, dmg.targetOffsetY);
+    }
+    dmg.label->setPosition(dmg.x + kDeltaX * dmg.offsetY / kDeltaY, dmg.y + dmg.offsetY);
+
+    if (dmg.timer >= kLifetime) {
+      const float alpha = 1.0f - (dmg.timer - kLifetime) / kFadeDuration;
+      dmg.label->setOpacity(static_cast<uint8_t>(alpha * 0xff));
+    }
   }
 }
 
 void FloatingDamages::show(Character* character, int damage) {
-  // If _damageMap does not have a deque of FloatingDamage objects for this character,
-  // then initialize it.
-  if (_damageMap.find(character) == _damageMap.end()) {
-    _damageMap[character] = {};
-  }
-
   // Move up the previous floating damage labels owned by this character.
-  for (auto& floatingDamage : _damageMap[character]) {
-    floatingDamage.label->runAction(MoveBy::create(kMoveUpDuration, {kDeltaX, kDeltaY}));
+  for (auto& dmg : _labels) {
+    if (dmg.isActive && dmg.owner == character) {
+      dmg.targetOffsetY += kDeltaY;
+    }
   }
 
   // Display the new floating damage label.
-  DamageLabel dmg(std::to_string(damage), 1.5f);
-  if (dynamic_cast<Player*>(character) || dynamic_cast<Npc*>(character)->isInPlayerParty()) {
-    dmg.label->setTextColor(colorscheme::kRed);
-  }
+  DamageLabel& dmg = _labels[acquireLabel()];
+  const bool isFriendly = dynamic_cast<Player*>(character) ||
+                          dynamic_cast<Npc*>(character)->isInPlayerParty();
   const auto& characterPos = character->getBody()->GetPosition();
-  float x = characterPos.x * kPpm;
-  float y = characterPos.y * kPpm + 15;
-  dmg.label->setPosition(x, y);
-  dmg.label->runAction(MoveBy::create(kMoveUpDuration, {kDeltaX, kDeltaY}));
 
-  _damageMap[character].push_back(dmg);
-  _layer->addChild(dmg.label);
+  dmg.owner = character;
+  dmg.x = characterPos.x * kPpm;
+  dmg.y = characterPos.y * kPpm + 15;
+  dmg.offsetY = 0;
+  dmg.targetOffsetY = kDeltaY;
+  dmg.timer = 0;
+  dmg.isActive = true;
+  dmg.label->setString(std::to_string(damage));
+  label_util::setTextColor(dmg.label, (isFriendly) ? colorscheme::kRed : colorscheme::kWhite);
+  dmg.label->setOpacity(0xff);
+  dmg.label->setPosition(dmg.x, dmg.y);
+  dmg.label->setVisible(true);
 }
 
 Layer* FloatingDamages::getLayer() const {
@@ -103,15 +114,31 @@ Layer* FloatingDamages::getLayer() const {
 }
 
 
-FloatingDamages::DamageLabel::DamageLabel(const string& text, float lifetime)
-    : label(Label::createWithTTF(text, kRegularFont, kRegularFontSize)),
-      lifetime(lifetime),
-      timer() {
-  label->getFontAtlas()->setAliasTexParameters();
+size_t FloatingDamages::acquireLabel() {
+  if (!_freeLabels.empty()) {
+    const size_t index = _freeLabels.back();
+    _freeLabels.pop_back();
+    return index;
+  }
+
+  // All labels are in use, so recycle the one which
+  // will disappear the soonest.
+  size_t oldestIndex = 0;
+  for (size_t i = 1; i < _labels.size(); i++) {
+    if (_labels[i].timer > _labels[oldestIndex].timer) {
+      oldestIndex = i;
+    }
+  }
+  return oldestIndex;
 }
 
-bool FloatingDamages::DamageLabel::operator==(const DamageLabel& other) {
-  return this->label == other.label;
+void FloatingDamages::releaseLabel(size_t index) {
+  DamageLabel& dmg = _labels[index];
+  dmg.owner = nullptr;
+  dmg.timer = 0;
+  dmg.isActive = false;
+  dmg.label->setVisible(false);
+  _freeLabels.push_back(index);
 }
 
 }  // namespace vigilante
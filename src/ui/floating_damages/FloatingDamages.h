@@ -2,9 +2,7 @@
 #ifndef VIGILANTE_FLOATING_DAMAGES_H_
 #define VIGILANTE_FLOATING_DAMAGES_H_
 
-#include <map>
-#include <deque>
-#include <string>
+#include <vector>
 
 #include <cocos2d.h>
 
@@ -12,6 +10,9 @@ namespace vigilante {
 
 class Character;
 
+// The damage labels are allocated up front and recycled, and all of them
+// are animated (moved up and faded out) in a single pass in update(),
+// instead of running a few cocos2d::Actions per label.
 class FloatingDamages {
  public:
   static FloatingDamages* getInstance();
@@ -22,24 +23,34 @@ class FloatingDamages {
   cocos2d::Layer* getLayer() const;
 
  private:
-  struct DamageLabel {
-    DamageLabel(const std::string& text, float lifetime);
-    bool operator==(const DamageLabel& other);
+  struct DamageLabel final {
     cocos2d::Label* label;
-    float lifetime;
+    const Character* owner;  // only compared against, never dereferenced
+    float x;
+    float y;
+    float offsetY;
+    float targetOffsetY;
     float timer;
+    bool isActive;
   };
 
   FloatingDamages();
 
+  // Returns the index of an inactive label, or of the oldest
+  // active label if all of them are in use.
+  size_t acquireLabel();
+  void releaseLabel(size_t index);
+
   static const float kDeltaX;
   static const float kDeltaY;
 
   static const float kMoveUpDuration;
   static const float kFadeDuration;
+  static const float kLifetime;
 
   cocos2d::Layer* _layer;
-  std::map<Character*, std::deque<FloatingDamages::DamageLabel>> _damageMap;
+  std::vector<FloatingDamages::DamageLabel> _labels;
+  std::vector<size_t> _freeLabels;
 };
 
 }  // namespace vigilante
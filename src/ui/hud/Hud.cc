@@ -1,30 +1,22 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "Hud.h"
 
-#include "std/make_unique.h"
 #include "AssetManager.h"
 #include "Constants.h"
+#include "EventBus.h"
 #include "character/Player.h"
 #include "item/Equipment.h"
 #include "map/GameMapManager.h"
+#include "util/LabelUtil.h"
 
 #define HUD_X 75
 #define HUD_Y cocos2d::Director::getInstance()->getWinSize().height - 40
 
 using std::string;
-using std::unique_ptr;
 using cocos2d::Layer;
 using cocos2d::Label;
-using cocos2d::ui::ImageView;
 using vigilante::asset_manager::kRegularFont;
 using vigilante::asset_manager::kRegularFontSize;
-using vigilante::asset_manager::kBarLeftPadding;
-using vigilante::asset_manager::kBarRightPadding;
-using vigilante::asset_manager::kHealthBar;
-using vigilante::asset_manager::kMagickaBar;
-using vigilante::asset_manager::kStaminaBar;
-using vigilante::asset_manager::kEquippedWeaponBg;
-using vigilante::asset_manager::kEquippedWeaponDescBg;
 
 namespace vigilante {
 
@@ -37,31 +29,27 @@ Hud* Hud::getInstance() {
 
 Hud::Hud()
     : _layer(Layer::create()),
-      _healthBar(std::make_unique<StatusBar>(kBarLeftPadding, kBarRightPadding, kHealthBar, _kBarLength)),
-      _magickaBar(std::make_unique<StatusBar>(kBarLeftPadding, kBarRightPadding, kMagickaBar, _kBarLength)),
-      _staminaBar(std::make_unique<StatusBar>(kBarLeftPadding, kBarRightPadding, kStaminaBar, _kBarLength)),
-      _equippedWeaponBg(ImageView::create(kEquippedWeaponBg)),
-      _equippedWeapon(ImageView::create()),
-      _equippedWeaponDescBg(ImageView::create(kEquippedWeaponDescBg)),
-      _equippedWeaponDesc(Label::createWithTTF("", kRegularFont, kRegularFontSize)) {
-  _equippedWeaponBg->setPosition({-20, -15});
-  _equippedWeaponDescBg->setPosition({33, -25});
-
+      _mesh(HudMesh::create(_kBarLength)),
+      _equippedWeaponDesc(label_util::create("", kRegularFont, kRegularFontSize)) {
   _equippedWeaponDesc->getFontAtlas()->setAliasTexParameters();
   _equippedWeaponDesc->setAnchorPoint({0, 0});
   _equippedWeaponDesc->setPosition({5.0f, -30.f});
 
-  _magickaBar->getLayout()->setPositionY(_magickaBar->getLayout()->getPositionY() - 6.0f);
-  _staminaBar->getLayout()->setPositionY(_staminaBar->getLayout()->getPositionY() - 12.0f);
-
   _layer->setPosition(HUD_X, HUD_Y);
-  _layer->addChild(_equippedWeaponBg);
-  _layer->addChild(_equippedWeapon);
-  _layer->addChild(_healthBar->getLayout());
-  _layer->addChild(_magickaBar->getLayout());
-  _layer->addChild(_staminaBar->getLayout());
-  _layer->addChild(_equippedWeaponDescBg);
+  _layer->addChild(_mesh);
   _layer->addChild(_equippedWeaponDesc);
+
+  // Only the player's stats and equipment are shown by the Hud.
+  EventBus::getInstance()->subscribe<StatChangedEvent>([this](const StatChangedEvent& e) {
+    if (e.character == GameMapManager::getInstance()->getPlayer()) {
+      updateStatusBars();
+    }
+  });
+  EventBus::getInstance()->subscribe<ItemChangedEvent>([this](const ItemChangedEvent& e) {
+    if (e.character == GameMapManager::getInstance()->getPlayer()) {
+      updateEquippedWeapon();
+    }
+  });
 }
 
 
@@ -69,24 +57,25 @@ void Hud::updateEquippedWeapon() {
   Equipment* weapon = GameMapManager::getInstance()->getPlayer()->getEquipmentSlots()[Equipment::Type::WEAPON];
 
   if (weapon) {
-    // Replace weapon icon
-    _equippedWeapon->loadTexture(weapon->getIconPath());
-    _equippedWeapon->setPosition(_equippedWeaponBg->getPosition());
-    _equippedWeapon->setScale(1.5);
-    // Update weapon desc label
+    _mesh->setWeaponIcon(weapon->getIconPath());
     _equippedWeaponDesc->setString(weapon->getItemProfile().name);
   } else {
-    _equippedWeapon->loadTexture(asset_manager::kEmptyImage);
+    _mesh->setWeaponIcon("");
     _equippedWeaponDesc->setString("");
   }
 }
 
 void Hud::updateStatusBars() {
-  Character::Profile& profile = GameMapManager::getInstance()->getPlayer()->getCharacterProfile();
+  Player* player = GameMapManager::getInstance()->getPlayer();
+  const Character::Profile& profile = player->getCharacterProfile();
+
+  _mesh->setBarValue(HudMesh::Bar::HEALTH, player->getStat(StatsSystem::Stat::HEALTH), profile.fullHealth);
+  _mesh->setBarValue(HudMesh::Bar::MAGICKA, player->getStat(StatsSystem::Stat::MAGICKA), profile.fullMagicka);
+  _mesh->setBarValue(HudMesh::Bar::STAMINA, player->getStat(StatsSystem::Stat::STAMINA), profile.fullStamina);
+}
 
-  _healthBar->update(profile.health, profile.fullHealth);
-  _magickaBar->update(profile.magicka, profile.fullMagicka);
-  _staminaBar->update(profile.stamina, profile.fullStamina);
+void Hud::update(float delta) {
+  _mesh->step(delta);
 }
 
 
@@ -3,15 +3,16 @@
 #define VIGILANTE_HUD_H_
 
 #include <string>
-#include <memory>
 
 #include <cocos2d.h>
 #include <2d/CCLabel.h>
-#include <ui/UIImageView.h>
-#include "StatusBar.h"
+#include "HudMesh.h"
 
 namespace vigilante {
 
+// The Hud is updated by the StatChangedEvent and ItemChangedEvent
+// of the player (see EventBus). Everything but the weapon's name
+// is drawn by a single HudMesh.
 class Hud {
  public:
   static Hud* getInstance();
@@ -20,6 +21,9 @@ class Hud {
   void updateEquippedWeapon();
   void updateStatusBars();
 
+  // Animates the status bars, see HudMesh.
+  void update(float delta);
+
   cocos2d::Layer* getLayer() const;
 
  private:
@@ -28,12 +32,7 @@ class Hud {
   static const float _kBarLength;
 
   cocos2d::Layer* _layer;
-  std::unique_ptr<StatusBar> _healthBar;
-  std::unique_ptr<StatusBar> _magickaBar;
-  std::unique_ptr<StatusBar> _staminaBar;
-  cocos2d::ui::ImageView* _equippedWeaponBg;
-  cocos2d::ui::ImageView* _equippedWeapon;
-  cocos2d::ui::ImageView* _equippedWeaponDescBg;
+  HudMesh* _mesh;
   cocos2d::Label* _equippedWeaponDesc;
 };
 
@@ -0,0 +1,339 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "HudMesh.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "AssetManager.h"
+#include "util/Logger.h"
+#include "util/ThreadPool.h"
+
+#define HUD_ICON_CELL_SIZE 32  // in pixels, the largest weapon icon which can be shown
+#define HUD_BAR_CATCH_UP_SPEED .5f  // of a full bar per second
+#define HUD_BAR_TRAIL_OPACITY 128
+
+using std::array;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using cocos2d::BlendFunc;
+using cocos2d::Color4B;
+using cocos2d::FileUtils;
+using cocos2d::GLProgram;
+using cocos2d::GLProgramState;
+using cocos2d::Image;
+using cocos2d::Mat4;
+using cocos2d::Rect;
+using cocos2d::Renderer;
+using cocos2d::Size;
+using cocos2d::Texture2D;
+using cocos2d::V3F_C4B_T2F_Quad;
+
+namespace vigilante {
+
+namespace {
+
+struct Pixels final {
+  vector<uint8_t> rgba;  // premultiplied
+  int width;
+  int height;
+};
+
+// Converts the decoded `image` into premultiplied RGBA8888.
+bool readPixels(const Image& image, Pixels& pixels) {
+  pixels.width = image.getWidth();
+  pixels.height = image.getHeight();
+  const size_t numPixels = static_cast<size_t>(pixels.width) * pixels.height;
+  const unsigned char* data = image.getData();
+
+  switch (image.getRenderFormat()) {
+    case Texture2D::PixelFormat::RGBA8888:
+      pixels.rgba.assign(data, data + numPixels * 4);
+      if (!image.hasPremultipliedAlpha()) {
+        for (size_t i = 0; i < numPixels; i++) {
+          uint8_t* pixel = &pixels.rgba[i * 4];
+          for (int c = 0; c < 3; c++) {
+            pixel[c] = static_cast<uint8_t>(pixel[c] * pixel[3] / 255);
+          }
+        }
+      }
+      return true;
+
+    case Texture2D::PixelFormat::RGB888:
+      pixels.rgba.resize(numPixels * 4);
+      for (size_t i = 0; i < numPixels; i++) {
+        std::copy(data + i * 3, data + i * 3 + 3, &pixels.rgba[i * 4]);
+        pixels.rgba[i * 4 + 3] = 255;
+      }
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool readPixels(const string& fileName, Pixels& pixels) {
+  Image image;
+  if (!image.initWithImageFile(fileName) || !readPixels(image, pixels)) {
+    VGLOG(LOG_ERR, "Unable to read the pixels of [%s]", fileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+HudMesh* HudMesh::create(float barLength) {
+  HudMesh* mesh = new (std::nothrow) HudMesh(barLength);
+  if (mesh && mesh->init()) {
+    mesh->autorelease();
+    return mesh;
+  }
+  CC_SAFE_DELETE(mesh);
+  return nullptr;
+}
+
+HudMesh::HudMesh(float barLength)
+    : _barLength(barLength),
+      _texture(),
+      _pieceRects(),
+      _bars(),
+      _quads(),
+      _quadCommand(),
+      _weaponIconRevision() {
+  _bars.fill({/*value=*/-1.0f, /*fill=*/-1.0f, /*trail=*/-1.0f, /*isAnimating=*/false});
+}
+
+HudMesh::~HudMesh() {
+  CC_SAFE_RELEASE(_texture);
+}
+
+bool HudMesh::init() {
+  if (!Node::init()) {
+    return false;
+  }
+
+  // If the texture can't be created, nothing is drawn
+  // rather than taking the whole GameScene down.
+  if (!createTexture()) {
+    return true;
+  }
+  setGLProgramState(GLProgramState::getOrCreateWithGLProgramName(
+      GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP, _texture));
+
+  const Rect& slotRect = _pieceRects[Piece::WEAPON_SLOT];
+  setQuad(Quad::WEAPON_SLOT_QUAD, Piece::WEAPON_SLOT,
+          -20 - slotRect.size.width / 2, -15 - slotRect.size.height / 2,
+          slotRect.size.width, slotRect.size.height);
+  setQuad(Quad::WEAPON_ICON_QUAD, Piece::WEAPON_ICON, 0, 0, 0, 0);
+
+  const Rect& descBgRect = _pieceRects[Piece::WEAPON_DESC_BG];
+  setQuad(Quad::WEAPON_DESC_BG_QUAD, Piece::WEAPON_DESC_BG,
+          33 - descBgRect.size.width / 2, -25 - descBgRect.size.height / 2,
+          descBgRect.size.width, descBgRect.size.height);
+
+  for (int i = 0; i < Bar::SIZE; i++) {
+    updateBarQuads(static_cast<Bar>(i));
+  }
+  return true;
+}
+
+bool HudMesh::createTexture() {
+  const array<const char*, Piece::WEAPON_ICON> fileNames = {{
+    asset_manager::kBarLeftPadding,
+    asset_manager::kBarRightPadding,
+    asset_manager::kHealthBar,
+    asset_manager::kMagickaBar,
+    asset_manager::kStaminaBar,
+    asset_manager::kEquippedWeaponBg,
+    asset_manager::kEquippedWeaponDescBg
+  }};
+
+  // The pieces are packed side by side, with a transparent
+  // column between each of them so that they won't bleed.
+  array<Pixels, Piece::WEAPON_ICON> pieces;
+  int width = HUD_ICON_CELL_SIZE;
+  int height = HUD_ICON_CELL_SIZE;
+  for (size_t i = 0; i < fileNames.size(); i++) {
+    if (!readPixels(fileNames[i], pieces[i])) {
+      return false;
+    }
+    _pieceRects[i].setRect(width + 1, 0, pieces[i].width, pieces[i].height);
+    width += pieces[i].width + 1;
+    height = std::max(height, pieces[i].height);
+  }
+  _pieceRects[Piece::WEAPON_ICON].setRect(0, 0, 0, 0);
+
+  vector<uint8_t> atlas(static_cast<size_t>(width) * height * 4);
+  for (size_t i = 0; i < pieces.size(); i++) {
+    const int x = static_cast<int>(_pieceRects[i].origin.x);
+    for (int row = 0; row < pieces[i].height; row++) {
+      std::copy_n(&pieces[i].rgba[static_cast<size_t>(row) * pieces[i].width * 4],
+                  pieces[i].width * 4,
+                  &atlas[(static_cast<size_t>(row) * width + x) * 4]);
+    }
+  }
+
+  Image image;
+  if (!image.initWithRawData(atlas.data(), atlas.size(), width, height, 8, /*preMulti=*/true)) {
+    return false;
+  }
+  _texture = new (std::nothrow) Texture2D();
+  if (!_texture || !_texture->initWithImage(&image)) {
+    VGLOG(LOG_ERR, "Unable to create the texture of the Hud");
+    CC_SAFE_RELEASE_NULL(_texture);
+    return false;
+  }
+  _texture->setAliasTexParameters();
+  return true;
+}
+
+
+void HudMesh::setBarValue(HudMesh::Bar bar, int currentVal, int fullVal) {
+  const float value = (fullVal > 0) ? std::min(std::max(static_cast<float>(currentVal) / fullVal, 0.0f), 1.0f)
+                                    : 0.0f;
+  BarState& state = _bars[bar];
+  if (value == state.value) {
+    return;
+  }
+
+  // The first value is shown as it is.
+  if (state.value < 0) {
+    state = {value, value, value, false};
+  } else if (value < state.fill) {
+    state.value = value;
+    state.fill = value;
+    state.isAnimating = true;
+  } else {
+    state.value = value;
+    state.trail = std::max(state.trail, value);
+    state.isAnimating = true;
+  }
+
+  if (_texture) {
+    updateBarQuads(bar);
+  }
+}
+
+void HudMesh::setWeaponIcon(const string& iconPath) {
+  const unsigned int revision = ++_weaponIconRevision;
+  if (!_texture) {
+    return;
+  }
+  setQuad(Quad::WEAPON_ICON_QUAD, Piece::WEAPON_ICON, 0, 0, 0, 0);
+  if (iconPath.empty()) {
+    return;
+  }
+
+  // Kept alive until the icon has been copied into the texture.
+  retain();
+  const string fullPath = FileUtils::getInstance()->fullPathForFilename(iconPath);
+  auto pixels = std::make_shared<Pixels>();
+  auto isDecoded = std::make_shared<bool>();
+  ThreadPool::getInstance()->post([fullPath, pixels, isDecoded]() {
+    Image image;
+    *isDecoded = image.initWithImageFileThreadSafe(fullPath) && readPixels(image, *pixels);
+  }, [this, revision, iconPath, pixels, isDecoded]() {
+    if (revision == _weaponIconRevision) {
+      if (!*isDecoded) {
+        VGLOG(LOG_ERR, "Unable to read the pixels of [%s]", iconPath.c_str());
+      } else {
+        // The icon is cropped if it doesn't fit in the cell.
+        const int width = std::min(pixels->width, HUD_ICON_CELL_SIZE);
+        const int height = std::min(pixels->height, HUD_ICON_CELL_SIZE);
+        vector<uint8_t> cell(HUD_ICON_CELL_SIZE * HUD_ICON_CELL_SIZE * 4);
+        for (int row = 0; row < height; row++) {
+          std::copy_n(&pixels->rgba[static_cast<size_t>(row) * pixels->width * 4], width * 4,
+                      &cell[static_cast<size_t>(row) * HUD_ICON_CELL_SIZE * 4]);
+        }
+        _texture->updateWithData(cell.data(), 0, 0, HUD_ICON_CELL_SIZE, HUD_ICON_CELL_SIZE);
+
+        // Same as the ImageView it replaces: 1.5x, centered in the slot.
+        _pieceRects[Piece::WEAPON_ICON].setRect(0, 0, width, height);
+        setQuad(Quad::WEAPON_ICON_QUAD, Piece::WEAPON_ICON,
+                -20 - width * .75f, -15 - height * .75f, width * 1.5f, height * 1.5f);
+      }
+    }
+    release();
+  });
+}
+
+void HudMesh::step(float delta) {
+  if (!_texture) {
+    return;
+  }
+
+  const float distance = HUD_BAR_CATCH_UP_SPEED * delta;
+  for (int i = 0; i < Bar::SIZE; i++) {
+    BarState& state = _bars[i];
+    if (!state.isAnimating) {
+      continue;
+    }
+    state.fill = std::min(state.fill + distance, state.value);
+    state.trail = std::max(state.trail - distance, state.value);
+    state.isAnimating = state.fill != state.value || state.trail != state.value;
+    updateBarQuads(static_cast<Bar>(i));
+  }
+}
+
+void HudMesh::draw(Renderer* renderer, const Mat4& transform, uint32_t flags) {
+  if (!_texture) {
+    return;
+  }
+  _quadCommand.init(_globalZOrder, _texture, getGLProgramState(), BlendFunc::ALPHA_PREMULTIPLIED,
+                    _quads.data(), _quads.size(), transform, flags);
+  renderer->addCommand(&_quadCommand);
+}
+
+
+void HudMesh::setQuad(HudMesh::Quad quad, HudMesh::Piece piece, float x, float y,
+                      float width, float height, GLubyte opacity) {
+  const Rect& rect = _pieceRects[piece];
+  const float atlasWidth = static_cast<float>(_texture->getPixelsWide());
+  const float atlasHeight = static_cast<float>(_texture->getPixelsHigh());
+  const float left = rect.origin.x / atlasWidth;
+  const float right = (rect.origin.x + rect.size.width) / atlasWidth;
+  const float top = rect.origin.y / atlasHeight;
+  const float bottom = (rect.origin.y + rect.size.height) / atlasHeight;
+
+  V3F_C4B_T2F_Quad& q = _quads[quad];
+  q.bl.vertices.set(x, y, 0);
+  q.br.vertices.set(x + width, y, 0);
+  q.tl.vertices.set(x, y + height, 0);
+  q.tr.vertices.set(x + width, y + height, 0);
+  q.bl.texCoords = {left, bottom};
+  q.br.texCoords = {right, bottom};
+  q.tl.texCoords = {left, top};
+  q.tr.texCoords = {right, top};
+  // The texture is premultiplied.
+  q.bl.colors = q.br.colors = q.tl.colors = q.tr.colors = Color4B(opacity, opacity, opacity, opacity);
+}
+
+void HudMesh::updateBarQuads(HudMesh::Bar bar) {
+  static const array<float, Bar::SIZE> kBarY = {{0, -6.0f, -12.0f}};
+
+  const BarState& state = _bars[bar];
+  const Piece barPiece = static_cast<Piece>(Piece::HEALTH_BAR + bar);
+  const Size& leftPaddingSize = _pieceRects[Piece::LEFT_PADDING].size;
+  const Size& rightPaddingSize = _pieceRects[Piece::RIGHT_PADDING].size;
+  const Size& barSize = _pieceRects[barPiece].size;
+  const float fullWidth = barSize.width * _barLength;
+  const float fill = std::max(state.fill, 0.0f);
+  const float trail = std::max(state.trail, 0.0f);
+  const float y = kBarY[bar];
+
+  const int firstQuad = Quad::BAR_QUADS + 4 * bar;
+  setQuad(static_cast<Quad>(firstQuad), Piece::LEFT_PADDING,
+          0, y, leftPaddingSize.width, leftPaddingSize.height);
+  setQuad(static_cast<Quad>(firstQuad + 1), barPiece,
+          leftPaddingSize.width, y, fullWidth * trail, barSize.height, HUD_BAR_TRAIL_OPACITY);
+  setQuad(static_cast<Quad>(firstQuad + 2), barPiece,
+          leftPaddingSize.width, y, fullWidth * fill, barSize.height);
+  setQuad(static_cast<Quad>(firstQuad + 3), Piece::RIGHT_PADDING,
+          leftPaddingSize.width + fullWidth * std::max(fill, trail), y,
+          rightPaddingSize.width, rightPaddingSize.height);
+}
+
+}  // namespace vigilante
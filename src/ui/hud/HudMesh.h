@@ -0,0 +1,103 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_HUD_MESH_H_
+#define VIGILANTE_HUD_MESH_H_
+
+#include <array>
+#include <string>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+// Draws the status bars (with their paddings), the equipped weapon slot and
+// its icon, and the background of the weapon's name as the quads of a single
+// texture with one QuadCommand. The Hud is on the screen all the time, and it
+// used to be a dozen ImageViews, i.e., a dozen draw calls.
+//
+// The images are packed into the texture when the mesh is created (they're
+// only a few dozen pixels wide), and the icon of the equipped weapon is
+// copied into a reserved cell of it whenever the weapon changes, having been
+// decoded on a worker thread (see ThreadPool).
+//
+// Each bar has a fill and a translucent trail of the same image. When the
+// value drops, the fill drops right away and the trail catches up with it.
+// When the value rises, the trail jumps and the fill catches up with it.
+// Only the quads of the bars which are still animating are rebuilt by step().
+//
+// All methods must be called on the main thread.
+class HudMesh : public cocos2d::Node {
+ public:
+  enum Bar {
+    HEALTH,
+    MAGICKA,
+    STAMINA,
+    SIZE
+  };
+
+  // `barLength` is the horizontal scale of the bar images when they're full.
+  static HudMesh* create(float barLength);
+
+  void setBarValue(HudMesh::Bar bar, int currentVal, int fullVal);
+  // An empty `iconPath` removes the icon.
+  void setWeaponIcon(const std::string& iconPath);
+
+  // Animates the bars towards their values.
+  void step(float delta);
+
+  virtual void draw(cocos2d::Renderer* renderer, const cocos2d::Mat4& transform, uint32_t flags) override;
+
+ private:
+  // The images packed into the texture.
+  enum Piece {
+    LEFT_PADDING,
+    RIGHT_PADDING,
+    HEALTH_BAR,
+    MAGICKA_BAR,
+    STAMINA_BAR,
+    WEAPON_SLOT,
+    WEAPON_DESC_BG,
+    WEAPON_ICON,  // a reserved cell, see setWeaponIcon()
+    PIECE_SIZE
+  };
+
+  // The quads, in the order they're drawn.
+  enum Quad {
+    WEAPON_SLOT_QUAD,
+    WEAPON_ICON_QUAD,
+    BAR_QUADS,  // LEFT_PADDING, trail, fill, RIGHT_PADDING of each bar
+    WEAPON_DESC_BG_QUAD = BAR_QUADS + 4 * Bar::SIZE,
+    QUAD_SIZE
+  };
+
+  struct BarState final {
+    float value;  // the target ratio, in [0, 1]
+    float fill;
+    float trail;
+    bool isAnimating;
+  };
+
+  explicit HudMesh(float barLength);
+  virtual ~HudMesh();
+
+  virtual bool init() override;
+  bool createTexture();
+
+  void setQuad(HudMesh::Quad quad, HudMesh::Piece piece, float x, float y,
+               float width, float height, GLubyte opacity=255);
+  void updateBarQuads(HudMesh::Bar bar);
+
+  const float _barLength;
+  cocos2d::Texture2D* _texture;  // retained
+  std::array<cocos2d::Rect, HudMesh::Piece::PIECE_SIZE> _pieceRects;  // in pixels
+  std::array<HudMesh::BarState, HudMesh::Bar::SIZE> _bars;
+  std::array<cocos2d::V3F_C4B_T2F_Quad, HudMesh::Quad::QUAD_SIZE> _quads;
+  cocos2d::QuadCommand _quadCommand;
+
+  // Bumped by each setWeaponIcon(), so that an icon decoded
+  // after the weapon has changed again is discarded.
+  unsigned int _weaponIconRevision;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_HUD_MESH_H_
@@ -4,6 +4,7 @@
 #include "AssetManager.h"
 #include "ui/Colorscheme.h"
 #include "ui/pause_menu/PauseMenu.h"
+#include "util/LabelUtil.h"
 
 using std::array;
 using std::string;
@@ -25,8 +26,8 @@ HeaderPane::HeaderPane(PauseMenu* pauseMenu)
 
   float nextX = 0;
   for (int i = 0; i < PauseMenu::Pane::SIZE; i++) {
-    Label* label = Label::createWithTTF(PauseMenu::_kPaneNames[i], kTitleFont, kRegularFontSize);
-    label->setTextColor(colorscheme::kGrey);
+    Label* label = label_util::create(PauseMenu::_kPaneNames[i], kTitleFont, kRegularFontSize);
+    label_util::setTextColor(label, colorscheme::kGrey);
     label->setPositionX(nextX + _kOptionGap * i);
     label->getFontAtlas()->setAliasTexParameters();
     _layout->addChild(label);
@@ -51,8 +52,8 @@ void HeaderPane::select(int index) {
   if (index < 0 || index >= _kOptionCount) {
     return;
   }
-  _labels[_currentIndex]->setTextColor(colorscheme::kGrey);
-  _labels[index]->setTextColor(colorscheme::kWhite);
+  label_util::setTextColor(_labels[_currentIndex], colorscheme::kGrey);
+  label_util::setTextColor(_labels[index], colorscheme::kWhite);
   _currentIndex = index;
 }
 
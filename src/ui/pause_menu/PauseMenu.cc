@@ -3,13 +3,16 @@
 
 #include "std/make_unique.h"
 #include "AssetManager.h"
+#include "EventBus.h"
 #include "input/InputManager.h"
 #include "map/GameMapManager.h"
+#include "ui/UiModuleRegistry.h"
 #include "ui/pause_menu/inventory/InventoryPane.h"
 #include "ui/pause_menu/equipment/EquipmentPane.h"
 #include "ui/pause_menu/skill/SkillPane.h"
 #include "ui/pause_menu/quest/QuestPane.h"
 #include "ui/pause_menu/option/OptionPane.h"
+#include "util/DeferredTaskScheduler.h"
 #include "util/Logger.h"
 
 #define HEADER_PANE_POS {140, 280}
@@ -47,7 +50,11 @@ PauseMenu::PauseMenu()
       _background(ImageView::create(kPauseMenuBg)),
       _headerPane(std::make_unique<HeaderPane>(this)),
       _statsPane(std::make_unique<StatsPane>(this)),
-      _dialog(std::make_unique<PauseMenuDialog>(this)) {
+      _dialog(std::make_unique<PauseMenuDialog>(this)),
+      _panes(),
+      _isPaneDirty(),
+      _isStatsPaneDirty(true),
+      _shownPlayer() {
   // Scale the bg image to fill the entire visible area.
   const auto visibleSize = Director::getInstance()->getVisibleSize();
   _background->setScaleX(visibleSize.width / _background->getContentSize().width);
@@ -69,26 +76,35 @@ PauseMenu::PauseMenu()
   _dialog->setVisible(false);
   _layer->addChild(_dialog->getLayout());
 
-  // Initialize Main Panes.
-  initMainPane(0, std::make_unique<InventoryPane>(this));
-  initMainPane(1, std::make_unique<EquipmentPane>(this));
-  initMainPane(2, std::make_unique<SkillPane>(this));
-  initMainPane(3, std::make_unique<QuestPane>(this));
-  initMainPane(4, std::make_unique<OptionPane>(this));
-
-  // Show inventory pane by default.
-  _panes.front()->setVisible(true);
+  // Show inventory pane by default. The other panes
+  // are constructed when they're shown for the first time.
+  getPane(Pane::INVENTORY)->setVisible(true);
+
+  // Mark the panes which display the player's stats, items or quests dirty
+  // when they change, and refresh the visible ones if the PauseMenu is shown.
+  EventBus::getInstance()->subscribe<StatChangedEvent>([this](const StatChangedEvent& e) {
+    if (e.character == getPlayer()) {
+      _isStatsPaneDirty = true;
+      requestUpdate();
+    }
+  });
+  EventBus::getInstance()->subscribe<ItemChangedEvent>([this](const ItemChangedEvent& e) {
+    if (e.character == getPlayer()) {
+      _isStatsPaneDirty = true;
+      setPaneDirty(Pane::INVENTORY);
+      setPaneDirty(Pane::EQUIPMENT);
+      requestUpdate();
+    }
+  });
+  EventBus::getInstance()->subscribe<QuestProgressedEvent>([this](const QuestProgressedEvent&) {
+    setPaneDirty(Pane::QUESTS);
+    requestUpdate();
+  });
 
   // By default, the PauseMenu should be invisible.
   _layer->setVisible(false);
-}
 
-void PauseMenu::initMainPane(int index, std::unique_ptr<AbstractPane> pane) {
-  pane->setPosition(MAIN_PANE_POS);
-  pane->setVisible(false);
-  _layer->addChild(pane->getLayout());
-
-  _panes[index] = std::move(pane);
+  UiModuleRegistry::getInstance()->onInstantiated(UiModuleRegistry::Module::PAUSE_MENU, _layer);
 }
 
 
@@ -97,8 +113,11 @@ void PauseMenu::update() {
     return;
   }
 
-  _statsPane->update();
-  _panes[_headerPane->getCurrentIndex()]->update();
+  if (_isStatsPaneDirty) {
+    _statsPane->update();
+    _isStatsPaneDirty = false;
+  }
+  refreshPane(_headerPane->getCurrentIndex());
 }
 
 void PauseMenu::handleInput() {
@@ -110,7 +129,7 @@ void PauseMenu::handleInput() {
   if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_Q)) {
     getCurrentPane()->setVisible(false);
     _headerPane->selectPrev();
-    getCurrentPane()->update();
+    refreshPane(_headerPane->getCurrentIndex());
     getCurrentPane()->setVisible(true);
 
     ControlHints::getInstance()->switchToProfile(
@@ -119,30 +138,94 @@ void PauseMenu::handleInput() {
   } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_E)) {
     getCurrentPane()->setVisible(false);
     _headerPane->selectNext();
-    getCurrentPane()->update();
+    refreshPane(_headerPane->getCurrentIndex());
     getCurrentPane()->setVisible(true);
 
     ControlHints::getInstance()->switchToProfile(
         static_cast<ControlHints::Profile>(_headerPane->getCurrentIndex()));
   }
 
-  _panes[_headerPane->getCurrentIndex()]->handleInput();
+  getCurrentPane()->handleInput();
 }
 
 void PauseMenu::show(Pane pane) {
+  // The pane is always refreshed, since it may be shown
+  // in a different mode (e.g., selecting an equipment).
   getCurrentPane()->setVisible(false);
   _headerPane->select(static_cast<int>(pane));
+  setPaneDirty(pane);
   getCurrentPane()->setVisible(true);
   update();
 }
 
 
+AbstractPane* PauseMenu::getPane(int index) {
+  if (!_panes[index]) {
+    _panes[index] = createPane(static_cast<Pane>(index));
+    _panes[index]->setPosition(MAIN_PANE_POS);
+    _panes[index]->setVisible(false);
+    _layer->addChild(_panes[index]->getLayout());
+
+    // The pane has been created after the camera mask of _layer has
+    // been set (see GameScene::init()), so apply it to the pane as well.
+    _layer->setCameraMask(_layer->getCameraMask());
+    _isPaneDirty[index] = true;
+  }
+  return _panes[index].get();
+}
+
+unique_ptr<AbstractPane> PauseMenu::createPane(Pane pane) {
+  switch (pane) {
+    case Pane::INVENTORY:
+      return std::make_unique<InventoryPane>(this);
+    case Pane::EQUIPMENT:
+      return std::make_unique<EquipmentPane>(this);
+    case Pane::SKILLS:
+      return std::make_unique<SkillPane>(this);
+    case Pane::QUESTS:
+      return std::make_unique<QuestPane>(this);
+    case Pane::OPTIONS:
+    default:
+      return std::make_unique<OptionPane>(this);
+  }
+}
+
+void PauseMenu::refreshPane(int index) {
+  AbstractPane* pane = getPane(index);
+  if (!_isPaneDirty[index] || !getPlayer()) {
+    return;
+  }
+
+  pane->update();
+  _isPaneDirty[index] = false;
+}
+
+void PauseMenu::setPaneDirty(Pane pane) {
+  _isPaneDirty[pane] = true;
+}
+
+void PauseMenu::requestUpdate() {
+  // The refresh is deferred (see DeferredTaskScheduler), so that it happens
+  // at most once per frame no matter how many kinds of events have been posted.
+  if (!isVisible()) {
+    return;
+  }
+
+  DeferredTaskScheduler::getInstance()->post([this]() {
+    if (isVisible()) {
+      update();
+    }
+    return true;
+  }, this);
+}
+
+
 Player* PauseMenu::getPlayer() const {
   return GameMapManager::getInstance()->getPlayer();
 }
 
-AbstractPane* PauseMenu::getCurrentPane() const {
-  return _panes[_headerPane->getCurrentIndex()].get();
+AbstractPane* PauseMenu::getCurrentPane() {
+  return getPane(_headerPane->getCurrentIndex());
 }
 
 Layer* PauseMenu::getLayer() const {
@@ -160,6 +243,18 @@ bool PauseMenu::isVisible() const {
 
 void PauseMenu::setVisible(bool visible) {
   if (visible && !isVisible()) {
+    // Nothing tells when the skills or the options change,
+    // so these panes are refreshed whenever they're shown.
+    setPaneDirty(Pane::SKILLS);
+    setPaneDirty(Pane::OPTIONS);
+
+    // A new game has been started or loaded since the last time.
+    if (getPlayer() != _shownPlayer) {
+      _shownPlayer = getPlayer();
+      _isStatsPaneDirty = true;
+      _isPaneDirty.fill(true);
+    }
+
     _layer->setVisible(true);
     ControlHints::getInstance()->pushProfile(
         static_cast<ControlHints::Profile>(_headerPane->getCurrentIndex()));
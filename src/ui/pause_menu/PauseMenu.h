@@ -43,12 +43,15 @@ class PauseMenu : public Controllable {
 
   virtual ~PauseMenu() = default;
 
+  // Refreshes the StatsPane and the current pane if they're dirty, i.e.,
+  // the player's stats, items or quests have changed since they were last
+  // refreshed. The hidden panes are refreshed when they're shown.
   void update();
   virtual void handleInput() override;
   void show(PauseMenu::Pane pane);
 
 
-  AbstractPane* getCurrentPane() const;
+  AbstractPane* getCurrentPane();
   cocos2d::Layer* getLayer() const;
   PauseMenuDialog* getDialog() const;
   Player* getPlayer() const;
@@ -58,7 +61,13 @@ class PauseMenu : public Controllable {
 
  private:
   PauseMenu();
-  void initMainPane(int index, std::unique_ptr<AbstractPane> pane);
+
+  // The main panes are constructed when they're shown for the first time.
+  AbstractPane* getPane(int index);
+  std::unique_ptr<AbstractPane> createPane(PauseMenu::Pane pane);
+  void refreshPane(int index);
+  void setPaneDirty(PauseMenu::Pane pane);
+  void requestUpdate();
 
   cocos2d::Layer* _layer;
   cocos2d::ui::ImageView* _background;
@@ -67,6 +76,9 @@ class PauseMenu : public Controllable {
   std::unique_ptr<StatsPane> _statsPane;
   std::unique_ptr<PauseMenuDialog> _dialog;
   std::array<std::unique_ptr<AbstractPane>, PauseMenu::Pane::SIZE> _panes;
+  std::array<bool, PauseMenu::Pane::SIZE> _isPaneDirty;
+  bool _isStatsPaneDirty;
+  Player* _shownPlayer;  // whose stats, items, etc. are shown in the panes
 };
 
 }  // namespace vigilante
@@ -6,6 +6,7 @@
 #include "input/InputManager.h"
 #include "ui/TableLayout.h"
 #include "ui/control_hints/ControlHints.h"
+#include "util/LabelUtil.h"
 
 using std::string;
 using std::unique_ptr;
@@ -24,7 +25,7 @@ const int PauseMenuDialog::Option::_kIconLabelGap = 1;
 
 PauseMenuDialog::PauseMenuDialog(PauseMenu* pauseMenu)
     : AbstractPane(pauseMenu, TableLayout::create()),
-      _message(Label::createWithTTF("", kBoldFont, kRegularFontSize)),
+      _message(label_util::create("", kBoldFont, kRegularFontSize)),
       _current() {
   _message->setAnchorPoint({0, 1});
   _message->getFontAtlas()->setAliasTexParameters();
@@ -150,7 +151,7 @@ void PauseMenuDialog::clearOptions() {
 PauseMenuDialog::Option::Option(const string& text, const function<void ()>& handler)
     : _layout(Layout::create()),
       _icon(ImageView::create(kDialogueTriangle)),
-      _label(Label::createWithTTF(text, kBoldFont, kRegularFontSize)),
+      _label(label_util::create(text, kBoldFont, kRegularFontSize)),
       _handler(handler) {
   _icon->setAnchorPoint({0, 1});
   _icon->setVisible(false);
@@ -5,6 +5,7 @@
 #include "character/Player.h"
 #include "ui/Colorscheme.h"
 #include "ui/pause_menu/PauseMenu.h"
+#include "util/LabelUtil.h"
 #include "util/StringUtil.h"
 
 using std::string;
@@ -26,19 +27,19 @@ const float StatsPane::_kSectionHeight = 8.0f;
 StatsPane::StatsPane(PauseMenu* pauseMenu)
     : AbstractPane(pauseMenu, TableLayout::create()), // install TableLayout to base class
       _background(ImageView::create(kStatsBg)),
-      _name(Label::createWithTTF("Aesophor", kRegularFont, kRegularFontSize)),
-      _level(Label::createWithTTF("Level 1", kRegularFont, kRegularFontSize)), 
-      _health(Label::createWithTTF("100 / 100", kRegularFont, kRegularFontSize)),
-      _magicka(Label::createWithTTF("100 / 100", kRegularFont, kRegularFontSize)),
-      _stamina(Label::createWithTTF("100 / 100", kRegularFont, kRegularFontSize)),
-      _attackRange(Label::createWithTTF("5", kRegularFont, kRegularFontSize)),
-      _attackSpeed(Label::createWithTTF("10", kRegularFont, kRegularFontSize)),
-      _moveSpeed(Label::createWithTTF("100", kRegularFont, kRegularFontSize)),
-      _jumpHeight(Label::createWithTTF("100", kRegularFont, kRegularFontSize)),
-      _str(Label::createWithTTF("5", kRegularFont, kRegularFontSize)),
-      _dex(Label::createWithTTF("5", kRegularFont, kRegularFontSize)),
-      _int(Label::createWithTTF("5", kRegularFont, kRegularFontSize)),
-      _luk(Label::createWithTTF("5", kRegularFont, kRegularFontSize)) {
+      _name(label_util::create("Aesophor", kRegularFont, kRegularFontSize)),
+      _level(label_util::create("Level 1", kRegularFont, kRegularFontSize)), 
+      _health(label_util::create("100 / 100", kRegularFont, kRegularFontSize)),
+      _magicka(label_util::create("100 / 100", kRegularFont, kRegularFontSize)),
+      _stamina(label_util::create("100 / 100", kRegularFont, kRegularFontSize)),
+      _attackRange(label_util::create("5", kRegularFont, kRegularFontSize)),
+      _attackSpeed(label_util::create("10", kRegularFont, kRegularFontSize)),
+      _moveSpeed(label_util::create("100", kRegularFont, kRegularFontSize)),
+      _jumpHeight(label_util::create("100", kRegularFont, kRegularFontSize)),
+      _str(label_util::create("5", kRegularFont, kRegularFontSize)),
+      _dex(label_util::create("5", kRegularFont, kRegularFontSize)),
+      _int(label_util::create("5", kRegularFont, kRegularFontSize)),
+      _luk(label_util::create("5", kRegularFont, kRegularFontSize)) {
   // AbstractPane::_layout is a cocos2d::ui::Layout,
   // but we know it's a TableLayout in StatsPane
   TableLayout* layout = dynamic_cast<TableLayout*>(_layout);
@@ -51,7 +52,7 @@ StatsPane::StatsPane(PauseMenu* pauseMenu)
   // Add name and level label at the top.
   layout->addChild(_name);
   layout->align(TableLayout::Alignment::LEFT)->padLeft(_kPadLeft)->padBottom(15.0f);
-  _level->setTextColor(colorscheme::kRed);
+  label_util::setTextColor(_level, colorscheme::kRed);
   layout->addChild(_level);
   layout->align(TableLayout::Alignment::RIGHT)->padRight(_kPadRight)->padBottom(15.0f);
   layout->row(4.0f);
@@ -75,22 +76,34 @@ StatsPane::StatsPane(PauseMenu* pauseMenu)
 
 
 void StatsPane::update() {
-  Character::Profile& profile = _pauseMenu->getPlayer()->getCharacterProfile();
+  Player* player = _pauseMenu->getPlayer();
+  const Character::Profile& profile = player->getCharacterProfile();
+  const Character::DerivedStats& stats = player->getDerivedStats();
 
   _level->setString(string_util::format("Level %d", profile.level));
-  _health->setString(string_util::format("%d / %d", profile.health, profile.fullHealth));
-  _magicka->setString(string_util::format("%d / %d", profile.magicka, profile.fullMagicka));
-  _stamina->setString(string_util::format("%d / %d", profile.stamina, profile.fullStamina));
+  _health->setString(string_util::format("%d / %d",
+        player->getStat(StatsSystem::Stat::HEALTH), profile.fullHealth));
+  _magicka->setString(string_util::format("%d / %d",
+        player->getStat(StatsSystem::Stat::MAGICKA), profile.fullMagicka));
+  _stamina->setString(string_util::format("%d / %d",
+        player->getStat(StatsSystem::Stat::STAMINA), profile.fullStamina));
 
   _attackRange->setString(string_util::format("%.2f", profile.attackRange));
   _attackSpeed->setString(string_util::format("%.2f", profile.attackTime));
-  _moveSpeed->setString(string_util::format("%.2f", profile.moveSpeed));
-  _jumpHeight->setString(string_util::format("%.2f", profile.jumpHeight));
+  _moveSpeed->setString(string_util::format("%.2f", stats.moveSpeed));
+  _jumpHeight->setString(string_util::format("%.2f", stats.jumpHeight));
 
-  _str->setString(string_util::format("%d", profile.strength));
-  _dex->setString(string_util::format("%d", profile.dexterity));
-  _int->setString(string_util::format("%d", profile.intelligence));
-  _luk->setString(string_util::format("%d", profile.luck));
+  _str->setString(string_util::format("%d", stats.strength));
+  _dex->setString(string_util::format("%d", stats.dexterity));
+  _int->setString(string_util::format("%d", stats.intelligence));
+  _luk->setString(string_util::format("%d", stats.luck));
+
+  // Only the rows whose values have changed in width are relaid out.
+  TableLayout* layout = dynamic_cast<TableLayout*>(_layout);
+  for (auto label : {_level, _health, _magicka, _stamina, _attackRange, _attackSpeed,
+                     _moveSpeed, _jumpHeight, _str, _dex, _int, _luk}) {
+    layout->invalidate(label);
+  }
 }
 
 void StatsPane::handleInput() {
@@ -101,8 +114,8 @@ void StatsPane::addEntry(const string& title, Label* label) const {
   TableLayout* layout = dynamic_cast<TableLayout*>(_layout);
 
   // Create title label and disable antialiasing.
-  Label* titleLabel = Label::createWithTTF(title, kRegularFont, kRegularFontSize);
-  titleLabel->setTextColor(colorscheme::kGrey);
+  Label* titleLabel = label_util::create(title, kRegularFont, kRegularFontSize);
+  label_util::setTextColor(titleLabel, colorscheme::kGrey);
   titleLabel->getFontAtlas()->setAliasTexParameters();
   label->getFontAtlas()->setAliasTexParameters();
 
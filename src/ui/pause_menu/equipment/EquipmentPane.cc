@@ -8,6 +8,7 @@
 #include "input/InputManager.h"
 #include "ui/pause_menu/PauseMenu.h"
 #include "ui/pause_menu/inventory/InventoryPane.h"
+#include "util/LabelUtil.h"
 
 using std::string;
 using std::unique_ptr;
@@ -102,8 +103,8 @@ EquipmentPane::EquipmentItem::EquipmentItem(EquipmentPane* parent, const string&
       _layout(TableLayout::create(300)), // FIXME: remove this literal
       _background(ImageView::create(kEquipmentRegular)),
       _icon(ImageView::create(kEmptyImage)),
-      _equipmentTypeLabel(Label::createWithTTF(title, kTitleFont, kRegularFontSize)),
-      _equipmentNameLabel(Label::createWithTTF("---", kBoldFont, kRegularFontSize)),
+      _equipmentTypeLabel(label_util::create(title, kTitleFont, kRegularFontSize)),
+      _equipmentNameLabel(label_util::create("---", kBoldFont, kRegularFontSize)),
       _equipment() {
   _icon->setScale((float) _kEquipmentIconSize / kIconSize);
 
@@ -140,6 +141,7 @@ void EquipmentPane::EquipmentItem::setEquipment(Equipment* equipment) {
     _icon->loadTexture(kEmptyImage);
     _equipmentNameLabel->setString("---");
   }
+  _layout->invalidate(_equipmentNameLabel);
 }
 
 void EquipmentPane::EquipmentItem::setSelected(bool selected) const {
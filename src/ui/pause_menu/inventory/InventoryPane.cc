@@ -64,6 +64,10 @@ void InventoryPane::handleInput() {
     _itemListView->selectUp();
   } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_DOWN_ARROW)) {
     _itemListView->selectDown();
+  } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_S) && !_isSelectingEquipment) {
+    _itemListView->cycleSortKey();
+  } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_F) && !_isSelectingEquipment) {
+    _itemListView->beginSearch();
   } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_ENTER)) {
     if (!_isSelectingEquipment) {
       _itemListView->confirm();
@@ -95,4 +99,8 @@ void InventoryPane::selectEquipment(Equipment::Type equipmentType) {
   _itemListView->showEquipmentByType(equipmentType);
 }
 
+ItemListView* InventoryPane::getItemListView() const {
+  return _itemListView.get();
+}
+
 }  // namespace vigilante
@@ -25,6 +25,7 @@ class InventoryPane : public AbstractPane {
   virtual void handleInput() override;
 
   void selectEquipment(Equipment::Type equipmentType);
+  ItemListView* getItemListView() const;
 
  private:
   cocos2d::ui::ImageView* _background;
@@ -9,8 +9,9 @@
 #include "item/Consumable.h"
 #include "ui/pause_menu/PauseMenu.h"
 #include "ui/pause_menu/PauseMenuDialog.h"
-#include "util/ds/SetVector.h"
 #include "util/KeyCodeUtil.h"
+#include "ui/notifications/Notifications.h"
+#include "util/LabelUtil.h"
 
 #define VISIBLE_ITEM_COUNT 5
 #define WIDTH 289.5
@@ -21,6 +22,7 @@
 
 #define DESC_LABEL_X 5
 #define DESC_LABEL_Y -132
+#define SEARCH_FIELD_HEIGHT 12
 
 #define EMPTY_ITEM_ICON vigilante::asset_manager::kEmptyImage
 #define EMPTY_ITEM_NAME "---"
@@ -36,7 +38,10 @@ namespace vigilante {
 ItemListView::ItemListView(PauseMenu* pauseMenu)
     : ListView<Item*>(VISIBLE_ITEM_COUNT, WIDTH, HEIGHT, ITEM_GAP_HEIGHT, REGULAR_BG, HIGHLIGHTED_BG),
       _pauseMenu(pauseMenu),
-      _descLabel(Label::createWithTTF("", asset_manager::kRegularFont, asset_manager::kRegularFontSize)) {
+      _descLabel(label_util::create("", asset_manager::kRegularFont, asset_manager::kRegularFontSize)),
+      _descLayouts(_descLabel, asset_manager::kRegularFont, asset_manager::kRegularFontSize),
+      _query(),
+      _searchField() {
 
   // _setObjectCallback is called at the end of ListView<T>::ListViewItem::setObject()
   // see ui/ListView.h
@@ -68,11 +73,35 @@ ItemListView::ItemListView(PauseMenu* pauseMenu)
     }
   };
 
+  // The rows also have to be rebound when the amount or the hotkey changes.
+  _getObjectStateCallback = [](Item* item) -> uint64_t {
+    if (!item) {
+      return 0;
+    }
+    Keybindable* keybindable = dynamic_cast<Keybindable*>(item);
+    const uint64_t hotkey = (keybindable) ? static_cast<uint64_t>(keybindable->getHotkey()) : 0;
+    return (hotkey << 32) | static_cast<uint32_t>(item->getAmount());
+  };
+
   _descLabel->getFontAtlas()->setAliasTexParameters();
   _descLabel->setAnchorPoint({0, 1});
   _descLabel->setPosition({DESC_LABEL_X, DESC_LABEL_Y});
   _descLabel->enableWrap(true);
   _layout->addChild(_descLabel);
+
+  // The search field takes the place of the description label while typing.
+  _searchField.getLayout()->setPosition({DESC_LABEL_X, DESC_LABEL_Y - SEARCH_FIELD_HEIGHT});
+  _searchField.getLayout()->setVisible(false);
+  _searchField.setOnChange([this]() {
+    _query.setFilter(_searchField.getString());
+    showQueryResults();
+  });
+  _searchField.setOnDismiss([this]() {
+    _searchField.setReceivingInput(false);
+    _searchField.getLayout()->setVisible(false);
+    _descLayouts.setVisible(true);
+  });
+  _layout->addChild(_searchField.getLayout());
 }
 
 
@@ -90,13 +119,11 @@ void ItemListView::confirm() {
     case Item::Type::EQUIPMENT:
       dialog->setOption(0, true, "Equip", [=]() {
         _pauseMenu->getPlayer()->equip(dynamic_cast<Equipment*>(item));
-        _pauseMenu->update();
       });
       break;
     case Item::Type::CONSUMABLE:
       dialog->setOption(0, true, "Use", [=]() {
         _pauseMenu->getPlayer()->useItem(dynamic_cast<Consumable*>(item));
-        _pauseMenu->update();
       });
       break;
     case Item::Type::MISC:  // fall through
@@ -106,7 +133,6 @@ void ItemListView::confirm() {
 
   dialog->setOption(1, true, "Discard", [=]() {
     _pauseMenu->getPlayer()->discardItem(item, 1);
-    _pauseMenu->update();
   });
   dialog->setOption(2, true, "Cancel");
   dialog->show();
@@ -121,7 +147,8 @@ void ItemListView::selectUp() {
   }
 
   Item* selectedItem = getSelectedObject();
-  _descLabel->setString((selectedItem) ? selectedItem->getDesc() : "Unequip");
+  _descLayouts.setString((selectedItem) ? selectedItem->getDesc() : "Unequip");
+  preloadSelectedEquipment();
 }
 
 void ItemListView::selectDown() {
@@ -132,20 +159,20 @@ void ItemListView::selectDown() {
   }
 
   Item* selectedItem = getSelectedObject();
-  _descLabel->setString((selectedItem) ? selectedItem->getDesc() : "Unequip");
+  _descLayouts.setString((selectedItem) ? selectedItem->getDesc() : "Unequip");
+  preloadSelectedEquipment();
 }
 
 
 void ItemListView::showItemsByType(Item::Type itemType) {
   // Show items of the specified type in ItemListView.
-  setObjects(_pauseMenu->getPlayer()->getInventory()[itemType]);
-
-  // Update description label.
-  _descLabel->setString((_objects.size() > 0) ? _objects[_current]->getDesc() : "");
+  _query.setOwner(_pauseMenu->getPlayer());
+  _query.setItemType(itemType);
+  showQueryResults();
 }
 
 void ItemListView::showEquipmentByType(Equipment::Type equipmentType) {
-  const SetVector<Item*>& equipments = _pauseMenu->getPlayer()->getInventory()[Item::Type::EQUIPMENT];
+  const vector<Item*>& equipments = _pauseMenu->getPlayer()->getInventory()[Item::Type::EQUIPMENT];
   deque<Item*> objects(equipments.begin(), equipments.end());
 
   // Filter out any equipment other than the specified equipmentType.
@@ -168,7 +195,38 @@ void ItemListView::showEquipmentByType(Equipment::Type equipmentType) {
 
   // Update description label. The first item is an empty item,
   // Selecting it will unequip current equipment.
-  _descLabel->setString((_objects.size() > 0) ? "Unequip" : "");
+  _descLayouts.setString((_objects.size() > 0) ? "Unequip" : "");
+  preloadSelectedEquipment();
+}
+
+
+void ItemListView::cycleSortKey() {
+  _query.cycleSortKey();
+  showQueryResults();
+  Notifications::getInstance()->show("Sort by: " + _query.getSortKeyName());
+}
+
+void ItemListView::beginSearch() {
+  _descLayouts.setVisible(false);
+  _searchField.getLayout()->setVisible(true);
+  _searchField.setReceivingInput(true);
+}
+
+void ItemListView::showQueryResults() {
+  setObjects(_query.getResults());
+
+  // Update description label.
+  _descLayouts.setString((_objects.size() > 0) ? _objects[_current]->getDesc() : "");
+  preloadSelectedEquipment();
+}
+
+void ItemListView::preloadSelectedEquipment() const {
+  if (_objects.empty()) {
+    return;
+  }
+  if (const Equipment* equipment = dynamic_cast<const Equipment*>(getSelectedObject())) {
+    _pauseMenu->getPlayer()->preloadEquipmentAnimations(equipment);
+  }
 }
 
 }  // namespace vigilante
@@ -4,7 +4,10 @@
 
 #include "item/Item.h"
 #include "item/Equipment.h"
+#include "ui/InventoryQuery.h"
 #include "ui/ListView.h"
+#include "ui/TextField.h"
+#include "ui/TextLayoutCache.h"
 
 namespace vigilante {
 
@@ -22,9 +25,21 @@ class ItemListView : public ListView<Item*> {
   void showItemsByType(Item::Type itemType);
   void showEquipmentByType(Equipment::Type equipmentType);
 
+  // Sorts / searches the items shown by showItemsByType().
+  void cycleSortKey();
+  void beginSearch();
+
  private:
+  void showQueryResults();
+  // Preloads the animations of the selected equipment (if any),
+  // so that equipping it is instant, see Character::preloadEquipmentAnimations().
+  void preloadSelectedEquipment() const;
+
   PauseMenu* _pauseMenu;
   cocos2d::Label* _descLabel;
+  TextLayoutCache _descLayouts;  // of _descLabel
+  InventoryQuery _query;
+  TextField _searchField;
 };
 
 }  // namespace vigilante
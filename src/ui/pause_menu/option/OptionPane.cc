@@ -29,9 +29,11 @@ OptionPane::OptionPane(PauseMenu* pauseMenu)
   _optionListView->getLayout()->setPosition({5, -5});
   _layout->addChild(_optionListView->getLayout());
 
-  auto quit = []() {
+  auto quit = [pauseMenu]() {
     InputManager::getInstance()->deactivate();
-    SceneManager::getInstance()->popScene();
+    pauseMenu->setVisible(false);
+    // Keep the GameMap and the UI around, so that going back to the game is instant.
+    SceneManager::getInstance()->suspendScene(GameScene::kSceneCacheKey);
     InputManager::getInstance()->activate(SceneManager::getInstance()->getCurrentScene());
   };
 
@@ -6,6 +6,7 @@
 #include "character/Player.h"
 #include "ui/pause_menu/PauseMenu.h"
 #include "ui/pause_menu/PauseMenuDialog.h"
+#include "util/LabelUtil.h"
 
 #define VISIBLE_ITEM_COUNT 5
 #define WIDTH 289.5
@@ -25,7 +26,7 @@ namespace vigilante {
 QuestListView::QuestListView(PauseMenu* pauseMenu)
     : ListView<Quest*>(VISIBLE_ITEM_COUNT, WIDTH, HEIGHT, ITEM_GAP_HEIGHT, REGULAR_BG, HIGHLIGHTED_BG),
       _pauseMenu(pauseMenu),
-      _descLabel(Label::createWithTTF("", asset_manager::kRegularFont, asset_manager::kRegularFontSize)) {
+      _descLabel(label_util::create("", asset_manager::kRegularFont, asset_manager::kRegularFontSize)) {
 
   // _setObjectCallback is called at the end of ListView<T>::ListViewItem::setObject()
   // see ui/ListView.h
@@ -129,7 +130,7 @@ void QuestListView::showCompletedQuests() {
 
 
 string QuestListView::generateDesc(const Quest* q) {
-  string text = q->getQuestProfile().desc;
+  string text = q->getQuestProfile().desc.getText();
   text += (q->isCompleted()) ? "" : "\n\n" + q->getCurrentStage().getHint();
   return text;
 }
@@ -72,4 +72,9 @@ void QuestPane::handleInput() {
   }
 }
 
+
+QuestListView* QuestPane::getQuestListView() const {
+  return _questListView.get();
+}
+
 } // namespace vigilante
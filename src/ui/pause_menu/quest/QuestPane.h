@@ -20,6 +20,8 @@ class QuestPane : public AbstractPane {
   virtual void update() override;
   virtual void handleInput() override;
 
+  QuestListView* getQuestListView() const;
+
  private:
   cocos2d::ui::ImageView* _background;
   std::unique_ptr<TabView> _tabView;
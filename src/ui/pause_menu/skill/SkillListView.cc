@@ -9,6 +9,7 @@
 #include "ui/pause_menu/PauseMenu.h"
 #include "ui/pause_menu/PauseMenuDialog.h"
 #include "util/KeyCodeUtil.h"
+#include "util/LabelUtil.h"
 
 #define VISIBLE_ITEM_COUNT 5
 #define WIDTH 289.5
@@ -29,7 +30,8 @@ namespace vigilante {
 SkillListView::SkillListView(PauseMenu* pauseMenu)
     : ListView<Skill*>(VISIBLE_ITEM_COUNT, WIDTH, HEIGHT, ITEM_GAP_HEIGHT, REGULAR_BG, HIGHLIGHTED_BG),
       _pauseMenu(pauseMenu),
-      _descLabel(Label::createWithTTF("", asset_manager::kRegularFont, asset_manager::kRegularFontSize)) {
+      _descLabel(label_util::create("", asset_manager::kRegularFont, asset_manager::kRegularFontSize)),
+      _descLayouts(_descLabel, asset_manager::kRegularFont, asset_manager::kRegularFontSize) {
 
   // _setObjectCallback is called at the end of ListView<T>::ListViewItem::setObject()
   // see ui/ListView.h
@@ -53,6 +55,11 @@ SkillListView::SkillListView(PauseMenu* pauseMenu)
     }
   };
 
+  // The rows also have to be rebound when the hotkey changes.
+  _getObjectStateCallback = [](Skill* skill) -> uint64_t {
+    return static_cast<uint64_t>(skill->getHotkey());
+  };
+
   _descLabel->getFontAtlas()->setAliasTexParameters();
   _descLabel->setAnchorPoint({0, 1});
   _descLabel->setPosition({DESC_LABEL_X, DESC_LABEL_Y});
@@ -99,7 +106,7 @@ void SkillListView::selectUp() {
   }
 
   Skill* selectedSkill = getSelectedObject();
-  _descLabel->setString((selectedSkill) ? selectedSkill->getDesc() : "");
+  _descLayouts.setString((selectedSkill) ? selectedSkill->getDesc() : "");
 }
 
 void SkillListView::selectDown() {
@@ -110,7 +117,7 @@ void SkillListView::selectDown() {
   }
 
   Skill* selectedSkill = getSelectedObject();
-  _descLabel->setString((selectedSkill) ? selectedSkill->getDesc() : "");
+  _descLayouts.setString((selectedSkill) ? selectedSkill->getDesc() : "");
 }
 
 
@@ -119,7 +126,7 @@ void SkillListView::showSkillsByType(Skill::Type skillType) {
   setObjects(_pauseMenu->getPlayer()->getSkillBook()[skillType]);
 
   // Update description label.
-  _descLabel->setString((_objects.size() > 0) ? _objects[_current]->getDesc() : "");
+  _descLayouts.setString((_objects.size() > 0) ? _objects[_current]->getDesc() : "");
 }
 
 }  // namespace vigilante
@@ -6,6 +6,7 @@
 
 #include "skill/Skill.h"
 #include "ui/ListView.h"
+#include "ui/TextLayoutCache.h"
 
 namespace vigilante {
 
@@ -25,6 +26,7 @@ class SkillListView : public ListView<Skill*> {
  private:
   PauseMenu* _pauseMenu;
   cocos2d::Label* _descLabel;
+  TextLayoutCache _descLayouts;  // of _descLabel
 };
 
 }  // namespace vigilante
@@ -0,0 +1,262 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "PerformanceHud.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+
+#include "AssetManager.h"
+#include "CallbackManager.h"
+#include "gl/GpuTimer.h"
+#include "map/GameMap.h"
+#include "map/GameMapManager.h"
+#include "ui/Colorscheme.h"
+#include "util/AllocationTracker.h"
+#include "util/FrameBudget.h"
+#include "util/FrameProfiler.h"
+#include "util/LabelUtil.h"
+#include "util/StringUtil.h"
+
+#define NUM_GRAPH_FRAMES 120
+#define NUM_FPS_FRAMES 30
+#define LABEL_UPDATE_INTERVAL 15  // in frames
+#define TEXTURE_MEMORY_UPDATE_INTERVAL 60  // in frames, as it walks the whole TextureCache
+#define GRAPH_WIDTH 120
+#define GRAPH_HEIGHT 40
+#define GRAPH_MAX_FRAME_TIME 50.0f  // in milliseconds, the top of the graph
+#define TARGET_FRAME_TIME (1000.0f / 60.0f)  // in milliseconds
+#define OVERLAY_RIGHT_PADDING 10
+#define OVERLAY_TOP_PADDING 10
+#define NUM_ALLOCATION_ZONES 3  // the zones which allocate the most are listed
+
+using std::string;
+using cocos2d::Director;
+using cocos2d::DrawNode;
+using cocos2d::EventCustom;
+using cocos2d::EventListenerCustom;
+using cocos2d::Label;
+using cocos2d::Layer;
+using cocos2d::Color3B;
+using cocos2d::Color4F;
+using cocos2d::Vec2;
+
+namespace vigilante {
+
+PerformanceHud* PerformanceHud::getInstance() {
+  static PerformanceHud instance;
+  return &instance;
+}
+
+PerformanceHud::PerformanceHud()
+    : _layer(Layer::create()),
+      _label(label_util::create("", asset_manager::kRegularFont, asset_manager::kSmallFontSize)),
+      _graph(DrawNode::create()),
+      _afterDrawListener(),
+      _frameTimes(NUM_GRAPH_FRAMES),
+      _nextFrameTimeIndex(),
+      _labelUpdateTimer(),
+      _textureMemoryUpdateTimer(),
+      _isBudgetFlashOn(),
+      _numDrawCalls(),
+      _numDrawnVertices(),
+      _numTextures(),
+      _textureMemory() {
+  const auto& winSize = Director::getInstance()->getWinSize();
+  _layer->setPosition(winSize.width - GRAPH_WIDTH - OVERLAY_RIGHT_PADDING,
+                      winSize.height - GRAPH_HEIGHT - OVERLAY_TOP_PADDING);
+  _layer->setVisible(false);
+
+  _graph->setPosition(0, 0);
+  _layer->addChild(_graph);
+
+  _label->setAnchorPoint({0, 1});
+  _label->getFontAtlas()->setAliasTexParameters();
+  _label->setPosition(0, -4);
+  _layer->addChild(_label);
+}
+
+void PerformanceHud::update(const GameMapManager* gameMapManager) {
+  if (!_layer->isVisible()) {
+    return;
+  }
+
+  // This is the wall time of the last frame, rather than
+  // the one which the game has been stepped by.
+  _frameTimes[_nextFrameTimeIndex] = Director::getInstance()->getDeltaTime() * 1000.0f;
+  _nextFrameTimeIndex = (_nextFrameTimeIndex + 1) % _frameTimes.size();
+  updateGraph();
+
+  if (--_textureMemoryUpdateTimer <= 0) {
+    _textureMemoryUpdateTimer = TEXTURE_MEMORY_UPDATE_INTERVAL;
+    updateTextureMemory();
+  }
+  if (--_labelUpdateTimer <= 0) {
+    _labelUpdateTimer = LABEL_UPDATE_INTERVAL;
+    updateLabel(gameMapManager);
+  }
+}
+
+bool PerformanceHud::isVisible() const {
+  return _layer->isVisible();
+}
+
+void PerformanceHud::setVisible(bool visible) {
+  if (visible == _layer->isVisible()) {
+    return;
+  }
+
+  _layer->setVisible(visible);
+  FrameProfiler::getInstance()->setRecordingRequested(visible);
+  AllocationTracker::getInstance()->setEnabled(visible);
+  GpuTimer::getInstance()->setEnabled(visible);
+
+  // The renderer stats are only complete once the frame has been drawn,
+  // and they're cleared before the next one is.
+  auto eventDispatcher = Director::getInstance()->getEventDispatcher();
+  if (visible) {
+    _afterDrawListener = eventDispatcher->addCustomEventListener(
+        Director::EVENT_AFTER_DRAW, [this](EventCustom*) {
+      auto renderer = Director::getInstance()->getRenderer();
+      _numDrawCalls = renderer->getDrawnBatches();
+      _numDrawnVertices = renderer->getDrawnVertices();
+    });
+  } else {
+    eventDispatcher->removeEventListener(_afterDrawListener);
+    _afterDrawListener = nullptr;
+
+    std::fill(_frameTimes.begin(), _frameTimes.end(), 0);
+    _nextFrameTimeIndex = 0;
+    _labelUpdateTimer = 0;
+    _textureMemoryUpdateTimer = 0;
+    _graph->clear();
+    _label->setString("");
+  }
+}
+
+Layer* PerformanceHud::getLayer() const {
+  return _layer;
+}
+
+
+void PerformanceHud::updateGraph() {
+  _graph->clear();
+  _graph->drawSolidRect(Vec2::ZERO, Vec2(GRAPH_WIDTH, GRAPH_HEIGHT), Color4F(0, 0, 0, .5f));
+
+  // Oldest frames on the left. The frames slower than 60 fps are red.
+  const float barWidth = static_cast<float>(GRAPH_WIDTH) / _frameTimes.size();
+  for (size_t i = 0; i < _frameTimes.size(); i++) {
+    const float frameTime = _frameTimes[(_nextFrameTimeIndex + i) % _frameTimes.size()];
+    if (frameTime <= 0) {
+      continue;
+    }
+    const float height = std::min(frameTime / GRAPH_MAX_FRAME_TIME, 1.0f) * GRAPH_HEIGHT;
+    const Color4F color = (frameTime > TARGET_FRAME_TIME + 1.0f) ? Color4F::RED : Color4F::GREEN;
+    _graph->drawSolidRect(Vec2(i * barWidth, 0), Vec2((i + 1) * barWidth, height), color);
+  }
+
+  const float targetY = TARGET_FRAME_TIME / GRAPH_MAX_FRAME_TIME * GRAPH_HEIGHT;
+  _graph->drawLine(Vec2(0, targetY), Vec2(GRAPH_WIDTH, targetY), Color4F::WHITE);
+}
+
+void PerformanceHud::updateLabel(const GameMapManager* gameMapManager) {
+  float totalFrameTime = 0;
+  for (int i = 1; i <= NUM_FPS_FRAMES; i++) {
+    totalFrameTime += _frameTimes[(_nextFrameTimeIndex + _frameTimes.size() - i) % _frameTimes.size()];
+  }
+  const float fps = (totalFrameTime > 0) ? NUM_FPS_FRAMES * 1000.0f / totalFrameTime : 0;
+
+  // The medians of the FrameProfiler's samples. AI is a part of the GameMap update.
+  const FrameProfiler* profiler = FrameProfiler::getInstance();
+  const float physicsTime = profiler->getPercentile(FrameProfiler::Section::PHYSICS_STEP, 50) +
+                            profiler->getPercentile(FrameProfiler::Section::CONTACT_CALLBACKS, 50);
+  const float aiTime = profiler->getPercentile(FrameProfiler::Section::AI, 50);
+  const float gameMapTime = profiler->getPercentile(FrameProfiler::Section::GAME_MAP_UPDATE, 50);
+  float uiTime = 0;
+  for (const auto section : {FrameProfiler::Section::HUD,
+                             FrameProfiler::Section::FLOATING_DAMAGES,
+                             FrameProfiler::Section::NOTIFICATIONS,
+                             FrameProfiler::Section::QUEST_HINTS,
+                             FrameProfiler::Section::DIALOGUE_MANAGER,
+                             FrameProfiler::Section::CONSOLE,
+                             FrameProfiler::Section::WINDOW_MANAGER}) {
+    uiTime += profiler->getPercentile(section, 50);
+  }
+
+  string text = string_util::format("fps: %.1f\n", fps);
+  text += string_util::format("physics: %.2f ms, ai: %.2f ms\n", physicsTime, aiTime);
+  text += string_util::format("map: %.2f ms, ui: %.2f ms\n", gameMapTime, uiTime);
+  text += string_util::format("draw calls: %zd, verts: %zd\n", _numDrawCalls, _numDrawnVertices);
+
+  // The GPU time of a few frames ago, see GpuTimer.
+  const GpuTimer* gpuTimer = GpuTimer::getInstance();
+  if (!gpuTimer->isAvailable()) {
+    text += "gpu: n/a\n";
+  } else if (gpuTimer->getTime(GpuTimer::Pass::WORLD) >= 0) {
+    text += string_util::format("gpu: world %.2f ms, hud %.2f ms",
+                                gpuTimer->getTime(GpuTimer::Pass::WORLD),
+                                std::max(gpuTimer->getTime(GpuTimer::Pass::HUD), 0.0f));
+    if (gpuTimer->getTime(GpuTimer::Pass::DEBUG_DRAW) >= 0) {
+      text += string_util::format(", debug %.2f ms", gpuTimer->getTime(GpuTimer::Pass::DEBUG_DRAW));
+    }
+    text += "\n";
+  }
+  text += string_util::format("textures: %ld, %.1f MB\n", _numTextures, _textureMemory / 1024.0f);
+
+  if (const b2World* world = gameMapManager->getWorld()) {
+    text += string_util::format("bodies: %d, contacts: %d\n",
+                                world->GetBodyCount(), world->GetContactCount());
+  }
+  if (const GameMap* gameMap = gameMapManager->getGameMap()) {
+    const ActorRegistry& actors = gameMap->getDynamicActors();
+    text += string_util::format("actors: %zu (npcs: %zu, items: %zu)\n", actors.size(),
+                                actors.getGroup(ActorRegistry::Group::NPC).size(),
+                                actors.getGroup(ActorRegistry::Group::ITEM).size());
+  }
+  text += string_util::format("callbacks: %d", CallbackManager::getInstance()->getPendingCount());
+
+  // The allocations of the last frame, and the zones which made the most of them.
+  if (AllocationTracker::isAvailable()) {
+    const AllocationTracker::FrameStats& stats = AllocationTracker::getInstance()->getLastFrameStats();
+    text += string_util::format("\nallocs: %llu, %.1f KB, refs: %llu",
+                                static_cast<unsigned long long>(stats.total.allocationCount),
+                                stats.total.allocatedBytes / 1024.0f,
+                                static_cast<unsigned long long>(stats.total.refCount));
+    for (int i = 0; i < std::min(stats.numZones, NUM_ALLOCATION_ZONES); i++) {
+      text += string_util::format("\n  %s: %llu", stats.zones[i].name,
+                                  static_cast<unsigned long long>(stats.zones[i].allocationCount));
+    }
+  }
+
+  // The subsystems over their budgets are listed, and the label flashes.
+  const FrameBudget* frameBudget = FrameBudget::getInstance();
+  bool isOverBudget = false;
+  for (int i = 0; i < FrameBudget::Subsystem::SUBSYSTEM_SIZE; i++) {
+    const FrameBudget::Subsystem subsystem = static_cast<FrameBudget::Subsystem>(i);
+    if (frameBudget->isViolating(subsystem)) {
+      text += string_util::format("\nover budget: %s %.2f / %.2f ms",
+                                  FrameBudget::_kSubsystemStr[i].c_str(),
+                                  frameBudget->getAverage(subsystem),
+                                  frameBudget->getBudget(subsystem));
+      isOverBudget = true;
+    }
+  }
+  _isBudgetFlashOn = isOverBudget && !_isBudgetFlashOn;
+  _label->setColor((_isBudgetFlashOn) ? Color3B(colorscheme::kRed) : Color3B::WHITE);
+  _label->setString(text);
+}
+
+void PerformanceHud::updateTextureMemory() {
+  // TextureCache doesn't expose its textures, so parse the summary
+  // line of its debug info, i.e., "... N textures, for M KB (... MB)".
+  const string info = Director::getInstance()->getTextureCache()->getCachedTextureInfo();
+  const char* summary = std::strstr(info.c_str(), "dumpDebugInfo:");
+  if (!summary ||
+      std::sscanf(summary, "dumpDebugInfo: %ld textures, for %lu KB", &_numTextures, &_textureMemory) != 2) {
+    _numTextures = 0;
+    _textureMemory = 0;
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,62 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_PERFORMANCE_HUD_H_
+#define VIGILANTE_PERFORMANCE_HUD_H_
+
+#include <vector>
+
+#include <cocos2d.h>
+#include <2d/CCLabel.h>
+
+namespace vigilante {
+
+class GameMapManager;
+
+// An overlay for testers which shows the FPS, a graph of the recent
+// frame times, the ms spent in physics / AI / UI, the draw calls and
+// texture memory of the renderer, and the counts of b2Bodies, contacts,
+// DynamicActors and pending callbacks (see GameScene::handleInput()).
+// If the game is built with VIGILANTE_COUNT_ALLOCATIONS, the heap allocations
+// of the last frame are shown as well (see AllocationTracker). So is the time
+// which the GPU spent on each render pass, if it can be measured (see GpuTimer).
+//
+// While it's visible, the FrameProfiler keeps recording samples.
+class PerformanceHud final {
+ public:
+  static PerformanceHud* getInstance();
+  ~PerformanceHud() = default;
+
+  // Must be called every frame, even when the game is paused.
+  void update(const GameMapManager* gameMapManager);
+
+  bool isVisible() const;
+  void setVisible(bool visible);
+  cocos2d::Layer* getLayer() const;
+
+ private:
+  PerformanceHud();
+
+  void updateGraph();
+  void updateLabel(const GameMapManager* gameMapManager);
+  void updateTextureMemory();
+
+  cocos2d::Layer* _layer;
+  cocos2d::Label* _label;
+  cocos2d::DrawNode* _graph;
+  cocos2d::EventListenerCustom* _afterDrawListener;
+
+  std::vector<float> _frameTimes;  // ring buffer, in milliseconds
+  size_t _nextFrameTimeIndex;
+  int _labelUpdateTimer;  // in frames
+  int _textureMemoryUpdateTimer;  // in frames
+  bool _isBudgetFlashOn;  // toggled whenever the label is updated, see FrameBudget
+
+  // The renderer stats of the last drawn frame.
+  ssize_t _numDrawCalls;
+  ssize_t _numDrawnVertices;
+  long _numTextures;
+  unsigned long _textureMemory;  // in KB
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_PERFORMANCE_HUD_H_
@@ -2,6 +2,7 @@
 #include "QuestHints.h"
 
 #include "Constants.h"
+#include "EventBus.h"
 
 #define STARTING_X vigilante::kVirtualWidth / 2
 #define STARTING_Y vigilante::kVirtualHeight * .75f
@@ -21,6 +22,10 @@ QuestHints::QuestHints()
                         STARTING_Y,
                         MAX_LABEL_COUNT,
                         LABEL_LIFETIME,
-                        LABEL_ALIGNMENT) {}
+                        LABEL_ALIGNMENT) {
+  EventBus::getInstance()->subscribe<QuestProgressedEvent>([this](const QuestProgressedEvent& e) {
+    show(e.hint);
+  });
+}
 
 }  // namespace vigilante
@@ -6,6 +6,7 @@
 
 namespace vigilante {
 
+// Shows the hints of the QuestProgressedEvents (see EventBus).
 class QuestHints : public TimedLabelService {
  public:
   static QuestHints* getInstance();
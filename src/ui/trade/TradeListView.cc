@@ -10,6 +10,7 @@
 #include "ui/WindowManager.h"
 #include "ui/notifications/Notifications.h"
 #include "ui/trade/TradeWindow.h"
+#include "util/LabelUtil.h"
 #include "util/StringUtil.h"
 
 #define VISIBLE_ITEM_COUNT 5
@@ -21,6 +22,7 @@
 
 #define DESC_LABEL_X 5
 #define DESC_LABEL_Y -132
+#define SEARCH_FIELD_HEIGHT 12
 
 #define EMPTY_ITEM_ICON vigilante::asset_manager::kEmptyImage
 #define EMPTY_ITEM_NAME "---"
@@ -34,7 +36,10 @@ namespace vigilante {
 TradeListView::TradeListView(TradeWindow* tradeWindow)
     : ListView<Item*>(VISIBLE_ITEM_COUNT, WIDTH, HEIGHT, ITEM_GAP_HEIGHT, REGULAR_BG, HIGHLIGHTED_BG),
       _tradeWindow(tradeWindow),
-      _descLabel(Label::createWithTTF("", asset_manager::kRegularFont, asset_manager::kRegularFontSize)) {
+      _descLabel(label_util::create("", asset_manager::kRegularFont, asset_manager::kRegularFontSize)),
+      _descLayouts(_descLabel, asset_manager::kRegularFont, asset_manager::kRegularFontSize),
+      _query(),
+      _searchField() {
 
   // _setObjectCallback is called at the end of ListView<T>::ListViewItem::setObject()
   // see ui/ListView.h
@@ -60,11 +65,32 @@ TradeListView::TradeListView(TradeWindow* tradeWindow)
     }
   };
 
+  // The rows also have to be rebound when the amount changes,
+  // or when the price is shown / hidden.
+  _getObjectStateCallback = [this](Item* item) -> uint64_t {
+    const uint64_t isTradingWithAlly = _tradeWindow->isTradingWithAlly();
+    return (isTradingWithAlly << 32) | static_cast<uint32_t>(item->getAmount());
+  };
+
   _descLabel->getFontAtlas()->setAliasTexParameters();
   _descLabel->setAnchorPoint({0, 1});
   _descLabel->setPosition({DESC_LABEL_X, DESC_LABEL_Y});
   _descLabel->enableWrap(true);
   _layout->addChild(_descLabel);
+
+  // The search field takes the place of the description label while typing.
+  _searchField.getLayout()->setPosition({DESC_LABEL_X, DESC_LABEL_Y - SEARCH_FIELD_HEIGHT});
+  _searchField.getLayout()->setVisible(false);
+  _searchField.setOnChange([this]() {
+    _query.setFilter(_searchField.getString());
+    showQueryResults();
+  });
+  _searchField.setOnDismiss([this]() {
+    _searchField.setReceivingInput(false);
+    _searchField.getLayout()->setVisible(false);
+    _descLayouts.setVisible(true);
+  });
+  _layout->addChild(_searchField.getLayout());
 }
 
 
@@ -74,17 +100,14 @@ void TradeListView::confirm() {
     return;
   }
 
-  Character* seller = _tradeWindow->getSeller();
-  Character* buyer = _tradeWindow->getBuyer();
-
   if (item->getAmount() == 1) {
-    doTrade(buyer, seller, item, 1);
+    doTrade(item, 1);
 
   } else {
     auto w = std::make_unique<AmountSelectionWindow>();
     AmountSelectionWindow* wRaw = w.get();
 
-    auto onSubmit = [wRaw, this, buyer, seller, item]() {
+    auto onSubmit = [wRaw, this, item]() {
       const string& buf = wRaw->getTextField()->getString();
       int amount = 0;
 
@@ -98,7 +121,7 @@ void TradeListView::confirm() {
         Notifications::getInstance()->show("Unknown error while parsing amount");
       }
 
-      doTrade(buyer, seller, item, amount);
+      doTrade(item, amount);
     };
 
     auto onDismiss = []() {
@@ -123,7 +146,7 @@ void TradeListView::selectUp() {
 
   Item* selectedItem = getSelectedObject();
   assert(selectedItem != nullptr);
-  _descLabel->setString(selectedItem->getDesc());
+  _descLayouts.setString(selectedItem->getDesc());
 }
 
 void TradeListView::selectDown() {
@@ -135,52 +158,43 @@ void TradeListView::selectDown() {
 
   Item* selectedItem = getSelectedObject();
   assert(selectedItem != nullptr);
-  _descLabel->setString(selectedItem->getDesc());
+  _descLayouts.setString(selectedItem->getDesc());
 }
 
 
 void TradeListView::showCharactersItemByType(Character* owner, Item::Type itemType) {
   // Show the owner's items of the specified type.
-  setObjects(owner->getInventory()[itemType]);
-
-  // Update description label.
-  _descLabel->setString((_objects.size() > 0) ? _objects[_current]->getDesc() : "");
+  _query.setOwner(owner);
+  _query.setItemType(itemType);
+  showQueryResults();
 }
 
 
-void TradeListView::doTrade(Character* buyer,
-                            Character* seller,
-                            Item* item,
-                            const int amount) const {
-  if (amount <= 0) {
-    return;
-  }
+void TradeListView::cycleSortKey() {
+  _query.cycleSortKey();
+  showQueryResults();
+  Notifications::getInstance()->show("Sort by: " + _query.getSortKeyName());
+}
 
-  const int price = item_price_table::getPrice(item);
+void TradeListView::beginSearch() {
+  _descLayouts.setVisible(false);
+  _searchField.getLayout()->setVisible(true);
+  _searchField.setReceivingInput(true);
+}
 
-  // Check if `amount` is valid.
-  if (amount > item->getAmount()) {
-    Notifications::getInstance()->show("Invalid amount");
-    return;
-  }
+void TradeListView::showQueryResults() {
+  setObjects(_query.getResults());
 
-  if (!_tradeWindow->isTradingWithAlly()) {
-    // Check if the buyer has sufficient amount of gold.
-    if (buyer->getGoldBalance() < price * amount) {
-      Notifications::getInstance()->show("The buyer doesn't have sufficient amount of gold.");
-      return;
-    }
+  // Update description label.
+  _descLayouts.setString((_objects.size() > 0) ? _objects[_current]->getDesc() : "");
+}
 
-    // Transfer funds
-    if (!item->isGold()) {
-      buyer->removeGold(price * amount);
-      seller->addGold(price * amount);
-    }
-  }
 
-  // Transfer items
-  buyer->addItem(Item::create(item->getItemProfile().jsonFileName), amount);
-  seller->removeItem(item, amount);
+void TradeListView::doTrade(Item* item, const int amount) const {
+  if (amount <= 0) {
+    return;
+  }
+  _tradeWindow->trade({{item, amount}});
 }
 
 }  // namespace vigilante
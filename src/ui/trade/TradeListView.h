@@ -4,7 +4,10 @@
 
 #include "character/Character.h"
 #include "item/Item.h"
+#include "ui/InventoryQuery.h"
 #include "ui/ListView.h"
+#include "ui/TextField.h"
+#include "ui/TextLayoutCache.h"
 
 namespace vigilante {
 
@@ -22,14 +25,19 @@ class TradeListView : public ListView<Item*> {
 
   void showCharactersItemByType(Character* owner, Item::Type itemType);
 
+  // Sorts / searches the items shown by showCharactersItemByType().
+  void cycleSortKey();
+  void beginSearch();
+
  private:
-  void doTrade(Character* buyer,
-               Character* seller,
-               Item* item,
-               const int amount) const;
+  void showQueryResults();
+  void doTrade(Item* item, const int amount) const;
 
   TradeWindow* _tradeWindow;
   cocos2d::Label* _descLabel;
+  TextLayoutCache _descLayouts;  // of _descLabel
+  InventoryQuery _query;
+  TextField _searchField;
 };
 
 }  // namespace vigilante
@@ -1,10 +1,15 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "TradeWindow.h"
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "std/make_unique.h"
 #include "AssetManager.h"
 #include "character/Player.h"
+#include "gameplay/ItemPriceTable.h"
 #include "input/InputManager.h"
+#include "ui/notifications/Notifications.h"
 #include "util/StringUtil.h"
 
 #define TRADE_WINDOW_CONTENT_MARGIN_LEFT 10
@@ -12,6 +17,11 @@
 #define TRADE_WINDOW_CONTENT_MARGIN_TOP 30
 #define TRADE_WINDOW_CONTENT_MARGIN_BOTTOM 40
 
+using std::pair;
+using std::vector;
+using std::string;
+using std::shared_ptr;
+using std::unordered_map;
 using cocos2d::ui::Layout;
 using cocos2d::ui::ImageView;
 using cocos2d::EventKeyboard;
@@ -26,7 +36,8 @@ TradeWindow::TradeWindow(Character* buyer, Character* seller)
       _contentBackground(ImageView::create(kTradeBg)),
       _tabView(std::make_unique<TabView>(kTabRegular, kTabHighlighted)),
       _tradeListView(std::make_unique<TradeListView>(this)),
-      _isTradingWithAlly(seller->getAllies().find(buyer) != seller->getAllies().end()),
+      _isTradingWithAlly(std::find(seller->getAllies().begin(), seller->getAllies().end(), buyer) !=
+                         seller->getAllies().end()),
       _buyer(buyer),
       _seller(seller) {
   // Resize window: Make the window slightly larger than `_contentBackground`.
@@ -88,6 +99,10 @@ void TradeWindow::handleInput() {
     _tradeListView->selectUp();
   } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_DOWN_ARROW)) {
     _tradeListView->selectDown();
+  } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_S)) {
+    _tradeListView->cycleSortKey();
+  } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_F)) {
+    _tradeListView->beginSearch();
   } else if (IS_KEY_JUST_PRESSED(EventKeyboard::KeyCode::KEY_ENTER)) {
     _tradeListView->confirm();
   }
@@ -100,6 +115,89 @@ void TradeWindow::toggleBuySell() {
 }
 
 
+bool TradeWindow::trade(const TradeWindow::Basket& basket) {
+  // Validate the whole basket before touching any inventory.
+  unordered_map<AssetId, int> requestedAmounts;
+  int totalPrice = 0;
+
+  for (const auto& p : basket) {
+    Item* item = p.first;
+    const int amount = p.second;
+    if (!item || amount <= 0) {
+      Notifications::getInstance()->show("Invalid amount");
+      return false;
+    }
+
+    int& requestedAmount = requestedAmounts[item->getItemProfile().nameId];
+    requestedAmount += amount;
+    if (requestedAmount > _seller->getItemAmount(item->getItemProfile().nameId)) {
+      Notifications::getInstance()->show("Invalid amount");
+      return false;
+    }
+
+    if (!_isTradingWithAlly && !item->isGold()) {
+      totalPrice += item_price_table::getPrice(item) * amount;
+    }
+  }
+
+  if (basket.empty()) {
+    return false;
+  }
+
+  if (totalPrice > _buyer->getGoldBalance()) {
+    Notifications::getInstance()->show("The buyer doesn't have sufficient amount of gold.");
+    return false;
+  }
+
+  // Build the buyer's copies of the items before any of the seller's
+  // Item* gets deleted by removeItems().
+  vector<pair<shared_ptr<Item>, int>> boughtItems;
+  boughtItems.reserve(basket.size());
+  for (const auto& p : basket) {
+    boughtItems.push_back({Item::create(p.first->getItemProfile().jsonFileName), p.second});
+  }
+  const string firstItemName = basket.front().first->getName();
+
+  // Apply the transaction. The non-virtual calls skip Player's per-call
+  // notifications, since we'll show a single one for the whole basket below.
+  if (totalPrice > 0) {
+    shared_ptr<Item> gold = Item::create(asset_manager::kGoldCoin);
+    _buyer->Character::removeItems({{gold.get(), totalPrice}});
+    _seller->Character::addItems({{std::move(gold), totalPrice}});
+  }
+  _seller->Character::removeItems(basket);
+  _buyer->Character::addItems(boughtItems);
+
+  Player* player = dynamic_cast<Player*>(_buyer);
+  if (!player) {
+    player = dynamic_cast<Player*>(_seller);
+  }
+  if (player) {
+    for (const auto& p : boughtItems) {
+      player->getQuestBook().update(Quest::Objective::Type::COLLECT, p.first->getItemProfile().nameId);
+    }
+  }
+
+  const string itemsString = (basket.size() == 1) ?
+      string_util::format("%s (%d)", firstItemName.c_str(), basket.front().second) :
+      string_util::format("%d items", static_cast<int>(basket.size()));
+  const bool isPlayerBuyer = player && player == _buyer;
+
+  char buf[256];
+  if (_isTradingWithAlly) {
+    Notifications::getInstance()->show(string_util::formatTo(buf,
+        (isPlayerBuyer) ? "Received: %s." : "Gave: %s.", itemsString.c_str()));
+  } else {
+    Notifications::getInstance()->show(string_util::formatTo(buf,
+        (isPlayerBuyer) ? "Bought: %s for $%d." : "Sold: %s for $%d.", itemsString.c_str(), totalPrice));
+  }
+
+  // Rebuild the list view once, since the seller's items have changed.
+  update(0);
+  return true;
+}
+
+
 bool TradeWindow::isTradingWithAlly() const {
   return _isTradingWithAlly;
 }
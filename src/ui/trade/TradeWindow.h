@@ -3,6 +3,8 @@
 #define VIGILANTE_TRADE_WINDOW_H_
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <cocos2d.h>
 #include <ui/UIImageView.h>
@@ -16,6 +18,9 @@ namespace vigilante {
 
 class TradeWindow : public Window {
  public:
+  // The seller's items to be traded to the buyer, and their amounts.
+  using Basket = std::vector<std::pair<Item*, int>>;
+
   TradeWindow(Character* buyer, Character* seller);
   virtual ~TradeWindow() = default;
 
@@ -24,6 +29,12 @@ class TradeWindow : public Window {
 
   void toggleBuySell();
 
+  // Trades the whole `basket` from the seller to the buyer as one transaction.
+  // Either all items (and the total price) are transferred, or none of them
+  // are, in which case false is returned. Afterwards, the player's quests are
+  // updated and a notification is shown only once for the whole basket.
+  bool trade(const TradeWindow::Basket& basket);
+
   bool isTradingWithAlly() const;
   Character* getBuyer() const;
   Character* getSeller() const;
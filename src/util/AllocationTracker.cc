@@ -0,0 +1,171 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#include "util/MainThread.h"
+
+#define NO_ZONE_NAME "(no zone)"
+
+namespace {
+
+// Only trivially constructible, so that they can be used by operator new
+// at any time (e.g., during the static initialization, or a thread's exit).
+thread_local uint64_t threadAllocationCount;
+thread_local const char* currentZoneName;
+thread_local bool isAttributing;  // only the main thread, while it's enabled
+
+}  // namespace
+
+
+#if VIGILANTE_COUNT_ALLOCATIONS
+namespace {
+
+void* allocate(std::size_t size, bool isRef) noexcept {
+  ::threadAllocationCount++;
+  if (::isAttributing) {
+    vigilante::AllocationTracker::getInstance()->addAllocation(::currentZoneName, size, isRef);
+  }
+  return std::malloc(size ? size : 1);
+}
+
+}  // namespace
+
+// Replaces the global allocation functions, so that
+// every heap allocation on any thread is counted.
+void* operator new(std::size_t size) {
+  if (void* ptr = allocate(size, /*isRef=*/false)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size, /*isRef=*/true);
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+#endif  // VIGILANTE_COUNT_ALLOCATIONS
+
+
+namespace vigilante {
+
+const int AllocationTracker::_kMaxZones;
+
+AllocationTracker* AllocationTracker::getInstance() {
+  static AllocationTracker instance;
+  return &instance;
+}
+
+AllocationTracker::AllocationTracker()
+    : _zones(),
+      _total(),
+      _lastFrameStats(),
+      _isEnabled() {}
+
+
+bool AllocationTracker::isAvailable() {
+#if VIGILANTE_COUNT_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint64_t AllocationTracker::getThreadAllocationCount() {
+  return ::threadAllocationCount;
+}
+
+const char* AllocationTracker::enterZone(const char* name) {
+  const char* previousName = ::currentZoneName;
+  ::currentZoneName = name;
+  return previousName;
+}
+
+void AllocationTracker::leaveZone(const char* previousName) {
+  ::currentZoneName = previousName;
+}
+
+void AllocationTracker::endFrame() {
+  VGASSERT_MAIN_THREAD();
+  if (!_isEnabled) {
+    return;
+  }
+
+  // Sorting an std::array doesn't allocate, so this isn't counted in the next frame.
+  _lastFrameStats.total = _total;
+  _lastFrameStats.numZones = 0;
+  for (const auto& zoneStats : _zones) {
+    if (zoneStats.name) {
+      _lastFrameStats.zones[_lastFrameStats.numZones++] = zoneStats;
+    }
+  }
+  std::sort(_lastFrameStats.zones.begin(), _lastFrameStats.zones.begin() + _lastFrameStats.numZones,
+            [](const ZoneStats& a, const ZoneStats& b) {
+    return a.allocationCount > b.allocationCount;
+  });
+
+  _zones.fill({});
+  _total = {};
+}
+
+const AllocationTracker::FrameStats& AllocationTracker::getLastFrameStats() const {
+  return _lastFrameStats;
+}
+
+bool AllocationTracker::isEnabled() const {
+  return _isEnabled;
+}
+
+void AllocationTracker::setEnabled(bool enabled) {
+  VGASSERT_MAIN_THREAD();
+  _isEnabled = enabled && isAvailable();
+  ::isAttributing = _isEnabled;
+
+  _zones.fill({});
+  _total = {};
+  _lastFrameStats = {};
+}
+
+void AllocationTracker::addAllocation(const char* zoneName, size_t bytes, bool isRef) {
+  _total.allocationCount++;
+  _total.allocatedBytes += bytes;
+  _total.refCount += isRef;
+
+  if (ZoneStats* zoneStats = getZoneStats((zoneName) ? zoneName : NO_ZONE_NAME)) {
+    zoneStats->allocationCount++;
+    zoneStats->allocatedBytes += bytes;
+    zoneStats->refCount += isRef;
+  }
+}
+
+
+AllocationTracker::ZoneStats* AllocationTracker::getZoneStats(const char* zoneName) {
+  // The names are string literals, so they're compared by their addresses.
+  const size_t hash = reinterpret_cast<uintptr_t>(zoneName) >> 3;
+  for (int i = 0; i < _kMaxZones; i++) {
+    ZoneStats& zoneStats = _zones[(hash + i) % _kMaxZones];
+    if (zoneStats.name == zoneName) {
+      return &zoneStats;
+    }
+    if (!zoneStats.name) {
+      zoneStats.name = zoneName;
+      return &zoneStats;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace vigilante
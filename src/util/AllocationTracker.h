@@ -0,0 +1,78 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_ALLOCATION_TRACKER_H_
+#define VIGILANTE_ALLOCATION_TRACKER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace vigilante {
+
+// Counts the heap allocations made on each thread by replacing the global
+// operator new, and attributes those of the main thread to the innermost
+// trace zone which is active (see VGTRACE_ZONE), so that the allocations of
+// each frame can be tracked down to zero (see PerformanceHud).
+//
+// cocos2d::Ref has no creation hook, so the Refs created are approximated
+// by the nothrow allocations, which is how the create() functions of
+// cocos2d (and of this game) allocate them.
+//
+// Nothing is counted unless the game is built with VIGILANTE_COUNT_ALLOCATIONS
+// (see CMakeLists.txt). Even then, the allocations of the main thread are only
+// attributed while it's enabled (e.g., while the PerformanceHud is visible).
+class AllocationTracker final {
+ public:
+  struct ZoneStats final {
+    const char* name;  // the zone's name, or "(no zone)"
+    uint64_t allocationCount;
+    uint64_t allocatedBytes;
+    uint64_t refCount;  // nothrow allocations, see above
+  };
+
+  static const int _kMaxZones = 64;  // per frame, the rest are counted in `total` only
+
+  struct FrameStats final {
+    AllocationTracker::ZoneStats total;
+    std::array<AllocationTracker::ZoneStats, _kMaxZones> zones;  // sorted by allocationCount, descending
+    int numZones;
+  };
+
+  static AllocationTracker* getInstance();
+
+  // Returns true if the game is built with VIGILANTE_COUNT_ALLOCATIONS.
+  static bool isAvailable();
+
+  // The number of heap allocations made on the current thread since it started.
+  static uint64_t getThreadAllocationCount();
+
+  // Used by TraceProfiler::Zone. Returns the zone which was active before.
+  static const char* enterZone(const char* name);
+  static void leaveZone(const char* previousName);
+
+  // Must be called once per frame on the main thread, see GameScene::step().
+  void endFrame();
+  const AllocationTracker::FrameStats& getLastFrameStats() const;
+
+  // Must be called on the main thread.
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+
+  // Called by the allocation functions on the main thread while it's enabled.
+  // Doesn't allocate anything.
+  void addAllocation(const char* zoneName, size_t bytes, bool isRef);
+
+ private:
+  AllocationTracker();
+
+  AllocationTracker::ZoneStats* getZoneStats(const char* zoneName);
+
+  // The zones of the current frame (open addressing, keyed by the name pointers).
+  std::array<AllocationTracker::ZoneStats, _kMaxZones> _zones;
+  AllocationTracker::ZoneStats _total;
+  AllocationTracker::FrameStats _lastFrameStats;
+  bool _isEnabled;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_ALLOCATION_TRACKER_H_
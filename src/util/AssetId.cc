@@ -0,0 +1,53 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "AssetId.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+using std::deque;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::unordered_map;
+
+namespace vigilante {
+
+namespace {
+
+mutex stringTableMutex;
+
+// string -> value, and value -> string. The strings in a deque
+// never move, so getName() can return references to them.
+unordered_map<string, uint32_t> values;
+deque<string> names;
+
+}  // namespace
+
+AssetId::AssetId(const string& name) {
+  lock_guard<mutex> lock(stringTableMutex);
+  auto it = values.find(name);
+  if (it == values.end()) {
+    it = values.insert({name, static_cast<uint32_t>(names.size())}).first;
+    names.push_back(name);
+  }
+  _value = it->second;
+}
+
+
+const string& AssetId::getName() const {
+  static const string kEmptyName;
+  if (!isValid()) {
+    return kEmptyName;
+  }
+
+  lock_guard<mutex> lock(stringTableMutex);
+  return names[_value];
+}
+
+size_t AssetId::getCount() {
+  lock_guard<mutex> lock(stringTableMutex);
+  return names.size();
+}
+
+}  // namespace vigilante
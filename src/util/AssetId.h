@@ -0,0 +1,57 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_ASSET_ID_H_
+#define VIGILANTE_ASSET_ID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace vigilante {
+
+// An interned asset identifier, e.g., of a json file name or an item name.
+//
+// Each distinct string is assigned a dense integer (0, 1, 2, ...) in a
+// global string table the first time an AssetId is constructed from it,
+// so AssetIds can be compared and hashed as integers, or even be used as
+// vector indices. Strings should only be interned at the json boundary
+// (e.g., in the Profile constructors), and the AssetIds passed around
+// afterwards.
+//
+// Interning is thread-safe.
+class AssetId final {
+ public:
+  AssetId() : _value(_kInvalidValue) {}
+  explicit AssetId(const std::string& name);
+
+  bool operator==(const AssetId& other) const { return _value == other._value; }
+  bool operator!=(const AssetId& other) const { return _value != other._value; }
+
+  // Returns the interned string, or an empty string if this AssetId is invalid.
+  const std::string& getName() const;
+  uint32_t getValue() const { return _value; }
+  bool isValid() const { return _value != _kInvalidValue; }
+
+  // The number of interned strings, i.e., all valid values are less than this.
+  static size_t getCount();
+
+  static const uint32_t _kInvalidValue = UINT32_MAX;
+
+ private:
+  uint32_t _value;
+};
+
+}  // namespace vigilante
+
+namespace std {
+
+template <>
+struct hash<vigilante::AssetId> {
+  size_t operator()(const vigilante::AssetId& id) const {
+    return id.getValue();
+  }
+};
+
+}  // namespace std
+
+#endif  // VIGILANTE_ASSET_ID_H_
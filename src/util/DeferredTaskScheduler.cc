@@ -0,0 +1,51 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "DeferredTaskScheduler.h"
+
+#include <chrono>
+
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace vigilante {
+
+DeferredTaskScheduler* DeferredTaskScheduler::getInstance() {
+  static DeferredTaskScheduler instance;
+  return &instance;
+}
+
+DeferredTaskScheduler::DeferredTaskScheduler() : _tasks(), _queuedKeys() {}
+
+
+void DeferredTaskScheduler::post(const DeferredTaskScheduler::Task& task, const void* key) {
+  if (key && !_queuedKeys.insert(key).second) {
+    return;
+  }
+  _tasks.push_back({task, key});
+}
+
+void DeferredTaskScheduler::update(float timeBudget) {
+  const steady_clock::time_point beginTime = steady_clock::now();
+
+  while (!_tasks.empty()) {
+    // The task may post other tasks, so take it out of the queue first.
+    QueuedTask queuedTask = std::move(_tasks.front());
+    _tasks.pop_front();
+
+    if (queuedTask.task()) {
+      _queuedKeys.erase(queuedTask.key);
+    } else {
+      _tasks.push_back(std::move(queuedTask));
+    }
+
+    const duration<float> elapsed = steady_clock::now() - beginTime;
+    if (elapsed.count() >= timeBudget) {
+      break;
+    }
+  }
+}
+
+size_t DeferredTaskScheduler::getNumQueuedTasks() const {
+  return _tasks.size();
+}
+
+}  // namespace vigilante
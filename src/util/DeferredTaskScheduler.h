@@ -0,0 +1,50 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_DEFERRED_TASK_SCHEDULER_H_
+#define VIGILANTE_DEFERRED_TASK_SCHEDULER_H_
+
+#include <deque>
+#include <functional>
+#include <unordered_set>
+
+namespace vigilante {
+
+// Runs low-priority upkeep (e.g., relayouting the ControlHints, rebuilding
+// the PauseMenu, spawning the contents of a chest, see GameMap::createItems())
+// which doesn't have to finish in the frame it's requested.
+// update() is called at the end of GameScene::update(), and runs the queued
+// tasks in FIFO order until the time budget of the frame is used up.
+// The remaining tasks are carried over to the next frame.
+//
+// All methods must be called on the main thread.
+class DeferredTaskScheduler final {
+ public:
+  // Returns true if the task has finished, or false if it has more work
+  // to do, in which case it will be run again later (e.g., in the next frame).
+  using Task = std::function<bool ()>;
+
+  static DeferredTaskScheduler* getInstance();
+
+  // If `key` is specified, and a task with the same key is still queued,
+  // then `task` is dropped, i.e., repeated requests are coalesced.
+  void post(const DeferredTaskScheduler::Task& task, const void* key=nullptr);
+
+  // Runs at least one task, even if `timeBudget` (in seconds) is zero.
+  void update(float timeBudget);
+
+  size_t getNumQueuedTasks() const;
+
+ private:
+  struct QueuedTask final {
+    DeferredTaskScheduler::Task task;
+    const void* key;
+  };
+
+  DeferredTaskScheduler();
+
+  std::deque<DeferredTaskScheduler::QueuedTask> _tasks;
+  std::unordered_set<const void*> _queuedKeys;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_DEFERRED_TASK_SCHEDULER_H_
@@ -0,0 +1,76 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "std/make_unique.h"
+#include "util/MainThread.h"
+
+namespace vigilante {
+
+const size_t FrameArena::_kMinBlockSize = 64 * 1024;
+
+FrameArena* FrameArena::getInstance() {
+  static FrameArena instance;
+  return &instance;
+}
+
+FrameArena::FrameArena() : _blocks(), _currentBlockIndex(), _offset() {
+  _blocks.push_back({std::make_unique<char[]>(_kMinBlockSize), _kMinBlockSize});
+}
+
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+  VGASSERT_MAIN_THREAD();
+
+  while (true) {
+    Block& block = _blocks[_currentBlockIndex];
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    const uintptr_t p = (base + _offset + alignment - 1) & ~(alignment - 1);
+    if (p + size <= base + block.size) {
+      _offset = p + size - base;
+      return reinterpret_cast<void*>(p);
+    }
+
+    // Move on to the next block, or append a new one which is large enough.
+    if (++_currentBlockIndex == _blocks.size()) {
+      const size_t blockSize = std::max({_kMinBlockSize, block.size * 2, size + alignment});
+      _blocks.push_back({std::make_unique<char[]>(blockSize), blockSize});
+    }
+    _offset = 0;
+  }
+}
+
+void FrameArena::deallocate(void* p, size_t size) {
+  const Block& block = _blocks[_currentBlockIndex];
+  if (static_cast<char*>(p) + size == block.data.get() + _offset) {
+    _offset -= size;
+  }
+}
+
+void FrameArena::reset() {
+  VGASSERT_MAIN_THREAD();
+
+  if (_blocks.size() > 1) {
+    size_t totalSize = 0;
+    for (const auto& block : _blocks) {
+      totalSize += block.size;
+    }
+    _blocks.clear();
+    _blocks.push_back({std::make_unique<char[]>(totalSize), totalSize});
+  }
+  _currentBlockIndex = 0;
+  _offset = 0;
+}
+
+
+size_t FrameArena::getCapacity() const {
+  size_t capacity = 0;
+  for (const auto& block : _blocks) {
+    capacity += block.size;
+  }
+  return capacity;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,84 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_FRAME_ARENA_H_
+#define VIGILANTE_FRAME_ARENA_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace vigilante {
+
+// A bump allocator for the temporaries which don't outlive a frame
+// (e.g., the scratch containers of InventoryQuery::syncEntries()).
+// Everything allocated from it is released at once by reset(), which is
+// called at the end of each frame (see GameScene::step()), so nothing
+// allocated from it may be kept across frames.
+//
+// If a frame needs more than one block, the blocks are merged into one
+// large enough for that frame on reset(), so the arena quickly settles on
+// a single block and stops allocating from the heap altogether.
+//
+// All methods must be called on the main thread.
+class FrameArena final {
+ public:
+  static FrameArena* getInstance();
+
+  void* allocate(size_t size, size_t alignment);
+  // Only the latest allocation is actually given back (e.g., when a vector
+  // grows), the others are released by reset().
+  void deallocate(void* p, size_t size);
+  void reset();
+
+  size_t getCapacity() const;
+
+ private:
+  struct Block final {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  FrameArena();
+
+  static const size_t _kMinBlockSize;
+
+  std::vector<FrameArena::Block> _blocks;
+  size_t _currentBlockIndex;
+  size_t _offset;  // into the current block
+};
+
+
+// An STL-compatible allocator which allocates from the FrameArena.
+template <typename T>
+class FrameAllocator {
+ public:
+  using value_type = T;
+
+  FrameAllocator() noexcept = default;
+  template <typename U>
+  FrameAllocator(const FrameAllocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(FrameArena::getInstance()->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    FrameArena::getInstance()->deallocate(p, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const FrameAllocator<U>&) const noexcept { return true; }
+  template <typename U>
+  bool operator!=(const FrameAllocator<U>&) const noexcept { return false; }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+template <typename T>
+using FrameUnorderedSet = std::unordered_set<T, std::hash<T>, std::equal_to<T>, FrameAllocator<T>>;
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_FRAME_ARENA_H_
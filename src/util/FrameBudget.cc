@@ -0,0 +1,222 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "FrameBudget.h"
+
+#include <algorithm>
+
+#include "util/Logger.h"
+#include "util/StringUtil.h"
+
+using std::array;
+using std::string;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace vigilante {
+
+const array<string, FrameBudget::Subsystem::SUBSYSTEM_SIZE> FrameBudget::_kSubsystemStr = {{
+  "physics",
+  "ai",
+  "gameMap",
+  "ui"
+}};
+
+const array<float, FrameBudget::Subsystem::SUBSYSTEM_SIZE> FrameBudget::_kDefaultBudgets = {{
+  3.0f,  // physics
+  2.0f,  // ai
+  4.0f,  // gameMap, including ai
+  1.0f   // ui
+}};
+
+const int FrameBudget::_kReportCooldown = 300;  // 5 seconds at 60 fps
+
+FrameBudget::ScopedOffender::ScopedOffender(FrameBudget::Subsystem subsystem, const string& name)
+    : _subsystem(subsystem),
+      _name(name),
+      _isEnabled(FrameBudget::getInstance()->isEnabled()),
+      _beginTime() {
+  if (_isEnabled) {
+    _beginTime = steady_clock::now();
+  }
+}
+
+FrameBudget::ScopedOffender::~ScopedOffender() {
+  if (_isEnabled) {
+    duration<float, std::milli> elapsed = steady_clock::now() - _beginTime;
+    FrameBudget::getInstance()->addOffender(_subsystem, _name, elapsed.count());
+  }
+}
+
+
+FrameBudget* FrameBudget::getInstance() {
+  static FrameBudget instance;
+  return &instance;
+}
+
+FrameBudget::FrameBudget()
+    : _isEnabled(),
+      _budgets(_kDefaultBudgets),
+      _times(),
+      _nextTimeIndex(),
+      _numTimes(),
+      _reportCooldowns(),
+      _offenders() {
+#ifndef NDEBUG
+  setEnabled(true);
+#endif
+}
+
+
+void FrameBudget::endFrame() {
+  if (!_isEnabled) {
+    return;
+  }
+
+  for (int i = 0; i < Subsystem::SUBSYSTEM_SIZE; i++) {
+    const Subsystem subsystem = static_cast<Subsystem>(i);
+    _times[i][_nextTimeIndex] = getSectionTime(subsystem);
+
+    if (_reportCooldowns[i] > 0) {
+      _reportCooldowns[i]--;
+    } else if (_numTimes == _kWindowSize && getAverage(subsystem) > _budgets[i]) {
+      report(subsystem);
+      _reportCooldowns[i] = _kReportCooldown;
+    }
+  }
+
+  _nextTimeIndex = (_nextTimeIndex + 1) % _kWindowSize;
+  _numTimes = std::min(_numTimes + 1, _kWindowSize);
+
+  // The offenders are those of the last window only.
+  if (_nextTimeIndex == 0) {
+    for (auto& offenders : _offenders) {
+      offenders.fill({});
+    }
+  }
+}
+
+bool FrameBudget::isViolating(FrameBudget::Subsystem subsystem) const {
+  return _isEnabled && _reportCooldowns[subsystem] > 0;
+}
+
+float FrameBudget::getAverage(FrameBudget::Subsystem subsystem) const {
+  if (_numTimes == 0) {
+    return 0;
+  }
+  float totalTime = 0;
+  for (int i = 0; i < _numTimes; i++) {
+    totalTime += _times[subsystem][i];
+  }
+  return totalTime / _numTimes;
+}
+
+
+bool FrameBudget::isEnabled() const {
+  return _isEnabled;
+}
+
+void FrameBudget::setEnabled(bool enabled) {
+  if (enabled == _isEnabled) {
+    return;
+  }
+
+  _isEnabled = enabled;
+  FrameProfiler::getInstance()->setRecordingRequested(enabled);
+
+  for (auto& times : _times) {
+    times.fill(0);
+  }
+  _nextTimeIndex = 0;
+  _numTimes = 0;
+  _reportCooldowns.fill(0);
+  for (auto& offenders : _offenders) {
+    offenders.fill({});
+  }
+}
+
+float FrameBudget::getBudget(FrameBudget::Subsystem subsystem) const {
+  return _budgets[subsystem];
+}
+
+void FrameBudget::setBudget(FrameBudget::Subsystem subsystem, float budget) {
+  _budgets[subsystem] = budget;
+  _reportCooldowns[subsystem] = 0;
+}
+
+FrameBudget::Subsystem FrameBudget::getSubsystem(const string& name) {
+  for (int i = 0; i < Subsystem::SUBSYSTEM_SIZE; i++) {
+    if (_kSubsystemStr[i] == name) {
+      return static_cast<Subsystem>(i);
+    }
+  }
+  return Subsystem::SUBSYSTEM_SIZE;
+}
+
+
+void FrameBudget::addOffender(FrameBudget::Subsystem subsystem, const string& name, float ms) {
+  // Insertion sort into the few longest ones, which are kept sorted in descending order.
+  array<Offender, _kNumOffenders>& offenders = _offenders[subsystem];
+  for (int i = 0; i < _kNumOffenders; i++) {
+    if (offenders[i].name == name) {
+      if (ms <= offenders[i].time) {
+        return;
+      }
+      offenders[i].time = ms;
+      for (; i > 0 && offenders[i].time > offenders[i - 1].time; i--) {
+        std::swap(offenders[i], offenders[i - 1]);
+      }
+      return;
+    }
+  }
+
+  if (ms <= offenders.back().time) {
+    return;
+  }
+  offenders.back() = {name, ms};
+  for (int i = _kNumOffenders - 1; i > 0 && offenders[i].time > offenders[i - 1].time; i--) {
+    std::swap(offenders[i], offenders[i - 1]);
+  }
+}
+
+void FrameBudget::report(FrameBudget::Subsystem subsystem) {
+  string offendersStr;
+  for (const auto& offender : _offenders[subsystem]) {
+    if (offender.time > 0) {
+      offendersStr += string_util::format("%s%s (%.2f ms)", (offendersStr.empty()) ? "" : ", ",
+                                          offender.name.c_str(), offender.time);
+    }
+  }
+
+  VGLOG(LOG_WARN, "Frame budget exceeded: %s took %.2f ms > %.2f ms on average over %d frames%s%s",
+        _kSubsystemStr[subsystem].c_str(), getAverage(subsystem), _budgets[subsystem], _kWindowSize,
+        (offendersStr.empty()) ? "" : ", top offenders: ", offendersStr.c_str());
+}
+
+float FrameBudget::getSectionTime(FrameBudget::Subsystem subsystem) const {
+  const FrameProfiler* profiler = FrameProfiler::getInstance();
+  switch (subsystem) {
+    case Subsystem::PHYSICS:
+      return profiler->getLastFrameTime(FrameProfiler::Section::PHYSICS_STEP) +
+             profiler->getLastFrameTime(FrameProfiler::Section::CONTACT_CALLBACKS);
+    case Subsystem::AI:
+      return profiler->getLastFrameTime(FrameProfiler::Section::AI);
+    case Subsystem::GAME_MAP:
+      return profiler->getLastFrameTime(FrameProfiler::Section::GAME_MAP_UPDATE);
+    case Subsystem::UI: {
+      float time = 0;
+      for (const auto section : {FrameProfiler::Section::HUD,
+                                 FrameProfiler::Section::FLOATING_DAMAGES,
+                                 FrameProfiler::Section::NOTIFICATIONS,
+                                 FrameProfiler::Section::QUEST_HINTS,
+                                 FrameProfiler::Section::DIALOGUE_MANAGER,
+                                 FrameProfiler::Section::CONSOLE,
+                                 FrameProfiler::Section::WINDOW_MANAGER}) {
+        time += profiler->getLastFrameTime(section);
+      }
+      return time;
+    }
+    default:
+      return 0;
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,103 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_FRAME_BUDGET_H_
+#define VIGILANTE_FRAME_BUDGET_H_
+
+#include <array>
+#include <chrono>
+#include <string>
+
+#include "util/FrameProfiler.h"
+
+namespace vigilante {
+
+// The performance contracts of the subsystems, e.g., physics <= 3 ms,
+// AI <= 2 ms and UI <= 1 ms per frame.
+//
+// The timings are taken from the FrameProfiler sections of each subsystem
+// once the frame has ended (see GameScene::step()), and averaged over the
+// last _kWindowSize frames. Whenever a subsystem's average exceeds its
+// budget, it's logged as a warning (at most once per _kReportCooldown frames)
+// along with the top offenders of the window, i.e., the specific Npcs or
+// Windows which took the longest (see ScopedOffender), and it flashes in
+// the PerformanceHud.
+//
+// The budgets are enforced by default in debug builds only (i.e., unless
+// NDEBUG is defined), since the FrameProfiler has to keep recording.
+// See also the "frameBudget" console command.
+//
+// All methods must be called on the main thread.
+class FrameBudget final {
+ public:
+  enum Subsystem {
+    PHYSICS,
+    AI,
+    GAME_MAP,
+    UI,
+    SUBSYSTEM_SIZE
+  };
+
+  // Attributes the time elapsed between its construction and destruction
+  // to `name` (e.g., an Npc's name) in the specified subsystem.
+  // `name` must outlive this object.
+  class ScopedOffender final {
+   public:
+    ScopedOffender(FrameBudget::Subsystem subsystem, const std::string& name);
+    ~ScopedOffender();
+
+   private:
+    FrameBudget::Subsystem _subsystem;
+    const std::string& _name;
+    bool _isEnabled;
+    std::chrono::steady_clock::time_point _beginTime;
+  };
+
+  static FrameBudget* getInstance();
+
+  // Called after FrameProfiler::endFrame().
+  void endFrame();
+
+  // Returns true if `subsystem` has exceeded its budget recently.
+  bool isViolating(FrameBudget::Subsystem subsystem) const;
+  // Returns the average time (in milliseconds) of `subsystem` over the window.
+  float getAverage(FrameBudget::Subsystem subsystem) const;
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+  float getBudget(FrameBudget::Subsystem subsystem) const;  // in milliseconds
+  void setBudget(FrameBudget::Subsystem subsystem, float budget);
+
+  // Returns SUBSYSTEM_SIZE if there's no subsystem named `name`.
+  static FrameBudget::Subsystem getSubsystem(const std::string& name);
+  static const std::array<std::string, Subsystem::SUBSYSTEM_SIZE> _kSubsystemStr;
+
+ private:
+  struct Offender final {
+    std::string name;
+    float time;  // in milliseconds, the longest within a frame
+  };
+
+  static const int _kWindowSize = 60;  // in frames
+  static const int _kReportCooldown;  // in frames
+  static const int _kNumOffenders = 3;
+  static const std::array<float, Subsystem::SUBSYSTEM_SIZE> _kDefaultBudgets;
+
+  FrameBudget();
+
+  void addOffender(FrameBudget::Subsystem subsystem, const std::string& name, float ms);
+  void report(FrameBudget::Subsystem subsystem);
+  float getSectionTime(FrameBudget::Subsystem subsystem) const;
+
+  bool _isEnabled;
+  std::array<float, Subsystem::SUBSYSTEM_SIZE> _budgets;
+  std::array<std::array<float, _kWindowSize>, Subsystem::SUBSYSTEM_SIZE> _times;  // ring buffers
+  size_t _nextTimeIndex;
+  int _numTimes;
+  // The frames left until the subsystem may be reported again. It's still
+  // violating the budget (and shown as such) while this is positive.
+  std::array<int, Subsystem::SUBSYSTEM_SIZE> _reportCooldowns;
+  std::array<std::array<FrameBudget::Offender, _kNumOffenders>, Subsystem::SUBSYSTEM_SIZE> _offenders;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_FRAME_BUDGET_H_
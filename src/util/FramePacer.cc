@@ -0,0 +1,105 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <cocos2d.h>
+#include "Constants.h"
+#include "util/Headless.h"
+#include "util/Logger.h"
+
+#define DEFAULT_REFRESH_RATE 60.0f
+#define HEADLESS_FPS 1000.0f  // nothing is presented, so the frames are run back to back
+
+using cocos2d::Director;
+
+namespace vigilante {
+
+const float FramePacer::_kIdleFps = 20.0f;
+const float FramePacer::_kBatterySaverFps = 30.0f;
+
+FramePacer* FramePacer::getInstance() {
+  static FramePacer instance;
+  return &instance;
+}
+
+FramePacer::FramePacer()
+    : _activity(Activity::ACTIVE),
+      _isBatterySaverEnabled(),
+      _refreshRate(DEFAULT_REFRESH_RATE),
+      _targetFps() {}
+
+void FramePacer::init() {
+  // cocos2d-x doesn't expose the refresh rate on mobile,
+  // where it happens to be 60 Hz on most devices anyway.
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32) || (CC_TARGET_PLATFORM == CC_PLATFORM_MAC) || (CC_TARGET_PLATFORM == CC_PLATFORM_LINUX)
+  if (GLFWmonitor* monitor = glfwGetPrimaryMonitor()) {
+    const GLFWvidmode* videoMode = glfwGetVideoMode(monitor);
+    if (videoMode && videoMode->refreshRate > 0) {
+      _refreshRate = static_cast<float>(videoMode->refreshRate);
+    }
+  }
+#endif
+  VGLOG(LOG_INFO, "Display refresh rate: %.0f Hz", _refreshRate);
+  apply();
+}
+
+void FramePacer::setActivity(FramePacer::Activity activity) {
+  if (activity != _activity) {
+    _activity = activity;
+    apply();
+  }
+}
+
+bool FramePacer::isBatterySaverEnabled() const {
+  return _isBatterySaverEnabled;
+}
+
+void FramePacer::setBatterySaverEnabled(bool enabled) {
+  if (enabled != _isBatterySaverEnabled) {
+    _isBatterySaverEnabled = enabled;
+    apply();
+  }
+}
+
+float FramePacer::getPhysicsTimeStep() const {
+  return (_isBatterySaverEnabled) ? 2 * kFixedTimeStep : kFixedTimeStep;
+}
+
+float FramePacer::getRefreshRate() const {
+  return _refreshRate;
+}
+
+float FramePacer::getTargetFps() const {
+  return _targetFps;
+}
+
+
+float FramePacer::getPacedFps(float fps) const {
+  const int divisor = std::max(1, static_cast<int>(std::round(_refreshRate / fps)));
+  return _refreshRate / divisor;
+}
+
+void FramePacer::apply() {
+  if (headless::isEnabled()) {
+    if (_targetFps != HEADLESS_FPS) {
+      _targetFps = HEADLESS_FPS;
+      Director::getInstance()->setAnimationInterval(1.0f / _targetFps);
+    }
+    return;
+  }
+
+  float fps = (_isBatterySaverEnabled) ? _kBatterySaverFps : kFps;
+  if (_activity == Activity::IDLE) {
+    fps = std::min(fps, _kIdleFps);
+  }
+
+  const float targetFps = getPacedFps(fps);
+  if (targetFps != _targetFps) {
+    _targetFps = targetFps;
+    Director::getInstance()->setAnimationInterval(1.0f / _targetFps);
+  }
+}
+
+}  // namespace vigilante
@@ -0,0 +1,60 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_FRAME_PACER_H_
+#define VIGILANTE_FRAME_PACER_H_
+
+namespace vigilante {
+
+// Picks the Director's animation interval for the current frame:
+// - ACTIVE: kFps, or 30 fps in battery saver mode.
+// - IDLE: the world is paused (e.g., the pause menu, a dialogue, or a window
+//         is shown), so only the UI has to be redrawn, at a much lower rate.
+//
+// Each rate is rounded to a divisor of the display's refresh rate
+// (e.g., 72 fps on a 144 Hz display instead of 60 fps), so that every frame
+// is shown for the same number of vblanks.
+//
+// In battery saver mode, the b2World is also stepped half as often, by twice
+// the fixed time step (see getPhysicsTimeStep()), unless a replay or a benchmark
+// is running, which must always be stepped by kFixedTimeStep.
+//
+// All methods must be called on the main thread.
+class FramePacer final {
+ public:
+  enum class Activity {
+    ACTIVE,
+    IDLE
+  };
+
+  static FramePacer* getInstance();
+
+  // Queries the display's refresh rate and applies the ACTIVE rate.
+  // Must be called after the Director's GLView has been created.
+  void init();
+  void setActivity(FramePacer::Activity activity);
+
+  bool isBatterySaverEnabled() const;
+  void setBatterySaverEnabled(bool enabled);
+
+  float getPhysicsTimeStep() const;
+  float getRefreshRate() const;
+  float getTargetFps() const;
+
+ private:
+  FramePacer();
+
+  // Rounds `fps` to the nearest divisor of the display's refresh rate.
+  float getPacedFps(float fps) const;
+  void apply();
+
+  static const float _kIdleFps;
+  static const float _kBatterySaverFps;
+
+  FramePacer::Activity _activity;
+  bool _isBatterySaverEnabled;
+  float _refreshRate;
+  float _targetFps;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_FRAME_PACER_H_
@@ -0,0 +1,230 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "AssetManager.h"
+#include "util/LabelUtil.h"
+#include "util/StatsUtil.h"
+#include "util/StringUtil.h"
+#include "util/Logger.h"
+
+#define MAX_SAMPLE_COUNT 300  // 5 seconds at 60 fps
+#define OVERLAY_UPDATE_INTERVAL 30  // in frames
+#define OVERLAY_X 10
+#define OVERLAY_Y 290
+
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using cocos2d::Label;
+using cocos2d::Layer;
+using cocos2d::Vec2;
+
+namespace vigilante {
+
+const std::array<string, FrameProfiler::Section::SECTION_SIZE> FrameProfiler::_kSectionStr = {{
+  "frame",
+  "physicsStep",
+  "contactCallbacks",
+  "gameMapUpdate",
+  "hud",
+  "floatingDamages",
+  "notifications",
+  "questHints",
+  "dialogueManager",
+  "console",
+  "windowManager",
+  "questEvents",
+  "ai"
+}};
+
+FrameProfiler::ScopedTimer::ScopedTimer(FrameProfiler::Section section)
+    : _section(section),
+      _isEnabled(FrameProfiler::getInstance()->isRecording()),
+      _beginTime() {
+  if (_isEnabled) {
+    _beginTime = steady_clock::now();
+  }
+}
+
+FrameProfiler::ScopedTimer::~ScopedTimer() {
+  if (_isEnabled) {
+    duration<float, std::milli> elapsed = steady_clock::now() - _beginTime;
+    FrameProfiler::getInstance()->addTime(_section, elapsed.count());
+  }
+}
+
+
+FrameProfiler* FrameProfiler::getInstance() {
+  static FrameProfiler instance;
+  return &instance;
+}
+
+FrameProfiler::FrameProfiler()
+    : _isEnabled(),
+      _numRecordingRequests(),
+      _currentSample(),
+      _samples(MAX_SAMPLE_COUNT),
+      _nextSampleIndex(),
+      _numSamples(),
+      _contactCallbackStats(),
+      _layer(Layer::create()),
+      _label(label_util::create("", asset_manager::kRegularFont, asset_manager::kSmallFontSize)),
+      _overlayUpdateTimer() {
+  _label->setAnchorPoint({0, 1});
+  _label->getFontAtlas()->setAliasTexParameters();
+  _layer->setPosition(OVERLAY_X, OVERLAY_Y);
+  _layer->setVisible(false);
+  _layer->addChild(_label);
+}
+
+
+void FrameProfiler::beginFrame() {
+  _currentSample = {};
+}
+
+void FrameProfiler::endFrame(const b2World* world) {
+  if (!isRecording()) {
+    return;
+  }
+
+  _currentSample.bodyCount = world->GetBodyCount();
+  _currentSample.contactCount = world->GetContactCount();
+  _currentSample.proxyCount = world->GetProxyCount();
+
+  _samples[_nextSampleIndex] = _currentSample;
+  _nextSampleIndex = (_nextSampleIndex + 1) % _samples.size();
+  _numSamples = std::min(_numSamples + 1, _samples.size());
+
+  if (_isEnabled && ++_overlayUpdateTimer >= OVERLAY_UPDATE_INTERVAL) {
+    _overlayUpdateTimer = 0;
+    updateOverlay();
+  }
+}
+
+
+void FrameProfiler::addTime(FrameProfiler::Section section, float ms) {
+  _currentSample.times[section] += ms;
+}
+
+void FrameProfiler::addContactCallbackTime(int categoryIndexA, int categoryIndexB, float ms) {
+  // The pairs are unordered, so always accumulate into the upper triangle.
+  if (categoryIndexA > categoryIndexB) {
+    std::swap(categoryIndexA, categoryIndexB);
+  }
+  ContactCallbackStats& stats = _contactCallbackStats[categoryIndexA][categoryIndexB];
+  stats.totalTime += ms;
+  stats.count++;
+  _currentSample.times[Section::CONTACT_CALLBACKS] += ms;
+}
+
+float FrameProfiler::getPercentile(FrameProfiler::Section section, float percentile) const {
+  vector<float> times(_numSamples);
+  for (size_t i = 0; i < _numSamples; i++) {
+    times[i] = _samples[i].times[section];
+  }
+  return stats_util::getPercentile(std::move(times), percentile);
+}
+
+float FrameProfiler::getLastFrameTime(FrameProfiler::Section section) const {
+  if (_numSamples == 0) {
+    return 0;
+  }
+  return _samples[(_nextSampleIndex + _samples.size() - 1) % _samples.size()].times[section];
+}
+
+bool FrameProfiler::dumpCsv(const string& fileName) const {
+  ofstream fout(fileName, std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_ERR, "Unable to write profiler samples to: %s", fileName.c_str());
+    return false;
+  }
+
+  for (const auto& sectionStr : _kSectionStr) {
+    fout << sectionStr << ',';
+  }
+  fout << "bodyCount,contactCount,proxyCount" << '\n';
+
+  // Oldest samples first.
+  const size_t firstSampleIndex = (_numSamples < _samples.size()) ? 0 : _nextSampleIndex;
+  for (size_t i = 0; i < _numSamples; i++) {
+    const Sample& sample = _samples[(firstSampleIndex + i) % _samples.size()];
+    for (const auto time : sample.times) {
+      fout << time << ',';
+    }
+    fout << sample.bodyCount << ',' << sample.contactCount << ',' << sample.proxyCount << '\n';
+  }
+
+  fout << '\n' << "categoryBitsA,categoryBitsB,totalTime,count" << '\n';
+  for (int a = 0; a < _kNumCategories; a++) {
+    for (int b = a; b < _kNumCategories; b++) {
+      const ContactCallbackStats& stats = _contactCallbackStats[a][b];
+      if (stats.count > 0) {
+        fout << (1 << a) << ',' << (1 << b) << ',' << stats.totalTime << ',' << stats.count << '\n';
+      }
+    }
+  }
+  return true;
+}
+
+
+bool FrameProfiler::isEnabled() const {
+  return _isEnabled;
+}
+
+void FrameProfiler::setEnabled(bool enabled) {
+  _isEnabled = enabled;
+  _layer->setVisible(enabled);
+  _overlayUpdateTimer = 0;
+  _label->setString("");
+
+  if (!isRecording()) {
+    resetSamples();
+  }
+}
+
+void FrameProfiler::setRecordingRequested(bool isRecordingRequested) {
+  _numRecordingRequests = std::max(0, _numRecordingRequests + ((isRecordingRequested) ? 1 : -1));
+
+  if (!isRecording()) {
+    resetSamples();
+  }
+}
+
+bool FrameProfiler::isRecording() const {
+  return _isEnabled || _numRecordingRequests > 0;
+}
+
+Layer* FrameProfiler::getLayer() const {
+  return _layer;
+}
+
+
+void FrameProfiler::updateOverlay() {
+  string text = "section: p50 / p95 / p99 (ms)\n";
+  for (int i = 0; i < Section::SECTION_SIZE; i++) {
+    const Section section = static_cast<Section>(i);
+    text += string_util::format("%s: %.2f / %.2f / %.2f\n", _kSectionStr[i].c_str(),
+                                getPercentile(section, 50),
+                                getPercentile(section, 95),
+                                getPercentile(section, 99));
+  }
+
+  const size_t lastSampleIndex = (_nextSampleIndex + _samples.size() - 1) % _samples.size();
+  const Sample& sample = _samples[lastSampleIndex];
+  text += string_util::format("bodies: %d, contacts: %d, proxies: %d",
+                              sample.bodyCount, sample.contactCount, sample.proxyCount);
+  _label->setString(text);
+}
+
+void FrameProfiler::resetSamples() {
+  _nextSampleIndex = 0;
+  _numSamples = 0;
+  _contactCallbackStats = {};
+}
+
+}  // namespace vigilante
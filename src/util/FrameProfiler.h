@@ -0,0 +1,119 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_FRAME_PROFILER_H_
+#define VIGILANTE_FRAME_PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <cocos2d.h>
+#include <Box2D/Box2D.h>
+
+namespace vigilante {
+
+// Records how long each part of GameScene::update() takes per frame,
+// as well as the b2World's body/contact/proxy counts. The samples of the
+// last few seconds are kept in a ring buffer, from which the rolling
+// percentiles are computed and shown in an overlay.
+//
+// Nothing is recorded unless the profiler is enabled (see GameScene::handleInput()),
+// or the recording has been requested by the PerformanceHud.
+class FrameProfiler final {
+ public:
+  enum Section {
+    FRAME,
+    PHYSICS_STEP,
+    CONTACT_CALLBACKS,
+    GAME_MAP_UPDATE,
+    HUD,
+    FLOATING_DAMAGES,
+    NOTIFICATIONS,
+    QUEST_HINTS,
+    DIALOGUE_MANAGER,
+    CONSOLE,
+    WINDOW_MANAGER,
+    QUEST_EVENTS,
+    AI,
+    SECTION_SIZE
+  };
+
+  // Adds the time elapsed between its construction and destruction
+  // to the specified section of the current frame.
+  class ScopedTimer final {
+   public:
+    explicit ScopedTimer(FrameProfiler::Section section);
+    ~ScopedTimer();
+
+   private:
+    FrameProfiler::Section _section;
+    bool _isEnabled;
+    std::chrono::steady_clock::time_point _beginTime;
+  };
+
+  static FrameProfiler* getInstance();
+
+  void beginFrame();
+  void endFrame(const b2World* world);
+
+  void addTime(FrameProfiler::Section section, float ms);
+  void addContactCallbackTime(int categoryIndexA, int categoryIndexB, float ms);
+
+  // Returns the `percentile`-th (0~100) percentile of the recorded
+  // timings (in milliseconds) of `section`.
+  float getPercentile(FrameProfiler::Section section, float percentile) const;
+  // Returns the timing (in milliseconds) of `section` in the last recorded frame.
+  float getLastFrameTime(FrameProfiler::Section section) const;
+
+  // Writes all recorded samples, followed by the accumulated
+  // contact callback timings of each pair of categories.
+  bool dumpCsv(const std::string& fileName) const;
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+  // Records the samples without showing the overlay. The requests of different
+  // users (e.g., PerformanceHud and FrameBudget) are counted, and each
+  // setRecordingRequested(true) must be paired with a setRecordingRequested(false).
+  void setRecordingRequested(bool isRecordingRequested);
+  bool isRecording() const;
+  cocos2d::Layer* getLayer() const;
+
+  static const int _kNumCategories = 16;
+
+ private:
+  struct Sample final {
+    std::array<float, Section::SECTION_SIZE> times;  // in milliseconds
+    int bodyCount;
+    int contactCount;
+    int proxyCount;
+  };
+
+  struct ContactCallbackStats final {
+    float totalTime;  // in milliseconds
+    int count;
+  };
+
+  FrameProfiler();
+
+  void updateOverlay();
+  void resetSamples();
+
+  static const std::array<std::string, Section::SECTION_SIZE> _kSectionStr;
+
+  bool _isEnabled;
+  int _numRecordingRequests;
+  FrameProfiler::Sample _currentSample;
+  std::vector<FrameProfiler::Sample> _samples;  // ring buffer
+  size_t _nextSampleIndex;
+  size_t _numSamples;
+  std::array<std::array<FrameProfiler::ContactCallbackStats, _kNumCategories>, _kNumCategories>
+    _contactCallbackStats;
+
+  cocos2d::Layer* _layer;
+  cocos2d::Label* _label;
+  int _overlayUpdateTimer;  // in frames
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_FRAME_PROFILER_H_
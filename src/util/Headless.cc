@@ -0,0 +1,58 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "Headless.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "util/Logger.h"
+
+using std::string;
+using std::vector;
+
+namespace vigilante {
+
+namespace headless {
+
+namespace {
+
+bool isHeadless = false;
+vector<string> commands;
+float duration = 0;
+
+}  // namespace
+
+void init(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      isHeadless = true;
+    } else if (std::strcmp(argv[i], "--exec") == 0 && i + 1 < argc) {
+      commands.push_back(argv[++i]);
+    } else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+      duration = std::max(0.0f, std::strtof(argv[++i], nullptr));
+    }
+  }
+
+  if (!isHeadless) {
+    commands.clear();
+    duration = 0;
+    return;
+  }
+  VGLOG(LOG_INFO, "Running headless: %zu commands, duration=%.0f s", commands.size(), duration);
+}
+
+bool isEnabled() {
+  return isHeadless;
+}
+
+const vector<string>& getCommands() {
+  return commands;
+}
+
+float getDuration() {
+  return duration;
+}
+
+}  // namespace headless
+
+}  // namespace vigilante
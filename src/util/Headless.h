@@ -0,0 +1,47 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_HEADLESS_H_
+#define VIGILANTE_HEADLESS_H_
+
+#include <string>
+#include <vector>
+
+namespace vigilante {
+
+// The headless mode runs the simulation (physics, AI, quests and callbacks)
+// without presenting anything, for the benchmark suites, replay playback
+// and soak tests on CI machines, e.g.,
+//
+//   ./Vigilante --headless --exec "benchmark 50 60 bench.json"
+//   ./Vigilante --headless --exec "replay play soak.replay"
+//   ./Vigilante --headless --duration 3600
+//
+// cocos2d-x can't create textures without a GL context, so the window is
+// still created but hidden right away, and the sinks of the presentation
+// side become no-ops:
+// - the scenes are never visited by the renderer (see SceneManager),
+// - no fx or particles are spawned (see FxManager and ParticleSystem),
+// - no audio is played (see AudioManager),
+// - the main menu is skipped, and a new game is started right away.
+//
+// Once the first GameMap has been loaded, the `--exec` commands are run
+// by the console in order, and then every frame advances the game by
+// exactly kFixedTimeStep as fast as possible. The game quits when
+// `--duration` seconds of game time have elapsed, or if no duration is
+// given, once there's no replay or benchmark running.
+namespace headless {
+
+// Parses the command line arguments. Must be called before the
+// AppDelegate runs, and does nothing if `--headless` isn't given.
+void init(int argc, char* argv[]);
+bool isEnabled();
+
+// The console commands given by `--exec`, in order.
+const std::vector<std::string>& getCommands();
+// In seconds of game time, or 0 if it isn't limited.
+float getDuration();
+
+}  // namespace headless
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_HEADLESS_H_
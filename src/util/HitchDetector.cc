@@ -0,0 +1,90 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "HitchDetector.h"
+
+#include <algorithm>
+
+#include <cocos2d.h>
+#include "util/FramePacer.h"
+#include "util/Logger.h"
+#include "util/MainThread.h"
+#include "util/StringUtil.h"
+#include "util/TraceProfiler.h"
+
+#define HITCH_DUMP_DIR "hitches/"
+#define FRAME_INTERVAL_TOLERANCE 1.5f
+
+using std::string;
+using std::chrono::steady_clock;
+using cocos2d::FileUtils;
+
+namespace vigilante {
+
+const float HitchDetector::_kDefaultBudget = .025f;
+const float HitchDetector::_kCooldown = 10.0f;
+const float HitchDetector::_kDumpDuration = 5.0f;
+const int HitchDetector::_kMaxDumps = 8;
+
+HitchDetector* HitchDetector::getInstance() {
+  static HitchDetector instance;
+  return &instance;
+}
+
+HitchDetector::HitchDetector()
+    : _isEnabled(true),
+      _budget(_kDefaultBudget),
+      _numDumps(),
+      _lastDumpTime() {}
+
+
+bool HitchDetector::isHitch(float frameTime) const {
+  if (!_isEnabled) {
+    return false;
+  }
+
+  const float frameInterval = 1.0f / FramePacer::getInstance()->getTargetFps();
+  return frameTime > std::max(_budget, frameInterval * FRAME_INTERVAL_TOLERANCE);
+}
+
+void HitchDetector::dump(float frameTime, const HitchDetector::Context& context) {
+  VGASSERT_MAIN_THREAD();
+
+  const steady_clock::time_point now = steady_clock::now();
+  if (_numDumps > 0 &&
+      std::chrono::duration<float>(now - _lastDumpTime).count() < _kCooldown) {
+    return;
+  }
+
+  const string dir = FileUtils::getInstance()->getWritablePath() + HITCH_DUMP_DIR;
+  FileUtils::getInstance()->createDirectory(dir);
+  const string filePath = dir + string_util::format("hitch_%d.json", _numDumps % _kMaxDumps);
+
+  HitchDetector::Context metadata = context;
+  metadata.insert(metadata.begin(), {"frameTime", string_util::format("%.2f ms", frameTime * 1000)});
+  if (!TraceProfiler::getInstance()->dumpFlightRecorder(_kDumpDuration, filePath, metadata)) {
+    return;  // the previous trace is still being written
+  }
+
+  VGLOG(LOG_WARN, "Hitch: the frame took %.2f ms (budget: %.2f ms)",
+        frameTime * 1000, _budget * 1000);
+  _lastDumpTime = now;
+  _numDumps++;
+}
+
+bool HitchDetector::isEnabled() const {
+  return _isEnabled;
+}
+
+void HitchDetector::setEnabled(bool enabled) {
+  _isEnabled = enabled;
+  TraceProfiler::getInstance()->setFlightRecorderEnabled(enabled);
+}
+
+float HitchDetector::getBudget() const {
+  return _budget;
+}
+
+void HitchDetector::setBudget(float budget) {
+  _budget = budget;
+}
+
+}  // namespace vigilante
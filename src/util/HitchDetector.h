@@ -0,0 +1,57 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_HITCH_DETECTOR_H_
+#define VIGILANTE_HITCH_DETECTOR_H_
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vigilante {
+
+// Catches the dropped frames which players report. Whenever a frame exceeds
+// the budget (see GameScene::update()), the zones of the last few seconds
+// are dumped from the TraceProfiler's flight recorder, along with the context
+// of the hitch (the map, the actor counts, ...), to
+// <writable path>/hitches/hitch_<n>.json, which can be opened in
+// chrome://tracing or https://ui.perfetto.dev.
+//
+// At most one hitch is dumped within _kCooldown, and only the last
+// _kMaxDumps files are kept.
+//
+// All methods must be called on the main thread.
+class HitchDetector final {
+ public:
+  using Context = std::vector<std::pair<std::string, std::string>>;
+
+  static HitchDetector* getInstance();
+
+  // Returns true if a frame which took `frameTime` seconds is a hitch, i.e.,
+  // it exceeds both the budget and the frame interval chosen by the FramePacer
+  // (which is longer than the budget while the world is paused).
+  bool isHitch(float frameTime) const;
+  // Dumps the flight recorder unless it's been done within _kCooldown.
+  void dump(float frameTime, const HitchDetector::Context& context);
+
+  bool isEnabled() const;
+  void setEnabled(bool enabled);
+  float getBudget() const;  // in seconds
+  void setBudget(float budget);
+
+ private:
+  static const float _kDefaultBudget;
+  static const float _kCooldown;
+  static const float _kDumpDuration;
+  static const int _kMaxDumps;
+
+  HitchDetector();
+
+  bool _isEnabled;
+  float _budget;
+  int _numDumps;
+  std::chrono::steady_clock::time_point _lastDumpTime;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_HITCH_DETECTOR_H_
@@ -0,0 +1,105 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "JobPool.h"
+
+#define JOB_POOL_MIN_PARALLEL_JOBS 8  // waking up the workers isn't free
+
+using std::lock_guard;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+
+namespace vigilante {
+
+JobPool::JobPool(int numWorkerThreads)
+    : _workerThreads(),
+      _mutex(),
+      _batchBeginCv(),
+      _batchEndCv(),
+      _batchId(),
+      _numBusyWorkers(),
+      _isStopping(),
+      _job(),
+      _numJobs(),
+      _nextJobIndex() {
+  for (int i = 0; i < numWorkerThreads; i++) {
+    _workerThreads.push_back(thread(&JobPool::runWorkerThread, this));
+  }
+}
+
+JobPool::~JobPool() {
+  {
+    lock_guard<mutex> lock(_mutex);
+    _isStopping = true;
+  }
+  _batchBeginCv.notify_all();
+
+  for (auto& workerThread : _workerThreads) {
+    workerThread.join();
+  }
+}
+
+
+void JobPool::parallelFor(size_t numJobs, const JobPool::Job& job) {
+  if (_workerThreads.empty() || numJobs < JOB_POOL_MIN_PARALLEL_JOBS) {
+    for (size_t i = 0; i < numJobs; i++) {
+      job(i);
+    }
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(_mutex);
+    _job = &job;
+    _numJobs = numJobs;
+    _nextJobIndex = 0;
+    _numBusyWorkers = static_cast<int>(_workerThreads.size());
+    _batchId++;
+  }
+  _batchBeginCv.notify_all();
+
+  runJobs();
+
+  // Every worker takes part in every batch (even if there's no job left
+  // for it), so that none of them can still be looking at `_job` afterwards.
+  unique_lock<mutex> lock(_mutex);
+  _batchEndCv.wait(lock, [this]() { return _numBusyWorkers == 0; });
+  _job = nullptr;
+}
+
+
+void JobPool::runWorkerThread() {
+  uint64_t lastBatchId = 0;
+
+  while (true) {
+    {
+      unique_lock<mutex> lock(_mutex);
+      _batchBeginCv.wait(lock, [this, lastBatchId]() {
+        return _isStopping || _batchId != lastBatchId;
+      });
+      if (_isStopping) {
+        return;
+      }
+      lastBatchId = _batchId;
+    }
+
+    runJobs();
+
+    bool isLastWorker = false;
+    {
+      lock_guard<mutex> lock(_mutex);
+      isLastWorker = --_numBusyWorkers == 0;
+    }
+    if (isLastWorker) {
+      _batchEndCv.notify_one();
+    }
+  }
+}
+
+void JobPool::runJobs() {
+  size_t i;
+  while ((i = _nextJobIndex.fetch_add(1)) < _numJobs) {
+    (*_job)(i);
+  }
+}
+
+}  // namespace vigilante
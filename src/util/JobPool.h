@@ -0,0 +1,56 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_JOB_POOL_H_
+#define VIGILANTE_JOB_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vigilante {
+
+// A pool of persistent worker threads which run batches of small jobs,
+// e.g., letting every Npc think (see GameMapManager::update()).
+//
+// The jobs of a batch are claimed one at a time from a shared counter by
+// the workers as well as the calling thread, so a thread which finishes
+// its jobs early simply takes over the remaining ones.
+class JobPool final {
+ public:
+  using Job = std::function<void (size_t)>;
+
+  explicit JobPool(int numWorkerThreads);
+  ~JobPool();
+
+  JobPool(const JobPool&) = delete;
+  JobPool& operator=(const JobPool&) = delete;
+
+  // Runs job(i) for each i in [0, numJobs), and blocks until all of them
+  // are done. Small batches are run on the calling thread alone.
+  // The jobs must not throw, and must not call parallelFor() themselves.
+  void parallelFor(size_t numJobs, const JobPool::Job& job);
+
+ private:
+  void runWorkerThread();
+  void runJobs();
+
+  std::vector<std::thread> _workerThreads;
+
+  std::mutex _mutex;
+  std::condition_variable _batchBeginCv;
+  std::condition_variable _batchEndCv;
+  uint64_t _batchId;  // incremented for each batch
+  int _numBusyWorkers;
+  bool _isStopping;
+
+  const JobPool::Job* _job;
+  size_t _numJobs;
+  std::atomic<size_t> _nextJobIndex;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_JOB_POOL_H_
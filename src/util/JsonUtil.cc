@@ -1,37 +1,120 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "JsonUtil.h"
 
-#include <fstream>
-#include <sstream>
+#include <mutex>
 #include <stdexcept>
 
+#include <cocos2d.h>
+#include <json/error/en.h>
+#include "AssetManager.h"
+#include "std/make_unique.h"
+#include "util/LoadProfiler.h"
+#include "util/Logger.h"
+
+#define JSON_ARENA_CHUNK_SIZE 16 * 1024  // the first chunk of each allocator (reused)
+#define JSON_ARENA_POOL_MAX_SIZE 4
+
+using std::mutex;
+using std::lock_guard;
 using std::string;
+using std::unique_ptr;
 using std::vector;
-using std::ifstream;
-using std::stringstream;
 using std::runtime_error;
+using cocos2d::FileUtils;
 using rapidjson::Document;
+using rapidjson::MemoryPoolAllocator;
 
 namespace vigilante {
 
 namespace json_util {
 
-Document parseJson(const string& jsonFileName) {
-  ifstream fin(jsonFileName);
-  if (!fin.is_open()) {
-    throw std::runtime_error("Json not found: " + jsonFileName);
+struct JsonDocument::Arena final {
+  Arena()
+      : content(),
+        chunk(JSON_ARENA_CHUNK_SIZE),
+        allocator(chunk.data(), chunk.size()) {}
+
+  // Frees everything except the first chunk, which is owned by this arena.
+  void clear() {
+    content.clear();
+    allocator.Clear();
+  }
+
+  vector<char> content;  // the file content, into which the strings point
+  vector<char> chunk;
+  MemoryPoolAllocator<> allocator;
+};
+
+namespace {
+
+mutex arenaPoolMutex;
+vector<unique_ptr<JsonDocument::Arena>> arenaPool;
+
+unique_ptr<JsonDocument::Arena> acquireArena() {
+  lock_guard<mutex> lock(arenaPoolMutex);
+  if (arenaPool.empty()) {
+    return std::make_unique<JsonDocument::Arena>();
   }
+  unique_ptr<JsonDocument::Arena> arena = std::move(arenaPool.back());
+  arenaPool.pop_back();
+  return arena;
+}
 
-  string content;
-  string line;
-  while (std::getline(fin, line)) {
-    content += line;
+void releaseArena(unique_ptr<JsonDocument::Arena> arena) {
+  arena->clear();
+  lock_guard<mutex> lock(arenaPoolMutex);
+  if (arenaPool.size() < JSON_ARENA_POOL_MAX_SIZE) {
+    arenaPool.push_back(std::move(arena));
   }
-  fin.close();
+}
+
+}  // namespace
+
+JsonDocument::JsonDocument(const string& jsonFileName)
+    : _arena(acquireArena()),
+      _document(std::make_unique<Document>(&_arena->allocator)) {
+  LoadProfiler::ScopedTimer timer(LoadProfiler::Section::JSON_PARSE);
+
+  // Release builds read the json straight from the memory mapped database pack.
+  // The pack is read-only, so the strings are copied into the pooled allocator.
+  const char* packedData = nullptr;
+  size_t packedSize = 0;
+  if (asset_manager::getPackedJson(jsonFileName, &packedData, &packedSize)) {
+    _document->Parse(packedData, packedSize);
+    if (_document->HasParseError()) {
+      VGLOG(LOG_ERR, "Failed to parse packed [%s] at offset %zu: %s", jsonFileName.c_str(),
+            _document->GetErrorOffset(), rapidjson::GetParseError_En(_document->GetParseError()));
+    }
+    return;
+  }
+
+  if (FileUtils::getInstance()->getContents(jsonFileName, &_arena->content) !=
+      FileUtils::Status::OK) {
+    _document.reset();
+    releaseArena(std::move(_arena));
+    throw runtime_error("Json not found: " + jsonFileName);
+  }
+  LoadProfiler::addFileRead(_arena->content.size());
+  _arena->content.push_back('\0');
+
+  _document->ParseInsitu(_arena->content.data());
+  if (_document->HasParseError()) {
+    VGLOG(LOG_ERR, "Failed to parse [%s] at offset %zu: %s", jsonFileName.c_str(),
+          _document->GetErrorOffset(), rapidjson::GetParseError_En(_document->GetParseError()));
+  }
+}
+
+JsonDocument::~JsonDocument() {
+  // The document must be destroyed before its allocator is reused.
+  _document.reset();
+  if (_arena) {
+    releaseArena(std::move(_arena));
+  }
+}
+
 
-  Document json;
-  json.Parse(content.c_str());
-  return json;
+Document& JsonDocument::get() {
+  return *_document;
 }
 
 }  // namespace json_util
@@ -2,6 +2,7 @@
 #ifndef VIGILANTE_JSON_UTIL_H_
 #define VIGILANTE_JSON_UTIL_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -11,7 +12,37 @@ namespace vigilante {
 
 namespace json_util {
 
-rapidjson::Document parseJson(const std::string& jsonFileName);
+// A json file parsed in situ.
+//
+// The whole file is read in one shot via cocos2d::FileUtils (which also
+// works for the files inside an APK), and then parsed with ParseInsitu(),
+// so the strings in the document point directly into the file content
+// instead of being copied. Both the file content buffer and the allocator
+// of the document come from an arena which is returned to a pool when the
+// JsonDocument is destroyed, and reused by the next one.
+//
+// Hence the document (and any `const char*` obtained from it)
+// must not outlive this object.
+//
+// If the database pack has been loaded (see asset_manager::loadDatabasePack()),
+// the json is parsed straight from the pack instead of the file.
+class JsonDocument final {
+ public:
+  // Throws std::runtime_error if `jsonFileName` cannot be read.
+  explicit JsonDocument(const std::string& jsonFileName);
+  ~JsonDocument();
+
+  JsonDocument(const JsonDocument&) = delete;
+  JsonDocument& operator=(const JsonDocument&) = delete;
+
+  rapidjson::Document& get();
+
+  struct Arena;
+
+ private:
+  std::unique_ptr<JsonDocument::Arena> _arena;
+  std::unique_ptr<rapidjson::Document> _document;
+};
 
 }  // namespace json_util
 
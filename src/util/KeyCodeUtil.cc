@@ -1,27 +1,117 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "KeyCodeUtil.h"
 
-#include <unordered_map>
-
 using std::string;
-using std::unordered_map;
 using cocos2d::EventKeyboard;
 
 namespace {
 
-// Apple's libc++ is retarded... This hash function object isn't
-// necessary when compiling with libstdc++
-#ifdef __APPLE__
-struct KeyCodeHash {
-  template <typename T>
-  std::size_t operator()(T t) const {
-    return static_cast<std::size_t>(t);
-  }
+// The names of the keys, indexed by their key codes (nullptr if unnamed).
+// Built at compile time, so looking up a name is a single array access.
+struct KeyNameTable final {
+  const char* names[vigilante::keycode_util::kNumKeyCodes];
 };
-unordered_map<EventKeyboard::KeyCode, string, KeyCodeHash> keyMap;
-#else
-unordered_map<EventKeyboard::KeyCode, string> keyMap;
-#endif
+
+constexpr void setName(KeyNameTable& table, EventKeyboard::KeyCode keyCode, const char* name) {
+  table.names[vigilante::keycode_util::toIndex(keyCode)] = name;
+}
+
+constexpr KeyNameTable makeKeyNameTable() {
+  KeyNameTable table{};
+  setName(table, EventKeyboard::KeyCode::KEY_BACK, "BACK");
+  setName(table, EventKeyboard::KeyCode::KEY_BACKSPACE, "BACKSPACE");
+  setName(table, EventKeyboard::KeyCode::KEY_TAB, "TAB");
+  setName(table, EventKeyboard::KeyCode::KEY_BACK_TAB, "BACKTAB");
+  setName(table, EventKeyboard::KeyCode::KEY_RETURN, "RETURN");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPS_LOCK, "CAPS LOCK");
+  setName(table, EventKeyboard::KeyCode::KEY_LEFT_SHIFT, "LEFT SHIFT");
+  setName(table, EventKeyboard::KeyCode::KEY_RIGHT_SHIFT, "RIGHT SHIFT");
+  setName(table, EventKeyboard::KeyCode::KEY_LEFT_CTRL, "LEFT CTRL");
+  setName(table, EventKeyboard::KeyCode::KEY_RIGHT_CTRL, "RIGHT CTRL");
+  setName(table, EventKeyboard::KeyCode::KEY_LEFT_ALT, "LEFT ALT");
+  setName(table, EventKeyboard::KeyCode::KEY_RIGHT_ALT, "RIGHT ALT");
+  setName(table, EventKeyboard::KeyCode::KEY_HOME, "HOME");
+  setName(table, EventKeyboard::KeyCode::KEY_PG_UP, "PG_UP");
+  setName(table, EventKeyboard::KeyCode::KEY_DELETE, "DELETE");
+  setName(table, EventKeyboard::KeyCode::KEY_END, "END");
+  setName(table, EventKeyboard::KeyCode::KEY_PG_DOWN, "PG_DOWN");
+  setName(table, EventKeyboard::KeyCode::KEY_LEFT_ARROW, "LEFT ARROW");
+  setName(table, EventKeyboard::KeyCode::KEY_RIGHT_ARROW, "RIGHT ARROW");
+  setName(table, EventKeyboard::KeyCode::KEY_UP_ARROW, "UP ARROW");
+  setName(table, EventKeyboard::KeyCode::KEY_DOWN_ARROW, "DOWN ARROW");
+  setName(table, EventKeyboard::KeyCode::KEY_PLUS, "PLUS");
+  setName(table, EventKeyboard::KeyCode::KEY_MINUS, "MINUS");
+  setName(table, EventKeyboard::KeyCode::KEY_ENTER, "ENTER");
+  setName(table, EventKeyboard::KeyCode::KEY_SPACE, "SPACE");
+
+  setName(table, EventKeyboard::KeyCode::KEY_0, "0");
+  setName(table, EventKeyboard::KeyCode::KEY_1, "1");
+  setName(table, EventKeyboard::KeyCode::KEY_2, "2");
+  setName(table, EventKeyboard::KeyCode::KEY_3, "3");
+  setName(table, EventKeyboard::KeyCode::KEY_4, "4");
+  setName(table, EventKeyboard::KeyCode::KEY_5, "5");
+  setName(table, EventKeyboard::KeyCode::KEY_6, "6");
+  setName(table, EventKeyboard::KeyCode::KEY_7, "7");
+  setName(table, EventKeyboard::KeyCode::KEY_8, "8");
+  setName(table, EventKeyboard::KeyCode::KEY_9, "9");
+
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_A, "A");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_B, "B");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_C, "C");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_D, "D");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_E, "E");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_F, "F");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_G, "G");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_H, "H");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_I, "I");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_J, "J");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_K, "K");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_L, "L");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_M, "M");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_N, "N");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_O, "O");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_P, "P");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_Q, "Q");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_R, "R");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_S, "S");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_T, "T");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_U, "U");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_V, "V");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_W, "W");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_X, "X");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_Y, "Y");
+  setName(table, EventKeyboard::KeyCode::KEY_CAPITAL_Z, "Z");
+
+  setName(table, EventKeyboard::KeyCode::KEY_A, "a");
+  setName(table, EventKeyboard::KeyCode::KEY_B, "b");
+  setName(table, EventKeyboard::KeyCode::KEY_C, "c");
+  setName(table, EventKeyboard::KeyCode::KEY_D, "d");
+  setName(table, EventKeyboard::KeyCode::KEY_E, "e");
+  setName(table, EventKeyboard::KeyCode::KEY_F, "f");
+  setName(table, EventKeyboard::KeyCode::KEY_G, "g");
+  setName(table, EventKeyboard::KeyCode::KEY_H, "h");
+  setName(table, EventKeyboard::KeyCode::KEY_I, "i");
+  setName(table, EventKeyboard::KeyCode::KEY_J, "j");
+  setName(table, EventKeyboard::KeyCode::KEY_K, "k");
+  setName(table, EventKeyboard::KeyCode::KEY_L, "l");
+  setName(table, EventKeyboard::KeyCode::KEY_M, "m");
+  setName(table, EventKeyboard::KeyCode::KEY_N, "n");
+  setName(table, EventKeyboard::KeyCode::KEY_O, "o");
+  setName(table, EventKeyboard::KeyCode::KEY_P, "p");
+  setName(table, EventKeyboard::KeyCode::KEY_Q, "q");
+  setName(table, EventKeyboard::KeyCode::KEY_R, "r");
+  setName(table, EventKeyboard::KeyCode::KEY_S, "s");
+  setName(table, EventKeyboard::KeyCode::KEY_T, "t");
+  setName(table, EventKeyboard::KeyCode::KEY_U, "u");
+  setName(table, EventKeyboard::KeyCode::KEY_V, "v");
+  setName(table, EventKeyboard::KeyCode::KEY_W, "w");
+  setName(table, EventKeyboard::KeyCode::KEY_X, "x");
+  setName(table, EventKeyboard::KeyCode::KEY_Y, "y");
+  setName(table, EventKeyboard::KeyCode::KEY_Z, "z");
+  return table;
+}
+
+constexpr KeyNameTable kKeyNameTable = makeKeyNameTable();
 
 }  // namespace
 
@@ -30,101 +120,9 @@ namespace vigilante {
 
 namespace keycode_util {
 
-void init() {
-  ::keyMap[EventKeyboard::KeyCode::KEY_BACK] = "BACK";
-  ::keyMap[EventKeyboard::KeyCode::KEY_BACKSPACE] = "BACKSPACE";
-  ::keyMap[EventKeyboard::KeyCode::KEY_TAB] = "TAB";
-  ::keyMap[EventKeyboard::KeyCode::KEY_BACK_TAB] = "BACKTAB";
-  ::keyMap[EventKeyboard::KeyCode::KEY_RETURN] = "RETURN";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPS_LOCK] = "CAPS LOCK";
-  ::keyMap[EventKeyboard::KeyCode::KEY_LEFT_SHIFT] = "LEFT SHIFT";
-  ::keyMap[EventKeyboard::KeyCode::KEY_RIGHT_SHIFT] = "RIGHT SHIFT";
-  ::keyMap[EventKeyboard::KeyCode::KEY_LEFT_CTRL] = "LEFT CTRL";
-  ::keyMap[EventKeyboard::KeyCode::KEY_RIGHT_CTRL] = "RIGHT CTRL";
-  ::keyMap[EventKeyboard::KeyCode::KEY_LEFT_ALT] = "LEFT ALT";
-  ::keyMap[EventKeyboard::KeyCode::KEY_RIGHT_ALT] = "RIGHT ALT";
-  ::keyMap[EventKeyboard::KeyCode::KEY_HOME] = "HOME";
-  ::keyMap[EventKeyboard::KeyCode::KEY_PG_UP] = "PG_UP";
-  ::keyMap[EventKeyboard::KeyCode::KEY_DELETE] = "DELETE";
-  ::keyMap[EventKeyboard::KeyCode::KEY_END] = "END";
-  ::keyMap[EventKeyboard::KeyCode::KEY_PG_DOWN] = "PG_DOWN";
-  ::keyMap[EventKeyboard::KeyCode::KEY_LEFT_ARROW] = "LEFT ARROW";
-  ::keyMap[EventKeyboard::KeyCode::KEY_RIGHT_ARROW] = "RIGHT ARROW";
-  ::keyMap[EventKeyboard::KeyCode::KEY_UP_ARROW] = "UP ARROW";
-  ::keyMap[EventKeyboard::KeyCode::KEY_DOWN_ARROW] = "DOWN ARROW";
-  ::keyMap[EventKeyboard::KeyCode::KEY_PLUS] = "PLUS";
-  ::keyMap[EventKeyboard::KeyCode::KEY_MINUS] = "MINUS";
-  ::keyMap[EventKeyboard::KeyCode::KEY_ENTER] = "ENTER";
-  ::keyMap[EventKeyboard::KeyCode::KEY_SPACE] = "SPACE";
-
-  ::keyMap[EventKeyboard::KeyCode::KEY_0] = "0";
-  ::keyMap[EventKeyboard::KeyCode::KEY_1] = "1";
-  ::keyMap[EventKeyboard::KeyCode::KEY_2] = "2";
-  ::keyMap[EventKeyboard::KeyCode::KEY_3] = "3";
-  ::keyMap[EventKeyboard::KeyCode::KEY_4] = "4";
-  ::keyMap[EventKeyboard::KeyCode::KEY_5] = "5";
-  ::keyMap[EventKeyboard::KeyCode::KEY_6] = "6";
-  ::keyMap[EventKeyboard::KeyCode::KEY_7] = "7";
-  ::keyMap[EventKeyboard::KeyCode::KEY_8] = "8";
-  ::keyMap[EventKeyboard::KeyCode::KEY_9] = "9";
-
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_A] = "A";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_B] = "B";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_C] = "C";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_D] = "D";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_E] = "E";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_F] = "F";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_G] = "G";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_H] = "H";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_I] = "I";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_J] = "J";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_K] = "K";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_L] = "L";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_M] = "M";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_N] = "N";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_O] = "O";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_P] = "P";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_Q] = "Q";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_R] = "R";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_S] = "S";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_T] = "T";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_U] = "U";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_V] = "V";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_W] = "W";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_X] = "X";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_Y] = "Y";
-  ::keyMap[EventKeyboard::KeyCode::KEY_CAPITAL_Z] = "Z";
-
-  ::keyMap[EventKeyboard::KeyCode::KEY_A] = "a";
-  ::keyMap[EventKeyboard::KeyCode::KEY_B] = "b";
-  ::keyMap[EventKeyboard::KeyCode::KEY_C] = "c";
-  ::keyMap[EventKeyboard::KeyCode::KEY_D] = "d";
-  ::keyMap[EventKeyboard::KeyCode::KEY_E] = "e";
-  ::keyMap[EventKeyboard::KeyCode::KEY_F] = "f";
-  ::keyMap[EventKeyboard::KeyCode::KEY_G] = "g";
-  ::keyMap[EventKeyboard::KeyCode::KEY_H] = "h";
-  ::keyMap[EventKeyboard::KeyCode::KEY_I] = "i";
-  ::keyMap[EventKeyboard::KeyCode::KEY_J] = "j";
-  ::keyMap[EventKeyboard::KeyCode::KEY_K] = "k";
-  ::keyMap[EventKeyboard::KeyCode::KEY_L] = "l";
-  ::keyMap[EventKeyboard::KeyCode::KEY_M] = "m";
-  ::keyMap[EventKeyboard::KeyCode::KEY_N] = "n";
-  ::keyMap[EventKeyboard::KeyCode::KEY_O] = "o";
-  ::keyMap[EventKeyboard::KeyCode::KEY_P] = "p";
-  ::keyMap[EventKeyboard::KeyCode::KEY_Q] = "q";
-  ::keyMap[EventKeyboard::KeyCode::KEY_R] = "r";
-  ::keyMap[EventKeyboard::KeyCode::KEY_S] = "s";
-  ::keyMap[EventKeyboard::KeyCode::KEY_T] = "t";
-  ::keyMap[EventKeyboard::KeyCode::KEY_U] = "u";
-  ::keyMap[EventKeyboard::KeyCode::KEY_V] = "v";
-  ::keyMap[EventKeyboard::KeyCode::KEY_W] = "w";
-  ::keyMap[EventKeyboard::KeyCode::KEY_X] = "x";
-  ::keyMap[EventKeyboard::KeyCode::KEY_Y] = "y";
-  ::keyMap[EventKeyboard::KeyCode::KEY_Z] = "z";
-}
-
 string keyCodeToString(EventKeyboard::KeyCode keyCode) {
-  return ::keyMap[keyCode];
+  const char* name = (toIndex(keyCode) < kNumKeyCodes) ? kKeyNameTable.names[toIndex(keyCode)] : nullptr;
+  return (name) ? name : "";
 }
 
 char keyCodeToAscii(EventKeyboard::KeyCode keyCode, bool isCapsLocked, bool isShiftPressed) {
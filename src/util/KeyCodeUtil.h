@@ -2,6 +2,7 @@
 #ifndef VIGILANTE_KEYCODE_UTIL_H_
 #define VIGILANTE_KEYCODE_UTIL_H_
 
+#include <cstddef>
 #include <string>
 
 #include <cocos2d.h>
@@ -10,7 +11,13 @@ namespace vigilante {
 
 namespace keycode_util {
 
-void init();
+// Large enough for every cocos2d::EventKeyboard::KeyCode, so that the
+// tables indexed by key codes (see toIndex()) can be dense arrays.
+constexpr size_t kNumKeyCodes = 256;
+
+constexpr size_t toIndex(cocos2d::EventKeyboard::KeyCode keyCode) {
+  return static_cast<size_t>(keyCode);
+}
 
 std::string keyCodeToString(cocos2d::EventKeyboard::KeyCode keyCode);
 char keyCodeToAscii(cocos2d::EventKeyboard::KeyCode keyCode, bool isCapsLocked, bool isShiftPressed);
@@ -0,0 +1,56 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "LabelUtil.h"
+
+#include <unordered_map>
+
+#include "util/MainThread.h"
+
+using std::string;
+using std::unordered_map;
+using cocos2d::Color3B;
+using cocos2d::Color4B;
+using cocos2d::FileUtils;
+using cocos2d::Label;
+
+namespace vigilante {
+
+namespace label_util {
+
+namespace {
+
+// <"Font/at01.ttf" at 16, "Font/at01_16.fnt" or "" if it doesn't exist>
+unordered_map<string, string> bmFontFiles;
+
+const string& getBmFontFile(const string& fontFile, float fontSize) {
+  const string bmFontFile = fontFile.substr(0, fontFile.find_last_of('.')) +
+                            "_" + std::to_string(static_cast<int>(fontSize)) + ".fnt";
+
+  auto it = bmFontFiles.find(bmFontFile);
+  if (it == bmFontFiles.end()) {
+    const bool exists = FileUtils::getInstance()->isFileExist(bmFontFile);
+    it = bmFontFiles.emplace(bmFontFile, (exists) ? bmFontFile : "").first;
+  }
+  return it->second;
+}
+
+}  // namespace
+
+Label* create(const string& text, const string& fontFile, float fontSize) {
+  VGASSERT_MAIN_THREAD();
+
+  const string& bmFontFile = getBmFontFile(fontFile, fontSize);
+  Label* label = (!bmFontFile.empty()) ? Label::createWithBMFont(bmFontFile, text)
+                                       : Label::createWithTTF(text, fontFile, fontSize);
+  label->getFontAtlas()->setAliasTexParameters();
+  return label;
+}
+
+void setTextColor(Label* label, const Color4B& textColor) {
+  // The glyphs of the bitmap fonts are baked in white, so that they can be
+  // tinted with the node color. This works for the TTF labels as well.
+  label->setColor(Color3B(textColor));
+}
+
+} // namespace label_util
+
+} // namespace vigilante
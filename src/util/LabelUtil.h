@@ -0,0 +1,33 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_LABEL_UTIL_H_
+#define VIGILANTE_LABEL_UTIL_H_
+
+#include <string>
+
+#include <cocos2d.h>
+
+namespace vigilante {
+
+namespace label_util {
+
+// Creates a label with the bitmap font prebaked from `fontFile` at
+// `fontSize` (see scripts/FontBaker.py) if there is one, or falls back to
+// rasterizing `fontFile` with FreeType. All of our fonts are pixel fonts
+// used at fixed sizes, so the bitmap fonts look exactly the same.
+//
+// The labels using the same bitmap font share the same texture and shader,
+// so the renderer draws all of them in a UI layer with a single batched
+// draw call, whereas each TTF label is drawn on its own.
+cocos2d::Label* create(const std::string& text,
+                       const std::string& fontFile,
+                       float fontSize);
+
+// Label::setTextColor() is only supported by TTF labels,
+// so use this to tint the labels created by create().
+void setTextColor(cocos2d::Label* label, const cocos2d::Color4B& textColor);
+
+} // namespace label_util
+
+} // namespace vigilante
+
+#endif // VIGILANTE_LABEL_UTIL_H_
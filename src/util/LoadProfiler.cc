@@ -0,0 +1,131 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "LoadProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "AssetManager.h"
+#include "util/AllocationTracker.h"
+#include "util/Logger.h"
+
+using std::string;
+using std::ofstream;
+using std::lock_guard;
+using std::mutex;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace {
+
+// The counters of the current thread (the allocations are counted by
+// AllocationTracker). They're never reset, and ScopedTimer only looks at
+// how much they've grown during its lifetime.
+struct ThreadCounters final {
+  uint64_t fileReadCount;
+  uint64_t bytesRead;
+};
+
+thread_local ThreadCounters threadCounters;
+
+double getPerCall(double value, uint64_t callCount) {
+  return (callCount > 0) ? static_cast<double>(value) / callCount : 0;
+}
+
+}  // namespace
+
+
+namespace vigilante {
+
+const std::array<string, LoadProfiler::Section::SECTION_SIZE> LoadProfiler::_kSectionStr = {{
+  "jsonParse",
+  "spritesheets",
+  "animations",
+  "mapObjects"
+}};
+
+LoadProfiler::ScopedTimer::ScopedTimer(LoadProfiler::Section section)
+    : _section(section),
+      _beginTime(steady_clock::now()),
+      _beginAllocationCount(AllocationTracker::getThreadAllocationCount()),
+      _beginFileReadCount(::threadCounters.fileReadCount),
+      _beginBytesRead(::threadCounters.bytesRead) {}
+
+LoadProfiler::ScopedTimer::~ScopedTimer() {
+  const duration<double, std::milli> elapsed = steady_clock::now() - _beginTime;
+
+  Stats stats;
+  stats.callCount = 1;
+  stats.totalTime = elapsed.count();
+  stats.maxTime = elapsed.count();
+  stats.allocationCount = AllocationTracker::getThreadAllocationCount() - _beginAllocationCount;
+  stats.fileReadCount = ::threadCounters.fileReadCount - _beginFileReadCount;
+  stats.bytesRead = ::threadCounters.bytesRead - _beginBytesRead;
+  LoadProfiler::getInstance()->addStats(_section, stats);
+}
+
+
+LoadProfiler* LoadProfiler::getInstance() {
+  static LoadProfiler instance;
+  return &instance;
+}
+
+LoadProfiler::LoadProfiler() : _mutex(), _stats() {}
+
+
+void LoadProfiler::addFileRead(size_t bytes) {
+  ::threadCounters.fileReadCount++;
+  ::threadCounters.bytesRead += bytes;
+}
+
+double LoadProfiler::getTotalTime(LoadProfiler::Section section) const {
+  lock_guard<mutex> lock(_mutex);
+  return _stats[section].totalTime;
+}
+
+bool LoadProfiler::dumpJson(const string& fileName) const {
+  ofstream fout(fileName, std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_ERR, "Unable to write load profile to: %s", fileName.c_str());
+    return false;
+  }
+
+  lock_guard<mutex> lock(_mutex);
+  fout << "{\n";
+  fout << "  \"databasePack\": " << (asset_manager::isDatabasePackLoaded() ? "true" : "false");
+  fout << ",\n  \"sections\": {";
+
+  for (int i = 0; i < Section::SECTION_SIZE; i++) {
+    const Stats& stats = _stats[i];
+    fout << ((i == 0) ? "\n" : ",\n");
+    fout << "    \"" << _kSectionStr[i] << "\": {"
+         << "\"calls\": " << stats.callCount << ", "
+         << "\"totalMs\": " << stats.totalTime << ", "
+         << "\"meanMs\": " << ::getPerCall(stats.totalTime, stats.callCount) << ", "
+         << "\"maxMs\": " << stats.maxTime << ", "
+         << "\"allocationsPerCall\": " << ::getPerCall(stats.allocationCount, stats.callCount) << ", "
+         << "\"fileReadsPerCall\": " << ::getPerCall(stats.fileReadCount, stats.callCount) << ", "
+         << "\"bytesReadPerCall\": " << ::getPerCall(stats.bytesRead, stats.callCount) << "}";
+  }
+
+  fout << "\n  }\n}\n";
+  return true;
+}
+
+void LoadProfiler::reset() {
+  lock_guard<mutex> lock(_mutex);
+  _stats = {};
+}
+
+
+void LoadProfiler::addStats(LoadProfiler::Section section, const LoadProfiler::Stats& stats) {
+  lock_guard<mutex> lock(_mutex);
+  Stats& total = _stats[section];
+  total.callCount += stats.callCount;
+  total.totalTime += stats.totalTime;
+  total.maxTime = std::max(total.maxTime, stats.maxTime);
+  total.allocationCount += stats.allocationCount;
+  total.fileReadCount += stats.fileReadCount;
+  total.bytesRead += stats.bytesRead;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,83 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_LOAD_PROFILER_H_
+#define VIGILANTE_LOAD_PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace vigilante {
+
+// Accumulates the cost of each call to the asset loaders (wall time,
+// heap allocations, and the file reads reported by the loaders), so that the loading
+// paths can be measured in isolation and compared between releases.
+// The results are written as json by dumpJson() (see the "dumpLoadProfile"
+// console command).
+//
+// The costs of nested loaders are inclusive, e.g., the json files parsed by
+// GameMap::createObjects() are counted in both JSON_PARSE and MAP_OBJECTS.
+//
+// Heap allocations are only counted if the game is built with
+// VIGILANTE_COUNT_ALLOCATIONS (see AllocationTracker), otherwise they're zero.
+// All methods are thread-safe.
+class LoadProfiler final {
+ public:
+  enum Section {
+    JSON_PARSE,
+    SPRITESHEETS,
+    ANIMATIONS,
+    MAP_OBJECTS,
+    SECTION_SIZE
+  };
+
+  // Adds the cost of the work done on the current thread between
+  // its construction and destruction to the specified section.
+  class ScopedTimer final {
+   public:
+    explicit ScopedTimer(LoadProfiler::Section section);
+    ~ScopedTimer();
+
+   private:
+    LoadProfiler::Section _section;
+    std::chrono::steady_clock::time_point _beginTime;
+    uint64_t _beginAllocationCount;
+    uint64_t _beginFileReadCount;
+    uint64_t _beginBytesRead;
+  };
+
+  static LoadProfiler* getInstance();
+
+  // Called by the loaders whenever a file is read on the current thread.
+  static void addFileRead(size_t bytes);
+
+  // In milliseconds, accumulated since the last reset().
+  double getTotalTime(LoadProfiler::Section section) const;
+
+  bool dumpJson(const std::string& fileName) const;
+  void reset();
+
+ private:
+  struct Stats final {
+    uint64_t callCount;
+    double totalTime;  // in milliseconds
+    double maxTime;  // in milliseconds
+    uint64_t allocationCount;
+    uint64_t fileReadCount;
+    uint64_t bytesRead;
+  };
+
+  LoadProfiler();
+
+  void addStats(LoadProfiler::Section section, const LoadProfiler::Stats& stats);
+
+  static const std::array<std::string, Section::SECTION_SIZE> _kSectionStr;
+
+  mutable std::mutex _mutex;
+  std::array<LoadProfiler::Stats, Section::SECTION_SIZE> _stats;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_LOAD_PROFILER_H_
@@ -1,6 +1,16 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "Logger.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
 extern "C" {
 #include <execinfo.h> // backtrace*
 #include <signal.h> // signal
@@ -9,18 +19,260 @@ extern "C" {
 #include <fcntl.h> // open
 }
 
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+#include <android/log.h>
+#endif
+
 #define NUM_STACKTRACE_FUNC 10
 #define LOG_FILENAME "vigilante.log"
 
+#define LOG_RING_CAPACITY 1024  // must be a power of two
+#define LOG_ENTRY_SIZE 256
+#define LOG_FLUSH_INTERVAL_MS 20
+#define NUM_CRASH_DUMP_ENTRIES 32
+#define MAX_NUM_DISABLED_TAGS 16
+
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+
 namespace vigilante {
 
 namespace logger {
 
-void segvHandler(int) {
-  void* array[10];
-  size_t size = backtrace(array, 10);
+namespace {
+
+// A bounded multi-producer queue (Vyukov's), so that any thread can
+// log without a lock. Each slot has a sequence number which tells
+// whether it's free to be written (== the enqueue position),
+// or ready to be read (== the enqueue position + 1).
+struct Entry final {
+  std::atomic<uint64_t> sequence;
+  Severity severity;
+  char text[LOG_ENTRY_SIZE];
+};
+
+class Backend final {
+ public:
+  static Backend* getInstance() {
+    // Never destroyed, so the messages logged by the other static
+    // destructors are still accepted.
+    static Backend* instance = new Backend();
+    return instance;
+  }
+
+  void push(Severity severity, const SourceLocation& location, const char* format, va_list args) {
+    uint64_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    Entry* entry = nullptr;
+    while (true) {
+      entry = &_entries[pos & (LOG_RING_CAPACITY - 1)];
+      const uint64_t sequence = entry->sequence.load(std::memory_order_acquire);
+      const int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+      if (diff == 0) {
+        if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        _numDroppedEntries.fetch_add(1, std::memory_order_relaxed);
+        return;
+      } else {
+        pos = _enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    entry->severity = severity;
+    int len = std::snprintf(entry->text, LOG_ENTRY_SIZE, "[%s] [%.*s] [%s: %d] ",
+                            _kSeverityStr[severity], location.tagLength, location.tag,
+                            location.fileName, location.line);
+    len = std::max(0, std::min(len, LOG_ENTRY_SIZE - 1));
+    std::vsnprintf(entry->text + len, LOG_ENTRY_SIZE - len, format, args);
+    entry->sequence.store(pos + 1, std::memory_order_release);
+
+    // Errors are written out right away, in case the game is about to crash.
+    // The flush thread is also woken up early during a burst of messages.
+    if (severity == Severity::ERROR || (pos & (LOG_RING_CAPACITY / 4 - 1)) == 0) {
+      _flushCv.notify_one();
+    }
+  }
+
+  void flush() {
+    lock_guard<mutex> lock(_consumerMutex);
+    drain();
+  }
+
+  // Async-signal-safe: only write() is used, and nothing is locked.
+  void dumpRecentEntries(int fd) const {
+    const uint64_t end = _enqueuePos.load(std::memory_order_relaxed);
+    const uint64_t begin = (end > NUM_CRASH_DUMP_ENTRIES) ? end - NUM_CRASH_DUMP_ENTRIES : 0;
+    for (uint64_t pos = begin; pos < end; pos++) {
+      const Entry& entry = _entries[pos & (LOG_RING_CAPACITY - 1)];
+      const uint64_t sequence = entry.sequence.load(std::memory_order_acquire);
+      // Skip the entries which are still being written, or have been overwritten.
+      if (sequence != pos + 1 && sequence != pos + LOG_RING_CAPACITY) {
+        continue;
+      }
+      ssize_t unused = ::write(fd, entry.text, strnlen(entry.text, LOG_ENTRY_SIZE));
+      unused = ::write(fd, "\n", 1);
+      (void) unused;
+    }
+  }
+
+  void setMinSeverity(Severity severity) {
+    _minSeverity.store(severity, std::memory_order_relaxed);
+  }
+
+  void setTagEnabled(uint32_t tagHash, bool enabled) {
+    lock_guard<mutex> lock(_tagsMutex);
+    int freeIndex = -1;
+    for (int i = 0; i < MAX_NUM_DISABLED_TAGS; i++) {
+      const uint32_t disabledTag = _disabledTags[i].load(std::memory_order_relaxed);
+      if (disabledTag == tagHash) {
+        if (!enabled) {
+          return;
+        }
+        _disabledTags[i].store(0, std::memory_order_relaxed);
+      } else if (disabledTag == 0 && freeIndex < 0) {
+        freeIndex = i;
+      }
+    }
+    if (!enabled && freeIndex >= 0) {
+      _disabledTags[freeIndex].store(tagHash, std::memory_order_relaxed);
+    }
+  }
+
+  bool isEnabled(Severity severity, uint32_t tagHash) const {
+    if (severity > _minSeverity.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    for (const auto& disabledTag : _disabledTags) {
+      if (disabledTag.load(std::memory_order_relaxed) == tagHash) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  Backend()
+      : _entries(),
+        _enqueuePos(),
+        _dequeuePos(),
+        _numDroppedEntries(),
+        _minSeverity(Severity::INFO),
+        _disabledTags(),
+        _tagsMutex(),
+        _consumerMutex(),
+        _flushMutex(),
+        _flushCv(),
+        _flushThread() {
+    for (uint64_t i = 0; i < LOG_RING_CAPACITY; i++) {
+      _entries[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    for (auto& disabledTag : _disabledTags) {
+      disabledTag.store(0, std::memory_order_relaxed);
+    }
+
+    _flushThread = std::thread([this]() {
+      while (true) {
+        {
+          unique_lock<mutex> lock(_flushMutex);
+          _flushCv.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+        }
+        flush();
+      }
+    });
+    _flushThread.detach();
+    std::atexit([]() { Backend::getInstance()->flush(); });
+  }
+
+  // Must be called with _consumerMutex locked.
+  void drain() {
+    while (true) {
+      Entry& entry = _entries[_dequeuePos & (LOG_RING_CAPACITY - 1)];
+      if (entry.sequence.load(std::memory_order_acquire) != _dequeuePos + 1) {
+        break;
+      }
+      output(entry.severity, entry.text);
+      // Hand the slot back to the producers, one lap later.
+      entry.sequence.store(_dequeuePos + LOG_RING_CAPACITY, std::memory_order_release);
+      _dequeuePos++;
+    }
+
+    const uint64_t numDroppedEntries = _numDroppedEntries.exchange(0, std::memory_order_relaxed);
+    if (numDroppedEntries > 0) {
+      char text[64];
+      std::snprintf(text, sizeof(text), "[WARNING] [core] %llu log messages dropped",
+                    static_cast<unsigned long long>(numDroppedEntries));
+      output(Severity::WARNING, text);
+    }
+    std::fflush(stdout);
+  }
+
+  static void output(Severity severity, const char* text) {
+#if CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+    __android_log_write((severity == Severity::ERROR) ? ANDROID_LOG_ERROR : ANDROID_LOG_DEBUG,
+                        "vigilante", text);
+#else
+    (void) severity;
+    std::fputs(text, stdout);
+    std::fputc('\n', stdout);
+#endif
+  }
 
+  Entry _entries[LOG_RING_CAPACITY];
+  std::atomic<uint64_t> _enqueuePos;
+  uint64_t _dequeuePos;  // guarded by _consumerMutex
+  std::atomic<uint64_t> _numDroppedEntries;
+
+  std::atomic<Severity> _minSeverity;
+  std::atomic<uint32_t> _disabledTags[MAX_NUM_DISABLED_TAGS];  // 0 means a free slot
+  mutex _tagsMutex;  // serializes setTagEnabled()
+
+  // The producers never lock these. The consumer (the flush thread,
+  // or whoever calls flush()) locks _consumerMutex.
+  mutex _consumerMutex;
+  mutex _flushMutex;
+  std::condition_variable _flushCv;
+
+  std::thread _flushThread;
+};
+
+}  // namespace
+
+
+void setMinSeverity(Severity severity) {
+  Backend::getInstance()->setMinSeverity(severity);
+}
+
+void setTagEnabled(const std::string& tag, bool enabled) {
+  Backend::getInstance()->setTagEnabled(hashTag(tag.c_str(), static_cast<int>(tag.size())), enabled);
+}
+
+bool isEnabled(Severity severity, uint32_t tagHash) {
+  return Backend::getInstance()->isEnabled(severity, tagHash);
+}
+
+void write(Severity severity, const SourceLocation& location, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  Backend::getInstance()->push(severity, location, format, args);
+  va_end(args);
+}
+
+void flush() {
+  Backend::getInstance()->flush();
+}
+
+
+void segvHandler(int) {
   int fd = open(LOG_FILENAME, O_CREAT | O_WRONLY, 0600);
+
+  // The last messages (some of which may not have been flushed yet),
+  // and then the backtrace.
+  Backend::getInstance()->dumpRecentEntries(fd);
+
+  void* array[NUM_STACKTRACE_FUNC];
+  size_t size = backtrace(array, NUM_STACKTRACE_FUNC);
   backtrace_symbols_fd(array + 2, size - 2, fd);
   close(fd);
 
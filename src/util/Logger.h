@@ -2,7 +2,7 @@
 #ifndef VIGILANTE_LOGGER_H_
 #define VIGILANTE_LOGGER_H_
 
-#include <array>
+#include <cstdint>
 #include <string>
 #include <memory>
 
@@ -13,13 +13,20 @@
 #define LOG_WARN vigilante::logger::Severity::WARNING
 #define LOG_INFO vigilante::logger::Severity::INFO
 
-// Example usage: VGLOG(LOG_INFO, __FILE__, "test msg %d", 5);
-#define VGLOG(severity, format, ...)\
-  cocos2d::log("[%s] [%s: %d] " format,\
-      (vigilante::logger::_kSeverityStr[severity].c_str()),\
-      (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__),\
-      (__LINE__),\
-      ##__VA_ARGS__)
+// Example usage: VGLOG(LOG_INFO, "test msg %d", 5);
+//
+// The file name and the tag (the subsystem, i.e., the name of the directory
+// the file is in, e.g., "quest") are extracted from __FILE__ at compile time.
+// The message is only formatted if its severity and tag are enabled,
+// and it's written by a background thread, see logger::write().
+#define VGLOG(severity, format, ...) \
+  do { \
+    constexpr vigilante::logger::SourceLocation _vgLogLocation \
+      = vigilante::logger::makeSourceLocation(__FILE__, __LINE__); \
+    if (vigilante::logger::isEnabled(severity, _vgLogLocation.tagHash)) { \
+      vigilante::logger::write(severity, _vgLogLocation, format, ##__VA_ARGS__); \
+    } \
+  } while (0)
 
 
 namespace vigilante {
@@ -32,14 +39,70 @@ enum Severity {
   INFO,
   SIZE
 };
-const std::array<std::string, Severity::SIZE> _kSeverityStr = {{
+constexpr const char* _kSeverityStr[Severity::SIZE] = {
   "ERROR",
   "WARNING",
   "INFO"
-}};
+};
+
+struct SourceLocation final {
+  const char* fileName;  // without the directories
+  const char* tag;  // not null-terminated, see tagLength
+  int tagLength;
+  uint32_t tagHash;
+  int line;
+};
+
+// FNV-1a
+constexpr uint32_t hashTag(const char* tag, int length) {
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < length; i++) {
+    hash = (hash ^ static_cast<uint8_t>(tag[i])) * 16777619u;
+  }
+  return hash;
+}
+
+constexpr SourceLocation makeSourceLocation(const char* path, int line) {
+  const char* fileName = path;
+  const char* dirName = path;
+  for (const char* p = path; *p; p++) {
+    if (*p == '/' || *p == '\\') {
+      dirName = fileName;
+      fileName = p + 1;
+    }
+  }
+
+  // The files directly under src/ (the "src" tag) are tagged "core".
+  int tagLength = static_cast<int>(fileName - dirName) - 1;
+  if (tagLength <= 0 || (tagLength == 3 && dirName[0] == 's' && dirName[1] == 'r' && dirName[2] == 'c')) {
+    dirName = "core";
+    tagLength = 4;
+  }
+  return {fileName, dirName, tagLength, hashTag(dirName, tagLength), line};
+}
+
+
+// The messages less severe than `severity` are discarded (INFO by default).
+void setMinSeverity(Severity severity);
+// Enables or disables the messages of a subsystem, e.g., "quest".
+void setTagEnabled(const std::string& tag, bool enabled);
+bool isEnabled(Severity severity, uint32_t tagHash);
+
+// Formats the message into a lock-free ring buffer, which is flushed
+// to stdout (or logcat) by a background thread. It never blocks: if the
+// ring is full, the message is dropped (and counted). Safe to be called
+// from any thread.
+void write(Severity severity, const SourceLocation& location, const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
 
+// Writes out all of the buffered messages on the calling thread.
+void flush();
 
-// SIGSEGV handler
+// SIGSEGV handler. Writes the last buffered messages
+// and the backtrace to the log file.
 void segvHandler(int);
 
 } // namespace logger
@@ -0,0 +1,138 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "MainThread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util/ds/CircularBuffer.h"
+
+#define TASK_RING_CAPACITY 256
+
+using std::function;
+using std::lock_guard;
+using std::mutex;
+using std::unique_ptr;
+using std::vector;
+
+namespace vigilante {
+
+namespace main_thread {
+
+namespace {
+
+// Each thread which posts tasks gets its own ring, so posting a task is
+// lock-free unless the ring is full. The overflowing tasks go to
+// `overflowTasks`, and the thread keeps posting there until drain() has
+// taken them, so that its tasks are still run in the order posted.
+struct TaskRing final {
+  TaskRing() : tasks(TASK_RING_CAPACITY), hasOverflowed(), isRetired() {}
+
+  SpscCircularBuffer<function<void ()>> tasks;
+  std::atomic<bool> hasOverflowed;
+  std::atomic<bool> isRetired;  // the posting thread has exited
+};
+
+// Retires the ring of a posting thread when the thread exits, so that the
+// rings of short-lived threads (e.g., AssetLoader's workers) don't pile up.
+// drain() frees a retired ring once it has run the tasks left in it.
+struct TaskRingOwner final {
+  ~TaskRingOwner() {
+    if (taskRing) {
+      taskRing->isRetired.store(true, std::memory_order_release);
+    }
+  }
+
+  TaskRing* taskRing = nullptr;
+};
+
+std::thread::id mainThreadId;
+
+mutex tasksMutex;
+vector<unique_ptr<TaskRing>> taskRings;  // guarded by tasksMutex
+vector<function<void ()>> overflowTasks;  // guarded by tasksMutex
+thread_local TaskRingOwner currentTaskRingOwner;
+
+TaskRing* getCurrentTaskRing() {
+  if (!currentTaskRingOwner.taskRing) {
+    lock_guard<mutex> lock(tasksMutex);
+    taskRings.push_back(std::make_unique<TaskRing>());
+    currentTaskRingOwner.taskRing = taskRings.back().get();
+  }
+  return currentTaskRingOwner.taskRing;
+}
+
+// A retired ring won't be pushed to anymore, so it can be freed once it's
+// empty. `isRetired` is checked first, since the thread may push
+// its last tasks right before it exits. Must be called with tasksMutex held.
+void eraseRetiredTaskRings() {
+  taskRings.erase(std::remove_if(taskRings.begin(), taskRings.end(),
+                                 [](const unique_ptr<TaskRing>& taskRing) {
+    return taskRing->isRetired.load(std::memory_order_acquire) && taskRing->tasks.size() == 0;
+  }), taskRings.end());
+}
+
+}  // namespace
+
+void init() {
+  mainThreadId = std::this_thread::get_id();
+}
+
+bool isMainThread() {
+  return std::this_thread::get_id() == mainThreadId;
+}
+
+void post(const function<void ()>& task) {
+  TaskRing* taskRing = getCurrentTaskRing();
+  if (!taskRing->hasOverflowed.load(std::memory_order_acquire) && taskRing->tasks.tryPush(task)) {
+    return;
+  }
+
+  lock_guard<mutex> lock(tasksMutex);
+  overflowTasks.push_back(task);
+  taskRing->hasOverflowed.store(true, std::memory_order_release);
+}
+
+void drain() {
+  VGASSERT_MAIN_THREAD();
+
+  // Only the tasks posted before the overflowing ones are taken from the
+  // rings, and a task may post another task, which will be run in the next
+  // frame. Both are ensured by counting the tasks in each ring up front.
+  vector<function<void ()>> pendingOverflowTasks;
+  vector<size_t> numRingTasks;
+  {
+    lock_guard<mutex> lock(tasksMutex);
+    eraseRetiredTaskRings();
+    pendingOverflowTasks.swap(overflowTasks);
+    numRingTasks.reserve(taskRings.size());
+    for (const auto& taskRing : taskRings) {
+      numRingTasks.push_back(taskRing->tasks.size());
+      taskRing->hasOverflowed.store(false, std::memory_order_release);
+    }
+  }
+
+  function<void ()> task;
+  for (size_t i = 0; i < numRingTasks.size(); i++) {
+    // taskRings may grow while the tasks are run, but the rings
+    // counted above are only removed by the next drain().
+    TaskRing* taskRing = nullptr;
+    {
+      lock_guard<mutex> lock(tasksMutex);
+      taskRing = taskRings[i].get();
+    }
+    for (size_t j = 0; j < numRingTasks[i] && taskRing->tasks.tryPop(&task); j++) {
+      task();
+    }
+  }
+  for (const auto& overflowTask : pendingOverflowTasks) {
+    overflowTask();
+  }
+}
+
+} // namespace main_thread
+
+} // namespace vigilante
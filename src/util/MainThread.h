@@ -0,0 +1,30 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_MAIN_THREAD_H_
+#define VIGILANTE_MAIN_THREAD_H_
+
+#include <cassert>
+#include <functional>
+
+// cocos2d (Node, Director, TextureCache, ...) and box2d are not thread-safe,
+// so the helpers which touch them should assert that they're called on the
+// main thread. Like assert(), this is compiled out if NDEBUG is defined.
+#define VGASSERT_MAIN_THREAD() assert(vigilante::main_thread::isMainThread())
+
+namespace vigilante {
+
+namespace main_thread {
+
+// Must be called on the main thread before anything else in here.
+void init();
+bool isMainThread();
+
+// Tasks can be posted from any thread, and they are run by drain()
+// on the main thread (see GameScene::update()) in the order posted.
+void post(const std::function<void ()>& task);
+void drain();
+
+} // namespace main_thread
+
+} // namespace vigilante
+
+#endif // VIGILANTE_MAIN_THREAD_H_
@@ -0,0 +1,84 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+
+namespace vigilante {
+
+#ifdef _WIN32
+// There's no mmap() on windows, so we'll simply read the entire file into memory.
+MappedFile::MappedFile(const string& fileName) : _data(), _size() {
+  std::ifstream fin(fileName, std::ios::binary | std::ios::ate);
+  if (!fin.is_open()) {
+    return;
+  }
+
+  std::streamsize size = fin.tellg();
+  if (size <= 0) {
+    return;
+  }
+
+  char* buf = new char[size];
+  fin.seekg(0);
+  if (!fin.read(buf, size)) {
+    delete[] buf;
+    return;
+  }
+  _data = buf;
+  _size = size;
+}
+
+MappedFile::~MappedFile() {
+  delete[] _data;
+}
+
+#else
+MappedFile::MappedFile(const string& fileName) : _data(), _size() {
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      _data = static_cast<const char*>(addr);
+      _size = st.st_size;
+    }
+  }
+
+  // The mapping stays valid after the file descriptor is closed.
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (_data) {
+    munmap(const_cast<char*>(_data), _size);
+  }
+}
+#endif
+
+
+bool MappedFile::isOpen() const {
+  return _data != nullptr;
+}
+
+const char* MappedFile::getData() const {
+  return _data;
+}
+
+size_t MappedFile::getSize() const {
+  return _size;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,30 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_MAPPED_FILE_H_
+#define VIGILANTE_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace vigilante {
+
+// A read-only memory mapped file. The mapping is released
+// when the MappedFile object goes out of scope.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& fileName);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  virtual ~MappedFile();
+
+  bool isOpen() const;
+  const char* getData() const;
+  size_t getSize() const;
+
+ private:
+  const char* _data;
+  size_t _size;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_MAPPED_FILE_H_
@@ -0,0 +1,221 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "MemoryTracker.h"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+#include <cocos2d.h>
+#include "AnimationCache.h"
+#include "TextureResidency.h"
+#include "map/FxManager.h"
+#include "map/GameMap.h"
+#include "map/GameMapManager.h"
+#include "util/Logger.h"
+#include "util/ProfileCache.h"
+#include "util/Telemetry.h"
+
+#if CC_TARGET_PLATFORM == CC_PLATFORM_LINUX || CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+#include <unistd.h>
+#endif
+
+#define TEXTURE_TAG_PREFIX "texture:"
+
+using std::string;
+using std::ofstream;
+using std::istringstream;
+using cocos2d::Director;
+using cocos2d::Node;
+
+namespace vigilante {
+
+namespace {
+
+// Including the node itself.
+int64_t getNodeCount(const Node* node) {
+  int64_t count = 1;
+  for (const auto child : node->getChildren()) {
+    count += getNodeCount(child);
+  }
+  return count;
+}
+
+// The resident set size of this process in KB, or -1 if unknown.
+int64_t getResidentSetSize() {
+#if CC_TARGET_PLATFORM == CC_PLATFORM_LINUX || CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID
+  FILE* file = std::fopen("/proc/self/statm", "r");
+  if (!file) {
+    return -1;
+  }
+  long numTotalPages = 0;
+  long numResidentPages = 0;
+  const int numFields = std::fscanf(file, "%ld %ld", &numTotalPages, &numResidentPages);
+  std::fclose(file);
+  return (numFields == 2) ? static_cast<int64_t>(numResidentPages) * sysconf(_SC_PAGESIZE) / 1024 : -1;
+#else
+  return -1;
+#endif
+}
+
+// Calls `func` with each tag whose amount differs between `before` and `after`,
+// along with both amounts (0 if a snapshot doesn't have the tag).
+void forEachChange(const MemoryTracker::Snapshot& before,
+                   const MemoryTracker::Snapshot& after,
+                   const std::function<void (const string&, int64_t, int64_t)>& func) {
+  auto beforeIt = before.begin();
+  auto afterIt = after.begin();
+  while (beforeIt != before.end() || afterIt != after.end()) {
+    if (afterIt == after.end() || (beforeIt != before.end() && beforeIt->first < afterIt->first)) {
+      func(beforeIt->first, beforeIt->second, 0);
+      ++beforeIt;
+    } else if (beforeIt == before.end() || afterIt->first < beforeIt->first) {
+      func(afterIt->first, 0, afterIt->second);
+      ++afterIt;
+    } else {
+      if (beforeIt->second != afterIt->second) {
+        func(afterIt->first, beforeIt->second, afterIt->second);
+      }
+      ++beforeIt;
+      ++afterIt;
+    }
+  }
+}
+
+}  // namespace
+
+
+MemoryTracker* MemoryTracker::getInstance() {
+  static MemoryTracker instance;
+  return &instance;
+}
+
+MemoryTracker::MemoryTracker() : _snapshots() {}
+
+MemoryTracker::Snapshot MemoryTracker::takeSnapshot(const GameMap* gameMap) const {
+  Snapshot snapshot;
+
+  const int64_t residentSetSize = getResidentSetSize();
+  if (residentSetSize >= 0) {
+    snapshot["process.rss.kb"] = residentSetSize;
+  }
+
+  addTextureStats(&snapshot);
+  snapshot["spritesheets.resident"] = TextureResidency::getInstance()->getNumResidentSpritesheets();
+
+  const AnimationCache* animationCache = AnimationCache::getInstance();
+  snapshot["animations.cached"] = animationCache->size();
+  snapshot["animations.references"] = animationCache->getNumReferences();
+
+  const FxManager* fxManager = FxManager::getInstance();
+  snapshot["fx.animations"] = fxManager->getNumCachedAnimations();
+  snapshot["fx.pooledSprites"] = fxManager->getNumPooledSprites();
+  snapshot["fx.particles"] = GameMapManager::getInstance()->getParticleSystem()->getNumParticles();
+
+  snapshot["profiles.cached"] = profile_cache::size();
+  snapshot["portals.savedStates"] = GameMap::Portal::getNumSavedLockUnlockStates();
+
+  if (gameMap) {
+    const ActorRegistry& actors = gameMap->getDynamicActors();
+    snapshot["map.actors.npcs"] = actors.getGroup(ActorRegistry::Group::NPC).size();
+    snapshot["map.actors.items"] = actors.getGroup(ActorRegistry::Group::ITEM).size();
+    snapshot["map.actors.chests"] = actors.getGroup(ActorRegistry::Group::CHEST).size();
+    snapshot["map.actors.others"] = actors.getGroup(ActorRegistry::Group::OTHER).size();
+    snapshot["map.nodes"] = getNodeCount(gameMap->getTmxTiledMap());
+  }
+  if (const b2World* world = GameMapManager::getInstance()->getWorld()) {
+    snapshot["map.bodies"] = world->GetBodyCount();
+  }
+  snapshot["map.batchNodes"] = GameMapManager::getInstance()->getBatchNodeRegistry()->getNumBatchNodes();
+  return snapshot;
+}
+
+void MemoryTracker::onGameMapLoaded(const GameMap* gameMap) {
+  const string& tmxMapFileName = gameMap->getTmxTiledMapFileName();
+  Snapshot snapshot = takeSnapshot(gameMap);
+
+  auto it = _snapshots.find(tmxMapFileName);
+  if (it != _snapshots.end()) {
+    // The same GameMap should take as much memory as it did last time.
+    // The RSS is left out, since it's affected by the allocator as well.
+    int numGrownTags = 0;
+    forEachChange(it->second, snapshot,
+                  [&numGrownTags](const string& tag, int64_t before, int64_t after) {
+      if (after > before && tag != "process.rss.kb") {
+        VGLOG(LOG_WARN, "%s: %lld -> %lld", tag.c_str(),
+              static_cast<long long>(before), static_cast<long long>(after));
+        numGrownTags++;
+      }
+    });
+    if (numGrownTags > 0) {
+      VGLOG(LOG_WARN, "Possible leaks: %d tags have grown since %s was last loaded",
+            numGrownTags, tmxMapFileName.c_str());
+    }
+  }
+
+  // The per-texture tags would make the telemetry batches too large.
+  for (const auto& p : snapshot) {
+    if (p.first.compare(0, sizeof(TEXTURE_TAG_PREFIX) - 1, TEXTURE_TAG_PREFIX) != 0) {
+      Telemetry::getInstance()->updateHighWaterMark(p.first, p.second);
+    }
+  }
+  _snapshots[tmxMapFileName] = std::move(snapshot);
+}
+
+bool MemoryTracker::dumpReport(const string& fileName, const GameMap* gameMap) const {
+  ofstream fout(fileName, std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_ERR, "Unable to write memory report to: %s", fileName.c_str());
+    return false;
+  }
+
+  const Snapshot snapshot = takeSnapshot(gameMap);
+  fout << "tag,amount" << '\n';
+  for (const auto& p : snapshot) {
+    fout << p.first << ',' << p.second << '\n';
+  }
+
+  if (!gameMap) {
+    return true;
+  }
+  auto it = _snapshots.find(gameMap->getTmxTiledMapFileName());
+  if (it == _snapshots.end()) {
+    return true;
+  }
+
+  fout << '\n' << "tag,sinceMapLoad,atMapLoad,now" << '\n';
+  forEachChange(it->second, snapshot, [&fout](const string& tag, int64_t before, int64_t after) {
+    fout << tag << ',' << (after - before) << ',' << before << ',' << after << '\n';
+  });
+  return true;
+}
+
+
+void MemoryTracker::addTextureStats(Snapshot* snapshot) {
+  // TextureCache doesn't expose its textures, so parse its debug info, i.e.,
+  // "\"<path>\" rc=... id=... <w> x <h> @ <bpp> bpp => <size> KB" for each texture.
+  const string info = Director::getInstance()->getTextureCache()->getCachedTextureInfo();
+  istringstream iss(info);
+  string line;
+  int64_t numTextures = 0;
+  int64_t totalTextureMemory = 0;
+
+  while (std::getline(iss, line)) {
+    const size_t pathEnd = line.find('"', 1);
+    const size_t sizeBegin = line.rfind("=> ");
+    unsigned long textureMemory = 0;
+    if (line.empty() || line[0] != '"' || pathEnd == string::npos || sizeBegin == string::npos ||
+        std::sscanf(line.c_str() + sizeBegin, "=> %lu KB", &textureMemory) != 1) {
+      continue;
+    }
+
+    (*snapshot)[TEXTURE_TAG_PREFIX + line.substr(1, pathEnd - 1) + ".kb"] += textureMemory;
+    numTextures++;
+    totalTextureMemory += textureMemory;
+  }
+
+  (*snapshot)["textures.count"] = numTextures;
+  (*snapshot)["textures.total.kb"] = totalTextureMemory;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,50 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_MEMORY_TRACKER_H_
+#define VIGILANTE_MEMORY_TRACKER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace vigilante {
+
+class GameMap;
+
+// Accounts for the memory held by each subsystem, tagged by what holds it:
+// the texture memory of each atlas (in KB), the retained animations, the
+// cached profiles, the saved portal states, and the actors, nodes and
+// b2Bodies of the current GameMap.
+//
+// A snapshot is taken whenever a GameMap has been loaded (see
+// GameMapManager::doLoadGameMap()). If the same GameMap is loaded again
+// (e.g., after going back and forth through a portal), whatever has grown
+// since its last load is logged as a possible leak. The "memoryReport"
+// console command writes the diff since the last load of the current GameMap.
+//
+// All methods must be called on the main thread.
+class MemoryTracker final {
+ public:
+  // tag -> amount. Sorted, so that the reports are easier to read.
+  using Snapshot = std::map<std::string, int64_t>;
+
+  static MemoryTracker* getInstance();
+
+  Snapshot takeSnapshot(const GameMap* gameMap) const;
+
+  void onGameMapLoaded(const GameMap* gameMap);
+  bool dumpReport(const std::string& fileName, const GameMap* gameMap) const;
+
+ private:
+  MemoryTracker();
+
+  // The texture memory of each texture in the TextureCache.
+  static void addTextureStats(Snapshot* snapshot);
+
+  // tmx map file name -> the snapshot taken when it was last loaded.
+  std::unordered_map<std::string, Snapshot> _snapshots;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_MEMORY_TRACKER_H_
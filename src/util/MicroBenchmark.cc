@@ -0,0 +1,241 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "MicroBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <unordered_set>
+
+#include <cocos2d.h>
+#include "AssetManager.h"
+#include "util/JsonUtil.h"
+#include "util/KeyCodeUtil.h"
+#include "util/Logger.h"
+#include "util/StringUtil.h"
+#include "util/ds/CircularBuffer.h"
+#include "util/ds/FlatSet.h"
+#include "util/ds/SetVector.h"
+
+#define INITIAL_BATCH_SIZE 1
+#define MAX_BATCH_SIZE (1 << 24)
+
+using std::deque;
+using std::function;
+using std::ofstream;
+using std::string;
+using std::unordered_set;
+using std::vector;
+using cocos2d::EventKeyboard;
+
+namespace vigilante {
+
+namespace micro_benchmark {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The results of the cases are accumulated here, so that
+// the compiler cannot optimize their bodies away.
+volatile size_t sink;
+
+struct Case final {
+  string name;
+  function<void ()> body;  // a single iteration
+};
+
+// The std::unordered_set + std::vector pair which used
+// to back the actor sets before SetVector was written.
+template <typename Key>
+class HashSetVector final {
+ public:
+  void insert(Key key) {
+    if (_set.insert(key).second) {
+      _vec.push_back(key);
+    }
+  }
+
+  void erase(Key key) {
+    if (_set.erase(key)) {
+      _vec.erase(std::find(_vec.begin(), _vec.end(), key));
+    }
+  }
+
+  bool contains(Key key) const { return _set.count(key); }
+  typename vector<Key>::const_iterator begin() const { return _vec.begin(); }
+  typename vector<Key>::const_iterator end() const { return _vec.end(); }
+
+ private:
+  unordered_set<Key> _set;
+  vector<Key> _vec;
+};
+
+// Inserts `n` keys, looks each of them up, iterates
+// over the set, and then erases them in a different order.
+template <typename Set>
+void exerciseSet(int n) {
+  Set set;
+  for (int i = 0; i < n; i++) {
+    set.insert(static_cast<uintptr_t>(i * 64 + 16));
+  }
+  size_t sum = 0;
+  for (int i = 0; i < n; i++) {
+    sum += set.contains(static_cast<uintptr_t>(i * 64 + 16));
+  }
+  for (auto key : set) {
+    sum += key;
+  }
+  for (int i = n - 1; i >= 0; i -= 2) {
+    set.erase(static_cast<uintptr_t>(i * 64 + 16));
+  }
+  for (int i = n - 2; i >= 0; i -= 2) {
+    set.erase(static_cast<uintptr_t>(i * 64 + 16));
+  }
+  sink += sum;
+}
+
+// std::deque bounded the way CircularBuffer is,
+// which drops its oldest element when it's full.
+class BoundedDeque final {
+ public:
+  explicit BoundedDeque(size_t capacity) : _capacity(capacity) {}
+
+  void push(int val) {
+    if (_deque.size() == _capacity) {
+      _deque.pop_front();
+    }
+    _deque.push_back(val);
+  }
+
+  int front() const { return _deque.front(); }
+
+ private:
+  deque<int> _deque;
+  const size_t _capacity;
+};
+
+vector<Case> getCases() {
+  vector<Case> cases;
+
+  // The sizes of the actor sets and the inventory tabs in practice.
+  for (int n : {8, 32, 128}) {
+    const string suffix = "/" + std::to_string(n);
+    cases.push_back({"SetVector" + suffix, [n]() { exerciseSet<SetVector<uintptr_t>>(n); }});
+    cases.push_back({"FlatSet" + suffix, [n]() { exerciseSet<FlatSet<uintptr_t>>(n); }});
+    cases.push_back({"unordered_set+vector" + suffix, [n]() { exerciseSet<HashSetVector<uintptr_t>>(n); }});
+  }
+
+  // The size of the console history and the notification queue.
+  cases.push_back({"CircularBuffer/16", []() {
+    static CircularBuffer<int> buffer(16);
+    for (int i = 0; i < 64; i++) {
+      buffer.push(i);
+    }
+    sink += buffer.front();
+  }});
+  cases.push_back({"deque/16", []() {
+    static BoundedDeque buffer(16);
+    for (int i = 0; i < 64; i++) {
+      buffer.push(i);
+    }
+    sink += buffer.front();
+  }});
+
+  cases.push_back({"string_util::format", []() {
+    const string s = string_util::format("Acquired item: %s (%d)", "Royal Crossbow", 3);
+    sink += s.size();
+  }});
+  cases.push_back({"string_util::formatTo", []() {
+    char buf[128];
+    sink += string_util::formatTo(buf, "Acquired item: %s (%d)", "Royal Crossbow", 3)[0];
+  }});
+  cases.push_back({"string_util::split", []() {
+    static const string cmd = "addItem Resources/Database/item/equipment/royal_crossbow.json 1";
+    sink += string_util::split(cmd).size();
+  }});
+
+  cases.push_back({"keycode_util::keyCodeToString", []() {
+    sink += keycode_util::keyCodeToString(EventKeyboard::KeyCode::KEY_LEFT_CTRL).size();
+  }});
+  cases.push_back({"keycode_util::keyCodeToAscii", []() {
+    sink += keycode_util::keyCodeToAscii(EventKeyboard::KeyCode::KEY_A, false, true);
+  }});
+
+  cases.push_back({"json_util::JsonDocument", []() {
+    json_util::JsonDocument document(asset_manager::kPlayerJson);
+    sink += document.get().MemberCount();
+  }});
+
+  return cases;
+}
+
+Result measure(const Case& c, float minTime) {
+  const auto minDuration = std::chrono::duration<double>(minTime);
+  c.body();  // warm up the caches and any lazily built tables.
+
+  uint64_t batchSize = INITIAL_BATCH_SIZE;
+  while (true) {
+    const Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < batchSize; i++) {
+      c.body();
+    }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    if (elapsed >= minDuration || batchSize >= MAX_BATCH_SIZE) {
+      const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+      return {c.name, batchSize, ns / batchSize};
+    }
+    batchSize *= 2;
+  }
+}
+
+}  // namespace
+
+
+vector<Result> run(float minTime, const string& filter) {
+  vector<Result> results;
+
+  for (const auto& c : getCases()) {
+    if (!filter.empty() && !string_util::contains(c.name, filter)) {
+      continue;
+    }
+    try {
+      results.push_back(measure(c, minTime));
+    } catch (const std::runtime_error& ex) {
+      VGLOG(LOG_ERR, "Micro benchmark %s failed: %s", c.name.c_str(), ex.what());
+      continue;
+    }
+    VGLOG(LOG_INFO, "Micro benchmark %s: %.1f ns/iteration (%llu iterations)",
+          results.back().name.c_str(), results.back().nsPerIteration,
+          static_cast<unsigned long long>(results.back().iterations));
+  }
+
+  return results;
+}
+
+bool writeResults(const vector<Result>& results, const string& fileName) {
+  ofstream fout(fileName, std::ios::trunc);
+  if (!fout.is_open()) {
+    VGLOG(LOG_ERR, "Unable to write micro benchmark results to: %s", fileName.c_str());
+    return false;
+  }
+
+  fout << "{\n";
+  fout << "  \"benchmarks\": [";
+
+  for (size_t i = 0; i < results.size(); i++) {
+    fout << ((i == 0) ? "\n" : ",\n");
+    fout << "    {\"name\": \"" << results[i].name << "\", "
+         << "\"iterations\": " << results[i].iterations << ", "
+         << "\"nsPerIteration\": " << results[i].nsPerIteration << "}";
+  }
+
+  fout << "\n  ]\n}\n";
+  return true;
+}
+
+}  // namespace micro_benchmark
+
+}  // namespace vigilante
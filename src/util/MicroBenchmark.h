@@ -0,0 +1,41 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_MICRO_BENCHMARK_H_
+#define VIGILANTE_MICRO_BENCHMARK_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vigilante {
+
+// Measures the containers and the string utilities which sit on the hot paths
+// (the actor sets, the inventories, the notifications, the trigger commands),
+// so that a change to any of them can be backed by numbers, e.g., by running
+// `microbench` from the console (or with --headless --exec) before and after.
+//
+// Each case runs its body in batches of doubling size until `minTime` has
+// passed (like Google Benchmark does), and reports the time per iteration.
+// Where there's an alternative data structure for the same job (e.g., the
+// std::unordered_set + std::vector pair which SetVector replaced), it's
+// measured alongside with the same workload.
+//
+// Must be called on the main thread, which is blocked while it runs.
+namespace micro_benchmark {
+
+struct Result final {
+  std::string name;
+  uint64_t iterations;
+  double nsPerIteration;
+};
+
+// Runs the cases whose names contain `filter` (all of them if it's empty).
+std::vector<Result> run(float minTime, const std::string& filter="");
+
+// Writes `results` as json. Returns false on failure.
+bool writeResults(const std::vector<Result>& results, const std::string& fileName);
+
+}  // namespace micro_benchmark
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_MICRO_BENCHMARK_H_
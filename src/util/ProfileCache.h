@@ -0,0 +1,91 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_PROFILE_CACHE_H_
+#define VIGILANTE_PROFILE_CACHE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vigilante {
+
+namespace profile_cache {
+
+namespace internal {
+
+// One for each type of Profile that has ever been cached.
+inline std::vector<std::function<void (const std::string&)>>& getInvalidators() {
+  static std::vector<std::function<void (const std::string&)>> invalidators;
+  return invalidators;
+}
+
+inline std::vector<std::function<size_t ()>>& getSizers() {
+  static std::vector<std::function<size_t ()>> sizers;
+  return sizers;
+}
+
+template <typename Profile>
+std::unordered_map<std::string, std::shared_ptr<const Profile>>& getProfiles() {
+  static std::unordered_map<std::string, std::shared_ptr<const Profile>> profiles;
+  static bool isInvalidatorRegistered = false;
+
+  if (!isInvalidatorRegistered) {
+    isInvalidatorRegistered = true;
+    getInvalidators().push_back([](const std::string& jsonFileName) {
+      getProfiles<Profile>().erase(jsonFileName);
+    });
+    getSizers().push_back([]() {
+      return getProfiles<Profile>().size();
+    });
+  }
+  return profiles;
+}
+
+}  // namespace internal
+
+// Returns the Profile (e.g., Character::Profile, Item::Profile) parsed from
+// `jsonFileName`. Each json file is only parsed the first time its profile is
+// requested, and the parsed profile is kept for the whole process, so that
+// respawned Npcs, dropped items, and chest contents reuse the parsed data.
+//
+// The cached profiles are immutable. The actors copy them into their own
+// (mutable) profiles, e.g., _characterProfile(*profile_cache::get<...>(...)),
+// except the items, which share them as prototypes (see Item::_itemProfile).
+//
+// `Profile` must be constructible from the json file name.
+// Must be called on the main thread.
+template <typename Profile>
+std::shared_ptr<const Profile> get(const std::string& jsonFileName) {
+  auto& profiles = internal::getProfiles<Profile>();
+
+  auto it = profiles.find(jsonFileName);
+  if (it == profiles.end()) {
+    it = profiles.insert({jsonFileName, std::make_shared<const Profile>(jsonFileName)}).first;
+  }
+  return it->second;
+}
+
+// Drops all types of profiles parsed from `jsonFileName`, so that they
+// will be parsed again the next time they're requested (see HotReloader).
+// Must be called on the main thread.
+inline void invalidate(const std::string& jsonFileName) {
+  for (const auto& invalidator : internal::getInvalidators()) {
+    invalidator(jsonFileName);
+  }
+}
+
+// Returns the number of profiles cached, of all types (see MemoryTracker).
+inline size_t size() {
+  size_t numProfiles = 0;
+  for (const auto& sizer : internal::getSizers()) {
+    numProfiles += sizer();
+  }
+  return numProfiles;
+}
+
+}  // namespace profile_cache
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_PROFILE_CACHE_H_
@@ -1,23 +1,95 @@
 // Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
 #include "RandUtil.h"
 
-#include <ctime>
-#include <random>
+#include <array>
+#include <chrono>
+
+using std::array;
 
 namespace vigilante {
 
 namespace rand_util {
 
+namespace {
+
+uint64_t masterSeed;
+array<Generator, Stream::STREAM_SIZE> streams;
+
+// splitmix64, used to expand a seed into the state of a generator.
+uint64_t splitMix64(uint64_t& x) {
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+}  // namespace
+
+
+Generator::Generator(uint64_t seed) : _state() {
+  _state[0] = splitMix64(seed);
+  _state[1] = splitMix64(seed);
+}
+
+uint64_t Generator::next() {
+  const uint64_t s0 = _state[0];
+  uint64_t s1 = _state[1];
+  const uint64_t result = s0 + s1;
+
+  s1 ^= s0;
+  _state[0] = rotl(s0, 24) ^ s1 ^ (s1 << 16);
+  _state[1] = rotl(s1, 37);
+  return result;
+}
+
+int Generator::randInt(int min, int max) {
+  // The low bits of xoroshiro128+ are weak, so only the high 32 bits are
+  // used, and mapped onto the range with a multiply instead of a modulo.
+  const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min + 1);
+  return min + static_cast<int>(((next() >> 32) * range) >> 32);
+}
+
+float Generator::randFloat(float min, float max) {
+  // 24 random bits fill the mantissa of a float in [0, 1).
+  const float r = static_cast<float>(next() >> 40) * (1.0f / 16777216.0f);
+  return r * (max - min) + min;
+}
+
+
 void init() {
-  srand(time(nullptr));
+  seed(static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count()));
+}
+
+void seed(uint64_t seed) {
+  masterSeed = seed;
+  for (int i = 0; i < Stream::STREAM_SIZE; i++) {
+    streams[i] = fork(static_cast<Stream>(i), 0);
+  }
+}
+
+uint64_t getSeed() {
+  return masterSeed;
+}
+
+Generator& getStream(Stream stream) {
+  return streams[stream];
+}
+
+Generator fork(Stream stream, uint64_t key) {
+  uint64_t x = masterSeed ^ (static_cast<uint64_t>(stream) << 56);
+  return Generator(splitMix64(x) ^ key);
 }
 
-int randInt(int min, int max) {
-  return (rand() % (max + 1 - min)) + min;
+int randInt(int min, int max, Stream stream) {
+  return streams[stream].randInt(min, max);
 }
 
-float randFloat(float min, float max) {
-  return (float(rand()) / (float(RAND_MAX) + 1.0)) * (max - min) + min;
+float randFloat(float min, float max, Stream stream) {
+  return streams[stream].randFloat(min, max);
 }
 
 } // namespace rand_util
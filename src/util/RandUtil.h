@@ -2,13 +2,56 @@
 #ifndef VIGILANTE_RAND_UTIL_H_
 #define VIGILANTE_RAND_UTIL_H_
 
+#include <cstdint>
+
 namespace vigilante {
 
 namespace rand_util {
 
+// Each subsystem draws its random numbers from its own stream, so that
+// e.g., the camera shake doesn't change the loot of the next kill.
+// All the streams are derived from a single seed (see seed()), which
+// makes a session reproducible for replays and benchmarks.
+enum Stream {
+  DEFAULT,
+  AI,
+  LOOT,
+  ITEM,
+  CAMERA,
+  FX,
+  STREAM_SIZE
+};
+
+// A xoroshiro128+ generator. It is small and cheap to copy, so a job which
+// runs off the main thread (e.g., Npc::think()) should own a Generator
+// obtained from fork() instead of sharing the streams below.
+class Generator final {
+ public:
+  explicit Generator(uint64_t seed=0);
+
+  uint64_t next();
+  int randInt(int min=0, int max=1);  // [min, max]
+  float randFloat(float min=0.0f, float max=1.0f);  // [min, max)
+
+ private:
+  uint64_t _state[2];
+};
+
+// Seeds all the streams with the current time.
 void init();
-int randInt(int min=0, int max=1);
-float randFloat(float min=0.0f, float max=1.0f);
+
+void seed(uint64_t seed);
+uint64_t getSeed();
+
+// The streams are meant to be used on the main thread only.
+Generator& getStream(Stream stream);
+
+// Returns a generator which is independent of all the streams, and of
+// any other generator forked with a different `key`.
+Generator fork(Stream stream, uint64_t key);
+
+int randInt(int min=0, int max=1, Stream stream=Stream::DEFAULT);
+float randFloat(float min=0.0f, float max=1.0f, Stream stream=Stream::DEFAULT);
 
 } // namespace rand_util
 
@@ -0,0 +1,168 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_SMALL_FUNCTION_H_
+#define VIGILANTE_SMALL_FUNCTION_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace vigilante {
+
+// A copyable type-erased callable like std::function, but the callables
+// of up to `Capacity` bytes (e.g., lambdas capturing a few pointers, or an
+// std::function itself) are stored inline rather than on the heap.
+// Larger callables still fall back to the heap.
+
+template <typename Signature, size_t Capacity = 48>
+class SmallFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class SmallFunction<R (Args...), Capacity> {
+ public:
+  SmallFunction() noexcept : _storage(), _ops() {}
+  SmallFunction(std::nullptr_t) noexcept : SmallFunction() {}
+
+  template <typename Func,
+            typename = typename std::enable_if<
+              !std::is_same<typename std::decay<Func>::type, SmallFunction>::value>::type>
+  SmallFunction(Func&& func) : SmallFunction() {
+    using Callable = typename std::decay<Func>::type;
+    ::new (&_storage) Storage<Callable>(std::forward<Func>(func));
+    _ops = &Ops<Callable>::_kOps;
+  }
+
+  SmallFunction(const SmallFunction& other) : SmallFunction() {
+    if (other._ops) {
+      other._ops->copy(&_storage, &other._storage);
+      _ops = other._ops;
+    }
+  }
+
+  SmallFunction(SmallFunction&& other) noexcept : SmallFunction() {
+    if (other._ops) {
+      other._ops->move(&_storage, &other._storage);
+      _ops = other._ops;
+      other.reset();
+    }
+  }
+
+  SmallFunction& operator=(const SmallFunction& other) {
+    if (this != &other) {
+      SmallFunction copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  SmallFunction& operator=(SmallFunction&& other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other._ops) {
+        other._ops->move(&_storage, &other._storage);
+        _ops = other._ops;
+        other.reset();
+      }
+    }
+    return *this;
+  }
+
+  SmallFunction& operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  ~SmallFunction() {
+    reset();
+  }
+
+
+  R operator()(Args... args) const {
+    return _ops->invoke(&_storage, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept {
+    return _ops != nullptr;
+  }
+
+ private:
+  using Buffer = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+  struct OpsTable final {
+    R (*invoke)(const void* storage, Args&&... args);
+    void (*copy)(void* dest, const void* src);
+    void (*move)(void* dest, void* src);  // leaves `src` to be destroyed
+    void (*destroy)(void* storage);
+  };
+
+  // Holds the callable inline if it fits (and can be moved without throwing),
+  // otherwise holds a pointer to it.
+  template <typename Callable>
+  using IsInline = std::integral_constant<bool,
+    sizeof(Callable) <= Capacity && alignof(Callable) <= alignof(std::max_align_t) &&
+    std::is_nothrow_move_constructible<Callable>::value>;
+
+  template <typename Callable, bool = IsInline<Callable>::value>
+  struct Storage;
+
+  template <typename Callable>
+  struct Storage<Callable, true> {
+    template <typename Func>
+    explicit Storage(Func&& func) : callable(std::forward<Func>(func)) {}
+    Callable& get() { return callable; }
+    Callable callable;
+  };
+
+  template <typename Callable>
+  struct Storage<Callable, false> {
+    template <typename Func>
+    explicit Storage(Func&& func) : callable(new Callable(std::forward<Func>(func))) {}
+    Storage(const Storage& other) : callable(new Callable(*other.callable)) {}
+    Storage(Storage&& other) noexcept : callable(other.callable) { other.callable = nullptr; }
+    ~Storage() { delete callable; }
+    Callable& get() { return *callable; }
+    Callable* callable;
+  };
+
+  template <typename Callable>
+  struct Ops final {
+    static R invoke(const void* storage, Args&&... args) {
+      auto s = static_cast<Storage<Callable>*>(const_cast<void*>(storage));
+      return s->get()(std::forward<Args>(args)...);
+    }
+    static void copy(void* dest, const void* src) {
+      ::new (dest) Storage<Callable>(*static_cast<const Storage<Callable>*>(src));
+    }
+    static void move(void* dest, void* src) {
+      ::new (dest) Storage<Callable>(std::move(*static_cast<Storage<Callable>*>(src)));
+    }
+    static void destroy(void* storage) {
+      static_cast<Storage<Callable>*>(storage)->~Storage<Callable>();
+    }
+
+    static const OpsTable _kOps;
+  };
+
+  void reset() noexcept {
+    if (_ops) {
+      _ops->destroy(&_storage);
+      _ops = nullptr;
+    }
+  }
+
+  static_assert(Capacity >= sizeof(void*), "SmallFunction must be able to hold a pointer");
+
+  mutable Buffer _storage;
+  const OpsTable* _ops;
+};
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename Callable>
+const typename SmallFunction<R (Args...), Capacity>::OpsTable
+SmallFunction<R (Args...), Capacity>::Ops<Callable>::_kOps = {
+  &Ops<Callable>::invoke, &Ops<Callable>::copy, &Ops<Callable>::move, &Ops<Callable>::destroy
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_SMALL_FUNCTION_H_
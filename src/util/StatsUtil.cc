@@ -0,0 +1,30 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "StatsUtil.h"
+
+using std::ostream;
+using std::vector;
+
+namespace vigilante {
+
+namespace stats_util {
+
+void writePercentiles(ostream& os, vector<float> samples) {
+  // Sorted once here rather than partially sorted for each percentile.
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](float percentile) -> float {
+    if (samples.empty()) {
+      return 0;
+    }
+    return samples[std::min(samples.size() - 1,
+                            static_cast<size_t>(samples.size() * percentile / 100))];
+  };
+
+  os << "\"p50Ms\": " << at(50) << ", "
+     << "\"p90Ms\": " << at(90) << ", "
+     << "\"p99Ms\": " << at(99) << ", "
+     << "\"maxMs\": " << at(100);
+}
+
+}  // namespace stats_util
+
+}  // namespace vigilante
@@ -0,0 +1,47 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_STATS_UTIL_H_
+#define VIGILANTE_STATS_UTIL_H_
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+namespace vigilante {
+
+namespace stats_util {
+
+// Returns the `percentile`-th (0~100) percentile of `samples`, or 0 if
+// there are no samples. `samples` is taken by value, since it's reordered.
+template <typename T>
+float getPercentile(std::vector<T> samples, float percentile) {
+  if (samples.empty()) {
+    return 0;
+  }
+  const size_t i = std::min(samples.size() - 1,
+                            static_cast<size_t>(samples.size() * percentile / 100));
+  std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+  return static_cast<float>(samples[i]);
+}
+
+template <typename T>
+float getAverage(const std::vector<T>& samples) {
+  if (samples.empty()) {
+    return 0;
+  }
+  double sum = 0;
+  for (const auto& sample : samples) {
+    sum += sample;
+  }
+  return static_cast<float>(sum / samples.size());
+}
+
+// Writes the p50, p90, p99 and max of `samples` (in ms) as the members of
+// a json object, e.g., "p50Ms": 1.2, "p90Ms": 2.5, "p99Ms": 4, "maxMs": 7.1
+// which is the summary of a section in the benchmarks' result files.
+void writePercentiles(std::ostream& os, std::vector<float> samples);
+
+}  // namespace stats_util
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_STATS_UTIL_H_
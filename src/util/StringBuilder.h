@@ -0,0 +1,101 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_STRING_BUILDER_H_
+#define VIGILANTE_STRING_BUILDER_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace vigilante {
+
+// Builds a string of up to `Capacity` - 1 chars in a fixed buffer, e.g.,
+// the text of a UI label, without any heap allocation. Whatever doesn't fit
+// is truncated (see isTruncated()). The result may be copied into a string
+// which is reused across frames with assignTo(), which doesn't allocate
+// either once the string has grown large enough.
+
+template <size_t Capacity>
+class StringBuilder {
+ public:
+  StringBuilder() : _buf(), _size(), _isTruncated() {}
+  virtual ~StringBuilder() = default;
+
+  StringBuilder& append(const char* s) {
+    return append(s, std::strlen(s));
+  }
+
+  StringBuilder& append(const std::string& s) {
+    return append(s.data(), s.size());
+  }
+
+  StringBuilder& append(const char* s, size_t len) {
+    const size_t n = std::min(len, Capacity - 1 - _size);
+    std::memcpy(_buf + _size, s, n);
+    _size += n;
+    _buf[_size] = '\0';
+    _isTruncated |= n < len;
+    return *this;
+  }
+
+  StringBuilder& append(char c) {
+    return append(&c, 1);
+  }
+
+  StringBuilder& append(int i) {
+    return appendFormat("%d", i);
+  }
+
+  template <typename... Args>
+  StringBuilder& appendFormat(const char* fmt, Args... args) {
+    const int len = std::snprintf(_buf + _size, Capacity - _size, fmt, args...);
+    if (len < 0) {
+      _buf[_size] = '\0';
+      return *this;
+    }
+    if (_size + len >= Capacity) {
+      _size = Capacity - 1;
+      _isTruncated = true;
+    } else {
+      _size += len;
+    }
+    return *this;
+  }
+
+  void clear() {
+    _buf[0] = '\0';
+    _size = 0;
+    _isTruncated = false;
+  }
+
+  void assignTo(std::string* s) const {
+    s->assign(_buf, _size);
+  }
+
+  const char* c_str() const {
+    return _buf;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  bool empty() const {
+    return _size == 0;
+  }
+
+  bool isTruncated() const {
+    return _isTruncated;
+  }
+
+ private:
+  static_assert(Capacity > 0, "StringBuilder must be able to hold the terminating null character");
+
+  char _buf[Capacity];
+  size_t _size;
+  bool _isTruncated;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_STRING_BUILDER_H_
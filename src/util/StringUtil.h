@@ -2,6 +2,7 @@
 #ifndef VIGILANTE_STRING_UTIL_H_
 #define VIGILANTE_STRING_UTIL_H_
 
+#include <cstdio>
 #include <cstring>
 #include <memory>
 #include <string>
@@ -16,6 +17,13 @@ namespace string_util {
 template <typename... Args>
 std::string format(const std::string& fmt, Args&&... args); 
 
+// Same as format(), but writes into the caller's buffer (truncating the
+// result if it doesn't fit) without any heap allocation, and returns `buf`.
+// e.g., char buf[128];
+//       notifications->show(string_util::formatTo(buf, "Acquired %d exp", exp));
+template <size_t N, typename... Args>
+const char* formatTo(char (&buf)[N], const char* fmt, Args... args);
+
 std::vector<std::string> split(const std::string& s, const char delimiter=' ');
 bool startsWith(const std::string& s, const std::string& keyword);
 bool contains(const std::string& s, const std::string& keyword);
@@ -33,14 +41,32 @@ std::string string_util::format(const std::string& fmt, Args&&... args) {
   // std::snprintf(dest, n, fmt, ...) returns the number of chars
   // that will be actually written into `dest` if `n` is large enough,
   // not counting the terminating null character.
-  const int bufSize
-    = 1 + std::snprintf(nullptr, 0, fmt.c_str(), std::forward<Args>(args)...);
+  //
+  // Most of the formatted strings are short, so they're written into
+  // a stack buffer first, and formatted again only if they don't fit.
+  char stackBuf[256];
+  const int len = std::snprintf(stackBuf, sizeof(stackBuf), fmt.c_str(), args...);
+  if (len <= 0) {
+    return "";
+  }
+  if (static_cast<size_t>(len) < sizeof(stackBuf)) {
+    return std::string(stackBuf, len);
+  }
 
-  const auto buf = std::make_unique<char[]>(bufSize);
-  std::memset(buf.get(), 0x00, bufSize);
+  // Write into the string directly (including the terminating null
+  // character, which std::string already has room for).
+  std::string s(len, '\0');
+  std::snprintf(&s[0], len + 1, fmt.c_str(), args...);
+  return s;
+}
 
-  return (std::snprintf(buf.get(), bufSize, fmt.c_str(),
-          std::forward<Args>(args)...) > 0) ? std::string(buf.get()) : "";
+template <size_t N, typename... Args>
+const char* string_util::formatTo(char (&buf)[N], const char* fmt, Args... args) {
+  static_assert(N > 0, "The buffer must be able to hold the terminating null character");
+  if (std::snprintf(buf, N, fmt, args...) < 0) {
+    buf[0] = '\0';
+  }
+  return buf;
 }
 
 }  // namespace vigilante
@@ -0,0 +1,301 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <cocos2d.h>
+#ifdef VIGILANTE_TELEMETRY_URL
+#include <network/HttpClient.h>
+#endif
+#include "util/FramePacer.h"
+#include "util/Logger.h"
+#include "util/MainThread.h"
+#include "util/StringUtil.h"
+#include "util/ThreadPool.h"
+
+#define TELEMETRY_SPOOL_DIR "telemetry/"
+#define TELEMETRY_ENABLED_KEY "telemetryEnabled"
+
+using std::string;
+using std::vector;
+using std::ofstream;
+using cocos2d::FileUtils;
+using cocos2d::UserDefault;
+
+namespace vigilante {
+
+const size_t Telemetry::_kNumFrameTimeBuckets;
+const std::array<float, Telemetry::_kNumFrameTimeBuckets - 1> Telemetry::_kFrameTimeBucketEdges = {{
+  8.0f, 12.0f, 16.7f, 20.0f, 25.0f, 33.4f, 50.0f, 66.7f, 100.0f, 250.0f
+}};
+const float Telemetry::_kBatchDuration = 600.0f;
+const float Telemetry::_kMinRetryInterval = 30.0f;
+const float Telemetry::_kMaxRetryInterval = 1800.0f;
+const size_t Telemetry::_kMaxSpooledBatches = 16;
+
+Telemetry* Telemetry::getInstance() {
+  static Telemetry instance;
+  return &instance;
+}
+
+Telemetry::Telemetry()
+    : _isEnabled(),
+      _batch(createBatch()),
+      _spoolDir(),
+      _spooledBatches(),
+      _numFlushes(),
+      _isUploading(),
+      _retryInterval(_kMinRetryInterval),
+      _retryTimer() {}
+
+
+void Telemetry::init() {
+  VGASSERT_MAIN_THREAD();
+
+  _isEnabled = UserDefault::getInstance()->getBoolForKey(TELEMETRY_ENABLED_KEY, false);
+  _spoolDir = FileUtils::getInstance()->getWritablePath() + TELEMETRY_SPOOL_DIR;
+  if (!_isEnabled) {
+    return;
+  }
+
+  FileUtils::getInstance()->createDirectory(_spoolDir);
+  vector<string> files = FileUtils::getInstance()->listFiles(_spoolDir);
+  std::sort(files.begin(), files.end());  // the file names start with the time of the flush
+  for (const auto& file : files) {
+    if (file.size() > 5 && file.compare(file.size() - 5, 5, ".json") == 0) {
+      _spooledBatches.push_back(file);
+    }
+  }
+  upload();
+}
+
+void Telemetry::update(float delta) {
+  if (!_isEnabled) {
+    return;
+  }
+
+  if (_batch.duration >= _kBatchDuration) {
+    flush();
+  }
+
+  if (_retryTimer > 0) {
+    _retryTimer -= delta;
+    if (_retryTimer <= 0) {
+      upload();
+    }
+  }
+}
+
+void Telemetry::flush() {
+  VGASSERT_MAIN_THREAD();
+
+  if (!_isEnabled || (_batch.duration == 0 && _batch.mapLoadTimes.empty() &&
+                      _batch.startupPhases.empty())) {
+    return;
+  }
+
+  const long long now = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  const string filePath = _spoolDir + string_util::format("%012lld_%03d.json", now, _numFlushes++ % 1000);
+  auto data = std::make_shared<string>(serialize(_batch));
+  _batch = createBatch();
+
+  auto isWritten = std::make_shared<bool>(false);
+  ThreadPool::getInstance()->post([filePath, data, isWritten]() {
+    ofstream fout(filePath, std::ios::trunc);
+    fout << *data;
+    *isWritten = static_cast<bool>(fout);
+  }, [this, filePath, isWritten]() {
+    if (!*isWritten) {
+      VGLOG(LOG_ERR, "Unable to spool the telemetry to: %s", filePath.c_str());
+      return;
+    }
+
+    _spooledBatches.push_back(filePath);
+    // The oldest batch can't be dropped while it's being uploaded.
+    const size_t oldest = (_isUploading) ? 1 : 0;
+    while (_spooledBatches.size() > _kMaxSpooledBatches) {
+      FileUtils::getInstance()->removeFile(_spooledBatches[oldest]);
+      _spooledBatches.erase(_spooledBatches.begin() + oldest);
+    }
+    upload();
+  });
+}
+
+
+void Telemetry::addFrameTime(float frameTime) {
+  if (!_isEnabled) {
+    return;
+  }
+
+  const float ms = frameTime * 1000;
+  const auto it = std::lower_bound(_kFrameTimeBucketEdges.begin(), _kFrameTimeBucketEdges.end(), ms);
+  _batch.frameTimeHistogram[it - _kFrameTimeBucketEdges.begin()]++;
+  _batch.frameTimeMax = std::max(_batch.frameTimeMax, ms);
+  _batch.duration += frameTime;
+}
+
+void Telemetry::addMapLoadTime(const string& tmxMapFileName, float loadTime) {
+  if (_isEnabled) {
+    _batch.mapLoadTimes.push_back({tmxMapFileName, loadTime});
+  }
+}
+
+void Telemetry::addStartupPhase(const string& name, float time) {
+  if (_isEnabled) {
+    _batch.startupPhases.push_back({name, time});
+  }
+}
+
+void Telemetry::updateHighWaterMark(const string& tag, int64_t value) {
+  if (!_isEnabled) {
+    return;
+  }
+
+  auto it = _batch.highWaterMarks.find(tag);
+  if (it == _batch.highWaterMarks.end()) {
+    _batch.highWaterMarks.insert({tag, value});
+  } else {
+    it->second = std::max(it->second, value);
+  }
+}
+
+
+bool Telemetry::isEnabled() const {
+  return _isEnabled;
+}
+
+void Telemetry::setEnabled(bool enabled) {
+  VGASSERT_MAIN_THREAD();
+
+  if (enabled == _isEnabled) {
+    return;
+  }
+
+  UserDefault::getInstance()->setBoolForKey(TELEMETRY_ENABLED_KEY, enabled);
+  UserDefault::getInstance()->flush();
+
+  if (enabled) {
+    init();
+    return;
+  }
+
+  _isEnabled = false;
+  _batch = createBatch();
+  _retryTimer = 0;
+  // The batch being uploaded (if any) is removed once the upload is done.
+  while (!_spooledBatches.empty() && !(_isUploading && _spooledBatches.size() == 1)) {
+    FileUtils::getInstance()->removeFile(_spooledBatches.back());
+    _spooledBatches.pop_back();
+  }
+}
+
+
+Telemetry::Batch Telemetry::createBatch() {
+  Batch batch;
+  batch.frameTimeHistogram.fill(0);
+  batch.frameTimeMax = 0;
+  batch.duration = 0;
+  return batch;
+}
+
+string Telemetry::serialize(const Telemetry::Batch& batch) const {
+  // The hardware tier of the device.
+  const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+  string json = "{";
+  json += string_util::format("\"platform\":%d,\"renderer\":\"%s\",\"cpus\":%u,\"refreshRate\":%.0f,",
+                              CC_TARGET_PLATFORM, (renderer) ? renderer : "",
+                              std::thread::hardware_concurrency(),
+                              FramePacer::getInstance()->getRefreshRate());
+
+  json += string_util::format("\"duration\":%.1f,\"frameTimeMax\":%.1f,\"frameTimeEdges\":[",
+                              batch.duration, batch.frameTimeMax);
+  for (size_t i = 0; i < _kFrameTimeBucketEdges.size(); i++) {
+    json += string_util::format((i > 0) ? ",%.1f" : "%.1f", _kFrameTimeBucketEdges[i]);
+  }
+  json += "],\"frameTimes\":[";
+  for (size_t i = 0; i < batch.frameTimeHistogram.size(); i++) {
+    json += string_util::format((i > 0) ? ",%u" : "%u", batch.frameTimeHistogram[i]);
+  }
+
+  json += "],\"mapLoads\":[";
+  for (size_t i = 0; i < batch.mapLoadTimes.size(); i++) {
+    json += string_util::format("%s[\"%s\",%.3f]", (i > 0) ? "," : "",
+                                batch.mapLoadTimes[i].first.c_str(), batch.mapLoadTimes[i].second);
+  }
+  json += "],\"startup\":{";
+  for (size_t i = 0; i < batch.startupPhases.size(); i++) {
+    json += string_util::format("%s\"%s\":%.3f", (i > 0) ? "," : "",
+                                batch.startupPhases[i].first.c_str(), batch.startupPhases[i].second);
+  }
+  json += "},\"memory\":{";
+  bool isFirstTag = true;
+  for (const auto& p : batch.highWaterMarks) {
+    json += string_util::format("%s\"%s\":%lld", (isFirstTag) ? "" : ",",
+                                p.first.c_str(), static_cast<long long>(p.second));
+    isFirstTag = false;
+  }
+  json += "}}";
+  return json;
+}
+
+
+void Telemetry::upload() {
+#ifdef VIGILANTE_TELEMETRY_URL
+  if (!_isEnabled || _isUploading || _retryTimer > 0 || _spooledBatches.empty()) {
+    return;
+  }
+  _isUploading = true;
+
+  const string filePath = _spooledBatches.front();
+  auto data = std::make_shared<string>();
+  ThreadPool::getInstance()->post([filePath, data]() {
+    *data = FileUtils::getInstance()->getStringFromFile(filePath);
+  }, [this, filePath, data]() {
+    if (data->empty()) {
+      onUploaded(filePath, /*isSucceeded=*/true);  // nothing to send, so drop it
+      return;
+    }
+
+    auto request = new (std::nothrow) cocos2d::network::HttpRequest;
+    request->setUrl(VIGILANTE_TELEMETRY_URL);
+    request->setRequestType(cocos2d::network::HttpRequest::Type::POST);
+    request->setHeaders({"Content-Type: application/json"});
+    request->setRequestData(data->data(), data->size());
+    request->setResponseCallback([this, filePath](cocos2d::network::HttpClient*,
+                                                  cocos2d::network::HttpResponse* response) {
+      const long code = (response) ? response->getResponseCode() : 0;
+      onUploaded(filePath, response && response->isSucceed() && code >= 200 && code < 300);
+    });
+    cocos2d::network::HttpClient::getInstance()->send(request);
+    request->release();
+  });
+#endif
+}
+
+void Telemetry::onUploaded(const string& filePath, bool isSucceeded) {
+  _isUploading = false;
+
+  if (!isSucceeded) {
+    VGLOG(LOG_WARN, "Failed to upload the telemetry, retrying in %.0f seconds", _retryInterval);
+    _retryTimer = _retryInterval;
+    _retryInterval = std::min(_retryInterval * 2, _kMaxRetryInterval);
+    if (_isEnabled) {
+      return;
+    }
+  }
+
+  // Uploaded (or opted out in the meantime).
+  FileUtils::getInstance()->removeFile(filePath);
+  _spooledBatches.erase(std::remove(_spooledBatches.begin(), _spooledBatches.end(), filePath),
+                        _spooledBatches.end());
+  _retryInterval = _kMinRetryInterval;
+  upload();
+}
+
+}  // namespace vigilante
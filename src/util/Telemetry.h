@@ -0,0 +1,99 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TELEMETRY_H_
+#define VIGILANTE_TELEMETRY_H_
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vigilante {
+
+// Opt-in performance telemetry (see the "telemetry" console command), so that
+// the hardware-tier decisions (e.g., the default render scale) can be made from
+// the data of real devices. Nothing is recorded unless the player has opted in.
+//
+// A batch collects:
+// - a histogram of the frame times (see GameScene::update()),
+// - the map load durations, from GameMapManager::loadGameMap() until the shade
+//   has faded out,
+// - the startup phase timings,
+// - the high-water marks of the memory tags of MemoryTracker.
+//
+// The batches are written to <writable path>/telemetry/ (the spool) on a worker
+// thread when the app goes to the background or every _kBatchDuration of play,
+// and the spooled batches are uploaded one at a time by HttpClient (which sends
+// them from its own thread), oldest first, retrying with a backoff. Only the
+// newest _kMaxSpooledBatches are kept while the uploads keep failing.
+//
+// The uploads are only compiled in if the game is built with
+// VIGILANTE_TELEMETRY_URL (see CMakeLists.txt), otherwise the batches stay
+// in the spool.
+//
+// All methods must be called on the main thread.
+class Telemetry final {
+ public:
+  static Telemetry* getInstance();
+
+  // Reads whether the player has opted in, and resumes the uploads
+  // of the batches spooled by the earlier sessions.
+  void init();
+
+  // Must be called each frame (see GameScene::update()).
+  void update(float delta);
+  // Writes the current batch to the spool and starts a new one.
+  void flush();
+
+  void addFrameTime(float frameTime);  // in seconds
+  void addMapLoadTime(const std::string& tmxMapFileName, float loadTime);  // in seconds
+  void addStartupPhase(const std::string& name, float time);  // in seconds
+  void updateHighWaterMark(const std::string& tag, int64_t value);
+
+  bool isEnabled() const;
+  // Opting out also discards the batches which haven't been uploaded yet.
+  void setEnabled(bool enabled);
+
+ private:
+  // The upper edges of the frame time buckets, in milliseconds.
+  // The last bucket holds everything above the last edge.
+  static const size_t _kNumFrameTimeBuckets = 11;
+  static const std::array<float, _kNumFrameTimeBuckets - 1> _kFrameTimeBucketEdges;
+  static const float _kBatchDuration;
+  static const float _kMinRetryInterval;
+  static const float _kMaxRetryInterval;
+  static const size_t _kMaxSpooledBatches;
+
+  struct Batch final {
+    std::array<uint32_t, _kNumFrameTimeBuckets> frameTimeHistogram;
+    float frameTimeMax;  // in milliseconds
+    float duration;  // the sum of the frame times, in seconds
+    std::vector<std::pair<std::string, float>> mapLoadTimes;
+    std::vector<std::pair<std::string, float>> startupPhases;
+    std::map<std::string, int64_t> highWaterMarks;
+  };
+
+  Telemetry();
+
+  static Telemetry::Batch createBatch();
+  std::string serialize(const Telemetry::Batch& batch) const;
+
+  // Sends the oldest spooled batch unless one is being sent.
+  void upload();
+  void onUploaded(const std::string& filePath, bool isSucceeded);
+
+  bool _isEnabled;
+  Telemetry::Batch _batch;
+  std::string _spoolDir;
+  std::deque<std::string> _spooledBatches;  // the file paths, oldest first
+  int _numFlushes;
+  bool _isUploading;
+  float _retryInterval;  // in seconds
+  float _retryTimer;  // in seconds
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TELEMETRY_H_
@@ -0,0 +1,184 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TextId.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <cocos2d.h>
+#include "std/make_unique.h"
+#include "util/ds/BinaryStream.h"
+#include "util/Logger.h"
+#include "util/MappedFile.h"
+
+#define TEXT_PACK_MAGIC 0x54585456  // "VTXT"
+#define TEXT_PACK_VERSION 1
+
+using std::deque;
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+using cocos2d::FileUtils;
+
+namespace vigilante {
+
+namespace {
+
+// See scripts/TextPacker.py for the format of the text pack.
+struct PackedText final {
+  uint32_t offset;  // relative to the text data
+  uint32_t length;
+};
+
+static_assert(sizeof(PackedText) == 2 * sizeof(uint32_t), "PackedText must not be padded");
+
+mutex textTableMutex;
+
+unique_ptr<MappedFile> textPack;
+const PackedText* packedTexts;  // sorted by text, points into the mapping
+uint32_t numPackedTexts;
+const char* packedTextData;
+
+// value -> the copy made by the first getText(), if any.
+vector<unique_ptr<string>> packedTextCopies;
+
+// The texts which aren't in the pack. Their values start from numPackedTexts.
+// The strings in a deque never move, so getText() can return references to them.
+unordered_map<string, uint32_t> runtimeValues;
+deque<string> runtimeTexts;
+
+bool isTextPackValid(const MappedFile& file) {
+  BinaryReader reader(file.getData(), file.getData() + file.getSize());
+  const uint32_t magic = reader.read<uint32_t>();
+  const uint32_t version = reader.read<uint32_t>();
+  const uint64_t numTexts = reader.read<uint32_t>();
+  const uint64_t dataSize = reader.read<uint32_t>();
+  if (!reader.isOk() || magic != TEXT_PACK_MAGIC || version != TEXT_PACK_VERSION) {
+    return false;
+  }
+
+  const uint64_t indexOffset = 4 * sizeof(uint32_t);
+  const uint64_t dataOffset = indexOffset + numTexts * sizeof(PackedText);
+  if (dataOffset + dataSize > file.getSize()) {
+    return false;
+  }
+
+  const PackedText* texts = reinterpret_cast<const PackedText*>(file.getData() + indexOffset);
+  for (uint64_t i = 0; i < numTexts; i++) {
+    if (static_cast<uint64_t>(texts[i].offset) + texts[i].length > dataSize) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compares `packedText` with `text` byte by byte,
+// in the same order as the texts are sorted by TextPacker.py.
+bool isPackedTextLess(const PackedText& packedText, const string& text) {
+  const int result = std::memcmp(packedTextData + packedText.offset, text.data(),
+                                 std::min<size_t>(packedText.length, text.size()));
+  return result < 0 || (result == 0 && packedText.length < text.size());
+}
+
+// Returns the value of `text` in the pack, or TextId::_kInvalidValue.
+uint32_t findPackedText(const string& text) {
+  const PackedText* end = packedTexts + numPackedTexts;
+  const PackedText* it = std::lower_bound(packedTexts, end, text, isPackedTextLess);
+  if (it == end || it->length != text.size() ||
+      std::memcmp(packedTextData + it->offset, text.data(), text.size()) != 0) {
+    return TextId::_kInvalidValue;
+  }
+  return static_cast<uint32_t>(it - packedTexts);
+}
+
+}  // namespace
+
+TextId::TextId(const string& text) : _value(_kInvalidValue) {
+  if (text.empty()) {
+    return;
+  }
+
+  lock_guard<mutex> lock(textTableMutex);
+  if (textPack) {
+    _value = findPackedText(text);
+    if (_value != _kInvalidValue) {
+      return;
+    }
+  }
+
+  auto it = runtimeValues.find(text);
+  if (it == runtimeValues.end()) {
+    const uint32_t value = numPackedTexts + static_cast<uint32_t>(runtimeTexts.size());
+    it = runtimeValues.insert({text, value}).first;
+    runtimeTexts.push_back(text);
+  }
+  _value = it->second;
+}
+
+
+const string& TextId::getText() const {
+  static const string kEmptyText;
+  if (!isValid()) {
+    return kEmptyText;
+  }
+
+  lock_guard<mutex> lock(textTableMutex);
+  if (_value >= numPackedTexts) {
+    return runtimeTexts[_value - numPackedTexts];
+  }
+
+  unique_ptr<string>& copy = packedTextCopies[_value];
+  if (!copy) {
+    const PackedText& packedText = packedTexts[_value];
+    copy = std::make_unique<string>(packedTextData + packedText.offset, packedText.length);
+  }
+  return *copy;
+}
+
+bool TextId::importPack(const string& packFileName) {
+  const string fullPath = FileUtils::getInstance()->fullPathForFilename(packFileName);
+  if (fullPath.empty()) {
+    VGLOG(LOG_INFO, "No text pack found, interning the texts at runtime instead.");
+    return false;
+  }
+
+  auto file = std::make_unique<MappedFile>(fullPath);
+  if (!file->isOpen() || !isTextPackValid(*file)) {
+    VGLOG(LOG_ERR, "Invalid text pack: %s, interning the texts at runtime instead.", fullPath.c_str());
+    return false;
+  }
+
+  lock_guard<mutex> lock(textTableMutex);
+  if (textPack || !runtimeTexts.empty()) {
+    VGLOG(LOG_ERR, "The text pack must be imported before any text is interned.");
+    return false;
+  }
+
+  const char* data = file->getData();
+  std::memcpy(&numPackedTexts, data + 2 * sizeof(uint32_t), sizeof(uint32_t));
+  packedTexts = reinterpret_cast<const PackedText*>(data + 4 * sizeof(uint32_t));
+  packedTextData = reinterpret_cast<const char*>(packedTexts + numPackedTexts);
+  packedTextCopies.resize(numPackedTexts);
+  textPack = std::move(file);
+  VGLOG(LOG_INFO, "Text pack: %u texts", numPackedTexts);
+  return true;
+}
+
+size_t TextId::getNumPackedTexts() {
+  lock_guard<mutex> lock(textTableMutex);
+  return numPackedTexts;
+}
+
+size_t TextId::getNumRuntimeTexts() {
+  lock_guard<mutex> lock(textTableMutex);
+  return runtimeTexts.size();
+}
+
+}  // namespace vigilante
@@ -0,0 +1,55 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TEXT_ID_H_
+#define VIGILANTE_TEXT_ID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vigilante {
+
+// An interned piece of text shown to the player, e.g., a dialogue line,
+// or the desc of an item, a skill or a quest.
+//
+// Like AssetId, each distinct text is stored only once and referred to by
+// a dense 32-bit value, so the profiles and dialogue nodes only hold the
+// values. The texts cooked into the text pack by scripts/TextPacker.py
+// aren't even copied: the pack is memory mapped (see importPack()), and
+// a packed text is only copied into a std::string the first time
+// getText() is called on it, i.e., when it's actually shown.
+// The texts which aren't in the pack (or all of them, if there's no pack)
+// are interned into a runtime table instead.
+//
+// Interning is thread-safe.
+class TextId final {
+ public:
+  TextId() : _value(_kInvalidValue) {}
+  // An empty `text` yields an invalid TextId.
+  explicit TextId(const std::string& text);
+
+  bool operator==(const TextId& other) const { return _value == other._value; }
+  bool operator!=(const TextId& other) const { return _value != other._value; }
+
+  // Returns an empty string if this TextId is invalid.
+  const std::string& getText() const;
+  uint32_t getValue() const { return _value; }
+  bool isValid() const { return _value != _kInvalidValue; }
+
+  // Maps the pack written by scripts/TextPacker.py. It must be imported
+  // before the first TextId is constructed, since the values of the packed
+  // texts come first. Returns false if there's no such pack or it's invalid.
+  static bool importPack(const std::string& packFileName);
+
+  // The number of packed texts and the number of texts interned at runtime.
+  static size_t getNumPackedTexts();
+  static size_t getNumRuntimeTexts();
+
+  static const uint32_t _kInvalidValue = UINT32_MAX;
+
+ private:
+  uint32_t _value;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TEXT_ID_H_
@@ -0,0 +1,135 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "util/MainThread.h"
+
+#define THREAD_POOL_MIN_WORKER_THREADS 2  // a map loader may block one of them
+
+using std::lock_guard;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+
+namespace vigilante {
+
+namespace {
+
+// The index of the calling worker thread, or -1 if it isn't one.
+thread_local int currentWorkerIndex = -1;
+
+}  // namespace
+
+ThreadPool* ThreadPool::getInstance() {
+  static ThreadPool instance(std::max(static_cast<int>(thread::hardware_concurrency()) - 1,
+                                      THREAD_POOL_MIN_WORKER_THREADS));
+  return &instance;
+}
+
+ThreadPool::ThreadPool(int numWorkerThreads)
+    : _queues(),
+      _workerThreads(),
+      _nextQueueIndex(),
+      _numQueuedTasks(),
+      _mutex(),
+      _taskCv(),
+      _isStopping() {
+  for (int i = 0; i < numWorkerThreads; i++) {
+    _queues.push_back(std::unique_ptr<Queue>(new Queue));
+  }
+  for (int i = 0; i < numWorkerThreads; i++) {
+    _workerThreads.push_back(thread(&ThreadPool::runWorkerThread, this, i));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(_mutex);
+    _isStopping = true;
+  }
+  _taskCv.notify_all();
+
+  // The tasks which haven't been started by now are dropped.
+  for (auto& workerThread : _workerThreads) {
+    workerThread.join();
+  }
+}
+
+
+void ThreadPool::post(const ThreadPool::Task& task) {
+  const size_t queueIndex = (currentWorkerIndex >= 0) ? currentWorkerIndex
+                                                        : _nextQueueIndex++ % _queues.size();
+  {
+    lock_guard<mutex> lock(_queues[queueIndex]->mutex);
+    _queues[queueIndex]->tasks.push_back(task);
+  }
+  {
+    // Incremented while holding _mutex, so that the wakeup
+    // can't be lost by a worker which is about to wait.
+    lock_guard<mutex> lock(_mutex);
+    _numQueuedTasks++;
+  }
+  _taskCv.notify_one();
+}
+
+void ThreadPool::post(const ThreadPool::Task& task, const ThreadPool::Task& continuation) {
+  post([task, continuation]() {
+    task();
+    ThreadPool::runOnMainThread(continuation);
+  });
+}
+
+void ThreadPool::runOnMainThread(const ThreadPool::Task& task) {
+  main_thread::post(task);
+}
+
+int ThreadPool::getNumWorkerThreads() const {
+  return static_cast<int>(_workerThreads.size());
+}
+
+
+void ThreadPool::runWorkerThread(int workerIndex) {
+  currentWorkerIndex = workerIndex;
+
+  Task task;
+  while (true) {
+    if (tryPopTask(workerIndex, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    unique_lock<mutex> lock(_mutex);
+    _taskCv.wait(lock, [this]() { return _isStopping || _numQueuedTasks > 0; });
+    if (_isStopping) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::tryPopTask(int workerIndex, ThreadPool::Task& task) {
+  // Take the most recently posted task from its own queue first,
+  // and then steal the oldest ones from the others.
+  const size_t numQueues = _queues.size();
+  for (size_t i = 0; i < numQueues; i++) {
+    Queue& queue = *_queues[(workerIndex + i) % numQueues];
+    lock_guard<mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+
+    if (i == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    _numQueuedTasks--;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace vigilante
@@ -0,0 +1,87 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_THREAD_POOL_H_
+#define VIGILANTE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vigilante {
+
+// The shared pool of worker threads for long-running background work
+// (e.g., loading or prefetching a GameMap), so that we don't have to
+// spawn detached threads for them.
+//
+// Each worker has its own task queue. A task posted by a worker goes to
+// its own queue, and the others go to the queues in round-robin order.
+// Idle workers steal tasks from the other queues.
+//
+// For batches of small jobs which must finish within the same frame, see
+// JobPool instead.
+class ThreadPool final {
+ public:
+  using Task = std::function<void ()>;
+
+  static ThreadPool* getInstance();
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void post(const ThreadPool::Task& task);
+
+  // Runs `task` on a worker thread, then `continuation` on the main thread
+  // (see runOnMainThread()).
+  void post(const ThreadPool::Task& task, const ThreadPool::Task& continuation);
+
+  template <typename Func>
+  std::future<typename std::result_of<Func ()>::type> submit(Func&& func);
+
+  // The task is run by main_thread::drain(), see util/MainThread.h.
+  static void runOnMainThread(const ThreadPool::Task& task);
+
+  int getNumWorkerThreads() const;
+
+ private:
+  struct Queue final {
+    std::mutex mutex;
+    std::deque<ThreadPool::Task> tasks;
+  };
+
+  explicit ThreadPool(int numWorkerThreads);
+
+  void runWorkerThread(int workerIndex);
+  bool tryPopTask(int workerIndex, ThreadPool::Task& task);
+
+  std::vector<std::unique_ptr<ThreadPool::Queue>> _queues;
+  std::vector<std::thread> _workerThreads;
+  std::atomic<size_t> _nextQueueIndex;
+  std::atomic<int> _numQueuedTasks;
+
+  std::mutex _mutex;
+  std::condition_variable _taskCv;
+  bool _isStopping;
+};
+
+
+template <typename Func>
+std::future<typename std::result_of<Func ()>::type> ThreadPool::submit(Func&& func) {
+  using Result = typename std::result_of<Func ()>::type;
+
+  // std::packaged_task is move-only, but ThreadPool::Task has to be copyable.
+  auto task = std::make_shared<std::packaged_task<Result ()>>(std::forward<Func>(func));
+  std::future<Result> future = task->get_future();
+  post([task]() { (*task)(); });
+  return future;
+}
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_THREAD_POOL_H_
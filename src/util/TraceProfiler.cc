@@ -0,0 +1,362 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "TraceProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "util/AllocationTracker.h"
+#include "util/Logger.h"
+#include "util/MainThread.h"
+#include "util/ThreadPool.h"
+
+#define MAX_TRACE_EVENTS_PER_THREAD 262144  // 6MB per thread
+#define TRACE_EVENTS_INITIAL_CAPACITY 4096
+#define FLIGHT_RECORDER_CAPACITY 65536  // 1.5MB, ~5 seconds of the main thread's zones
+#define TRACE_PID 1
+
+using std::pair;
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using std::ofstream;
+using std::lock_guard;
+using std::mutex;
+using std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+using std::chrono::duration_cast;
+
+namespace vigilante {
+
+namespace {
+
+int64_t toNanoseconds(steady_clock::time_point timePoint) {
+  return duration_cast<nanoseconds>(timePoint.time_since_epoch()).count();
+}
+
+void writeEscaped(ofstream& fout, const string& s) {
+  for (const char c : s) {
+    if (c == '"' || c == '\\') {
+      fout << '\\';
+    }
+    fout << ((static_cast<unsigned char>(c) < 0x20) ? ' ' : c);
+  }
+}
+
+}  // namespace
+
+std::atomic<uint32_t> TraceProfiler::_activeCaptureId{0};
+std::atomic<bool> TraceProfiler::_isFlightRecorderEnabled{true};
+
+TraceProfiler::Zone::Zone(const char* name)
+    : _name(name),
+      _captureId(TraceProfiler::_activeCaptureId.load(std::memory_order_relaxed)),
+      _isFlightRecorded(TraceProfiler::_isFlightRecorderEnabled.load(std::memory_order_relaxed) &&
+                        main_thread::isMainThread()),
+      _beginTime()
+#if VIGILANTE_COUNT_ALLOCATIONS
+      , _previousAllocationZone(AllocationTracker::enterZone(name))
+#endif
+      {
+  if (_captureId || _isFlightRecorded) {
+    _beginTime = steady_clock::now();
+  }
+}
+
+TraceProfiler::Zone::~Zone() {
+#if VIGILANTE_COUNT_ALLOCATIONS
+  AllocationTracker::leaveZone(_previousAllocationZone);
+#endif
+  if (!_captureId && !_isFlightRecorded) {
+    return;
+  }
+
+  const steady_clock::time_point endTime = steady_clock::now();
+  if (_captureId) {
+    TraceProfiler::getInstance()->addEvent(_captureId, _name, _beginTime, endTime);
+  }
+  if (_isFlightRecorded) {
+    TraceProfiler::getInstance()->addFlightEvent(_name, _beginTime, endTime);
+  }
+}
+
+
+TraceProfiler* TraceProfiler::getInstance() {
+  static TraceProfiler instance;
+  return &instance;
+}
+
+TraceProfiler::TraceProfiler()
+    : _lastCaptureId(),
+      _beginTime(),
+      _endTime(),
+      _filePath(),
+      _isWriting(),
+      _threadBuffersMutex(),
+      _threadBuffers(),
+      _gpuBuffer(),
+      _nextThreadIndex(1),
+      _flightEvents(),
+      _nextFlightEventIndex() {}
+
+bool TraceProfiler::start(float duration, const string& filePath) {
+  VGASSERT_MAIN_THREAD();
+
+  if (isCapturing() || _isWriting) {
+    return false;
+  }
+
+  _beginTime = steady_clock::now();
+  _endTime = _beginTime + duration_cast<steady_clock::duration>(
+      std::chrono::duration<float>(duration));
+  _filePath = filePath;
+
+  // The ids are never reused (nor 0), so that the zones which are still
+  // open from an earlier capture can be told apart.
+  if (++_lastCaptureId == 0) {
+    ++_lastCaptureId;
+  }
+  _activeCaptureId.store(_lastCaptureId, std::memory_order_relaxed);
+  VGLOG(LOG_INFO, "Capturing a trace for %.1f seconds.", duration);
+  return true;
+}
+
+void TraceProfiler::stop() {
+  VGASSERT_MAIN_THREAD();
+
+  const uint32_t captureId = _activeCaptureId.exchange(0, std::memory_order_relaxed);
+  if (captureId == 0) {
+    return;
+  }
+
+  // Move the events out of each thread's buffer. The zones which are
+  // still open on the other threads are discarded when they close.
+  vector<Snapshot> snapshots;
+  {
+    lock_guard<mutex> lock(_threadBuffersMutex);
+    for (const auto& buffer : _threadBuffers) {
+      lock_guard<mutex> bufferLock(buffer->mutex);
+      if (buffer->captureId != captureId || buffer->events.empty()) {
+        continue;
+      }
+      snapshots.push_back({std::move(buffer->events), buffer->threadIndex,
+                           buffer->isMainThread, buffer->isGpu, buffer->numDroppedEvents});
+      buffer->events.clear();
+      buffer->numDroppedEvents = 0;
+    }
+
+    // The buffers of the threads which have exited are only referenced here.
+    _threadBuffers.erase(std::remove_if(_threadBuffers.begin(), _threadBuffers.end(),
+                                        [](const shared_ptr<ThreadBuffer>& buffer) {
+                                          return buffer.use_count() == 1;
+                                        }),
+                         _threadBuffers.end());
+  }
+
+  _isWriting = true;
+  const string filePath = _filePath;
+  const int64_t beginTime = toNanoseconds(_beginTime);
+  auto sharedSnapshots = std::make_shared<vector<Snapshot>>(std::move(snapshots));
+  ThreadPool::getInstance()->post([this, filePath, beginTime, sharedSnapshots]() {
+    if (TraceProfiler::writeJson(filePath, beginTime, *sharedSnapshots, {})) {
+      VGLOG(LOG_INFO, "The trace has been written to %s", filePath.c_str());
+    } else {
+      VGLOG(LOG_ERR, "Failed to write the trace to %s", filePath.c_str());
+    }
+    _isWriting = false;
+  });
+}
+
+void TraceProfiler::update() {
+  if (isCapturing() && steady_clock::now() >= _endTime) {
+    stop();
+  }
+}
+
+bool TraceProfiler::isCapturing() const {
+  return _activeCaptureId.load(std::memory_order_relaxed) != 0;
+}
+
+void TraceProfiler::addGpuEvent(const char* name, steady_clock::time_point beginTime,
+                                nanoseconds duration) {
+  VGASSERT_MAIN_THREAD();
+
+  // The passes issued before the capture began are still being read back.
+  const uint32_t captureId = _activeCaptureId.load(std::memory_order_relaxed);
+  if (captureId == 0 || beginTime < _beginTime) {
+    return;
+  }
+
+  if (!_gpuBuffer) {
+    _gpuBuffer = createThreadBuffer(/*isMainThread=*/false, /*isGpu=*/true);
+  }
+  const int64_t begin = toNanoseconds(beginTime);
+  addEvent(_gpuBuffer.get(), captureId, {name, begin, begin + duration.count()});
+}
+
+
+bool TraceProfiler::dumpFlightRecorder(float duration, const string& filePath,
+                                       const vector<pair<string, string>>& metadata) {
+  VGASSERT_MAIN_THREAD();
+
+  if (_isWriting) {
+    return false;
+  }
+
+  // Copy the recent events in the order they were recorded (i.e., by their end time).
+  const int64_t now = toNanoseconds(steady_clock::now());
+  const int64_t beginTime = now - static_cast<int64_t>(duration * 1e9);
+  Snapshot snapshot{{}, getThreadBuffer()->threadIndex, /*isMainThread=*/true, /*isGpu=*/false, 0};
+  const size_t numEvents = _flightEvents.size();
+  for (size_t i = 0; i < numEvents; i++) {
+    const Event& event = _flightEvents[(_nextFlightEventIndex + i) % numEvents];
+    if (event.endTime >= beginTime) {
+      snapshot.events.push_back(event);
+    }
+  }
+
+  _isWriting = true;
+  auto sharedSnapshots = std::make_shared<vector<Snapshot>>(1, std::move(snapshot));
+  ThreadPool::getInstance()->post([this, filePath, beginTime, sharedSnapshots, metadata]() {
+    if (TraceProfiler::writeJson(filePath, beginTime, *sharedSnapshots, metadata)) {
+      VGLOG(LOG_INFO, "The flight recorder has been written to %s", filePath.c_str());
+    } else {
+      VGLOG(LOG_ERR, "Failed to write the flight recorder to %s", filePath.c_str());
+    }
+    _isWriting = false;
+  });
+  return true;
+}
+
+bool TraceProfiler::isFlightRecorderEnabled() const {
+  return _isFlightRecorderEnabled.load(std::memory_order_relaxed);
+}
+
+void TraceProfiler::setFlightRecorderEnabled(bool enabled) {
+  VGASSERT_MAIN_THREAD();
+
+  _isFlightRecorderEnabled.store(enabled, std::memory_order_relaxed);
+  if (!enabled) {
+    _flightEvents.clear();
+    _flightEvents.shrink_to_fit();
+    _nextFlightEventIndex = 0;
+  }
+}
+
+
+void TraceProfiler::addEvent(uint32_t captureId, const char* name,
+                             steady_clock::time_point beginTime,
+                             steady_clock::time_point endTime) {
+  if (_activeCaptureId.load(std::memory_order_relaxed) != captureId) {
+    return;
+  }
+  addEvent(getThreadBuffer(), captureId, {name, toNanoseconds(beginTime), toNanoseconds(endTime)});
+}
+
+void TraceProfiler::addEvent(ThreadBuffer* buffer, uint32_t captureId, const Event& event) {
+  lock_guard<mutex> lock(buffer->mutex);
+  if (buffer->captureId != captureId) {
+    // Whatever is left belongs to an earlier capture.
+    buffer->events.clear();
+    buffer->events.reserve(TRACE_EVENTS_INITIAL_CAPACITY);
+    buffer->captureId = captureId;
+    buffer->numDroppedEvents = 0;
+  }
+
+  if (buffer->events.size() >= MAX_TRACE_EVENTS_PER_THREAD) {
+    buffer->numDroppedEvents++;
+    return;
+  }
+  buffer->events.push_back(event);
+}
+
+TraceProfiler::ThreadBuffer* TraceProfiler::getThreadBuffer() {
+  thread_local shared_ptr<ThreadBuffer> threadBuffer;
+  if (!threadBuffer) {
+    threadBuffer = createThreadBuffer(main_thread::isMainThread(), /*isGpu=*/false);
+  }
+  return threadBuffer.get();
+}
+
+shared_ptr<TraceProfiler::ThreadBuffer> TraceProfiler::createThreadBuffer(bool isMainThread, bool isGpu) {
+  auto buffer = std::make_shared<ThreadBuffer>();
+  buffer->captureId = 0;
+  buffer->isMainThread = isMainThread;
+  buffer->isGpu = isGpu;
+  buffer->numDroppedEvents = 0;
+
+  lock_guard<mutex> lock(_threadBuffersMutex);
+  buffer->threadIndex = _nextThreadIndex++;
+  _threadBuffers.push_back(buffer);
+  return buffer;
+}
+
+void TraceProfiler::addFlightEvent(const char* name,
+                                   steady_clock::time_point beginTime,
+                                   steady_clock::time_point endTime) {
+  const Event event{name, toNanoseconds(beginTime), toNanoseconds(endTime)};
+  if (_flightEvents.size() < FLIGHT_RECORDER_CAPACITY) {
+    _flightEvents.push_back(event);
+    return;
+  }
+  _flightEvents[_nextFlightEventIndex] = event;
+  _nextFlightEventIndex = (_nextFlightEventIndex + 1) % FLIGHT_RECORDER_CAPACITY;
+}
+
+bool TraceProfiler::writeJson(const string& filePath, int64_t beginTime,
+                              const vector<Snapshot>& snapshots,
+                              const vector<pair<string, string>>& metadata) {
+  ofstream fout(filePath);
+  if (!fout.is_open()) {
+    return false;
+  }
+
+  // The timestamps of the Chrome trace format are in microseconds.
+  char line[256];
+  bool isFirstEvent = true;
+  auto writeLine = [&fout, &line, &isFirstEvent]() {
+    fout << (isFirstEvent ? "\n" : ",\n") << line;
+    isFirstEvent = false;
+  };
+
+  fout << "{\"displayTimeUnit\":\"ms\",";
+  if (!metadata.empty()) {
+    fout << "\"otherData\":{";
+    for (size_t i = 0; i < metadata.size(); i++) {
+      fout << ((i > 0) ? "," : "") << '"';
+      writeEscaped(fout, metadata[i].first);
+      fout << "\":\"";
+      writeEscaped(fout, metadata[i].second);
+      fout << '"';
+    }
+    fout << "},";
+  }
+  fout << "\"traceEvents\":[";
+  for (const auto& snapshot : snapshots) {
+    std::snprintf(line, sizeof(line),
+                  "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                  "\"args\":{\"name\":\"%s %d\"}}",
+                  TRACE_PID, snapshot.threadIndex,
+                  (snapshot.isGpu) ? "gpu" : (snapshot.isMainThread) ? "main" : "worker",
+                  snapshot.threadIndex);
+    writeLine();
+
+    for (const auto& event : snapshot.events) {
+      std::snprintf(line, sizeof(line),
+                    "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    event.name, TRACE_PID, snapshot.threadIndex,
+                    (event.beginTime - beginTime) / 1000.0,
+                    (event.endTime - event.beginTime) / 1000.0);
+      writeLine();
+    }
+
+    if (snapshot.numDroppedEvents > 0) {
+      VGLOG(LOG_WARN, "%zu trace events of thread %d dropped",
+            snapshot.numDroppedEvents, snapshot.threadIndex);
+    }
+  }
+  fout << "\n]}\n";
+  return static_cast<bool>(fout);
+}
+
+}  // namespace vigilante
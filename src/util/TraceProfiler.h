@@ -0,0 +1,161 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TRACE_PROFILER_H_
+#define VIGILANTE_TRACE_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define VGTRACE_CONCAT_IMPL(a, b) a##b
+#define VGTRACE_CONCAT(a, b) VGTRACE_CONCAT_IMPL(a, b)
+
+// Example usage: VGTRACE_ZONE("GameMapManager::update");
+//
+// Records the time spent in the enclosing scope as a zone of the current
+// trace capture (see the "trace" console command). The name must be a string
+// literal (it's stored as a pointer). When nothing is being captured, a zone
+// costs a relaxed atomic load. The zones are compiled out entirely if the game
+// is built with VIGILANTE_DISABLE_TRACE_ZONES (see CMakeLists.txt).
+// The allocations made in a zone are attributed to it by AllocationTracker.
+#if VIGILANTE_DISABLE_TRACE_ZONES
+#define VGTRACE_ZONE(name) do {} while (0)
+#else
+#define VGTRACE_ZONE(name) \
+  vigilante::TraceProfiler::Zone VGTRACE_CONCAT(_vgTraceZone, __LINE__)("" name)
+#endif
+
+
+namespace vigilante {
+
+// Captures the zones entered on any thread for a few seconds, and writes
+// them as a Chrome trace (json), which can be opened in chrome://tracing
+// or https://ui.perfetto.dev.
+//
+// Each thread appends its zones to its own buffer, so the threads only
+// contend with the main thread when a capture ends.
+//
+// The time which the GPU spent on each render pass is added as well, on a track
+// of its own (see GpuTimer).
+//
+// Besides, the zones of the main thread are always recorded into a ring
+// buffer (the flight recorder), so that the last few seconds can be dumped
+// after something has gone wrong, e.g., a hitch (see HitchDetector).
+class TraceProfiler final {
+ public:
+  class Zone final {
+   public:
+    explicit Zone(const char* name);
+    ~Zone();
+
+   private:
+    const char* _name;
+    uint32_t _captureId;  // 0 if nothing was being captured on entry
+    bool _isFlightRecorded;
+    std::chrono::steady_clock::time_point _beginTime;
+#if VIGILANTE_COUNT_ALLOCATIONS
+    const char* _previousAllocationZone;  // see AllocationTracker
+#endif
+  };
+
+  static TraceProfiler* getInstance();
+
+  // Starts capturing for `duration` seconds (of wall time), after which the
+  // trace is written to `filePath` on a worker thread. Returns false
+  // if a capture is already in progress or its trace is still being written.
+  bool start(float duration, const std::string& filePath);
+  // Ends the capture early. The trace is written the same way.
+  void stop();
+  // Must be called each frame on the main thread (see GameScene::update()).
+  void update();
+
+  bool isCapturing() const;
+
+  // Adds a render pass measured by GpuTimer to the capture in progress, if any.
+  // The GPU's clock isn't the same as the CPU's, so the pass is placed at
+  // `beginTime`, i.e., when it was issued rather than when the GPU ran it.
+  // Main thread only.
+  void addGpuEvent(const char* name, std::chrono::steady_clock::time_point beginTime,
+                   std::chrono::nanoseconds duration);
+
+  // Writes the zones recorded by the flight recorder within the last `duration`
+  // seconds to `filePath` on a worker thread, along with `metadata` (key, value)
+  // as the "otherData" of the trace. Returns false if a trace is still being written.
+  bool dumpFlightRecorder(float duration, const std::string& filePath,
+                          const std::vector<std::pair<std::string, std::string>>& metadata);
+
+  bool isFlightRecorderEnabled() const;
+  void setFlightRecorderEnabled(bool enabled);
+
+ private:
+  struct Event final {
+    const char* name;
+    int64_t beginTime;  // in nanoseconds since the epoch of steady_clock
+    int64_t endTime;
+  };
+
+  struct ThreadBuffer final {
+    std::mutex mutex;  // only contended when a capture ends
+    std::vector<TraceProfiler::Event> events;
+    uint32_t captureId;  // which capture `events` belongs to
+    int threadIndex;
+    bool isMainThread;
+    bool isGpu;  // see addGpuEvent()
+    size_t numDroppedEvents;
+  };
+
+  struct Snapshot final {
+    std::vector<TraceProfiler::Event> events;
+    int threadIndex;
+    bool isMainThread;
+    bool isGpu;
+    size_t numDroppedEvents;
+  };
+
+  TraceProfiler();
+
+  void addEvent(uint32_t captureId, const char* name,
+                std::chrono::steady_clock::time_point beginTime,
+                std::chrono::steady_clock::time_point endTime);
+  void addEvent(ThreadBuffer* buffer, uint32_t captureId, const TraceProfiler::Event& event);
+  ThreadBuffer* getThreadBuffer();
+  std::shared_ptr<ThreadBuffer> createThreadBuffer(bool isMainThread, bool isGpu);
+  // Main thread only.
+  void addFlightEvent(const char* name,
+                      std::chrono::steady_clock::time_point beginTime,
+                      std::chrono::steady_clock::time_point endTime);
+
+  static bool writeJson(const std::string& filePath, int64_t beginTime,
+                        const std::vector<TraceProfiler::Snapshot>& snapshots,
+                        const std::vector<std::pair<std::string, std::string>>& metadata);
+
+  // The id of the capture in progress, or 0. Zones only look at this.
+  static std::atomic<uint32_t> _activeCaptureId;
+  static std::atomic<bool> _isFlightRecorderEnabled;
+
+  uint32_t _lastCaptureId;  // main thread only
+  std::chrono::steady_clock::time_point _beginTime;
+  std::chrono::steady_clock::time_point _endTime;
+  std::string _filePath;
+  std::atomic<bool> _isWriting;
+
+  // Every thread which has ever entered a zone during a capture. Shared with
+  // the threads themselves, so the buffers of finished threads are kept
+  // until the capture ends.
+  std::mutex _threadBuffersMutex;
+  std::vector<std::shared_ptr<TraceProfiler::ThreadBuffer>> _threadBuffers;
+  std::shared_ptr<TraceProfiler::ThreadBuffer> _gpuBuffer;  // main thread only
+  int _nextThreadIndex;  // guarded by _threadBuffersMutex
+
+  // The flight recorder (ring buffer), main thread only.
+  std::vector<TraceProfiler::Event> _flightEvents;
+  size_t _nextFlightEventIndex;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TRACE_PROFILER_H_
@@ -0,0 +1,183 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#include "util/box2d/b2BatchBuilder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "util/Logger.h"
+
+#define MORTON_GRID_SIZE 65535.0f  // 16 bits per axis
+
+using std::pair;
+using std::vector;
+
+namespace vigilante {
+
+namespace {
+
+// Spreads the lower 16 bits of `v` to the even bits.
+uint32_t spreadBits(uint32_t v) {
+  v &= 0x0000ffff;
+  v = (v | (v << 8)) & 0x00ff00ff;
+  v = (v | (v << 4)) & 0x0f0f0f0f;
+  v = (v | (v << 2)) & 0x33333333;
+  v = (v | (v << 1)) & 0x55555555;
+  return v;
+}
+
+// Returns the AABB of all fixtures of `body`, which may be inactive
+// (i.e., its fixtures don't have any broadphase proxies yet).
+b2AABB computeBodyAABB(const b2Body* body) {
+  b2AABB aabb;
+  aabb.lowerBound = body->GetPosition();
+  aabb.upperBound = body->GetPosition();
+
+  for (const b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+    const b2Shape* shape = fixture->GetShape();
+    for (int i = 0; i < shape->GetChildCount(); i++) {
+      b2AABB childAABB;
+      shape->ComputeAABB(&childAABB, body->GetTransform(), i);
+      aabb.Combine(childAABB);
+    }
+  }
+  return aabb;
+}
+
+}  // namespace
+
+
+b2BatchBuilder::b2BatchBuilder(b2World* world, float ppm, bool deferProxies)
+    : _world(world),
+      _ppm(ppm),
+      _deferProxies(deferProxies),
+      _polygonShape(),
+      _scaledVertices(),
+      _pendingBodies() {}
+
+b2BatchBuilder::~b2BatchBuilder() {
+  commit();
+}
+
+void b2BatchBuilder::build(const BodySpec* bodies, size_t numBodies,
+                           const FixtureSpec* fixtures, size_t numFixtures,
+                           vector<b2Body*>* outBodies) {
+  if (outBodies) {
+    outBodies->reserve(outBodies->size() + numBodies);
+  }
+  if (_deferProxies) {
+    _pendingBodies.reserve(_pendingBodies.size() + numBodies);
+  }
+
+  b2BodyDef bdef;
+  bdef.active = !_deferProxies;
+
+  for (size_t i = 0; i < numBodies; i++) {
+    const BodySpec& bodySpec = bodies[i];
+    if (bodySpec.firstFixture + bodySpec.numFixtures > numFixtures) {
+      VGLOG(LOG_ERR, "Body spec [%zu] refers to fixtures beyond the given ones.", i);
+      continue;
+    }
+
+    bdef.type = bodySpec.type;
+    bdef.position.Set(bodySpec.position.x / _ppm, bodySpec.position.y / _ppm);
+    b2Body* body = _world->CreateBody(&bdef);
+
+    for (size_t j = 0; j < bodySpec.numFixtures; j++) {
+      buildFixture(body, fixtures[bodySpec.firstFixture + j]);
+    }
+
+    if (_deferProxies) {
+      _pendingBodies.push_back(body);
+    }
+    if (outBodies) {
+      outBodies->push_back(body);
+    }
+  }
+}
+
+void b2BatchBuilder::commit() {
+  sortPendingBodies();
+
+  for (auto body : _pendingBodies) {
+    body->SetActive(true);
+  }
+  _pendingBodies.clear();
+}
+
+
+void b2BatchBuilder::buildFixture(b2Body* body, const FixtureSpec& spec) {
+  b2FixtureDef fdef;
+  fdef.filter.categoryBits = spec.categoryBits;
+  fdef.filter.maskBits = spec.maskBits;
+  fdef.isSensor = spec.isSensor;
+  fdef.friction = spec.friction;
+  fdef.userData = spec.userData;
+
+  switch (spec.shape) {
+    case FixtureSpec::Shape::RECTANGLE:
+      _polygonShape.SetAsBox(spec.halfSize.x / _ppm, spec.halfSize.y / _ppm);
+      fdef.shape = &_polygonShape;
+      body->CreateFixture(&fdef);
+      break;
+
+    case FixtureSpec::Shape::POLYLINE: {
+      _scaledVertices.resize(spec.numVertices);
+      for (size_t i = 0; i < spec.numVertices; i++) {
+        _scaledVertices[i].Set(spec.vertices[i].x / _ppm, spec.vertices[i].y / _ppm);
+      }
+      // b2ChainShape owns its vertices, so it can't be reused
+      // across fixtures without being destroyed in between.
+      b2ChainShape chainShape;
+      chainShape.CreateChain(_scaledVertices.data(), static_cast<int32>(spec.numVertices));
+      fdef.shape = &chainShape;
+      body->CreateFixture(&fdef);
+      break;
+    }
+
+    default:
+      VGLOG(LOG_ERR, "Unknown fixture shape: %d", spec.shape);
+      break;
+  }
+}
+
+void b2BatchBuilder::sortPendingBodies() {
+  if (_pendingBodies.size() < 2) {
+    return;
+  }
+
+  vector<b2Vec2> centers;
+  centers.reserve(_pendingBodies.size());
+  b2Vec2 lowerBound = {b2_maxFloat, b2_maxFloat};
+  b2Vec2 upperBound = {-b2_maxFloat, -b2_maxFloat};
+  for (auto body : _pendingBodies) {
+    const b2Vec2 center = computeBodyAABB(body).GetCenter();
+    centers.push_back(center);
+    lowerBound = b2Min(lowerBound, center);
+    upperBound = b2Max(upperBound, center);
+  }
+
+  const b2Vec2 extents = upperBound - lowerBound;
+  const float scaleX = (extents.x > 0) ? MORTON_GRID_SIZE / extents.x : 0;
+  const float scaleY = (extents.y > 0) ? MORTON_GRID_SIZE / extents.y : 0;
+
+  vector<pair<uint32_t, b2Body*>> keyedBodies;
+  keyedBodies.reserve(_pendingBodies.size());
+  for (size_t i = 0; i < _pendingBodies.size(); i++) {
+    const auto x = static_cast<uint32_t>((centers[i].x - lowerBound.x) * scaleX);
+    const auto y = static_cast<uint32_t>((centers[i].y - lowerBound.y) * scaleY);
+    keyedBodies.push_back({spreadBits(x) | (spreadBits(y) << 1), _pendingBodies[i]});
+  }
+
+  // Stable, so that the bodies sharing a cell keep their authored order.
+  std::stable_sort(keyedBodies.begin(), keyedBodies.end(),
+                   [](const pair<uint32_t, b2Body*>& lhs, const pair<uint32_t, b2Body*>& rhs) {
+    return lhs.first < rhs.first;
+  });
+
+  for (size_t i = 0; i < keyedBodies.size(); i++) {
+    _pendingBodies[i] = keyedBodies[i].second;
+  }
+}
+
+} // namespace vigilante
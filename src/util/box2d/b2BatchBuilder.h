@@ -0,0 +1,84 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_B2_BATCH_BUILDER_H_
+#define VIGILANTE_B2_BATCH_BUILDER_H_
+
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+namespace vigilante {
+
+// Builds many bodies at once from plain-data specs (e.g., the static layers
+// of a compiled GameMapSpec), which is what b2BodyBuilder is too slow for
+// when a big map is loaded: it heap allocates a shape per fixture.
+//
+// The shapes are constructed in place in scratch storage owned by the batch
+// builder (b2Fixture clones whatever shape it's given, so one scratch shape
+// of each type is enough), and the vertices are scaled into a reused buffer.
+//
+// If `deferProxies` is true, the bodies are created inactive, so that none
+// of their fixtures are inserted into the broadphase until commit() is
+// called, after all of the bodies of the batch have been created.
+//
+// The proxies are then inserted in the Morton (Z-order) order of the
+// bodies' centers, so that neighbouring proxies are inserted one after
+// another. The broadphase's dynamic AABB tree is built by incremental
+// insertion (and b2BroadPhase doesn't expose b2DynamicTree::RebuildBottomUp()),
+// so a spatially coherent insertion order is what keeps the static part
+// of the tree compact, instead of the order in which the layers were authored.
+class b2BatchBuilder final {
+ public:
+  struct FixtureSpec final {
+    enum Shape {
+      RECTANGLE,
+      POLYLINE,
+    };
+
+    FixtureSpec::Shape shape;
+    b2Vec2 halfSize;  // RECTANGLE only, in pixels
+    const b2Vec2* vertices;  // POLYLINE only, in pixels (not owned)
+    size_t numVertices;
+    short categoryBits;
+    short maskBits;
+    bool isSensor;
+    float friction;
+    void* userData;
+  };
+
+  struct BodySpec final {
+    b2BodyType type;
+    b2Vec2 position;  // in pixels
+    size_t firstFixture;  // the index into the fixture specs
+    size_t numFixtures;
+  };
+
+  b2BatchBuilder(b2World* world, float ppm, bool deferProxies=true);
+  ~b2BatchBuilder();
+
+  // Creates the bodies in `bodies`, and their fixtures from `fixtures`.
+  // The created bodies are appended to `outBodies` (if not nullptr).
+  void build(const BodySpec* bodies, size_t numBodies,
+             const FixtureSpec* fixtures, size_t numFixtures,
+             std::vector<b2Body*>* outBodies=nullptr);
+
+  // Creates the broadphase proxies of all the bodies built so far at once.
+  // Also called by the destructor, so that no body is left inactive.
+  void commit();
+
+ private:
+  void buildFixture(b2Body* body, const FixtureSpec& spec);
+  // Sorts _pendingBodies in the Morton order of their AABB centers.
+  void sortPendingBodies();
+
+  b2World* _world;
+  float _ppm;
+  bool _deferProxies;
+
+  b2PolygonShape _polygonShape;
+  std::vector<b2Vec2> _scaledVertices;
+  std::vector<b2Body*> _pendingBodies;
+};
+
+} // namespace vigilante
+
+#endif // VIGILANTE_B2_BATCH_BUILDER_H_
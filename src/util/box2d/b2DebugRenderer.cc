@@ -21,6 +21,8 @@
  */
 #include "b2DebugRenderer.h"
 
+#include "gl/GpuTimer.h"
+
 using cocos2d::Director;
 using cocos2d::Renderer;
 using cocos2d::Mat4;
@@ -69,9 +71,10 @@ void b2DebugRenderer::onDraw(const Mat4& transform, uint32_t flags) {
   director->pushMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW);
   director->loadMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW, transform);
 
-  cocos2d::GL::enableVertexAttribs(cocos2d::GL::VERTEX_ATTRIB_FLAG_POSITION);
-
+  vigilante::GpuTimer::getInstance()->begin(vigilante::GpuTimer::Pass::DEBUG_DRAW);
   _world->DrawDebugData();
+  mB2DebugDraw->flush();
+  vigilante::GpuTimer::getInstance()->end(vigilante::GpuTimer::Pass::DEBUG_DRAW);
 
   CHECK_GL_ERROR_DEBUG();
 
@@ -0,0 +1,100 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_BINARY_STREAM_H_
+#define VIGILANTE_BINARY_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace vigilante {
+
+// A minimal little helper which appends trivially copyable values
+// and length-prefixed strings to an in-memory buffer.
+class BinaryWriter {
+ public:
+  BinaryWriter() : _buf() {}
+  virtual ~BinaryWriter() = default;
+
+  template <typename T>
+  void write(const T& val) {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+    _buf.append(reinterpret_cast<const char*>(&val), sizeof(T));
+  }
+
+  void writeString(const std::string& s) {
+    write<uint32_t>(s.size());
+    _buf.append(s);
+  }
+
+  const std::string& getBuffer() const {
+    return _buf;
+  }
+
+ private:
+  std::string _buf;
+};
+
+
+// Reads back what BinaryWriter wrote. The reader never reads past `end`.
+// Once an out-of-bound read has been attempted, isOk() returns false
+// and all subsequent reads yield zero-initialized values.
+class BinaryReader {
+ public:
+  BinaryReader(const char* begin, const char* end)
+      : _cur(begin), _end(end), _isOk(true) {}
+  virtual ~BinaryReader() = default;
+
+  template <typename T>
+  T read() {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+    T val{};
+    if (!_isOk || _end - _cur < static_cast<std::ptrdiff_t>(sizeof(T))) {
+      _isOk = false;
+      return val;
+    }
+    std::memcpy(&val, _cur, sizeof(T));
+    _cur += sizeof(T);
+    return val;
+  }
+
+  // Reads an element count. Since each element takes up at least one byte,
+  // a count larger than the number of remaining bytes means the data is corrupted.
+  uint32_t readCount() {
+    uint32_t count = read<uint32_t>();
+    if (!_isOk || static_cast<uint32_t>(_end - _cur) < count) {
+      _isOk = false;
+      return 0;
+    }
+    return count;
+  }
+
+  std::string readString() {
+    uint32_t size = read<uint32_t>();
+    if (!_isOk || static_cast<uint32_t>(_end - _cur) < size) {
+      _isOk = false;
+      return "";
+    }
+    std::string s(_cur, size);
+    _cur += size;
+    return s;
+  }
+
+  bool isOk() const {
+    return _isOk;
+  }
+
+  bool isEof() const {
+    return _cur == _end;
+  }
+
+ private:
+  const char* _cur;
+  const char* _end;
+  bool _isOk;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_BINARY_STREAM_H_
@@ -2,8 +2,11 @@
 #ifndef VIGILANTE_CIRCULAR_BUFFER_H_
 #define VIGILANTE_CIRCULAR_BUFFER_H_
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <utility>
 
 #include "std/make_unique.h"
 
@@ -11,6 +14,12 @@
 
 namespace vigilante {
 
+// A fixed-capacity ring buffer. One of its slots is always kept empty
+// (so that _head == _tail means it's empty), hence it holds up to
+// capacity() - 1 elements. Pushing into a full buffer drops the oldest one.
+// It's single-threaded only, see SpscCircularBuffer for passing
+// elements between two threads.
+
 template <typename T>
 class CircularBuffer {
  public:
@@ -18,7 +27,8 @@ class CircularBuffer {
   virtual ~CircularBuffer() = default;
   T& operator[] (size_t i);
 
-  void push(T val);
+  void push(const T& val);
+  void push(T&& val);
   void pop();
   void clear();
 
@@ -26,10 +36,15 @@ class CircularBuffer {
   size_t capacity() const;
   bool empty() const;
   bool full() const;
-  T front() const;
-  T back() const;
+  T& front();
+  const T& front() const;
+  T& back();
+  const T& back() const;
 
  protected:
+  // Advances _tail after _data[_tail] has been assigned.
+  void commitPush();
+
   std::unique_ptr<T[]> _data;
   int _head;
   int _tail;
@@ -38,6 +53,47 @@ class CircularBuffer {
 };
 
 
+// A fixed-capacity ring buffer which lets one producer thread pass elements
+// to one consumer thread without a mutex. Unlike CircularBuffer, pushing
+// into a full buffer fails instead of dropping anything, and all of the
+// `capacity` slots can be used.
+//
+// tryPush() must only be called by the producer thread, and tryPop()
+// by the consumer thread. size() may be called by either of them.
+
+template <typename T>
+class SpscCircularBuffer {
+ public:
+  explicit SpscCircularBuffer(size_t capacity=DEFAULT_CAPACITY);
+  virtual ~SpscCircularBuffer() = default;
+
+  SpscCircularBuffer(const SpscCircularBuffer&) = delete;
+  SpscCircularBuffer& operator=(const SpscCircularBuffer&) = delete;
+
+  bool tryPush(const T& val);
+  bool tryPush(T&& val);
+  // The slot is reset afterwards, so whatever the element holds
+  // is released by the consumer thread.
+  bool tryPop(T* val);
+
+  size_t size() const;
+  size_t capacity() const;
+
+ private:
+  template <typename U>
+  bool tryPushImpl(U&& val);
+
+  std::unique_ptr<T[]> _data;
+  const size_t _capacity;
+
+  // Both are monotonic, and the slot of the i-th element is i % _capacity.
+  // They are written by different threads, so they are kept on separate
+  // cache lines.
+  alignas(64) std::atomic<uint64_t> _head;  // written by the consumer
+  alignas(64) std::atomic<uint64_t> _tail;  // written by the producer
+};
+
+
 
 template <typename T>
 CircularBuffer<T>::CircularBuffer(int capacity)
@@ -50,32 +106,42 @@ T& CircularBuffer<T>::operator[] (size_t i) {
 
 
 template <typename T>
-void CircularBuffer<T>::push(T val) {
+void CircularBuffer<T>::push(const T& val) {
+  // The slot is assigned in place, so e.g., a std::string reuses its buffer.
   _data[_tail] = val;
-  
+  commitPush();
+}
+
+template <typename T>
+void CircularBuffer<T>::push(T&& val) {
+  _data[_tail] = std::move(val);
+  commitPush();
+}
+
+template <typename T>
+void CircularBuffer<T>::commitPush() {
   if (full()) {
     _head = (_head + 1) % _capacity;
-  }
-  _tail = (_tail + 1) % _capacity;
-
-  if (_size < _capacity) {
+  } else {
     _size++;
   }
+  _tail = (_tail + 1) % _capacity;
 }
 
 template <typename T>
 void CircularBuffer<T>::pop() {
-  _head = (_head + 1) % _capacity;
-
-  if (_size > 0) {
-    _size--;
+  if (empty()) {
+    return;
   }
+  _head = (_head + 1) % _capacity;
+  _size--;
 }
 
 template <typename T>
 void CircularBuffer<T>::clear() {
   _tail = 0;
   _head = 0;
+  _size = 0;
 }
 
 
@@ -91,24 +157,89 @@ size_t CircularBuffer<T>::capacity() const {
 
 template <typename T>
 bool CircularBuffer<T>::empty() const {
-  return _tail == _head;
+  return _size == 0;
 }
 
 template <typename T>
 bool CircularBuffer<T>::full() const {
-  return (_tail + 1) % (int) _capacity == _head;
+  return _size + 1 >= _capacity;
+}
+
+template <typename T>
+T& CircularBuffer<T>::front() {
+  return _data[_head];
 }
 
 template <typename T>
-T CircularBuffer<T>::front() const {
+const T& CircularBuffer<T>::front() const {
   return _data[_head];
 }
 
 template <typename T>
-T CircularBuffer<T>::back() const {
+T& CircularBuffer<T>::back() {
   return _data[(_tail - 1 < 0) ? _capacity - 1 : _tail - 1];
 }
 
+template <typename T>
+const T& CircularBuffer<T>::back() const {
+  return _data[(_tail - 1 < 0) ? _capacity - 1 : _tail - 1];
+}
+
+
+
+template <typename T>
+SpscCircularBuffer<T>::SpscCircularBuffer(size_t capacity)
+    : _data(std::make_unique<T[]>(capacity)), _capacity(capacity), _head(), _tail() {}
+
+template <typename T>
+bool SpscCircularBuffer<T>::tryPush(const T& val) {
+  return tryPushImpl(val);
+}
+
+template <typename T>
+bool SpscCircularBuffer<T>::tryPush(T&& val) {
+  return tryPushImpl(std::move(val));
+}
+
+template <typename T>
+template <typename U>
+bool SpscCircularBuffer<T>::tryPushImpl(U&& val) {
+  const uint64_t tail = _tail.load(std::memory_order_relaxed);
+  if (tail - _head.load(std::memory_order_acquire) >= _capacity) {
+    return false;
+  }
+
+  _data[tail % _capacity] = std::forward<U>(val);
+  // Publish the element to the consumer.
+  _tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool SpscCircularBuffer<T>::tryPop(T* val) {
+  const uint64_t head = _head.load(std::memory_order_relaxed);
+  if (head == _tail.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  T& slot = _data[head % _capacity];
+  *val = std::move(slot);
+  slot = T();
+  // Hand the slot back to the producer.
+  _head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+size_t SpscCircularBuffer<T>::size() const {
+  return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+}
+
+template <typename T>
+size_t SpscCircularBuffer<T>::capacity() const {
+  return _capacity;
+}
+
 }  // namespace vigilante
 
 #endif  // VIGILANTE_CIRCULAR_BUFFER_H_
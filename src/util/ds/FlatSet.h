@@ -0,0 +1,89 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_FLAT_SET_H_
+#define VIGILANTE_FLAT_SET_H_
+
+#include <algorithm>
+#include <vector>
+
+namespace vigilante {
+
+// A set of unique objects of type Key stored in a plain vector,
+// where the order of iteration is the order of insertion.
+// Lookups are linear, so it's meant for a handful of elements
+// (e.g., the characters within a character's attack range).
+
+template <typename Key>
+class FlatSet {
+ public:
+  using size_type = typename std::vector<Key>::size_type;
+  using iterator = typename std::vector<Key>::iterator;
+  using const_iterator = typename std::vector<Key>::const_iterator;
+
+  FlatSet() : _vec() {}
+  virtual ~FlatSet() = default;
+
+
+  void insert(const Key& key) {
+    if (!contains(key)) {
+      _vec.push_back(key);
+    }
+  }
+
+  size_type erase(const Key& key) {
+    auto it = std::find(_vec.begin(), _vec.end(), key);
+    if (it == _vec.end()) {
+      return 0;
+    }
+    _vec.erase(it);
+    return 1;
+  }
+
+  void clear() {
+    _vec.clear();
+  }
+
+
+  bool contains(const Key& key) const {
+    return std::find(_vec.begin(), _vec.end(), key) != _vec.end();
+  }
+
+  bool empty() const {
+    return _vec.empty();
+  }
+
+  size_type size() const {
+    return _vec.size();
+  }
+
+  iterator begin() {
+    return _vec.begin();
+  }
+
+  iterator end() {
+    return _vec.end();
+  }
+
+  const_iterator begin() const {
+    return _vec.begin();
+  }
+
+  const_iterator end() const {
+    return _vec.end();
+  }
+
+
+  Key& front() {
+    return _vec.front();
+  }
+
+  Key& back() {
+    return _vec.back();
+  }
+
+ protected:
+  std::vector<Key> _vec;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_FLAT_SET_H_
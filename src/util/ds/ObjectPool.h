@@ -0,0 +1,59 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_OBJECT_POOL_H_
+#define VIGILANTE_OBJECT_POOL_H_
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace vigilante {
+
+// A free list of the memory blocks of `T` objects, so that the objects which
+// are created and destroyed constantly (e.g., items being dropped, picked up
+// and traded) are recycled instead of hitting the heap each time.
+//
+// Meant to be used by the class-specific operator new/delete of T:
+//
+//   static void* operator new(size_t size) { return ObjectPool<T>::allocate(size); }
+//   static void operator delete(void* p, size_t size) { ObjectPool<T>::deallocate(p, size); }
+//
+// Since these operators are inherited, the blocks of any other size (i.e., a
+// subclass of T which doesn't declare its own) are passed to ::operator new/delete.
+//
+// Not thread-safe. All T objects must be created and destroyed on the main thread.
+template <typename T>
+class ObjectPool final {
+ public:
+  static void* allocate(size_t size) {
+    std::vector<void*>& freeBlocks = getFreeBlocks();
+    if (size != sizeof(T) || freeBlocks.empty()) {
+      return ::operator new(size);
+    }
+    void* block = freeBlocks.back();
+    freeBlocks.pop_back();
+    return block;
+  }
+
+  static void deallocate(void* block, size_t size) {
+    std::vector<void*>& freeBlocks = getFreeBlocks();
+    if (size != sizeof(T) || freeBlocks.size() >= _kMaxFreeBlocks) {
+      ::operator delete(block);
+      return;
+    }
+    freeBlocks.push_back(block);
+  }
+
+  static const size_t _kMaxFreeBlocks = 64;
+
+ private:
+  static std::vector<void*>& getFreeBlocks() {
+    // Intentionally leaked, so that the T objects destroyed during static
+    // destruction (e.g., those owned by singletons) can still be deallocated.
+    static std::vector<void*>* freeBlocks = new std::vector<void*>();
+    return *freeBlocks;
+  }
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_OBJECT_POOL_H_
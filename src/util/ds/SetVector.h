@@ -2,115 +2,288 @@
 #ifndef VIGILANTE_SET_VECTOR_H_
 #define VIGILANTE_SET_VECTOR_H_
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <initializer_list>
-#include <unordered_set>
+#include <iterator>
 #include <vector>
 
 namespace vigilante {
 
 // A vector that contains a set of unique objects of type Key
 // where the order of iteration is the order of insertion.
+//
+// The keys are stored in a dense vector of slots, and are indexed by
+// an open-addressing hash table (linear probing) which maps each key to
+// its slot, so insert(), erase() and contains() are O(1) on average.
+// An erased key only marks its slot as erased (and its index entry as
+// a tombstone), which the iterators skip, so the order of the other keys
+// is kept. Both are compacted once the erased slots outnumber the keys.
+// Note that insert() and erase() may invalidate the iterators.
 
 template <typename Key>
 class SetVector {
+ private:
+  struct Slot {
+    Key key;
+    bool isErased;
+  };
+
+  template <typename SlotType, typename KeyType>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using pointer = KeyType*;
+    using reference = KeyType&;
+
+    Iterator() : _slot(), _end() {}
+    Iterator(SlotType* slot, SlotType* end) : _slot(slot), _end(end) { skipErased(); }
+
+    // Allows converting an iterator to a const_iterator.
+    template <typename OtherSlotType, typename OtherKeyType>
+    Iterator(const Iterator<OtherSlotType, OtherKeyType>& other)
+        : _slot(other._slot), _end(other._end) {}
+
+    reference operator*() const { return _slot->key; }
+    pointer operator->() const { return &_slot->key; }
+
+    Iterator& operator++() {
+      ++_slot;
+      skipErased();
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator it = *this;
+      ++(*this);
+      return it;
+    }
+
+    bool operator==(const Iterator& other) const { return _slot == other._slot; }
+    bool operator!=(const Iterator& other) const { return _slot != other._slot; }
+
+   private:
+    template <typename, typename> friend class Iterator;
+
+    void skipErased() {
+      while (_slot != _end && _slot->isErased) {
+        ++_slot;
+      }
+    }
+
+    SlotType* _slot;
+    SlotType* _end;
+  };
+
  public:
-  using size_type = typename std::vector<Key>::size_type;
-  using iterator = typename std::vector<Key>::iterator;
-  using const_iterator = typename std::vector<Key>::const_iterator;
+  using size_type = size_t;
+  using iterator = Iterator<Slot, Key>;
+  using const_iterator = Iterator<const Slot, const Key>;
 
-  SetVector() : _set(), _vec() {}
+  SetVector() : _slots(), _index(), _size(), _numTombstones() {}
 
   SetVector(std::initializer_list<Key> init_list) : SetVector() {
     for (const auto& element : init_list) {
       insert(element);
     }
   }
-  
-  SetVector(const SetVector& other)
-      : _set(other._set), _vec(other._vec) {}
 
+  SetVector(const SetVector& other) = default;
   SetVector(SetVector&& other) noexcept
-      : _set(std::move(other._set)), _vec(std::move(other._vec)) {}
-
-  SetVector& operator=(const SetVector& other) {
-    _set = other._set;
-    _vec = other._vec;
-    return *this;
+      : _slots(std::move(other._slots)),
+        _index(std::move(other._index)),
+        _size(other._size),
+        _numTombstones(other._numTombstones) {
+    other._size = 0;
+    other._numTombstones = 0;
   }
-  
+
+  SetVector& operator=(const SetVector& other) = default;
   SetVector& operator=(SetVector&& other) noexcept {
-    _set = std::move(other._set);
-    _vec = std::move(other._vec);
+    _slots = std::move(other._slots);
+    _index = std::move(other._index);
+    _size = other._size;
+    _numTombstones = other._numTombstones;
+    other._size = 0;
+    other._numTombstones = 0;
     return *this;
   }
-  
+
   virtual ~SetVector() = default;
 
 
   void insert(Key key) {
-    auto it = _set.find(key);
-    if (it != _set.end()) {
-      return;
+    // Keep the load factor (including the tombstones) below 3/4.
+    if ((_size + _numTombstones + 1) * 4 > _index.size() * 3) {
+      rehash();
+    }
+
+    size_t i = bucketOf(key);
+    size_t firstTombstone = _index.size();
+    while (_index[i] != _kEmpty) {
+      if (_index[i] == _kTombstone) {
+        if (firstTombstone == _index.size()) {
+          firstTombstone = i;
+        }
+      } else if (_slots[_index[i]].key == key) {
+        return;
+      }
+      i = (i + 1) & (_index.size() - 1);
+    }
+
+    if (firstTombstone != _index.size()) {
+      i = firstTombstone;
+      _numTombstones--;
     }
-    _vec.push_back(key);
-    _set.insert(key);
+    _index[i] = static_cast<int32_t>(_slots.size());
+    _slots.push_back({key, false});
+    _size++;
   }
 
   size_type erase(Key key) {
-    auto it = _set.find(key);
-    if (it == _set.end()) {
+    const size_t i = find(key);
+    if (i == _index.size()) {
       return 0;
     }
 
-    _vec.erase(std::remove(_vec.begin(), _vec.end(), key), _vec.end());
-    _set.erase(key);
+    _slots[_index[i]].isErased = true;
+    _index[i] = _kTombstone;
+    _numTombstones++;
+    _size--;
+
+    if (_size == 0) {
+      clear();
+    } else if (_slots.size() - _size > _size) {
+      rehash();
+    }
     return 1;
   }
 
   void clear() {
-    _set.clear();
-    _vec.clear();
+    _slots.clear();
+    std::fill(_index.begin(), _index.end(), _kEmpty);
+    _size = 0;
+    _numTombstones = 0;
+  }
+
+
+  bool contains(const Key& key) const {
+    return find(key) != _index.size();
   }
-  
 
   bool empty() const {
-    return _vec.empty();
+    return _size == 0;
   }
 
   size_type size() const {
-    return _vec.size();
+    return _size;
   }
 
   iterator begin() {
-    return _vec.begin();
+    return iterator(_slots.data(), _slots.data() + _slots.size());
   }
 
   iterator end() {
-    return _vec.end();
+    return iterator(_slots.data() + _slots.size(), _slots.data() + _slots.size());
   }
 
   const_iterator begin() const {
-    return _vec.begin();
+    return const_iterator(_slots.data(), _slots.data() + _slots.size());
   }
 
   const_iterator end() const {
-    return _vec.end();
+    return const_iterator(_slots.data() + _slots.size(), _slots.data() + _slots.size());
   }
 
 
   Key& front() {
-    return _vec.front();
+    return *begin();
   }
 
   Key& back() {
-    return _vec.back();
+    auto it = _slots.rbegin();
+    while (it->isErased) {
+      ++it;
+    }
+    return it->key;
   }
 
  protected:
-  std::unordered_set<Key> _set;
-  std::vector<Key> _vec;
+  static constexpr int32_t _kEmpty = -1;
+  static constexpr int32_t _kTombstone = -2;
+  static constexpr size_t _kMinIndexSize = 8;
+
+  // std::hash is the identity for pointers and integers, whose low bits are
+  // mostly the same (e.g., the alignment of the actors), so the hash is
+  // scrambled by a Fibonacci multiply and the bucket is picked from the
+  // upper half of the product, which depends on all bits of the hash.
+  size_t bucketOf(const Key& key) const {
+    const uint64_t h = static_cast<uint64_t>(std::hash<Key>()(key)) * 0x9e3779b97f4a7c15ull;
+    return static_cast<size_t>(h >> 32) & (_index.size() - 1);
+  }
+
+  // Returns the index entry of `key`, or _index.size() if there's no such key.
+  size_t find(const Key& key) const {
+    if (_size == 0) {
+      return _index.size();
+    }
+
+    size_t i = bucketOf(key);
+    while (_index[i] != _kEmpty) {
+      if (_index[i] >= 0 && _slots[_index[i]].key == key) {
+        return i;
+      }
+      i = (i + 1) & (_index.size() - 1);
+    }
+    return _index.size();
+  }
+
+  // Drops the erased slots and the tombstones, and resizes the index
+  // so that it's at most half full (after inserting another key).
+  void rehash() {
+    size_t n = 0;
+    for (size_t i = 0; i < _slots.size(); i++) {
+      if (!_slots[i].isErased) {
+        _slots[n++] = std::move(_slots[i]);
+      }
+    }
+    _slots.resize(n);
+
+    size_t indexSize = _kMinIndexSize;
+    while (indexSize < (_size + 1) * 2) {
+      indexSize *= 2;
+    }
+    _index.assign(indexSize, _kEmpty);
+    _numTombstones = 0;
+
+    for (size_t s = 0; s < _slots.size(); s++) {
+      size_t i = bucketOf(_slots[s].key);
+      while (_index[i] != _kEmpty) {
+        i = (i + 1) & (_index.size() - 1);
+      }
+      _index[i] = static_cast<int32_t>(s);
+    }
+  }
+
+  std::vector<Slot> _slots;
+  std::vector<int32_t> _index;  // the size is a power of two
+  size_t _size;  // the number of keys, excluding the erased slots
+  size_t _numTombstones;
 };
 
+template <typename Key>
+constexpr int32_t SetVector<Key>::_kEmpty;
+
+template <typename Key>
+constexpr int32_t SetVector<Key>::_kTombstone;
+
+template <typename Key>
+constexpr size_t SetVector<Key>::_kMinIndexSize;
+
 }  // namespace vigilante
 
 #endif  // VIGILANTE_SET_VECTOR_H_
@@ -0,0 +1,138 @@
+// Copyright (c) 2018-2021 Marco Wang <m.aesophor@gmail.com>. All rights reserved.
+#ifndef VIGILANTE_TRIE_H_
+#define VIGILANTE_TRIE_H_
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vigilante {
+
+// A prefix tree of strings (e.g., the console's command names),
+// used for tab completion. All nodes are stored in one vector, and the
+// children of each node are kept sorted by their characters, so the words
+// can be enumerated in lexicographical order without any sorting.
+
+class Trie {
+ public:
+  Trie() : _nodes(1), _size() {}
+  virtual ~Trie() = default;
+
+
+  void insert(const std::string& word) {
+    int node = 0;
+    for (char c : word) {
+      auto& children = _nodes[node].children;
+      auto it = std::lower_bound(children.begin(), children.end(), c,
+                                 [](const std::pair<char, int>& child, char c) {
+        return child.first < c;
+      });
+      if (it != children.end() && it->first == c) {
+        node = it->second;
+        continue;
+      }
+
+      const int child = static_cast<int>(_nodes.size());
+      // `children` is invalidated by emplace_back(), so insert into it first.
+      children.insert(it, {c, child});
+      _nodes.emplace_back();
+      node = child;
+    }
+
+    if (!_nodes[node].isWord) {
+      _nodes[node].isWord = true;
+      _size++;
+    }
+  }
+
+  void clear() {
+    _nodes.assign(1, Node());
+    _size = 0;
+  }
+
+  bool empty() const {
+    return _size == 0;
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+
+  // Returns the longest string which all of the words starting with `prefix`
+  // start with (which is `prefix` itself if it's ambiguous),
+  // or an empty string if no word starts with `prefix`.
+  std::string complete(const std::string& prefix) const {
+    int node = find(prefix);
+    if (node < 0) {
+      return "";
+    }
+
+    std::string completion = prefix;
+    while (!_nodes[node].isWord && _nodes[node].children.size() == 1) {
+      completion += _nodes[node].children.front().first;
+      node = _nodes[node].children.front().second;
+    }
+    return completion;
+  }
+
+  // Appends up to `maxCount` words starting with `prefix` to `words`
+  // in lexicographical order.
+  void getWords(const std::string& prefix, std::vector<std::string>* words, size_t maxCount) const {
+    int node = find(prefix);
+    if (node < 0) {
+      return;
+    }
+
+    std::string word = prefix;
+    collect(node, &word, words, maxCount);
+  }
+
+
+ private:
+  struct Node {
+    Node() : children(), isWord() {}
+
+    std::vector<std::pair<char, int>> children;  // sorted by char
+    bool isWord;
+  };
+
+  // Returns the node of `prefix`, or -1 if there's no such node.
+  int find(const std::string& prefix) const {
+    int node = 0;
+    for (char c : prefix) {
+      const auto& children = _nodes[node].children;
+      auto it = std::lower_bound(children.begin(), children.end(), c,
+                                 [](const std::pair<char, int>& child, char c) {
+        return child.first < c;
+      });
+      if (it == children.end() || it->first != c) {
+        return -1;
+      }
+      node = it->second;
+    }
+    return node;
+  }
+
+  void collect(int node, std::string* word, std::vector<std::string>* words, size_t maxCount) const {
+    if (words->size() >= maxCount) {
+      return;
+    }
+    if (_nodes[node].isWord) {
+      words->push_back(*word);
+    }
+    for (const auto& child : _nodes[node].children) {
+      word->push_back(child.first);
+      collect(child.second, word, words, maxCount);
+      word->pop_back();
+    }
+  }
+
+  std::vector<Node> _nodes;  // _nodes[0] is the root
+  size_t _size;
+};
+
+}  // namespace vigilante
+
+#endif  // VIGILANTE_TRIE_H_